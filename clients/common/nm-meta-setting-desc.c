@@ -6434,6 +6434,15 @@ static const NMMetaPropertyInfo *const property_infos_SRIOV[] = {
 	PROPERTY_INFO_WITH_DESC (NM_SETTING_SRIOV_AUTOPROBE_DRIVERS,
 	    .property_type =                &_pt_gobject_enum,
 	),
+	PROPERTY_INFO_WITH_DESC (NM_SETTING_SRIOV_ESWITCH_MODE,
+	    .property_type =                &_pt_gobject_enum,
+	),
+	PROPERTY_INFO_WITH_DESC (NM_SETTING_SRIOV_ESWITCH_INLINE_MODE,
+	    .property_type =                &_pt_gobject_enum,
+	),
+	PROPERTY_INFO_WITH_DESC (NM_SETTING_SRIOV_ESWITCH_ENCAP_MODE,
+	    .property_type =                &_pt_gobject_enum,
+	),
 	NULL
 };
 
@@ -142,6 +142,8 @@ gboolean     nm_ip_route_attribute_validate  (const char *name,
 #define NM_IP_ROUTE_ATTRIBUTE_LOCK_INITCWND  "lock-initcwnd"
 #define NM_IP_ROUTE_ATTRIBUTE_LOCK_INITRWND  "lock-initrwnd"
 #define NM_IP_ROUTE_ATTRIBUTE_LOCK_MTU       "lock-mtu"
+#define NM_IP_ROUTE_ATTRIBUTE_NHID           "nhid"
+#define NM_IP_ROUTE_ATTRIBUTE_WEIGHT         "weight"
 
 /*****************************************************************************/
 
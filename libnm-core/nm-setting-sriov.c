@@ -22,6 +22,9 @@ NM_GOBJECT_PROPERTIES_DEFINE (NMSettingSriov,
 	PROP_TOTAL_VFS,
 	PROP_VFS,
 	PROP_AUTOPROBE_DRIVERS,
+	PROP_ESWITCH_MODE,
+	PROP_ESWITCH_INLINE_MODE,
+	PROP_ESWITCH_ENCAP_MODE,
 );
 
 /**
@@ -36,6 +39,9 @@ struct _NMSettingSriov {
 	GPtrArray *vfs;
 	guint total_vfs;
 	NMTernary autoprobe_drivers;
+	NMSriovEswitchMode eswitch_mode;
+	NMSriovEswitchInlineMode eswitch_inline_mode;
+	NMSriovEswitchEncapMode eswitch_encap_mode;
 };
 
 struct _NMSettingSriovClass {
@@ -852,6 +858,63 @@ nm_setting_sriov_get_autoprobe_drivers (NMSettingSriov *setting)
 	return setting->autoprobe_drivers;
 }
 
+/**
+ * nm_setting_sriov_get_eswitch_mode:
+ * @setting: the #NMSettingSriov
+ *
+ * Returns the value contained in the #NMSettingSriov:eswitch-mode
+ * property.
+ *
+ * Returns: the eswitch-mode property value
+ *
+ * Since: 1.22
+ **/
+NMSriovEswitchMode
+nm_setting_sriov_get_eswitch_mode (NMSettingSriov *setting)
+{
+	g_return_val_if_fail (NM_IS_SETTING_SRIOV (setting), NM_SRIOV_ESWITCH_MODE_PRESERVE);
+
+	return setting->eswitch_mode;
+}
+
+/**
+ * nm_setting_sriov_get_eswitch_inline_mode:
+ * @setting: the #NMSettingSriov
+ *
+ * Returns the value contained in the #NMSettingSriov:eswitch-inline-mode
+ * property.
+ *
+ * Returns: the eswitch-inline-mode property value
+ *
+ * Since: 1.22
+ **/
+NMSriovEswitchInlineMode
+nm_setting_sriov_get_eswitch_inline_mode (NMSettingSriov *setting)
+{
+	g_return_val_if_fail (NM_IS_SETTING_SRIOV (setting), NM_SRIOV_ESWITCH_INLINE_MODE_PRESERVE);
+
+	return setting->eswitch_inline_mode;
+}
+
+/**
+ * nm_setting_sriov_get_eswitch_encap_mode:
+ * @setting: the #NMSettingSriov
+ *
+ * Returns the value contained in the #NMSettingSriov:eswitch-encap-mode
+ * property.
+ *
+ * Returns: the eswitch-encap-mode property value
+ *
+ * Since: 1.22
+ **/
+NMSriovEswitchEncapMode
+nm_setting_sriov_get_eswitch_encap_mode (NMSettingSriov *setting)
+{
+	g_return_val_if_fail (NM_IS_SETTING_SRIOV (setting), NM_SRIOV_ESWITCH_ENCAP_MODE_PRESERVE);
+
+	return setting->eswitch_encap_mode;
+}
+
 static gint
 vf_index_compare (gconstpointer a, gconstpointer b)
 {
@@ -1176,6 +1239,15 @@ get_property (GObject *object, guint prop_id,
 	case PROP_AUTOPROBE_DRIVERS:
 		g_value_set_enum (value, self->autoprobe_drivers);
 		break;
+	case PROP_ESWITCH_MODE:
+		g_value_set_enum (value, self->eswitch_mode);
+		break;
+	case PROP_ESWITCH_INLINE_MODE:
+		g_value_set_enum (value, self->eswitch_inline_mode);
+		break;
+	case PROP_ESWITCH_ENCAP_MODE:
+		g_value_set_enum (value, self->eswitch_encap_mode);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -1201,6 +1273,15 @@ set_property (GObject *object, guint prop_id,
 	case PROP_AUTOPROBE_DRIVERS:
 		self->autoprobe_drivers = g_value_get_enum (value);
 		break;
+	case PROP_ESWITCH_MODE:
+		self->eswitch_mode = g_value_get_enum (value);
+		break;
+	case PROP_ESWITCH_INLINE_MODE:
+		self->eswitch_inline_mode = g_value_get_enum (value);
+		break;
+	case PROP_ESWITCH_ENCAP_MODE:
+		self->eswitch_encap_mode = g_value_get_enum (value);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -1369,6 +1450,74 @@ nm_setting_sriov_class_init (NMSettingSriovClass *klass)
 	                       G_PARAM_CONSTRUCT |
 	                       G_PARAM_STATIC_STRINGS);
 
+	/**
+	 * NMSettingSriov:eswitch-mode
+	 *
+	 * The mode of the eswitch of the device, that is configured via
+	 * devlink. Offloaded datapaths like OVS or TC flower need
+	 * %NM_SRIOV_ESWITCH_MODE_SWITCHDEV, which creates a representor
+	 * port for each VF.
+	 *
+	 * The mode can only be changed while the device has no VFs.
+	 * If it needs to change, NetworkManager destroys the existing
+	 * VFs first and creates them again afterwards.
+	 *
+	 * When set to %NM_SRIOV_ESWITCH_MODE_PRESERVE, the mode is not
+	 * changed.
+	 *
+	 * Since: 1.22
+	 **/
+	obj_properties[PROP_ESWITCH_MODE] =
+	    g_param_spec_enum (NM_SETTING_SRIOV_ESWITCH_MODE, "", "",
+	                       NM_TYPE_SRIOV_ESWITCH_MODE,
+	                       NM_SRIOV_ESWITCH_MODE_PRESERVE,
+	                       NM_SETTING_PARAM_FUZZY_IGNORE |
+	                       G_PARAM_READWRITE |
+	                       G_PARAM_CONSTRUCT |
+	                       G_PARAM_STATIC_STRINGS);
+
+	/**
+	 * NMSettingSriov:eswitch-inline-mode
+	 *
+	 * The minimal headers that the VFs inline in the transmit descriptor
+	 * for the eswitch. Some devices need this in switchdev mode to match
+	 * on the headers. Like #NMSettingSriov:eswitch-mode, it is applied
+	 * before creating the VFs.
+	 *
+	 * When set to %NM_SRIOV_ESWITCH_INLINE_MODE_PRESERVE, the inline mode
+	 * is not changed.
+	 *
+	 * Since: 1.22
+	 **/
+	obj_properties[PROP_ESWITCH_INLINE_MODE] =
+	    g_param_spec_enum (NM_SETTING_SRIOV_ESWITCH_INLINE_MODE, "", "",
+	                       NM_TYPE_SRIOV_ESWITCH_INLINE_MODE,
+	                       NM_SRIOV_ESWITCH_INLINE_MODE_PRESERVE,
+	                       NM_SETTING_PARAM_FUZZY_IGNORE |
+	                       G_PARAM_READWRITE |
+	                       G_PARAM_CONSTRUCT |
+	                       G_PARAM_STATIC_STRINGS);
+
+	/**
+	 * NMSettingSriov:eswitch-encap-mode
+	 *
+	 * Whether the eswitch offloads the encapsulation of tunnels. Like
+	 * #NMSettingSriov:eswitch-mode, it is applied before creating the VFs.
+	 *
+	 * When set to %NM_SRIOV_ESWITCH_ENCAP_MODE_PRESERVE, the encap mode
+	 * is not changed.
+	 *
+	 * Since: 1.22
+	 **/
+	obj_properties[PROP_ESWITCH_ENCAP_MODE] =
+	    g_param_spec_enum (NM_SETTING_SRIOV_ESWITCH_ENCAP_MODE, "", "",
+	                       NM_TYPE_SRIOV_ESWITCH_ENCAP_MODE,
+	                       NM_SRIOV_ESWITCH_ENCAP_MODE_PRESERVE,
+	                       NM_SETTING_PARAM_FUZZY_IGNORE |
+	                       G_PARAM_READWRITE |
+	                       G_PARAM_CONSTRUCT |
+	                       G_PARAM_STATIC_STRINGS);
+
 	g_object_class_install_properties (object_class, _PROPERTY_ENUMS_LAST, obj_properties);
 
 	_nm_setting_class_commit_full (setting_class, NM_META_SETTING_TYPE_SRIOV,
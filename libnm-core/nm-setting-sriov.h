@@ -26,6 +26,9 @@ G_BEGIN_DECLS
 #define NM_SETTING_SRIOV_TOTAL_VFS             "total-vfs"
 #define NM_SETTING_SRIOV_VFS                   "vfs"
 #define NM_SETTING_SRIOV_AUTOPROBE_DRIVERS     "autoprobe-drivers"
+#define NM_SETTING_SRIOV_ESWITCH_MODE          "eswitch-mode"
+#define NM_SETTING_SRIOV_ESWITCH_INLINE_MODE   "eswitch-inline-mode"
+#define NM_SETTING_SRIOV_ESWITCH_ENCAP_MODE    "eswitch-encap-mode"
 
 #define NM_SRIOV_VF_ATTRIBUTE_MAC              "mac"
 #define NM_SRIOV_VF_ATTRIBUTE_SPOOF_CHECK      "spoof-check"
@@ -50,6 +53,63 @@ typedef enum {
 	NM_SRIOV_VF_VLAN_PROTOCOL_802_1AD = 1,
 } NMSriovVFVlanProtocol;
 
+/**
+ * NMSriovEswitchMode:
+ * @NM_SRIOV_ESWITCH_MODE_PRESERVE: don't modify the current mode of the eswitch
+ * @NM_SRIOV_ESWITCH_MODE_LEGACY: the legacy SR-IOV mode, where the eswitch
+ *   is managed by the driver
+ * @NM_SRIOV_ESWITCH_MODE_SWITCHDEV: the switchdev mode, where a representor
+ *   port is created for each VF and the traffic can be offloaded
+ *
+ * #NMSriovEswitchMode indicates the mode of the eswitch of the device.
+ *
+ * Since: 1.22
+ */
+typedef enum {
+	NM_SRIOV_ESWITCH_MODE_PRESERVE  = -1,
+	NM_SRIOV_ESWITCH_MODE_LEGACY    = 0,
+	NM_SRIOV_ESWITCH_MODE_SWITCHDEV = 1,
+} NMSriovEswitchMode;
+
+/**
+ * NMSriovEswitchInlineMode:
+ * @NM_SRIOV_ESWITCH_INLINE_MODE_PRESERVE: don't modify the current inline mode
+ * @NM_SRIOV_ESWITCH_INLINE_MODE_NONE: the VFs don't inline any headers
+ * @NM_SRIOV_ESWITCH_INLINE_MODE_LINK: the VFs inline the L2 headers
+ * @NM_SRIOV_ESWITCH_INLINE_MODE_NETWORK: the VFs inline the L2 and L3 headers
+ * @NM_SRIOV_ESWITCH_INLINE_MODE_TRANSPORT: the VFs inline the L2, L3 and L4 headers
+ *
+ * #NMSriovEswitchInlineMode indicates which headers the VFs pass to the
+ * eswitch in the transmit descriptor, as required by some devices for
+ * the offloaded matching.
+ *
+ * Since: 1.22
+ */
+typedef enum {
+	NM_SRIOV_ESWITCH_INLINE_MODE_PRESERVE  = -1,
+	NM_SRIOV_ESWITCH_INLINE_MODE_NONE      = 0,
+	NM_SRIOV_ESWITCH_INLINE_MODE_LINK      = 1,
+	NM_SRIOV_ESWITCH_INLINE_MODE_NETWORK   = 2,
+	NM_SRIOV_ESWITCH_INLINE_MODE_TRANSPORT = 3,
+} NMSriovEswitchInlineMode;
+
+/**
+ * NMSriovEswitchEncapMode:
+ * @NM_SRIOV_ESWITCH_ENCAP_MODE_PRESERVE: don't modify the current encap mode
+ * @NM_SRIOV_ESWITCH_ENCAP_MODE_NONE: disable the offloading of tunnel encapsulation
+ * @NM_SRIOV_ESWITCH_ENCAP_MODE_BASIC: enable the offloading of tunnel encapsulation
+ *
+ * #NMSriovEswitchEncapMode indicates whether the eswitch offloads the
+ * encapsulation and decapsulation of tunnels.
+ *
+ * Since: 1.22
+ */
+typedef enum {
+	NM_SRIOV_ESWITCH_ENCAP_MODE_PRESERVE = -1,
+	NM_SRIOV_ESWITCH_ENCAP_MODE_NONE     = 0,
+	NM_SRIOV_ESWITCH_ENCAP_MODE_BASIC    = 1,
+} NMSriovEswitchEncapMode;
+
 NM_AVAILABLE_IN_1_14
 GType nm_setting_sriov_get_type (void);
 NM_AVAILABLE_IN_1_14
@@ -70,6 +130,12 @@ NM_AVAILABLE_IN_1_14
 void nm_setting_sriov_clear_vfs (NMSettingSriov *setting);
 NM_AVAILABLE_IN_1_14
 NMTernary nm_setting_sriov_get_autoprobe_drivers (NMSettingSriov *setting);
+NM_AVAILABLE_IN_1_22
+NMSriovEswitchMode nm_setting_sriov_get_eswitch_mode (NMSettingSriov *setting);
+NM_AVAILABLE_IN_1_22
+NMSriovEswitchInlineMode nm_setting_sriov_get_eswitch_inline_mode (NMSettingSriov *setting);
+NM_AVAILABLE_IN_1_22
+NMSriovEswitchEncapMode nm_setting_sriov_get_eswitch_encap_mode (NMSettingSriov *setting);
 
 NM_AVAILABLE_IN_1_14
 gboolean nm_sriov_vf_add_vlan (NMSriovVF *vf, guint vlan_id);
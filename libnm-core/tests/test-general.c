@@ -1681,6 +1681,14 @@ test_setting_ip_route_attributes (void)
 	TEST_ATTR ("lock-mtu", boolean, TRUE, AF_INET, TRUE,  TRUE);
 	TEST_ATTR ("lock-mtu", uint32,  1,    AF_INET, FALSE, TRUE);
 
+	TEST_ATTR ("nhid", uint32, 5,   AF_INET6, TRUE,  TRUE);
+	TEST_ATTR ("nhid", string, "5", AF_INET,  FALSE, TRUE);
+
+	TEST_ATTR ("weight", uint32, 1,   AF_INET,  TRUE,  TRUE);
+	TEST_ATTR ("weight", uint32, 256, AF_INET6, TRUE,  TRUE);
+	TEST_ATTR ("weight", uint32, 257, AF_INET,  FALSE, TRUE);
+	TEST_ATTR ("weight", string, "2", AF_INET,  FALSE, TRUE);
+
 	TEST_ATTR ("from", string, "fd01::1",     AF_INET6, TRUE,  TRUE);
 	TEST_ATTR ("from", string, "fd01::1/64",  AF_INET6, TRUE,  TRUE);
 	TEST_ATTR ("from", string, "fd01::1/128", AF_INET6, TRUE,  TRUE);
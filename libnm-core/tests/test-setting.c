@@ -1720,6 +1720,108 @@ test_sriov_setting (void)
 	nm_sriov_vf_unref (vf3);
 }
 
+static void
+_test_sriov_eswitch_range (NMSettingSriov *s_sriov, const char *property, int max)
+{
+	nm_auto_unref_gtypeclass GEnumClass *enum_class = NULL;
+	GParamSpec *pspec;
+	GValue value = G_VALUE_INIT;
+	int i;
+
+	pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (s_sriov), property);
+	g_assert (pspec);
+	g_assert (G_IS_PARAM_SPEC_ENUM (pspec));
+	g_assert_cmpint (G_PARAM_SPEC_ENUM (pspec)->default_value, ==, -1);
+
+	enum_class = g_type_class_ref (pspec->value_type);
+	g_assert_cmpint (enum_class->minimum, ==, -1);
+	g_assert_cmpint (enum_class->maximum, ==, max);
+
+	g_value_init (&value, pspec->value_type);
+	for (i = -2; i <= max + 1; i++) {
+		g_value_set_enum (&value, i);
+		if (i < -1 || i > max) {
+			g_assert (g_param_value_validate (pspec, &value));
+			g_assert_cmpint (g_value_get_enum (&value), ==, -1);
+			continue;
+		}
+		g_assert (!g_param_value_validate (pspec, &value));
+		g_object_set_property (G_OBJECT (s_sriov), property, &value);
+		g_value_reset (&value);
+		g_object_get_property (G_OBJECT (s_sriov), property, &value);
+		g_assert_cmpint (g_value_get_enum (&value), ==, i);
+	}
+	g_value_unset (&value);
+}
+
+static void
+test_sriov_eswitch (void)
+{
+	gs_unref_object NMConnection *con = NULL;
+	gs_unref_object NMConnection *con2 = NULL;
+	gs_unref_keyfile GKeyFile *keyfile = NULL;
+	gs_free_error GError *error = NULL;
+	NMSettingSriov *s_sriov;
+	NMSettingSriov *s_sriov2;
+
+	con = nmtst_create_minimal_connection ("sriov-eswitch",
+	                                       NULL,
+	                                       NM_SETTING_WIRED_SETTING_NAME,
+	                                       NULL);
+	s_sriov = NM_SETTING_SRIOV (nm_setting_sriov_new ());
+	nm_connection_add_setting (con, NM_SETTING (s_sriov));
+
+	g_assert_cmpint (nm_setting_sriov_get_eswitch_mode (s_sriov), ==, NM_SRIOV_ESWITCH_MODE_PRESERVE);
+	g_assert_cmpint (nm_setting_sriov_get_eswitch_inline_mode (s_sriov), ==, NM_SRIOV_ESWITCH_INLINE_MODE_PRESERVE);
+	g_assert_cmpint (nm_setting_sriov_get_eswitch_encap_mode (s_sriov), ==, NM_SRIOV_ESWITCH_ENCAP_MODE_PRESERVE);
+
+	nmtst_connection_normalize (con);
+
+	/* the defaults are not written. */
+	keyfile = nm_keyfile_write (con, NULL, NULL, &error);
+	nmtst_assert_success (keyfile, error);
+	g_assert (!g_key_file_has_key (keyfile, NM_SETTING_SRIOV_SETTING_NAME, NM_SETTING_SRIOV_ESWITCH_MODE, NULL));
+	g_assert (!g_key_file_has_key (keyfile, NM_SETTING_SRIOV_SETTING_NAME, NM_SETTING_SRIOV_ESWITCH_INLINE_MODE, NULL));
+	g_assert (!g_key_file_has_key (keyfile, NM_SETTING_SRIOV_SETTING_NAME, NM_SETTING_SRIOV_ESWITCH_ENCAP_MODE, NULL));
+	g_clear_pointer (&keyfile, g_key_file_unref);
+
+	_test_sriov_eswitch_range (s_sriov, NM_SETTING_SRIOV_ESWITCH_MODE, NM_SRIOV_ESWITCH_MODE_SWITCHDEV);
+	_test_sriov_eswitch_range (s_sriov, NM_SETTING_SRIOV_ESWITCH_INLINE_MODE, NM_SRIOV_ESWITCH_INLINE_MODE_TRANSPORT);
+	_test_sriov_eswitch_range (s_sriov, NM_SETTING_SRIOV_ESWITCH_ENCAP_MODE, NM_SRIOV_ESWITCH_ENCAP_MODE_BASIC);
+
+	g_object_set (s_sriov,
+	              NM_SETTING_SRIOV_ESWITCH_MODE, NM_SRIOV_ESWITCH_MODE_SWITCHDEV,
+	              NM_SETTING_SRIOV_ESWITCH_INLINE_MODE, NM_SRIOV_ESWITCH_INLINE_MODE_NETWORK,
+	              NM_SETTING_SRIOV_ESWITCH_ENCAP_MODE, NM_SRIOV_ESWITCH_ENCAP_MODE_NONE,
+	              NULL);
+	nmtst_assert_connection_verifies_without_normalization (con);
+
+	keyfile = nm_keyfile_write (con, NULL, NULL, &error);
+	nmtst_assert_success (keyfile, error);
+	g_assert_cmpint (g_key_file_get_integer (keyfile, NM_SETTING_SRIOV_SETTING_NAME, NM_SETTING_SRIOV_ESWITCH_MODE, NULL), ==, 1);
+	g_assert_cmpint (g_key_file_get_integer (keyfile, NM_SETTING_SRIOV_SETTING_NAME, NM_SETTING_SRIOV_ESWITCH_INLINE_MODE, NULL), ==, 2);
+	g_assert_cmpint (g_key_file_get_integer (keyfile, NM_SETTING_SRIOV_SETTING_NAME, NM_SETTING_SRIOV_ESWITCH_ENCAP_MODE, NULL), ==, 0);
+
+	con2 = nm_keyfile_read (keyfile,
+	                        "/ignored/current/working/directory/for/loading/relative/paths",
+	                        NULL,
+	                        NULL,
+	                        &error);
+	nmtst_assert_success (con2, error);
+
+	nm_keyfile_read_ensure_id (con2, "unused-because-already-has-id");
+	nm_keyfile_read_ensure_uuid (con2, "unused-because-already-has-uuid");
+
+	nmtst_connection_normalize (con2);
+
+	nmtst_assert_connection_equals (con, FALSE, con2, FALSE);
+
+	s_sriov2 = NM_SETTING_SRIOV (nm_connection_get_setting (con2, NM_TYPE_SETTING_SRIOV));
+	g_assert_cmpint (nm_setting_sriov_get_eswitch_mode (s_sriov2), ==, NM_SRIOV_ESWITCH_MODE_SWITCHDEV);
+	g_assert_cmpint (nm_setting_sriov_get_eswitch_inline_mode (s_sriov2), ==, NM_SRIOV_ESWITCH_INLINE_MODE_NETWORK);
+	g_assert_cmpint (nm_setting_sriov_get_eswitch_encap_mode (s_sriov2), ==, NM_SRIOV_ESWITCH_ENCAP_MODE_NONE);
+}
+
 typedef struct {
 	guint id;
 	guint qos;
@@ -3622,6 +3724,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/libnm/settings/sriov/vf-dup", test_sriov_vf_dup);
 	g_test_add_func ("/libnm/settings/sriov/vf-vlan", test_sriov_vf_vlan);
 	g_test_add_func ("/libnm/settings/sriov/setting", test_sriov_setting);
+	g_test_add_func ("/libnm/settings/sriov/eswitch", test_sriov_eswitch);
 	g_test_add_func ("/libnm/settings/sriov/vlans", test_sriov_parse_vlans);
 
 	g_test_add_func ("/libnm/settings/tc_config/qdisc", test_tc_config_qdisc);
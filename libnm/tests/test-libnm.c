@@ -2590,6 +2590,9 @@ test_types (void)
 		G (nm_setting_wireless_wake_on_wlan_get_type),
 		G (nm_setting_wpan_get_type),
 		G (nm_simple_connection_get_type),
+		G (nm_sriov_eswitch_encap_mode_get_type),
+		G (nm_sriov_eswitch_inline_mode_get_type),
+		G (nm_sriov_eswitch_mode_get_type),
 		G (nm_sriov_vf_get_type),
 		G (nm_sriov_vf_vlan_protocol_get_type),
 		G (nm_state_get_type),
@@ -459,8 +459,13 @@ bridge_set_vlan_options (NMDevice *device, NMSettingBridge *s_bridge)
 	if (!nm_platform_sysctl_master_set_option (plat, ifindex, "default_pvid", "0"))
 		return FALSE;
 
-	/* Clear all existing VLANs */
-	if (!nm_platform_link_set_bridge_vlans (plat, ifindex, FALSE, NULL))
+	g_object_get (s_bridge, NM_SETTING_BRIDGE_VLANS, &vlans, NULL);
+	plat_vlans = setting_vlans_to_platform (vlans);
+
+	/* Clear the existing VLANs, except for the ones that are already
+	 * configured as requested. Those are skipped when adding the
+	 * VLANs below. */
+	if (!nm_platform_link_flush_bridge_vlans (plat, ifindex, FALSE, plat_vlans))
 		return FALSE;
 
 	/* Now set the default PVID. After this point the kernel creates
@@ -476,8 +481,6 @@ bridge_set_vlan_options (NMDevice *device, NMSettingBridge *s_bridge)
 
 	/* Create VLANs only after setting the default PVID, so that
 	 * any PVID VLAN overrides the bridge's default PVID. */
-	g_object_get (s_bridge, NM_SETTING_BRIDGE_VLANS, &vlans, NULL);
-	plat_vlans = setting_vlans_to_platform (vlans);
 	if (   plat_vlans
 	    && !nm_platform_link_set_bridge_vlans (plat, ifindex, FALSE, plat_vlans))
 		return FALSE;
@@ -37,7 +37,9 @@ _LOG_DECLARE_SELF(NMDeviceWireGuard);
  *   as well. We may use policy-routing like wg-quick does. See also disussions at
  *   https://www.wireguard.com/netns/#improving-the-classic-solutions */
 
-/* TODO: honor the TTL of DNS to determine when to retry resolving endpoints. */
+/* TODO: honor the TTL of DNS to determine when to retry resolving endpoints. GResolver
+ *   does not expose the TTL, so the shared resolve cache uses a short, fixed lifetime
+ *   instead (see RESOLVE_CACHE_TTL_MSEC). */
 
 /* TODO: when we get multiple IP addresses when resolving a peer endpoint. We currently
  *   just take the first from GAI. We should only accept AAAA/IPv6 if we also have a suitable
@@ -68,6 +70,17 @@ G_STATIC_ASSERT (NM_WIREGUARD_SYMMETRIC_KEY_LEN == NMP_WIREGUARD_SYMMETRIC_KEY_L
 
 #define RETRY_IN_MSEC_MAX ((gint64) (30 * 60 * 1000))
 
+/* the maximum number of concurrent name lookups, for all WireGuard devices together. */
+#define RESOLVE_MAX_PARALLEL 16
+
+/* a lookup that takes longer than this is aborted and counts as failure for the
+ * waiting peers. That way, unresponsive names don't block the parallel slots
+ * for the other peers. */
+#define RESOLVE_TIMEOUT_MSEC ((guint) (15 * 1000))
+
+/* how long a successful lookup result is reused, before asking the resolver again. */
+#define RESOLVE_CACHE_TTL_MSEC ((gint64) (60 * 1000))
+
 typedef enum {
 	LINK_CONFIG_MODE_FULL,
 	LINK_CONFIG_MODE_REAPPLY,
@@ -466,6 +479,405 @@ coerce_route_table (NMDevice *device,
 
 /*****************************************************************************/
 
+/* Name resolution for peer endpoints is shared between all WireGuard devices.
+ *
+ * - lookups for the same host name are merged into one request.
+ * - successful results are cached for RESOLVE_CACHE_TTL_MSEC.
+ * - at most RESOLVE_MAX_PARALLEL lookups run at the same time, the others
+ *   are queued.
+ * - failures are not cached. Each peer backs off by itself, see
+ *   _peers_retry_in_msec(). */
+
+typedef struct {
+	char *host;
+
+	/* linked in _resolve.lst_queue_head while waiting for a free slot. */
+	CList lst_queue;
+
+	/* the GTask instances waiting for the result. A task whose
+	 * cancellable gets cancelled is dropped right away, see
+	 * _resolve_task_cancelled_cb(). */
+	GPtrArray *tasks;
+
+	/* the cached result (a list of GInetAddress), valid until @expiry_nsec. */
+	GList *addresses;
+	gint64 expiry_nsec;
+
+	/* set while the lookup is in progress. */
+	GCancellable *cancellable;
+	guint timeout_id;
+
+	/* the result of the ongoing lookup must not be cached, because the
+	 * cache was flushed after it started. */
+	bool result_stale:1;
+} ResolveEntry;
+
+static struct {
+	GHashTable *entries;
+	CList lst_queue_head;
+	guint n_running;
+	guint gc_id;
+} _resolve;
+
+static void
+_resolve_addresses_free (gpointer list)
+{
+	g_list_free_full (list, g_object_unref);
+}
+
+static GList *
+_resolve_addresses_copy (GList *list)
+{
+	return g_list_copy_deep (list, (GCopyFunc) g_object_ref, NULL);
+}
+
+static void
+_resolve_entry_free (gpointer data)
+{
+	ResolveEntry *entry = data;
+
+	nm_assert (entry->tasks->len == 0);
+	nm_assert (!entry->cancellable);
+	nm_assert (entry->timeout_id == 0);
+
+	c_list_unlink_stale (&entry->lst_queue);
+	g_ptr_array_unref (entry->tasks);
+	_resolve_addresses_free (entry->addresses);
+	g_free (entry->host);
+	g_slice_free (ResolveEntry, entry);
+}
+
+static void _resolve_task_cancelled_cb (GCancellable *cancellable, GTask *task);
+
+static void
+_resolve_task_detach (GTask *task)
+{
+	GCancellable *cancellable = g_task_get_cancellable (task);
+
+	if (cancellable)
+		g_signal_handlers_disconnect_by_func (cancellable, _resolve_task_cancelled_cb, task);
+}
+
+static void
+_resolve_task_cancelled_cb (GCancellable *cancellable,
+                            GTask *task)
+{
+	gs_unref_object GTask *task_keep_alive = g_object_ref (task);
+	ResolveEntry *entry = g_task_get_task_data (task);
+
+	/* don't keep the task of a cancelled waiter until the shared
+	 * lookup completes. */
+	_resolve_task_detach (task);
+	g_ptr_array_remove (entry->tasks, task);
+
+	if (entry->tasks->len == 0) {
+		/* nobody waits for a lookup that did not start yet. */
+		c_list_unlink (&entry->lst_queue);
+	}
+
+	/* the callback might start a new lookup. Only return when @entry
+	 * is consistent again. */
+	g_task_return_error_if_cancelled (task);
+}
+
+static gboolean
+_resolve_entry_is_idle (const ResolveEntry *entry)
+{
+	return    entry->tasks->len == 0
+	       && !entry->cancellable
+	       && !c_list_is_linked (&entry->lst_queue);
+}
+
+static gboolean
+_resolve_gc_cb (gpointer user_data)
+{
+	GHashTableIter iter;
+	ResolveEntry *entry;
+	gint64 now;
+
+	_resolve.gc_id = 0;
+
+	now = nm_utils_get_monotonic_timestamp_ns ();
+	g_hash_table_iter_init (&iter, _resolve.entries);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry)) {
+		if (   _resolve_entry_is_idle (entry)
+		    && entry->expiry_nsec <= now)
+			g_hash_table_iter_remove (&iter);
+	}
+
+	if (g_hash_table_size (_resolve.entries) > 0) {
+		_resolve.gc_id = g_timeout_add (RESOLVE_CACHE_TTL_MSEC,
+		                                _resolve_gc_cb,
+		                                NULL);
+	}
+	return G_SOURCE_REMOVE;
+}
+
+static void _resolve_queue_process (void);
+
+static void
+_resolve_entry_complete (ResolveEntry *entry,
+                         GList *addresses,
+                         GError *error)
+{
+	gs_unref_ptrarray GPtrArray *tasks = NULL;
+	guint i;
+
+	nm_assert (entry->cancellable);
+	nm_assert ((!error) != (!addresses));
+	nm_assert (_resolve.n_running > 0);
+
+	nm_clear_g_source (&entry->timeout_id);
+	g_clear_object (&entry->cancellable);
+	_resolve.n_running--;
+
+	_resolve_addresses_free (g_steal_pointer (&entry->addresses));
+	entry->expiry_nsec = 0;
+	if (   addresses
+	    && !entry->result_stale) {
+		entry->addresses = _resolve_addresses_copy (addresses);
+		entry->expiry_nsec =   nm_utils_get_monotonic_timestamp_ns ()
+		                     + (RESOLVE_CACHE_TTL_MSEC * NM_UTILS_NS_PER_MSEC);
+	}
+	entry->result_stale = FALSE;
+
+	/* the callbacks may start new lookups for this entry. Steal the list
+	 * of tasks first. */
+	tasks = g_steal_pointer (&entry->tasks);
+	entry->tasks = g_ptr_array_new_with_free_func (g_object_unref);
+
+	/* a callback might cancel one of the other tasks. */
+	for (i = 0; i < tasks->len; i++)
+		_resolve_task_detach (tasks->pdata[i]);
+
+	for (i = 0; i < tasks->len; i++) {
+		GTask *task = tasks->pdata[i];
+
+		if (g_task_return_error_if_cancelled (task))
+			continue;
+		if (error)
+			g_task_return_error (task, g_error_copy (error));
+		else {
+			g_task_return_pointer (task,
+			                       _resolve_addresses_copy (addresses),
+			                       _resolve_addresses_free);
+		}
+	}
+
+	_resolve_queue_process ();
+}
+
+static void
+_resolve_lookup_cb (GObject *source_object,
+                    GAsyncResult *res,
+                    gpointer user_data)
+{
+	gs_free_error GError *error = NULL;
+	GList *addresses;
+
+	addresses = g_resolver_lookup_by_name_finish (G_RESOLVER (source_object), res, &error);
+
+	if (nm_utils_error_is_cancelled (error, FALSE))
+		return;
+
+	_resolve_entry_complete (user_data, addresses, error);
+	_resolve_addresses_free (addresses);
+}
+
+static gboolean
+_resolve_lookup_timeout_cb (gpointer user_data)
+{
+	ResolveEntry *entry = user_data;
+	gs_free_error GError *error = NULL;
+
+	entry->timeout_id = 0;
+
+	nm_log_trace (LOGD_DEVICE, "wireguard-resolve: lookup of \"%s\" timed out", entry->host);
+
+	/* cancelling makes _resolve_lookup_cb() ignore the late result. */
+	g_cancellable_cancel (entry->cancellable);
+
+	g_set_error (&error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+	             "timeout resolving \"%s\"", entry->host);
+	_resolve_entry_complete (entry, NULL, error);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+_resolve_queue_process (void)
+{
+	ResolveEntry *entry;
+
+	while (   _resolve.n_running < RESOLVE_MAX_PARALLEL
+	       && (entry = c_list_first_entry (&_resolve.lst_queue_head, ResolveEntry, lst_queue))) {
+		gs_unref_object GResolver *resolver = NULL;
+
+		c_list_unlink (&entry->lst_queue);
+
+		/* cancelled tasks are already gone. Don't waste a lookup if
+		 * nobody is interested anymore. */
+		if (entry->tasks->len == 0)
+			continue;
+
+		resolver = g_resolver_get_default ();
+
+		_resolve.n_running++;
+		entry->cancellable = g_cancellable_new ();
+		g_resolver_lookup_by_name_async (resolver,
+		                                 entry->host,
+		                                 entry->cancellable,
+		                                 _resolve_lookup_cb,
+		                                 entry);
+		entry->timeout_id = g_timeout_add (RESOLVE_TIMEOUT_MSEC,
+		                                   _resolve_lookup_timeout_cb,
+		                                   entry);
+	}
+}
+
+static void
+_resolve_lookup_async (const char *host,
+                       GCancellable *cancellable,
+                       GAsyncReadyCallback callback,
+                       gpointer user_data)
+{
+	gs_unref_object GTask *task = NULL;
+	ResolveEntry *entry;
+
+	nm_assert (host);
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_source_tag (task, _resolve_lookup_async);
+
+	if (G_UNLIKELY (!_resolve.entries)) {
+		_resolve.entries = g_hash_table_new_full (nm_str_hash, g_str_equal, NULL, _resolve_entry_free);
+		c_list_init (&_resolve.lst_queue_head);
+	}
+
+	entry = g_hash_table_lookup (_resolve.entries, host);
+	if (!entry) {
+		entry = g_slice_new (ResolveEntry);
+		*entry = (ResolveEntry) {
+			.host      = g_strdup (host),
+			.lst_queue = C_LIST_INIT (entry->lst_queue),
+			.tasks     = g_ptr_array_new_with_free_func (g_object_unref),
+		};
+		g_hash_table_insert (_resolve.entries, entry->host, entry);
+	}
+
+	if (!_resolve.gc_id) {
+		_resolve.gc_id = g_timeout_add (RESOLVE_CACHE_TTL_MSEC,
+		                                _resolve_gc_cb,
+		                                NULL);
+	}
+
+	if (   entry->addresses
+	    && entry->expiry_nsec > nm_utils_get_monotonic_timestamp_ns ()) {
+		g_task_return_pointer (task,
+		                       _resolve_addresses_copy (entry->addresses),
+		                       _resolve_addresses_free);
+		return;
+	}
+
+	if (g_task_return_error_if_cancelled (task))
+		return;
+
+	g_task_set_task_data (task, entry, NULL);
+	if (cancellable) {
+		g_signal_connect (cancellable,
+		                  "cancelled",
+		                  G_CALLBACK (_resolve_task_cancelled_cb),
+		                  task);
+	}
+	g_ptr_array_add (entry->tasks, g_steal_pointer (&task));
+
+	if (   !entry->cancellable
+	    && !c_list_is_linked (&entry->lst_queue)) {
+		c_list_link_tail (&_resolve.lst_queue_head, &entry->lst_queue);
+		_resolve_queue_process ();
+	}
+}
+
+static GList *
+_resolve_lookup_finish (GAsyncResult *result,
+                        GError **error)
+{
+	g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+	g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == _resolve_lookup_async, NULL);
+
+	return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/* forget all cached results, for example after the DNS configuration changed. */
+static void
+_resolve_cache_flush (void)
+{
+	GHashTableIter iter;
+	ResolveEntry *entry;
+
+	if (!_resolve.entries)
+		return;
+
+	g_hash_table_iter_init (&iter, _resolve.entries);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry)) {
+		_resolve_addresses_free (g_steal_pointer (&entry->addresses));
+		entry->expiry_nsec = 0;
+		if (entry->cancellable)
+			entry->result_stale = TRUE;
+	}
+}
+
+void
+_nmtst_device_wireguard_resolve_lookup_async (const char *host,
+                                              GCancellable *cancellable,
+                                              GAsyncReadyCallback callback,
+                                              gpointer user_data)
+{
+	_resolve_lookup_async (host, cancellable, callback, user_data);
+}
+
+GList *
+_nmtst_device_wireguard_resolve_lookup_finish (GAsyncResult *result,
+                                               GError **error)
+{
+	return _resolve_lookup_finish (result, error);
+}
+
+/* let the cached results expire, as if RESOLVE_CACHE_TTL_MSEC passed. */
+void
+_nmtst_device_wireguard_resolve_cache_expire (void)
+{
+	GHashTableIter iter;
+	ResolveEntry *entry;
+	gint64 now;
+
+	if (!_resolve.entries)
+		return;
+
+	now = nm_utils_get_monotonic_timestamp_ns ();
+	g_hash_table_iter_init (&iter, _resolve.entries);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry)) {
+		if (entry->addresses)
+			entry->expiry_nsec = now;
+	}
+}
+
+guint
+_nmtst_device_wireguard_resolve_get_n_running (void)
+{
+	return _resolve.n_running;
+}
+
+guint
+_nmtst_device_wireguard_resolve_get_n_waiters (const char *host)
+{
+	ResolveEntry *entry;
+
+	entry = _resolve.entries ? g_hash_table_lookup (_resolve.entries, host) : NULL;
+	return entry ? entry->tasks->len : 0u;
+}
+
+/*****************************************************************************/
+
 static gboolean
 _peer_data_equal (gconstpointer ptr_a, gconstpointer ptr_b)
 {
@@ -682,7 +1094,7 @@ _peers_resolve_cb (GObject *source_object,
 	char s_sockaddr[100];
 	char s_retry[100];
 
-	list = g_resolver_lookup_by_name_finish (G_RESOLVER (source_object), res, &resolv_error);
+	list = _resolve_lookup_finish (res, &resolv_error);
 
 	if (nm_utils_error_is_cancelled (resolv_error, FALSE))
 		return;
@@ -802,11 +1214,8 @@ static void
 _peers_resolve_start (NMDeviceWireGuard *self,
                       PeerData *peer_data)
 {
-	gs_unref_object GResolver *resolver = NULL;
 	const char *host;
 
-	resolver = g_resolver_get_default ();
-
 	nm_assert (!peer_data->ep_resolv.cancellable);
 
 	peer_data->ep_resolv.cancellable = g_cancellable_new ();
@@ -820,11 +1229,10 @@ _peers_resolve_start (NMDeviceWireGuard *self,
 
 	host = nm_sock_addr_endpoint_get_host (_nm_wireguard_peer_get_endpoint (peer_data->peer));
 
-	g_resolver_lookup_by_name_async (resolver,
-	                                 host,
-	                                 peer_data->ep_resolv.cancellable,
-	                                 _peers_resolve_cb,
-	                                 peer_data);
+	_resolve_lookup_async (host,
+	                       peer_data->ep_resolv.cancellable,
+	                       _peers_resolve_cb,
+	                       peer_data);
 
 	_LOGT (LOGD_DEVICE, "wireguard-peer[%s]: resolving name \"%s\" for endpoint \"%s\"...",
 	       nm_wireguard_peer_get_public_key (peer_data->peer),
@@ -838,6 +1246,8 @@ _peers_resolve_reresolve_all (NMDeviceWireGuard *self)
 	NMDeviceWireGuardPrivate *priv = NM_DEVICE_WIREGUARD_GET_PRIVATE (self);
 	PeerData *peer_data;
 
+	_resolve_cache_flush ();
+
 	c_list_for_each_entry (peer_data, &priv->lst_peers_head, lst_peers) {
 		if (peer_data->ep_resolv.cancellable) {
 			/* remember to retry when the currently ongoing request completes. */
@@ -24,4 +24,14 @@ typedef struct _NMDeviceWireGuardClass NMDeviceWireGuardClass;
 
 GType nm_device_wireguard_get_type (void);
 
+void _nmtst_device_wireguard_resolve_lookup_async (const char *host,
+                                                   GCancellable *cancellable,
+                                                   GAsyncReadyCallback callback,
+                                                   gpointer user_data);
+GList *_nmtst_device_wireguard_resolve_lookup_finish (GAsyncResult *result,
+                                                      GError **error);
+void _nmtst_device_wireguard_resolve_cache_expire (void);
+guint _nmtst_device_wireguard_resolve_get_n_running (void);
+guint _nmtst_device_wireguard_resolve_get_n_waiters (const char *host);
+
 #endif /* __NM_DEVICE_WIREGUARD_H__ */
@@ -113,8 +113,12 @@ typedef struct {
 	GCancellable *cancellable;
 	NMPlatformAsyncCallback callback;
 	gpointer callback_data;
+	NMPlatformVF **vfs;
 	guint num_vfs;
 	NMTernary autoprobe;
+	NMSriovEswitchMode eswitch_mode;
+	NMSriovEswitchInlineMode eswitch_inline_mode;
+	NMSriovEswitchEncapMode eswitch_encap_mode;
 } SriovOp;
 
 typedef void (*AcdCallback) (NMDevice *, NMIP4Config **, gboolean);
@@ -418,6 +422,10 @@ typedef struct _NMDevicePrivate {
 		NMIPConfig *ip_config_x[2];
 	};
 
+	/* The routes that the last commit of ip_config_x synced to platform,
+	 * so that the next commit only needs to apply the difference. */
+	NMPlatformIPRouteSyncState *route_sync_state_x[2];
+
 	/* Config from DHCP, PPP, LLv4, etc */
 	AppliedConfig  dev_ip_config_4;
 
@@ -4246,6 +4254,14 @@ nm_device_update_from_platform_link (NMDevice *self, const NMPlatformLink *plink
 
 /*****************************************************************************/
 
+static void
+sriov_op_free (SriovOp *op)
+{
+	nm_auto_freev NMPlatformVF **vfs = g_steal_pointer (&op->vfs);
+
+	nm_g_slice_free (op);
+}
+
 static void
 sriov_op_start (NMDevice *self, SriovOp *op)
 {
@@ -4261,6 +4277,9 @@ sriov_op_start (NMDevice *self, SriovOp *op)
 	                                         priv->ifindex,
 	                                         op->num_vfs,
 	                                         op->autoprobe,
+	                                         op->eswitch_mode,
+	                                         op->eswitch_inline_mode,
+	                                         op->eswitch_encap_mode,
 	                                         sriov_op_cb,
 	                                         op,
 	                                         op->cancellable);
@@ -4270,11 +4289,29 @@ static void
 sriov_op_cb (GError *error, gpointer user_data)
 {
 	SriovOp *op = user_data;
-	gs_unref_object NMDevice *self = op->device;
-	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (self);
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (op->device);
+	gs_unref_object NMDevice *self = NULL;
 
 	nm_assert (op == priv->sriov.pending);
 
+	if (   !error
+	    && op->vfs) {
+		nm_auto_freev NMPlatformVF **vfs = g_steal_pointer (&op->vfs);
+
+		/* the VFs exist now. Configure them as part of the same operation,
+		 * so that they don't race with a following change of the number
+		 * of VFs. */
+		nm_platform_link_set_sriov_vfs_async (nm_device_get_platform (op->device),
+		                                      priv->ifindex,
+		                                      (const NMPlatformVF *const *) vfs,
+		                                      sriov_op_cb,
+		                                      op,
+		                                      op->cancellable);
+		return;
+	}
+
+	self = g_steal_pointer (&op->device);
+
 	priv->sriov.pending = NULL;
 
 	g_clear_object (&op->cancellable);
@@ -4284,7 +4321,7 @@ sriov_op_cb (GError *error, gpointer user_data)
 
 	nm_assert (!priv->sriov.pending);
 
-	nm_g_slice_free (op);
+	sriov_op_free (op);
 
 	if (priv->sriov.next) {
 		sriov_op_start (self,
@@ -4309,7 +4346,7 @@ sriov_op_queue_op (NMDevice *self,
 			op_next->callback (error, op_next->callback_data);
 		}
 
-		nm_g_slice_free (op_next);
+		sriov_op_free (op_next);
 
 		if (!priv->sriov.pending) {
 			/* This (having "next" set but "pending" not) can only happen if we are
@@ -4334,6 +4371,10 @@ static void
 sriov_op_queue (NMDevice *self,
                 guint num_vfs,
                 NMTernary autoprobe,
+                NMSriovEswitchMode eswitch_mode,
+                NMSriovEswitchInlineMode eswitch_inline_mode,
+                NMSriovEswitchEncapMode eswitch_encap_mode,
+                NMPlatformVF **vfs,
                 NMPlatformAsyncCallback callback,
                 gpointer callback_data)
 {
@@ -4360,10 +4401,14 @@ sriov_op_queue (NMDevice *self,
 
 	op = g_slice_new (SriovOp);
 	*op = (SriovOp) {
-		.num_vfs       = num_vfs,
-		.autoprobe     = autoprobe,
-		.callback      = callback,
-		.callback_data = callback_data,
+		.num_vfs             = num_vfs,
+		.autoprobe           = autoprobe,
+		.eswitch_mode        = eswitch_mode,
+		.eswitch_inline_mode = eswitch_inline_mode,
+		.eswitch_encap_mode  = eswitch_encap_mode,
+		.vfs                 = vfs,
+		.callback            = callback,
+		.callback_data       = callback_data,
 	};
 	sriov_op_queue_op (self, op);
 }
@@ -4383,7 +4428,15 @@ device_init_static_sriov_num_vfs (NMDevice *self)
 		                                          NULL);
 		num_vfs = _nm_utils_ascii_str_to_int64 (value, 10, 0, G_MAXINT32, -1);
 		if (num_vfs >= 0)
-			sriov_op_queue (self, num_vfs, NM_TERNARY_DEFAULT, NULL, NULL);
+			sriov_op_queue (self,
+			                num_vfs,
+			                NM_TERNARY_DEFAULT,
+			                NM_SRIOV_ESWITCH_MODE_PRESERVE,
+			                NM_SRIOV_ESWITCH_INLINE_MODE_PRESERVE,
+			                NM_SRIOV_ESWITCH_ENCAP_MODE_PRESERVE,
+			                NULL,
+			                NULL,
+			                NULL);
 	}
 }
 
@@ -6424,11 +6477,8 @@ sriov_vf_config_to_platform (NMDevice *self,
 static void
 sriov_params_cb (GError *error, gpointer data)
 {
-	NMDevice *self;
+	NMDevice *self = data;
 	NMDevicePrivate *priv;
-	nm_auto_freev NMPlatformVF **plat_vfs = NULL;
-
-	nm_utils_user_data_unpack (data, &self, &plat_vfs);
 
 	if (nm_utils_error_is_cancelled (error, TRUE))
 		return;
@@ -6443,16 +6493,6 @@ sriov_params_cb (GError *error, gpointer data)
 		return;
 	}
 
-	if (!nm_platform_link_set_sriov_vfs (nm_device_get_platform (self),
-	                                     priv->ifindex,
-	                                     (const NMPlatformVF *const *) plat_vfs)) {
-		_LOGE (LOGD_DEVICE, "failed to apply SR-IOV VFs");
-		nm_device_state_changed (self,
-		                         NM_DEVICE_STATE_FAILED,
-		                         NM_DEVICE_STATE_REASON_SRIOV_CONFIGURATION_FAILED);
-		return;
-	}
-
 	priv->stage1_sriov_state = NM_DEVICE_STAGE_STATE_COMPLETED;
 
 	nm_device_activate_schedule_stage1_device_prepare (self);
@@ -6534,9 +6574,12 @@ activate_stage1_device_prepare (NMDevice *self)
 			sriov_op_queue (self,
 			                nm_setting_sriov_get_total_vfs (s_sriov),
 			                autoprobe,
+			                nm_setting_sriov_get_eswitch_mode (s_sriov),
+			                nm_setting_sriov_get_eswitch_inline_mode (s_sriov),
+			                nm_setting_sriov_get_eswitch_encap_mode (s_sriov),
+			                g_steal_pointer (&plat_vfs),
 			                sriov_params_cb,
-			                nm_utils_user_data_pack (self,
-			                                         g_steal_pointer (&plat_vfs)));
+			                self);
 			priv->stage1_sriov_state = NM_DEVICE_STAGE_STATE_PENDING;
 			return;
 		}
@@ -12618,10 +12661,14 @@ nm_device_set_ip_config (NMDevice *self,
 		               ? NM_IP4_CONFIG (new_config)
 		               : priv->ip_config_4);
 
+		if (!priv->route_sync_state_x[IS_IPv4])
+			priv->route_sync_state_x[IS_IPv4] = nm_platform_ip_route_sync_state_new ();
+
 		if (IS_IPv4) {
 			success = nm_ip4_config_commit (NM_IP4_CONFIG (new_config),
 			                                nm_device_get_platform (self),
-			                                _get_route_table_sync_mode_stateful (self, addr_family));
+			                                _get_route_table_sync_mode_stateful (self, addr_family),
+			                                priv->route_sync_state_x[IS_IPv4]);
 			nm_platform_ip4_dev_route_blacklist_set (nm_device_get_platform (self),
 			                                         nm_ip_config_get_ifindex (new_config),
 			                                         ip4_dev_route_blacklist);
@@ -12631,6 +12678,7 @@ nm_device_set_ip_config (NMDevice *self,
 			success = nm_ip6_config_commit (NM_IP6_CONFIG (new_config),
 			                                nm_device_get_platform (self),
 			                                _get_route_table_sync_mode_stateful (self, addr_family),
+			                                priv->route_sync_state_x[IS_IPv4],
 			                                &temporary_not_available);
 
 			if (!_rt6_temporary_not_available_set (self, temporary_not_available))
@@ -14910,6 +14958,8 @@ _cleanup_generic_post (NMDevice *self, CleanupType cleanup_type)
 	g_clear_object (&priv->ext_ip6_config_captured);
 	applied_config_clear (&priv->dev2_ip_config_6);
 	g_clear_object (&priv->ip_config_6);
+	nm_clear_pointer (&priv->route_sync_state_x[0], nm_platform_ip_route_sync_state_free);
+	nm_clear_pointer (&priv->route_sync_state_x[1], nm_platform_ip_route_sync_state_free);
 	g_clear_object (&priv->dad6_ip6_config);
 	priv->ipv6ll_has = FALSE;
 	memset (&priv->ipv6ll_addr, 0, sizeof (priv->ipv6ll_addr));
@@ -15594,6 +15644,10 @@ _set_state_full (NMDevice *self,
 				sriov_op_queue (self,
 				                0,
 				                NM_TERNARY_TRUE,
+				                NM_SRIOV_ESWITCH_MODE_PRESERVE,
+				                NM_SRIOV_ESWITCH_INLINE_MODE_PRESERVE,
+				                NM_SRIOV_ESWITCH_ENCAP_MODE_PRESERVE,
+				                NULL,
 				                sriov_deactivate_cb,
 				                nm_utils_user_data_pack (self, (gpointer) reason));
 			}
@@ -16957,6 +17011,9 @@ finalize (GObject *object)
 	g_hash_table_unref (priv->ip6_saved_properties);
 	g_hash_table_unref (priv->available_connections);
 
+	nm_platform_ip_route_sync_state_free (priv->route_sync_state_x[0]);
+	nm_platform_ip_route_sync_state_free (priv->route_sync_state_x[1]);
+
 	nm_dbus_track_obj_path_deinit (&priv->parent_device);
 	nm_dbus_track_obj_path_deinit (&priv->act_request);
 
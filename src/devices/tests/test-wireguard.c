@@ -0,0 +1,276 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Copyright (C) 2020 Red Hat, Inc.
+ */
+
+#include "nm-default.h"
+
+#include "devices/nm-device-wireguard.h"
+
+#include "nm-test-utils-core.h"
+
+/* RESOLVE_MAX_PARALLEL in nm-device-wireguard.c */
+#define RESOLVE_MAX_PARALLEL 16
+
+/*****************************************************************************/
+
+/* a GResolver that never resolves anything by itself. The tests
+ * complete the pending lookups by hand. */
+
+typedef struct {
+	GResolver parent;
+	GPtrArray *pending;
+	guint n_lookups;
+} TestResolver;
+
+typedef struct {
+	GResolverClass parent;
+} TestResolverClass;
+
+static GType test_resolver_get_type (void);
+
+G_DEFINE_TYPE (TestResolver, test_resolver, G_TYPE_RESOLVER)
+
+static void
+test_resolver_lookup_by_name_async (GResolver *resolver,
+                                    const char *hostname,
+                                    GCancellable *cancellable,
+                                    GAsyncReadyCallback callback,
+                                    gpointer user_data)
+{
+	TestResolver *self = (TestResolver *) resolver;
+	GTask *task;
+
+	task = g_task_new (resolver, cancellable, callback, user_data);
+	g_task_set_task_data (task, g_strdup (hostname), g_free);
+	g_ptr_array_add (self->pending, task);
+	self->n_lookups++;
+}
+
+static GList *
+test_resolver_lookup_by_name_finish (GResolver *resolver,
+                                     GAsyncResult *result,
+                                     GError **error)
+{
+	return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+static void
+test_resolver_init (TestResolver *self)
+{
+	self->pending = g_ptr_array_new_with_free_func (g_object_unref);
+}
+
+static void
+test_resolver_finalize (GObject *object)
+{
+	TestResolver *self = (TestResolver *) object;
+
+	g_ptr_array_unref (self->pending);
+
+	G_OBJECT_CLASS (test_resolver_parent_class)->finalize (object);
+}
+
+static void
+test_resolver_class_init (TestResolverClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	GResolverClass *resolver_class = G_RESOLVER_CLASS (klass);
+
+	object_class->finalize = test_resolver_finalize;
+	resolver_class->lookup_by_name_async = test_resolver_lookup_by_name_async;
+	resolver_class->lookup_by_name_finish = test_resolver_lookup_by_name_finish;
+}
+
+static TestResolver *
+_resolver_get (void)
+{
+	static TestResolver *resolver = NULL;
+
+	if (!resolver) {
+		resolver = g_object_new (test_resolver_get_type (), NULL);
+		g_resolver_set_default (G_RESOLVER (resolver));
+	}
+	return resolver;
+}
+
+static void
+_resolver_complete (TestResolver *self,
+                    const char *host,
+                    const char *address)
+{
+	GTask *task = NULL;
+	guint i;
+
+	for (i = 0; i < self->pending->len; i++) {
+		if (nm_streq (g_task_get_task_data (self->pending->pdata[i]), host)) {
+			task = g_object_ref (self->pending->pdata[i]);
+			g_ptr_array_remove_index (self->pending, i);
+			break;
+		}
+	}
+	g_assert (task);
+
+	g_task_return_pointer (task,
+	                       g_list_append (NULL, g_inet_address_new_from_string (address)),
+	                       (GDestroyNotify) g_resolver_free_addresses);
+	g_object_unref (task);
+}
+
+/*****************************************************************************/
+
+typedef struct {
+	guint n_called;
+	GList *addresses;
+	GError *error;
+} ResolveResult;
+
+static void
+_resolve_cb (GObject *source,
+             GAsyncResult *result,
+             gpointer user_data)
+{
+	ResolveResult *r = user_data;
+
+	g_assert (!r->addresses);
+	g_assert (!r->error);
+
+	r->n_called++;
+	r->addresses = _nmtst_device_wireguard_resolve_lookup_finish (result, &r->error);
+}
+
+static void
+_resolve_result_assert (ResolveResult *r,
+                        const char *address)
+{
+	gs_free char *str = NULL;
+
+	nmtst_main_context_iterate_until (NULL, 1000, r->n_called > 0);
+	g_assert_cmpint (r->n_called, ==, 1);
+	g_assert_no_error (r->error);
+	g_assert (r->addresses);
+	g_assert (!r->addresses->next);
+
+	str = g_inet_address_to_string (r->addresses->data);
+	g_assert_cmpstr (str, ==, address);
+
+	g_resolver_free_addresses (g_steal_pointer (&r->addresses));
+	r->n_called = 0;
+}
+
+/*****************************************************************************/
+
+static void
+test_resolve_cache (void)
+{
+	TestResolver *resolver = _resolver_get ();
+	ResolveResult r1 = { };
+	ResolveResult r2 = { };
+	guint n_lookups = resolver->n_lookups;
+
+	/* lookups for the same host get merged. */
+	_nmtst_device_wireguard_resolve_lookup_async ("cache.example", NULL, _resolve_cb, &r1);
+	_nmtst_device_wireguard_resolve_lookup_async ("cache.example", NULL, _resolve_cb, &r2);
+	g_assert_cmpint (resolver->n_lookups, ==, n_lookups + 1);
+	g_assert_cmpint (_nmtst_device_wireguard_resolve_get_n_waiters ("cache.example"), ==, 2);
+
+	_resolver_complete (resolver, "cache.example", "192.0.2.1");
+	_resolve_result_assert (&r1, "192.0.2.1");
+	_resolve_result_assert (&r2, "192.0.2.1");
+	g_assert_cmpint (_nmtst_device_wireguard_resolve_get_n_waiters ("cache.example"), ==, 0);
+
+	/* the result is cached. */
+	_nmtst_device_wireguard_resolve_lookup_async ("cache.example", NULL, _resolve_cb, &r1);
+	_resolve_result_assert (&r1, "192.0.2.1");
+	g_assert_cmpint (resolver->n_lookups, ==, n_lookups + 1);
+
+	/* after the TTL, the host gets resolved again. */
+	_nmtst_device_wireguard_resolve_cache_expire ();
+	_nmtst_device_wireguard_resolve_lookup_async ("cache.example", NULL, _resolve_cb, &r1);
+	g_assert_cmpint (resolver->n_lookups, ==, n_lookups + 2);
+	g_assert_cmpint (r1.n_called, ==, 0);
+
+	_resolver_complete (resolver, "cache.example", "192.0.2.2");
+	_resolve_result_assert (&r1, "192.0.2.2");
+	g_assert_cmpint (_nmtst_device_wireguard_resolve_get_n_running (), ==, 0);
+}
+
+static void
+test_resolve_queue (void)
+{
+	TestResolver *resolver = _resolver_get ();
+	ResolveResult results[RESOLVE_MAX_PARALLEL + 2] = { };
+	char hosts[G_N_ELEMENTS (results)][64];
+	guint n_lookups = resolver->n_lookups;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (results); i++) {
+		nm_sprintf_buf (hosts[i], "queue-%u.example", i);
+		_nmtst_device_wireguard_resolve_lookup_async (hosts[i], NULL, _resolve_cb, &results[i]);
+	}
+
+	/* only RESOLVE_MAX_PARALLEL lookups run, the others wait. */
+	g_assert_cmpint (_nmtst_device_wireguard_resolve_get_n_running (), ==, RESOLVE_MAX_PARALLEL);
+	g_assert_cmpint (resolver->n_lookups, ==, n_lookups + RESOLVE_MAX_PARALLEL);
+
+	/* a completed lookup frees the slot for the next queued one. */
+	_resolver_complete (resolver, hosts[0], "192.0.2.10");
+	_resolve_result_assert (&results[0], "192.0.2.10");
+	g_assert_cmpint (_nmtst_device_wireguard_resolve_get_n_running (), ==, RESOLVE_MAX_PARALLEL);
+	g_assert_cmpint (resolver->n_lookups, ==, n_lookups + RESOLVE_MAX_PARALLEL + 1);
+
+	for (i = 1; i < G_N_ELEMENTS (results); i++) {
+		_resolver_complete (resolver, hosts[i], "192.0.2.11");
+		_resolve_result_assert (&results[i], "192.0.2.11");
+	}
+
+	g_assert_cmpint (_nmtst_device_wireguard_resolve_get_n_running (), ==, 0);
+	g_assert_cmpint (resolver->n_lookups, ==, n_lookups + G_N_ELEMENTS (results));
+	g_assert_cmpint (resolver->pending->len, ==, 0);
+}
+
+static void
+test_resolve_cancel (void)
+{
+	TestResolver *resolver = _resolver_get ();
+	gs_unref_object GCancellable *cancellable = g_cancellable_new ();
+	ResolveResult r1 = { };
+	ResolveResult r2 = { };
+
+	_nmtst_device_wireguard_resolve_lookup_async ("cancel.example", cancellable, _resolve_cb, &r1);
+	_nmtst_device_wireguard_resolve_lookup_async ("cancel.example", NULL, _resolve_cb, &r2);
+	g_assert_cmpint (_nmtst_device_wireguard_resolve_get_n_waiters ("cancel.example"), ==, 2);
+
+	/* the cancelled waiter is dropped right away, not only when the
+	 * shared lookup completes. */
+	g_cancellable_cancel (cancellable);
+	g_assert_cmpint (_nmtst_device_wireguard_resolve_get_n_waiters ("cancel.example"), ==, 1);
+
+	nmtst_main_context_iterate_until (NULL, 1000, r1.n_called > 0);
+	g_assert_cmpint (r1.n_called, ==, 1);
+	g_assert (!r1.addresses);
+	g_assert_error (r1.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_clear_error (&r1.error);
+
+	/* the other waiter still gets the result. */
+	_resolver_complete (resolver, "cancel.example", "192.0.2.20");
+	_resolve_result_assert (&r2, "192.0.2.20");
+	g_assert_cmpint (r1.n_called, ==, 1);
+	g_assert_cmpint (_nmtst_device_wireguard_resolve_get_n_running (), ==, 0);
+}
+
+/*****************************************************************************/
+
+NMTST_DEFINE ();
+
+int
+main (int argc, char **argv)
+{
+	nmtst_init_with_logging (&argc, &argv, NULL, "ALL");
+
+	g_test_add_func ("/wireguard/resolve/cache", test_resolve_cache);
+	g_test_add_func ("/wireguard/resolve/queue", test_resolve_queue);
+	g_test_add_func ("/wireguard/resolve/cancel", test_resolve_cancel);
+
+	return g_test_run ();
+}
@@ -15,12 +15,14 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/resource.h>
+#include <linux/rtnetlink.h>
 
 #include "main-utils.h"
 #include "nm-dbus-interface.h"
 #include "NetworkManagerUtils.h"
 #include "nm-manager.h"
 #include "platform/nm-linux-platform.h"
+#include "platform/nm-platform-utils.h"
 #include "nm-dbus-manager.h"
 #include "devices/nm-device.h"
 #include "dhcp/nm-dhcp-manager.h"
@@ -110,6 +112,85 @@ _init_nm_debug (NMConfig *config)
 		_set_g_fatal_warnings ();
 }
 
+static void
+_init_platform_route_ignore (NMConfig *config)
+{
+	gs_free char *protocols_str = NULL;
+	gs_free char *tables_str = NULL;
+	gs_free const char **protocols_strv = NULL;
+	gs_free const char **tables_strv = NULL;
+	gs_unref_array GArray *protocols = NULL;
+	gs_unref_array GArray *tables = NULL;
+	gsize i;
+
+	protocols_str = nm_config_data_get_value (nm_config_get_data_orig (config),
+	                                          NM_CONFIG_KEYFILE_GROUP_MAIN,
+	                                          NM_CONFIG_KEYFILE_KEY_MAIN_IGNORE_ROUTE_PROTOCOLS,
+	                                          NM_CONFIG_GET_VALUE_STRIP | NM_CONFIG_GET_VALUE_NO_EMPTY);
+	tables_str = nm_config_data_get_value (nm_config_get_data_orig (config),
+	                                       NM_CONFIG_KEYFILE_GROUP_MAIN,
+	                                       NM_CONFIG_KEYFILE_KEY_MAIN_IGNORE_ROUTE_TABLES,
+	                                       NM_CONFIG_GET_VALUE_STRIP | NM_CONFIG_GET_VALUE_NO_EMPTY);
+	if (!protocols_str && !tables_str)
+		return;
+
+	protocols = g_array_new (FALSE, FALSE, sizeof (guint8));
+	tables = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+	protocols_strv = nm_utils_strsplit_set (protocols_str, " \t,");
+	for (i = 0; protocols_strv && protocols_strv[i]; i++) {
+		int rtprot;
+		guint8 v;
+
+		rtprot = nmp_utils_rtprot_from_string (protocols_strv[i]);
+		if (rtprot < 0) {
+			nm_log_warn (LOGD_CORE, "config: invalid route protocol '%s' in %s",
+			             protocols_strv[i], NM_CONFIG_KEYFILE_KEY_MAIN_IGNORE_ROUTE_PROTOCOLS);
+			continue;
+		}
+		if (NM_IN_SET (rtprot, RTPROT_UNSPEC,
+		                       RTPROT_REDIRECT,
+		                       RTPROT_KERNEL,
+		                       RTPROT_STATIC,
+		                       RTPROT_RA,
+		                       RTPROT_DHCP)) {
+			/* NetworkManager itself configures routes with these protocols. */
+			nm_log_warn (LOGD_CORE, "config: cannot ignore route protocol '%s' in %s",
+			             protocols_strv[i], NM_CONFIG_KEYFILE_KEY_MAIN_IGNORE_ROUTE_PROTOCOLS);
+			continue;
+		}
+		v = rtprot;
+		g_array_append_val (protocols, v);
+	}
+
+	tables_strv = nm_utils_strsplit_set (tables_str, " \t,");
+	for (i = 0; tables_strv && tables_strv[i]; i++) {
+		gint64 table;
+		guint32 v;
+
+		table = _nm_utils_ascii_str_to_int64 (tables_strv[i], 0, 1, G_MAXUINT32, -1);
+		if (table < 0) {
+			nm_log_warn (LOGD_CORE, "config: invalid route table '%s' in %s",
+			             tables_strv[i], NM_CONFIG_KEYFILE_KEY_MAIN_IGNORE_ROUTE_TABLES);
+			continue;
+		}
+		if (NM_IN_SET (table, RT_TABLE_MAIN, RT_TABLE_LOCAL)) {
+			nm_log_warn (LOGD_CORE, "config: cannot ignore route table '%s' in %s",
+			             tables_strv[i], NM_CONFIG_KEYFILE_KEY_MAIN_IGNORE_ROUTE_TABLES);
+			continue;
+		}
+		v = table;
+		g_array_append_val (tables, v);
+	}
+
+	/* set it as default, so that the platform instances of other network
+	 * namespaces ignore the same routes. */
+	nm_platform_route_ignore_set_default ((const guint8 *) protocols->data,
+	                                      protocols->len,
+	                                      (const guint32 *) tables->data,
+	                                      tables->len);
+}
+
 void
 nm_main_config_reload (int signal)
 {
@@ -406,6 +487,7 @@ main (int argc, char *argv[])
 	if (!_dbus_manager_init (config))
 		goto done_no_manager;
 
+	_init_platform_route_ignore (config);
 	nm_linux_platform_setup ();
 
 	NM_UTILS_KEEP_ALIVE (config, nm_netns_get (), "NMConfig-depends-on-NMNetns");
@@ -768,6 +768,8 @@ static const ConfigGroup config_groups[] = {
 			NM_CONFIG_KEYFILE_KEY_MAIN_DNS,
 			NM_CONFIG_KEYFILE_KEY_MAIN_HOSTNAME_MODE,
 			NM_CONFIG_KEYFILE_KEY_MAIN_IGNORE_CARRIER,
+			NM_CONFIG_KEYFILE_KEY_MAIN_IGNORE_ROUTE_PROTOCOLS,
+			NM_CONFIG_KEYFILE_KEY_MAIN_IGNORE_ROUTE_TABLES,
 			NM_CONFIG_KEYFILE_KEY_MAIN_MONITOR_CONNECTION_FILES,
 			NM_CONFIG_KEYFILE_KEY_MAIN_NO_AUTO_DEFAULT,
 			NM_CONFIG_KEYFILE_KEY_MAIN_PLUGINS,
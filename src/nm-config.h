@@ -51,6 +51,8 @@
 #define NM_CONFIG_KEYFILE_KEY_MAIN_DNS                      "dns"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_HOSTNAME_MODE            "hostname-mode"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_IGNORE_CARRIER           "ignore-carrier"
+#define NM_CONFIG_KEYFILE_KEY_MAIN_IGNORE_ROUTE_PROTOCOLS   "ignore-route-protocols"
+#define NM_CONFIG_KEYFILE_KEY_MAIN_IGNORE_ROUTE_TABLES      "ignore-route-tables"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_MONITOR_CONNECTION_FILES "monitor-connection-files"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_NO_AUTO_DEFAULT          "no-auto-default"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_PLUGINS                  "plugins"
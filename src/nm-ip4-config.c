@@ -794,7 +794,8 @@ again:
 gboolean
 nm_ip4_config_commit (const NMIP4Config *self,
                       NMPlatform *platform,
-                      NMIPRouteTableSyncMode route_table_sync)
+                      NMIPRouteTableSyncMode route_table_sync,
+                      NMPlatformIPRouteSyncState *route_sync_state)
 {
 	gs_unref_ptrarray GPtrArray *addresses = NULL;
 	gs_unref_ptrarray GPtrArray *routes = NULL;
@@ -813,19 +814,22 @@ nm_ip4_config_commit (const NMIP4Config *self,
 	routes = nm_dedup_multi_objs_to_ptr_array_head (nm_ip4_config_lookup_routes (self),
 	                                                NULL, NULL);
 
-	routes_prune = nm_platform_ip_route_get_prune_list (platform,
-	                                                    AF_INET,
-	                                                    ifindex,
-	                                                    route_table_sync);
+	routes_prune = nm_platform_ip_route_sync_state_get_prune_list (platform,
+	                                                               route_sync_state,
+	                                                               AF_INET,
+	                                                               ifindex,
+	                                                               route_table_sync);
 
 	nm_platform_ip4_address_sync (platform, ifindex, addresses);
 
-	if (!nm_platform_ip_route_sync (platform,
-	                                AF_INET,
-	                                ifindex,
-	                                routes,
-	                                routes_prune,
-	                                NULL))
+	if (!nm_platform_ip_route_sync_with_state (platform,
+	                                           AF_INET,
+	                                           ifindex,
+	                                           route_sync_state,
+	                                           routes,
+	                                           routes_prune,
+	                                           route_table_sync,
+	                                           NULL))
 		success = FALSE;
 
 	return success;
@@ -839,7 +843,9 @@ _nm_ip_config_merge_route_attributes (int addr_family,
 {
 	GVariant *variant;
 	guint32 table;
+	guint32 weight;
 	NMIPAddr addr;
+	NMPlatformIPRouteMetrics metrics = { 0 };
 	NMPlatformIP4Route *r4 = (NMPlatformIP4Route *) r;
 	NMPlatformIP6Route *r6 = (NMPlatformIP6Route *) r;
 	gboolean onlink;
@@ -869,16 +875,24 @@ _nm_ip_config_merge_route_attributes (int addr_family,
 
 	r->r_rtm_flags = ((onlink) ? (unsigned) RTNH_F_ONLINK : 0u);
 
-	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_WINDOW,         r->window,         UINT32,   uint32, 0);
-	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_CWND,           r->cwnd,           UINT32,   uint32, 0);
-	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_INITCWND,       r->initcwnd,       UINT32,   uint32, 0);
-	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_INITRWND,       r->initrwnd,       UINT32,   uint32, 0);
-	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_MTU,            r->mtu,            UINT32,   uint32, 0);
-	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_LOCK_WINDOW,    r->lock_window,    BOOLEAN,  boolean, FALSE);
-	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_LOCK_CWND,      r->lock_cwnd,      BOOLEAN,  boolean, FALSE);
-	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_LOCK_INITCWND,  r->lock_initcwnd,  BOOLEAN,  boolean, FALSE);
-	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_LOCK_INITRWND,  r->lock_initrwnd,  BOOLEAN,  boolean, FALSE);
-	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_LOCK_MTU,       r->lock_mtu,       BOOLEAN,  boolean, FALSE);
+	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_WINDOW,         metrics.window,        UINT32,   uint32, 0);
+	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_CWND,           metrics.cwnd,          UINT32,   uint32, 0);
+	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_INITCWND,       metrics.initcwnd,      UINT32,   uint32, 0);
+	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_INITRWND,       metrics.initrwnd,      UINT32,   uint32, 0);
+	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_MTU,            metrics.mtu,           UINT32,   uint32, 0);
+	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_LOCK_WINDOW,    metrics.lock_window,   BOOLEAN,  boolean, FALSE);
+	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_LOCK_CWND,      metrics.lock_cwnd,     BOOLEAN,  boolean, FALSE);
+	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_LOCK_INITCWND,  metrics.lock_initcwnd, BOOLEAN,  boolean, FALSE);
+	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_LOCK_INITRWND,  metrics.lock_initrwnd, BOOLEAN,  boolean, FALSE);
+	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_LOCK_MTU,       metrics.lock_mtu,      BOOLEAN,  boolean, FALSE);
+	r->metrics = nm_platform_ip_route_metrics_intern (&metrics);
+
+	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_NHID,           r->nhid,               UINT32,   uint32, 0);
+
+	/* routes with a weight and the same destination are merged into an
+	 * ECMP route by nm_platform_ip_route_sync(). */
+	GET_ATTR (NM_IP_ROUTE_ATTRIBUTE_WEIGHT,         weight,            UINT32,   uint32, 0);
+	r->weight = MIN (weight, 256u);
 
 	if (   (variant = nm_ip_route_get_attribute (s_route, NM_IP_ROUTE_ATTRIBUTE_SRC))
 	    && g_variant_is_of_type (variant, G_VARIANT_TYPE_STRING)) {
@@ -554,6 +554,7 @@ gboolean
 nm_ip6_config_commit (const NMIP6Config *self,
                       NMPlatform *platform,
                       NMIPRouteTableSyncMode route_table_sync,
+                      NMPlatformIPRouteSyncState *route_sync_state,
                       GPtrArray **out_temporary_not_available)
 {
 	gs_unref_ptrarray GPtrArray *addresses = NULL;
@@ -573,19 +574,22 @@ nm_ip6_config_commit (const NMIP6Config *self,
 	routes = nm_dedup_multi_objs_to_ptr_array_head (nm_ip6_config_lookup_routes (self),
 	                                                NULL, NULL);
 
-	routes_prune = nm_platform_ip_route_get_prune_list (platform,
-	                                                    AF_INET6,
-	                                                    ifindex,
-	                                                    route_table_sync);
+	routes_prune = nm_platform_ip_route_sync_state_get_prune_list (platform,
+	                                                               route_sync_state,
+	                                                               AF_INET6,
+	                                                               ifindex,
+	                                                               route_table_sync);
 
 	nm_platform_ip6_address_sync (platform, ifindex, addresses, FALSE);
 
-	if (!nm_platform_ip_route_sync (platform,
-	                                AF_INET6,
-	                                ifindex,
-	                                routes,
-	                                routes_prune,
-	                                out_temporary_not_available))
+	if (!nm_platform_ip_route_sync_with_state (platform,
+	                                           AF_INET6,
+	                                           ifindex,
+	                                           route_sync_state,
+	                                           routes,
+	                                           routes_prune,
+	                                           route_table_sync,
+	                                           out_temporary_not_available))
 		success = FALSE;
 
 	return success;
@@ -99,6 +99,7 @@ void nm_ip6_config_add_dependent_routes (NMIP6Config *self,
 gboolean nm_ip6_config_commit (const NMIP6Config *self,
                                NMPlatform *platform,
                                NMIPRouteTableSyncMode route_table_sync,
+                               NMPlatformIPRouteSyncState *route_sync_state,
                                GPtrArray **out_temporary_not_available);
 void nm_ip6_config_merge_setting (NMIP6Config *self,
                                   NMSettingIPConfig *setting,
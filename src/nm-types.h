@@ -178,6 +178,8 @@ typedef enum {
 	NMP_OBJECT_TYPE_IP6_ADDRESS,
 	NMP_OBJECT_TYPE_IP4_ROUTE,
 	NMP_OBJECT_TYPE_IP6_ROUTE,
+	NMP_OBJECT_TYPE_IP4_NEXTHOP,
+	NMP_OBJECT_TYPE_IP6_NEXTHOP,
 	NMP_OBJECT_TYPE_ROUTING_RULE,
 
 	NMP_OBJECT_TYPE_QDISC,
@@ -12,7 +12,9 @@
 #include <endian.h>
 #include <fcntl.h>
 #include <libudev.h>
+#include <linux/ethtool.h>
 #include <linux/fib_rules.h>
+#include <linux/filter.h>
 #include <linux/ip.h>
 #include <linux/if_arp.h>
 #include <linux/if_bridge.h>
@@ -24,6 +26,8 @@
 #include <netinet/icmp6.h>
 #include <netinet/in.h>
 #include <poll.h>
+#include <sched.h>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -71,6 +75,35 @@ enum {
 
 /*****************************************************************************/
 
+/* re-implement <linux/nexthop.h> to build against kernel
+ * headers that lack this. */
+
+struct nhmsg {
+	unsigned char nh_family;
+	unsigned char nh_scope;
+	unsigned char nh_protocol;
+	unsigned char resvd;
+	unsigned int  nh_flags;
+};
+
+enum {
+	NHA_UNSPEC,
+	NHA_ID,
+	NHA_GROUP,
+	NHA_GROUP_TYPE,
+	NHA_BLACKHOLE,
+	NHA_OIF,
+	NHA_GATEWAY,
+	NHA_ENCAP_TYPE,
+	NHA_ENCAP,
+	NHA_GROUPS,
+	NHA_MASTER,
+	__NHA_MAX,
+};
+#define NHA_MAX (__NHA_MAX - 1)
+
+/*****************************************************************************/
+
 /* Compat with older kernels. */
 
 #define TCA_FQ_CODEL_CE_THRESHOLD 7
@@ -139,8 +172,11 @@ enum {
 
 G_STATIC_ASSERT (RTA_MAX == (__RTA_MAX - 1));
 #define RTA_PREF                        20
+#define RTA_NH_ID                       30
 #undef  RTA_MAX
-#define RTA_MAX                        (MAX ((__RTA_MAX - 1), RTA_PREF))
+#define RTA_MAX                        (MAX ((__RTA_MAX - 1), RTA_NH_ID))
+
+#define RTNLGRP_NEXTHOP                 32
 
 #ifndef MACVLAN_FLAG_NOPROMISC
 #define MACVLAN_FLAG_NOPROMISC          1
@@ -231,6 +267,74 @@ G_STATIC_ASSERT (RTA_MAX == (__RTA_MAX - 1));
 
 /*****************************************************************************/
 
+/* Redefine the devlink enums, <linux/devlink.h> is not available on
+ * older kernels. */
+
+#define DEVLINK_GENL_NAME                      "devlink"
+#define DEVLINK_GENL_VERSION                   1
+
+#define DEVLINK_CMD_ESWITCH_GET                29
+#define DEVLINK_CMD_ESWITCH_SET                30
+
+#define DEVLINK_ATTR_BUS_NAME                  1
+#define DEVLINK_ATTR_DEV_NAME                  2
+#define DEVLINK_ATTR_ESWITCH_MODE              25
+#define DEVLINK_ATTR_ESWITCH_INLINE_MODE       26
+#define DEVLINK_ATTR_ESWITCH_ENCAP_MODE        62
+
+/*****************************************************************************/
+
+/* Redefine the ethtool netlink enums, <linux/ethtool_netlink.h> is not
+ * available on older kernels. */
+
+#define ETHTOOL_GENL_NAME                      "ethtool"
+#define ETHTOOL_GENL_VERSION                   1
+
+#define ETHTOOL_MSG_STRSET_GET                 1
+#define ETHTOOL_MSG_LINKMODES_GET              4
+#define ETHTOOL_MSG_LINKSTATE_GET              6
+#define ETHTOOL_MSG_FEATURES_GET               11
+#define ETHTOOL_MSG_FEATURES_SET               12
+
+#define ETHTOOL_FLAG_COMPACT_BITSETS           (1 << 0)
+#define ETHTOOL_FLAG_OMIT_REPLY                (1 << 1)
+
+#define ETHTOOL_A_HEADER_DEV_INDEX             1
+#define ETHTOOL_A_HEADER_FLAGS                 3
+
+#define ETHTOOL_A_BITSET_NOMASK                1
+#define ETHTOOL_A_BITSET_SIZE                  2
+#define ETHTOOL_A_BITSET_VALUE                 4
+#define ETHTOOL_A_BITSET_MASK                  5
+
+#define ETHTOOL_A_STRING_INDEX                 1
+#define ETHTOOL_A_STRING_VALUE                 2
+
+#define ETHTOOL_A_STRINGSET_ID                 1
+#define ETHTOOL_A_STRINGSET_COUNT              2
+#define ETHTOOL_A_STRINGSET_STRINGS            3
+
+#define ETHTOOL_A_STRINGSETS_STRINGSET         1
+
+#define ETHTOOL_A_STRSET_HEADER                1
+#define ETHTOOL_A_STRSET_STRINGSETS            2
+
+#define ETHTOOL_A_LINKMODES_HEADER             1
+#define ETHTOOL_A_LINKMODES_AUTONEG            2
+#define ETHTOOL_A_LINKMODES_SPEED              5
+#define ETHTOOL_A_LINKMODES_DUPLEX             6
+
+#define ETHTOOL_A_LINKSTATE_HEADER             1
+#define ETHTOOL_A_LINKSTATE_LINK               2
+
+#define ETHTOOL_A_FEATURES_HEADER              1
+#define ETHTOOL_A_FEATURES_HW                  2
+#define ETHTOOL_A_FEATURES_WANTED              3
+#define ETHTOOL_A_FEATURES_ACTIVE              4
+#define ETHTOOL_A_FEATURES_NOCHANGE            5
+
+/*****************************************************************************/
+
 /* Redefine VF enums and structures that are not available on older kernels. */
 
 #define IFLA_VF_UNSPEC                 0
@@ -277,6 +381,20 @@ struct _ifla_vf_vlan_info {
 #define BRIDGE_VLAN_INFO_RANGE_END      (1 << 4) /* VLAN is end of vlan range */
 #endif
 
+/* Appeared in in kernel 3.19 dated February 8, 2015 */
+#ifndef RTEXT_FILTER_VF
+#define RTEXT_FILTER_VF                 (1 << 0)
+#endif
+
+#ifndef RTEXT_FILTER_BRVLAN_COMPRESSED
+#define RTEXT_FILTER_BRVLAN_COMPRESSED  (1 << 2)
+#endif
+
+/* Appeared in in kernel 4.6 dated May 15, 2016 */
+#ifndef RTEXT_FILTER_SKIP_STATS
+#define RTEXT_FILTER_SKIP_STATS         (1 << 3)
+#endif
+
 /*****************************************************************************/
 
 typedef enum {
@@ -311,6 +429,8 @@ typedef enum {
 	REFRESH_ALL_TYPE_ROUTING_RULES_IP6 = 6,
 	REFRESH_ALL_TYPE_QDISCS            = 7,
 	REFRESH_ALL_TYPE_TFILTERS          = 8,
+	REFRESH_ALL_TYPE_IP4_NEXTHOPS      = 9,
+	REFRESH_ALL_TYPE_IP6_NEXTHOPS      = 10,
 
 	_REFRESH_ALL_TYPE_NUM,
 } RefreshAllType;
@@ -335,18 +455,23 @@ typedef enum {
 	DELAYED_ACTION_TYPE_REFRESH_ALL_ROUTING_RULES_IP6 = 1 << F (6, REFRESH_ALL_TYPE_ROUTING_RULES_IP6),
 	DELAYED_ACTION_TYPE_REFRESH_ALL_QDISCS            = 1 << F (7, REFRESH_ALL_TYPE_QDISCS),
 	DELAYED_ACTION_TYPE_REFRESH_ALL_TFILTERS          = 1 << F (8, REFRESH_ALL_TYPE_TFILTERS),
+	DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_NEXTHOPS      = 1 << F (9, REFRESH_ALL_TYPE_IP4_NEXTHOPS),
+	DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_NEXTHOPS      = 1 << F (10, REFRESH_ALL_TYPE_IP6_NEXTHOPS),
 #undef F
 
-	DELAYED_ACTION_TYPE_REFRESH_LINK                  = 1 <<  9,
-	DELAYED_ACTION_TYPE_MASTER_CONNECTED              = 1 << 10,
-	DELAYED_ACTION_TYPE_READ_NETLINK                  = 1 << 11,
-	DELAYED_ACTION_TYPE_WAIT_FOR_NL_RESPONSE          = 1 << 12,
+	DELAYED_ACTION_TYPE_REFRESH_LINK                  = 1 << 11,
+	DELAYED_ACTION_TYPE_MASTER_CONNECTED              = 1 << 12,
+	DELAYED_ACTION_TYPE_READ_NETLINK                  = 1 << 13,
+	DELAYED_ACTION_TYPE_WAIT_FOR_NL_RESPONSE          = 1 << 14,
 
 	__DELAYED_ACTION_TYPE_MAX,
 
 	DELAYED_ACTION_TYPE_REFRESH_ALL_ROUTING_RULES_ALL = DELAYED_ACTION_TYPE_REFRESH_ALL_ROUTING_RULES_IP4 |
 	                                                    DELAYED_ACTION_TYPE_REFRESH_ALL_ROUTING_RULES_IP6,
 
+	DELAYED_ACTION_TYPE_REFRESH_ALL_NEXTHOPS_ALL      = DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_NEXTHOPS |
+	                                                    DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_NEXTHOPS,
+
 	DELAYED_ACTION_TYPE_REFRESH_ALL                   = DELAYED_ACTION_TYPE_REFRESH_ALL_LINKS |
 	                                                    DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_ADDRESSES |
 	                                                    DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ADDRESSES |
@@ -354,7 +479,14 @@ typedef enum {
 	                                                    DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ROUTES |
 	                                                    DELAYED_ACTION_TYPE_REFRESH_ALL_ROUTING_RULES_ALL |
 	                                                    DELAYED_ACTION_TYPE_REFRESH_ALL_QDISCS |
-	                                                    DELAYED_ACTION_TYPE_REFRESH_ALL_TFILTERS,
+	                                                    DELAYED_ACTION_TYPE_REFRESH_ALL_TFILTERS |
+	                                                    DELAYED_ACTION_TYPE_REFRESH_ALL_NEXTHOPS_ALL,
+
+	/* the object types that the kernel can dump filtered by ifindex. */
+	DELAYED_ACTION_TYPE_REFRESH_ALL_BY_IFINDEX        = DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_ADDRESSES |
+	                                                    DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ADDRESSES |
+	                                                    DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_ROUTES |
+	                                                    DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ROUTES,
 
 	DELAYED_ACTION_TYPE_MAX                           = __DELAYED_ACTION_TYPE_MAX -1,
 } DelayedActionType;
@@ -396,8 +528,45 @@ typedef enum {
 	DELAYED_ACTION_RESPONSE_TYPE_VOID                       = 0,
 	DELAYED_ACTION_RESPONSE_TYPE_REFRESH_ALL_IN_PROGRESS    = 1,
 	DELAYED_ACTION_RESPONSE_TYPE_ROUTE_GET                  = 2,
+	DELAYED_ACTION_RESPONSE_TYPE_BRIDGE_VLANS_GET           = 3,
+	DELAYED_ACTION_RESPONSE_TYPE_SRIOV_VFS_GET              = 4,
 } DelayedActionWaitForNlResponseType;
 
+#define BRIDGE_VLAN_VID_MAX 4094
+
+/* the state of one VLAN on a bridge port, as tracked in priv->bridge_vlans. */
+#define BRIDGE_VLAN_STATE_PRESENT  ((guint8) 0x01)
+#define BRIDGE_VLAN_STATE_UNTAGGED ((guint8) 0x02)
+#define BRIDGE_VLAN_STATE_PVID     ((guint8) 0x04)
+
+typedef struct {
+	/* the VLAN states of the dumped links, by ifindex. See priv->bridge_vlans. */
+	GHashTable *bridge_vlans;
+} BridgeVlansGetData;
+
+/* the configuration of one VF, as reported in IFLA_VFINFO_LIST. */
+typedef struct {
+	guint8 mac[32];
+	guint32 min_tx_rate;
+	guint32 max_tx_rate;
+	guint32 vlan;
+	guint32 qos;
+	guint16 vlan_proto;
+	gint8 spoofchk;
+	gint8 trust;
+	bool valid:1;
+} SriovVfState;
+
+typedef struct {
+	int ifindex;
+	bool found:1;
+
+	/* indexed by the VF index, @n_vfs entries. VFs with a larger
+	 * index are ignored. */
+	guint n_vfs;
+	SriovVfState *vfs;
+} SriovVfsGetData;
+
 typedef struct {
 	guint32 seq_number;
 	WaitForNlResponseResult seq_result;
@@ -408,24 +577,152 @@ typedef struct {
 	union {
 		int *out_refresh_all_in_progress;
 		NMPObject **out_route_get;
+		BridgeVlansGetData *out_bridge_vlans_get;
+		SriovVfsGetData *out_sriov_vfs_get;
 		gpointer out_data;
 	} response;
 } DelayedActionWaitForNlResponseData;
 
+/* how long to wait for the kernel to acknowledge a request sent
+ * with _nl_send_nlmsg_async(). */
+#define ASYNC_REQUEST_TIMEOUT_MSEC 5000
+
+typedef struct {
+	CList lst;
+	NMPlatform *platform;
+	NMPlatformAsyncCallback callback;
+	gpointer callback_data;
+	GCancellable *cancellable;
+	gulong cancelled_id;
+	char *log_id;
+	char *errmsg;
+	gint64 timeout_abs_ns;
+	guint32 seq_number;
+	WaitForNlResponseResult seq_result;
+	bool is_delete:1;
+	bool is_pending:1;
+} AsyncRequest;
+
+/* how many datagrams of a dump we read from the request socket, before
+ * looking at the event socket again. */
+#define NL_REQUEST_DATAGRAMS_PER_ROUND 16
+
+typedef struct {
+	CList lst;
+	struct nl_msg *msg;
+
+	/* the type of the dump that the event waits for, or _REFRESH_ALL_TYPE_NUM
+	 * if the message only waits for the events before it. */
+	RefreshAllType refresh_all_type;
+} DeferredEvent;
+
+/* the number of events that the worker thread queues, before it waits
+ * for the main thread to catch up. */
+#define EVENT_WORKER_BATCH_MAX 50000
+
+/* after a read failure other than an overrun, the worker thread waits
+ * before polling the socket again. Doubled with every failure in a row. */
+#define EVENT_WORKER_ERROR_BACKOFF_MIN_MSEC 50
+#define EVENT_WORKER_ERROR_BACKOFF_MAX_MSEC 10000
+
+/* For a platform in its own network namespace, a worker thread reads the
+ * event socket. The thread enters the namespace once and stays there. It
+ * only copies the messages, parsing and updating the cache happens in
+ * batches on the main thread. Unless noted otherwise, the fields are
+ * protected by @lock. */
+typedef struct {
+	GMutex lock;
+	GCond cond;
+	GThread *thread;
+	GMainContext *context;
+
+	/* the event socket of the platform. */
+	struct nl_sock *sk;
+
+	/* immutable. */
+	NMPNetns *netns;
+	NMPlatform *platform;
+	int fd_wakeup;
+
+	/* the messages that wait for the main thread. */
+	GPtrArray *batch;
+	GSource *idle_source;
+
+	/* the last read failure, for the main thread to report. */
+	int error;
+	guint error_backoff_msec;
+
+	/* for tests: a failure that every read returns, and the number
+	 * of times that the thread polled the socket. */
+	int nmtst_error;
+	guint64 n_polls;
+
+	bool overrun:1;
+	bool stop:1;
+} EventWorker;
+
 /*****************************************************************************/
 
+/* After a netlink overrun, any object type could have lost events, so we
+ * immediately resync all of them. Only when overruns keep coming, we
+ * immediately resync just the links, the addresses and the object types (and
+ * for routes, the ifindexes) that had events within the last
+ * RESYNC_HOT_WINDOW_NSEC. The remaining types are then resynced later with an
+ * exponential backoff, so that a storm of overruns doesn't cause a full dump
+ * each time. */
+#define RESYNC_HOT_WINDOW_NSEC       (2 * NM_UTILS_NS_PER_SECOND)
+#define RESYNC_HOT_IFINDEXES_MAX     8
+#define RESYNC_BACKOFF_MIN_MSEC      250
+#define RESYNC_BACKOFF_MAX_MSEC      (30 * 1000)
+#define RESYNC_BACKOFF_RESET_NSEC    (60 * NM_UTILS_NS_PER_SECOND)
+
 typedef struct {
 	struct nl_sock *genl;
 
+	/* the resolved generic netlink family of WireGuard, or -1. */
+	int wireguard_family_id;
+
+	/* how often the configuration of a WireGuard device was fetched
+	 * from kernel, for unit tests. */
+	guint wireguard_n_refreshes;
+
+	/* the resolved generic netlink family of devlink, or -1. */
+	int devlink_family_id;
+
+	/* the resolved generic netlink family of ethtool, -1 if not yet
+	 * resolved, or 0 if kernel only supports the ioctl API. */
+	int ethtool_family_id;
+
+	/* the names of the netdev features (ETH_SS_FEATURES), the same for
+	 * all devices. */
+	char **ethtool_ss_features;
+	guint ethtool_ss_features_len;
+
+	/* the socket for requests, their ACKs and for dumps. It is not
+	 * subscribed to any multicast group. */
 	struct nl_sock *nlh;
 	guint32 nlh_seq_next;
 #if NM_MORE_LOGGING
 	guint32 nlh_seq_last_handled;
 #endif
 	guint32 nlh_seq_last_seen;
+	GIOChannel *request_channel;
+	guint request_id;
+
+	/* the socket that receives the multicast events. Having it separate
+	 * from @nlh means that a large dump neither delays the events nor
+	 * overruns their receive buffer. */
+	struct nl_sock *nlh_event;
 	GIOChannel *event_channel;
 	guint event_id;
 
+	/* events received while a dump of the same object type was in progress.
+	 * See event_deferred_add(). */
+	CList deferred_events_lst_head;
+
+	/* if set, the event socket is read by a worker thread. See EventWorker. */
+	EventWorker *event_worker;
+
 	guint32 pruning[_REFRESH_ALL_TYPE_NUM];
 
 	GHashTable *sysctl_get_prev_values;
@@ -448,6 +745,76 @@ typedef struct {
 
 		int is_handling;
 	} delayed_action;
+
+	struct {
+		/* the requests from _nl_send_nlmsg_async() that still wait for
+		 * their ACK, by sequence number. They are also linked in
+		 * @pending_lst, ordered by their timeout. */
+		GHashTable *pending;
+		CList pending_lst;
+
+		/* completed requests, whose callback is invoked from @idle_id. */
+		CList completed_lst;
+
+		guint idle_id;
+		guint timeout_id;
+	} async;
+
+	struct {
+		/* The object types for which we received events within the
+		 * current window. After an overrun these are resynchronized first.
+		 * The ifindex-filterable types are only dumped for @ifindexes,
+		 * unless they are also in @hot_types_full. */
+		DelayedActionType hot_types;
+		DelayedActionType hot_types_full;
+		int ifindexes[RESYNC_HOT_IFINDEXES_MAX];
+		guint n_ifindexes;
+		gint64 window_start_ns;
+
+		/* types that still require a full dump since the last overrun. They
+		 * are refreshed by @timeout_id. */
+		DelayedActionType pending_full;
+		guint timeout_id;
+		guint backoff_level;
+		gint64 last_overrun_ns;
+
+		/* whether NETLINK_GET_STRICT_CHK is enabled, so that the kernel honors dump filters. */
+		bool strict_check:1;
+	} resync;
+
+	struct {
+		/* the result of the last nexthop dump. Kernels before 5.3 reject
+		 * RTM_GETNEXTHOP, and then we stop requesting nexthops. */
+		WaitForNlResponseResult dump_result;
+		bool unsupported:1;
+	} nexthops;
+
+	struct {
+		/* number of times the netlink sockets woke us up. */
+		guint64 n_wakeups;
+		/* number of netlink messages received on @nlh and @nlh_event. */
+		guint64 n_messages;
+		/* number of events that had to wait for a dump to complete. */
+		guint64 n_deferred;
+	} nl_stats;
+
+	struct {
+		/* if set, the netlink messages handled by event_valid_msg() are
+		 * appended to this file. See nm_linux_platform_record_start(). */
+		FILE *f;
+		guint64 n_records;
+	} record;
+
+	/* the VLANs of bridges and bridge ports, by ifindex. The values are the
+	 * BRIDGE_VLAN_STATE_* flags, indexed by VID, or %NULL if kernel did not
+	 * report them. The platform cache doesn't track them. The table is filled
+	 * by one AF_BRIDGE dump, and then kept up to date by the AF_BRIDGE link
+	 * notifications. %NULL if the table must be dumped again. */
+	GHashTable *bridge_vlans;
+
+	/* the platform is only fed by nm_linux_platform_replay(). Its netlink
+	 * sockets are not connected and it never talks to kernel. */
+	bool replay:1;
 } NMLinuxPlatformPrivate;
 
 struct _NMLinuxPlatform {
@@ -461,6 +828,10 @@ struct _NMLinuxPlatformClass {
 
 G_DEFINE_TYPE (NMLinuxPlatform, nm_linux_platform, NM_TYPE_PLATFORM)
 
+NM_GOBJECT_PROPERTIES_DEFINE_BASE (
+	PROP_REPLAY,
+);
+
 #define NM_LINUX_PLATFORM_GET_PRIVATE(self) _NM_GET_PRIVATE (self, NMLinuxPlatform, NM_IS_LINUX_PLATFORM, NMPlatform)
 
 /*****************************************************************************/
@@ -530,6 +901,7 @@ static void cache_on_change (NMPlatform *platform,
 static void cache_prune_all (NMPlatform *platform);
 static gboolean event_handler_read_netlink (NMPlatform *platform, gboolean wait_for_acks);
 static struct nl_sock *_genl_sock (NMLinuxPlatform *platform);
+static void _bridge_vlans_invalidate (NMPlatform *platform);
 
 /*****************************************************************************/
 
@@ -2207,6 +2579,7 @@ static int
 _wireguard_get_family_id (NMPlatform *platform, int ifindex_try)
 {
 	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	struct nl_sock *genl;
 	int wireguard_family_id = -1;
 
 	if (ifindex_try > 0) {
@@ -2215,8 +2588,21 @@ _wireguard_get_family_id (NMPlatform *platform, int ifindex_try)
 		if (nm_platform_link_get_lnk_wireguard (platform, ifindex_try, &plink))
 			wireguard_family_id = NMP_OBJECT_UP_CAST (plink)->_link.wireguard_family_id;
 	}
-	if (wireguard_family_id < 0)
-		wireguard_family_id = genl_ctrl_resolve (priv->genl, "wireguard");
+	if (wireguard_family_id >= 0)
+		return wireguard_family_id;
+
+	/* the family id only changes when the module gets reloaded. Then the
+	 * next request fails and we resolve it again. */
+	if (priv->wireguard_family_id >= 0)
+		return priv->wireguard_family_id;
+
+	genl = _genl_sock (NM_LINUX_PLATFORM (platform));
+	if (!genl)
+		return -1;
+
+	wireguard_family_id = genl_ctrl_resolve (genl, "wireguard");
+	if (wireguard_family_id >= 0)
+		priv->wireguard_family_id = wireguard_family_id;
 	return wireguard_family_id;
 }
 
@@ -2225,7 +2611,7 @@ _wireguard_refresh_link (NMPlatform *platform,
                          int wireguard_family_id,
                          int ifindex)
 {
-	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	struct nl_sock *genl = _genl_sock (NM_LINUX_PLATFORM (platform));
 	nm_auto_nmpobj const NMPObject *obj_old = NULL;
 	nm_auto_nmpobj const NMPObject *obj_new = NULL;
 	nm_auto_nmpobj const NMPObject *lnk_new = NULL;
@@ -2236,6 +2622,8 @@ _wireguard_refresh_link (NMPlatform *platform,
 	nm_assert (wireguard_family_id >= 0);
 	nm_assert (ifindex > 0);
 
+	NM_LINUX_PLATFORM_GET_PRIVATE (platform)->wireguard_n_refreshes++;
+
 	nm_platform_process_events (platform);
 
 	plink = nm_platform_link_get_obj (platform, ifindex, TRUE);
@@ -2250,10 +2638,12 @@ _wireguard_refresh_link (NMPlatform *platform,
 		if (NMP_OBJECT_GET_TYPE (plink->_link.netlink.lnk) == NMP_OBJECT_TYPE_LNK_WIREGUARD)
 			lnk_new = nmp_object_ref (plink->_link.netlink.lnk);
 	} else {
-		lnk_new = _wireguard_read_info (platform,
-		                                priv->genl,
-		                                wireguard_family_id,
-		                                ifindex);
+		lnk_new = genl
+		          ? _wireguard_read_info (platform,
+		                                  genl,
+		                                  wireguard_family_id,
+		                                  ifindex)
+		          : NULL;
 		if (!lnk_new) {
 			if (NMP_OBJECT_GET_TYPE (plink->_link.netlink.lnk) == NMP_OBJECT_TYPE_LNK_WIREGUARD)
 				lnk_new = nmp_object_ref (plink->_link.netlink.lnk);
@@ -2331,9 +2721,9 @@ _wireguard_create_change_nlmsgs (NMPlatform *platform,
 	idx_peer_curr = IDX_NIL;
 	idx_allowed_ips_curr = IDX_NIL;
 
-	/* TODO: for the moment, we always reset all peers and allowed-ips (WGDEVICE_F_REPLACE_PEERS, WGPEER_F_REPLACE_ALLOWEDIPS).
-	 * The platform API should be extended to also support partial updates. In particular, configuring the same configuration
-	 * multiple times, should not clear and re-add all settings, but rather sync the existing settings with the desired configuration. */
+	/* This sends the peers as requested. link_wireguard_change() first reduces
+	 * the request to the differences to the current configuration, see
+	 * _wireguard_peers_diff(). */
 
 again:
 
@@ -2517,6 +2907,235 @@ nla_put_failure:
 #undef _nla_nest_end
 }
 
+typedef struct {
+	/* the peers to send and their flags. They are shallow copies of the
+	 * requested peers, except for allowed-ips that are partially added. */
+	GArray *peers;
+	GArray *peer_flags;
+
+	/* the allowed-ips arrays allocated for the peers in @peers. */
+	GPtrArray *allowed_ips;
+} WireGuardPeersDiff;
+
+static void
+_wireguard_peers_diff_clear (WireGuardPeersDiff *diff)
+{
+	if (diff->peers) {
+		nm_explicit_bzero (diff->peers->data, sizeof (NMPWireGuardPeer) * diff->peers->len);
+		g_array_unref (diff->peers);
+		diff->peers = NULL;
+	}
+	nm_clear_pointer (&diff->peer_flags, g_array_unref);
+	nm_clear_pointer (&diff->allowed_ips, g_ptr_array_unref);
+}
+
+static guint
+_wireguard_public_key_hash (gconstpointer ptr)
+{
+	NMHashState h;
+
+	nm_hash_init (&h, 1593624877u);
+	nm_hash_update (&h, ptr, NMP_WIREGUARD_PUBLIC_KEY_LEN);
+	return nm_hash_complete (&h);
+}
+
+static gboolean
+_wireguard_public_key_equal (gconstpointer a, gconstpointer b)
+{
+	return memcmp (a, b, NMP_WIREGUARD_PUBLIC_KEY_LEN) == 0;
+}
+
+static gboolean
+_wireguard_allowed_ips_contains (const NMPWireGuardPeer *peer,
+                                 const NMPWireGuardAllowedIP *aip)
+{
+	guint i;
+
+	for (i = 0; i < peer->allowed_ips_len; i++) {
+		const NMPWireGuardAllowedIP *a = &peer->allowed_ips[i];
+
+		if (   a->family != aip->family
+		    || a->mask != aip->mask)
+			continue;
+		if (  a->family == AF_INET
+		    ? nm_utils_ip4_address_same_prefix (a->addr.addr4, aip->addr.addr4, a->mask)
+		    : nm_utils_ip6_address_same_prefix (&a->addr.addr6, &aip->addr.addr6, a->mask))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* Compares the requested configuration with @lnk_old, the configuration that
+ * is currently in kernel. The result in @diff only contains what changed:
+ * new and removed peers, and for the other peers only the changed settings
+ * and the added allowed-ips. Also, the settings of the device that are
+ * unchanged are removed from @inout_change_flags.
+ *
+ * With 1000s of peers, this keeps the netlink messages small, when only
+ * a few peers change. */
+static void
+_wireguard_peers_diff (const NMPObject *lnk_old,
+                       const NMPlatformLnkWireGuard *lnk_wireguard,
+                       const NMPWireGuardPeer *peers,
+                       const NMPlatformWireGuardChangePeerFlags *peer_flags,
+                       guint peers_len,
+                       NMPlatformWireGuardChangeFlags *inout_change_flags,
+                       WireGuardPeersDiff *diff)
+{
+	const NMPObjectLnkWireGuard *old = &lnk_old->_lnk_wireguard;
+	NMPlatformWireGuardChangeFlags change_flags = *inout_change_flags;
+	const gboolean replace_peers = NM_FLAGS_HAS (change_flags, NM_PLATFORM_WIREGUARD_CHANGE_FLAG_REPLACE_PEERS);
+	gs_unref_hashtable GHashTable *old_idx = NULL;
+	gs_free gboolean *old_seen = NULL;
+	guint i;
+	guint j;
+
+	nm_assert (NMP_OBJECT_GET_TYPE (lnk_old) == NMP_OBJECT_TYPE_LNK_WIREGUARD);
+
+	if (   NM_FLAGS_HAS (change_flags, NM_PLATFORM_WIREGUARD_CHANGE_FLAG_HAS_PRIVATE_KEY)
+	    && memcmp (lnk_wireguard->private_key, old->_public.private_key, sizeof (lnk_wireguard->private_key)) == 0)
+		change_flags &= ~NM_PLATFORM_WIREGUARD_CHANGE_FLAG_HAS_PRIVATE_KEY;
+	if (   NM_FLAGS_HAS (change_flags, NM_PLATFORM_WIREGUARD_CHANGE_FLAG_HAS_LISTEN_PORT)
+	    && lnk_wireguard->listen_port == old->_public.listen_port)
+		change_flags &= ~NM_PLATFORM_WIREGUARD_CHANGE_FLAG_HAS_LISTEN_PORT;
+	if (   NM_FLAGS_HAS (change_flags, NM_PLATFORM_WIREGUARD_CHANGE_FLAG_HAS_FWMARK)
+	    && lnk_wireguard->fwmark == old->_public.fwmark)
+		change_flags &= ~NM_PLATFORM_WIREGUARD_CHANGE_FLAG_HAS_FWMARK;
+
+	old_idx = g_hash_table_new (_wireguard_public_key_hash, _wireguard_public_key_equal);
+	for (i = 0; i < old->peers_len; i++)
+		g_hash_table_insert (old_idx, (gpointer) old->peers[i].public_key, GUINT_TO_POINTER (i + 1));
+	old_seen = g_new0 (gboolean, old->peers_len + 1);
+
+	diff->peers = g_array_sized_new (FALSE, FALSE, sizeof (NMPWireGuardPeer), peers_len);
+	diff->peer_flags = g_array_sized_new (FALSE, FALSE, sizeof (NMPlatformWireGuardChangePeerFlags), peers_len);
+	diff->allowed_ips = g_ptr_array_new_with_free_func (g_free);
+
+	for (i = 0; i < peers_len; i++) {
+		NMPlatformWireGuardChangePeerFlags p_flags = peer_flags ? peer_flags[i] : NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_DEFAULT;
+		NMPWireGuardPeer p = peers[i];
+		const NMPWireGuardPeer *p_old = NULL;
+		guint idx;
+
+		idx = GPOINTER_TO_UINT (g_hash_table_lookup (old_idx, p.public_key));
+		if (idx > 0) {
+			p_old = &old->peers[idx - 1];
+			old_seen[idx - 1] = TRUE;
+		}
+
+		if (NM_FLAGS_HAS (p_flags, NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_REMOVE_ME)) {
+			if (!p_old)
+				goto next;
+			goto add;
+		}
+
+		if (!p_old) {
+			/* a new peer. Send it as requested. */
+			goto add;
+		}
+
+		if (replace_peers) {
+			/* replacing the peers would reset all settings that are not
+			 * specified. Make that explicit, so that we can compare them. */
+			if (!NM_FLAGS_HAS (p_flags, NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_PRESHARED_KEY)) {
+				memset (p.preshared_key, 0, sizeof (p.preshared_key));
+				p_flags |= NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_PRESHARED_KEY;
+			}
+			if (!NM_FLAGS_HAS (p_flags, NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_KEEPALIVE_INTERVAL)) {
+				p.persistent_keepalive_interval = 0;
+				p_flags |= NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_KEEPALIVE_INTERVAL;
+			}
+			if (!NM_FLAGS_HAS (p_flags, NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_ALLOWEDIPS)) {
+				p.allowed_ips = NULL;
+				p.allowed_ips_len = 0;
+				p_flags |= NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_ALLOWEDIPS;
+			}
+			p_flags |= NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_REPLACE_ALLOWEDIPS;
+		}
+
+		if (   NM_FLAGS_HAS (p_flags, NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_PRESHARED_KEY)
+		    && memcmp (p.preshared_key, p_old->preshared_key, sizeof (p.preshared_key)) == 0)
+			p_flags &= ~NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_PRESHARED_KEY;
+
+		if (   NM_FLAGS_HAS (p_flags, NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_KEEPALIVE_INTERVAL)
+		    && p.persistent_keepalive_interval == p_old->persistent_keepalive_interval)
+			p_flags &= ~NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_KEEPALIVE_INTERVAL;
+
+		if (   NM_FLAGS_HAS (p_flags, NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_ENDPOINT)
+		    && (   p.endpoint.sa.sa_family == AF_UNSPEC
+		        || nm_sock_addr_union_cmp (&p.endpoint, &p_old->endpoint) == 0))
+			p_flags &= ~NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_ENDPOINT;
+
+		if (NM_FLAGS_HAS (p_flags, NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_ALLOWEDIPS)) {
+			gboolean old_kept = TRUE;
+
+			if (NM_FLAGS_HAS (p_flags, NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_REPLACE_ALLOWEDIPS)) {
+				for (j = 0; j < p_old->allowed_ips_len; j++) {
+					if (!_wireguard_allowed_ips_contains (&p, &p_old->allowed_ips[j])) {
+						old_kept = FALSE;
+						break;
+					}
+				}
+			}
+
+			if (old_kept) {
+				/* no allowed-ip gets removed. Only send the new ones, there
+				 * is no need to replace the existing. */
+				NMPWireGuardAllowedIP *added = NULL;
+				guint n_added = 0;
+
+				for (j = 0; j < p.allowed_ips_len; j++) {
+					if (_wireguard_allowed_ips_contains (p_old, &p.allowed_ips[j]))
+						continue;
+					if (!added)
+						added = g_new (NMPWireGuardAllowedIP, p.allowed_ips_len - j);
+					added[n_added++] = p.allowed_ips[j];
+				}
+
+				p_flags &= ~NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_REPLACE_ALLOWEDIPS;
+				if (n_added == 0)
+					p_flags &= ~NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_ALLOWEDIPS;
+				else {
+					g_ptr_array_add (diff->allowed_ips, added);
+					p.allowed_ips = added;
+					p.allowed_ips_len = n_added;
+				}
+			}
+		} else if (   NM_FLAGS_HAS (p_flags, NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_REPLACE_ALLOWEDIPS)
+		           && p_old->allowed_ips_len == 0)
+			p_flags &= ~NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_REPLACE_ALLOWEDIPS;
+
+		if (p_flags == NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_NONE)
+			goto next;
+
+add:
+		g_array_append_val (diff->peers, p);
+		g_array_append_val (diff->peer_flags, p_flags);
+next:
+		/* @p is a copy of the requested peer, including the preshared-key. */
+		nm_explicit_bzero (&p, sizeof (p));
+	}
+
+	if (replace_peers) {
+		/* instead of replacing all peers, remove the ones that are no longer
+		 * requested. */
+		for (i = 0; i < old->peers_len; i++) {
+			NMPWireGuardPeer p = { };
+			NMPlatformWireGuardChangePeerFlags p_flags = NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_REMOVE_ME;
+
+			if (old_seen[i])
+				continue;
+
+			memcpy (p.public_key, old->peers[i].public_key, sizeof (p.public_key));
+			g_array_append_val (diff->peers, p);
+			g_array_append_val (diff->peer_flags, p_flags);
+		}
+		change_flags &= ~NM_PLATFORM_WIREGUARD_CHANGE_FLAG_REPLACE_PEERS;
+	}
+
+	*inout_change_flags = change_flags;
+}
+
 static int
 link_wireguard_change (NMPlatform *platform,
                        int ifindex,
@@ -2527,15 +3146,63 @@ link_wireguard_change (NMPlatform *platform,
                        NMPlatformWireGuardChangeFlags change_flags)
 {
 	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	nm_auto (_wireguard_peers_diff_clear) WireGuardPeersDiff diff = { };
 	gs_unref_ptrarray GPtrArray *msgs = NULL;
+	const NMPObject *plink = NULL;
+	const NMPObject *lnk_old = NULL;
+	struct nl_sock *genl;
 	int wireguard_family_id;
 	guint i;
 	int r;
 
+	genl = _genl_sock (NM_LINUX_PLATFORM (platform));
+	if (!genl)
+		return -NME_PL_NO_FIRMWARE;
+
 	wireguard_family_id = _wireguard_get_family_id (platform, ifindex);
 	if (wireguard_family_id < 0)
 		return -NME_PL_NO_FIRMWARE;
 
+	/* only send what differs from the cached configuration. Fetching the
+	 * peers from kernel means a dump of all peers, which is expensive with
+	 * many peers. So don't do that here, the cache gets refreshed after
+	 * the change below. Kernel doesn't notify about WireGuard changes, so
+	 * a change by somebody else since the last refresh is only noticed by
+	 * the following change. */
+	plink = nm_platform_link_get_obj (platform, ifindex, TRUE);
+
+	if (   plink
+	    && plink->link.type == NM_LINK_TYPE_WIREGUARD
+	    && NMP_OBJECT_GET_TYPE (plink->_link.netlink.lnk) == NMP_OBJECT_TYPE_LNK_WIREGUARD)
+		lnk_old = plink->_link.netlink.lnk;
+
+	if (lnk_old) {
+		_wireguard_peers_diff (lnk_old,
+		                       lnk_wireguard,
+		                       peers,
+		                       peer_flags,
+		                       peers_len,
+		                       &change_flags,
+		                       &diff);
+
+		if (   diff.peers->len == 0
+		    && !NM_FLAGS_ANY (change_flags,   NM_PLATFORM_WIREGUARD_CHANGE_FLAG_HAS_PRIVATE_KEY
+		                                    | NM_PLATFORM_WIREGUARD_CHANGE_FLAG_HAS_LISTEN_PORT
+		                                    | NM_PLATFORM_WIREGUARD_CHANGE_FLAG_HAS_FWMARK)) {
+			_LOGT ("wireguard: set-device, configuration of ifindex %d is unchanged", ifindex);
+			return 0;
+		}
+
+		_LOGT ("wireguard: set-device, update %u of %u requested peers (%u known)",
+		       diff.peers->len,
+		       peers_len,
+		       lnk_old->_lnk_wireguard.peers_len);
+
+		peers = (const NMPWireGuardPeer *) diff.peers->data;
+		peer_flags = (const NMPlatformWireGuardChangePeerFlags *) diff.peer_flags->data;
+		peers_len = diff.peers->len;
+	}
+
 	r = _wireguard_create_change_nlmsgs (platform,
 	                                     ifindex,
 	                                     wireguard_family_id,
@@ -2551,23 +3218,26 @@ link_wireguard_change (NMPlatform *platform,
 	}
 
 	for (i = 0; i < msgs->len; i++) {
-		r = nl_send_auto (priv->genl, msgs->pdata[i]);
+		r = nl_send_auto (genl, msgs->pdata[i]);
 		if (r < 0) {
 			_LOGW ("wireguard: set-device, send netlink message #%u failed: %s", i, nm_strerror (r));
+			priv->wireguard_family_id = -1;
 			return r;
 		}
 
 		do {
-			r = nl_recvmsgs (priv->genl, NULL);
+			r = nl_recvmsgs (genl, NULL);
 		} while (r == -EAGAIN);
 		if (r < 0) {
 			_LOGW ("wireguard: set-device, message #%u was rejected: %s", i, nm_strerror (r));
+			priv->wireguard_family_id = -1;
 			return r;
 		}
 
 		_LOGT ("wireguard: set-device, message #%u sent and confirmed", i);
 	}
 
+	/* the only refresh per change. */
 	_wireguard_refresh_link (platform, wireguard_family_id, ifindex);
 
 	return 0;
@@ -2642,6 +3312,7 @@ _new_from_nl_link (NMPlatform *platform, const NMPCache *cache, struct nlmsghdr
 	gboolean need_ext_data = FALSE;
 	gboolean af_inet6_token_valid = FALSE;
 	gboolean af_inet6_addr_gen_mode_valid = FALSE;
+	guint64 lnk_hash = 0;
 
 	if (!nlmsg_valid_hdr (nlh, sizeof (*ifi)))
 		return NULL;
@@ -2763,55 +3434,78 @@ _new_from_nl_link (NMPlatform *platform, const NMPCache *cache, struct nlmsghdr
 		}
 	}
 
-	switch (obj->link.type) {
-	case NM_LINK_TYPE_GRE:
-	case NM_LINK_TYPE_GRETAP:
-		lnk_data = _parse_lnk_gre (nl_info_kind, nl_info_data);
-		break;
-	case NM_LINK_TYPE_INFINIBAND:
-		lnk_data = _parse_lnk_infiniband (nl_info_kind, nl_info_data);
-		break;
-	case NM_LINK_TYPE_IP6TNL:
-		lnk_data = _parse_lnk_ip6tnl (nl_info_kind, nl_info_data);
-		break;
-	case NM_LINK_TYPE_IP6GRE:
-	case NM_LINK_TYPE_IP6GRETAP:
-		lnk_data = _parse_lnk_ip6gre (nl_info_kind, nl_info_data);
-		break;
-	case NM_LINK_TYPE_IPIP:
-		lnk_data = _parse_lnk_ipip (nl_info_kind, nl_info_data);
-		break;
-	case NM_LINK_TYPE_MACSEC:
-		lnk_data = _parse_lnk_macsec (nl_info_kind, nl_info_data);
-		break;
-	case NM_LINK_TYPE_MACVLAN:
-	case NM_LINK_TYPE_MACVTAP:
-		lnk_data = _parse_lnk_macvlan (nl_info_kind, nl_info_data);
-		break;
-	case NM_LINK_TYPE_SIT:
-		lnk_data = _parse_lnk_sit (nl_info_kind, nl_info_data);
-		break;
-	case NM_LINK_TYPE_TUN:
-		lnk_data = _parse_lnk_tun (nl_info_kind, nl_info_data);
-		break;
-	case NM_LINK_TYPE_VLAN:
-		lnk_data = _parse_lnk_vlan (nl_info_kind, nl_info_data);
-		break;
-	case NM_LINK_TYPE_VXLAN:
-		lnk_data = _parse_lnk_vxlan (nl_info_kind, nl_info_data);
-		break;
-	case NM_LINK_TYPE_WIFI:
-	case NM_LINK_TYPE_OLPC_MESH:
-	case NM_LINK_TYPE_WPAN:
-		need_ext_data = TRUE;
-		lnk_data_complete_from_cache = FALSE;
-		break;
-	case NM_LINK_TYPE_WIREGUARD:
-		lnk_data_complete_from_cache = TRUE;
-		break;
-	default:
-		lnk_data_complete_from_cache = FALSE;
-		break;
+	if (   nl_info_data
+	    && completed_from_cache) {
+		NMHashState h;
+
+		nm_hash_init (&h, 1559158037u);
+		nm_hash_update_str0 (&h, nl_info_kind);
+		nm_hash_update_mem (&h, nla_data (nl_info_data), nla_len (nl_info_data));
+		lnk_hash = nm_hash_complete_u64 (&h);
+
+		/* Links flap often, but their IFLA_INFO_DATA rarely changes. If it is
+		 * the same as for the cached link, reuse the cached lnk object instead
+		 * of parsing it again. */
+		_lookup_cached_link (cache, obj->link.ifindex, completed_from_cache, &link_cached);
+		if (   link_cached
+		    && link_cached->_link.netlink.is_in_netlink
+		    && link_cached->link.type == obj->link.type
+		    && link_cached->_link.netlink.lnk
+		    && link_cached->_link.netlink.lnk_hash == lnk_hash)
+			lnk_data = nmp_object_ref (link_cached->_link.netlink.lnk);
+	}
+
+	if (!lnk_data) {
+		switch (obj->link.type) {
+		case NM_LINK_TYPE_GRE:
+		case NM_LINK_TYPE_GRETAP:
+			lnk_data = _parse_lnk_gre (nl_info_kind, nl_info_data);
+			break;
+		case NM_LINK_TYPE_INFINIBAND:
+			lnk_data = _parse_lnk_infiniband (nl_info_kind, nl_info_data);
+			break;
+		case NM_LINK_TYPE_IP6TNL:
+			lnk_data = _parse_lnk_ip6tnl (nl_info_kind, nl_info_data);
+			break;
+		case NM_LINK_TYPE_IP6GRE:
+		case NM_LINK_TYPE_IP6GRETAP:
+			lnk_data = _parse_lnk_ip6gre (nl_info_kind, nl_info_data);
+			break;
+		case NM_LINK_TYPE_IPIP:
+			lnk_data = _parse_lnk_ipip (nl_info_kind, nl_info_data);
+			break;
+		case NM_LINK_TYPE_MACSEC:
+			lnk_data = _parse_lnk_macsec (nl_info_kind, nl_info_data);
+			break;
+		case NM_LINK_TYPE_MACVLAN:
+		case NM_LINK_TYPE_MACVTAP:
+			lnk_data = _parse_lnk_macvlan (nl_info_kind, nl_info_data);
+			break;
+		case NM_LINK_TYPE_SIT:
+			lnk_data = _parse_lnk_sit (nl_info_kind, nl_info_data);
+			break;
+		case NM_LINK_TYPE_TUN:
+			lnk_data = _parse_lnk_tun (nl_info_kind, nl_info_data);
+			break;
+		case NM_LINK_TYPE_VLAN:
+			lnk_data = _parse_lnk_vlan (nl_info_kind, nl_info_data);
+			break;
+		case NM_LINK_TYPE_VXLAN:
+			lnk_data = _parse_lnk_vxlan (nl_info_kind, nl_info_data);
+			break;
+		case NM_LINK_TYPE_WIFI:
+		case NM_LINK_TYPE_OLPC_MESH:
+		case NM_LINK_TYPE_WPAN:
+			need_ext_data = TRUE;
+			lnk_data_complete_from_cache = FALSE;
+			break;
+		case NM_LINK_TYPE_WIREGUARD:
+			lnk_data_complete_from_cache = TRUE;
+			break;
+		default:
+			lnk_data_complete_from_cache = FALSE;
+			break;
+		}
 	}
 
 	if (   completed_from_cache
@@ -2838,6 +3532,8 @@ _new_from_nl_link (NMPlatform *platform, const NMPCache *cache, struct nlmsghdr
 				 * we want to keep the previously received lnk_data. */
 				nmp_object_unref (lnk_data);
 				lnk_data = nmp_object_ref (link_cached->_link.netlink.lnk);
+				if (!nl_info_data)
+					lnk_hash = link_cached->_link.netlink.lnk_hash;
 			}
 
 			if (   need_ext_data
@@ -2865,6 +3561,8 @@ _new_from_nl_link (NMPlatform *platform, const NMPCache *cache, struct nlmsghdr
 	}
 
 	obj->_link.netlink.lnk = lnk_data;
+	if (lnk_data)
+		obj->_link.netlink.lnk_hash = lnk_hash;
 
 	if (   need_ext_data
 	    && obj->_link.ext_data == NULL) {
@@ -3052,6 +3750,7 @@ _new_from_nl_route (struct nlmsghdr *nlh, gboolean id_only)
 		[RTA_CACHEINFO] = { .minlen = nm_offsetofend (struct rta_cacheinfo, rta_tsage) },
 		[RTA_METRICS]   = { .type = NLA_NESTED },
 		[RTA_MULTIPATH] = { .type = NLA_NESTED },
+		[RTA_NH_ID]     = { .type = NLA_U32 },
 	};
 	const struct rtmsg *rtm;
 	struct nlattr *tb[G_N_ELEMENTS (policy)];
@@ -3062,15 +3761,13 @@ _new_from_nl_route (struct nlmsghdr *nlh, gboolean id_only)
 		gboolean is_present;
 		int ifindex;
 		NMIPAddr gateway;
+		guint16 weight;
 	} nh = {
 		.is_present = FALSE,
 	};
+	gs_unref_array GArray *extra_nexthops = NULL;
 	guint32 mss;
-	guint32 window = 0;
-	guint32 cwnd = 0;
-	guint32 initcwnd = 0;
-	guint32 initrwnd = 0;
-	guint32 mtu = 0;
+	NMPlatformIPRouteMetrics metrics = { 0 };
 	guint32 lock = 0;
 
 	if (!nlmsg_valid_hdr (nlh, sizeof (*rtm)))
@@ -3105,7 +3802,8 @@ _new_from_nl_route (struct nlmsghdr *nlh, gboolean id_only)
 		return NULL;
 
 	/*****************************************************************
-	 * parse nexthops. Only handle routes with one nh.
+	 * parse nexthops. The first nexthop goes to @nh, for ECMP routes
+	 * the remaining ones are collected in @extra_nexthops.
 	 *****************************************************************/
 
 	if (tb[RTA_MULTIPATH]) {
@@ -3121,14 +3819,7 @@ _new_from_nl_route (struct nlmsghdr *nlh, gboolean id_only)
 			goto rta_multipath_done;
 
 		while (TRUE) {
-
-			if (nh.is_present) {
-				/* we don't support multipath routes. */
-				return NULL;
-			}
-
-			nh.is_present = TRUE;
-			nh.ifindex = rtnh->rtnh_ifindex;
+			NMIPAddr gateway = { };
 
 			if (rtnh->rtnh_len > sizeof (*rtnh)) {
 				struct nlattr *ntb[G_N_ELEMENTS (policy)];
@@ -3140,9 +3831,40 @@ _new_from_nl_route (struct nlmsghdr *nlh, gboolean id_only)
 					return NULL;
 
 				if (_check_addr_or_return_null (ntb, RTA_GATEWAY, addr_len))
-					memcpy (&nh.gateway, nla_data (ntb[RTA_GATEWAY]), addr_len);
+					memcpy (&gateway, nla_data (ntb[RTA_GATEWAY]), addr_len);
+			}
+
+			if (!nh.is_present) {
+				nh.is_present = TRUE;
+				nh.ifindex = rtnh->rtnh_ifindex;
+				nh.gateway = gateway;
+				nh.weight = ((guint16) rtnh->rtnh_hops) + 1u;
+			} else if (is_v4) {
+				NMPlatformIP4RtNextHop *nh4;
+
+				if (!extra_nexthops)
+					extra_nexthops = g_array_new (FALSE, TRUE, sizeof (NMPlatformIP4RtNextHop));
+				g_array_set_size (extra_nexthops, extra_nexthops->len + 1);
+				nh4 = &g_array_index (extra_nexthops, NMPlatformIP4RtNextHop, extra_nexthops->len - 1);
+				nh4->ifindex = rtnh->rtnh_ifindex;
+				nh4->gateway = gateway.addr4;
+				nh4->weight = ((guint16) rtnh->rtnh_hops) + 1u;
+			} else {
+				NMPlatformIP6RtNextHop *nh6;
+
+				if (!extra_nexthops)
+					extra_nexthops = g_array_new (FALSE, TRUE, sizeof (NMPlatformIP6RtNextHop));
+				g_array_set_size (extra_nexthops, extra_nexthops->len + 1);
+				nh6 = &g_array_index (extra_nexthops, NMPlatformIP6RtNextHop, extra_nexthops->len - 1);
+				nh6->ifindex = rtnh->rtnh_ifindex;
+				nh6->gateway = gateway.addr6;
+				nh6->weight = ((guint16) rtnh->rtnh_hops) + 1u;
 			}
 
+			if (   extra_nexthops
+			    && extra_nexthops->len >= G_MAXUINT16 - 1)
+				return NULL;
+
 			if (tlen < RTNH_ALIGN (rtnh->rtnh_len) + sizeof (*rtnh))
 				goto rta_multipath_done;
 
@@ -3203,15 +3925,15 @@ rta_multipath_done:
 		if (mtb[RTAX_ADVMSS])
 			mss = nla_get_u32 (mtb[RTAX_ADVMSS]);
 		if (mtb[RTAX_WINDOW])
-			window = nla_get_u32 (mtb[RTAX_WINDOW]);
+			metrics.window = nla_get_u32 (mtb[RTAX_WINDOW]);
 		if (mtb[RTAX_CWND])
-			cwnd = nla_get_u32 (mtb[RTAX_CWND]);
+			metrics.cwnd = nla_get_u32 (mtb[RTAX_CWND]);
 		if (mtb[RTAX_INITCWND])
-			initcwnd = nla_get_u32 (mtb[RTAX_INITCWND]);
+			metrics.initcwnd = nla_get_u32 (mtb[RTAX_INITCWND]);
 		if (mtb[RTAX_INITRWND])
-			initrwnd = nla_get_u32 (mtb[RTAX_INITRWND]);
+			metrics.initrwnd = nla_get_u32 (mtb[RTAX_INITRWND]);
 		if (mtb[RTAX_MTU])
-			mtu = nla_get_u32 (mtb[RTAX_MTU]);
+			metrics.mtu = nla_get_u32 (mtb[RTAX_MTU]);
 	}
 
 	/*****************************************************************/
@@ -3258,16 +3980,12 @@ rta_multipath_done:
 	}
 
 	obj->ip_route.mss = mss;
-	obj->ip_route.window = window;
-	obj->ip_route.cwnd = cwnd;
-	obj->ip_route.initcwnd = initcwnd;
-	obj->ip_route.initrwnd = initrwnd;
-	obj->ip_route.mtu = mtu;
-	obj->ip_route.lock_window   = NM_FLAGS_HAS (lock, 1 << RTAX_WINDOW);
-	obj->ip_route.lock_cwnd     = NM_FLAGS_HAS (lock, 1 << RTAX_CWND);
-	obj->ip_route.lock_initcwnd = NM_FLAGS_HAS (lock, 1 << RTAX_INITCWND);
-	obj->ip_route.lock_initrwnd = NM_FLAGS_HAS (lock, 1 << RTAX_INITRWND);
-	obj->ip_route.lock_mtu      = NM_FLAGS_HAS (lock, 1 << RTAX_MTU);
+	metrics.lock_window   = NM_FLAGS_HAS (lock, 1 << RTAX_WINDOW);
+	metrics.lock_cwnd     = NM_FLAGS_HAS (lock, 1 << RTAX_CWND);
+	metrics.lock_initcwnd = NM_FLAGS_HAS (lock, 1 << RTAX_INITCWND);
+	metrics.lock_initrwnd = NM_FLAGS_HAS (lock, 1 << RTAX_INITRWND);
+	metrics.lock_mtu      = NM_FLAGS_HAS (lock, 1 << RTAX_MTU);
+	obj->ip_route.metrics = nm_platform_ip_route_metrics_intern (&metrics);
 
 	if (!is_v4) {
 
@@ -3282,6 +4000,21 @@ rta_multipath_done:
 			obj->ip6_route.rt_pref = nla_get_u8 (tb[RTA_PREF]);
 	}
 
+	if (tb[RTA_NH_ID])
+		obj->ip_route.nhid = nla_get_u32 (tb[RTA_NH_ID]);
+
+	if (extra_nexthops) {
+		/* an ECMP route. Kernel reports the nexthops of a single-hop route
+		 * not in RTA_MULTIPATH, but be lenient and treat a multipath route
+		 * with one nexthop like a regular route. */
+		obj->ip_route.n_nexthops = extra_nexthops->len + 1u;
+		obj->ip_route.weight = nh.weight;
+		if (is_v4)
+			obj->_ip4_route.extra_nexthops = (gpointer) g_array_free (g_steal_pointer (&extra_nexthops), FALSE);
+		else
+			obj->_ip6_route.extra_nexthops = (gpointer) g_array_free (g_steal_pointer (&extra_nexthops), FALSE);
+	}
+
 	obj->ip_route.r_rtm_flags = rtm->rtm_flags;
 	obj->ip_route.rt_source = nmp_utils_ip_config_source_from_rtprot (rtm->rtm_protocol);
 
@@ -3564,14 +4297,88 @@ _new_from_nl_qdisc (struct nlmsghdr *nlh, gboolean id_only)
 	return obj;
 }
 
-static NMPObject *
-_new_from_nl_tfilter (struct nlmsghdr *nlh, gboolean id_only)
+/* parses the first action of a filter, in the same layout that
+ * _nl_msg_new_tfilter() creates. Knowing the action allows
+ * nm_platform_tfilter_sync() to leave filters alone that are
+ * already as desired. */
+static void
+_parse_tfilter_action (const struct nlattr *options_attr,
+                       NMPlatformAction *action)
 {
-	static const struct nla_policy policy[] = {
-		[TCA_KIND] = { .type = NLA_STRING },
+	static const struct nla_policy act_policy[] = {
+		[TCA_ACT_KIND]    = { .type = NLA_STRING },
+		[TCA_ACT_OPTIONS] = { .type = NLA_NESTED },
 	};
-	struct nlattr *tb[G_N_ELEMENTS (policy)];
-	NMPObject *obj = NULL;
+	struct nlattr *tb[G_N_ELEMENTS (act_policy)];
+	struct nlattr *act_tab;
+	struct nlattr *prio;
+
+	act_tab = nla_find (nla_data (options_attr), nla_len (options_attr), TCA_OPTIONS);
+	if (!act_tab)
+		return;
+
+	prio = nla_find (nla_data (act_tab), nla_len (act_tab), 1 /* priority */);
+	if (!prio)
+		return;
+
+	if (nla_parse_nested_arr (tb, prio, act_policy) < 0)
+		return;
+
+	if (!tb[TCA_ACT_KIND])
+		return;
+
+	action->kind = g_intern_string (nla_get_string (tb[TCA_ACT_KIND]));
+
+	if (!tb[TCA_ACT_OPTIONS])
+		return;
+
+	if (nm_streq (action->kind, NM_PLATFORM_ACTION_KIND_SIMPLE)) {
+		struct nlattr *data;
+
+		data = nla_find (nla_data (tb[TCA_ACT_OPTIONS]), nla_len (tb[TCA_ACT_OPTIONS]), TCA_DEF_DATA);
+		if (data)
+			nla_strlcpy (action->simple.sdata, data, sizeof (action->simple.sdata));
+	} else if (nm_streq (action->kind, NM_PLATFORM_ACTION_KIND_MIRRED)) {
+		const struct tc_mirred *sel;
+		struct nlattr *parms;
+
+		parms = nla_find (nla_data (tb[TCA_ACT_OPTIONS]), nla_len (tb[TCA_ACT_OPTIONS]), TCA_MIRRED_PARMS);
+		if (   !parms
+		    || nla_len (parms) < sizeof (*sel))
+			return;
+
+		sel = nla_data (parms);
+		action->mirred.ifindex = sel->ifindex;
+		switch (sel->eaction) {
+		case TCA_EGRESS_REDIR:
+			action->mirred.egress = TRUE;
+			action->mirred.redirect = TRUE;
+			break;
+		case TCA_EGRESS_MIRROR:
+			action->mirred.egress = TRUE;
+			action->mirred.mirror = TRUE;
+			break;
+		case TCA_INGRESS_REDIR:
+			action->mirred.ingress = TRUE;
+			action->mirred.redirect = TRUE;
+			break;
+		case TCA_INGRESS_MIRROR:
+			action->mirred.ingress = TRUE;
+			action->mirred.mirror = TRUE;
+			break;
+		}
+	}
+}
+
+static NMPObject *
+_new_from_nl_tfilter (struct nlmsghdr *nlh, gboolean id_only)
+{
+	static const struct nla_policy policy[] = {
+		[TCA_KIND]    = { .type = NLA_STRING },
+		[TCA_OPTIONS] = { .type = NLA_NESTED },
+	};
+	struct nlattr *tb[G_N_ELEMENTS (policy)];
+	NMPObject *obj = NULL;
 	const struct tcmsg *tcm;
 
 	if (nlmsg_parse_arr (nlh, sizeof (*tcm), tb, policy) < 0)
@@ -3591,6 +4398,69 @@ _new_from_nl_tfilter (struct nlmsghdr *nlh, gboolean id_only)
 	obj->tfilter.parent = tcm->tcm_parent;
 	obj->tfilter.info = tcm->tcm_info;
 
+	if (tb[TCA_OPTIONS])
+		_parse_tfilter_action (tb[TCA_OPTIONS], &obj->tfilter.action);
+
+	return obj;
+}
+
+static NMPObject *
+_new_from_nl_nexthop (struct nlmsghdr *nlh, gboolean id_only)
+{
+	static const struct nla_policy policy[] = {
+		[NHA_ID]        = { .type = NLA_U32 },
+		[NHA_GROUP]     = { .type = NLA_UNSPEC },
+		[NHA_BLACKHOLE] = { .type = NLA_FLAG },
+		[NHA_OIF]       = { .type = NLA_U32 },
+		[NHA_GATEWAY]   = { .type = NLA_UNSPEC },
+	};
+	struct nlattr *tb[G_N_ELEMENTS (policy)];
+	const struct nhmsg *nhm;
+	NMPObject *obj;
+	gboolean is_v4;
+	int addr_len;
+
+	if (nlmsg_parse_arr (nlh, sizeof (*nhm), tb, policy) < 0)
+		return NULL;
+
+	nhm = nlmsg_data (nlh);
+
+	/* Only handle plain nexthops. Groups (which have AF_UNSPEC family) and
+	 * blackhole nexthops have no device and are not tracked. */
+	if (!NM_IN_SET (nhm->nh_family, AF_INET, AF_INET6))
+		return NULL;
+
+	if (   !tb[NHA_ID]
+	    || tb[NHA_GROUP]
+	    || tb[NHA_BLACKHOLE])
+		return NULL;
+
+	is_v4 = nhm->nh_family == AF_INET;
+	addr_len = is_v4
+	           ? sizeof (in_addr_t)
+	           : sizeof (struct in6_addr);
+
+	obj = nmp_object_new (is_v4 ? NMP_OBJECT_TYPE_IP4_NEXTHOP : NMP_OBJECT_TYPE_IP6_NEXTHOP, NULL);
+
+	obj->ip_nexthop.id = nla_get_u32 (tb[NHA_ID]);
+
+	if (id_only)
+		return obj;
+
+	if (tb[NHA_OIF])
+		obj->ip_nexthop.ifindex = nla_get_u32 (tb[NHA_OIF]);
+
+	if (tb[NHA_GATEWAY]) {
+		if (nla_len (tb[NHA_GATEWAY]) != addr_len) {
+			nmp_object_unref (obj);
+			return NULL;
+		}
+		memcpy (obj->ip_nexthop.gateway_ptr, nla_data (tb[NHA_GATEWAY]), addr_len);
+	}
+
+	obj->ip_nexthop.nh_flags = nhm->nh_flags;
+	obj->ip_nexthop.nh_source = nmp_utils_ip_config_source_from_rtprot (nhm->nh_protocol);
+
 	return obj;
 }
 
@@ -3642,6 +4512,10 @@ nmp_object_new_from_nl (NMPlatform *platform, const NMPCache *cache, struct nl_m
 	case RTM_DELTFILTER:
 	case RTM_GETTFILTER:
 		return _new_from_nl_tfilter (msghdr, id_only);
+	case RTM_NEWNEXTHOP:
+	case RTM_DELNEXTHOP:
+	case RTM_GETNEXTHOP:
+		return _new_from_nl_nexthop (msghdr, id_only);
 	default:
 		return NULL;
 	}
@@ -3972,13 +4846,13 @@ nla_put_failure:
 }
 
 static guint32
-ip_route_get_lock_flag (const NMPlatformIPRoute *route)
+ip_route_get_lock_flag (const NMPlatformIPRouteMetrics *metrics)
 {
-	return   (((guint32) route->lock_window)   << RTAX_WINDOW)
-	       | (((guint32) route->lock_cwnd)     << RTAX_CWND)
-	       | (((guint32) route->lock_initcwnd) << RTAX_INITCWND)
-	       | (((guint32) route->lock_initrwnd) << RTAX_INITRWND)
-	       | (((guint32) route->lock_mtu)      << RTAX_MTU);
+	return   (((guint32) metrics->lock_window)   << RTAX_WINDOW)
+	       | (((guint32) metrics->lock_cwnd)     << RTAX_CWND)
+	       | (((guint32) metrics->lock_initcwnd) << RTAX_INITCWND)
+	       | (((guint32) metrics->lock_initrwnd) << RTAX_INITRWND)
+	       | (((guint32) metrics->lock_mtu)      << RTAX_MTU);
 }
 
 /* Copied and modified from libnl3's build_route_msg() and rtnl_route_build_msg(). */
@@ -3990,7 +4864,8 @@ _nl_msg_new_route (int nlmsg_type,
 	nm_auto_nlmsg struct nl_msg *msg = NULL;
 	const NMPClass *klass = NMP_OBJECT_GET_CLASS (obj);
 	gboolean is_v4 = klass->addr_family == AF_INET;
-	const guint32 lock = ip_route_get_lock_flag (NMP_OBJECT_CAST_IP_ROUTE (obj));
+	const NMPlatformIPRouteMetrics *const route_metrics = nm_platform_ip_route_get_metrics (NMP_OBJECT_CAST_IP_ROUTE (obj));
+	const guint32 lock = ip_route_get_lock_flag (route_metrics);
 	const guint32 table = nm_platform_route_table_uncoerce (NMP_OBJECT_CAST_IP_ROUTE (obj)->table_coerced, TRUE);
 	const struct rtmsg rtmsg = {
 		.rtm_family = klass->addr_family,
@@ -4048,12 +4923,7 @@ _nl_msg_new_route (int nlmsg_type,
 	}
 
 	if (   obj->ip_route.mss
-	    || obj->ip_route.window
-	    || obj->ip_route.cwnd
-	    || obj->ip_route.initcwnd
-	    || obj->ip_route.initrwnd
-	    || obj->ip_route.mtu
-	    || lock) {
+	    || obj->ip_route.metrics) {
 		struct nlattr *metrics;
 
 		metrics = nla_nest_start (msg, RTA_METRICS);
@@ -4062,30 +4932,90 @@ _nl_msg_new_route (int nlmsg_type,
 
 		if (obj->ip_route.mss)
 			NLA_PUT_U32 (msg, RTAX_ADVMSS, obj->ip_route.mss);
-		if (obj->ip_route.window)
-			NLA_PUT_U32 (msg, RTAX_WINDOW, obj->ip_route.window);
-		if (obj->ip_route.cwnd)
-			NLA_PUT_U32 (msg, RTAX_CWND, obj->ip_route.cwnd);
-		if (obj->ip_route.initcwnd)
-			NLA_PUT_U32 (msg, RTAX_INITCWND, obj->ip_route.initcwnd);
-		if (obj->ip_route.initrwnd)
-			NLA_PUT_U32 (msg, RTAX_INITRWND, obj->ip_route.initrwnd);
-		if (obj->ip_route.mtu)
-			NLA_PUT_U32 (msg, RTAX_MTU, obj->ip_route.mtu);
+		if (route_metrics->window)
+			NLA_PUT_U32 (msg, RTAX_WINDOW, route_metrics->window);
+		if (route_metrics->cwnd)
+			NLA_PUT_U32 (msg, RTAX_CWND, route_metrics->cwnd);
+		if (route_metrics->initcwnd)
+			NLA_PUT_U32 (msg, RTAX_INITCWND, route_metrics->initcwnd);
+		if (route_metrics->initrwnd)
+			NLA_PUT_U32 (msg, RTAX_INITRWND, route_metrics->initrwnd);
+		if (route_metrics->mtu)
+			NLA_PUT_U32 (msg, RTAX_MTU, route_metrics->mtu);
 		if (lock)
 			NLA_PUT_U32 (msg, RTAX_LOCK, lock);
 
 		nla_nest_end (msg, metrics);
 	}
 
-	/* We currently don't have need for multi-hop routes... */
-	if (is_v4) {
-		NLA_PUT (msg, RTA_GATEWAY, addr_len, &obj->ip4_route.gateway);
+	if (obj->ip_route.nhid) {
+		/* the gateway and device come from the nexthop object. Kernel
+		 * rejects RTA_NH_ID together with RTA_OIF/RTA_GATEWAY, and
+		 * also doesn't find the route for deletion if they are set. */
+		NLA_PUT_U32 (msg, RTA_NH_ID, obj->ip_route.nhid);
+	} else if (nmp_object_ip_route_get_n_extra_nexthops (obj) > 0) {
+		struct nlattr *multipath;
+		guint n = obj->ip_route.n_nexthops;
+		guint i;
+
+		multipath = nla_nest_start (msg, RTA_MULTIPATH);
+		if (!multipath)
+			goto nla_put_failure;
+
+		for (i = 0; i < n; i++) {
+			struct rtnexthop *rtnh;
+			gconstpointer gateway;
+			int ifindex;
+			guint16 weight;
+
+			if (i == 0) {
+				ifindex = obj->ip_route.ifindex;
+				weight = obj->ip_route.weight;
+				gateway = is_v4
+				          ? (gconstpointer) &obj->ip4_route.gateway
+				          : (gconstpointer) &obj->ip6_route.gateway;
+			} else if (is_v4) {
+				const NMPlatformIP4RtNextHop *nh = &obj->_ip4_route.extra_nexthops[i - 1];
+
+				ifindex = nh->ifindex;
+				weight = nh->weight;
+				gateway = &nh->gateway;
+			} else {
+				const NMPlatformIP6RtNextHop *nh = &obj->_ip6_route.extra_nexthops[i - 1];
+
+				ifindex = nh->ifindex;
+				weight = nh->weight;
+				gateway = &nh->gateway;
+			}
+
+			rtnh = nlmsg_reserve (msg, sizeof (*rtnh), NLMSG_ALIGNTO);
+			if (!rtnh)
+				goto nla_put_failure;
+
+			*rtnh = (struct rtnexthop) {
+				.rtnh_flags   = rtmsg.rtm_flags,
+				.rtnh_hops    = weight > 0 ? weight - 1 : 0,
+				.rtnh_ifindex = ifindex,
+			};
+
+			if (   is_v4
+			    ? *((const in_addr_t *) gateway) != 0
+			    : !IN6_IS_ADDR_UNSPECIFIED ((const struct in6_addr *) gateway))
+				NLA_PUT (msg, RTA_GATEWAY, addr_len, gateway);
+
+			rtnh->rtnh_len = (char *) nlmsg_tail (nlmsg_hdr (msg)) - (char *) rtnh;
+		}
+
+		nla_nest_end (msg, multipath);
 	} else {
-		if (!IN6_IS_ADDR_UNSPECIFIED (&obj->ip6_route.gateway))
-			NLA_PUT (msg, RTA_GATEWAY, addr_len, &obj->ip6_route.gateway);
+		if (is_v4) {
+			NLA_PUT (msg, RTA_GATEWAY, addr_len, &obj->ip4_route.gateway);
+		} else {
+			if (!IN6_IS_ADDR_UNSPECIFIED (&obj->ip6_route.gateway))
+				NLA_PUT (msg, RTA_GATEWAY, addr_len, &obj->ip6_route.gateway);
+		}
+		NLA_PUT_U32 (msg, RTA_OIF, obj->ip_route.ifindex);
 	}
-	NLA_PUT_U32 (msg, RTA_OIF, obj->ip_route.ifindex);
 
 	if (   !is_v4
 	    && obj->ip6_route.rt_pref != NM_ICMPV6_ROUTER_PREF_MEDIUM)
@@ -4097,6 +5027,53 @@ nla_put_failure:
 	g_return_val_if_reached (NULL);
 }
 
+static struct nl_msg *
+_nl_msg_new_nexthop (int nlmsg_type,
+                     guint16 nlmsgflags,
+                     const NMPObject *obj)
+{
+	nm_auto_nlmsg struct nl_msg *msg = NULL;
+	const NMPClass *klass = NMP_OBJECT_GET_CLASS (obj);
+	const NMPlatformIPNexthop *nexthop = NMP_OBJECT_CAST_IP_NEXTHOP (obj);
+	gboolean is_v4 = klass->addr_family == AF_INET;
+	const struct nhmsg nhm = {
+		.nh_family = klass->addr_family,
+		.nh_protocol = nmp_utils_ip_config_source_coerce_to_rtprot (nexthop->nh_source),
+		.nh_flags = nexthop->nh_flags & ((unsigned) (RTNH_F_ONLINK)),
+	};
+
+	nm_assert (NM_IN_SET (NMP_OBJECT_GET_TYPE (obj), NMP_OBJECT_TYPE_IP4_NEXTHOP, NMP_OBJECT_TYPE_IP6_NEXTHOP));
+	nm_assert (NM_IN_SET (nlmsg_type, RTM_NEWNEXTHOP, RTM_DELNEXTHOP));
+	nm_assert (nexthop->id > 0);
+
+	msg = nlmsg_alloc_simple (nlmsg_type, (int) nlmsgflags);
+
+	if (nlmsg_append_struct (msg, &nhm) < 0)
+		goto nla_put_failure;
+
+	NLA_PUT_U32 (msg, NHA_ID, nexthop->id);
+
+	if (nlmsg_type == RTM_DELNEXTHOP) {
+		/* kernel only looks at the id for deletion. */
+		return g_steal_pointer (&msg);
+	}
+
+	NLA_PUT_U32 (msg, NHA_OIF, nexthop->ifindex);
+
+	if (is_v4) {
+		if (obj->ip4_nexthop.gateway)
+			NLA_PUT (msg, NHA_GATEWAY, sizeof (in_addr_t), &obj->ip4_nexthop.gateway);
+	} else {
+		if (!IN6_IS_ADDR_UNSPECIFIED (&obj->ip6_nexthop.gateway))
+			NLA_PUT (msg, NHA_GATEWAY, sizeof (struct in6_addr), &obj->ip6_nexthop.gateway);
+	}
+
+	return g_steal_pointer (&msg);
+
+nla_put_failure:
+	g_return_val_if_reached (NULL);
+}
+
 static struct nl_msg *
 _nl_msg_new_routing_rule (int nlmsg_type,
                           int nlmsg_flags,
@@ -4561,6 +5538,13 @@ sysctl_set (NMPlatform *platform,
 		return FALSE;
 	}
 
+	if (   dirfd >= 0
+	    && nm_streq (path, "bridge/default_pvid")) {
+		/* kernel changes the VLANs of the bridge and its ports, but it doesn't
+		 * send a link notification about that. */
+		_bridge_vlans_invalidate (platform);
+	}
+
 	return sysctl_set_internal (platform, pathid, dirfd, path, value);
 }
 
@@ -4898,6 +5882,10 @@ refresh_all_type_get_info (RefreshAllType refresh_all_type)
 		R (REFRESH_ALL_TYPE_ROUTING_RULES_IP6, NMP_OBJECT_TYPE_ROUTING_RULE, AF_INET6),
 		R (REFRESH_ALL_TYPE_QDISCS,            NMP_OBJECT_TYPE_QDISC,        AF_UNSPEC),
 		R (REFRESH_ALL_TYPE_TFILTERS,          NMP_OBJECT_TYPE_TFILTER,      AF_UNSPEC),
+		/* the dump of nexthops must be filtered by nh_family. Otherwise, each of the
+		 * two dumps returns the nexthops of both families. */
+		R (REFRESH_ALL_TYPE_IP4_NEXTHOPS,      NMP_OBJECT_TYPE_IP4_NEXTHOP,  AF_INET),
+		R (REFRESH_ALL_TYPE_IP6_NEXTHOPS,      NMP_OBJECT_TYPE_IP6_NEXTHOP,  AF_INET6),
 #undef R
 	};
 
@@ -4919,6 +5907,8 @@ _NM_UTILS_LOOKUP_DEFINE (static, delayed_action_type_to_refresh_all_type, Delaye
 	NM_UTILS_LOOKUP_ITEM (DELAYED_ACTION_TYPE_REFRESH_ALL_ROUTING_RULES_IP6, REFRESH_ALL_TYPE_ROUTING_RULES_IP6),
 	NM_UTILS_LOOKUP_ITEM (DELAYED_ACTION_TYPE_REFRESH_ALL_QDISCS,            REFRESH_ALL_TYPE_QDISCS),
 	NM_UTILS_LOOKUP_ITEM (DELAYED_ACTION_TYPE_REFRESH_ALL_TFILTERS,          REFRESH_ALL_TYPE_TFILTERS),
+	NM_UTILS_LOOKUP_ITEM (DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_NEXTHOPS,      REFRESH_ALL_TYPE_IP4_NEXTHOPS),
+	NM_UTILS_LOOKUP_ITEM (DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_NEXTHOPS,      REFRESH_ALL_TYPE_IP6_NEXTHOPS),
 	NM_UTILS_LOOKUP_ITEM_IGNORE_OTHER (),
 );
 
@@ -4947,6 +5937,8 @@ refresh_all_type_from_needle_object (const NMPObject *obj_needle)
 	case NMP_OBJECT_TYPE_IP6_ROUTE:   return REFRESH_ALL_TYPE_IP6_ROUTES;
 	case NMP_OBJECT_TYPE_QDISC:       return REFRESH_ALL_TYPE_QDISCS;
 	case NMP_OBJECT_TYPE_TFILTER:     return REFRESH_ALL_TYPE_TFILTERS;
+	case NMP_OBJECT_TYPE_IP4_NEXTHOP: return REFRESH_ALL_TYPE_IP4_NEXTHOPS;
+	case NMP_OBJECT_TYPE_IP6_NEXTHOP: return REFRESH_ALL_TYPE_IP6_NEXTHOPS;
 	case NMP_OBJECT_TYPE_ROUTING_RULE:
 		switch (NMP_OBJECT_CAST_ROUTING_RULE (obj_needle)->addr_family) {
 		case AF_INET:  return REFRESH_ALL_TYPE_ROUTING_RULES_IP4;
@@ -4978,8 +5970,10 @@ refresh_all_type_init_lookup (RefreshAllType refresh_all_type,
 		                                              refresh_all_info->addr_family);
 	}
 
-	/* not yet implemented. */
-	nm_assert (refresh_all_info->addr_family == AF_UNSPEC);
+	/* not yet implemented, unless the object type already implies the family. */
+	nm_assert (NM_IN_SET (refresh_all_info->addr_family,
+	                      AF_UNSPEC,
+	                      nmp_class_from_type (refresh_all_info->obj_type)->addr_family));
 
 	return nmp_lookup_init_obj_type (lookup,
 	                                 refresh_all_info->obj_type);
@@ -5002,6 +5996,8 @@ NM_UTILS_LOOKUP_STR_DEFINE_STATIC (delayed_action_to_string, DelayedActionType,
 	NM_UTILS_LOOKUP_STR_ITEM (DELAYED_ACTION_TYPE_REFRESH_ALL_ROUTING_RULES_IP6, "refresh-all-routing-rules-ip6"),
 	NM_UTILS_LOOKUP_STR_ITEM (DELAYED_ACTION_TYPE_REFRESH_ALL_QDISCS,            "refresh-all-qdiscs"),
 	NM_UTILS_LOOKUP_STR_ITEM (DELAYED_ACTION_TYPE_REFRESH_ALL_TFILTERS,          "refresh-all-tfilters"),
+	NM_UTILS_LOOKUP_STR_ITEM (DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_NEXTHOPS,      "refresh-all-ip4-nexthops"),
+	NM_UTILS_LOOKUP_STR_ITEM (DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_NEXTHOPS,      "refresh-all-ip6-nexthops"),
 	NM_UTILS_LOOKUP_STR_ITEM (DELAYED_ACTION_TYPE_REFRESH_LINK,                  "refresh-link"),
 	NM_UTILS_LOOKUP_STR_ITEM (DELAYED_ACTION_TYPE_MASTER_CONNECTED,              "master-connected"),
 	NM_UTILS_LOOKUP_STR_ITEM (DELAYED_ACTION_TYPE_READ_NETLINK,                  "read-netlink"),
@@ -5009,6 +6005,7 @@ NM_UTILS_LOOKUP_STR_DEFINE_STATIC (delayed_action_to_string, DelayedActionType,
 	NM_UTILS_LOOKUP_ITEM_IGNORE (DELAYED_ACTION_TYPE_NONE),
 	NM_UTILS_LOOKUP_ITEM_IGNORE (DELAYED_ACTION_TYPE_REFRESH_ALL),
 	NM_UTILS_LOOKUP_ITEM_IGNORE (DELAYED_ACTION_TYPE_REFRESH_ALL_ROUTING_RULES_ALL),
+	NM_UTILS_LOOKUP_ITEM_IGNORE (DELAYED_ACTION_TYPE_REFRESH_ALL_NEXTHOPS_ALL),
 	NM_UTILS_LOOKUP_ITEM_IGNORE (__DELAYED_ACTION_TYPE_MAX),
 );
 
@@ -5115,6 +6112,12 @@ delayed_action_wait_for_nl_response_complete (NMPlatform *platform,
 			data->response.out_route_get = NULL;
 		}
 		break;
+	case DELAYED_ACTION_RESPONSE_TYPE_BRIDGE_VLANS_GET:
+		data->response.out_bridge_vlans_get = NULL;
+		break;
+	case DELAYED_ACTION_RESPONSE_TYPE_SRIOV_VFS_GET:
+		data->response.out_sriov_vfs_get = NULL;
+		break;
 	}
 
 	g_array_remove_index_fast (priv->delayed_action.list_wait_for_nl_response, idx);
@@ -5321,6 +6324,13 @@ delayed_action_schedule (NMPlatform *platform, DelayedActionType action_type, gp
 
 	nm_assert (action_type != DELAYED_ACTION_TYPE_NONE);
 
+	if (   priv->replay
+	    && action_type != DELAYED_ACTION_TYPE_MASTER_CONNECTED) {
+		/* without kernel, there is nothing to request or to read. */
+		nm_assert (action_type != DELAYED_ACTION_TYPE_WAIT_FOR_NL_RESPONSE);
+		return;
+	}
+
 	switch (action_type) {
 	case DELAYED_ACTION_TYPE_REFRESH_LINK:
 		if (_nm_utils_ptrarray_find_first ((gconstpointer *) priv->delayed_action.list_refresh_link->pdata, priv->delayed_action.list_refresh_link->len, user_data) < 0)
@@ -5481,7 +6491,7 @@ cache_on_change (NMPlatform *platform,
 		{
 			int ifindex = 0;
 
-			/* if we remove a link (from netlink), we must refresh the addresses, routes, qdiscs and tfilters */
+			/* if we remove a link (from netlink), we must refresh the addresses, routes, nexthops, qdiscs and tfilters */
 			if (   cache_op == NMP_CACHE_OPS_REMOVED
 			    && obj_old /* <-- nonsensical, make coverity happy */)
 				ifindex = obj_old->link.ifindex;
@@ -5499,7 +6509,8 @@ cache_on_change (NMPlatform *platform,
 				                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ROUTES |
 				                         DELAYED_ACTION_TYPE_REFRESH_ALL_ROUTING_RULES_ALL |
 				                         DELAYED_ACTION_TYPE_REFRESH_ALL_QDISCS |
-				                         DELAYED_ACTION_TYPE_REFRESH_ALL_TFILTERS,
+				                         DELAYED_ACTION_TYPE_REFRESH_ALL_TFILTERS |
+				                         DELAYED_ACTION_TYPE_REFRESH_ALL_NEXTHOPS_ALL,
 				                         NULL);
 			}
 		}
@@ -5547,10 +6558,14 @@ cache_on_change (NMPlatform *platform,
 			            && !NM_FLAGS_HAS (obj_new->link.n_ifi_flags, IFF_LOWER_UP)))) {
 				/* FIXME: I suspect that IFF_LOWER_UP must not be considered, and I
 				 * think kernel does send RTM_DELROUTE events for IPv6 routes, so
-				 * we might not need to refresh IPv6 routes. */
+				 * we might not need to refresh IPv6 routes.
+				 *
+				 * Kernel also flushes the nexthops of a link that goes down,
+				 * without sending RTM_DELNEXTHOP. */
 				delayed_action_schedule (platform,
 				                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_ROUTES |
-				                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ROUTES,
+				                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ROUTES |
+				                         DELAYED_ACTION_TYPE_REFRESH_ALL_NEXTHOPS_ALL,
 				                         NULL);
 			}
 		}
@@ -5651,6 +6666,19 @@ cache_on_change (NMPlatform *platform,
 			}
 		}
 		break;
+	case NMP_OBJECT_TYPE_IP4_NEXTHOP:
+	case NMP_OBJECT_TYPE_IP6_NEXTHOP:
+		{
+			/* Deleting a nexthop also deletes the routes that use it, but kernel
+			 * sends no RTM_DELROUTE for them. IPv4 routes can also use IPv6 nexthops. */
+			if (cache_op == NMP_CACHE_OPS_REMOVED) {
+				delayed_action_schedule (platform,
+				                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_ROUTES |
+				                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ROUTES,
+				                         NULL);
+			}
+		}
+		break;
 	default:
 		break;
 	}
@@ -5769,124 +6797,607 @@ _nl_send_nlmsg (NMPlatform *platform,
 	return 0;
 }
 
+/*****************************************************************************/
+
 static void
-do_request_link_no_delayed_actions (NMPlatform *platform, int ifindex, const char *name)
+async_request_timeout_schedule (NMPlatform *platform);
+
+static void
+async_request_free (AsyncRequest *req)
 {
-	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
-	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
-	int nle;
+	nm_assert (!req->cancelled_id);
 
-	if (name && !name[0])
-		name = NULL;
+	nm_g_object_unref (req->cancellable);
+	g_free (req->log_id);
+	g_free (req->errmsg);
+	g_slice_free (AsyncRequest, req);
+}
 
-	g_return_if_fail (ifindex > 0 || name);
+static void
+async_request_invoke (AsyncRequest *req)
+{
+	NMPlatform *platform = req->platform;
+	gs_free_error GError *error = NULL;
+	char s_buf[256];
+	gboolean success;
+	const char *log_detail = "";
 
-	_LOGD ("do-request-link: %d %s", ifindex, name ?: "");
+	nm_clear_g_signal_handler (req->cancellable, &req->cancelled_id);
 
-	if (ifindex > 0) {
-		const NMDedupMultiEntry *entry;
+	if (req->is_delete) {
+		/* For deletion, the object being already gone counts as success. */
+		success =    req->seq_result == WAIT_FOR_NL_RESPONSE_RESULT_RESPONSE_OK
+		          || NM_IN_SET (-((int) req->seq_result), ESRCH, ENOENT, ENODEV);
+		if (!success) {
+			/* pass */
+		} else if (req->seq_result != WAIT_FOR_NL_RESPONSE_RESULT_RESPONSE_OK)
+			log_detail = ", meaning the object was already removed";
+	} else
+		success = (req->seq_result == WAIT_FOR_NL_RESPONSE_RESULT_RESPONSE_OK);
 
-		entry = nmp_cache_lookup_entry_link (nm_platform_get_cache (platform), ifindex);
-		if (entry) {
-			priv->pruning[REFRESH_ALL_TYPE_LINKS] += 1;
-			nm_dedup_multi_entry_set_dirty (entry, TRUE);
-		}
+	_NMLOG (success ? LOGL_DEBUG : LOGL_WARN,
+	        "do-%s-async[%s]: %s%s (seq %u)",
+	        req->is_delete ? "delete" : "change",
+	        req->log_id,
+	        wait_for_nl_response_to_string (req->seq_result, req->errmsg, s_buf, sizeof (s_buf)),
+	        log_detail,
+	        req->seq_number);
+
+	if (!success) {
+		g_set_error (&error,
+		             NM_UTILS_ERROR,
+		             NM_UTILS_ERROR_UNKNOWN,
+		             "%s",
+		             wait_for_nl_response_to_string (req->seq_result, req->errmsg, s_buf, sizeof (s_buf)));
 	}
 
-	event_handler_read_netlink (platform, FALSE);
+	if (req->callback)
+		req->callback (error, req->callback_data);
+	async_request_free (req);
+}
 
-	nlmsg = _nl_msg_new_link (RTM_GETLINK,
-	                          0,
-	                          ifindex,
-	                          name);
-	if (nlmsg) {
-		nle = _nl_send_nlmsg (platform, nlmsg, NULL, NULL, DELAYED_ACTION_RESPONSE_TYPE_VOID, NULL);
-		if (nle < 0) {
-			_LOGE ("do-request-link: %d %s: failed sending netlink request \"%s\" (%d)",
-			       ifindex, name ?: "",
-			       nm_strerror (nle), -nle);
-			return;
-		}
+static void
+async_request_dispatch (NMPlatform *platform)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	AsyncRequest *req;
+
+	while ((req = c_list_first_entry (&priv->async.completed_lst, AsyncRequest, lst))) {
+		c_list_unlink (&req->lst);
+		async_request_invoke (req);
 	}
 }
 
+static gboolean
+async_request_dispatch_idle (gpointer user_data)
+{
+	NMPlatform *platform = user_data;
+
+	NM_LINUX_PLATFORM_GET_PRIVATE (platform)->async.idle_id = 0;
+	async_request_dispatch (platform);
+	return G_SOURCE_REMOVE;
+}
+
 static void
-do_request_link (NMPlatform *platform, int ifindex, const char *name)
+async_request_complete (NMPlatform *platform,
+                        AsyncRequest *req,
+                        WaitForNlResponseResult seq_result,
+                        const char *errmsg)
 {
-	do_request_link_no_delayed_actions (platform, ifindex, name);
-	delayed_action_handle_all (platform, FALSE);
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+
+	nm_assert (req->is_pending);
+
+	if (!g_hash_table_remove (priv->async.pending, GUINT_TO_POINTER (req->seq_number)))
+		nm_assert_not_reached ();
+	req->is_pending = FALSE;
+	req->seq_result = seq_result;
+	req->errmsg = g_strdup (errmsg);
+
+	/* the callback is never invoked synchronously while reading from netlink,
+	 * because it may well start new requests. */
+	c_list_unlink (&req->lst);
+	c_list_link_tail (&priv->async.completed_lst, &req->lst);
+	if (!priv->async.idle_id)
+		priv->async.idle_id = g_idle_add (async_request_dispatch_idle, platform);
 }
 
-static struct nl_msg *
-_nl_msg_new_dump (NMPObjectType obj_type,
-                  int preferred_addr_family)
+static void
+async_request_check_seq (NMPlatform *platform,
+                         guint32 seq_number,
+                         WaitForNlResponseResult seq_result,
+                         const char *errmsg)
 {
-	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
-	const NMPClass *klass;
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	AsyncRequest *req;
 
-	klass = nmp_class_from_type (obj_type);
+	if (   seq_number == 0
+	    || !priv->async.pending)
+		return;
 
-	nm_assert (klass);
-	nm_assert (klass->rtm_gettype > 0);
+	req = g_hash_table_lookup (priv->async.pending, GUINT_TO_POINTER (seq_number));
+	if (!req)
+		return;
 
-	nlmsg = nlmsg_alloc_simple (klass->rtm_gettype, NLM_F_DUMP);
+	/* the timeout is not rescheduled. When it fires, it only completes
+	 * the requests that are still pending. */
+	async_request_complete (platform, req, seq_result, errmsg);
+}
 
-	if (klass->addr_family != AF_UNSPEC) {
-		/* if the class specifies a particular address family, then it is preferred. */
-		nm_assert (NM_IN_SET (preferred_addr_family, AF_UNSPEC, klass->addr_family));
-		preferred_addr_family = klass->addr_family;
-	}
+static void
+async_request_complete_all (NMPlatform *platform,
+                            WaitForNlResponseResult seq_result)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	AsyncRequest *req;
 
-	switch (klass->obj_type) {
-	case NMP_OBJECT_TYPE_QDISC:
-	case NMP_OBJECT_TYPE_TFILTER:
-		{
-			const struct tcmsg tcmsg = {
-				.tcm_family = preferred_addr_family,
-			};
+	while ((req = c_list_first_entry (&priv->async.pending_lst, AsyncRequest, lst)))
+		async_request_complete (platform, req, seq_result, NULL);
+	nm_clear_g_source (&priv->async.timeout_id);
+}
 
-			if (nlmsg_append_struct (nlmsg, &tcmsg) < 0)
-				g_return_val_if_reached (NULL);
-		}
-		break;
-	case NMP_OBJECT_TYPE_LINK:
-	case NMP_OBJECT_TYPE_IP4_ADDRESS:
-	case NMP_OBJECT_TYPE_IP6_ADDRESS:
-	case NMP_OBJECT_TYPE_IP4_ROUTE:
-	case NMP_OBJECT_TYPE_IP6_ROUTE:
-	case NMP_OBJECT_TYPE_ROUTING_RULE:
-		{
-			const struct rtgenmsg gmsg = {
-				.rtgen_family = preferred_addr_family,
-			};
+static gboolean
+async_request_timeout_cb (gpointer user_data)
+{
+	NMPlatform *platform = user_data;
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	gint64 now_ns = nm_utils_get_monotonic_timestamp_ns ();
+	AsyncRequest *req;
 
-			if (nlmsg_append_struct (nlmsg, &gmsg) < 0)
-				g_return_val_if_reached (NULL);
-		}
-		break;
-	default:
-		g_return_val_if_reached (NULL);
+	priv->async.timeout_id = 0;
+
+	while ((req = c_list_first_entry (&priv->async.pending_lst, AsyncRequest, lst))) {
+		if (req->timeout_abs_ns > now_ns)
+			break;
+		async_request_complete (platform, req, WAIT_FOR_NL_RESPONSE_RESULT_FAILED_TIMEOUT, NULL);
 	}
 
-	return g_steal_pointer (&nlmsg);
+	async_request_timeout_schedule (platform);
+	return G_SOURCE_REMOVE;
 }
 
 static void
-do_request_all_no_delayed_actions (NMPlatform *platform, DelayedActionType action_type)
+async_request_timeout_schedule (NMPlatform *platform)
 {
 	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
-	DelayedActionType action_type_prune;
-	DelayedActionType iflags;
+	AsyncRequest *req;
+	gint64 timeout_ms;
 
-	nm_assert (!NM_FLAGS_ANY (action_type, ~DELAYED_ACTION_TYPE_REFRESH_ALL));
-	action_type &= DELAYED_ACTION_TYPE_REFRESH_ALL;
+	nm_clear_g_source (&priv->async.timeout_id);
 
-	action_type_prune = action_type;
+	req = c_list_first_entry (&priv->async.pending_lst, AsyncRequest, lst);
+	if (!req)
+		return;
 
-	/* calling nmp_cache_dirty_set_all_main() with a non-main lookup-index requires an extra
-	 * cache lookup for every entry.
-	 *
-	 * Avoid that, by special casing routing-rules here. */
+	timeout_ms = (req->timeout_abs_ns - nm_utils_get_monotonic_timestamp_ns ()) / (NM_UTILS_NS_PER_SECOND / 1000);
+	priv->async.timeout_id = g_timeout_add (MAX (1, timeout_ms), async_request_timeout_cb, platform);
+}
+
+static void
+async_request_cancelled_cb (GCancellable *cancellable,
+                            AsyncRequest *req)
+{
+	NMPlatform *platform = req->platform;
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	gs_free_error GError *error = NULL;
+	NMPlatformAsyncCallback callback;
+	gpointer callback_data;
+
+	/* like nm_utils_invoke_on_idle(), on cancellation we invoke the callback
+	 * synchronously. The kernel still handles the request, but we no longer
+	 * care about its ACK. */
+	nm_clear_g_signal_handler (req->cancellable, &req->cancelled_id);
+
+	if (req->is_pending) {
+		if (!g_hash_table_remove (priv->async.pending, GUINT_TO_POINTER (req->seq_number)))
+			nm_assert_not_reached ();
+	}
+	c_list_unlink (&req->lst);
+
+	_LOGD ("do-%s-async[%s]: cancelled (seq %u)",
+	       req->is_delete ? "delete" : "change",
+	       req->log_id,
+	       req->seq_number);
+
+	callback = req->callback;
+	callback_data = req->callback_data;
+	g_cancellable_set_error_if_cancelled (cancellable, &error);
+	async_request_free (req);
+
+	if (callback)
+		callback (error, callback_data);
+}
+
+/**
+ * _nl_send_nlmsg_async:
+ * @platform:
+ * @nlmsg: the request to send.
+ * @obj: the object of the request, only used for logging.
+ * @is_delete: whether @nlmsg deletes @obj.
+ * @callback: (allow-none): invoked once the kernel acknowledged the request,
+ *   or when it failed.
+ * @callback_data: user data for @callback.
+ * @cancellable: (allow-none):
+ *
+ * Unlike _nl_send_nlmsg(), this does not register a delayed action that
+ * delayed_action_handle_all() waits for. The ACK is read whenever there is
+ * something to read on the netlink socket, and @callback is invoked from an
+ * idle handler afterwards. When @cancellable gets cancelled, @callback is
+ * invoked synchronously.
+ *
+ * Returns: the sequence number of the request, or 0 if it could not
+ *   be sent. In that case, @callback is invoked with an error on idle.
+ */
+static guint32
+_nl_send_nlmsg_async (NMPlatform *platform,
+                      struct nl_msg *nlmsg,
+                      const NMPObject *obj,
+                      gboolean is_delete,
+                      NMPlatformAsyncCallback callback,
+                      gpointer callback_data,
+                      GCancellable *cancellable)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	AsyncRequest *req;
+	guint32 seq;
+	int nle;
+
+	nm_assert (nlmsg);
+	nm_assert (callback || !callback_data);
+
+	if (g_cancellable_is_cancelled (cancellable)) {
+		nle = 0;
+		goto fail;
+	}
+
+	seq = _nlh_seq_next_get (priv);
+	nlmsg_hdr (nlmsg)->nlmsg_seq = seq;
+
+	nle = nl_send_auto (priv->nlh, nlmsg);
+	if (nle < 0) {
+		_LOGE ("do-%s-async[%s]: failed sending netlink request \"%s\" (%d)",
+		       is_delete ? "delete" : "change",
+		       nmp_object_to_string (obj, NMP_OBJECT_TO_STRING_ID, NULL, 0),
+		       nm_strerror (nle), -nle);
+		goto fail;
+	}
+
+	req = g_slice_new (AsyncRequest);
+	*req = (AsyncRequest) {
+		.platform       = platform,
+		.callback       = callback,
+		.callback_data  = callback_data,
+		.cancellable    = nm_g_object_ref (cancellable),
+		.log_id         = g_strdup (nmp_object_to_string (obj, NMP_OBJECT_TO_STRING_ID, NULL, 0)),
+		.timeout_abs_ns = nm_utils_get_monotonic_timestamp_ns () + (ASYNC_REQUEST_TIMEOUT_MSEC * (NM_UTILS_NS_PER_SECOND / 1000)),
+		.seq_number     = seq,
+		.is_delete      = is_delete,
+		.is_pending     = TRUE,
+	};
+
+	if (!priv->async.pending)
+		priv->async.pending = g_hash_table_new (nm_direct_hash, NULL);
+	g_hash_table_insert (priv->async.pending, GUINT_TO_POINTER (seq), req);
+	c_list_link_tail (&priv->async.pending_lst, &req->lst);
+
+	if (cancellable) {
+		req->cancelled_id = g_signal_connect (cancellable,
+		                                      "cancelled",
+		                                      G_CALLBACK (async_request_cancelled_cb),
+		                                      req);
+	}
+
+	_LOGt ("do-%s-async[%s]: sent request (seq %u)",
+	       is_delete ? "delete" : "change",
+	       nmp_object_to_string (obj, NMP_OBJECT_TO_STRING_ID, NULL, 0),
+	       seq);
+
+	if (!priv->async.timeout_id)
+		async_request_timeout_schedule (platform);
+	return seq;
+
+fail:
+	if (callback) {
+		GError *error = NULL;
+
+		/* if @cancellable is cancelled, the idle handler reports that instead. */
+		if (nle < 0) {
+			g_set_error (&error,
+			             NM_UTILS_ERROR,
+			             NM_UTILS_ERROR_UNKNOWN,
+			             "failed sending netlink request: %s",
+			             nm_strerror (nle));
+		}
+		nm_utils_invoke_on_idle (sysctl_set_async_return_idle,
+		                         nm_utils_user_data_pack (g_object_ref (platform),
+		                                                  callback,
+		                                                  callback_data,
+		                                                  error),
+		                         cancellable);
+	}
+	return 0;
+}
+
+/* Upper bounds for what _nl_send_nlmsg_batch() packs into one sendmsg() call.
+ * Kernel rejects a request that is larger than the send buffer of the socket
+ * (which we leave at 32 KiB), so stay well below that. */
+#define NL_SEND_BATCH_MAX_BYTES  (16u * 1024u)
+#define NL_SEND_BATCH_MAX_MSGS   256u
+
+/**
+ * _nl_send_nlmsg_batch:
+ * @platform:
+ * @nlmsgs: the messages to send.
+ * @len: the number of messages in @nlmsgs.
+ * @out_seq_results: array of length @len, that receives the result for
+ *   each message.
+ * @out_errmsgs: array of length @len, that receives the extended ACK
+ *   message for each request (if any).
+ *
+ * Like _nl_send_nlmsg(), but packs as many messages as possible into one
+ * sendmsg() call. Kernel processes the messages in order and sends one
+ * ACK for each of them. The responses are collected together by the next
+ * delayed_action_handle_all(), so the arrays must stay alive until then.
+ *
+ * Returns: the number of messages that were sent, which are the first
+ *   messages of @nlmsgs. On failure, a negative errno.
+ */
+static int
+_nl_send_nlmsg_batch (NMPlatform *platform,
+                      struct nl_msg *const*nlmsgs,
+                      guint len,
+                      WaitForNlResponseResult *out_seq_results,
+                      char **out_errmsgs)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	struct iovec iov[NL_SEND_BATCH_MAX_MSGS];
+	struct sockaddr_nl nladdr = {
+		.nl_family = AF_NETLINK,
+	};
+	struct msghdr msg = {
+		.msg_name = &nladdr,
+		.msg_namelen = sizeof (nladdr),
+		.msg_iov = iov,
+	};
+	gsize n_bytes = 0;
+	guint n;
+	guint i;
+	int try_count;
+	int errsv;
+
+	nm_assert (len > 0);
+	nm_assert (out_seq_results);
+	nm_assert (out_errmsgs);
+
+	for (n = 0; n < len && n < NL_SEND_BATCH_MAX_MSGS; n++) {
+		struct nlmsghdr *nlhdr = nlmsg_hdr (nlmsgs[n]);
+
+		/* kernel parses the messages at NLMSG_ALIGN() offsets. Our messages
+		 * are always padded, so they can be concatenated as they are. */
+		nm_assert (nlhdr->nlmsg_len == NLMSG_ALIGN (nlhdr->nlmsg_len));
+
+		if (   n > 0
+		    && n_bytes + nlhdr->nlmsg_len > NL_SEND_BATCH_MAX_BYTES)
+			break;
+
+		nlhdr->nlmsg_seq = _nlh_seq_next_get (priv);
+		if (!nlhdr->nlmsg_pid)
+			nlhdr->nlmsg_pid = nl_socket_get_local_port (priv->nlh);
+		nlhdr->nlmsg_flags |= (NLM_F_REQUEST | NLM_F_ACK);
+
+		iov[n].iov_base = nlhdr;
+		iov[n].iov_len = nlhdr->nlmsg_len;
+		n_bytes += nlhdr->nlmsg_len;
+	}
+
+	msg.msg_iovlen = n;
+
+	try_count = 0;
+again:
+	if (sendmsg (nl_socket_get_fd (priv->nlh), &msg, 0) < 0) {
+		errsv = errno;
+		if (errsv == EINTR && try_count++ < 100)
+			goto again;
+		_LOGD ("netlink: nl-send-nlmsg-batch: failed sending %u messages: %s (%d)",
+		       n, nm_strerror_native (errsv), errsv);
+		return -nm_errno_from_native (errsv);
+	}
+
+	_LOGt ("netlink: nl-send-nlmsg-batch: sent %u messages (%"G_GSIZE_FORMAT" bytes)", n, n_bytes);
+
+	for (i = 0; i < n; i++) {
+		delayed_action_schedule_WAIT_FOR_NL_RESPONSE (platform,
+		                                              nlmsg_hdr (nlmsgs[i])->nlmsg_seq,
+		                                              &out_seq_results[i],
+		                                              &out_errmsgs[i],
+		                                              DELAYED_ACTION_RESPONSE_TYPE_VOID,
+		                                              NULL);
+	}
+	return n;
+}
+
+static void
+do_request_link_no_delayed_actions (NMPlatform *platform, int ifindex, const char *name)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
+	int nle;
+
+	if (name && !name[0])
+		name = NULL;
+
+	g_return_if_fail (ifindex > 0 || name);
+
+	_LOGD ("do-request-link: %d %s", ifindex, name ?: "");
+
+	if (ifindex > 0) {
+		const NMDedupMultiEntry *entry;
+
+		entry = nmp_cache_lookup_entry_link (nm_platform_get_cache (platform), ifindex);
+		if (entry) {
+			priv->pruning[REFRESH_ALL_TYPE_LINKS] += 1;
+			nm_dedup_multi_entry_set_dirty (entry, TRUE);
+		}
+	}
+
+	event_handler_read_netlink (platform, FALSE);
+
+	nlmsg = _nl_msg_new_link (RTM_GETLINK,
+	                          0,
+	                          ifindex,
+	                          name);
+	if (nlmsg) {
+		nle = _nl_send_nlmsg (platform, nlmsg, NULL, NULL, DELAYED_ACTION_RESPONSE_TYPE_VOID, NULL);
+		if (nle < 0) {
+			_LOGE ("do-request-link: %d %s: failed sending netlink request \"%s\" (%d)",
+			       ifindex, name ?: "",
+			       nm_strerror (nle), -nle);
+			return;
+		}
+	}
+}
+
+static void
+do_request_link (NMPlatform *platform, int ifindex, const char *name)
+{
+	do_request_link_no_delayed_actions (platform, ifindex, name);
+	delayed_action_handle_all (platform, FALSE);
+}
+
+static struct nl_msg *
+_nl_msg_new_dump (NMPObjectType obj_type,
+                  int preferred_addr_family,
+                  int ifindex)
+{
+	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
+	const NMPClass *klass;
+
+	klass = nmp_class_from_type (obj_type);
+
+	nm_assert (klass);
+	nm_assert (klass->rtm_gettype > 0);
+	nm_assert (   ifindex == 0
+	           || NM_IN_SET (obj_type, NMP_OBJECT_TYPE_IP4_ADDRESS,
+	                                   NMP_OBJECT_TYPE_IP6_ADDRESS,
+	                                   NMP_OBJECT_TYPE_IP4_ROUTE,
+	                                   NMP_OBJECT_TYPE_IP6_ROUTE));
+
+	nlmsg = nlmsg_alloc_simple (klass->rtm_gettype, NLM_F_DUMP);
+
+	if (klass->addr_family != AF_UNSPEC) {
+		/* if the class specifies a particular address family, then it is preferred. */
+		nm_assert (NM_IN_SET (preferred_addr_family, AF_UNSPEC, klass->addr_family));
+		preferred_addr_family = klass->addr_family;
+	}
+
+	/* Send the full header of the respective type (and not only a struct rtgenmsg).
+	 * With NETLINK_GET_STRICT_CHK the kernel rejects dump requests otherwise. Older
+	 * kernels only look at the family, which is always the first field. */
+	switch (klass->obj_type) {
+	case NMP_OBJECT_TYPE_QDISC:
+	case NMP_OBJECT_TYPE_TFILTER:
+		{
+			const struct tcmsg tcmsg = {
+				.tcm_family = preferred_addr_family,
+			};
+
+			if (nlmsg_append_struct (nlmsg, &tcmsg) < 0)
+				g_return_val_if_reached (NULL);
+		}
+		break;
+	case NMP_OBJECT_TYPE_LINK:
+		{
+			const struct ifinfomsg ifi = {
+				.ifi_family = preferred_addr_family,
+			};
+
+			if (nlmsg_append_struct (nlmsg, &ifi) < 0)
+				g_return_val_if_reached (NULL);
+		}
+		break;
+	case NMP_OBJECT_TYPE_IP4_ADDRESS:
+	case NMP_OBJECT_TYPE_IP6_ADDRESS:
+		{
+			const struct ifaddrmsg ifa = {
+				.ifa_family = preferred_addr_family,
+				.ifa_index  = ifindex,
+			};
+
+			if (nlmsg_append_struct (nlmsg, &ifa) < 0)
+				g_return_val_if_reached (NULL);
+		}
+		break;
+	case NMP_OBJECT_TYPE_IP4_ROUTE:
+	case NMP_OBJECT_TYPE_IP6_ROUTE:
+		{
+			const struct rtmsg rtmsg = {
+				.rtm_family = preferred_addr_family,
+			};
+
+			if (nlmsg_append_struct (nlmsg, &rtmsg) < 0)
+				g_return_val_if_reached (NULL);
+			if (ifindex > 0)
+				NLA_PUT_U32 (nlmsg, RTA_OIF, ifindex);
+		}
+		break;
+	case NMP_OBJECT_TYPE_ROUTING_RULE:
+		{
+			const struct fib_rule_hdr frh = {
+				.family = preferred_addr_family,
+			};
+
+			if (nlmsg_append_struct (nlmsg, &frh) < 0)
+				g_return_val_if_reached (NULL);
+		}
+		break;
+	case NMP_OBJECT_TYPE_IP4_NEXTHOP:
+	case NMP_OBJECT_TYPE_IP6_NEXTHOP:
+		{
+			const struct nhmsg nhm = {
+				.nh_family = preferred_addr_family,
+			};
+
+			if (nlmsg_append_struct (nlmsg, &nhm) < 0)
+				g_return_val_if_reached (NULL);
+		}
+		break;
+	default:
+		g_return_val_if_reached (NULL);
+	}
+
+	return g_steal_pointer (&nlmsg);
+
+nla_put_failure:
+	g_return_val_if_reached (NULL);
+}
+
+static void
+do_request_all_no_delayed_actions (NMPlatform *platform, DelayedActionType action_type)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	DelayedActionType action_type_prune;
+	DelayedActionType iflags;
+
+	nm_assert (!NM_FLAGS_ANY (action_type, ~DELAYED_ACTION_TYPE_REFRESH_ALL));
+	action_type &= DELAYED_ACTION_TYPE_REFRESH_ALL;
+
+	if (   !priv->nexthops.unsupported
+	    && NM_IN_SET (priv->nexthops.dump_result, -EINVAL, -EOPNOTSUPP)) {
+		_LOGD ("nexthop objects are not supported by kernel");
+		priv->nexthops.unsupported = TRUE;
+	}
+	if (priv->nexthops.unsupported)
+		action_type &= ~DELAYED_ACTION_TYPE_REFRESH_ALL_NEXTHOPS_ALL;
+
+	/* a full dump also satisfies a resync that is still pending after an overrun. */
+	priv->resync.pending_full &= ~action_type;
+
+	action_type_prune = action_type;
+
+	/* calling nmp_cache_dirty_set_all_main() with a non-main lookup-index requires an extra
+	 * cache lookup for every entry.
+	 *
+	 * Avoid that, by special casing routing-rules here. */
 	if (NM_FLAGS_ALL (action_type_prune, DELAYED_ACTION_TYPE_REFRESH_ALL_ROUTING_RULES_ALL)) {
 		NMPLookup lookup;
 
@@ -5936,13 +7447,17 @@ do_request_all_no_delayed_actions (NMPlatform *platform, DelayedActionType actio
 		event_handler_read_netlink (platform, FALSE);
 
 		nlmsg = _nl_msg_new_dump (refresh_all_info->obj_type,
-		                          refresh_all_info->addr_family);
+		                          refresh_all_info->addr_family,
+		                          0);
 		if (!nlmsg)
 			goto next_after_fail;
 
 		if (_nl_send_nlmsg (platform,
 		                    nlmsg,
-		                    NULL,
+		                    NM_IN_SET (refresh_all_type, REFRESH_ALL_TYPE_IP4_NEXTHOPS,
+		                                                 REFRESH_ALL_TYPE_IP6_NEXTHOPS)
+		                      ? &priv->nexthops.dump_result
+		                      : NULL,
 		                    NULL,
 		                    DELAYED_ACTION_RESPONSE_TYPE_REFRESH_ALL_IN_PROGRESS,
 		                    out_refresh_all_in_progress) < 0)
@@ -5957,29 +7472,86 @@ next_after_fail:
 }
 
 static void
-do_request_one_type_by_needle_object (NMPlatform *platform, const NMPObject *obj_needle)
-{
-	do_request_all_no_delayed_actions (platform, delayed_action_refresh_from_needle_object (obj_needle));
-	delayed_action_handle_all (platform, FALSE);
-}
-
-static void
-event_seq_check_refresh_all (NMPlatform *platform, guint32 seq_number)
+do_request_by_ifindex_no_delayed_actions (NMPlatform *platform,
+                                          DelayedActionType action_type,
+                                          const int *ifindexes,
+                                          guint n_ifindexes)
 {
 	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
-	DelayedActionWaitForNlResponseData *data;
+	NMPCache *cache = nm_platform_get_cache (platform);
+	DelayedActionType iflags;
 	guint i;
 
-	if (NM_IN_SET (seq_number, 0, priv->nlh_seq_last_seen))
-		return;
+	nm_assert (!NM_FLAGS_ANY (action_type, ~DELAYED_ACTION_TYPE_REFRESH_ALL_BY_IFINDEX));
+	nm_assert (priv->resync.strict_check);
 
-	if (NM_FLAGS_HAS (priv->delayed_action.flags, DELAYED_ACTION_TYPE_WAIT_FOR_NL_RESPONSE)) {
-		nm_assert (priv->delayed_action.list_wait_for_nl_response->len > 0);
+	FOR_EACH_DELAYED_ACTION (iflags, action_type) {
+		RefreshAllType refresh_all_type = delayed_action_type_to_refresh_all_type (iflags);
+		const RefreshAllInfo *refresh_all_info = refresh_all_type_get_info (refresh_all_type);
+		int *out_refresh_all_in_progress;
 
-		for (i = 0; i < priv->delayed_action.list_wait_for_nl_response->len; i++) {
-			data = &g_array_index (priv->delayed_action.list_wait_for_nl_response, DelayedActionWaitForNlResponseData, i);
+		/* only the objects on the requested ifindexes are dirty. Pruning
+		 * still goes over the entire type, but only removes dirty objects. */
+		priv->pruning[refresh_all_type] += 1;
+		for (i = 0; i < n_ifindexes; i++) {
+			NMPLookup lookup;
 
-			if (   data->response_type == DELAYED_ACTION_RESPONSE_TYPE_REFRESH_ALL_IN_PROGRESS
+			nmp_lookup_init_object (&lookup, refresh_all_info->obj_type, ifindexes[i]);
+			nmp_cache_dirty_set_all_main (cache, &lookup);
+		}
+
+		out_refresh_all_in_progress = &priv->delayed_action.refresh_all_in_progress[refresh_all_type];
+
+		for (i = 0; i < n_ifindexes; i++) {
+			nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
+
+			_LOGt_delayed_action (iflags, NULL, "handle (do-request-by-ifindex)");
+
+			nlmsg = _nl_msg_new_dump (refresh_all_info->obj_type,
+			                          refresh_all_info->addr_family,
+			                          ifindexes[i]);
+			if (!nlmsg)
+				continue;
+
+			nm_assert (*out_refresh_all_in_progress >= 0);
+			*out_refresh_all_in_progress += 1;
+			if (_nl_send_nlmsg (platform,
+			                    nlmsg,
+			                    NULL,
+			                    NULL,
+			                    DELAYED_ACTION_RESPONSE_TYPE_REFRESH_ALL_IN_PROGRESS,
+			                    out_refresh_all_in_progress) < 0) {
+				nm_assert (*out_refresh_all_in_progress > 0);
+				*out_refresh_all_in_progress -= 1;
+			}
+		}
+	}
+}
+
+static void
+do_request_one_type_by_needle_object (NMPlatform *platform, const NMPObject *obj_needle)
+{
+	do_request_all_no_delayed_actions (platform, delayed_action_refresh_from_needle_object (obj_needle));
+	delayed_action_handle_all (platform, FALSE);
+}
+
+static void
+event_seq_check_refresh_all (NMPlatform *platform, guint32 seq_number)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	DelayedActionWaitForNlResponseData *data;
+	guint i;
+
+	if (NM_IN_SET (seq_number, 0, priv->nlh_seq_last_seen))
+		return;
+
+	if (NM_FLAGS_HAS (priv->delayed_action.flags, DELAYED_ACTION_TYPE_WAIT_FOR_NL_RESPONSE)) {
+		nm_assert (priv->delayed_action.list_wait_for_nl_response->len > 0);
+
+		for (i = 0; i < priv->delayed_action.list_wait_for_nl_response->len; i++) {
+			data = &g_array_index (priv->delayed_action.list_wait_for_nl_response, DelayedActionWaitForNlResponseData, i);
+
+			if (   data->response_type == DELAYED_ACTION_RESPONSE_TYPE_REFRESH_ALL_IN_PROGRESS
 			    && data->response.out_refresh_all_in_progress
 			    && data->seq_number == priv->nlh_seq_last_seen) {
 				*data->response.out_refresh_all_in_progress -= 1;
@@ -6031,6 +7603,286 @@ event_seq_check (NMPlatform *platform, guint32 seq_number, WaitForNlResponseResu
 #endif
 }
 
+/* A netlink record file starts with NL_RECORD_MAGIC. Then, for each
+ * message follows a NLRecordHeader and the raw netlink message. Like
+ * netlink itself, all integers are in host byte order. */
+#define NL_RECORD_MAGIC "NMNLREC1"
+
+typedef struct {
+	/* nm_utils_get_monotonic_timestamp_ns() of when the message was handled.
+	 * That clock starts with the process, so the timestamps are only
+	 * comparable within one recording. */
+	gint64 timestamp_ns;
+	/* the running number of the record, starting with 1. */
+	guint64 seq;
+	guint32 len;
+	guint32 _reserved;
+} NLRecordHeader;
+
+static void
+_nl_record_msg (NMPlatform *platform, const struct nlmsghdr *msghdr)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	NLRecordHeader rec = {
+		.timestamp_ns = nm_utils_get_monotonic_timestamp_ns (),
+		.seq = ++priv->record.n_records,
+		.len = msghdr->nlmsg_len,
+	};
+
+	if (   fwrite (&rec, sizeof (rec), 1, priv->record.f) != 1
+	    || fwrite (msghdr, msghdr->nlmsg_len, 1, priv->record.f) != 1) {
+		_LOGW ("netlink-record: failure to write message. Stop recording");
+		fclose (priv->record.f);
+		priv->record.f = NULL;
+	}
+}
+
+/* Returns: (transfer full): the BRIDGE_VLAN_STATE_* flags of the VLANs
+ *   in the AF_BRIDGE link message @nlh, indexed by VID. %NULL if the message
+ *   doesn't contain them. */
+static guint8 *
+_bridge_vlans_parse (struct nlmsghdr *nlh)
+{
+	static const struct nla_policy policy[] = {
+		[IFLA_AF_SPEC] = { .type = NLA_NESTED },
+	};
+	struct nlattr *tb[G_N_ELEMENTS (policy)];
+	struct nlattr *attr;
+	guint8 *vlan_states;
+	guint16 range_start = 0;
+	int rem;
+
+	if (nlmsg_parse_arr (nlh, sizeof (struct ifinfomsg), tb, policy) < 0)
+		return NULL;
+
+	if (!tb[IFLA_AF_SPEC])
+		return NULL;
+
+	vlan_states = g_malloc0 (BRIDGE_VLAN_VID_MAX + 1);
+
+	nla_for_each_nested (attr, tb[IFLA_AF_SPEC], rem) {
+		const struct bridge_vlan_info *vinfo;
+		guint16 vid_start;
+		guint8 state;
+		guint vid;
+
+		if (   nla_type (attr) != IFLA_BRIDGE_VLAN_INFO
+		    || nla_len (attr) < sizeof (*vinfo))
+			continue;
+
+		vinfo = nla_data (attr);
+		if (   vinfo->vid < 1
+		    || vinfo->vid > BRIDGE_VLAN_VID_MAX)
+			continue;
+
+		if (NM_FLAGS_HAS (vinfo->flags, BRIDGE_VLAN_INFO_RANGE_BEGIN)) {
+			range_start = vinfo->vid;
+			continue;
+		}
+
+		vid_start = vinfo->vid;
+		if (   NM_FLAGS_HAS (vinfo->flags, BRIDGE_VLAN_INFO_RANGE_END)
+		    && range_start != 0
+		    && range_start < vinfo->vid)
+			vid_start = range_start;
+		range_start = 0;
+
+		state = BRIDGE_VLAN_STATE_PRESENT;
+		if (NM_FLAGS_HAS (vinfo->flags, BRIDGE_VLAN_INFO_UNTAGGED))
+			state |= BRIDGE_VLAN_STATE_UNTAGGED;
+		if (NM_FLAGS_HAS (vinfo->flags, BRIDGE_VLAN_INFO_PVID))
+			state |= BRIDGE_VLAN_STATE_PVID;
+
+		for (vid = vid_start; vid <= vinfo->vid; vid++)
+			vlan_states[vid] = state;
+	}
+
+	return vlan_states;
+}
+
+static void
+_bridge_vlans_invalidate (NMPlatform *platform)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+
+	nm_clear_pointer (&priv->bridge_vlans, g_hash_table_unref);
+}
+
+/* keeps priv->bridge_vlans up to date with the link notification @nlh. */
+static void
+_bridge_vlans_handle_event (NMPlatform *platform,
+                            struct nlmsghdr *nlh)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	const struct ifinfomsg *ifi = nlmsg_data (nlh);
+
+	if (!priv->bridge_vlans)
+		return;
+
+	if (nlh->nlmsg_type == RTM_DELLINK) {
+		/* either the link is gone, or it's no longer a bridge port. */
+		g_hash_table_remove (priv->bridge_vlans, GINT_TO_POINTER (ifi->ifi_index));
+		return;
+	}
+
+	if (ifi->ifi_family != AF_BRIDGE)
+		return;
+
+	/* the notification comes from the bridge, never from a switchdev driver.
+	 * It contains all the VLANs of the port. */
+	g_hash_table_insert (priv->bridge_vlans,
+	                     GINT_TO_POINTER (ifi->ifi_index),
+	                     _bridge_vlans_parse (nlh));
+}
+
+static void
+_sriov_vfs_parse (struct nlmsghdr *nlh,
+                  SriovVfsGetData *data)
+{
+	static const struct nla_policy policy[] = {
+		[IFLA_VFINFO_LIST] = { .type = NLA_NESTED },
+	};
+	struct nlattr *tb[G_N_ELEMENTS (policy)];
+	struct nlattr *attr;
+	int rem;
+
+	if (nlmsg_parse_arr (nlh, sizeof (struct ifinfomsg), tb, policy) < 0)
+		return;
+
+	if (!tb[IFLA_VFINFO_LIST])
+		return;
+
+	nla_for_each_nested (attr, tb[IFLA_VFINFO_LIST], rem) {
+		static const struct nla_policy policy_info[] = {
+			[IFLA_VF_MAC]       = { .minlen = sizeof (struct ifla_vf_mac) },
+			[IFLA_VF_VLAN]      = { .minlen = sizeof (struct ifla_vf_vlan) },
+			[IFLA_VF_SPOOFCHK]  = { .minlen = sizeof (struct _ifla_vf_setting) },
+			[IFLA_VF_RATE]      = { .minlen = sizeof (struct _ifla_vf_rate) },
+			[IFLA_VF_TRUST]     = { .minlen = sizeof (struct _ifla_vf_setting) },
+			[IFLA_VF_VLAN_LIST] = { .type = NLA_NESTED },
+		};
+		struct nlattr *tbi[G_N_ELEMENTS (policy_info)];
+		const struct ifla_vf_mac *ivm;
+		SriovVfState *state;
+
+		if (nla_type (attr) != IFLA_VF_INFO)
+			continue;
+		if (nla_parse_nested_arr (tbi, attr, policy_info) < 0)
+			continue;
+		if (!tbi[IFLA_VF_MAC])
+			continue;
+
+		ivm = nla_data (tbi[IFLA_VF_MAC]);
+		if (ivm->vf >= data->n_vfs)
+			continue;
+
+		state = &data->vfs[ivm->vf];
+		*state = (SriovVfState) {
+			.valid    = TRUE,
+			.spoofchk = -1,
+			.trust    = -1,
+		};
+		memcpy (state->mac, ivm->mac, sizeof (state->mac));
+
+		if (tbi[IFLA_VF_SPOOFCHK]) {
+			const struct _ifla_vf_setting *ivs = nla_data (tbi[IFLA_VF_SPOOFCHK]);
+
+			/* kernel reports -1 if the driver does not support the setting. */
+			if (ivs->setting <= 1)
+				state->spoofchk = ivs->setting;
+		}
+
+		if (tbi[IFLA_VF_TRUST]) {
+			const struct _ifla_vf_setting *ivs = nla_data (tbi[IFLA_VF_TRUST]);
+
+			if (ivs->setting <= 1)
+				state->trust = ivs->setting;
+		}
+
+		if (tbi[IFLA_VF_RATE]) {
+			const struct _ifla_vf_rate *ivr = nla_data (tbi[IFLA_VF_RATE]);
+
+			state->min_tx_rate = ivr->min_tx_rate;
+			state->max_tx_rate = ivr->max_tx_rate;
+		}
+
+		state->vlan_proto = htons (ETH_P_8021Q);
+		if (tbi[IFLA_VF_VLAN_LIST]) {
+			struct nlattr *attr_vlan;
+			int rem_vlan;
+
+			nla_for_each_nested (attr_vlan, tbi[IFLA_VF_VLAN_LIST], rem_vlan) {
+				const struct _ifla_vf_vlan_info *ivvi;
+
+				if (   nla_type (attr_vlan) != IFLA_VF_VLAN_INFO
+				    || nla_len (attr_vlan) < sizeof (*ivvi))
+					continue;
+
+				/* kernel only supports one VLAN per VF. */
+				ivvi = nla_data (attr_vlan);
+				state->vlan = ivvi->vlan;
+				state->qos = ivvi->qos;
+				state->vlan_proto = ivvi->vlan_proto;
+				break;
+			}
+		} else if (tbi[IFLA_VF_VLAN]) {
+			const struct ifla_vf_vlan *ivv = nla_data (tbi[IFLA_VF_VLAN]);
+
+			state->vlan = ivv->vlan;
+			state->qos = ivv->qos;
+		}
+	}
+}
+
+static void
+_link_get_handle_msg (NMPlatform *platform,
+                      struct nlmsghdr *msghdr)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	const struct ifinfomsg *ifi = nlmsg_data (msghdr);
+	guint i;
+
+	for (i = 0; i < priv->delayed_action.list_wait_for_nl_response->len; i++) {
+		DelayedActionWaitForNlResponseData *data = &g_array_index (priv->delayed_action.list_wait_for_nl_response, DelayedActionWaitForNlResponseData, i);
+
+		if (data->seq_number != msghdr->nlmsg_seq)
+			continue;
+
+		switch (data->response_type) {
+		case DELAYED_ACTION_RESPONSE_TYPE_BRIDGE_VLANS_GET: {
+			BridgeVlansGetData *get_data = data->response.out_bridge_vlans_get;
+
+			/* for a port with a switchdev driver, kernel sends a second message with
+			 * the view of the driver. We only care about the first one, from the bridge. */
+			if (   get_data
+			    && ifi->ifi_family == AF_BRIDGE
+			    && ifi->ifi_index > 0
+			    && !g_hash_table_contains (get_data->bridge_vlans, GINT_TO_POINTER (ifi->ifi_index))) {
+				g_hash_table_insert (get_data->bridge_vlans,
+				                     GINT_TO_POINTER (ifi->ifi_index),
+				                     _bridge_vlans_parse (msghdr));
+			}
+			break;
+		}
+		case DELAYED_ACTION_RESPONSE_TYPE_SRIOV_VFS_GET: {
+			SriovVfsGetData *get_data = data->response.out_sriov_vfs_get;
+
+			if (   get_data
+			    && ifi->ifi_family != AF_BRIDGE
+			    && ifi->ifi_index == get_data->ifindex
+			    && !get_data->found) {
+				get_data->found = TRUE;
+				_sriov_vfs_parse (msghdr, get_data);
+			}
+			break;
+		}
+		default:
+			break;
+		}
+		return;
+	}
+}
+
 static void
 event_valid_msg (NMPlatform *platform, struct nl_msg *msg, gboolean handle_events)
 {
@@ -6070,12 +7922,30 @@ event_valid_msg (NMPlatform *platform, struct nl_msg *msg, gboolean handle_event
 	if (!handle_events)
 		return;
 
+	priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	if (priv->record.f)
+		_nl_record_msg (platform, msghdr);
+
+	if (   msghdr->nlmsg_type == RTM_NEWLINK
+	    && NM_FLAGS_HAS (priv->delayed_action.flags, DELAYED_ACTION_TYPE_WAIT_FOR_NL_RESPONSE)
+	    && nlmsg_valid_hdr (msghdr, sizeof (struct ifinfomsg))) {
+		/* the cache tracks neither bridge VLANs nor VFs. But the message
+		 * might be the response to _bridge_vlans_get() or _sriov_vfs_get(). */
+		_link_get_handle_msg (platform, msghdr);
+	}
+
+	if (   priv->bridge_vlans
+	    && NM_IN_SET (msghdr->nlmsg_type, RTM_NEWLINK, RTM_DELLINK)
+	    && nlmsg_valid_hdr (msghdr, sizeof (struct ifinfomsg)))
+		_bridge_vlans_handle_event (platform, msghdr);
+
 	if (NM_IN_SET (msghdr->nlmsg_type, RTM_DELLINK,
 	                                   RTM_DELADDR,
 	                                   RTM_DELROUTE,
 	                                   RTM_DELRULE,
 	                                   RTM_DELQDISC,
-	                                   RTM_DELTFILTER)) {
+	                                   RTM_DELTFILTER,
+	                                   RTM_DELNEXTHOP)) {
 		/* The event notifies about a deleted object. We don't need to initialize all
 		 * fields of the object. */
 		is_del = TRUE;
@@ -6094,7 +7964,8 @@ event_valid_msg (NMPlatform *platform, struct nl_msg *msg, gboolean handle_event
 	                                      RTM_NEWROUTE,
 	                                      RTM_NEWRULE,
 	                                      RTM_NEWQDISC,
-	                                      RTM_NEWTFILTER)) {
+	                                      RTM_NEWTFILTER,
+	                                      RTM_NEWNEXTHOP)) {
 		is_dump = delayed_action_refresh_all_in_progress (platform,
 		                                                  delayed_action_refresh_from_needle_object (obj));
 	}
@@ -6118,6 +7989,7 @@ event_valid_msg (NMPlatform *platform, struct nl_msg *msg, gboolean handle_event
 		case RTM_NEWQDISC:
 		case RTM_NEWRULE:
 		case RTM_NEWTFILTER:
+		case RTM_NEWNEXTHOP:
 			cache_op = nmp_cache_update_netlink (cache, obj, is_dump, &obj_old, &obj_new);
 			if (cache_op != NMP_CACHE_OPS_UNCHANGED) {
 				cache_on_change (platform, cache_op, obj_old, obj_new);
@@ -6136,7 +8008,6 @@ event_valid_msg (NMPlatform *platform, struct nl_msg *msg, gboolean handle_event
 			is_ipv6 = NMP_OBJECT_GET_TYPE (obj) == NMP_OBJECT_TYPE_IP6_ROUTE;
 			if (is_ipv6 || NM_FLAGS_HAS (obj->ip_route.r_rtm_flags, RTM_F_CLONED)) {
 				nm_assert (is_ipv6 || !nmp_object_is_alive (obj));
-				priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
 				if (NM_FLAGS_HAS (priv->delayed_action.flags, DELAYED_ACTION_TYPE_WAIT_FOR_NL_RESPONSE)) {
 					guint i;
 
@@ -6217,6 +8088,7 @@ event_valid_msg (NMPlatform *platform, struct nl_msg *msg, gboolean handle_event
 		case RTM_DELROUTE:
 		case RTM_DELRULE:
 		case RTM_DELTFILTER:
+		case RTM_DELNEXTHOP:
 			cache_op = nmp_cache_remove_netlink (cache, obj, &obj_old, &obj_new);
 			if (cache_op != NMP_CACHE_OPS_UNCHANGED) {
 				cache_on_change (platform, cache_op, obj_old, obj_new);
@@ -6231,6 +8103,223 @@ event_valid_msg (NMPlatform *platform, struct nl_msg *msg, gboolean handle_event
 
 /*****************************************************************************/
 
+/**
+ * nm_linux_platform_record_start:
+ * @platform: the #NMLinuxPlatform
+ * @filename: the file to write
+ * @error: (allow-none): the failure reason
+ *
+ * Starts writing all netlink messages that @platform handles (events
+ * and dump results) to @filename, so that they can later be fed to
+ * nm_linux_platform_replay(). The recording starts with a full dump.
+ * A previous recording is stopped.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean
+nm_linux_platform_record_start (NMPlatform *platform, const char *filename, GError **error)
+{
+	NMLinuxPlatformPrivate *priv;
+	FILE *f;
+
+	g_return_val_if_fail (NM_IS_LINUX_PLATFORM (platform), FALSE);
+	g_return_val_if_fail (filename, FALSE);
+
+	priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+
+	nm_linux_platform_record_stop (platform);
+
+	f = fopen (filename, "we");
+	if (!f) {
+		int errsv = errno;
+
+		g_set_error (error,
+		             NM_UTILS_ERROR,
+		             NM_UTILS_ERROR_UNKNOWN,
+		             "cannot open \"%s\": %s",
+		             filename,
+		             nm_strerror_native (errsv));
+		return FALSE;
+	}
+
+	if (fwrite (NL_RECORD_MAGIC, NM_STRLEN (NL_RECORD_MAGIC), 1, f) != 1) {
+		int errsv = errno;
+
+		fclose (f);
+		g_set_error (error,
+		             NM_UTILS_ERROR,
+		             NM_UTILS_ERROR_UNKNOWN,
+		             "cannot write \"%s\": %s",
+		             filename,
+		             nm_strerror_native (errsv));
+		return FALSE;
+	}
+
+	priv->record.f = f;
+	priv->record.n_records = 0;
+	_LOGD ("netlink-record: start recording to \"%s\"", filename);
+
+	/* the recording starts with a dump of all objects, so that a replay
+	 * starts from the same state. */
+	delayed_action_schedule (platform, DELAYED_ACTION_TYPE_REFRESH_ALL, NULL);
+	if (priv->delayed_action.is_handling == 0)
+		delayed_action_handle_all (platform, FALSE);
+	return TRUE;
+}
+
+/**
+ * nm_linux_platform_record_stop:
+ * @platform: the #NMLinuxPlatform
+ *
+ * Stops a recording started with nm_linux_platform_record_start().
+ */
+void
+nm_linux_platform_record_stop (NMPlatform *platform)
+{
+	NMLinuxPlatformPrivate *priv;
+
+	g_return_if_fail (NM_IS_LINUX_PLATFORM (platform));
+
+	priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+
+	if (!priv->record.f)
+		return;
+
+	_LOGD ("netlink-record: stop recording after %"G_GUINT64_FORMAT" messages", priv->record.n_records);
+	fclose (priv->record.f);
+	priv->record.f = NULL;
+}
+
+/**
+ * nm_linux_platform_replay:
+ * @platform: the #NMLinuxPlatform, created with nm_linux_platform_new_replay()
+ * @filename: a file written by nm_linux_platform_record_start()
+ * @out_n_messages: (allow-none): the number of replayed messages
+ * @error: (allow-none): the failure reason
+ *
+ * Feeds the recorded netlink messages to @platform, as if they were
+ * received from kernel. The messages are handled as fast as possible,
+ * the recorded timestamps are ignored.
+ *
+ * Returns: %TRUE if the entire file was replayed.
+ */
+gboolean
+nm_linux_platform_replay (NMPlatform *platform,
+                          const char *filename,
+                          guint64 *out_n_messages,
+                          GError **error)
+{
+	NMLinuxPlatformPrivate *priv;
+	nm_auto_pop_netns NMPNetns *netns = NULL;
+	gs_free struct nlmsghdr *buf = NULL;
+	gsize buf_len = 0;
+	char magic[NM_STRLEN (NL_RECORD_MAGIC)];
+	guint64 n_messages = 0;
+	gboolean success = FALSE;
+	FILE *f;
+
+	g_return_val_if_fail (NM_IS_LINUX_PLATFORM (platform), FALSE);
+	g_return_val_if_fail (filename, FALSE);
+
+	priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+
+	g_return_val_if_fail (priv->replay, FALSE);
+
+	f = fopen (filename, "re");
+	if (!f) {
+		int errsv = errno;
+
+		g_set_error (error,
+		             NM_UTILS_ERROR,
+		             NM_UTILS_ERROR_UNKNOWN,
+		             "cannot open \"%s\": %s",
+		             filename,
+		             nm_strerror_native (errsv));
+		return FALSE;
+	}
+
+	if (   fread (magic, sizeof (magic), 1, f) != 1
+	    || memcmp (magic, NL_RECORD_MAGIC, sizeof (magic)) != 0) {
+		g_set_error (error,
+		             NM_UTILS_ERROR,
+		             NM_UTILS_ERROR_UNKNOWN,
+		             "\"%s\" is not a netlink record file",
+		             filename);
+		goto out;
+	}
+
+	if (!nm_platform_netns_push (platform, &netns)) {
+		g_set_error_literal (error,
+		                     NM_UTILS_ERROR,
+		                     NM_UTILS_ERROR_UNKNOWN,
+		                     "cannot switch to the namespace of the platform");
+		goto out;
+	}
+
+	for (;;) {
+		nm_auto_nlmsg struct nl_msg *msg = NULL;
+		NLRecordHeader rec;
+
+		if (fread (&rec, sizeof (rec), 1, f) != 1) {
+			if (feof (f))
+				break;
+			g_set_error (error,
+			             NM_UTILS_ERROR,
+			             NM_UTILS_ERROR_UNKNOWN,
+			             "failure reading \"%s\"",
+			             filename);
+			goto out;
+		}
+
+		if (   rec.len < sizeof (struct nlmsghdr)
+		    || rec.len > 64 * 1024 * 1024) {
+			g_set_error (error,
+			             NM_UTILS_ERROR,
+			             NM_UTILS_ERROR_UNKNOWN,
+			             "invalid record #%"G_GUINT64_FORMAT" in \"%s\"",
+			             rec.seq,
+			             filename);
+			goto out;
+		}
+
+		if (rec.len > buf_len) {
+			buf_len = NM_MAX (rec.len, 4096u);
+			g_free (buf);
+			buf = g_malloc (buf_len);
+		}
+
+		if (   fread (buf, rec.len, 1, f) != 1
+		    || buf->nlmsg_len != rec.len) {
+			g_set_error (error,
+			             NM_UTILS_ERROR,
+			             NM_UTILS_ERROR_UNKNOWN,
+			             "truncated record #%"G_GUINT64_FORMAT" in \"%s\"",
+			             rec.seq,
+			             filename);
+			goto out;
+		}
+
+		msg = nlmsg_alloc_convert (buf);
+		nlmsg_set_proto (msg, NETLINK_ROUTE);
+		event_valid_msg (platform, msg, TRUE);
+		n_messages++;
+
+		/* only the cache-internal delayed actions are scheduled in replay
+		 * mode, see delayed_action_schedule(). */
+		delayed_action_handle_all (platform, FALSE);
+	}
+
+	_LOGD ("netlink-replay: replayed %"G_GUINT64_FORMAT" messages from \"%s\"", n_messages, filename);
+	success = TRUE;
+
+out:
+	fclose (f);
+	NM_SET_OUT (out_n_messages, n_messages);
+	return success;
+}
+
+/*****************************************************************************/
+
 static int
 do_add_link_with_lookup (NMPlatform *platform,
                          NMLinkType link_type,
@@ -6290,7 +8379,8 @@ do_add_addrroute (NMPlatform *platform,
 
 	nm_assert (NM_IN_SET (NMP_OBJECT_GET_TYPE (obj_id),
 	                      NMP_OBJECT_TYPE_IP4_ADDRESS, NMP_OBJECT_TYPE_IP6_ADDRESS,
-	                      NMP_OBJECT_TYPE_IP4_ROUTE, NMP_OBJECT_TYPE_IP6_ROUTE));
+	                      NMP_OBJECT_TYPE_IP4_ROUTE, NMP_OBJECT_TYPE_IP6_ROUTE,
+	                      NMP_OBJECT_TYPE_IP4_NEXTHOP, NMP_OBJECT_TYPE_IP6_NEXTHOP));
 
 	event_handler_read_netlink (platform, FALSE);
 
@@ -6333,14 +8423,40 @@ do_add_addrroute (NMPlatform *platform,
 }
 
 static gboolean
-do_delete_object (NMPlatform *platform, const NMPObject *obj_id, struct nl_msg *nlmsg)
+_delete_object_result_is_success (const NMPObject *obj_id,
+                                  WaitForNlResponseResult seq_result,
+                                  const char **out_log_detail)
 {
-	WaitForNlResponseResult seq_result = WAIT_FOR_NL_RESPONSE_RESULT_UNKNOWN;
+	const char *log_detail = "";
+	gboolean success = TRUE;
+
+	if (seq_result == WAIT_FOR_NL_RESPONSE_RESULT_RESPONSE_OK) {
+		/* ok */
+	} else if (NM_IN_SET (-((int) seq_result), ESRCH, ENOENT))
+		log_detail = ", meaning the object was already removed";
+	else if (   NM_IN_SET (-((int) seq_result), ENXIO)
+	         && NM_IN_SET (NMP_OBJECT_GET_TYPE (obj_id), NMP_OBJECT_TYPE_IP6_ADDRESS)) {
+		/* On RHEL7 kernel, deleting a non existing address fails with ENXIO */
+		log_detail = ", meaning the address was already removed";
+	} else if (   NM_IN_SET (-((int) seq_result), EADDRNOTAVAIL)
+	           && NM_IN_SET (NMP_OBJECT_GET_TYPE (obj_id), NMP_OBJECT_TYPE_IP4_ADDRESS, NMP_OBJECT_TYPE_IP6_ADDRESS))
+		log_detail = ", meaning the address was already removed";
+	else
+		success = FALSE;
+
+	*out_log_detail = log_detail;
+	return success;
+}
+
+static gboolean
+do_delete_object (NMPlatform *platform, const NMPObject *obj_id, struct nl_msg *nlmsg)
+{
+	WaitForNlResponseResult seq_result = WAIT_FOR_NL_RESPONSE_RESULT_UNKNOWN;
 	gs_free char *errmsg = NULL;
 	int nle;
 	char s_buf[256];
 	gboolean success;
-	const char *log_detail = "";
+	const char *log_detail;
 
 	event_handler_read_netlink (platform, FALSE);
 
@@ -6357,20 +8473,7 @@ do_delete_object (NMPlatform *platform, const NMPObject *obj_id, struct nl_msg *
 
 	nm_assert (seq_result);
 
-	success = TRUE;
-	if (seq_result == WAIT_FOR_NL_RESPONSE_RESULT_RESPONSE_OK) {
-		/* ok */
-	} else if (NM_IN_SET (-((int) seq_result), ESRCH, ENOENT))
-		log_detail = ", meaning the object was already removed";
-	else if (   NM_IN_SET (-((int) seq_result), ENXIO)
-	         && NM_IN_SET (NMP_OBJECT_GET_TYPE (obj_id), NMP_OBJECT_TYPE_IP6_ADDRESS)) {
-		/* On RHEL7 kernel, deleting a non existing address fails with ENXIO */
-		log_detail = ", meaning the address was already removed";
-	} else if (   NM_IN_SET (-((int) seq_result), EADDRNOTAVAIL)
-	           && NM_IN_SET (NMP_OBJECT_GET_TYPE (obj_id), NMP_OBJECT_TYPE_IP4_ADDRESS, NMP_OBJECT_TYPE_IP6_ADDRESS))
-		log_detail = ", meaning the address was already removed";
-	else
-		success = FALSE;
+	success = _delete_object_result_is_success (obj_id, seq_result, &log_detail);
 
 	_NMLOG (success ? LOGL_DEBUG : LOGL_WARN,
 	        "do-delete-%s[%s]: %s%s",
@@ -6397,6 +8500,97 @@ do_delete_object (NMPlatform *platform, const NMPObject *obj_id, struct nl_msg *
 	return success;
 }
 
+/**
+ * do_addrroute_batch:
+ * @platform:
+ * @obj_ids: the objects for which the requests in @nlmsgs are. They
+ *   are only used for logging.
+ * @nlmsgs: the RTM_NEWROUTE or RTM_DELROUTE requests.
+ * @len: the number of requests.
+ * @is_delete: whether the requests are to delete objects.
+ * @suppress_netlink_failure: only log failures at debug level.
+ * @out_results: (allow-none): array of length @len, receives the
+ *   result for each request, like do_add_addrroute() would return it.
+ *
+ * Sends the requests using _nl_send_nlmsg_batch() and waits for the responses
+ * once per batch. That way, configuring many routes costs one round trip per
+ * batch, instead of one per route.
+ */
+static void
+do_addrroute_batch (NMPlatform *platform,
+                    const NMPObject *const*obj_ids,
+                    struct nl_msg *const*nlmsgs,
+                    guint len,
+                    gboolean is_delete,
+                    gboolean suppress_netlink_failure,
+                    int *out_results)
+{
+	gs_free WaitForNlResponseResult *seq_results = NULL;
+	gs_free char **errmsgs = NULL;
+	char s_buf[256];
+	guint i, j;
+	int n;
+
+	nm_assert (len > 0);
+
+	seq_results = g_new0 (WaitForNlResponseResult, len);
+	errmsgs = g_new0 (char *, len);
+
+	for (i = 0; i < len; ) {
+		nm_assert (NM_IN_SET (NMP_OBJECT_GET_TYPE (obj_ids[i]),
+		                      NMP_OBJECT_TYPE_IP4_ROUTE, NMP_OBJECT_TYPE_IP6_ROUTE));
+
+		event_handler_read_netlink (platform, FALSE);
+
+		n = _nl_send_nlmsg_batch (platform, &nlmsgs[i], len - i, &seq_results[i], &errmsgs[i]);
+		if (n < 0) {
+			/* fail only the first message, and try the remaining ones again. */
+			_LOGE ("do-%s-%s[%s]: failure sending netlink request \"%s\" (%d)",
+			       is_delete ? "delete" : "add",
+			       NMP_OBJECT_GET_CLASS (obj_ids[i])->obj_type_name,
+			       nmp_object_to_string (obj_ids[i], NMP_OBJECT_TO_STRING_ID, NULL, 0),
+			       nm_strerror (n), -n);
+			if (out_results)
+				out_results[i] = -NME_PL_NETLINK;
+			i++;
+			continue;
+		}
+
+		nm_assert (n > 0 && (guint) n <= len - i);
+
+		delayed_action_handle_all (platform, FALSE);
+
+		for (j = i; j < i + n; j++) {
+			const char *log_detail = "";
+			gboolean success;
+
+			nm_assert (seq_results[j]);
+
+			if (is_delete)
+				success = _delete_object_result_is_success (obj_ids[j], seq_results[j], &log_detail);
+			else {
+				success =    seq_results[j] == WAIT_FOR_NL_RESPONSE_RESULT_RESPONSE_OK
+				          || (   suppress_netlink_failure
+				              && seq_results[j] < 0);
+			}
+
+			_NMLOG (success ? LOGL_DEBUG : LOGL_WARN,
+			        "do-%s-%s[%s]: %s%s",
+			        is_delete ? "delete" : "add",
+			        NMP_OBJECT_GET_CLASS (obj_ids[j])->obj_type_name,
+			        nmp_object_to_string (obj_ids[j], NMP_OBJECT_TO_STRING_ID, NULL, 0),
+			        wait_for_nl_response_to_string (seq_results[j], errmsgs[j], s_buf, sizeof (s_buf)),
+			        log_detail);
+
+			if (out_results)
+				out_results[j] = wait_for_nl_response_to_nmerr (seq_results[j]);
+			nm_clear_g_free (&errmsgs[j]);
+		}
+
+		i += n;
+	}
+}
+
 static int
 do_change_link (NMPlatform *platform,
                 ChangeLinkType change_link_type,
@@ -6586,107 +8780,685 @@ link_change_flags (NMPlatform *platform,
 	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
 	char s_flags[100];
 
-	_LOGD ("link: change %d: flags: set 0x%x/0x%x ([%s] / [%s])",
-	       ifindex,
-	       flags_set,
-	       flags_mask,
-	       nm_platform_link_flags2str (flags_set, s_flags, sizeof (s_flags)),
-	       nm_platform_link_flags2str (flags_mask, NULL, 0));
+	_LOGD ("link: change %d: flags: set 0x%x/0x%x ([%s] / [%s])",
+	       ifindex,
+	       flags_set,
+	       flags_mask,
+	       nm_platform_link_flags2str (flags_set, s_flags, sizeof (s_flags)),
+	       nm_platform_link_flags2str (flags_mask, NULL, 0));
+
+	nlmsg = _nl_msg_new_link_full (RTM_NEWLINK,
+	                               0,
+	                               ifindex,
+	                               NULL,
+	                               AF_UNSPEC,
+	                               flags_mask,
+	                               flags_set);
+	if (!nlmsg)
+		return -NME_UNSPEC;
+	return do_change_link (platform, CHANGE_LINK_TYPE_UNSPEC, ifindex, nlmsg, NULL);
+}
+
+static gboolean
+link_set_up (NMPlatform *platform, int ifindex, gboolean *out_no_firmware)
+{
+	int r;
+
+	r = link_change_flags (platform, ifindex, IFF_UP, IFF_UP);
+	NM_SET_OUT (out_no_firmware, (r == -NME_PL_NO_FIRMWARE));
+	return r >= 0;
+}
+
+static gboolean
+link_set_down (NMPlatform *platform, int ifindex)
+{
+	return (link_change_flags (platform, ifindex, IFF_UP, 0) >= 0);
+}
+
+static gboolean
+link_set_arp (NMPlatform *platform, int ifindex)
+{
+	return (link_change_flags (platform, ifindex, IFF_NOARP, 0) >= 0);
+}
+
+static gboolean
+link_set_noarp (NMPlatform *platform, int ifindex)
+{
+	return (link_change_flags (platform, ifindex, IFF_NOARP, IFF_NOARP) >= 0);
+}
+
+static const char *
+link_get_udi (NMPlatform *platform, int ifindex)
+{
+	const NMPObject *obj = nm_platform_link_get_obj (platform, ifindex, TRUE);
+
+	if (   !obj
+	    || !obj->_link.netlink.is_in_netlink
+	    || !obj->_link.udev.device)
+		return NULL;
+	return udev_device_get_syspath (obj->_link.udev.device);
+}
+
+static int
+link_set_user_ipv6ll_enabled (NMPlatform *platform, int ifindex, gboolean enabled)
+{
+	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
+	guint8 mode = enabled ? NM_IN6_ADDR_GEN_MODE_NONE : NM_IN6_ADDR_GEN_MODE_EUI64;
+
+	_LOGD ("link: change %d: user-ipv6ll: set IPv6 address generation mode to %s",
+	       ifindex,
+	       nm_platform_link_inet6_addrgenmode2str (mode, NULL, 0));
+
+	if (!nm_platform_kernel_support_get (NM_PLATFORM_KERNEL_SUPPORT_TYPE_USER_IPV6LL)) {
+		_LOGD ("link: change %d: user-ipv6ll: not supported", ifindex);
+		return -NME_PL_OPNOTSUPP;
+	}
+
+	nlmsg = _nl_msg_new_link (RTM_NEWLINK,
+	                          0,
+	                          ifindex,
+	                          NULL);
+	if (   !nlmsg
+	    || !_nl_msg_new_link_set_afspec (nlmsg, mode, NULL))
+		g_return_val_if_reached (-NME_BUG);
+
+	return do_change_link (platform, CHANGE_LINK_TYPE_UNSPEC, ifindex, nlmsg, NULL);
+}
+
+static gboolean
+link_set_token (NMPlatform *platform, int ifindex, NMUtilsIPv6IfaceId iid)
+{
+	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
+	char sbuf[NM_UTILS_INET_ADDRSTRLEN];
+
+	_LOGD ("link: change %d: token: set IPv6 address generation token to %s",
+	       ifindex, nm_utils_inet6_interface_identifier_to_token (iid, sbuf));
+
+	nlmsg = _nl_msg_new_link (RTM_NEWLINK, 0, ifindex, NULL);
+	if (!nlmsg || !_nl_msg_new_link_set_afspec (nlmsg, -1, &iid))
+		g_return_val_if_reached (FALSE);
+
+	return (do_change_link (platform, CHANGE_LINK_TYPE_UNSPEC, ifindex, nlmsg, NULL) >= 0);
+}
+
+/*****************************************************************************/
+
+static int
+_ethtool_get_family_id (NMPlatform *platform)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	struct nl_sock *genl;
+	int ethtool_family_id;
+
+	if (priv->ethtool_family_id >= 0)
+		return priv->ethtool_family_id;
+
+	genl = _genl_sock (NM_LINUX_PLATFORM (platform));
+	if (!genl)
+		return 0;
+
+	ethtool_family_id = genl_ctrl_resolve (genl, ETHTOOL_GENL_NAME);
+	if (ethtool_family_id > 0) {
+		priv->ethtool_family_id = ethtool_family_id;
+		return ethtool_family_id;
+	}
+
+	if (ethtool_family_id == -ENOENT) {
+		/* kernels before 5.6 only have the ioctl API. Remember that, so that
+		 * we don't resolve the family again for each request. */
+		_LOGD ("ethtool: netlink API not supported by kernel, use ioctl");
+		priv->ethtool_family_id = 0;
+	}
+	return 0;
+}
+
+static struct nl_msg *
+_ethtool_msg_new (int ethtool_family_id,
+                  guint8 cmd,
+                  int header_attr,
+                  int ifindex,
+                  guint32 header_flags)
+{
+	nm_auto_nlmsg struct nl_msg *msg = NULL;
+	struct nlattr *nest;
+
+	msg = nlmsg_alloc ();
+
+	if (!genlmsg_put (msg,
+	                  NL_AUTO_PORT,
+	                  NL_AUTO_SEQ,
+	                  ethtool_family_id,
+	                  0,
+	                  0,
+	                  cmd,
+	                  ETHTOOL_GENL_VERSION))
+		goto nla_put_failure;
+
+	if (ifindex > 0) {
+		nest = nla_nest_start (msg, header_attr);
+		if (!nest)
+			goto nla_put_failure;
+		NLA_PUT_U32 (msg, ETHTOOL_A_HEADER_DEV_INDEX, ifindex);
+		if (header_flags)
+			NLA_PUT_U32 (msg, ETHTOOL_A_HEADER_FLAGS, header_flags);
+		nla_nest_end (msg, nest);
+	}
+
+	return g_steal_pointer (&msg);
+
+nla_put_failure:
+	g_return_val_if_reached (NULL);
+}
+
+static int
+_ethtool_request (NMPlatform *platform,
+                  struct nl_msg *msg,
+                  int (*valid_cb) (struct nl_msg *, void *),
+                  gpointer valid_arg)
+{
+	struct nl_sock *genl = _genl_sock (NM_LINUX_PLATFORM (platform));
+	int r;
+
+	r = nl_send_auto (genl, msg);
+	if (r >= 0 && valid_cb) {
+		r = nl_recvmsgs (genl,
+		                 &((const struct nl_cb) {
+		                     .valid_cb  = valid_cb,
+		                     .valid_arg = valid_arg,
+		                 }));
+	}
+	if (r >= 0)
+		r = nl_wait_for_ack (genl, NULL);
+	return r;
+}
+
+static gboolean
+_ethtool_bitset_parse (const struct nlattr *nla,
+                       guint32 *words,
+                       guint n_words)
+{
+	static const struct nla_policy policy[] = {
+		[ETHTOOL_A_BITSET_NOMASK] = { .type = NLA_FLAG },
+		[ETHTOOL_A_BITSET_SIZE]   = { .type = NLA_U32 },
+		[ETHTOOL_A_BITSET_VALUE]  = { .type = NLA_UNSPEC },
+	};
+	struct nlattr *tb[G_N_ELEMENTS (policy)];
+	gsize len;
+
+	memset (words, 0, n_words * sizeof (guint32));
+
+	if (!nla)
+		return FALSE;
+
+	if (nla_parse_nested_arr (tb, nla, policy) < 0)
+		return FALSE;
+
+	/* we request compact bitsets, where the value is an array of
+	 * 32 bit words in host order. */
+	if (!tb[ETHTOOL_A_BITSET_VALUE])
+		return FALSE;
+
+	len = MIN ((gsize) nla_len (tb[ETHTOOL_A_BITSET_VALUE]), n_words * sizeof (guint32));
+	memcpy (words, nla_data (tb[ETHTOOL_A_BITSET_VALUE]), len);
+	return TRUE;
+}
+
+static int
+_ethtool_ss_features_get_cb (struct nl_msg *msg, void *arg)
+{
+	static const struct nla_policy policy[] = {
+		[ETHTOOL_A_STRSET_STRINGSETS] = { .type = NLA_NESTED },
+	};
+	static const struct nla_policy policy_set[] = {
+		[ETHTOOL_A_STRINGSET_ID]      = { .type = NLA_U32 },
+		[ETHTOOL_A_STRINGSET_COUNT]   = { .type = NLA_U32 },
+		[ETHTOOL_A_STRINGSET_STRINGS] = { .type = NLA_NESTED },
+	};
+	static const struct nla_policy policy_string[] = {
+		[ETHTOOL_A_STRING_INDEX] = { .type = NLA_U32 },
+		[ETHTOOL_A_STRING_VALUE] = { .type = NLA_STRING },
+	};
+	struct nlattr *tb[G_N_ELEMENTS (policy)];
+	GPtrArray **p_names = arg;
+	struct nlattr *attr_set;
+	int rem_set;
+
+	if (genlmsg_parse_arr (nlmsg_hdr (msg), 0, tb, policy) < 0)
+		return NL_SKIP;
+
+	if (!tb[ETHTOOL_A_STRSET_STRINGSETS])
+		return NL_SKIP;
+
+	nla_for_each_nested (attr_set, tb[ETHTOOL_A_STRSET_STRINGSETS], rem_set) {
+		struct nlattr *tb_set[G_N_ELEMENTS (policy_set)];
+		GPtrArray *names;
+		struct nlattr *attr_string;
+		int rem_string;
+		guint32 count;
+		guint i;
+
+		if (nla_type (attr_set) != ETHTOOL_A_STRINGSETS_STRINGSET)
+			continue;
+		if (nla_parse_nested_arr (tb_set, attr_set, policy_set) < 0)
+			continue;
+		if (   !tb_set[ETHTOOL_A_STRINGSET_ID]
+		    || nla_get_u32 (tb_set[ETHTOOL_A_STRINGSET_ID]) != ETH_SS_FEATURES
+		    || !tb_set[ETHTOOL_A_STRINGSET_COUNT]
+		    || !tb_set[ETHTOOL_A_STRINGSET_STRINGS])
+			continue;
+
+		count = nla_get_u32 (tb_set[ETHTOOL_A_STRINGSET_COUNT]);
+		if (count == 0 || count > 1024)
+			continue;
+
+		names = g_ptr_array_new_full (count + 1, g_free);
+		g_ptr_array_set_size (names, count);
+
+		nla_for_each_nested (attr_string, tb_set[ETHTOOL_A_STRINGSET_STRINGS], rem_string) {
+			struct nlattr *tb_string[G_N_ELEMENTS (policy_string)];
+			guint32 idx;
+
+			if (nla_parse_nested_arr (tb_string, attr_string, policy_string) < 0)
+				continue;
+			if (   !tb_string[ETHTOOL_A_STRING_INDEX]
+			    || !tb_string[ETHTOOL_A_STRING_VALUE])
+				continue;
+
+			idx = nla_get_u32 (tb_string[ETHTOOL_A_STRING_INDEX]);
+			if (   idx >= count
+			    || names->pdata[idx])
+				continue;
+			names->pdata[idx] = g_strdup (nla_get_string (tb_string[ETHTOOL_A_STRING_VALUE]));
+		}
+
+		/* fill gaps, so that the result is a complete strv. */
+		for (i = 0; i < count; i++) {
+			if (!names->pdata[i])
+				names->pdata[i] = g_strdup ("");
+		}
+		g_ptr_array_add (names, NULL);
+
+		nm_clear_pointer (p_names, g_ptr_array_unref);
+		*p_names = names;
+		return NL_STOP;
+	}
+
+	return NL_SKIP;
+}
+
+static const char *const*
+_ethtool_ss_features_get (NMPlatform *platform,
+                          int ethtool_family_id,
+                          guint *out_len)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	nm_auto_nlmsg struct nl_msg *msg = NULL;
+	gs_unref_ptrarray GPtrArray *names = NULL;
+	struct nlattr *nest_sets;
+	struct nlattr *nest_set;
+	int r;
+
+	/* the names of the features are compiled into kernel and don't change.
+	 * Fetch them only once. */
+	if (priv->ethtool_ss_features) {
+		*out_len = priv->ethtool_ss_features_len;
+		return (const char *const*) priv->ethtool_ss_features;
+	}
+
+	msg = _ethtool_msg_new (ethtool_family_id,
+	                        ETHTOOL_MSG_STRSET_GET,
+	                        ETHTOOL_A_STRSET_HEADER,
+	                        0,
+	                        0);
+	if (!msg)
+		g_return_val_if_reached (NULL);
+
+	nest_sets = nla_nest_start (msg, ETHTOOL_A_STRSET_STRINGSETS);
+	if (!nest_sets)
+		goto nla_put_failure;
+	nest_set = nla_nest_start (msg, ETHTOOL_A_STRINGSETS_STRINGSET);
+	if (!nest_set)
+		goto nla_put_failure;
+	NLA_PUT_U32 (msg, ETHTOOL_A_STRINGSET_ID, ETH_SS_FEATURES);
+	nla_nest_end (msg, nest_set);
+	nla_nest_end (msg, nest_sets);
+
+	r = _ethtool_request (platform, msg, _ethtool_ss_features_get_cb, &names);
+	if (r < 0 || !names) {
+		_LOGD ("ethtool: failure to get the feature names: %s",
+		       r < 0 ? nm_strerror (r) : "missing in reply");
+		return NULL;
+	}
+
+	priv->ethtool_ss_features_len = names->len - 1;
+	priv->ethtool_ss_features = (char **) g_ptr_array_free (g_steal_pointer (&names), FALSE);
+
+	*out_len = priv->ethtool_ss_features_len;
+	return (const char *const*) priv->ethtool_ss_features;
+
+nla_put_failure:
+	g_return_val_if_reached (NULL);
+}
+
+typedef struct {
+	guint n_blocks;
+	NMPUtilsEthtoolFeatureBlock *blocks;
+	bool has_reply:1;
+} EthtoolFeaturesGetData;
+
+static int
+_ethtool_features_get_cb (struct nl_msg *msg, void *arg)
+{
+	static const struct nla_policy policy[] = {
+		[ETHTOOL_A_FEATURES_HW]       = { .type = NLA_NESTED },
+		[ETHTOOL_A_FEATURES_WANTED]   = { .type = NLA_NESTED },
+		[ETHTOOL_A_FEATURES_ACTIVE]   = { .type = NLA_NESTED },
+		[ETHTOOL_A_FEATURES_NOCHANGE] = { .type = NLA_NESTED },
+	};
+	struct nlattr *tb[G_N_ELEMENTS (policy)];
+	EthtoolFeaturesGetData *data = arg;
+	guint32 *words;
+	guint i;
+
+	if (genlmsg_parse_arr (nlmsg_hdr (msg), 0, tb, policy) < 0)
+		return NL_SKIP;
+
+	words = g_alloca (data->n_blocks * sizeof (guint32));
+
+	if (!_ethtool_bitset_parse (tb[ETHTOOL_A_FEATURES_HW], words, data->n_blocks))
+		return NL_SKIP;
+	for (i = 0; i < data->n_blocks; i++)
+		data->blocks[i].available = words[i];
+
+	_ethtool_bitset_parse (tb[ETHTOOL_A_FEATURES_WANTED], words, data->n_blocks);
+	for (i = 0; i < data->n_blocks; i++)
+		data->blocks[i].requested = words[i];
+
+	_ethtool_bitset_parse (tb[ETHTOOL_A_FEATURES_ACTIVE], words, data->n_blocks);
+	for (i = 0; i < data->n_blocks; i++)
+		data->blocks[i].active = words[i];
+
+	_ethtool_bitset_parse (tb[ETHTOOL_A_FEATURES_NOCHANGE], words, data->n_blocks);
+	for (i = 0; i < data->n_blocks; i++)
+		data->blocks[i].never_changed = words[i];
+
+	data->has_reply = TRUE;
+	return NL_STOP;
+}
+
+static NMEthtoolFeatureStates *
+ethtool_get_features (NMPlatform *platform, int ifindex)
+{
+	nm_auto_nlmsg struct nl_msg *msg = NULL;
+	gs_free NMPUtilsEthtoolFeatureBlock *blocks_free = NULL;
+	const char *const*ss_features;
+	guint n_ss_features;
+	EthtoolFeaturesGetData data;
+	NMEthtoolFeatureStates *features;
+	int ethtool_family_id;
+	int r;
+
+	ethtool_family_id = _ethtool_get_family_id (platform);
+	if (ethtool_family_id <= 0)
+		return nmp_utils_ethtool_get_features (ifindex);
+
+	ss_features = _ethtool_ss_features_get (platform, ethtool_family_id, &n_ss_features);
+	if (!ss_features)
+		return nmp_utils_ethtool_get_features (ifindex);
+
+	/* all features of the device are returned by one request, the compact
+	 * bitsets have the same layout as the ETHTOOL_GFEATURES blocks. */
+	data = (EthtoolFeaturesGetData) {
+		.n_blocks = NM_DIV_ROUND_UP (n_ss_features, 32u),
+	};
+	data.blocks = nm_malloc0_maybe_a (300,
+	                                  data.n_blocks * sizeof (NMPUtilsEthtoolFeatureBlock),
+	                                  &blocks_free);
+
+	msg = _ethtool_msg_new (ethtool_family_id,
+	                        ETHTOOL_MSG_FEATURES_GET,
+	                        ETHTOOL_A_FEATURES_HEADER,
+	                        ifindex,
+	                        ETHTOOL_FLAG_COMPACT_BITSETS);
+	if (!msg)
+		g_return_val_if_reached (NULL);
+
+	r = _ethtool_request (platform, msg, _ethtool_features_get_cb, &data);
+	if (r == -EOPNOTSUPP)
+		return nmp_utils_ethtool_get_features (ifindex);
+	if (r < 0 || !data.has_reply) {
+		_LOGT ("ethtool[%d]: get-features: failure getting features (%s)",
+		       ifindex,
+		       r < 0 ? nm_strerror (r) : "missing in reply");
+		return NULL;
+	}
+
+	features = nmp_utils_ethtool_features_new (n_ss_features, ss_features, data.blocks);
+	if (!features) {
+		_LOGT ("ethtool[%d]: get-features: failure getting features",
+		       ifindex);
+		return NULL;
+	}
+
+	_LOGT ("ethtool[%d]: get-features: retrieved kernel features",
+	       ifindex);
+	return features;
+}
+
+static gboolean
+ethtool_set_features (NMPlatform *platform,
+                      int ifindex,
+                      const NMEthtoolFeatureStates *features,
+                      const NMTernary *requested,
+                      gboolean do_set)
+{
+	nm_auto_nlmsg struct nl_msg *msg = NULL;
+	gs_free guint32 *bits_free = NULL;
+	struct nlattr *nest;
+	guint32 *valid;
+	guint32 *wanted;
+	guint n_blocks;
+	gboolean success;
+	int ethtool_family_id;
+	int r;
+
+	ethtool_family_id = _ethtool_get_family_id (platform);
+	if (ethtool_family_id <= 0)
+		return nmp_utils_ethtool_set_features (ifindex, features, requested, do_set);
+
+	n_blocks = NM_DIV_ROUND_UP (features->n_ss_features, 32u);
+	valid = nm_malloc0_maybe_a (300, 2u * n_blocks * sizeof (guint32), &bits_free);
+	wanted = &valid[n_blocks];
+
+	if (nmp_utils_ethtool_features_prepare_set (ifindex,
+	                                            features,
+	                                            requested,
+	                                            do_set,
+	                                            valid,
+	                                            wanted,
+	                                            &success) == 0) {
+		_LOGT ("ethtool[%d]: set-features: no feature requested",
+		       ifindex);
+		return TRUE;
+	}
+
+	/* all changes are sent with one request. Kernel only touches the features
+	 * in the mask. */
+	msg = _ethtool_msg_new (ethtool_family_id,
+	                        ETHTOOL_MSG_FEATURES_SET,
+	                        ETHTOOL_A_FEATURES_HEADER,
+	                        ifindex,
+	                        ETHTOOL_FLAG_OMIT_REPLY);
+	if (!msg)
+		g_return_val_if_reached (FALSE);
+
+	nest = nla_nest_start (msg, ETHTOOL_A_FEATURES_WANTED);
+	if (!nest)
+		goto nla_put_failure;
+	NLA_PUT_U32 (msg, ETHTOOL_A_BITSET_SIZE, features->n_ss_features);
+	NLA_PUT (msg, ETHTOOL_A_BITSET_VALUE, n_blocks * sizeof (guint32), wanted);
+	NLA_PUT (msg, ETHTOOL_A_BITSET_MASK, n_blocks * sizeof (guint32), valid);
+	nla_nest_end (msg, nest);
+
+	r = _ethtool_request (platform, msg, NULL, NULL);
+	if (r == -EOPNOTSUPP)
+		return nmp_utils_ethtool_set_features (ifindex, features, requested, do_set);
+	if (r < 0) {
+		_LOGT ("ethtool[%d]: set-features: failure setting features (%s)",
+		       ifindex,
+		       nm_strerror (r));
+		return FALSE;
+	}
+
+	_LOGT ("ethtool[%d]: set-features: %s",
+	       ifindex,
+	       success
+	         ? "successfully setting features"
+	         : "at least some of the features were not successfully set");
+	return success;
+
+nla_put_failure:
+	g_return_val_if_reached (FALSE);
+}
+
+typedef struct {
+	int autoneg;
+	guint32 speed;
+	int duplex;
+	bool has_reply:1;
+} EthtoolLinkModesGetData;
+
+static int
+_ethtool_linkmodes_get_cb (struct nl_msg *msg, void *arg)
+{
+	static const struct nla_policy policy[] = {
+		[ETHTOOL_A_LINKMODES_AUTONEG] = { .type = NLA_U8 },
+		[ETHTOOL_A_LINKMODES_SPEED]   = { .type = NLA_U32 },
+		[ETHTOOL_A_LINKMODES_DUPLEX]  = { .type = NLA_U8 },
+	};
+	struct nlattr *tb[G_N_ELEMENTS (policy)];
+	EthtoolLinkModesGetData *data = arg;
+
+	if (genlmsg_parse_arr (nlmsg_hdr (msg), 0, tb, policy) < 0)
+		return NL_SKIP;
 
-	nlmsg = _nl_msg_new_link_full (RTM_NEWLINK,
-	                               0,
-	                               ifindex,
-	                               NULL,
-	                               AF_UNSPEC,
-	                               flags_mask,
-	                               flags_set);
-	if (!nlmsg)
-		return -NME_UNSPEC;
-	return do_change_link (platform, CHANGE_LINK_TYPE_UNSPEC, ifindex, nlmsg, NULL);
+	if (tb[ETHTOOL_A_LINKMODES_AUTONEG])
+		data->autoneg = nla_get_u8 (tb[ETHTOOL_A_LINKMODES_AUTONEG]);
+	if (tb[ETHTOOL_A_LINKMODES_SPEED])
+		data->speed = nla_get_u32 (tb[ETHTOOL_A_LINKMODES_SPEED]);
+	if (tb[ETHTOOL_A_LINKMODES_DUPLEX])
+		data->duplex = nla_get_u8 (tb[ETHTOOL_A_LINKMODES_DUPLEX]);
+
+	data->has_reply = TRUE;
+	return NL_STOP;
 }
 
 static gboolean
-link_set_up (NMPlatform *platform, int ifindex, gboolean *out_no_firmware)
+ethtool_get_link_settings (NMPlatform *platform,
+                           int ifindex,
+                           gboolean *out_autoneg,
+                           guint32 *out_speed,
+                           NMPlatformLinkDuplexType *out_duplex)
 {
+	nm_auto_nlmsg struct nl_msg *msg = NULL;
+	EthtoolLinkModesGetData data = {
+		.autoneg = AUTONEG_DISABLE,
+		.speed   = SPEED_UNKNOWN,
+		.duplex  = DUPLEX_UNKNOWN,
+	};
+	int ethtool_family_id;
 	int r;
 
-	r = link_change_flags (platform, ifindex, IFF_UP, IFF_UP);
-	NM_SET_OUT (out_no_firmware, (r == -NME_PL_NO_FIRMWARE));
-	return r >= 0;
-}
+	ethtool_family_id = _ethtool_get_family_id (platform);
+	if (ethtool_family_id <= 0)
+		return nmp_utils_ethtool_get_link_settings (ifindex, out_autoneg, out_speed, out_duplex);
 
-static gboolean
-link_set_down (NMPlatform *platform, int ifindex)
-{
-	return (link_change_flags (platform, ifindex, IFF_UP, 0) >= 0);
-}
+	msg = _ethtool_msg_new (ethtool_family_id,
+	                        ETHTOOL_MSG_LINKMODES_GET,
+	                        ETHTOOL_A_LINKMODES_HEADER,
+	                        ifindex,
+	                        ETHTOOL_FLAG_COMPACT_BITSETS);
+	if (!msg)
+		g_return_val_if_reached (FALSE);
 
-static gboolean
-link_set_arp (NMPlatform *platform, int ifindex)
-{
-	return (link_change_flags (platform, ifindex, IFF_NOARP, 0) >= 0);
-}
+	r = _ethtool_request (platform, msg, _ethtool_linkmodes_get_cb, &data);
+	if (r == -EOPNOTSUPP)
+		return nmp_utils_ethtool_get_link_settings (ifindex, out_autoneg, out_speed, out_duplex);
+	if (r < 0 || !data.has_reply)
+		return FALSE;
 
-static gboolean
-link_set_noarp (NMPlatform *platform, int ifindex)
-{
-	return (link_change_flags (platform, ifindex, IFF_NOARP, IFF_NOARP) >= 0);
-}
+	NM_SET_OUT (out_autoneg, (data.autoneg == AUTONEG_ENABLE));
 
-static const char *
-link_get_udi (NMPlatform *platform, int ifindex)
-{
-	const NMPObject *obj = nm_platform_link_get_obj (platform, ifindex, TRUE);
+	if (out_speed) {
+		if (   data.speed == G_MAXUINT16
+		    || data.speed == G_MAXUINT32)
+			data.speed = 0;
+		*out_speed = data.speed;
+	}
 
-	if (   !obj
-	    || !obj->_link.netlink.is_in_netlink
-	    || !obj->_link.udev.device)
-		return NULL;
-	return udev_device_get_syspath (obj->_link.udev.device);
+	if (out_duplex) {
+		switch (data.duplex) {
+		case DUPLEX_HALF:
+			*out_duplex = NM_PLATFORM_LINK_DUPLEX_HALF;
+			break;
+		case DUPLEX_FULL:
+			*out_duplex = NM_PLATFORM_LINK_DUPLEX_FULL;
+			break;
+		default: /* DUPLEX_UNKNOWN */
+			*out_duplex = NM_PLATFORM_LINK_DUPLEX_UNKNOWN;
+			break;
+		}
+	}
+
+	return TRUE;
 }
 
 static int
-link_set_user_ipv6ll_enabled (NMPlatform *platform, int ifindex, gboolean enabled)
+_ethtool_linkstate_get_cb (struct nl_msg *msg, void *arg)
 {
-	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
-	guint8 mode = enabled ? NM_IN6_ADDR_GEN_MODE_NONE : NM_IN6_ADDR_GEN_MODE_EUI64;
-
-	_LOGD ("link: change %d: user-ipv6ll: set IPv6 address generation mode to %s",
-	       ifindex,
-	       nm_platform_link_inet6_addrgenmode2str (mode, NULL, 0));
-
-	if (!nm_platform_kernel_support_get (NM_PLATFORM_KERNEL_SUPPORT_TYPE_USER_IPV6LL)) {
-		_LOGD ("link: change %d: user-ipv6ll: not supported", ifindex);
-		return -NME_PL_OPNOTSUPP;
-	}
+	static const struct nla_policy policy[] = {
+		[ETHTOOL_A_LINKSTATE_LINK] = { .type = NLA_U8 },
+	};
+	struct nlattr *tb[G_N_ELEMENTS (policy)];
+	NMTernary *supported = arg;
 
-	nlmsg = _nl_msg_new_link (RTM_NEWLINK,
-	                          0,
-	                          ifindex,
-	                          NULL);
-	if (   !nlmsg
-	    || !_nl_msg_new_link_set_afspec (nlmsg, mode, NULL))
-		g_return_val_if_reached (-NME_BUG);
+	if (genlmsg_parse_arr (nlmsg_hdr (msg), 0, tb, policy) < 0)
+		return NL_SKIP;
 
-	return do_change_link (platform, CHANGE_LINK_TYPE_UNSPEC, ifindex, nlmsg, NULL);
+	/* kernel only reports the link state if the driver implements
+	 * the get_link() operation, just like for ETHTOOL_GLINK. */
+	*supported = !!tb[ETHTOOL_A_LINKSTATE_LINK];
+	return NL_STOP;
 }
 
 static gboolean
-link_set_token (NMPlatform *platform, int ifindex, NMUtilsIPv6IfaceId iid)
+_ethtool_supports_carrier_detect (NMPlatform *platform, int ifindex)
 {
-	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
-	char sbuf[NM_UTILS_INET_ADDRSTRLEN];
+	nm_auto_nlmsg struct nl_msg *msg = NULL;
+	NMTernary supported = NM_TERNARY_DEFAULT;
+	int ethtool_family_id;
+	int r;
 
-	_LOGD ("link: change %d: token: set IPv6 address generation token to %s",
-	       ifindex, nm_utils_inet6_interface_identifier_to_token (iid, sbuf));
+	ethtool_family_id = _ethtool_get_family_id (platform);
+	if (ethtool_family_id <= 0)
+		return nmp_utils_ethtool_supports_carrier_detect (ifindex);
 
-	nlmsg = _nl_msg_new_link (RTM_NEWLINK, 0, ifindex, NULL);
-	if (!nlmsg || !_nl_msg_new_link_set_afspec (nlmsg, -1, &iid))
+	msg = _ethtool_msg_new (ethtool_family_id,
+	                        ETHTOOL_MSG_LINKSTATE_GET,
+	                        ETHTOOL_A_LINKSTATE_HEADER,
+	                        ifindex,
+	                        0);
+	if (!msg)
 		g_return_val_if_reached (FALSE);
 
-	return (do_change_link (platform, CHANGE_LINK_TYPE_UNSPEC, ifindex, nlmsg, NULL) >= 0);
+	r = _ethtool_request (platform, msg, _ethtool_linkstate_get_cb, &supported);
+	if (r == -EOPNOTSUPP)
+		return nmp_utils_ethtool_supports_carrier_detect (ifindex);
+	return r >= 0 && supported == NM_TERNARY_TRUE;
 }
 
+/*****************************************************************************/
+
 static gboolean
 link_supports_carrier_detect (NMPlatform *platform, int ifindex)
 {
@@ -6699,7 +9471,7 @@ link_supports_carrier_detect (NMPlatform *platform, int ifindex)
 	 * us whether the device actually supports carrier detection in the first
 	 * place. We assume any device that does implements one of these two APIs.
 	 */
-	return    nmp_utils_ethtool_supports_carrier_detect (ifindex)
+	return    _ethtool_supports_carrier_detect (platform, ifindex)
 	       || nmp_utils_mii_supports_carrier_detect (ifindex);
 }
 
@@ -6792,52 +9564,376 @@ nla_put_failure:
 	g_return_val_if_reached (FALSE);
 }
 
-static gboolean
-link_get_permanent_address (NMPlatform *platform,
-                            int ifindex,
-                            guint8 *buf,
-                            size_t *length)
+static gboolean
+link_get_permanent_address (NMPlatform *platform,
+                            int ifindex,
+                            guint8 *buf,
+                            size_t *length)
+{
+	nm_auto_pop_netns NMPNetns *netns = NULL;
+
+	if (!nm_platform_netns_push (platform, &netns))
+		return FALSE;
+
+	return nmp_utils_ethtool_get_permanent_address (ifindex, buf, length);
+}
+
+static int
+link_set_mtu (NMPlatform *platform, int ifindex, guint32 mtu)
+{
+	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
+
+	nlmsg = _nl_msg_new_link (RTM_NEWLINK,
+	                          0,
+	                          ifindex,
+	                          NULL);
+	if (!nlmsg)
+		return FALSE;
+
+	NLA_PUT_U32 (nlmsg, IFLA_MTU, mtu);
+
+	return do_change_link (platform, CHANGE_LINK_TYPE_SET_MTU, ifindex, nlmsg, NULL);
+nla_put_failure:
+	g_return_val_if_reached (FALSE);
+}
+
+static void
+sriov_idle_cb (gpointer user_data,
+               GCancellable *cancellable)
+{
+	gs_unref_object NMPlatform *platform = NULL;
+	gs_free_error GError *cancelled_error = NULL;
+	gs_free_error GError *error = NULL;
+	NMPlatformAsyncCallback callback;
+	gpointer callback_data;
+
+	g_cancellable_set_error_if_cancelled (cancellable, &cancelled_error);
+	nm_utils_user_data_unpack (user_data, &platform, &error, &callback, &callback_data);
+	callback (cancelled_error ?: error, callback_data);
+}
+
+/* identifies the devlink instance of a device, like "pci/0000:03:00.0". */
+typedef struct {
+	char bus_name[32];
+	char dev_name[64];
+} DevlinkHandle;
+
+/* the eswitch parameters, with the values of the DEVLINK_ESWITCH_* enums
+ * of kernel. A negative value means that the parameter is unknown or that
+ * it shall not be changed. */
+typedef struct {
+	int mode;
+	int inline_mode;
+	int encap_mode;
+} DevlinkEswitch;
+
+#define DEVLINK_ESWITCH_INIT { .mode = -1, .inline_mode = -1, .encap_mode = -1, }
+
+static int
+_devlink_get_family_id (NMPlatform *platform)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	struct nl_sock *genl;
+	int devlink_family_id;
+
+	if (priv->devlink_family_id >= 0)
+		return priv->devlink_family_id;
+
+	genl = _genl_sock (NM_LINUX_PLATFORM (platform));
+	if (!genl)
+		return -1;
+
+	devlink_family_id = genl_ctrl_resolve (genl, DEVLINK_GENL_NAME);
+	if (devlink_family_id >= 0)
+		priv->devlink_family_id = devlink_family_id;
+	return devlink_family_id;
+}
+
+static gboolean
+_devlink_handle_init (DevlinkHandle *handle,
+                      int dirfd,
+                      GError **error)
+{
+	char buf[PATH_MAX];
+	const char *name;
+	ssize_t len;
+
+	/* the devlink instance is named after the parent device of the netdev,
+	 * which is "device" in the netdir, and its bus. */
+	len = readlinkat (dirfd, "device", buf, sizeof (buf) - 1);
+	if (len <= 0)
+		goto fail;
+	buf[len] = '\0';
+	name = strrchr (buf, '/');
+	name = name ? &name[1] : buf;
+	if (g_strlcpy (handle->dev_name, name, sizeof (handle->dev_name)) >= sizeof (handle->dev_name))
+		goto fail;
+
+	len = readlinkat (dirfd, "device/subsystem", buf, sizeof (buf) - 1);
+	if (len <= 0)
+		goto fail;
+	buf[len] = '\0';
+	name = strrchr (buf, '/');
+	name = name ? &name[1] : buf;
+	if (g_strlcpy (handle->bus_name, name, sizeof (handle->bus_name)) >= sizeof (handle->bus_name))
+		goto fail;
+
+	return TRUE;
+
+fail:
+	g_set_error_literal (error,
+	                     NM_UTILS_ERROR,
+	                     NM_UTILS_ERROR_UNKNOWN,
+	                     "couldn't determine the devlink device");
+	return FALSE;
+}
+
+static struct nl_msg *
+_devlink_msg_new (int devlink_family_id,
+                  guint8 cmd,
+                  const DevlinkHandle *handle)
+{
+	nm_auto_nlmsg struct nl_msg *msg = NULL;
+
+	msg = nlmsg_alloc ();
+
+	if (!genlmsg_put (msg,
+	                  NL_AUTO_PORT,
+	                  NL_AUTO_SEQ,
+	                  devlink_family_id,
+	                  0,
+	                  0,
+	                  cmd,
+	                  DEVLINK_GENL_VERSION))
+		goto nla_put_failure;
+
+	NLA_PUT_STRING (msg, DEVLINK_ATTR_BUS_NAME, handle->bus_name);
+	NLA_PUT_STRING (msg, DEVLINK_ATTR_DEV_NAME, handle->dev_name);
+
+	return g_steal_pointer (&msg);
+
+nla_put_failure:
+	g_return_val_if_reached (NULL);
+}
+
+static int
+_devlink_eswitch_get_cb (struct nl_msg *msg, void *arg)
+{
+	static const struct nla_policy policy[] = {
+		[DEVLINK_ATTR_ESWITCH_MODE]        = { .type = NLA_U16 },
+		[DEVLINK_ATTR_ESWITCH_INLINE_MODE] = { .type = NLA_U8 },
+		[DEVLINK_ATTR_ESWITCH_ENCAP_MODE]  = { .type = NLA_U8 },
+	};
+	struct nlattr *tb[G_N_ELEMENTS (policy)];
+	DevlinkEswitch *eswitch = arg;
+
+	if (genlmsg_parse_arr (nlmsg_hdr (msg), 0, tb, policy) < 0)
+		return NL_SKIP;
+
+	if (tb[DEVLINK_ATTR_ESWITCH_MODE])
+		eswitch->mode = nla_get_u16 (tb[DEVLINK_ATTR_ESWITCH_MODE]);
+	if (tb[DEVLINK_ATTR_ESWITCH_INLINE_MODE])
+		eswitch->inline_mode = nla_get_u8 (tb[DEVLINK_ATTR_ESWITCH_INLINE_MODE]);
+	if (tb[DEVLINK_ATTR_ESWITCH_ENCAP_MODE])
+		eswitch->encap_mode = nla_get_u8 (tb[DEVLINK_ATTR_ESWITCH_ENCAP_MODE]);
+
+	return NL_STOP;
+}
+
+static gboolean
+_devlink_eswitch_get (NMPlatform *platform,
+                      const DevlinkHandle *handle,
+                      DevlinkEswitch *out_eswitch,
+                      GError **error)
+{
+	struct nl_sock *genl = _genl_sock (NM_LINUX_PLATFORM (platform));
+	nm_auto_nlmsg struct nl_msg *msg = NULL;
+	int devlink_family_id;
+	int r;
+
+	*out_eswitch = (DevlinkEswitch) DEVLINK_ESWITCH_INIT;
+
+	devlink_family_id = _devlink_get_family_id (platform);
+	if (devlink_family_id < 0) {
+		g_set_error_literal (error,
+		                     NM_UTILS_ERROR,
+		                     NM_UTILS_ERROR_UNKNOWN,
+		                     "devlink is not supported by kernel");
+		return FALSE;
+	}
+
+	msg = _devlink_msg_new (devlink_family_id, DEVLINK_CMD_ESWITCH_GET, handle);
+	if (!msg)
+		g_return_val_if_reached (FALSE);
+
+	r = nl_send_auto (genl, msg);
+	if (r >= 0) {
+		r = nl_recvmsgs (genl,
+		                 &((const struct nl_cb) {
+		                     .valid_cb  = _devlink_eswitch_get_cb,
+		                     .valid_arg = out_eswitch,
+		                 }));
+	}
+	if (r >= 0)
+		r = nl_wait_for_ack (genl, NULL);
+	if (r < 0) {
+		g_set_error (error,
+		             NM_UTILS_ERROR,
+		             NM_UTILS_ERROR_UNKNOWN,
+		             "couldn't read the eswitch of %s/%s: %s",
+		             handle->bus_name, handle->dev_name, nm_strerror (r));
+		return FALSE;
+	}
+
+	_LOGD ("devlink: eswitch of %s/%s has mode %d, inline-mode %d, encap-mode %d",
+	       handle->bus_name, handle->dev_name,
+	       out_eswitch->mode, out_eswitch->inline_mode, out_eswitch->encap_mode);
+	return TRUE;
+}
+
+static gboolean
+_devlink_eswitch_set (NMPlatform *platform,
+                      const DevlinkHandle *handle,
+                      const DevlinkEswitch *eswitch,
+                      GError **error)
+{
+	struct nl_sock *genl = _genl_sock (NM_LINUX_PLATFORM (platform));
+	nm_auto_nlmsg struct nl_msg *msg = NULL;
+	int devlink_family_id;
+	int r;
+
+	devlink_family_id = _devlink_get_family_id (platform);
+	if (devlink_family_id < 0) {
+		g_set_error_literal (error,
+		                     NM_UTILS_ERROR,
+		                     NM_UTILS_ERROR_UNKNOWN,
+		                     "devlink is not supported by kernel");
+		return FALSE;
+	}
+
+	msg = _devlink_msg_new (devlink_family_id, DEVLINK_CMD_ESWITCH_SET, handle);
+	if (!msg)
+		g_return_val_if_reached (FALSE);
+
+	/* kernel applies the mode first, so that the inline and encap
+	 * modes can be set for the new mode in the same request. */
+	if (eswitch->mode >= 0)
+		NLA_PUT_U16 (msg, DEVLINK_ATTR_ESWITCH_MODE, eswitch->mode);
+	if (eswitch->inline_mode >= 0)
+		NLA_PUT_U8 (msg, DEVLINK_ATTR_ESWITCH_INLINE_MODE, eswitch->inline_mode);
+	if (eswitch->encap_mode >= 0)
+		NLA_PUT_U8 (msg, DEVLINK_ATTR_ESWITCH_ENCAP_MODE, eswitch->encap_mode);
+
+	_LOGD ("devlink: set eswitch of %s/%s to mode %d, inline-mode %d, encap-mode %d",
+	       handle->bus_name, handle->dev_name,
+	       eswitch->mode, eswitch->inline_mode, eswitch->encap_mode);
+
+	r = nl_send_auto (genl, msg);
+	if (r >= 0)
+		r = nl_wait_for_ack (genl, NULL);
+	if (r < 0) {
+		g_set_error (error,
+		             NM_UTILS_ERROR,
+		             NM_UTILS_ERROR_UNKNOWN,
+		             "couldn't set the eswitch of %s/%s: %s",
+		             handle->bus_name, handle->dev_name, nm_strerror (r));
+		return FALSE;
+	}
+	return TRUE;
+
+nla_put_failure:
+	g_return_val_if_reached (FALSE);
+}
+
+typedef struct {
+	NMPlatform *platform;
+	GCancellable *cancellable;
+	NMPlatformAsyncCallback callback;
+	gpointer callback_data;
+	DevlinkHandle devlink;
+	DevlinkEswitch eswitch;
+	int ifindex;
+	guint num_vfs;
+} SriovEswitchData;
+
+static void
+sriov_eswitch_data_free (SriovEswitchData *data)
+{
+	g_object_unref (data->platform);
+	nm_g_object_unref (data->cancellable);
+	nm_g_slice_free (data);
+}
+
+/* invoked after the VFs were destroyed. Now the eswitch can be changed, and
+ * the VFs are created again. */
+static void
+sriov_eswitch_cb (GError *error, gpointer user_data)
 {
+	SriovEswitchData *data = user_data;
+	NMPlatform *platform = data->platform;
 	nm_auto_pop_netns NMPNetns *netns = NULL;
+	gs_free_error GError *local = NULL;
+	nm_auto_close int dirfd = -1;
+	char ifname[IFNAMSIZ];
+	const char *values[2];
 
-	if (!nm_platform_netns_push (platform, &netns))
-		return FALSE;
+	if (error) {
+		if (data->callback)
+			data->callback (error, data->callback_data);
+		goto out;
+	}
 
-	return nmp_utils_ethtool_get_permanent_address (ifindex, buf, length);
-}
+	if (!nm_platform_netns_push (platform, &netns)) {
+		g_set_error_literal (&local,
+		                     NM_UTILS_ERROR,
+		                     NM_UTILS_ERROR_UNKNOWN,
+		                     "couldn't change namespace");
+		goto out_error;
+	}
 
-static int
-link_set_mtu (NMPlatform *platform, int ifindex, guint32 mtu)
-{
-	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
+	if (!_devlink_eswitch_set (platform, &data->devlink, &data->eswitch, &local))
+		goto out_error;
 
-	nlmsg = _nl_msg_new_link (RTM_NEWLINK,
-	                          0,
-	                          ifindex,
-	                          NULL);
-	if (!nlmsg)
-		return FALSE;
+	if (data->num_vfs == 0) {
+		if (data->callback)
+			data->callback (NULL, data->callback_data);
+		goto out;
+	}
 
-	NLA_PUT_U32 (nlmsg, IFLA_MTU, mtu);
+	dirfd = nm_platform_sysctl_open_netdir (platform, data->ifindex, ifname);
+	if (dirfd < 0) {
+		g_set_error_literal (&local,
+		                     NM_UTILS_ERROR,
+		                     NM_UTILS_ERROR_UNKNOWN,
+		                     "couldn't open netdir");
+		goto out_error;
+	}
 
-	return do_change_link (platform, CHANGE_LINK_TYPE_SET_MTU, ifindex, nlmsg, NULL);
-nla_put_failure:
-	g_return_val_if_reached (FALSE);
+	values[0] = nm_sprintf_bufa (32, "%u", data->num_vfs);
+	values[1] = NULL;
+	sysctl_set_async (platform,
+	                  NMP_SYSCTL_PATHID_NETDIR (dirfd, ifname, "device/sriov_numvfs"),
+	                  values,
+	                  data->callback,
+	                  data->callback_data,
+	                  data->cancellable);
+	goto out;
+
+out_error:
+	if (data->callback)
+		data->callback (local, data->callback_data);
+out:
+	sriov_eswitch_data_free (data);
 }
 
 static void
-sriov_idle_cb (gpointer user_data,
-               GCancellable *cancellable)
+sriov_eswitch_idle_cb (gpointer user_data,
+                       GCancellable *cancellable)
 {
-	gs_unref_object NMPlatform *platform = NULL;
 	gs_free_error GError *cancelled_error = NULL;
-	gs_free_error GError *error = NULL;
-	NMPlatformAsyncCallback callback;
-	gpointer callback_data;
 
 	g_cancellable_set_error_if_cancelled (cancellable, &cancelled_error);
-	nm_utils_user_data_unpack (user_data, &platform, &error, &callback, &callback_data);
-	callback (cancelled_error ?: error, callback_data);
+	sriov_eswitch_cb (cancelled_error, user_data);
 }
 
 static void
@@ -6845,6 +9941,9 @@ link_set_sriov_params_async (NMPlatform *platform,
                              int ifindex,
                              guint num_vfs,
                              NMTernary autoprobe,
+                             int eswitch_mode,
+                             int eswitch_inline_mode,
+                             int eswitch_encap_mode,
                              NMPlatformAsyncCallback callback,
                              gpointer data,
                              GCancellable *cancellable)
@@ -6859,6 +9958,9 @@ link_set_sriov_params_async (NMPlatform *platform,
 	gpointer packed;
 	const char *values[3];
 	char buf[64];
+	DevlinkHandle devlink;
+	DevlinkEswitch eswitch_set = DEVLINK_ESWITCH_INIT;
+	gboolean eswitch_change = FALSE;
 
 	g_return_if_fail (callback || !data);
 	g_return_if_fail (cancellable);
@@ -6898,10 +10000,35 @@ link_set_sriov_params_async (NMPlatform *platform,
 		num_vfs = total;
 	}
 
+	if (   eswitch_mode >= 0
+	    || eswitch_inline_mode >= 0
+	    || eswitch_encap_mode >= 0) {
+		DevlinkEswitch eswitch_current;
+
+		if (   !_devlink_handle_init (&devlink, dirfd, &error)
+		    || !_devlink_eswitch_get (platform, &devlink, &eswitch_current, &error))
+			goto out_idle;
+
+		if (   eswitch_mode >= 0
+		    && eswitch_mode != eswitch_current.mode)
+			eswitch_set.mode = eswitch_mode;
+		if (   eswitch_inline_mode >= 0
+		    && eswitch_inline_mode != eswitch_current.inline_mode)
+			eswitch_set.inline_mode = eswitch_inline_mode;
+		if (   eswitch_encap_mode >= 0
+		    && eswitch_encap_mode != eswitch_current.encap_mode)
+			eswitch_set.encap_mode = eswitch_encap_mode;
+
+		eswitch_change =    eswitch_set.mode >= 0
+		                 || eswitch_set.inline_mode >= 0
+		                 || eswitch_set.encap_mode >= 0;
+	}
+
 	/*
 	 * Take special care when setting new values:
 	 *  - don't touch anything if the right values are already set
-	 *  - to change the number of VFs or autoprobe we need to destroy existing VFs
+	 *  - to change the number of VFs, autoprobe or the eswitch we need to
+	 *    destroy existing VFs
 	 *  - the autoprobe setting is irrelevant when numvfs is zero
 	 */
 	current_num = nm_platform_sysctl_get_int_checked (platform,
@@ -6923,7 +10050,8 @@ link_set_sriov_params_async (NMPlatform *platform,
 	}
 
 	if (   current_num == num_vfs
-	    && (autoprobe == NM_TERNARY_DEFAULT || current_autoprobe == autoprobe))
+	    && (autoprobe == NM_TERNARY_DEFAULT || current_autoprobe == autoprobe)
+	    && !eswitch_change)
 		goto out_idle;
 
 	if (   NM_IN_SET (autoprobe, NM_TERNARY_TRUE, NM_TERNARY_FALSE)
@@ -6941,139 +10069,590 @@ link_set_sriov_params_async (NMPlatform *platform,
 		goto out_idle;
 	}
 
-	if (current_num == 0 && num_vfs == 0)
+	if (eswitch_change) {
+		SriovEswitchData *eswitch_data;
+
+		/* drivers only allow to change the eswitch while there are no VFs.
+		 * Destroy them first, and create them after changing the eswitch. */
+		eswitch_data = g_slice_new (SriovEswitchData);
+		*eswitch_data = (SriovEswitchData) {
+			.platform      = g_object_ref (platform),
+			.cancellable   = nm_g_object_ref (cancellable),
+			.callback      = callback,
+			.callback_data = data,
+			.devlink       = devlink,
+			.eswitch       = eswitch_set,
+			.ifindex       = ifindex,
+			.num_vfs       = num_vfs,
+		};
+
+		if (current_num == 0) {
+			nm_utils_invoke_on_idle (sriov_eswitch_idle_cb,
+			                         eswitch_data,
+			                         cancellable);
+			return;
+		}
+
+		values[0] = "0";
+		values[1] = NULL;
+		sysctl_set_async (platform,
+		                  NMP_SYSCTL_PATHID_NETDIR (dirfd, ifname, "device/sriov_numvfs"),
+		                  values,
+		                  sriov_eswitch_cb,
+		                  eswitch_data,
+		                  cancellable);
+		return;
+	}
+
+	if (current_num == 0 && num_vfs == 0)
+		goto out_idle;
+
+	i = 0;
+	if (current_num != 0)
+		values[i++] = "0";
+	if (num_vfs != 0)
+		values[i++] = nm_sprintf_bufa (32, "%u", num_vfs);
+	values[i++] = NULL;
+
+	sysctl_set_async (platform,
+	                  NMP_SYSCTL_PATHID_NETDIR (dirfd, ifname, "device/sriov_numvfs"),
+	                  values,
+	                  callback,
+	                  data,
+	                  cancellable);
+	return;
+
+out_idle:
+	if (callback) {
+		packed = nm_utils_user_data_pack (g_object_ref (platform),
+		                                  g_steal_pointer (&error),
+		                                  callback,
+		                                  data);
+		nm_utils_invoke_on_idle (sriov_idle_cb, packed, cancellable);
+	}
+}
+
+/* The number of VFs that are packed into one RTM_SETLINK message. With all
+ * attributes, one IFLA_VF_INFO takes about 110 bytes, so the message stays
+ * well within the page that _nl_msg_new_link() allocates. */
+#define SRIOV_VFS_PER_NLMSG 24u
+
+/* requests the current configuration of the VFs of @ifindex from kernel. The
+ * cache does not track IFLA_VFINFO_LIST, because it is only included in the
+ * response when asking for it with RTEXT_FILTER_VF.
+ *
+ * Returns: %TRUE if kernel reported the VFs of @ifindex. */
+static gboolean
+_sriov_vfs_get (NMPlatform *platform,
+                int ifindex,
+                SriovVfState *vfs,
+                guint n_vfs)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	WaitForNlResponseResult seq_result = WAIT_FOR_NL_RESPONSE_RESULT_UNKNOWN;
+	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
+	SriovVfsGetData data = {
+		.ifindex = ifindex,
+		.n_vfs   = n_vfs,
+		.vfs     = vfs,
+	};
+	gsize buf_size;
+	gsize buf_size_old;
+	gboolean success = FALSE;
+	int nle;
+
+	memset (vfs, 0, sizeof (vfs[0]) * n_vfs);
+
+	nlmsg = _nl_msg_new_link_full (RTM_GETLINK,
+	                               0,
+	                               ifindex,
+	                               NULL,
+	                               AF_UNSPEC,
+	                               0,
+	                               0);
+	if (!nlmsg)
+		g_return_val_if_reached (FALSE);
+
+	NLA_PUT_U32 (nlmsg, IFLA_EXT_MASK, RTEXT_FILTER_VF | RTEXT_FILTER_SKIP_STATS);
+
+	event_handler_read_netlink (platform, FALSE);
+
+	/* the response has the VFs of the whole device. Make sure it fits in
+	 * the receive buffer, otherwise it would be lost. The buffer is only
+	 * enlarged for this response, the socket keeps it allocated while the
+	 * size is set. */
+	buf_size = NM_MIN ((gsize) 512 * 1024, (gsize) 16 * 1024 + (gsize) n_vfs * 512);
+	buf_size_old = nl_socket_get_msg_buf_size (priv->nlh);
+	if (buf_size_old < buf_size) {
+		if (nl_socket_set_msg_buf_size (priv->nlh, buf_size) < 0)
+			nm_assert_not_reached ();
+	}
+
+	nle = _nl_send_nlmsg (platform, nlmsg, &seq_result, NULL, DELAYED_ACTION_RESPONSE_TYPE_SRIOV_VFS_GET, &data);
+	if (nle >= 0) {
+		delayed_action_handle_all (platform, FALSE);
+		success =    seq_result == WAIT_FOR_NL_RESPONSE_RESULT_RESPONSE_OK
+		          && data.found;
+	}
+
+	if (buf_size_old < buf_size) {
+		if (nl_socket_set_msg_buf_size (priv->nlh, buf_size_old) < 0)
+			nm_assert_not_reached ();
+	}
+
+	return success;
+
+nla_put_failure:
+	g_return_val_if_reached (FALSE);
+}
+
+static gboolean
+_sriov_vf_is_satisfied (const NMPlatformVF *vf,
+                        const SriovVfState *state)
+{
+	if (!state->valid)
+		return FALSE;
+
+	if (   vf->spoofchk >= 0
+	    && vf->spoofchk != state->spoofchk)
+		return FALSE;
+
+	if (   vf->trust >= 0
+	    && vf->trust != state->trust)
+		return FALSE;
+
+	if (   vf->mac.len
+	    && memcmp (vf->mac.data, state->mac, vf->mac.len) != 0)
+		return FALSE;
+
+	if (   (vf->min_tx_rate || vf->max_tx_rate)
+	    && (   vf->min_tx_rate != state->min_tx_rate
+	        || vf->max_tx_rate != state->max_tx_rate))
+		return FALSE;
+
+	if (vf->num_vlans == 1) {
+		if (   vf->vlans[0].id != state->vlan
+		    || vf->vlans[0].qos != state->qos
+		    || htons (vf->vlans[0].proto_ad ? ETH_P_8021AD : ETH_P_8021Q) != state->vlan_proto)
+			return FALSE;
+	} else {
+		if (state->vlan != 0)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+_sriov_vf_put (struct nl_msg *nlmsg,
+               const NMPlatformVF *vf)
+{
+	struct nlattr *info, *vlan_list;
+	struct _ifla_vf_vlan_info ivvi = { 0 };
+
+	if (!(info = nla_nest_start (nlmsg, IFLA_VF_INFO)))
+		goto nla_put_failure;
+
+	if (vf->spoofchk >= 0) {
+		struct _ifla_vf_setting ivs = { 0 };
+
+		ivs.vf = vf->index;
+		ivs.setting = vf->spoofchk;
+		NLA_PUT (nlmsg, IFLA_VF_SPOOFCHK, sizeof (ivs), &ivs);
+	}
+
+	if (vf->trust >= 0) {
+		struct _ifla_vf_setting ivs = { 0 };
+
+		ivs.vf = vf->index;
+		ivs.setting = vf->trust;
+		NLA_PUT (nlmsg, IFLA_VF_TRUST, sizeof (ivs), &ivs);
+	}
+
+	if (vf->mac.len) {
+		struct ifla_vf_mac ivm = { 0 };
+
+		ivm.vf = vf->index;
+		memcpy (ivm.mac, vf->mac.data, vf->mac.len);
+		NLA_PUT (nlmsg, IFLA_VF_MAC, sizeof (ivm), &ivm);
+	}
+
+	if (vf->min_tx_rate || vf->max_tx_rate) {
+		struct _ifla_vf_rate ivr = { 0 };
+
+		ivr.vf = vf->index;
+		ivr.min_tx_rate = vf->min_tx_rate;
+		ivr.max_tx_rate = vf->max_tx_rate;
+		NLA_PUT (nlmsg, IFLA_VF_RATE, sizeof (ivr), &ivr);
+	}
+
+	/* Kernel only supports one VLAN per VF now. If this
+	 * changes in the future, we need to figure out how to
+	 * clear existing VLANs and set new ones in one message
+	 * with the new API.*/
+	nm_assert (vf->num_vlans <= 1);
+
+	if (!(vlan_list = nla_nest_start (nlmsg, IFLA_VF_VLAN_LIST)))
+		goto nla_put_failure;
+
+	ivvi.vf = vf->index;
+	if (vf->num_vlans == 1) {
+		ivvi.vlan = vf->vlans[0].id;
+		ivvi.qos = vf->vlans[0].qos;
+		ivvi.vlan_proto = htons (vf->vlans[0].proto_ad ? ETH_P_8021AD : ETH_P_8021Q);
+	} else {
+		/* Clear existing VLAN */
+		ivvi.vlan = 0;
+		ivvi.qos = 0;
+		ivvi.vlan_proto = htons (ETH_P_8021Q);
+	}
+
+	NLA_PUT (nlmsg, IFLA_VF_VLAN_INFO, sizeof (ivvi), &ivvi);
+	nla_nest_end (nlmsg, vlan_list);
+	nla_nest_end (nlmsg, info);
+	return TRUE;
+
+nla_put_failure:
+	return FALSE;
+}
+
+/* creates the RTM_SETLINK messages to configure @vfs, skipping the VFs that
+ * are already configured as requested.
+ *
+ * Returns: %FALSE if @vfs cannot be configured. Otherwise, @out_nlmsgs
+ *   are the messages to send, which might be none. */
+static gboolean
+_sriov_vfs_create_nlmsgs (NMPlatform *platform,
+                          int ifindex,
+                          const NMPlatformVF *const *vfs,
+                          GPtrArray **out_nlmsgs)
+{
+	gs_unref_ptrarray GPtrArray *nlmsgs = NULL;
+	gs_free SriovVfState *states = NULL;
+	struct nl_msg *nlmsg = NULL;
+	struct nlattr *list = NULL;
+	gboolean states_valid;
+	guint n_states = 0;
+	guint n_skipped = 0;
+	guint n_in_msg = 0;
+	guint i;
+
+	for (i = 0; vfs[i]; i++) {
+		if (vfs[i]->num_vlans > 1) {
+			_LOGW ("multiple VLANs per VF are not supported at the moment");
+			return FALSE;
+		}
+		n_states = NM_MAX (n_states, vfs[i]->index + 1);
+	}
+
+	nlmsgs = g_ptr_array_new_with_free_func ((GDestroyNotify) nlmsg_free);
+
+	if (n_states == 0)
+		goto out;
+
+	states = g_new (SriovVfState, n_states);
+	states_valid = _sriov_vfs_get (platform, ifindex, states, n_states);
+	if (!states_valid)
+		_LOGD ("link: could not read VFs of %d, configure all of them", ifindex);
+
+	for (i = 0; vfs[i]; i++) {
+		const NMPlatformVF *vf = vfs[i];
+
+		if (   states_valid
+		    && _sriov_vf_is_satisfied (vf, &states[vf->index])) {
+			n_skipped++;
+			continue;
+		}
+
+		if (!nlmsg) {
+			nlmsg = _nl_msg_new_link (RTM_SETLINK,
+			                          0,
+			                          ifindex,
+			                          NULL);
+			if (!nlmsg)
+				g_return_val_if_reached (FALSE);
+			g_ptr_array_add (nlmsgs, nlmsg);
+
+			if (!(list = nla_nest_start (nlmsg, IFLA_VFINFO_LIST)))
+				g_return_val_if_reached (FALSE);
+			n_in_msg = 0;
+		}
+
+		if (!_sriov_vf_put (nlmsg, vf))
+			g_return_val_if_reached (FALSE);
+
+		if (++n_in_msg >= SRIOV_VFS_PER_NLMSG) {
+			nla_nest_end (nlmsg, list);
+			nlmsg = NULL;
+		}
+	}
+	if (nlmsg)
+		nla_nest_end (nlmsg, list);
+
+out:
+	_LOGD ("link: configure VFs of %d with %u messages (%u VFs already up to date)",
+	       ifindex, nlmsgs->len, n_skipped);
+	*out_nlmsgs = g_steal_pointer (&nlmsgs);
+	return TRUE;
+}
+
+static gboolean
+link_set_sriov_vfs (NMPlatform *platform, int ifindex, const NMPlatformVF *const *vfs)
+{
+	gs_unref_ptrarray GPtrArray *nlmsgs = NULL;
+	gs_free WaitForNlResponseResult *seq_results = NULL;
+	gs_free char **errmsgs = NULL;
+	gboolean success = TRUE;
+	char s_buf[256];
+	guint i, j;
+	int n;
+
+	if (!_sriov_vfs_create_nlmsgs (platform, ifindex, vfs, &nlmsgs))
+		return FALSE;
+
+	if (nlmsgs->len == 0)
+		return TRUE;
+
+	seq_results = g_new0 (WaitForNlResponseResult, nlmsgs->len);
+	errmsgs = g_new0 (char *, nlmsgs->len);
+
+	for (i = 0; i < nlmsgs->len; ) {
+		event_handler_read_netlink (platform, FALSE);
+
+		n = _nl_send_nlmsg_batch (platform,
+		                          (struct nl_msg *const*) &nlmsgs->pdata[i],
+		                          nlmsgs->len - i,
+		                          &seq_results[i],
+		                          &errmsgs[i]);
+		if (n < 0) {
+			_LOGE ("link: failure sending netlink request to configure VFs of %d: %s (%d)",
+			       ifindex, nm_strerror (n), -n);
+			success = FALSE;
+			break;
+		}
+
+		delayed_action_handle_all (platform, FALSE);
+
+		for (j = i; j < i + n; j++) {
+			if (seq_results[j] == WAIT_FOR_NL_RESPONSE_RESULT_RESPONSE_OK)
+				continue;
+			_LOGW ("link: failure configuring VFs of %d: %s",
+			       ifindex,
+			       wait_for_nl_response_to_string (seq_results[j], errmsgs[j], s_buf, sizeof (s_buf)));
+			success = FALSE;
+		}
+		i += n;
+	}
+
+	for (i = 0; i < nlmsgs->len; i++)
+		g_free (errmsgs[i]);
+
+	return success;
+}
+
+typedef struct {
+	NMPlatformAsyncCallback callback;
+	gpointer callback_data;
+	GError *error;
+	guint n_pending;
+} SriovVfsAsyncData;
+
+static void
+sriov_vfs_async_cb (GError *error, gpointer user_data)
+{
+	SriovVfsAsyncData *data = user_data;
+
+	if (   error
+	    && !data->error)
+		data->error = g_error_copy (error);
+
+	nm_assert (data->n_pending > 0);
+	if (--data->n_pending > 0)
+		return;
+
+	if (data->callback)
+		data->callback (data->error, data->callback_data);
+
+	g_clear_error (&data->error);
+	nm_g_slice_free (data);
+}
+
+static void
+link_set_sriov_vfs_async (NMPlatform *platform,
+                          int ifindex,
+                          const NMPlatformVF *const *vfs,
+                          NMPlatformAsyncCallback callback,
+                          gpointer callback_data,
+                          GCancellable *cancellable)
+{
+	gs_unref_ptrarray GPtrArray *nlmsgs = NULL;
+	SriovVfsAsyncData *data;
+	GError *error = NULL;
+	NMPObject obj_id;
+	guint i;
+
+	g_return_if_fail (callback || !callback_data);
+
+	if (!_sriov_vfs_create_nlmsgs (platform, ifindex, vfs, &nlmsgs)) {
+		g_set_error_literal (&error,
+		                     NM_UTILS_ERROR,
+		                     NM_UTILS_ERROR_UNKNOWN,
+		                     "invalid VF configuration");
+		goto out_idle;
+	}
+
+	if (nlmsgs->len == 0)
 		goto out_idle;
 
-	i = 0;
-	if (current_num != 0)
-		values[i++] = "0";
-	if (num_vfs != 0)
-		values[i++] = nm_sprintf_bufa (32, "%u", num_vfs);
-	values[i++] = NULL;
+	data = g_slice_new (SriovVfsAsyncData);
+	*data = (SriovVfsAsyncData) {
+		.callback      = callback,
+		.callback_data = callback_data,
+		.n_pending     = nlmsgs->len,
+	};
 
-	sysctl_set_async (platform,
-	                  NMP_SYSCTL_PATHID_NETDIR (dirfd, ifname, "device/sriov_numvfs"),
-	                  values,
-	                  callback,
-	                  data,
-	                  cancellable);
+	/* the requests don't wait for each other. Kernel processes them in order,
+	 * and the callback is invoked once all of them are acknowledged. */
+	nmp_object_stackinit_id_link (&obj_id, ifindex);
+	for (i = 0; i < nlmsgs->len; i++)
+		_nl_send_nlmsg_async (platform, nlmsgs->pdata[i], &obj_id, FALSE, sriov_vfs_async_cb, data, cancellable);
 	return;
 
 out_idle:
 	if (callback) {
-		packed = nm_utils_user_data_pack (g_object_ref (platform),
-		                                  g_steal_pointer (&error),
-		                                  callback,
-		                                  data);
-		nm_utils_invoke_on_idle (sriov_idle_cb, packed, cancellable);
-	}
+		nm_utils_invoke_on_idle (sriov_idle_cb,
+		                         nm_utils_user_data_pack (g_object_ref (platform),
+		                                                  error,
+		                                                  callback,
+		                                                  callback_data),
+		                         cancellable);
+	} else
+		g_clear_error (&error);
 }
 
+/* gets the VLANs of @ifindex from priv->bridge_vlans. If they are not known,
+ * all bridge VLANs are dumped again.
+ *
+ * Returns: %TRUE if kernel reported the VLANs for @ifindex. */
 static gboolean
-link_set_sriov_vfs (NMPlatform *platform, int ifindex, const NMPlatformVF *const *vfs)
+_bridge_vlans_get (NMPlatform *platform,
+                   int ifindex,
+                   guint8 *vlan_states)
 {
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	WaitForNlResponseResult seq_result = WAIT_FOR_NL_RESPONSE_RESULT_UNKNOWN;
 	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
-	struct nlattr *list, *info, *vlan_list;
-	guint i;
+	gs_unref_hashtable GHashTable *bridge_vlans = NULL;
+	BridgeVlansGetData data;
+	const guint8 *states;
+	int nle;
 
-	nlmsg = _nl_msg_new_link (RTM_NEWLINK,
-	                          0,
-	                          ifindex,
-	                          NULL);
-	if (!nlmsg)
-		g_return_val_if_reached (-NME_BUG);
+	memset (vlan_states, 0, BRIDGE_VLAN_VID_MAX + 1);
 
-	if (!(list = nla_nest_start (nlmsg, IFLA_VFINFO_LIST)))
-		goto nla_put_failure;
+	/* the pending notifications update the known VLANs. */
+	event_handler_read_netlink (platform, FALSE);
 
-	for (i = 0; vfs[i]; i++) {
-		const NMPlatformVF *vf = vfs[i];
+	if (   priv->bridge_vlans
+	    && (states = g_hash_table_lookup (priv->bridge_vlans, GINT_TO_POINTER (ifindex)))) {
+		memcpy (vlan_states, states, BRIDGE_VLAN_VID_MAX + 1);
+		return TRUE;
+	}
 
-		if (!(info = nla_nest_start (nlmsg, IFLA_VF_INFO)))
-			goto nla_put_failure;
+	/* while dumping, the table is unset. Otherwise, the responses
+	 * would also be handled like notifications. */
+	_bridge_vlans_invalidate (platform);
+
+	nlmsg = _nl_msg_new_link_full (RTM_GETLINK,
+	                               NLM_F_DUMP,
+	                               0,
+	                               NULL,
+	                               AF_BRIDGE,
+	                               0,
+	                               0);
+	if (!nlmsg)
+		g_return_val_if_reached (FALSE);
 
-		if (vf->spoofchk >= 0) {
-			struct _ifla_vf_setting ivs = { 0 };
+	NLA_PUT_U32 (nlmsg, IFLA_EXT_MASK, RTEXT_FILTER_BRVLAN_COMPRESSED);
 
-			ivs.vf = vf->index;
-			ivs.setting = vf->spoofchk;
-			NLA_PUT (nlmsg, IFLA_VF_SPOOFCHK, sizeof (ivs), &ivs);
-		}
+	bridge_vlans = g_hash_table_new_full (nm_direct_hash, NULL, NULL, g_free);
+	data.bridge_vlans = bridge_vlans;
 
-		if (vf->trust >= 0) {
-			struct _ifla_vf_setting ivs = { 0 };
+	nle = _nl_send_nlmsg (platform, nlmsg, &seq_result, NULL, DELAYED_ACTION_RESPONSE_TYPE_BRIDGE_VLANS_GET, &data);
+	if (nle < 0)
+		return FALSE;
 
-			ivs.vf = vf->index;
-			ivs.setting = vf->trust;
-			NLA_PUT (nlmsg, IFLA_VF_TRUST, sizeof (ivs), &ivs);
-		}
+	delayed_action_handle_all (platform, FALSE);
 
-		if (vf->mac.len) {
-			struct ifla_vf_mac ivm = { 0 };
+	if (seq_result != WAIT_FOR_NL_RESPONSE_RESULT_RESPONSE_OK)
+		return FALSE;
 
-			ivm.vf = vf->index;
-			memcpy (ivm.mac, vf->mac.data, vf->mac.len);
-			NLA_PUT (nlmsg, IFLA_VF_MAC, sizeof (ivm), &ivm);
-		}
+	priv->bridge_vlans = g_steal_pointer (&bridge_vlans);
 
-		if (vf->min_tx_rate || vf->max_tx_rate) {
-			struct _ifla_vf_rate ivr = { 0 };
+	states = g_hash_table_lookup (priv->bridge_vlans, GINT_TO_POINTER (ifindex));
+	if (!states)
+		return FALSE;
+	memcpy (vlan_states, states, BRIDGE_VLAN_VID_MAX + 1);
+	return TRUE;
 
-			ivr.vf = vf->index;
-			ivr.min_tx_rate = vf->min_tx_rate;
-			ivr.max_tx_rate = vf->max_tx_rate;
-			NLA_PUT (nlmsg, IFLA_VF_RATE, sizeof (ivr), &ivr);
-		}
+nla_put_failure:
+	g_return_val_if_reached (FALSE);
+}
 
-		/* Kernel only supports one VLAN per VF now. If this
-		 * changes in the future, we need to figure out how to
-		 * clear existing VLANs and set new ones in one message
-		 * with the new API.*/
-		if (vf->num_vlans > 1) {
-			_LOGW ("multiple VLANs per VF are not supported at the moment");
-			return FALSE;
-		} else {
-			struct _ifla_vf_vlan_info ivvi = { 0 };
+static gboolean
+_bridge_vlans_put_range (struct nl_msg *nlmsg,
+                         guint16 vid_start,
+                         guint16 vid_end,
+                         guint8 state)
+{
+	struct bridge_vlan_info vinfo = { };
+	guint16 flags = 0;
 
-			if (!(vlan_list = nla_nest_start (nlmsg, IFLA_VF_VLAN_LIST)))
-				goto nla_put_failure;
+	if (NM_FLAGS_HAS (state, BRIDGE_VLAN_STATE_UNTAGGED))
+		flags |= BRIDGE_VLAN_INFO_UNTAGGED;
+	if (NM_FLAGS_HAS (state, BRIDGE_VLAN_STATE_PVID))
+		flags |= BRIDGE_VLAN_INFO_PVID;
 
-			ivvi.vf = vf->index;
-			if (vf->num_vlans == 1) {
-				ivvi.vlan = vf->vlans[0].id;
-				ivvi.qos = vf->vlans[0].qos;
-				ivvi.vlan_proto = htons (vf->vlans[0].proto_ad ? ETH_P_8021AD : ETH_P_8021Q);
-			} else {
-				/* Clear existing VLAN */
-				ivvi.vlan = 0;
-				ivvi.qos = 0;
-				ivvi.vlan_proto = htons (ETH_P_8021Q);
-			}
+	nm_assert (vid_start <= vid_end);
+	nm_assert (vid_start == vid_end || !NM_FLAGS_HAS (flags, BRIDGE_VLAN_INFO_PVID));
 
-			NLA_PUT (nlmsg, IFLA_VF_VLAN_INFO, sizeof (ivvi), &ivvi);
-			nla_nest_end (nlmsg, vlan_list);
-		}
-		nla_nest_end (nlmsg, info);
+	vinfo.vid = vid_start;
+	vinfo.flags = flags | (vid_start != vid_end ? BRIDGE_VLAN_INFO_RANGE_BEGIN : 0);
+	NLA_PUT (nlmsg, IFLA_BRIDGE_VLAN_INFO, sizeof (vinfo), &vinfo);
+
+	if (vid_start != vid_end) {
+		vinfo.vid = vid_end;
+		vinfo.flags = flags | BRIDGE_VLAN_INFO_RANGE_END;
+		NLA_PUT (nlmsg, IFLA_BRIDGE_VLAN_INFO, sizeof (vinfo), &vinfo);
 	}
-	nla_nest_end (nlmsg, list);
+	return TRUE;
 
-	return (do_change_link (platform, CHANGE_LINK_TYPE_UNSPEC, ifindex, nlmsg, NULL) >= 0);
 nla_put_failure:
-	g_return_val_if_reached (FALSE);
+	return FALSE;
 }
 
 static gboolean
 link_set_bridge_vlans (NMPlatform *platform,
                        int ifindex,
                        gboolean on_master,
-                       const NMPlatformBridgeVlan *const *vlans)
+                       const NMPlatformBridgeVlan *const *vlans,
+                       gboolean flush)
 {
 	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
+	gs_free guint8 *vlan_states_have = NULL;
+	gs_free guint8 *vlan_states_want = NULL;
+	gboolean have_valid;
 	struct nlattr *list;
-	struct bridge_vlan_info vinfo = { };
+	guint n_ranges = 0;
+	guint vid_start = 0;
+	guint8 state_start = 0;
+	guint vid;
 	guint i;
 
-	nlmsg = _nl_msg_new_link_full (vlans ? RTM_SETLINK : RTM_DELLINK,
+	/* the current VLANs of the port. Only the difference is sent to kernel. */
+	vlan_states_have = g_malloc (BRIDGE_VLAN_VID_MAX + 1);
+	have_valid = _bridge_vlans_get (platform, ifindex, vlan_states_have);
+
+	nlmsg = _nl_msg_new_link_full (flush ? RTM_DELLINK : RTM_SETLINK,
 	                               0,
 	                               ifindex,
 	                               NULL,
@@ -7090,42 +10669,77 @@ link_set_bridge_vlans (NMPlatform *platform,
 	             IFLA_BRIDGE_FLAGS,
 	             on_master ? BRIDGE_FLAGS_MASTER : BRIDGE_FLAGS_SELF);
 
-	if (vlans) {
-		/* Add VLANs */
-		for (i = 0; vlans[i]; i++) {
-			const NMPlatformBridgeVlan *vlan = vlans[i];
-			gboolean is_range = vlan->vid_start != vlan->vid_end;
+	vlan_states_want = g_malloc0 (BRIDGE_VLAN_VID_MAX + 1);
+	for (i = 0; vlans && vlans[i]; i++) {
+		const NMPlatformBridgeVlan *vlan = vlans[i];
+		guint8 state = BRIDGE_VLAN_STATE_PRESENT;
 
-			vinfo.vid = vlan->vid_start;
-			vinfo.flags = is_range ? BRIDGE_VLAN_INFO_RANGE_BEGIN : 0;
+		if (vlan->untagged)
+			state |= BRIDGE_VLAN_STATE_UNTAGGED;
+		if (vlan->pvid)
+			state |= BRIDGE_VLAN_STATE_PVID;
 
-			if (vlan->untagged)
-				vinfo.flags |= BRIDGE_VLAN_INFO_UNTAGGED;
-			if (vlan->pvid)
-				vinfo.flags |= BRIDGE_VLAN_INFO_PVID;
+		for (vid = NM_MAX (vlan->vid_start, 1); vid <= NM_MIN (vlan->vid_end, BRIDGE_VLAN_VID_MAX); vid++)
+			vlan_states_want[vid] = state;
+	}
+
+	if (   flush
+	    && !have_valid) {
+		/* we don't know which VLANs exist. Delete them all. */
+		if (!_bridge_vlans_put_range (nlmsg, 1, BRIDGE_VLAN_VID_MAX, 0))
+			goto nla_put_failure;
+		n_ranges++;
+	} else {
+		/* Adjacent VLANs with the same flags are merged to ranges. On add, VLANs that
+		 * already exist with the same flags are skipped. On flush, all present VLANs
+		 * are deleted, except for those in @vlans that already exist with the same flags. */
+		for (vid = 1; vid <= BRIDGE_VLAN_VID_MAX + 1; vid++) {
+			guint8 state = 0;
+
+			if (vid <= BRIDGE_VLAN_VID_MAX) {
+				if (!flush) {
+					state = vlan_states_want[vid];
+					if (   have_valid
+					    && state == vlan_states_have[vid])
+						state = 0;
+				} else if (   vlan_states_have[vid]
+				           && vlan_states_have[vid] != vlan_states_want[vid]) {
+					/* deleted regardless of their flags. */
+					state = BRIDGE_VLAN_STATE_PRESENT;
+				}
+			}
 
-			NLA_PUT (nlmsg, IFLA_BRIDGE_VLAN_INFO, sizeof (vinfo), &vinfo);
+			if (   vid_start != 0
+			    && (   state != state_start
+			        || NM_FLAGS_HAS (state, BRIDGE_VLAN_STATE_PVID))) {
+				/* the range ends. A PVID can't be part of a range. */
+				if (!_bridge_vlans_put_range (nlmsg, vid_start, vid - 1, flush ? 0 : state_start))
+					goto nla_put_failure;
+				n_ranges++;
+				vid_start = 0;
+			}
 
-			if (is_range) {
-				vinfo.vid = vlan->vid_end;
-				vinfo.flags = BRIDGE_VLAN_INFO_RANGE_END;
-				NLA_PUT (nlmsg, IFLA_BRIDGE_VLAN_INFO, sizeof (vinfo), &vinfo);
+			if (   state != 0
+			    && vid_start == 0) {
+				vid_start = vid;
+				state_start = state;
 			}
 		}
-	} else {
-		/* Flush existing VLANs */
-		vinfo.vid = 1;
-		vinfo.flags = BRIDGE_VLAN_INFO_RANGE_BEGIN;
-		NLA_PUT (nlmsg, IFLA_BRIDGE_VLAN_INFO, sizeof (vinfo), &vinfo);
+	}
 
-		vinfo.vid = 4094;
-		vinfo.flags = BRIDGE_VLAN_INFO_RANGE_END;
-		NLA_PUT (nlmsg, IFLA_BRIDGE_VLAN_INFO, sizeof (vinfo), &vinfo);
+	if (n_ranges == 0) {
+		_LOGD ("link: bridge VLANs on %d are already up to date", ifindex);
+		return TRUE;
 	}
 
 	nla_nest_end (nlmsg, list);
 
-	return (do_change_link (platform, CHANGE_LINK_TYPE_UNSPEC, ifindex, nlmsg, NULL) >= 0);
+	if (do_change_link (platform, CHANGE_LINK_TYPE_UNSPEC, ifindex, nlmsg, NULL) < 0) {
+		/* kernel might have applied a part of the change. */
+		_bridge_vlans_invalidate (platform);
+		return FALSE;
+	}
+	return TRUE;
 nla_put_failure:
 	g_return_val_if_reached (FALSE);
 }
@@ -8333,6 +11947,245 @@ ip_route_add (NMPlatform *platform,
 	                         NM_FLAGS_HAS (flags, NMP_NLM_FLAG_SUPPRESS_NETLINK_FAILURE));
 }
 
+static void
+_ip_route_many (NMPlatform *platform,
+                int nlmsg_type,
+                NMPNlmFlags flags,
+                const NMPObject *const*routes,
+                guint len,
+                int *out_results)
+{
+	gs_free NMPObject *objs = NULL;
+	gs_free const NMPObject **obj_ids = NULL;
+	gs_free struct nl_msg **nlmsgs = NULL;
+	gs_free guint *idx = NULL;
+	gs_free int *results = NULL;
+	guint n_msgs = 0;
+	guint i;
+
+	nm_assert (NM_IN_SET (nlmsg_type, RTM_NEWROUTE, RTM_DELROUTE));
+	nm_assert (len > 0);
+
+	objs = g_new (NMPObject, len);
+	obj_ids = g_new (const NMPObject *, len);
+	nlmsgs = g_new (struct nl_msg *, len);
+	idx = g_new (guint, len);
+
+	for (i = 0; i < len; i++) {
+		NMPObject *obj = &objs[i];
+
+		nmp_object_stackinit_obj (obj, routes[i]);
+
+		/* the stack object only borrows the nexthops of ECMP routes. */
+		if (NMP_OBJECT_GET_TYPE (obj) == NMP_OBJECT_TYPE_IP4_ROUTE)
+			obj->_ip4_route.extra_nexthops = routes[i]->_ip4_route.extra_nexthops;
+		else
+			obj->_ip6_route.extra_nexthops = routes[i]->_ip6_route.extra_nexthops;
+
+		if (nlmsg_type == RTM_NEWROUTE) {
+			nm_platform_ip_route_normalize (NMP_OBJECT_GET_TYPE (obj) == NMP_OBJECT_TYPE_IP4_ROUTE
+			                                  ? AF_INET
+			                                  : AF_INET6,
+			                                NMP_OBJECT_CAST_IP_ROUTE (obj));
+		}
+
+		nlmsgs[n_msgs] = _nl_msg_new_route (nlmsg_type,
+		                                    nlmsg_type == RTM_NEWROUTE ? (flags & NMP_NLM_FLAG_FMASK) : 0,
+		                                    obj);
+		if (!nlmsgs[n_msgs]) {
+			nm_assert_not_reached ();
+			if (out_results)
+				out_results[i] = -NME_BUG;
+			continue;
+		}
+		obj_ids[n_msgs] = obj;
+		idx[n_msgs] = i;
+		n_msgs++;
+	}
+
+	if (n_msgs > 0) {
+		if (out_results)
+			results = g_new (int, n_msgs);
+
+		do_addrroute_batch (platform,
+		                    obj_ids,
+		                    nlmsgs,
+		                    n_msgs,
+		                    nlmsg_type == RTM_DELROUTE,
+		                    NM_FLAGS_HAS (flags, NMP_NLM_FLAG_SUPPRESS_NETLINK_FAILURE),
+		                    results);
+
+		for (i = 0; i < n_msgs; i++) {
+			if (out_results)
+				out_results[idx[i]] = results[i];
+			nlmsg_free (nlmsgs[i]);
+		}
+	}
+}
+
+static void
+ip_route_add_many (NMPlatform *platform,
+                   NMPNlmFlags flags,
+                   const NMPObject *const*routes,
+                   guint len,
+                   int *out_results)
+{
+	_ip_route_many (platform, RTM_NEWROUTE, flags, routes, len, out_results);
+}
+
+static void
+ip_route_delete_many (NMPlatform *platform,
+                      const NMPObject *const*routes,
+                      guint len)
+{
+	_ip_route_many (platform, RTM_DELROUTE, 0, routes, len, NULL);
+}
+
+/* the BPF program can only compare a limited number of values, because
+ * the jump offsets are 8 bit. */
+#define ROUTE_IGNORE_BPF_MAX_CHECKS 200
+
+static void
+route_ignore_changed (NMPlatform *platform)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	const NMPlatformRouteIgnore *ri = nm_platform_route_ignore_get (platform);
+	NMPCache *cache = nm_platform_get_cache (platform);
+	gs_free struct sock_filter *prog = NULL;
+	guint n_tables = 0;
+	guint n_checks;
+	guint n_prog;
+	guint i_accept;
+	guint i_drop;
+	guint i;
+	guint n;
+	int nle;
+
+	/* Install a socket filter on the event socket that drops route notifications
+	 * of ignored protocols and tables in kernel, before they are queued.
+	 *
+	 * Notifications are sent as one message per skb. That is not the case
+	 * for dumps, where the filter could only accept or drop a whole batch of
+	 * routes. Hence, dumps and replies to our requests on the request socket are
+	 * not filtered, and the ignored routes get dropped by
+	 * route_ignore_msg_is_ignored() before parsing. Notifications about changes
+	 * that we made carry the port of the request socket and are accepted too.
+	 *
+	 * Tables >= 256 are only in the RTA_TABLE attribute, which the filter cannot
+	 * find. Those are also only dropped in user space. */
+	for (i = 0; i < ri->n_tables; i++) {
+		if (ri->tables[i] < 256)
+			n_tables++;
+	}
+	n_checks = ri->n_protocols + n_tables;
+
+	if (n_checks == 0 || n_checks > ROUTE_IGNORE_BPF_MAX_CHECKS) {
+		if (n_checks > 0)
+			_LOGW ("route-ignore: too many protocols and tables to filter in kernel");
+		nle = nl_socket_detach_filter (priv->nlh_event);
+		if (nle < 0)
+			_LOGW ("route-ignore: failure to detach socket filter: %s", nm_strerror (nle));
+	} else {
+		n_prog = 5 + ri->n_protocols + (n_tables > 0 ? 1 + n_tables : 0) + 2;
+		i_accept = n_prog - 2;
+		i_drop = n_prog - 1;
+		prog = g_new (struct sock_filter, n_prog);
+
+#define _JUMP_TO(i_target)  ((guint8) ((i_target) - n - 1))
+
+		n = 0;
+		prog[n] = (struct sock_filter) BPF_STMT (BPF_LD | BPF_H | BPF_ABS, G_STRUCT_OFFSET (struct nlmsghdr, nlmsg_type));
+		n++;
+		prog[n] = (struct sock_filter) BPF_JUMP (BPF_JMP | BPF_JEQ | BPF_K, htons (RTM_NEWROUTE), 1, 0);
+		n++;
+		prog[n] = (struct sock_filter) BPF_JUMP (BPF_JMP | BPF_JEQ | BPF_K, htons (RTM_DELROUTE), 0, _JUMP_TO (i_accept));
+		n++;
+		prog[n] = (struct sock_filter) BPF_STMT (BPF_LD | BPF_W | BPF_ABS, G_STRUCT_OFFSET (struct nlmsghdr, nlmsg_pid));
+		n++;
+		prog[n] = (struct sock_filter) BPF_JUMP (BPF_JMP | BPF_JEQ | BPF_K, htonl (nl_socket_get_local_port (priv->nlh)), _JUMP_TO (i_accept), 0);
+		n++;
+
+		if (ri->n_protocols > 0) {
+			prog[n] = (struct sock_filter) BPF_STMT (BPF_LD | BPF_B | BPF_ABS, NLMSG_HDRLEN + G_STRUCT_OFFSET (struct rtmsg, rtm_protocol));
+			n++;
+			for (i = 0; i < 256; i++) {
+				if (!NM_FLAGS_HAS (ri->protocols[i / 32], 1u << (i % 32)))
+					continue;
+				prog[n] = (struct sock_filter) BPF_JUMP (BPF_JMP | BPF_JEQ | BPF_K, i, _JUMP_TO (i_drop), 0);
+				n++;
+			}
+		}
+		if (n_tables > 0) {
+			prog[n] = (struct sock_filter) BPF_STMT (BPF_LD | BPF_B | BPF_ABS, NLMSG_HDRLEN + G_STRUCT_OFFSET (struct rtmsg, rtm_table));
+			n++;
+			for (i = 0; i < ri->n_tables; i++) {
+				if (ri->tables[i] >= 256)
+					continue;
+				prog[n] = (struct sock_filter) BPF_JUMP (BPF_JMP | BPF_JEQ | BPF_K, ri->tables[i], _JUMP_TO (i_drop), 0);
+				n++;
+			}
+		}
+
+#undef _JUMP_TO
+
+		nm_assert (n == i_accept);
+		prog[n++] = (struct sock_filter) BPF_STMT (BPF_RET | BPF_K, 0xFFFFFFFFu);
+		prog[n++] = (struct sock_filter) BPF_STMT (BPF_RET | BPF_K, 0);
+		nm_assert (n == n_prog);
+
+		nle = nl_socket_attach_filter (priv->nlh_event, prog, n_prog);
+		if (nle < 0)
+			_LOGW ("route-ignore: failure to attach socket filter: %s", nm_strerror (nle));
+		else
+			_LOGD ("route-ignore: attached socket filter with %u instructions", n_prog);
+	}
+
+	/* drop the ignored routes that are already in the cache. */
+	for (i = 0; i < 2; i++) {
+		gs_unref_ptrarray GPtrArray *to_remove = NULL;
+		const NMPObjectType obj_type = i == 0
+		                               ? NMP_OBJECT_TYPE_IP4_ROUTE
+		                               : NMP_OBJECT_TYPE_IP6_ROUTE;
+		NMDedupMultiIter iter;
+		const NMPObject *obj;
+		NMPLookup lookup;
+		guint n_lookups;
+		guint k;
+		guint j;
+
+		/* if only tables are ignored, only the routes of these tables
+		 * need checking. Otherwise, check them all. */
+		n_lookups = ri->n_protocols == 0 ? ri->n_tables : 1u;
+
+		for (k = 0; k < n_lookups; k++) {
+			if (ri->n_protocols == 0)
+				nmp_lookup_init_route_by_table (&lookup, obj_type, ri->tables[k]);
+			else
+				nmp_lookup_init_obj_type (&lookup, obj_type);
+			nm_dedup_multi_iter_for_each (&iter, nmp_cache_lookup (cache, &lookup)) {
+				obj = iter.current->obj;
+				if (!nm_platform_route_ignore_check_route (platform, NMP_OBJECT_CAST_IP_ROUTE (obj)))
+					continue;
+				if (!to_remove)
+					to_remove = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
+				g_ptr_array_add (to_remove, (gpointer) nmp_object_ref (obj));
+			}
+		}
+		if (!to_remove)
+			continue;
+		for (j = 0; j < to_remove->len; j++) {
+			nm_auto_nmpobj const NMPObject *obj_old = NULL;
+			NMPCacheOpsType cache_op;
+
+			cache_op = nmp_cache_remove (cache, to_remove->pdata[j], TRUE, TRUE, &obj_old);
+			if (cache_op == NMP_CACHE_OPS_UNCHANGED)
+				continue;
+			cache_on_change (platform, cache_op, obj_old, NULL);
+			nm_platform_cache_update_emit_signal (platform, cache_op, obj_old, NULL);
+		}
+	}
+}
+
 static gboolean
 object_delete (NMPlatform *platform,
                const NMPObject *obj)
@@ -8357,13 +12210,199 @@ object_delete (NMPlatform *platform,
 	case NMP_OBJECT_TYPE_TFILTER:
 		nlmsg = _nl_msg_new_tfilter (RTM_DELTFILTER, 0, NMP_OBJECT_CAST_TFILTER (obj));
 		break;
+	case NMP_OBJECT_TYPE_IP4_NEXTHOP:
+	case NMP_OBJECT_TYPE_IP6_NEXTHOP:
+		nlmsg = _nl_msg_new_nexthop (RTM_DELNEXTHOP, 0, obj);
+		break;
+	default:
+		break;
+	}
+
+	if (!nlmsg)
+		g_return_val_if_reached (FALSE);
+	return do_delete_object (platform, obj, nlmsg);
+}
+
+static guint32
+object_add_async (NMPlatform *platform,
+                  NMPNlmFlags flags,
+                  const NMPObject *obj,
+                  NMPlatformAsyncCallback callback,
+                  gpointer callback_data,
+                  GCancellable *cancellable)
+{
+	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
+	NMPObject obj_stack;
+	const int nlmsg_flags = flags & NMP_NLM_FLAG_FMASK;
+
+	switch (NMP_OBJECT_GET_TYPE (obj)) {
+	case NMP_OBJECT_TYPE_IP4_ADDRESS: {
+		const NMPlatformIP4Address *a = NMP_OBJECT_CAST_IP4_ADDRESS (obj);
+		guint32 lifetime, preferred;
+
+		lifetime = nm_utils_lifetime_get (a->timestamp, a->lifetime, a->preferred,
+		                                  nm_utils_get_monotonic_timestamp_s (), &preferred);
+		nlmsg = _nl_msg_new_address (RTM_NEWADDR,
+		                             NLM_F_CREATE | NLM_F_REPLACE,
+		                             AF_INET,
+		                             a->ifindex,
+		                             &a->address,
+		                             a->plen,
+		                             &a->peer_address,
+		                             a->n_ifa_flags,
+		                             nm_utils_ip4_address_is_link_local (a->address) ? RT_SCOPE_LINK : RT_SCOPE_UNIVERSE,
+		                             lifetime,
+		                             preferred,
+		                             a->label);
+		break;
+	}
+	case NMP_OBJECT_TYPE_IP6_ADDRESS: {
+		const NMPlatformIP6Address *a = NMP_OBJECT_CAST_IP6_ADDRESS (obj);
+		guint32 lifetime, preferred;
+
+		lifetime = nm_utils_lifetime_get (a->timestamp, a->lifetime, a->preferred,
+		                                  nm_utils_get_monotonic_timestamp_s (), &preferred);
+		nlmsg = _nl_msg_new_address (RTM_NEWADDR,
+		                             NLM_F_CREATE | NLM_F_REPLACE,
+		                             AF_INET6,
+		                             a->ifindex,
+		                             &a->address,
+		                             a->plen,
+		                             IN6_IS_ADDR_UNSPECIFIED (&a->peer_address) ? NULL : &a->peer_address,
+		                             a->n_ifa_flags,
+		                             RT_SCOPE_UNIVERSE,
+		                             lifetime,
+		                             preferred,
+		                             NULL);
+		break;
+	}
+	case NMP_OBJECT_TYPE_IP4_ROUTE:
+	case NMP_OBJECT_TYPE_IP6_ROUTE:
+		nmp_object_stackinit_obj (&obj_stack, obj);
+
+		/* the stack object only borrows the nexthops of ECMP routes. */
+		if (NMP_OBJECT_GET_TYPE (obj) == NMP_OBJECT_TYPE_IP4_ROUTE)
+			obj_stack._ip4_route.extra_nexthops = obj->_ip4_route.extra_nexthops;
+		else
+			obj_stack._ip6_route.extra_nexthops = obj->_ip6_route.extra_nexthops;
+
+		nm_platform_ip_route_normalize (NMP_OBJECT_GET_CLASS (obj)->addr_family,
+		                                NMP_OBJECT_CAST_IP_ROUTE (&obj_stack));
+		nlmsg = _nl_msg_new_route (RTM_NEWROUTE, nlmsg_flags, &obj_stack);
+		break;
+	case NMP_OBJECT_TYPE_IP4_NEXTHOP:
+	case NMP_OBJECT_TYPE_IP6_NEXTHOP:
+		nlmsg = _nl_msg_new_nexthop (RTM_NEWNEXTHOP, nlmsg_flags, obj);
+		break;
+	case NMP_OBJECT_TYPE_ROUTING_RULE:
+		nlmsg = _nl_msg_new_routing_rule (RTM_NEWRULE, nlmsg_flags, NMP_OBJECT_CAST_ROUTING_RULE (obj));
+		break;
+	case NMP_OBJECT_TYPE_QDISC:
+		nlmsg = _nl_msg_new_qdisc (RTM_NEWQDISC, nlmsg_flags, NMP_OBJECT_CAST_QDISC (obj));
+		break;
+	case NMP_OBJECT_TYPE_TFILTER:
+		nlmsg = _nl_msg_new_tfilter (RTM_NEWTFILTER, nlmsg_flags, NMP_OBJECT_CAST_TFILTER (obj));
+		break;
+	default:
+		break;
+	}
+
+	if (!nlmsg)
+		g_return_val_if_reached (0);
+	return _nl_send_nlmsg_async (platform, nlmsg, obj, FALSE, callback, callback_data, cancellable);
+}
+
+static guint32
+object_delete_async (NMPlatform *platform,
+                     const NMPObject *obj,
+                     NMPlatformAsyncCallback callback,
+                     gpointer callback_data,
+                     GCancellable *cancellable)
+{
+	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
+
+	switch (NMP_OBJECT_GET_TYPE (obj)) {
+	case NMP_OBJECT_TYPE_LINK:
+		nlmsg = _nl_msg_new_link (RTM_DELLINK, 0, obj->link.ifindex, NULL);
+		break;
+	case NMP_OBJECT_TYPE_IP4_ADDRESS:
+		nlmsg = _nl_msg_new_address (RTM_DELADDR,
+		                             0,
+		                             AF_INET,
+		                             obj->ip4_address.ifindex,
+		                             &obj->ip4_address.address,
+		                             obj->ip4_address.plen,
+		                             &obj->ip4_address.peer_address,
+		                             0,
+		                             RT_SCOPE_NOWHERE,
+		                             NM_PLATFORM_LIFETIME_PERMANENT,
+		                             NM_PLATFORM_LIFETIME_PERMANENT,
+		                             NULL);
+		break;
+	case NMP_OBJECT_TYPE_IP6_ADDRESS:
+		nlmsg = _nl_msg_new_address (RTM_DELADDR,
+		                             0,
+		                             AF_INET6,
+		                             obj->ip6_address.ifindex,
+		                             &obj->ip6_address.address,
+		                             obj->ip6_address.plen,
+		                             NULL,
+		                             0,
+		                             RT_SCOPE_NOWHERE,
+		                             NM_PLATFORM_LIFETIME_PERMANENT,
+		                             NM_PLATFORM_LIFETIME_PERMANENT,
+		                             NULL);
+		break;
+	case NMP_OBJECT_TYPE_IP4_ROUTE:
+	case NMP_OBJECT_TYPE_IP6_ROUTE:
+		nlmsg = _nl_msg_new_route (RTM_DELROUTE, 0, obj);
+		break;
+	case NMP_OBJECT_TYPE_IP4_NEXTHOP:
+	case NMP_OBJECT_TYPE_IP6_NEXTHOP:
+		nlmsg = _nl_msg_new_nexthop (RTM_DELNEXTHOP, 0, obj);
+		break;
+	case NMP_OBJECT_TYPE_ROUTING_RULE:
+		nlmsg = _nl_msg_new_routing_rule (RTM_DELRULE, 0, NMP_OBJECT_CAST_ROUTING_RULE (obj));
+		break;
+	case NMP_OBJECT_TYPE_QDISC:
+		nlmsg = _nl_msg_new_qdisc (RTM_DELQDISC, 0, NMP_OBJECT_CAST_QDISC (obj));
+		break;
+	case NMP_OBJECT_TYPE_TFILTER:
+		nlmsg = _nl_msg_new_tfilter (RTM_DELTFILTER, 0, NMP_OBJECT_CAST_TFILTER (obj));
+		break;
 	default:
 		break;
 	}
 
 	if (!nlmsg)
-		g_return_val_if_reached (FALSE);
-	return do_delete_object (platform, obj, nlmsg);
+		g_return_val_if_reached (0);
+	return _nl_send_nlmsg_async (platform, nlmsg, obj, TRUE, callback, callback_data, cancellable);
+}
+
+static guint32
+link_change_flags_async (NMPlatform *platform,
+                         int ifindex,
+                         unsigned flags_mask,
+                         unsigned flags_set,
+                         NMPlatformAsyncCallback callback,
+                         gpointer callback_data,
+                         GCancellable *cancellable)
+{
+	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
+	NMPObject obj_id;
+
+	nlmsg = _nl_msg_new_link_full (RTM_NEWLINK,
+	                               0,
+	                               ifindex,
+	                               NULL,
+	                               AF_UNSPEC,
+	                               flags_mask,
+	                               flags_set);
+	if (!nlmsg)
+		g_return_val_if_reached (0);
+
+	nmp_object_stackinit_id_link (&obj_id, ifindex);
+	return _nl_send_nlmsg_async (platform, nlmsg, &obj_id, FALSE, callback, callback_data, cancellable);
 }
 
 /*****************************************************************************/
@@ -8447,6 +12486,37 @@ ip_route_get (NMPlatform *platform,
 
 /*****************************************************************************/
 
+static int
+ip_nexthop_add (NMPlatform *platform,
+                NMPNlmFlags flags,
+                int addr_family,
+                const NMPlatformIPNexthop *nexthop)
+{
+	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
+	NMPObject obj;
+
+	switch (addr_family) {
+	case AF_INET:
+		nmp_object_stackinit (&obj, NMP_OBJECT_TYPE_IP4_NEXTHOP, (const NMPlatformObject *) nexthop);
+		break;
+	case AF_INET6:
+		nmp_object_stackinit (&obj, NMP_OBJECT_TYPE_IP6_NEXTHOP, (const NMPlatformObject *) nexthop);
+		break;
+	default:
+		nm_assert_not_reached ();
+	}
+
+	nlmsg = _nl_msg_new_nexthop (RTM_NEWNEXTHOP, flags & NMP_NLM_FLAG_FMASK, &obj);
+	if (!nlmsg)
+		g_return_val_if_reached (-NME_BUG);
+	return do_add_addrroute (platform,
+	                         &obj,
+	                         nlmsg,
+	                         NM_FLAGS_HAS (flags, NMP_NLM_FLAG_SUPPRESS_NETLINK_FAILURE));
+}
+
+/*****************************************************************************/
+
 static int
 routing_rule_add (NMPlatform *platform,
                   NMPNlmFlags flags,
@@ -8567,35 +12637,627 @@ tfilter_add (NMPlatform *platform,
 	        "do-add-tfilter: %s",
 	        wait_for_nl_response_to_string (seq_result, errmsg, s_buf, sizeof (s_buf)));
 
-	if (seq_result == WAIT_FOR_NL_RESPONSE_RESULT_RESPONSE_OK)
-		return 0;
+	if (seq_result == WAIT_FOR_NL_RESPONSE_RESULT_RESPONSE_OK)
+		return 0;
+
+	return -NME_UNSPEC;
+}
+
+/*****************************************************************************/
+
+#define EVENT_CONDITIONS      ((GIOCondition) (G_IO_IN | G_IO_PRI))
+#define ERROR_CONDITIONS      ((GIOCondition) (G_IO_ERR | G_IO_NVAL))
+#define DISCONNECT_CONDITIONS ((GIOCondition) (G_IO_HUP))
+
+static void
+_nl_get_recv_stats (NMLinuxPlatformPrivate *priv, struct nl_recv_stats *out_stats)
+{
+	struct nl_recv_stats stats_event;
+
+	nl_socket_get_recv_stats (priv->nlh, out_stats);
+	if (priv->event_worker) {
+		g_mutex_lock (&priv->event_worker->lock);
+		nl_socket_get_recv_stats (priv->nlh_event, &stats_event);
+		g_mutex_unlock (&priv->event_worker->lock);
+	} else
+		nl_socket_get_recv_stats (priv->nlh_event, &stats_event);
+	out_stats->n_syscalls += stats_event.n_syscalls;
+	out_stats->n_datagrams += stats_event.n_datagrams;
+	out_stats->n_bytes += stats_event.n_bytes;
+}
+
+static gboolean
+event_handler (GIOChannel *channel,
+               GIOCondition io_condition,
+               gpointer user_data)
+{
+	NMPlatform *platform = NM_PLATFORM (user_data);
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	struct nl_recv_stats stats_before;
+	struct nl_recv_stats stats;
+	guint64 n_messages_before;
+
+	_nl_get_recv_stats (priv, &stats_before);
+	n_messages_before = priv->nl_stats.n_messages;
+
+	priv->nl_stats.n_wakeups++;
+	delayed_action_handle_all (platform, TRUE);
+
+	if (_LOGt_ENABLED ()) {
+		_nl_get_recv_stats (priv, &stats);
+		_LOGt ("netlink: wakeup #%"G_GUINT64_FORMAT": received %"G_GUINT64_FORMAT" messages in %"G_GUINT64_FORMAT" datagrams (%"G_GUINT64_FORMAT" bytes) with %"G_GUINT64_FORMAT" syscalls",
+		       priv->nl_stats.n_wakeups,
+		       priv->nl_stats.n_messages - n_messages_before,
+		       stats.n_datagrams - stats_before.n_datagrams,
+		       stats.n_bytes - stats_before.n_bytes,
+		       stats.n_syscalls - stats_before.n_syscalls);
+	}
+	return TRUE;
+}
+
+/*****************************************************************************/
+
+static DelayedActionType
+event_msg_get_refresh_type (struct nlmsghdr *hdr, int *out_ifindex)
+{
+	DelayedActionType action_type = DELAYED_ACTION_TYPE_NONE;
+	int ifindex = 0;
+
+	/* Only look at the header, because this is also called while draining
+	 * the socket without parsing the messages. */
+	switch (hdr->nlmsg_type) {
+	case RTM_NEWLINK:
+	case RTM_DELLINK:
+		action_type = DELAYED_ACTION_TYPE_REFRESH_ALL_LINKS;
+		break;
+	case RTM_NEWADDR:
+	case RTM_DELADDR:
+		if (nlmsg_valid_hdr (hdr, sizeof (struct ifaddrmsg))) {
+			const struct ifaddrmsg *ifa = nlmsg_data (hdr);
+
+			if (ifa->ifa_family == AF_INET)
+				action_type = DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_ADDRESSES;
+			else if (ifa->ifa_family == AF_INET6)
+				action_type = DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ADDRESSES;
+			ifindex = ifa->ifa_index;
+		}
+		break;
+	case RTM_NEWROUTE:
+	case RTM_DELROUTE:
+		if (nlmsg_valid_hdr (hdr, sizeof (struct rtmsg))) {
+			const struct rtmsg *rtm = nlmsg_data (hdr);
+			struct nlattr *nla;
+
+			if (rtm->rtm_family == AF_INET)
+				action_type = DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_ROUTES;
+			else if (rtm->rtm_family == AF_INET6)
+				action_type = DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ROUTES;
+			nla = nlmsg_find_attr (hdr, sizeof (struct rtmsg), RTA_OIF);
+			if (nla && nla_len (nla) >= (int) sizeof (guint32))
+				ifindex = nla_get_u32 (nla);
+		}
+		break;
+	case RTM_NEWRULE:
+	case RTM_DELRULE:
+		if (nlmsg_valid_hdr (hdr, sizeof (struct fib_rule_hdr))) {
+			const struct fib_rule_hdr *frh = nlmsg_data (hdr);
+
+			if (frh->family == AF_INET)
+				action_type = DELAYED_ACTION_TYPE_REFRESH_ALL_ROUTING_RULES_IP4;
+			else if (frh->family == AF_INET6)
+				action_type = DELAYED_ACTION_TYPE_REFRESH_ALL_ROUTING_RULES_IP6;
+		}
+		break;
+	case RTM_NEWQDISC:
+	case RTM_DELQDISC:
+		action_type = DELAYED_ACTION_TYPE_REFRESH_ALL_QDISCS;
+		break;
+	case RTM_NEWTFILTER:
+	case RTM_DELTFILTER:
+		action_type = DELAYED_ACTION_TYPE_REFRESH_ALL_TFILTERS;
+		break;
+	case RTM_NEWNEXTHOP:
+	case RTM_DELNEXTHOP:
+		if (nlmsg_valid_hdr (hdr, sizeof (struct nhmsg))) {
+			const struct nhmsg *nhm = nlmsg_data (hdr);
+
+			if (nhm->nh_family == AF_INET)
+				action_type = DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_NEXTHOPS;
+			else if (nhm->nh_family == AF_INET6)
+				action_type = DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_NEXTHOPS;
+		}
+		break;
+	}
+
+	NM_SET_OUT (out_ifindex, ifindex);
+	return action_type;
+}
+
+static void
+resync_note_event (NMPlatform *platform, struct nlmsghdr *hdr)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	DelayedActionType action_type;
+	int ifindex;
+	gint64 now_ns;
+	guint i;
+
+	/* Remember which object types had events recently. */
+	action_type = event_msg_get_refresh_type (hdr, &ifindex);
+
+	if (action_type == DELAYED_ACTION_TYPE_NONE)
+		return;
+
+	now_ns = nm_utils_get_monotonic_timestamp_ns ();
+	if (now_ns - priv->resync.window_start_ns > RESYNC_HOT_WINDOW_NSEC) {
+		priv->resync.hot_types = DELAYED_ACTION_TYPE_NONE;
+		priv->resync.hot_types_full = DELAYED_ACTION_TYPE_NONE;
+		priv->resync.n_ifindexes = 0;
+		priv->resync.window_start_ns = now_ns;
+	}
+
+	priv->resync.hot_types |= action_type;
+
+	if (   !NM_FLAGS_ANY (action_type, DELAYED_ACTION_TYPE_REFRESH_ALL_BY_IFINDEX)
+	    || NM_FLAGS_ANY (priv->resync.hot_types_full, action_type))
+		return;
+
+	if (ifindex <= 0) {
+		/* e.g. blackhole or multipath routes. */
+		priv->resync.hot_types_full |= action_type;
+		return;
+	}
+
+	for (i = 0; i < priv->resync.n_ifindexes; i++) {
+		if (priv->resync.ifindexes[i] == ifindex)
+			return;
+	}
+
+	if (priv->resync.n_ifindexes >= RESYNC_HOT_IFINDEXES_MAX) {
+		/* too many interfaces involved. Filtering by ifindex is pointless. */
+		priv->resync.hot_types_full |= DELAYED_ACTION_TYPE_REFRESH_ALL_BY_IFINDEX;
+		return;
+	}
+
+	priv->resync.ifindexes[priv->resync.n_ifindexes++] = ifindex;
+}
+
+static gboolean
+route_ignore_msg_is_ignored (NMPlatform *platform, struct nlmsghdr *hdr)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	const NMPlatformRouteIgnore *ri = nm_platform_route_ignore_get (platform);
+	const struct rtmsg *rtm;
+	struct nlattr *nla;
+	guint32 table;
+
+	if (   ri->n_protocols == 0
+	    && ri->n_tables == 0)
+		return FALSE;
+
+	if (!NM_IN_SET (hdr->nlmsg_type, RTM_NEWROUTE, RTM_DELROUTE))
+		return FALSE;
+
+	if (   !NM_FLAGS_HAS (hdr->nlmsg_flags, NLM_F_MULTI)
+	    && hdr->nlmsg_pid == nl_socket_get_local_port (priv->nlh)) {
+		/* a reply to our own request, like RTM_GETROUTE. Never hide those. */
+		return FALSE;
+	}
+
+	if (!nlmsg_valid_hdr (hdr, sizeof (struct rtmsg)))
+		return FALSE;
+
+	rtm = nlmsg_data (hdr);
+	table = rtm->rtm_table;
+	nla = nlmsg_find_attr (hdr, sizeof (struct rtmsg), RTA_TABLE);
+	if (nla && nla_len (nla) >= (int) sizeof (guint32))
+		table = nla_get_u32 (nla);
+
+	return nm_platform_route_ignore_check (platform, rtm->rtm_protocol, table);
+}
+
+/*****************************************************************************/
+
+/**
+ * event_deferred_add:
+ * @platform:
+ * @hdr: an event from the event socket.
+ *
+ * Dumps and events arrive on different sockets, so their relative
+ * order is lost. A datagram of a dump can be older than an event that
+ * we already received. Processing the event first could let the dump
+ * resurrect a deleted object. Therefore, events for an object type with
+ * a dump in progress are kept and only processed after the dump completes.
+ * To preserve the order of events, all later events are deferred too
+ * while any event is pending.
+ *
+ * Returns: %TRUE if the event was deferred.
+ */
+static gboolean
+event_deferred_add (NMPlatform *platform, struct nlmsghdr *hdr)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	RefreshAllType refresh_all_type = _REFRESH_ALL_TYPE_NUM;
+	DelayedActionType action_type;
+	DeferredEvent *deferred;
+
+	action_type = event_msg_get_refresh_type (hdr, NULL);
+	if (action_type != DELAYED_ACTION_TYPE_NONE) {
+		refresh_all_type = delayed_action_type_to_refresh_all_type (action_type);
+		if (priv->delayed_action.refresh_all_in_progress[refresh_all_type] <= 0)
+			refresh_all_type = _REFRESH_ALL_TYPE_NUM;
+	}
+
+	if (   refresh_all_type == _REFRESH_ALL_TYPE_NUM
+	    && c_list_is_empty (&priv->deferred_events_lst_head))
+		return FALSE;
+
+	deferred = g_slice_new (DeferredEvent);
+	deferred->msg = nlmsg_alloc_convert (hdr);
+	nlmsg_set_proto (deferred->msg, NETLINK_ROUTE);
+	deferred->refresh_all_type = refresh_all_type;
+	c_list_link_tail (&priv->deferred_events_lst_head, &deferred->lst);
+	priv->nl_stats.n_deferred++;
+	return TRUE;
+}
+
+static void
+event_deferred_free (DeferredEvent *deferred)
+{
+	c_list_unlink (&deferred->lst);
+	nlmsg_free (deferred->msg);
+	g_slice_free (DeferredEvent, deferred);
+}
+
+static void
+event_deferred_process (NMPlatform *platform)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	DeferredEvent *deferred;
+
+	while ((deferred = c_list_first_entry (&priv->deferred_events_lst_head, DeferredEvent, lst))) {
+		if (   deferred->refresh_all_type != _REFRESH_ALL_TYPE_NUM
+		    && priv->delayed_action.refresh_all_in_progress[deferred->refresh_all_type] > 0)
+			return;
+
+		/* unlink first. Processing the event emits signals, and the handlers
+		 * might read netlink again. */
+		c_list_unlink (&deferred->lst);
+		event_valid_msg (platform, deferred->msg, TRUE);
+		event_deferred_free (deferred);
+	}
+}
+
+static void
+event_deferred_clear (NMPlatform *platform)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	DeferredEvent *deferred;
+
+	while ((deferred = c_list_first_entry (&priv->deferred_events_lst_head, DeferredEvent, lst)))
+		event_deferred_free (deferred);
+}
+
+/*****************************************************************************/
+
+static gboolean
+resync_timeout_cb (gpointer user_data)
+{
+	NMPlatform *platform = user_data;
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+
+	priv->resync.timeout_id = 0;
+
+	if (priv->resync.pending_full != DELAYED_ACTION_TYPE_NONE) {
+		_LOGD ("netlink: resync: refresh remaining object types after overrun");
+		delayed_action_schedule (platform, priv->resync.pending_full, NULL);
+		delayed_action_handle_all (platform, FALSE);
+	}
+	return G_SOURCE_REMOVE;
+}
+
+static void
+resync_after_overrun (NMPlatform *platform)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	DelayedActionType types_full;
+	DelayedActionType types_by_ifindex;
+	gint64 now_ns;
+	guint timeout_msec;
+	gboolean repeated;
+
+	now_ns = nm_utils_get_monotonic_timestamp_ns ();
+
+	repeated =    priv->resync.last_overrun_ns != 0
+	           && now_ns - priv->resync.last_overrun_ns <= RESYNC_BACKOFF_RESET_NSEC;
+
+	/* back off exponentially with the full resync while overruns keep coming. */
+	if (!repeated)
+		priv->resync.backoff_level = 0;
+	else if (priv->resync.backoff_level < 10)
+		priv->resync.backoff_level++;
+	priv->resync.last_overrun_ns = now_ns;
+
+	/* the bridge VLANs are kept up to date by notifications, some of which
+	 * are lost. */
+	_bridge_vlans_invalidate (platform);
+
+	/* every type needs a full resync, because we cannot know for sure
+	 * which events were lost. Types that are dumped in full now drop out of this
+	 * set once their dump is sent. */
+	priv->resync.pending_full = DELAYED_ACTION_TYPE_REFRESH_ALL;
+
+	if (!repeated) {
+		_LOGD ("netlink: resync: full dump of all types");
+		delayed_action_schedule (platform, DELAYED_ACTION_TYPE_REFRESH_ALL, NULL);
+		goto out;
+	}
+
+	if (now_ns - priv->resync.window_start_ns > RESYNC_HOT_WINDOW_NSEC) {
+		priv->resync.hot_types = DELAYED_ACTION_TYPE_NONE;
+		priv->resync.hot_types_full = DELAYED_ACTION_TYPE_NONE;
+		priv->resync.n_ifindexes = 0;
+	}
+
+	/* links and addresses are cheap to dump, and stale entries of them are the
+	 * most harmful. Always refresh them right away. */
+	types_full =   DELAYED_ACTION_TYPE_REFRESH_ALL_LINKS
+	             | DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_ADDRESSES
+	             | DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ADDRESSES
+	             | (priv->resync.hot_types & ~DELAYED_ACTION_TYPE_REFRESH_ALL_BY_IFINDEX)
+	             | (priv->resync.hot_types & priv->resync.hot_types_full);
+	if (   !priv->resync.strict_check
+	    || priv->resync.n_ifindexes == 0)
+		types_full |= priv->resync.hot_types;
+	types_by_ifindex = priv->resync.hot_types & ~types_full;
+
+	_LOGD ("netlink: resync: full dump of links, addresses and recently changed types%s (%u ifindexes), the rest follows later",
+	       types_by_ifindex ? ", filtered dump of recently changed routes" : "",
+	       types_by_ifindex ? priv->resync.n_ifindexes : 0u);
+
+	delayed_action_schedule (platform, types_full, NULL);
+	if (types_by_ifindex != DELAYED_ACTION_TYPE_NONE) {
+		do_request_by_ifindex_no_delayed_actions (platform,
+		                                          types_by_ifindex,
+		                                          priv->resync.ifindexes,
+		                                          priv->resync.n_ifindexes);
+	}
+
+	if (priv->resync.timeout_id == 0) {
+		timeout_msec = MIN (((guint) RESYNC_BACKOFF_MIN_MSEC) << priv->resync.backoff_level,
+		                    (guint) RESYNC_BACKOFF_MAX_MSEC);
+		priv->resync.timeout_id = g_timeout_add (timeout_msec, resync_timeout_cb, platform);
+	}
+
+out:
+	priv->resync.hot_types = DELAYED_ACTION_TYPE_NONE;
+	priv->resync.hot_types_full = DELAYED_ACTION_TYPE_NONE;
+	priv->resync.n_ifindexes = 0;
+	priv->resync.window_start_ns = now_ns;
+}
+
+/**
+ * _nmtst_linux_platform_simulate_overrun:
+ * @platform: the #NMLinuxPlatform instance
+ *
+ * Drops all pending events of the event socket, as if kernel failed to
+ * queue them, and handles it like an ENOBUFS overrun.
+ */
+void
+_nmtst_linux_platform_simulate_overrun (NMPlatform *platform)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	struct sockaddr_nl nla = { 0 };
+	unsigned char *buf;
+	int n;
+
+	g_return_if_fail (NM_IS_LINUX_PLATFORM (platform));
+	g_return_if_fail (!priv->event_worker);
+
+	do {
+		buf = NULL;
+		n = nl_recv_borrow (priv->nlh_event, &nla, &buf, NULL, NULL);
+		nl_recv_release (priv->nlh_event, buf);
+	} while (n > 0);
+
+	resync_after_overrun (platform);
+}
+
+/**
+ * _nmtst_linux_platform_event_worker_set_error:
+ * @platform: the #NMLinuxPlatform instance
+ * @error: a negative error code, or zero.
+ * @out_n_polls: (allow-none) (out): the number of times that the worker
+ *   thread polled the socket so far.
+ *
+ * Lets every read of the worker thread fail with @error, without
+ * touching the socket. Zero lets the reads succeed again.
+ *
+ * Returns: %FALSE if @platform has no worker thread.
+ */
+gboolean
+_nmtst_linux_platform_event_worker_set_error (NMPlatform *platform,
+                                              int error,
+                                              guint64 *out_n_polls)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	EventWorker *worker = priv->event_worker;
+
+	g_return_val_if_fail (NM_IS_LINUX_PLATFORM (platform), FALSE);
+	g_return_val_if_fail (error <= 0, FALSE);
+
+	if (!worker)
+		return FALSE;
+
+	g_mutex_lock (&worker->lock);
+	worker->nmtst_error = error;
+	NM_SET_OUT (out_n_polls, worker->n_polls);
+	g_mutex_unlock (&worker->lock);
+	return TRUE;
+}
+
+/**
+ * _nmtst_linux_platform_sriov_vfs_create_nlmsgs:
+ * @platform: the #NMLinuxPlatform instance
+ * @ifindex: the ifindex of the PF
+ * @vfs: the %NULL terminated list of VFs to configure
+ *
+ * Returns: (transfer full): the RTM_SETLINK messages (struct nl_msg) that
+ *   nm_platform_link_set_sriov_vfs() would send, or %NULL on failure.
+ */
+GPtrArray *
+_nmtst_linux_platform_sriov_vfs_create_nlmsgs (NMPlatform *platform,
+                                               int ifindex,
+                                               const NMPlatformVF *const *vfs)
+{
+	GPtrArray *nlmsgs = NULL;
+
+	g_return_val_if_fail (NM_IS_LINUX_PLATFORM (platform), NULL);
+
+	if (!_sriov_vfs_create_nlmsgs (platform, ifindex, vfs, &nlmsgs))
+		return NULL;
+	return nlmsgs;
+}
+
+/**
+ * _nmtst_linux_platform_sriov_vf_is_satisfied:
+ * @vf: the requested configuration of the VF
+ * @state: the configuration of the VF in kernel. Only one VLAN is
+ *   supported, like in IFLA_VF_VLAN.
+ *
+ * Returns: whether @vf needs no change.
+ */
+gboolean
+_nmtst_linux_platform_sriov_vf_is_satisfied (const NMPlatformVF *vf,
+                                             const NMPlatformVF *state)
+{
+	SriovVfState s = {
+		.min_tx_rate = state->min_tx_rate,
+		.max_tx_rate = state->max_tx_rate,
+		.spoofchk    = state->spoofchk,
+		.trust       = state->trust,
+		.vlan_proto  = htons (ETH_P_8021Q),
+		.valid       = TRUE,
+	};
+
+	g_return_val_if_fail (state->mac.len <= sizeof (s.mac), FALSE);
+
+	memcpy (s.mac, state->mac.data, state->mac.len);
+	if (state->num_vlans > 0) {
+		s.vlan = state->vlans[0].id;
+		s.qos = state->vlans[0].qos;
+		s.vlan_proto = htons (state->vlans[0].proto_ad ? ETH_P_8021AD : ETH_P_8021Q);
+	}
+	return _sriov_vf_is_satisfied (vf, &s);
+}
+
+/**
+ * _nmtst_linux_platform_bridge_vlan_get:
+ * @platform: the #NMLinuxPlatform instance
+ * @ifindex: the bridge or bridge port
+ * @vid: the VLAN ID
+ * @out_untagged: (allow-none) (out): whether the VLAN is untagged
+ * @out_pvid: (allow-none) (out): whether the VLAN is the PVID
+ *
+ * Looks up a VLAN in the bridge VLANs that @platform knows, the same
+ * way as nm_platform_link_set_bridge_vlans() does.
+ *
+ * Returns: %TRUE if the VLAN exists.
+ */
+gboolean
+_nmtst_linux_platform_bridge_vlan_get (NMPlatform *platform,
+                                       int ifindex,
+                                       guint16 vid,
+                                       gboolean *out_untagged,
+                                       gboolean *out_pvid)
+{
+	gs_free guint8 *vlan_states = NULL;
+
+	g_return_val_if_fail (NM_IS_LINUX_PLATFORM (platform), FALSE);
+	g_return_val_if_fail (vid >= 1 && vid <= BRIDGE_VLAN_VID_MAX, FALSE);
 
-	return -NME_UNSPEC;
+	vlan_states = g_malloc (BRIDGE_VLAN_VID_MAX + 1);
+	if (!_bridge_vlans_get (platform, ifindex, vlan_states))
+		return FALSE;
+
+	NM_SET_OUT (out_untagged, NM_FLAGS_HAS (vlan_states[vid], BRIDGE_VLAN_STATE_UNTAGGED));
+	NM_SET_OUT (out_pvid, NM_FLAGS_HAS (vlan_states[vid], BRIDGE_VLAN_STATE_PVID));
+	return NM_FLAGS_HAS (vlan_states[vid], BRIDGE_VLAN_STATE_PRESENT);
 }
 
-/*****************************************************************************/
+guint
+_nmtst_linux_platform_wireguard_get_n_refreshes (NMPlatform *platform)
+{
+	g_return_val_if_fail (NM_IS_LINUX_PLATFORM (platform), 0);
 
-#define EVENT_CONDITIONS      ((GIOCondition) (G_IO_IN | G_IO_PRI))
-#define ERROR_CONDITIONS      ((GIOCondition) (G_IO_ERR | G_IO_NVAL))
-#define DISCONNECT_CONDITIONS ((GIOCondition) (G_IO_HUP))
+	return NM_LINUX_PLATFORM_GET_PRIVATE (platform)->wireguard_n_refreshes;
+}
 
-static gboolean
-event_handler (GIOChannel *channel,
-               GIOCondition io_condition,
-               gpointer user_data)
-{
-	delayed_action_handle_all (NM_PLATFORM (user_data), TRUE);
-	return TRUE;
+/**
+ * _nmtst_linux_platform_wireguard_peers_diff:
+ * @lnk_old: the #NMPObject of type %NMP_OBJECT_TYPE_LNK_WIREGUARD, as
+ *   currently configured in kernel.
+ * @lnk_wireguard: the requested device settings.
+ * @peers: the requested peers.
+ * @peer_flags: (allow-none): the flags for @peers.
+ * @peers_len: the number of @peers.
+ * @inout_change_flags: the requested change flags. On return, the
+ *   flags for unchanged settings are cleared.
+ * @out_peers: (out) (transfer full): the peers to send.
+ * @out_peer_flags: (out) (transfer full): the flags for @out_peers.
+ * @out_allowed_ips: (out) (transfer full): the allowed-ips buffers that
+ *   @out_peers point to. Free them only after @out_peers.
+ *
+ * Exposes _wireguard_peers_diff() for unit tests.
+ */
+void
+_nmtst_linux_platform_wireguard_peers_diff (const NMPObject *lnk_old,
+                                            const NMPlatformLnkWireGuard *lnk_wireguard,
+                                            const NMPWireGuardPeer *peers,
+                                            const NMPlatformWireGuardChangePeerFlags *peer_flags,
+                                            guint peers_len,
+                                            NMPlatformWireGuardChangeFlags *inout_change_flags,
+                                            GArray **out_peers,
+                                            GArray **out_peer_flags,
+                                            GPtrArray **out_allowed_ips)
+{
+	WireGuardPeersDiff diff = { };
+
+	_wireguard_peers_diff (lnk_old,
+	                       lnk_wireguard,
+	                       peers,
+	                       peer_flags,
+	                       peers_len,
+	                       inout_change_flags,
+	                       &diff);
+	*out_peers = diff.peers;
+	*out_peer_flags = diff.peer_flags;
+	*out_allowed_ips = diff.allowed_ips;
 }
 
-/*****************************************************************************/
+/**
+ * _nmtst_linux_platform_ethtool_bitset_parse:
+ * @nla: the nested ethtool bitset attribute, in compact form
+ * @words: (out caller-allocates): the bits of the bitset
+ * @n_words: the number of elements of @words
+ *
+ * Returns: %TRUE if @nla is a compact bitset.
+ */
+gboolean
+_nmtst_linux_platform_ethtool_bitset_parse (const struct nlattr *nla,
+                                            guint32 *words,
+                                            guint n_words)
+{
+	return _ethtool_bitset_parse (nla, words, n_words);
+}
 
 /* copied from libnl3's recvmsgs() */
 static int
-event_handler_recvmsgs (NMPlatform *platform, gboolean handle_events)
+event_handler_recvmsgs (NMPlatform *platform, struct nl_sock *sk, gboolean handle_events)
 {
 	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
-	struct nl_sock *sk = priv->nlh;
+	const gboolean is_event_sk = (sk == priv->nlh_event);
+	guint n_datagrams = 0;
 	int n;
 	int err = 0;
 	gboolean multipart = 0;
@@ -8605,11 +13267,12 @@ event_handler_recvmsgs (NMPlatform *platform, gboolean handle_events)
 	struct sockaddr_nl nla = {0};
 	struct ucred creds;
 	gboolean creds_has;
-	nm_auto_free unsigned char *buf = NULL;
+	unsigned char *buf = NULL;
+	nm_auto_nlmsg struct nl_msg *msg = NULL;
 
 continue_reading:
-	g_clear_pointer (&buf, free);
-	n = nl_recv (sk, &nla, &buf, &creds, &creds_has);
+	nl_recv_release (sk, g_steal_pointer (&buf));
+	n = nl_recv_borrow (sk, &nla, &buf, &creds, &creds_has);
 
 	if (n <= 0) {
 
@@ -8634,14 +13297,22 @@ continue_reading:
 
 	hdr = (struct nlmsghdr *) buf;
 	while (nlmsg_ok (hdr, n)) {
-		nm_auto_nlmsg struct nl_msg *msg = NULL;
 		gboolean abort_parsing = FALSE;
 		gboolean process_valid_msg = FALSE;
 		guint32 seq_number;
 		char buf_nlmsghdr[400];
 		const char *extack_msg = NULL;
 
-		msg = nlmsg_alloc_convert (hdr);
+		priv->nl_stats.n_messages++;
+
+		if (   is_event_sk
+		    && hdr->nlmsg_type >= NLMSG_MIN_TYPE)
+			resync_note_event (platform, hdr);
+
+		/* the message is only parsed and not kept. Don't copy it. */
+		if (!msg)
+			msg = nlmsg_alloc_view ();
+		nlmsg_set_view (msg, hdr);
 
 		nlmsg_set_proto (msg, NETLINK_ROUTE);
 		nlmsg_set_src (msg, &nla);
@@ -8739,8 +13410,20 @@ continue_reading:
 				seq_result = -NM_ERRNO_NATIVE (errsv);
 			} else
 				seq_result = WAIT_FOR_NL_RESPONSE_RESULT_RESPONSE_OK;
-		} else
+		} else if (!route_ignore_msg_is_ignored (platform, hdr))
 			process_valid_msg = TRUE;
+		else
+			seq_result = WAIT_FOR_NL_RESPONSE_RESULT_RESPONSE_OK;
+
+		if (is_event_sk) {
+			/* Events carry the sequence number of the request that caused
+			 * them, but the responses to our requests only arrive on @nlh. */
+			if (   process_valid_msg
+			    && (   !handle_events
+			        || !event_deferred_add (platform, hdr)))
+				event_valid_msg (platform, msg, handle_events);
+			goto next;
+		}
 
 		seq_number = nlmsg_hdr (msg)->nlmsg_seq;
 
@@ -8764,6 +13447,10 @@ continue_reading:
 		}
 
 		event_seq_check (platform, seq_number, seq_result, extack_msg);
+		if (hdr->nlmsg_type == NLMSG_ERROR)
+			async_request_check_seq (platform, seq_number, seq_result, extack_msg);
+
+next:
 
 		if (abort_parsing)
 			goto stop;
@@ -8773,8 +13460,11 @@ continue_reading:
 	}
 
 	if (multipart) {
-		/* Multipart message not yet complete, continue reading */
-		goto continue_reading;
+		/* Multipart message not yet complete, continue reading. But for large
+		 * dumps return after a while, so that the caller can look at the
+		 * event socket in between. */
+		if (++n_datagrams < NL_REQUEST_DATAGRAMS_PER_ROUND)
+			goto continue_reading;
 	}
 stop:
 	if (!handle_events) {
@@ -8784,6 +13474,8 @@ stop:
 		goto continue_reading;
 	}
 
+	nl_recv_release (sk, buf);
+
 	if (interrupted)
 		return -NME_NL_DUMP_INTR;
 	return err;
@@ -8791,13 +13483,342 @@ stop:
 
 /*****************************************************************************/
 
+/**
+ * event_handler_read_socket:
+ * @platform:
+ * @sk: the socket to read.
+ *
+ * Reads from @sk until there is nothing left. But a dump on the request
+ * socket is only read in parts (see NL_REQUEST_DATAGRAMS_PER_ROUND).
+ *
+ * Returns: %TRUE if something was read. If @sk is the request socket, there
+ *   might be more.
+ */
+static gboolean
+event_handler_read_socket (NMPlatform *platform, struct nl_sock *sk)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	gboolean any = FALSE;
+	int nle;
+
+	for (;;) {
+		nle = event_handler_recvmsgs (platform, sk, TRUE);
+
+		if (nle < 0) {
+			switch (nle) {
+			case -EAGAIN:
+				return any;
+			case -NME_NL_DUMP_INTR:
+				_LOGD ("netlink: read: uncritical failure to retrieve incoming events: %s (%d)", nm_strerror (nle), nle);
+				break;
+			case -NME_NL_MSG_TRUNC:
+			case -ENOBUFS:
+				_LOGI ("netlink: read: %s%s. Need to resynchronize platform cache",
+				       ({
+				            const char *_reason = "unknown";
+				            switch (nle) {
+				            case -NME_NL_MSG_TRUNC: _reason = "message truncated";       break;
+				            case -ENOBUFS:       _reason = "too many netlink events"; break;
+				            }
+				            _reason;
+				       }),
+				       sk == priv->nlh_event ? "" : " on request socket");
+				event_handler_recvmsgs (platform, sk, FALSE);
+				if (sk == priv->nlh) {
+					/* the responses to our requests are lost, including the ACKs
+					 * of asynchronous requests. */
+					delayed_action_wait_for_nl_response_complete_all (platform,
+					                                                  WAIT_FOR_NL_RESPONSE_RESULT_FAILED_RESYNC);
+					async_request_complete_all (platform,
+					                            WAIT_FOR_NL_RESPONSE_RESULT_FAILED_RESYNC);
+				}
+
+				resync_after_overrun (platform);
+				break;
+			default:
+				_LOGE ("netlink: read: failed to retrieve incoming events: %s (%d)", nm_strerror (nle), nle);
+				break;
+			}
+		}
+		any = TRUE;
+
+		if (sk == priv->nlh)
+			return TRUE;
+	}
+}
+
+/*****************************************************************************/
+
+/* Returns: zero once the socket is drained, or a negative error code for a
+ *   failure that the next read likely runs into again. */
+static int
+event_worker_read_locked (EventWorker *worker)
+{
+	struct sockaddr_nl nla;
+	struct ucred creds;
+	gboolean creds_has;
+	unsigned char *buf;
+	struct nlmsghdr *hdr;
+	int n;
+
+	for (;;) {
+		if (worker->nmtst_error < 0)
+			return worker->nmtst_error;
+
+		buf = NULL;
+		n = nl_recv_borrow (worker->sk, &nla, &buf, &creds, &creds_has);
+		if (n <= 0) {
+			if (n == -NME_NL_MSG_TRUNC) {
+				int buf_size;
+
+				/* like event_handler_recvmsgs(). The message is lost. */
+				buf_size = nl_socket_get_msg_buf_size (worker->sk);
+				if (buf_size < 512*1024)
+					nl_socket_set_msg_buf_size (worker->sk, buf_size * 2);
+				worker->overrun = TRUE;
+				continue;
+			}
+			if (n == -ENOBUFS) {
+				/* kernel dropped events. Reading the socket clears the
+				 * error, the main thread resyncs the cache. */
+				worker->overrun = TRUE;
+				continue;
+			}
+			if (NM_IN_SET (n, 0, -EAGAIN, -EINTR))
+				return 0;
+			return n;
+		}
+
+		if (   creds_has
+		    && creds.pid == 0) {
+			for (hdr = (struct nlmsghdr *) buf; nlmsg_ok (hdr, n); hdr = nlmsg_next (hdr, &n)) {
+				struct nl_msg *msg;
+
+				if (hdr->nlmsg_type == NLMSG_OVERRUN) {
+					worker->overrun = TRUE;
+					continue;
+				}
+				if (hdr->nlmsg_type < NLMSG_MIN_TYPE)
+					continue;
+
+				msg = nlmsg_alloc_convert (hdr);
+				nlmsg_set_proto (msg, NETLINK_ROUTE);
+				g_ptr_array_add (worker->batch, msg);
+			}
+		}
+
+		nl_recv_release (worker->sk, buf);
+	}
+}
+
+static gboolean
+event_worker_idle_cb (gpointer user_data)
+{
+	EventWorker *worker = user_data;
+	NMPlatform *platform = worker->platform;
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+
+	g_mutex_lock (&worker->lock);
+	nm_clear_pointer (&worker->idle_source, g_source_unref);
+	g_mutex_unlock (&worker->lock);
+
+	priv->nl_stats.n_wakeups++;
+	delayed_action_handle_all (platform, TRUE);
+	return G_SOURCE_REMOVE;
+}
+
+static gpointer
+event_worker_thread (gpointer user_data)
+{
+	EventWorker *worker = user_data;
+	nm_auto_pop_netns NMPNetns *netns = NULL;
+	int r;
+
+	/* A thread of a multi-threaded process cannot change its mount namespace,
+	 * and it only needs the network namespace anyway. */
+	if (nmp_netns_push_type (worker->netns, CLONE_NEWNET))
+		netns = worker->netns;
+
+	g_mutex_lock (&worker->lock);
+	while (!worker->stop) {
+		struct pollfd pfd[2] = {
+			{ .fd = nl_socket_get_fd (worker->sk), .events = POLLIN },
+			{ .fd = worker->fd_wakeup,             .events = POLLIN },
+		};
+
+		if (worker->batch->len >= EVENT_WORKER_BATCH_MAX) {
+			/* let the socket buffer fill up, instead of our memory. */
+			g_cond_wait (&worker->cond, &worker->lock);
+			continue;
+		}
+
+		g_mutex_unlock (&worker->lock);
+		poll (pfd, G_N_ELEMENTS (pfd), -1);
+		g_mutex_lock (&worker->lock);
+
+		if (worker->stop)
+			break;
+
+		worker->n_polls++;
+		r = event_worker_read_locked (worker);
+		if (r < 0) {
+			worker->error = r;
+			worker->error_backoff_msec = worker->error_backoff_msec
+			                             ? MIN (worker->error_backoff_msec * 2, EVENT_WORKER_ERROR_BACKOFF_MAX_MSEC)
+			                             : EVENT_WORKER_ERROR_BACKOFF_MIN_MSEC;
+		} else
+			worker->error_backoff_msec = 0;
+
+		if (   (   worker->batch->len > 0
+		        || worker->overrun
+		        || worker->error < 0)
+		    && !worker->idle_source) {
+			worker->idle_source = g_idle_source_new ();
+			g_source_set_callback (worker->idle_source, event_worker_idle_cb, worker, NULL);
+			g_source_attach (worker->idle_source, worker->context);
+		}
+
+		if (r < 0) {
+			const gint64 end_time = g_get_monotonic_time () + (worker->error_backoff_msec * (gint64) 1000);
+
+			/* the socket likely stays readable (e.g. a pending POLLERR), and
+			 * polling again would spin. */
+			while (   !worker->stop
+			       && g_cond_wait_until (&worker->cond, &worker->lock, end_time)) {
+				/* woken up early. Keep waiting. */
+			}
+		}
+	}
+	g_mutex_unlock (&worker->lock);
+
+	return NULL;
+}
+
+static EventWorker *
+event_worker_new (NMPlatform *platform, struct nl_sock *sk)
+{
+	EventWorker *worker;
+	int fd_wakeup;
+
+	fd_wakeup = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (fd_wakeup < 0)
+		return NULL;
+
+	worker = g_slice_new0 (EventWorker);
+	g_mutex_init (&worker->lock);
+	g_cond_init (&worker->cond);
+	worker->context = g_main_context_ref_thread_default ();
+	worker->sk = sk;
+	worker->netns = g_object_ref (nm_platform_netns_get (platform));
+	worker->platform = platform;
+	worker->fd_wakeup = fd_wakeup;
+	worker->batch = g_ptr_array_new_with_free_func ((GDestroyNotify) nlmsg_free);
+	worker->thread = g_thread_new ("nm-platform-netns", event_worker_thread, worker);
+	return worker;
+}
+
+static void
+event_worker_free (EventWorker *worker)
+{
+	const guint64 one = 1;
+
+	g_mutex_lock (&worker->lock);
+	worker->stop = TRUE;
+	g_cond_signal (&worker->cond);
+	g_mutex_unlock (&worker->lock);
+
+	if (write (worker->fd_wakeup, &one, sizeof (one)) < 0)
+		nm_assert_not_reached ();
+	g_thread_join (worker->thread);
+
+	if (worker->idle_source) {
+		g_source_destroy (worker->idle_source);
+		g_source_unref (worker->idle_source);
+	}
+	g_ptr_array_unref (worker->batch);
+	nm_close (worker->fd_wakeup);
+	g_object_unref (worker->netns);
+	g_main_context_unref (worker->context);
+	g_cond_clear (&worker->cond);
+	g_mutex_clear (&worker->lock);
+	g_slice_free (EventWorker, worker);
+}
+
+/**
+ * event_worker_collect:
+ * @platform:
+ *
+ * Takes the events from the worker and processes them. This also reads the
+ * event socket, so that the events are complete up to now. Kernel queues
+ * the notification about a change before it sends the ACK. So after reading
+ * an ACK, the notification is either in the batch of the worker or still
+ * in the socket.
+ *
+ * Returns: %TRUE if there were any events.
+ */
+static gboolean
+event_worker_collect (NMPlatform *platform)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	EventWorker *worker = priv->event_worker;
+	gs_unref_ptrarray GPtrArray *batch = NULL;
+	gboolean overrun;
+	int error;
+	guint i;
+
+	g_mutex_lock (&worker->lock);
+	/* a failure is left to the thread, which backs off and reports it. */
+	event_worker_read_locked (worker);
+	if (worker->batch->len > 0) {
+		batch = g_steal_pointer (&worker->batch);
+		worker->batch = g_ptr_array_new_with_free_func ((GDestroyNotify) nlmsg_free);
+		g_cond_signal (&worker->cond);
+	}
+	overrun = worker->overrun;
+	worker->overrun = FALSE;
+	error = worker->error;
+	worker->error = 0;
+	g_mutex_unlock (&worker->lock);
+
+	if (batch) {
+		_LOGt ("netlink: read: process %u events from worker thread", batch->len);
+		for (i = 0; i < batch->len; i++) {
+			struct nl_msg *msg = batch->pdata[i];
+			struct nlmsghdr *hdr = nlmsg_hdr (msg);
+
+			priv->nl_stats.n_messages++;
+			resync_note_event (platform, hdr);
+			if (route_ignore_msg_is_ignored (platform, hdr))
+				continue;
+			if (!event_deferred_add (platform, hdr))
+				event_valid_msg (platform, msg, TRUE);
+		}
+	}
+
+	if (error < 0) {
+		/* the thread backs off until the next read. Events might be lost
+		 * meanwhile. */
+		_LOGW ("netlink: read: failed to retrieve incoming events in worker thread: %s (%d). Need to resynchronize platform cache",
+		       nm_strerror (error), error);
+		overrun = TRUE;
+	} else if (overrun)
+		_LOGI ("netlink: read: too many netlink events. Need to resynchronize platform cache");
+
+	if (overrun)
+		resync_after_overrun (platform);
+
+	return batch || overrun;
+}
+
+/*****************************************************************************/
+
 static gboolean
 event_handler_read_netlink (NMPlatform *platform, gboolean wait_for_acks)
 {
 	nm_auto_pop_netns NMPNetns *netns = NULL;
 	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
 	int r;
-	struct pollfd pfd;
+	struct pollfd pfd[2];
 	gboolean any = FALSE;
 	int timeout_ms;
 	struct {
@@ -8806,6 +13827,9 @@ event_handler_read_netlink (NMPlatform *platform, gboolean wait_for_acks)
 		gint64 now_ns;
 	} next;
 
+	if (priv->replay)
+		return FALSE;
+
 	if (!nm_platform_netns_push (platform, &netns)) {
 		delayed_action_wait_for_nl_response_complete_all (platform,
 		                                                  WAIT_FOR_NL_RESPONSE_RESULT_FAILED_SETNS);
@@ -8814,66 +13838,46 @@ event_handler_read_netlink (NMPlatform *platform, gboolean wait_for_acks)
 
 	for (;;) {
 		for (;;) {
-			int nle;
-
-			nle = event_handler_recvmsgs (platform, TRUE);
-
-			if (nle < 0) {
-				switch (nle) {
-				case -EAGAIN:
-					goto after_read;
-				case -NME_NL_DUMP_INTR:
-					_LOGD ("netlink: read: uncritical failure to retrieve incoming events: %s (%d)", nm_strerror (nle), nle);
-					break;
-				case -NME_NL_MSG_TRUNC:
-				case -ENOBUFS:
-					_LOGI ("netlink: read: %s. Need to resynchronize platform cache",
-					       ({
-					            const char *_reason = "unknown";
-					            switch (nle) {
-					            case -NME_NL_MSG_TRUNC: _reason = "message truncated";       break;
-					            case -ENOBUFS:       _reason = "too many netlink events"; break;
-					            }
-					            _reason;
-					       }));
-					event_handler_recvmsgs (platform, FALSE);
-					delayed_action_wait_for_nl_response_complete_all (platform,
-					                                                  WAIT_FOR_NL_RESPONSE_RESULT_FAILED_RESYNC);
-
-					delayed_action_schedule (platform,
-					                         DELAYED_ACTION_TYPE_REFRESH_ALL_LINKS |
-					                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_ADDRESSES |
-					                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ADDRESSES |
-					                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_ROUTES |
-					                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ROUTES |
-					                         DELAYED_ACTION_TYPE_REFRESH_ALL_ROUTING_RULES_ALL |
-					                         DELAYED_ACTION_TYPE_REFRESH_ALL_QDISCS |
-					                         DELAYED_ACTION_TYPE_REFRESH_ALL_TFILTERS,
-					                         NULL);
-					break;
-				default:
-					_LOGE ("netlink: read: failed to retrieve incoming events: %s (%d)", nm_strerror (nle), nle);
-					break;
-				}
-			}
+			gboolean again = FALSE;
+
+			/* Read the request socket first. Kernel queues the notification
+			 * about a change on the event socket before it sends the ACK. So
+			 * when we see an ACK, the following read of the event socket
+			 * also gets the corresponding event. */
+			if (event_handler_read_socket (platform, priv->nlh))
+				again = TRUE;
+			if (  priv->event_worker
+			    ? event_worker_collect (platform)
+			    : event_handler_read_socket (platform, priv->nlh_event))
+				again = TRUE;
+			event_deferred_process (platform);
+
+			if (!again)
+				break;
 			any = TRUE;
 		}
 
-after_read:
+		next.seq_number = 0;
+		if (NM_FLAGS_HAS (priv->delayed_action.flags, DELAYED_ACTION_TYPE_WAIT_FOR_NL_RESPONSE)) {
+			delayed_action_wait_for_nl_response_complete_check (platform,
+			                                                    WAIT_FOR_NL_RESPONSE_RESULT_UNKNOWN,
+			                                                    &next.seq_number,
+			                                                    &next.timeout_abs_ns,
+			                                                    &next.now_ns);
 
-		if (!NM_FLAGS_HAS (priv->delayed_action.flags, DELAYED_ACTION_TYPE_WAIT_FOR_NL_RESPONSE))
-			return any;
-
-		delayed_action_wait_for_nl_response_complete_check (platform,
-		                                                    WAIT_FOR_NL_RESPONSE_RESULT_UNKNOWN,
-		                                                    &next.seq_number,
-		                                                    &next.timeout_abs_ns,
-		                                                    &next.now_ns);
+			/* a dump might have timed out. Its events can be processed now. */
+			event_deferred_process (platform);
+		}
 
 		if (   !wait_for_acks
 		    || !NM_FLAGS_HAS (priv->delayed_action.flags, DELAYED_ACTION_TYPE_WAIT_FOR_NL_RESPONSE))
 			return any;
 
+		if (next.seq_number == 0) {
+			/* the deferred events caused new requests. */
+			continue;
+		}
+
 		nm_assert (next.seq_number);
 		nm_assert (next.now_ns > 0);
 		nm_assert (next.timeout_abs_ns > next.now_ns);
@@ -8882,14 +13886,18 @@ after_read:
 
 		timeout_ms = (next.timeout_abs_ns - next.now_ns) / (NM_UTILS_NS_PER_SECOND / 1000);
 
-		memset (&pfd, 0, sizeof (pfd));
-		pfd.fd = nl_socket_get_fd (priv->nlh);
-		pfd.events = POLLIN;
-		r = poll (&pfd, 1, MAX (1, timeout_ms));
+		/* also wake up for events, so that they are not delayed by a
+		 * long running dump. */
+		memset (pfd, 0, sizeof (pfd));
+		pfd[0].fd = nl_socket_get_fd (priv->nlh);
+		pfd[0].events = POLLIN;
+		pfd[1].fd = nl_socket_get_fd (priv->nlh_event);
+		pfd[1].events = POLLIN;
+		r = poll (pfd, G_N_ELEMENTS (pfd), MAX (1, timeout_ms));
 
 		if (r == 0) {
 			/* timeout and there is nothing to read. */
-			goto after_read;
+			continue;
 		}
 
 		if (r < 0) {
@@ -8898,6 +13906,7 @@ after_read:
 			if (errsv != EINTR) {
 				_LOGE ("netlink: read: poll failed with %s", nm_strerror_native (errsv));
 				delayed_action_wait_for_nl_response_complete_all (platform, WAIT_FOR_NL_RESPONSE_RESULT_FAILED_POLL);
+				event_deferred_process (platform);
 				return any;
 			}
 			/* Continue to read again, even if there might be nothing to read after EINTR. */
@@ -9044,6 +14053,32 @@ nm_linux_platform_init (NMLinuxPlatform *self)
 	priv->delayed_action.list_master_connected = g_ptr_array_new ();
 	priv->delayed_action.list_refresh_link = g_ptr_array_new ();
 	priv->delayed_action.list_wait_for_nl_response = g_array_new (FALSE, TRUE, sizeof (DelayedActionWaitForNlResponseData));
+	c_list_init (&priv->async.pending_lst);
+	c_list_init (&priv->async.completed_lst);
+	c_list_init (&priv->deferred_events_lst_head);
+	priv->wireguard_family_id = -1;
+	priv->devlink_family_id = -1;
+	priv->ethtool_family_id = -1;
+}
+
+static GIOChannel *
+_nl_socket_add_watch (struct nl_sock *sk, NMPlatform *platform, guint *out_source_id)
+{
+	GIOChannel *channel;
+	int channel_flags;
+	gboolean status;
+
+	channel = g_io_channel_unix_new (nl_socket_get_fd (sk));
+	g_io_channel_set_encoding (channel, NULL, NULL);
+
+	channel_flags = g_io_channel_get_flags (channel);
+	status = g_io_channel_set_flags (channel,
+	                                 channel_flags | G_IO_FLAG_NONBLOCK, NULL);
+	g_assert (status);
+	*out_source_id = g_io_add_watch (channel,
+	                                 (EVENT_CONDITIONS | ERROR_CONDITIONS | DISCONNECT_CONDITIONS),
+	                                 event_handler, platform);
+	return channel;
 }
 
 static void
@@ -9051,8 +14086,6 @@ constructed (GObject *_object)
 {
 	NMPlatform *platform = NM_PLATFORM (_object);
 	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
-	int channel_flags;
-	gboolean status;
 	int nle;
 
 	nm_assert (!platform->_netns || platform->_netns == nmp_netns_get_current ());
@@ -9073,6 +14106,15 @@ constructed (GObject *_object)
 	                                   nmp_netns_get_current () == nmp_netns_get_initial () ? "/main" : "")),
 	       nm_platform_get_use_udev (platform) ? "use" : "no");
 
+	if (priv->replay) {
+		/* the sockets stay unconnected, so that any request fails right
+		 * away. The cache is only populated by nm_linux_platform_replay(). */
+		_LOGD ("replay mode. Don't talk to kernel");
+		priv->nlh = nl_socket_alloc ();
+		priv->nlh_event = nl_socket_alloc ();
+		G_OBJECT_CLASS (nm_linux_platform_parent_class)->constructed (_object);
+		return;
+	}
 
 	priv->genl = nl_socket_alloc ();
 	g_assert (priv->genl);
@@ -9085,6 +14127,11 @@ constructed (GObject *_object)
 		priv->genl = NULL;
 	}
 
+	/* The request socket. It is not subscribed to any multicast group,
+	 * so it only receives the responses to our requests. Kernel doesn't
+	 * generate the next part of a dump before we read the previous one,
+	 * so the buffer only needs to hold the ACKs of a batch of requests
+	 * (see _nl_send_nlmsg_batch()). */
 	priv->nlh = nl_socket_alloc ();
 	g_assert (priv->nlh);
 
@@ -9093,25 +14140,55 @@ constructed (GObject *_object)
 	nle = nl_socket_set_passcred (priv->nlh, 1);
 	g_assert (!nle);
 
-	/* No blocking for event socket, so that we can drain it safely. */
+	/* No blocking, so that we can drain it safely. */
 	nle = nl_socket_set_nonblocking (priv->nlh);
 	g_assert (!nle);
 
-	/* use 8 MB for receive socket kernel queue. */
-	nle = nl_socket_set_buffer_size (priv->nlh, 8*1024*1024, 0);
+	nle = nl_socket_set_buffer_size (priv->nlh, 2*1024*1024, 0);
 	g_assert (!nle);
 
 	nle = nl_socket_set_ext_ack (priv->nlh, TRUE);
 	if (nle)
 		_LOGD ("could not enable extended acks on netlink socket");
 
+	/* with strict checking, the kernel honors the filters in dump requests. */
+	nle = nl_socket_set_strict_check (priv->nlh, TRUE);
+	if (nle)
+		_LOGD ("could not enable strict checking on netlink socket");
+	else
+		priv->resync.strict_check = TRUE;
+
 	/* explicitly set the msg buffer size and disable MSG_PEEK.
 	 * If we later encounter NME_NL_MSG_TRUNC, we will adjust the buffer size. */
 	nl_socket_disable_msg_peek (priv->nlh);
 	nle = nl_socket_set_msg_buf_size (priv->nlh, 32 * 1024);
 	g_assert (!nle);
 
-	nle = nl_socket_add_memberships (priv->nlh,
+	_LOGD ("Netlink socket for requests established: port=%u, fd=%d", nl_socket_get_local_port (priv->nlh), nl_socket_get_fd (priv->nlh));
+
+	/* The event socket. */
+	priv->nlh_event = nl_socket_alloc ();
+	g_assert (priv->nlh_event);
+
+	nle = nl_connect (priv->nlh_event, NETLINK_ROUTE);
+	g_assert (!nle);
+	nle = nl_socket_set_passcred (priv->nlh_event, 1);
+	g_assert (!nle);
+
+	/* No blocking for event socket, so that we can drain it safely. */
+	nle = nl_socket_set_nonblocking (priv->nlh_event);
+	g_assert (!nle);
+
+	/* use 8 MB for receive socket kernel queue. Unlike dumps, events are not
+	 * flow controlled and get lost if the queue is full. */
+	nle = nl_socket_set_buffer_size (priv->nlh_event, 8*1024*1024, 0);
+	g_assert (!nle);
+
+	nl_socket_disable_msg_peek (priv->nlh_event);
+	nle = nl_socket_set_msg_buf_size (priv->nlh_event, 32 * 1024);
+	g_assert (!nle);
+
+	nle = nl_socket_add_memberships (priv->nlh_event,
 	                                 RTNLGRP_IPV4_IFADDR,
 	                                 RTNLGRP_IPV4_ROUTE,
 	                                 RTNLGRP_IPV4_RULE,
@@ -9122,18 +14199,39 @@ constructed (GObject *_object)
 	                                 RTNLGRP_TC,
 	                                 0);
 	g_assert (!nle);
-	_LOGD ("Netlink socket for events established: port=%u, fd=%d", nl_socket_get_local_port (priv->nlh), nl_socket_get_fd (priv->nlh));
 
-	priv->event_channel = g_io_channel_unix_new (nl_socket_get_fd (priv->nlh));
-	g_io_channel_set_encoding (priv->event_channel, NULL, NULL);
+	/* kernels before 5.3 don't know the nexthop group. */
+	nle = nl_socket_add_memberships (priv->nlh_event,
+	                                 RTNLGRP_NEXTHOP,
+	                                 0);
+	if (nle) {
+		_LOGD ("could not subscribe to nexthop events. Nexthops are not supported");
+		priv->nexthops.unsupported = TRUE;
+	}
+
+	{
+		const NMPlatformRouteIgnore *ri = nm_platform_route_ignore_get (platform);
 
-	channel_flags = g_io_channel_get_flags (priv->event_channel);
-	status = g_io_channel_set_flags (priv->event_channel,
-	                                 channel_flags | G_IO_FLAG_NONBLOCK, NULL);
-	g_assert (status);
-	priv->event_id = g_io_add_watch (priv->event_channel,
-	                                (EVENT_CONDITIONS | ERROR_CONDITIONS | DISCONNECT_CONDITIONS),
-	                                 event_handler, platform);
+		/* the policy was already set by the constructor of NMPlatform. Filter the
+		 * events before the first dump. */
+		if (ri->n_protocols > 0 || ri->n_tables > 0)
+			route_ignore_changed (platform);
+	}
+	_LOGD ("Netlink socket for events established: port=%u, fd=%d", nl_socket_get_local_port (priv->nlh_event), nl_socket_get_fd (priv->nlh_event));
+
+	if (platform->_netns) {
+		/* a platform for another namespace reads its events in a worker
+		 * thread, so that many namespaces don't serialize on the main thread. */
+		priv->event_worker = event_worker_new (platform, priv->nlh_event);
+		if (!priv->event_worker)
+			_LOGW ("failure to start worker thread for netlink events. Read them on the main thread");
+	}
+	if (!priv->event_worker)
+		priv->event_channel = _nl_socket_add_watch (priv->nlh_event, platform, &priv->event_id);
+
+	/* the request socket needs a watch too, for the ACKs of asynchronous
+	 * requests. */
+	priv->request_channel = _nl_socket_add_watch (priv->nlh, platform, &priv->request_id);
 
 	/* complete construction of the GObject instance before populating the cache. */
 	G_OBJECT_CLASS (nm_linux_platform_parent_class)->constructed (_object);
@@ -9147,7 +14245,8 @@ constructed (GObject *_object)
 	                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ROUTES |
 	                         DELAYED_ACTION_TYPE_REFRESH_ALL_ROUTING_RULES_ALL |
 	                         DELAYED_ACTION_TYPE_REFRESH_ALL_QDISCS |
-	                         DELAYED_ACTION_TYPE_REFRESH_ALL_TFILTERS,
+	                         DELAYED_ACTION_TYPE_REFRESH_ALL_TFILTERS |
+	                         DELAYED_ACTION_TYPE_REFRESH_ALL_NEXTHOPS_ALL,
 	                         NULL);
 
 	delayed_action_handle_all (platform, FALSE);
@@ -9197,18 +14296,83 @@ nm_linux_platform_new (gboolean log_with_ptr, gboolean netns_support)
 	                     NULL);
 }
 
+/**
+ * nm_linux_platform_new_replay:
+ * @log_with_ptr: whether to log with the instance pointer
+ *
+ * Creates a platform instance that never talks to kernel. Its cache
+ * starts empty and is populated only by nm_linux_platform_replay(), via
+ * the same code path as netlink events. Requests to change the
+ * configuration fail.
+ *
+ * Returns: (transfer full): the new platform instance.
+ */
+NMPlatform *
+nm_linux_platform_new_replay (gboolean log_with_ptr)
+{
+	return g_object_new (NM_TYPE_LINUX_PLATFORM,
+	                     NM_PLATFORM_LOG_WITH_PTR, log_with_ptr,
+	                     NM_PLATFORM_USE_UDEV, FALSE,
+	                     NM_PLATFORM_NETNS_SUPPORT, FALSE,
+	                     NM_LINUX_PLATFORM_REPLAY, TRUE,
+	                     NULL);
+}
+
+static void
+set_property (GObject *object, guint prop_id,
+              const GValue *value, GParamSpec *pspec)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (object);
+
+	switch (prop_id) {
+	case PROP_REPLAY:
+		/* construct-only */
+		priv->replay = g_value_get_boolean (value);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
 static void
 dispose (GObject *object)
 {
 	NMPlatform *platform = NM_PLATFORM (object);
 	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	struct nl_recv_stats stats;
 
 	_LOGD ("dispose");
 
+	nm_linux_platform_record_stop (platform);
+
+	nm_clear_pointer (&priv->event_worker, event_worker_free);
+
+	_bridge_vlans_invalidate (platform);
+
+	_nl_get_recv_stats (priv, &stats);
+	_LOGD ("netlink: statistics: %"G_GUINT64_FORMAT" wakeups, %"G_GUINT64_FORMAT" messages in %"G_GUINT64_FORMAT" datagrams (%"G_GUINT64_FORMAT" bytes) with %"G_GUINT64_FORMAT" syscalls, %"G_GUINT64_FORMAT" events deferred during dumps",
+	       priv->nl_stats.n_wakeups,
+	       priv->nl_stats.n_messages,
+	       stats.n_datagrams,
+	       stats.n_bytes,
+	       stats.n_syscalls,
+	       priv->nl_stats.n_deferred);
+
 	delayed_action_wait_for_nl_response_complete_all (platform,
 	                                                  WAIT_FOR_NL_RESPONSE_RESULT_FAILED_DISPOSING);
 
+	/* pending asynchronous requests fail, and all callbacks are invoked
+	 * right away. */
+	async_request_complete_all (platform, WAIT_FOR_NL_RESPONSE_RESULT_FAILED_DISPOSING);
+	async_request_dispatch (platform);
+	nm_clear_g_source (&priv->async.idle_id);
+	nm_clear_pointer (&priv->async.pending, g_hash_table_unref);
+
+	event_deferred_clear (platform);
+
 	priv->delayed_action.flags = DELAYED_ACTION_TYPE_NONE;
+	nm_clear_g_source (&priv->resync.timeout_id);
 	g_ptr_array_set_size (priv->delayed_action.list_master_connected, 0);
 	g_ptr_array_set_size (priv->delayed_action.list_refresh_link, 0);
 
@@ -9225,9 +14389,14 @@ finalize (GObject *object)
 	g_array_unref (priv->delayed_action.list_wait_for_nl_response);
 
 	nl_socket_free (priv->genl);
+	g_strfreev (priv->ethtool_ss_features);
 
-	g_source_remove (priv->event_id);
-	g_io_channel_unref (priv->event_channel);
+	nm_clear_g_source (&priv->event_id);
+	nm_clear_pointer (&priv->event_channel, g_io_channel_unref);
+	nl_socket_free (priv->nlh_event);
+
+	nm_clear_g_source (&priv->request_id);
+	nm_clear_pointer (&priv->request_channel, g_io_channel_unref);
 	nl_socket_free (priv->nlh);
 
 	if (priv->sysctl_get_prev_values) {
@@ -9247,9 +14416,19 @@ nm_linux_platform_class_init (NMLinuxPlatformClass *klass)
 	NMPlatformClass *platform_class = NM_PLATFORM_CLASS (klass);
 
 	object_class->constructed = constructed;
+	object_class->set_property = set_property;
 	object_class->dispose = dispose;
 	object_class->finalize = finalize;
 
+	obj_properties[PROP_REPLAY] =
+	    g_param_spec_boolean (NM_LINUX_PLATFORM_REPLAY, "", "",
+	                          FALSE,
+	                          G_PARAM_WRITABLE |
+	                          G_PARAM_CONSTRUCT_ONLY |
+	                          G_PARAM_STATIC_STRINGS);
+
+	g_object_class_install_properties (object_class, _PROPERTY_ENUMS_LAST, obj_properties);
+
 	platform_class->sysctl_set = sysctl_set;
 	platform_class->sysctl_set_async = sysctl_set_async;
 	platform_class->sysctl_get = sysctl_get;
@@ -9263,6 +14442,7 @@ nm_linux_platform_class_init (NMLinuxPlatformClass *klass)
 
 	platform_class->link_set_up = link_set_up;
 	platform_class->link_set_down = link_set_down;
+	platform_class->link_change_flags_async = link_change_flags_async;
 	platform_class->link_set_arp = link_set_arp;
 	platform_class->link_set_noarp = link_set_noarp;
 
@@ -9277,6 +14457,7 @@ nm_linux_platform_class_init (NMLinuxPlatformClass *klass)
 	platform_class->link_set_name = link_set_name;
 	platform_class->link_set_sriov_params_async = link_set_sriov_params_async;
 	platform_class->link_set_sriov_vfs = link_set_sriov_vfs;
+	platform_class->link_set_sriov_vfs_async = link_set_sriov_vfs_async;
 	platform_class->link_set_bridge_vlans = link_set_bridge_vlans;
 
 	platform_class->link_get_physical_port_id = link_get_physical_port_id;
@@ -9284,6 +14465,10 @@ nm_linux_platform_class_init (NMLinuxPlatformClass *klass)
 	platform_class->link_get_wake_on_lan = link_get_wake_on_lan;
 	platform_class->link_get_driver_info = link_get_driver_info;
 
+	platform_class->ethtool_get_features = ethtool_get_features;
+	platform_class->ethtool_set_features = ethtool_set_features;
+	platform_class->ethtool_get_link_settings = ethtool_get_link_settings;
+
 	platform_class->link_supports_carrier_detect = link_supports_carrier_detect;
 	platform_class->link_supports_vlans = link_supports_vlans;
 	platform_class->link_supports_sriov = link_supports_sriov;
@@ -9335,13 +14520,19 @@ nm_linux_platform_class_init (NMLinuxPlatformClass *klass)
 	platform_class->link_6lowpan_add = link_6lowpan_add;
 
 	platform_class->object_delete = object_delete;
+	platform_class->object_add_async = object_add_async;
+	platform_class->object_delete_async = object_delete_async;
 	platform_class->ip4_address_add = ip4_address_add;
 	platform_class->ip6_address_add = ip6_address_add;
 	platform_class->ip4_address_delete = ip4_address_delete;
 	platform_class->ip6_address_delete = ip6_address_delete;
 
 	platform_class->ip_route_add = ip_route_add;
+	platform_class->ip_route_add_many = ip_route_add_many;
+	platform_class->ip_route_delete_many = ip_route_delete_many;
+	platform_class->route_ignore_changed = route_ignore_changed;
 	platform_class->ip_route_get = ip_route_get;
+	platform_class->ip_nexthop_add = ip_nexthop_add;
 
 	platform_class->routing_rule_add = routing_rule_add;
 
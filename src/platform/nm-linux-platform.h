@@ -15,6 +15,8 @@
 #define NM_IS_LINUX_PLATFORM_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), NM_TYPE_LINUX_PLATFORM))
 #define NM_LINUX_PLATFORM_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), NM_TYPE_LINUX_PLATFORM, NMLinuxPlatformClass))
 
+#define NM_LINUX_PLATFORM_REPLAY "replay"
+
 typedef struct _NMLinuxPlatform NMLinuxPlatform;
 typedef struct _NMLinuxPlatformClass NMLinuxPlatformClass;
 
@@ -24,4 +26,44 @@ NMPlatform *nm_linux_platform_new (gboolean log_with_ptr, gboolean netns_support
 
 void nm_linux_platform_setup (void);
 
+NMPlatform *nm_linux_platform_new_replay (gboolean log_with_ptr);
+
+gboolean nm_linux_platform_record_start (NMPlatform *platform, const char *filename, GError **error);
+void nm_linux_platform_record_stop (NMPlatform *platform);
+
+gboolean nm_linux_platform_replay (NMPlatform *platform,
+                                   const char *filename,
+                                   guint64 *out_n_messages,
+                                   GError **error);
+
+void _nmtst_linux_platform_simulate_overrun (NMPlatform *platform);
+gboolean _nmtst_linux_platform_event_worker_set_error (NMPlatform *platform,
+                                                       int error,
+                                                       guint64 *out_n_polls);
+GPtrArray *_nmtst_linux_platform_sriov_vfs_create_nlmsgs (NMPlatform *platform,
+                                                          int ifindex,
+                                                          const NMPlatformVF *const *vfs);
+gboolean _nmtst_linux_platform_sriov_vf_is_satisfied (const NMPlatformVF *vf,
+                                                      const NMPlatformVF *state);
+gboolean _nmtst_linux_platform_bridge_vlan_get (NMPlatform *platform,
+                                                int ifindex,
+                                                guint16 vid,
+                                                gboolean *out_untagged,
+                                                gboolean *out_pvid);
+void _nmtst_linux_platform_wireguard_peers_diff (const NMPObject *lnk_old,
+                                                 const NMPlatformLnkWireGuard *lnk_wireguard,
+                                                 const struct _NMPWireGuardPeer *peers,
+                                                 const NMPlatformWireGuardChangePeerFlags *peer_flags,
+                                                 guint peers_len,
+                                                 NMPlatformWireGuardChangeFlags *inout_change_flags,
+                                                 GArray **out_peers,
+                                                 GArray **out_peer_flags,
+                                                 GPtrArray **out_allowed_ips);
+guint _nmtst_linux_platform_wireguard_get_n_refreshes (NMPlatform *platform);
+
+struct nlattr;
+gboolean _nmtst_linux_platform_ethtool_bitset_parse (const struct nlattr *nla,
+                                                     guint32 *words,
+                                                     guint n_words);
+
 #endif /* __NETWORKMANAGER_LINUX_PLATFORM_H__ */
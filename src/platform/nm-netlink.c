@@ -9,6 +9,7 @@
 
 #include <unistd.h>
 #include <fcntl.h>
+#include <linux/filter.h>
 
 /*****************************************************************************/
 
@@ -27,6 +28,13 @@
 #define NETLINK_EXT_ACK         11
 #endif
 
+#ifndef NETLINK_GET_STRICT_CHK
+#define NETLINK_GET_STRICT_CHK  12
+#endif
+
+/* number of datagrams that nl_recv_borrow() fetches with one recvmmsg() call. */
+#define NL_RECV_MMSG_MAX        8u
+
 struct nl_msg {
 	int                     nm_protocol;
 	struct sockaddr_nl      nm_src;
@@ -35,8 +43,16 @@ struct nl_msg {
 	struct nlmsghdr *       nm_nlh;
 	size_t                  nm_size;
 	bool                    nm_creds_has:1;
+
+	/* the message only refers to a received header, see nlmsg_set_view(). */
+	bool                    nm_is_view:1;
 };
 
+typedef union {
+	char buf[CMSG_SPACE (sizeof (struct ucred))];
+	struct cmsghdr align;
+} NLRecvCtrlBuf;
+
 struct nl_sock {
 	struct sockaddr_nl      s_local;
 	struct sockaddr_nl      s_peer;
@@ -46,6 +62,25 @@ struct nl_sock {
 	unsigned int            s_seq_expect;
 	int                     s_flags;
 	size_t                  s_bufsize;
+
+	/* The receive ring of nl_recv_borrow(). It is allocated on first use
+	 * and consists of NL_RECV_MMSG_MAX slots of @slot_size bytes. A refill
+	 * reads as many pending datagrams as there are slots. The datagrams
+	 * [n_next, n_filled) are still queued. */
+	struct {
+		unsigned char *buf;
+		size_t slot_size;
+		struct mmsghdr mmsgs[NL_RECV_MMSG_MAX];
+		struct iovec iovs[NL_RECV_MMSG_MAX];
+		struct sockaddr_nl addrs[NL_RECV_MMSG_MAX];
+		NLRecvCtrlBuf ctrls[NL_RECV_MMSG_MAX];
+		guint n_filled;
+		guint n_next;
+		guint n_borrowed;
+		bool no_recvmmsg:1;
+	} s_recv;
+
+	struct nl_recv_stats    s_recv_stats;
 };
 
 /*****************************************************************************/
@@ -106,6 +141,9 @@ nl_nlmsghdr_to_str (const struct nlmsghdr *hdr, char *buf, gsize len)
 	case RTM_GETTFILTER: s = "RTM_GETTFILTER";  break;
 	case RTM_NEWTFILTER: s = "RTM_NEWTFILTER";  break;
 	case RTM_DELTFILTER: s = "RTM_DELTFILTER";  break;
+	case RTM_GETNEXTHOP: s = "RTM_GETNEXTHOP";  break;
+	case RTM_NEWNEXTHOP: s = "RTM_NEWNEXTHOP";  break;
+	case RTM_DELNEXTHOP: s = "RTM_DELNEXTHOP";  break;
 	case NLMSG_NOOP:     s = "NLMSG_NOOP";      break;
 	case NLMSG_ERROR:    s = "NLMSG_ERROR";     break;
 	case NLMSG_DONE:     s = "NLMSG_DONE";      break;
@@ -154,6 +192,7 @@ nl_nlmsghdr_to_str (const struct nlmsghdr *hdr, char *buf, gsize len)
 	case RTM_NEWROUTE:
 	case RTM_NEWQDISC:
 	case RTM_NEWTFILTER:
+	case RTM_NEWNEXTHOP:
 		_F (NLM_F_REPLACE, "replace");
 		_F (NLM_F_EXCL, "excl");
 		_F (NLM_F_CREATE, "create");
@@ -162,6 +201,7 @@ nl_nlmsghdr_to_str (const struct nlmsghdr *hdr, char *buf, gsize len)
 	case RTM_GETLINK:
 	case RTM_GETADDR:
 	case RTM_GETROUTE:
+	case RTM_GETNEXTHOP:
 	case RTM_DELQDISC:
 	case RTM_DELTFILTER:
 		_F (NLM_F_DUMP, "dump");
@@ -290,6 +330,51 @@ nlmsg_alloc_convert (struct nlmsghdr *hdr)
 	return nm;
 }
 
+/**
+ * nlmsg_alloc_view:
+ *
+ * Like nlmsg_alloc(), but the message has no buffer of its own. Point
+ * it to a received message with nlmsg_set_view(). This allows to parse
+ * many received messages with one allocation.
+ *
+ * Returns: the new message, free with nlmsg_free().
+ */
+struct nl_msg *
+nlmsg_alloc_view (void)
+{
+	struct nl_msg *nm;
+
+	nm = g_slice_new (struct nl_msg);
+	*nm = (struct nl_msg) {
+		.nm_protocol = -1,
+		.nm_is_view  = TRUE,
+	};
+	return nm;
+}
+
+/**
+ * nlmsg_set_view:
+ * @msg: a message from nlmsg_alloc_view().
+ * @hdr: the netlink message header.
+ *
+ * Like nlmsg_alloc_convert(), but instead of copying @hdr, @msg only
+ * refers to it. The message must not be modified, and it is only valid
+ * as long as @hdr is.
+ */
+void
+nlmsg_set_view (struct nl_msg *msg, struct nlmsghdr *hdr)
+{
+	nm_assert (msg);
+	nm_assert (msg->nm_is_view);
+
+	*msg = (struct nl_msg) {
+		.nm_protocol = -1,
+		.nm_nlh      = hdr,
+		.nm_size     = hdr->nlmsg_len,
+		.nm_is_view  = TRUE,
+	};
+}
+
 struct nl_msg *
 nlmsg_alloc_simple (int nlmsgtype, int flags)
 {
@@ -308,7 +393,8 @@ void nlmsg_free (struct nl_msg *msg)
 	if (!msg)
 		return;
 
-	g_free (msg->nm_nlh);
+	if (!msg->nm_is_view)
+		g_free (msg->nm_nlh);
 	g_slice_free (struct nl_msg, msg);
 }
 
@@ -841,8 +927,11 @@ nl_socket_free (struct nl_sock *sk)
 	if (!sk)
 		return;
 
+	nm_assert (sk->s_recv.n_borrowed == 0);
+
 	if (sk->s_fd >= 0)
 		nm_close (sk->s_fd);
+	g_free (sk->s_recv.buf);
 	g_slice_free (struct nl_sock, sk);
 }
 
@@ -864,6 +953,12 @@ nl_socket_get_msg_buf_size (struct nl_sock *sk)
 	return sk->s_bufsize;
 }
 
+void
+nl_socket_get_recv_stats (const struct nl_sock *sk, struct nl_recv_stats *out_stats)
+{
+	*out_stats = sk->s_recv_stats;
+}
+
 int
 nl_socket_set_passcred (struct nl_sock *sk, int state)
 {
@@ -990,6 +1085,60 @@ nl_socket_set_ext_ack (struct nl_sock *sk, gboolean enable)
 	return 0;
 }
 
+int
+nl_socket_set_strict_check (struct nl_sock *sk, gboolean enable)
+{
+	int err, val;
+
+	if (sk->s_fd == -1)
+		return -NME_NL_BAD_SOCK;
+
+	val = !!enable;
+	err = setsockopt (sk->s_fd, SOL_NETLINK, NETLINK_GET_STRICT_CHK, &val, sizeof (val));
+	if (err < 0)
+		return -nm_errno_from_native (errno);
+
+	return 0;
+}
+
+int
+nl_socket_attach_filter (struct nl_sock *sk, const struct sock_filter *filter, guint len)
+{
+	const struct sock_fprog fprog = {
+		.len    = len,
+		.filter = (struct sock_filter *) filter,
+	};
+
+	if (sk->s_fd == -1)
+		return -NME_NL_BAD_SOCK;
+
+	nm_assert (filter && len > 0 && len <= G_MAXUSHORT);
+
+	if (setsockopt (sk->s_fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof (fprog)) < 0)
+		return -nm_errno_from_native (errno);
+
+	return 0;
+}
+
+int
+nl_socket_detach_filter (struct nl_sock *sk)
+{
+	int val = 0;
+
+	if (sk->s_fd == -1)
+		return -NME_NL_BAD_SOCK;
+
+	if (setsockopt (sk->s_fd, SOL_SOCKET, SO_DETACH_FILTER, &val, sizeof (val)) < 0) {
+		int errsv = errno;
+
+		/* ENOENT means there was no filter attached. */
+		if (errsv != ENOENT)
+			return -nm_errno_from_native (errsv);
+	}
+
+	return 0;
+}
+
 void nl_socket_disable_msg_peek (struct nl_sock *sk)
 {
 	sk->s_flags |= NL_MSG_PEEK_EXPLICIT;
@@ -1391,6 +1540,7 @@ nl_recv (struct nl_sock *sk,
 
 retry:
 	n = recvmsg (sk->s_fd, &msg, flags);
+	sk->s_recv_stats.n_syscalls++;
 	if (!n) {
 		retval = 0;
 		goto abort;
@@ -1458,6 +1608,8 @@ retry:
 	}
 
 	retval = n;
+	sk->s_recv_stats.n_datagrams++;
+	sk->s_recv_stats.n_bytes += n;
 
 abort:
 	g_free (msg.msg_control);
@@ -1473,3 +1625,186 @@ abort:
 	NM_SET_OUT (out_creds_has, tmpcreds_has);
 	return retval;
 }
+
+static int
+_nl_recv_ring_fill (struct nl_sock *sk)
+{
+	gboolean with_creds = NM_FLAGS_HAS (sk->s_flags, NL_SOCK_PASSCRED);
+	guint i;
+	int n;
+	int errsv;
+
+	nm_assert (sk->s_bufsize > 0);
+	nm_assert (sk->s_recv.n_borrowed == 0);
+	nm_assert (sk->s_recv.n_next >= sk->s_recv.n_filled);
+
+	sk->s_recv.n_filled = 0;
+	sk->s_recv.n_next = 0;
+
+	if (sk->s_recv.slot_size != sk->s_bufsize) {
+		/* the buffer size changed (or this is the first call). Reallocate the ring. */
+		g_free (sk->s_recv.buf);
+		sk->s_recv.slot_size = sk->s_bufsize;
+		sk->s_recv.buf = g_malloc (NL_RECV_MMSG_MAX * sk->s_recv.slot_size);
+	}
+
+	for (i = 0; i < NL_RECV_MMSG_MAX; i++) {
+		sk->s_recv.iovs[i] = (struct iovec) {
+			.iov_base = &sk->s_recv.buf[i * sk->s_recv.slot_size],
+			.iov_len  = sk->s_recv.slot_size,
+		};
+		sk->s_recv.mmsgs[i] = (struct mmsghdr) {
+			.msg_hdr = {
+				.msg_name       = &sk->s_recv.addrs[i],
+				.msg_namelen    = sizeof (struct sockaddr_nl),
+				.msg_iov        = &sk->s_recv.iovs[i],
+				.msg_iovlen     = 1,
+				.msg_control    = with_creds ? sk->s_recv.ctrls[i].buf : NULL,
+				.msg_controllen = with_creds ? sizeof (sk->s_recv.ctrls[i].buf) : 0,
+			},
+		};
+	}
+
+retry:
+	if (!sk->s_recv.no_recvmmsg) {
+		/* MSG_WAITFORONE, so that a blocking socket only blocks for the first datagram. */
+		n = recvmmsg (sk->s_fd, sk->s_recv.mmsgs, NL_RECV_MMSG_MAX, MSG_WAITFORONE, NULL);
+	} else {
+		ssize_t n2;
+
+		n2 = recvmsg (sk->s_fd, &sk->s_recv.mmsgs[0].msg_hdr, 0);
+		if (n2 > 0) {
+			sk->s_recv.mmsgs[0].msg_len = n2;
+			n = 1;
+		} else
+			n = n2;
+	}
+	sk->s_recv_stats.n_syscalls++;
+
+	if (n < 0) {
+		errsv = errno;
+		if (errsv == EINTR)
+			goto retry;
+		if (   errsv == ENOSYS
+		    && !sk->s_recv.no_recvmmsg) {
+			sk->s_recv.no_recvmmsg = TRUE;
+			goto retry;
+		}
+		return -nm_errno_from_native (errsv);
+	}
+
+	for (i = 0; i < (guint) n; i++) {
+		sk->s_recv_stats.n_bytes += sk->s_recv.mmsgs[i].msg_len;
+	}
+	sk->s_recv_stats.n_datagrams += n;
+
+	sk->s_recv.n_filled = n;
+	return n;
+}
+
+/**
+ * nl_recv_borrow:
+ * @sk: the netlink socket.
+ * @nla: the sender address of the datagram.
+ * @buf: (out): the received datagram.
+ * @out_creds: (allow-none): the credentials of the sender.
+ * @out_creds_has: (allow-none): whether @out_creds is set.
+ *
+ * Like nl_recv(), but the returned buffer is owned by @sk and must be
+ * returned with nl_recv_release(). Datagrams are read with recvmmsg()
+ * into a receive ring that is reused between calls, so that draining
+ * the socket costs neither allocations nor one syscall per datagram.
+ *
+ * The function may be called again before the buffer is released.
+ * If the queued datagrams are exhausted at that point, it falls back
+ * to nl_recv().
+ *
+ * Returns: the number of bytes in @buf, zero, or a negative error code.
+ *   If a datagram was larger than the message buffer size, it is lost
+ *   and -NME_NL_MSG_TRUNC is returned for it.
+ */
+int
+nl_recv_borrow (struct nl_sock *sk,
+                struct sockaddr_nl *nla,
+                unsigned char **buf,
+                struct ucred *out_creds,
+                gboolean *out_creds_has)
+{
+	struct msghdr *msg;
+	gboolean tmpcreds_has = FALSE;
+	guint i;
+	int r;
+
+	nm_assert (nla);
+	nm_assert (buf && !*buf);
+	nm_assert (!out_creds_has == !out_creds);
+
+	if (   sk->s_bufsize == 0
+	    || (sk->s_flags & NL_MSG_PEEK)
+	    || !(sk->s_flags & NL_MSG_PEEK_EXPLICIT)) {
+		/* the ring requires a fixed message buffer size. */
+		return nl_recv (sk, nla, buf, out_creds, out_creds_has);
+	}
+
+	if (sk->s_recv.n_next >= sk->s_recv.n_filled) {
+		if (sk->s_recv.n_borrowed > 0) {
+			/* we are called re-entrantly while the ring is still in use. */
+			return nl_recv (sk, nla, buf, out_creds, out_creds_has);
+		}
+		r = _nl_recv_ring_fill (sk);
+		if (r <= 0)
+			return r;
+	}
+
+	i = sk->s_recv.n_next++;
+	msg = &sk->s_recv.mmsgs[i].msg_hdr;
+
+	if (msg->msg_flags & MSG_TRUNC)
+		return -NME_NL_MSG_TRUNC;
+
+	if (msg->msg_namelen != sizeof (struct sockaddr_nl))
+		return -NME_UNSPEC;
+
+	if (   out_creds
+	    && (sk->s_flags & NL_SOCK_PASSCRED)) {
+		struct cmsghdr *cmsg;
+
+		for (cmsg = CMSG_FIRSTHDR (msg); cmsg; cmsg = CMSG_NXTHDR (msg, cmsg)) {
+			if (cmsg->cmsg_level != SOL_SOCKET)
+				continue;
+			if (cmsg->cmsg_type != SCM_CREDENTIALS)
+				continue;
+			memcpy (out_creds, CMSG_DATA (cmsg), sizeof (*out_creds));
+			tmpcreds_has = TRUE;
+			break;
+		}
+	}
+	NM_SET_OUT (out_creds_has, tmpcreds_has);
+
+	*nla = sk->s_recv.addrs[i];
+	*buf = sk->s_recv.iovs[i].iov_base;
+	sk->s_recv.n_borrowed++;
+	return sk->s_recv.mmsgs[i].msg_len;
+}
+
+/**
+ * nl_recv_release:
+ * @sk: the netlink socket.
+ * @buf: (allow-none): a buffer returned by nl_recv_borrow().
+ */
+void
+nl_recv_release (struct nl_sock *sk, unsigned char *buf)
+{
+	if (!buf)
+		return;
+
+	if (   sk->s_recv.buf
+	    && buf >= sk->s_recv.buf
+	    && buf < &sk->s_recv.buf[NL_RECV_MMSG_MAX * sk->s_recv.slot_size]) {
+		nm_assert (sk->s_recv.n_borrowed > 0);
+		sk->s_recv.n_borrowed--;
+		return;
+	}
+
+	g_free (buf);
+}
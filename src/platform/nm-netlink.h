@@ -24,6 +24,13 @@
 #define NLM_F_ACK_TLVS                  0x200
 #endif
 
+/* nexthop objects were added in kernel 5.3. */
+#ifndef RTM_NEWNEXTHOP
+#define RTM_NEWNEXTHOP                  104
+#define RTM_DELNEXTHOP                  105
+#define RTM_GETNEXTHOP                  106
+#endif
+
 /*****************************************************************************/
 
 /* Basic attribute data types */
@@ -381,6 +388,10 @@ struct nl_msg *nlmsg_alloc_size (size_t max);
 
 struct nl_msg *nlmsg_alloc_convert (struct nlmsghdr *hdr);
 
+struct nl_msg *nlmsg_alloc_view (void);
+
+void nlmsg_set_view (struct nl_msg *msg, struct nlmsghdr *hdr);
+
 struct nl_msg *nlmsg_alloc_simple (int nlmsgtype, int flags);
 
 void *nlmsg_reserve (struct nl_msg *n, size_t len, int pad);
@@ -546,6 +557,25 @@ int nl_recv (struct nl_sock *sk,
              struct ucred *out_creds,
              gboolean *out_creds_has);
 
+int nl_recv_borrow (struct nl_sock *sk,
+                    struct sockaddr_nl *nla,
+                    unsigned char **buf,
+                    struct ucred *out_creds,
+                    gboolean *out_creds_has);
+
+void nl_recv_release (struct nl_sock *sk, unsigned char *buf);
+
+struct nl_recv_stats {
+	/* number of recvmsg()/recvmmsg() calls */
+	guint64 n_syscalls;
+	/* number of received datagrams */
+	guint64 n_datagrams;
+	/* number of received bytes */
+	guint64 n_bytes;
+};
+
+void nl_socket_get_recv_stats (const struct nl_sock *sk, struct nl_recv_stats *out_stats);
+
 int nl_send (struct nl_sock *sk, struct nl_msg *msg);
 
 int nl_send_auto (struct nl_sock *sk, struct nl_msg *msg);
@@ -593,6 +623,14 @@ int nl_wait_for_ack (struct nl_sock *sk,
 
 int nl_socket_set_ext_ack (struct nl_sock *sk, gboolean enable);
 
+int nl_socket_set_strict_check (struct nl_sock *sk, gboolean enable);
+
+struct sock_filter;
+
+int nl_socket_attach_filter (struct nl_sock *sk, const struct sock_filter *filter, guint len);
+
+int nl_socket_detach_filter (struct nl_sock *sk);
+
 /*****************************************************************************/
 
 void *genlmsg_put (struct nl_msg *msg, uint32_t port, uint32_t seq, int family,
@@ -533,93 +533,120 @@ _ASSERT_ethtool_feature_infos (void)
 #endif
 }
 
-static NMEthtoolFeatureStates *
-ethtool_get_features (SocketHandle *shandle)
+NMEthtoolFeatureStates *
+nmp_utils_ethtool_features_new (guint n_ss_features,
+                                const char *const*ss_features,
+                                const NMPUtilsEthtoolFeatureBlock *blocks)
 {
 	gs_free NMEthtoolFeatureStates *states = NULL;
-	gs_free struct ethtool_gstrings *ss_features = NULL;
+	const NMEthtoolFeatureState *states_list0 = NULL;
+	const NMEthtoolFeatureState *const*states_plist0 = NULL;
+	guint states_plist_n = 0;
+	guint idx;
 
 	_ASSERT_ethtool_feature_infos ();
 
-	ss_features = ethtool_get_stringset (shandle, ETH_SS_FEATURES);
-	if (!ss_features)
+	if (n_ss_features == 0)
 		return NULL;
 
-	if (ss_features->len > 0) {
-		gs_free struct ethtool_gfeatures *gfeatures_free = NULL;
-		struct ethtool_gfeatures *gfeatures;
-		gsize gfeatures_len;
-		guint idx;
-		const NMEthtoolFeatureState *states_list0 = NULL;
-		const NMEthtoolFeatureState *const*states_plist0 = NULL;
-		guint states_plist_n = 0;
-
-		gfeatures_len =   sizeof (struct ethtool_gfeatures)
-		                + (NM_DIV_ROUND_UP (ss_features->len, 32u) * sizeof(gfeatures->features[0]));
-		gfeatures = nm_malloc0_maybe_a (300, gfeatures_len, &gfeatures_free);
-		gfeatures->cmd = ETHTOOL_GFEATURES;
-		gfeatures->size = NM_DIV_ROUND_UP (ss_features->len, 32u);
-		if (_ethtool_call_handle (shandle, gfeatures, gfeatures_len) < 0)
-			return NULL;
+	for (idx = 0; idx < G_N_ELEMENTS (_ethtool_feature_infos); idx++) {
+		const NMEthtoolFeatureInfo *info = &_ethtool_feature_infos[idx];
+		guint idx_kernel_name;
 
-		for (idx = 0; idx < G_N_ELEMENTS (_ethtool_feature_infos); idx++) {
-			const NMEthtoolFeatureInfo *info = &_ethtool_feature_infos[idx];
-			guint idx_kernel_name;
-
-			for (idx_kernel_name = 0; idx_kernel_name < info->n_kernel_names; idx_kernel_name++) {
-				NMEthtoolFeatureState *kstate;
-				const char *kernel_name = info->kernel_names[idx_kernel_name];
-				int i_feature;
-				guint i_block;
-				guint32 i_flag;
-
-				i_feature = ethtool_gstrings_find (ss_features, kernel_name);
-				if (i_feature < 0)
-					continue;
-
-				i_block = ((guint) i_feature) / 32u;
-				i_flag = (guint32) (1u << (((guint) i_feature) % 32u));
-
-				if (!states) {
-					states = g_malloc0 (sizeof (NMEthtoolFeatureStates)
-					                    + (N_ETHTOOL_KERNEL_FEATURES * sizeof (NMEthtoolFeatureState))
-					                    + ((N_ETHTOOL_KERNEL_FEATURES + G_N_ELEMENTS (_ethtool_feature_infos)) * sizeof (NMEthtoolFeatureState *)));
-					states_list0 = &states->states_list[0];
-					states_plist0 = (gpointer) &states_list0[N_ETHTOOL_KERNEL_FEATURES];
-					states->n_ss_features = ss_features->len;
-				}
-
-				nm_assert (states->n_states < N_ETHTOOL_KERNEL_FEATURES);
-				kstate = (NMEthtoolFeatureState *) &states_list0[states->n_states];
-				states->n_states++;
-
-				kstate->info = info;
-				kstate->idx_ss_features = i_feature;
-				kstate->idx_kernel_name = idx_kernel_name;
-				kstate->available     = !!(gfeatures->features[i_block].available     & i_flag);
-				kstate->requested     = !!(gfeatures->features[i_block].requested     & i_flag);
-				kstate->active        = !!(gfeatures->features[i_block].active        & i_flag);
-				kstate->never_changed = !!(gfeatures->features[i_block].never_changed & i_flag);
-
-				nm_assert (states_plist_n < N_ETHTOOL_KERNEL_FEATURES + G_N_ELEMENTS (_ethtool_feature_infos));
-
-				if (!states->states_indexed[info->ethtool_id - _NM_ETHTOOL_ID_FEATURE_FIRST])
-					states->states_indexed[info->ethtool_id - _NM_ETHTOOL_ID_FEATURE_FIRST] = &states_plist0[states_plist_n];
-				((const NMEthtoolFeatureState **) states_plist0)[states_plist_n] = kstate;
-				states_plist_n++;
-			}
+		for (idx_kernel_name = 0; idx_kernel_name < info->n_kernel_names; idx_kernel_name++) {
+			NMEthtoolFeatureState *kstate;
+			const char *kernel_name = info->kernel_names[idx_kernel_name];
+			gssize i_feature;
+			guint i_block;
+			guint32 i_flag;
+
+			i_feature = nm_utils_strv_find_first ((char **) ss_features, n_ss_features, kernel_name);
+			if (i_feature < 0)
+				continue;
 
-			if (states && states->states_indexed[info->ethtool_id - _NM_ETHTOOL_ID_FEATURE_FIRST]) {
-				nm_assert (states_plist_n < N_ETHTOOL_KERNEL_FEATURES + G_N_ELEMENTS (_ethtool_feature_infos));
-				nm_assert (!states_plist0[states_plist_n]);
-				states_plist_n++;
+			i_block = ((guint) i_feature) / 32u;
+			i_flag = (guint32) (1u << (((guint) i_feature) % 32u));
+
+			if (!states) {
+				states = g_malloc0 (sizeof (NMEthtoolFeatureStates)
+				                    + (N_ETHTOOL_KERNEL_FEATURES * sizeof (NMEthtoolFeatureState))
+				                    + ((N_ETHTOOL_KERNEL_FEATURES + G_N_ELEMENTS (_ethtool_feature_infos)) * sizeof (NMEthtoolFeatureState *)));
+				states_list0 = &states->states_list[0];
+				states_plist0 = (gpointer) &states_list0[N_ETHTOOL_KERNEL_FEATURES];
+				states->n_ss_features = n_ss_features;
 			}
+
+			nm_assert (states->n_states < N_ETHTOOL_KERNEL_FEATURES);
+			kstate = (NMEthtoolFeatureState *) &states_list0[states->n_states];
+			states->n_states++;
+
+			kstate->info = info;
+			kstate->idx_ss_features = i_feature;
+			kstate->idx_kernel_name = idx_kernel_name;
+			kstate->available     = !!(blocks[i_block].available     & i_flag);
+			kstate->requested     = !!(blocks[i_block].requested     & i_flag);
+			kstate->active        = !!(blocks[i_block].active        & i_flag);
+			kstate->never_changed = !!(blocks[i_block].never_changed & i_flag);
+
+			nm_assert (states_plist_n < N_ETHTOOL_KERNEL_FEATURES + G_N_ELEMENTS (_ethtool_feature_infos));
+
+			if (!states->states_indexed[info->ethtool_id - _NM_ETHTOOL_ID_FEATURE_FIRST])
+				states->states_indexed[info->ethtool_id - _NM_ETHTOOL_ID_FEATURE_FIRST] = &states_plist0[states_plist_n];
+			((const NMEthtoolFeatureState **) states_plist0)[states_plist_n] = kstate;
+			states_plist_n++;
+		}
+
+		if (states && states->states_indexed[info->ethtool_id - _NM_ETHTOOL_ID_FEATURE_FIRST]) {
+			nm_assert (states_plist_n < N_ETHTOOL_KERNEL_FEATURES + G_N_ELEMENTS (_ethtool_feature_infos));
+			nm_assert (!states_plist0[states_plist_n]);
+			states_plist_n++;
 		}
 	}
 
 	return g_steal_pointer (&states);
 }
 
+static NMEthtoolFeatureStates *
+ethtool_get_features (SocketHandle *shandle)
+{
+	gs_free struct ethtool_gstrings *ss_features = NULL;
+	gs_free struct ethtool_gfeatures *gfeatures_free = NULL;
+	gs_free const char **ss_names_free = NULL;
+	struct ethtool_gfeatures *gfeatures;
+	const char **ss_names;
+	gsize gfeatures_len;
+	guint i;
+
+	G_STATIC_ASSERT_EXPR (sizeof (NMPUtilsEthtoolFeatureBlock) == sizeof (struct ethtool_get_features_block));
+	G_STATIC_ASSERT_EXPR (G_STRUCT_OFFSET (NMPUtilsEthtoolFeatureBlock, available)     == G_STRUCT_OFFSET (struct ethtool_get_features_block, available));
+	G_STATIC_ASSERT_EXPR (G_STRUCT_OFFSET (NMPUtilsEthtoolFeatureBlock, requested)     == G_STRUCT_OFFSET (struct ethtool_get_features_block, requested));
+	G_STATIC_ASSERT_EXPR (G_STRUCT_OFFSET (NMPUtilsEthtoolFeatureBlock, active)        == G_STRUCT_OFFSET (struct ethtool_get_features_block, active));
+	G_STATIC_ASSERT_EXPR (G_STRUCT_OFFSET (NMPUtilsEthtoolFeatureBlock, never_changed) == G_STRUCT_OFFSET (struct ethtool_get_features_block, never_changed));
+
+	ss_features = ethtool_get_stringset (shandle, ETH_SS_FEATURES);
+	if (!ss_features)
+		return NULL;
+
+	if (ss_features->len == 0)
+		return NULL;
+
+	gfeatures_len =   sizeof (struct ethtool_gfeatures)
+	                + (NM_DIV_ROUND_UP (ss_features->len, 32u) * sizeof(gfeatures->features[0]));
+	gfeatures = nm_malloc0_maybe_a (300, gfeatures_len, &gfeatures_free);
+	gfeatures->cmd = ETHTOOL_GFEATURES;
+	gfeatures->size = NM_DIV_ROUND_UP (ss_features->len, 32u);
+	if (_ethtool_call_handle (shandle, gfeatures, gfeatures_len) < 0)
+		return NULL;
+
+	ss_names = nm_malloc_maybe_a (300, ss_features->len * sizeof (const char *), &ss_names_free);
+	for (i = 0; i < ss_features->len; i++)
+		ss_names[i] = (const char *) &ss_features->data[i * ETH_GSTRING_LEN];
+
+	return nmp_utils_ethtool_features_new (ss_features->len,
+	                                       ss_names,
+	                                       (const NMPUtilsEthtoolFeatureBlock *) gfeatures->features);
+}
+
 NMEthtoolFeatureStates *
 nmp_utils_ethtool_get_features (int ifindex)
 {
@@ -661,29 +688,38 @@ _ethtool_feature_state_to_string (char *buf, gsize buf_size, const NMEthtoolFeat
 	return buf;
 }
 
-gboolean
-nmp_utils_ethtool_set_features (int ifindex,
-                                const NMEthtoolFeatureStates *features,
-                                const NMTernary *requested /* indexed by NMEthtoolID - _NM_ETHTOOL_ID_FEATURE_FIRST */,
-                                gboolean do_set /* or reset */)
+/**
+ * nmp_utils_ethtool_features_prepare_set:
+ * @ifindex: the ifindex, only used for logging
+ * @features: the current feature states
+ * @requested: the requested features, indexed by NMEthtoolID - _NM_ETHTOOL_ID_FEATURE_FIRST
+ * @do_set: whether to set @requested or to reset them to their current state
+ * @valid: (out caller-allocates): the bitmask of the features to change. It has
+ *   NM_DIV_ROUND_UP (features->n_ss_features, 32) zero initialized elements.
+ * @wanted: (out caller-allocates): the bitmask of the features to enable, same
+ *   size as @valid.
+ * @out_success: (out): set to %FALSE if a requested feature cannot be changed.
+ *
+ * Collects all requested feature changes, so that the caller can apply them with
+ * one request to kernel.
+ *
+ * Returns: the number of kernel features in @valid.
+ */
+guint
+nmp_utils_ethtool_features_prepare_set (int ifindex,
+                                        const NMEthtoolFeatureStates *features,
+                                        const NMTernary *requested /* indexed by NMEthtoolID - _NM_ETHTOOL_ID_FEATURE_FIRST */,
+                                        gboolean do_set /* or reset */,
+                                        guint32 *valid,
+                                        guint32 *wanted,
+                                        gboolean *out_success)
 {
-	nm_auto_socket_handle SocketHandle shandle = SOCKET_HANDLE_INIT (ifindex);
-	gs_free struct ethtool_sfeatures *sfeatures_free = NULL;
-	struct ethtool_sfeatures *sfeatures;
-	gsize sfeatures_len;
-	int r;
 	guint i, j;
-	struct {
-		const NMEthtoolFeatureState *f_state;
-		NMTernary requested;
-	} set_states[N_ETHTOOL_KERNEL_FEATURES];
-	guint set_states_n = 0;
+	guint n_set = 0;
 	gboolean success = TRUE;
 
-	g_return_val_if_fail (ifindex > 0, 0);
-	g_return_val_if_fail (features, 0);
-	g_return_val_if_fail (requested, 0);
-
+	nm_assert (features);
+	nm_assert (requested);
 	nm_assert (features->n_states <= N_ETHTOOL_KERNEL_FEATURES);
 
 	for (i = 0; i < _NM_ETHTOOL_ID_FEATURE_NUM; i++) {
@@ -706,9 +742,9 @@ nmp_utils_ethtool_set_features (int ifindex,
 		for (j = 0; states_indexed[j]; j++) {
 			const NMEthtoolFeatureState *s = states_indexed[j];
 			char sbuf[255];
-
-			if (set_states_n >= G_N_ELEMENTS (set_states))
-				g_return_val_if_reached (FALSE);
+			guint i_block;
+			guint32 i_flag;
+			gboolean is_requested;
 
 			if (s->never_changed) {
 				nm_log_trace (LOGD_PLATFORM, "ethtool[%d]: %s: %s feature %s (%s): %s, %s (skip feature marked as never changed)",
@@ -740,13 +776,62 @@ nmp_utils_ethtool_set_features (int ifindex,
 				success = FALSE;
 			}
 
-			set_states[set_states_n].f_state = s;
-			set_states[set_states_n].requested = requested[i];
-			set_states_n++;
+			nm_assert (s->idx_ss_features < features->n_ss_features);
+
+			i_block = s->idx_ss_features / 32u;
+			i_flag = (guint32) (1u << (s->idx_ss_features % 32u));
+
+			if (do_set)
+				is_requested = (requested[i] == NM_TERNARY_TRUE);
+			else
+				is_requested = s->active;
+
+			valid[i_block] |= i_flag;
+			if (is_requested)
+				wanted[i_block] |= i_flag;
+			else
+				wanted[i_block] &= ~i_flag;
+			n_set++;
 		}
 	}
 
-	if (set_states_n == 0) {
+	*out_success = success;
+	return n_set;
+}
+
+gboolean
+nmp_utils_ethtool_set_features (int ifindex,
+                                const NMEthtoolFeatureStates *features,
+                                const NMTernary *requested /* indexed by NMEthtoolID - _NM_ETHTOOL_ID_FEATURE_FIRST */,
+                                gboolean do_set /* or reset */)
+{
+	nm_auto_socket_handle SocketHandle shandle = SOCKET_HANDLE_INIT (ifindex);
+	gs_free struct ethtool_sfeatures *sfeatures_free = NULL;
+	gs_free guint32 *bits_free = NULL;
+	struct ethtool_sfeatures *sfeatures;
+	gsize sfeatures_len;
+	guint32 *valid;
+	guint32 *wanted;
+	guint n_blocks;
+	int r;
+	guint i;
+	gboolean success;
+
+	g_return_val_if_fail (ifindex > 0, 0);
+	g_return_val_if_fail (features, 0);
+	g_return_val_if_fail (requested, 0);
+
+	n_blocks = NM_DIV_ROUND_UP (features->n_ss_features, 32U);
+	valid = nm_malloc0_maybe_a (300, 2u * n_blocks * sizeof (guint32), &bits_free);
+	wanted = &valid[n_blocks];
+
+	if (nmp_utils_ethtool_features_prepare_set (ifindex,
+	                                            features,
+	                                            requested,
+	                                            do_set,
+	                                            valid,
+	                                            wanted,
+	                                            &success) == 0) {
 		nm_log_trace (LOGD_PLATFORM, "ethtool[%d]: %s: no feature requested",
 		              ifindex,
 		              "set-features");
@@ -754,36 +839,18 @@ nmp_utils_ethtool_set_features (int ifindex,
 	}
 
 	sfeatures_len =   sizeof (struct ethtool_sfeatures)
-	                + (NM_DIV_ROUND_UP (features->n_ss_features, 32U) * sizeof(sfeatures->features[0]));
+	                + (n_blocks * sizeof(sfeatures->features[0]));
 	sfeatures = nm_malloc0_maybe_a (300, sfeatures_len, &sfeatures_free);
 	sfeatures->cmd = ETHTOOL_SFEATURES;
-	sfeatures->size = NM_DIV_ROUND_UP (features->n_ss_features, 32U);
-
-	for (i = 0; i < set_states_n; i++) {
-		const NMEthtoolFeatureState *s = set_states[i].f_state;
-		guint i_block;
-		guint32 i_flag;
-		gboolean is_requested;
-
-		i_block = s->idx_ss_features / 32u;
-		i_flag = (guint32) (1u << (s->idx_ss_features % 32u));
+	sfeatures->size = n_blocks;
 
-		sfeatures->features[i_block].valid |= i_flag;
-
-		if (do_set)
-			is_requested = (set_states[i].requested == NM_TERNARY_TRUE);
-		else
-			is_requested = s->active;
-
-		if (is_requested)
-			sfeatures->features[i_block].requested |= i_flag;
-		else
-			sfeatures->features[i_block].requested &= ~i_flag;
+	for (i = 0; i < n_blocks; i++) {
+		sfeatures->features[i].valid = valid[i];
+		sfeatures->features[i].requested = wanted[i];
 	}
 
 	r = _ethtool_call_handle (&shandle, sfeatures, sfeatures_len);
 	if (r < 0) {
-		success = FALSE;
 		nm_log_trace (LOGD_PLATFORM, "ethtool[%d]: %s: failure setting features (%s)",
 		              ifindex,
 		              "set-features",
@@ -1369,6 +1436,57 @@ nmp_utils_ip_config_source_to_string (NMIPConfigSource source, char *buf, gsize
 	return buf;
 }
 
+/**
+ * nmp_utils_rtprot_from_string:
+ * @str: the name or number of a route protocol.
+ *
+ * Parses a route protocol like iproute2 does, by the names from
+ * "/etc/iproute2/rt_protos" or by number.
+ *
+ * Returns: the protocol or -1 if @str is invalid.
+ */
+int
+nmp_utils_rtprot_from_string (const char *str)
+{
+	static const struct {
+		const char *name;
+		guint8 rtprot;
+	} names[] = {
+		{ "unspec",     0   },
+		{ "redirect",   1   },
+		{ "kernel",     2   },
+		{ "boot",       3   },
+		{ "static",     4   },
+		{ "gated",      8   },
+		{ "ra",         9   },
+		{ "mrt",        10  },
+		{ "zebra",      11  },
+		{ "bird",       12  },
+		{ "dnrouted",   13  },
+		{ "xorp",       14  },
+		{ "ntk",        15  },
+		{ "dhcp",       16  },
+		{ "keepalived", 18  },
+		{ "babel",      42  },
+		{ "bgp",        186 },
+		{ "isis",       187 },
+		{ "ospf",       188 },
+		{ "rip",        189 },
+		{ "eigrp",      192 },
+	};
+	guint i;
+
+	if (!str)
+		return -1;
+
+	for (i = 0; i < G_N_ELEMENTS (names); i++) {
+		if (nm_streq (str, names[i].name))
+			return names[i].rtprot;
+	}
+
+	return _nm_utils_ascii_str_to_int64 (str, 0, 0, 255, -1);
+}
+
 /**
  * nmp_utils_sysctl_open_netdir:
  * @ifindex: the ifindex for which to open "/sys/class/net/%s"
@@ -85,6 +85,27 @@ struct _NMEthtoolFeatureStates {
 	const NMEthtoolFeatureState states_list[];
 };
 
+typedef struct {
+	/* We don't want to include <linux/ethtool.h> in header files,
+	 * thus create a ABI compatible version of struct ethtool_get_features_block.*/
+	guint32 available;
+	guint32 requested;
+	guint32 active;
+	guint32 never_changed;
+} NMPUtilsEthtoolFeatureBlock;
+
+NMEthtoolFeatureStates *nmp_utils_ethtool_features_new (guint n_ss_features,
+                                                        const char *const*ss_features,
+                                                        const NMPUtilsEthtoolFeatureBlock *blocks);
+
+guint nmp_utils_ethtool_features_prepare_set (int ifindex,
+                                              const NMEthtoolFeatureStates *features,
+                                              const NMTernary *requested /* indexed by NMEthtoolID - _NM_ETHTOOL_ID_FEATURE_FIRST */,
+                                              gboolean do_set /* or reset */,
+                                              guint32 *valid,
+                                              guint32 *wanted,
+                                              gboolean *out_success);
+
 NMEthtoolFeatureStates *nmp_utils_ethtool_get_features (int ifindex);
 
 gboolean nmp_utils_ethtool_set_features (int ifindex,
@@ -106,6 +127,8 @@ NMIPConfigSource nmp_utils_ip_config_source_coerce_from_rtprot (NMIPConfigSource
 NMIPConfigSource nmp_utils_ip_config_source_round_trip_rtprot  (NMIPConfigSource source) _nm_const;
 const char *     nmp_utils_ip_config_source_to_string (NMIPConfigSource source, char *buf, gsize len);
 
+int nmp_utils_rtprot_from_string (const char *str);
+
 const char *nmp_utils_if_indextoname (int ifindex, char *out_ifname/*IFNAMSIZ*/);
 int nmp_utils_if_nametoindex (const char *ifname);
 
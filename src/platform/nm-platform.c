@@ -19,6 +19,7 @@
 #include <linux/if_tun.h>
 #include <linux/if_tunnel.h>
 #include <linux/rtnetlink.h>
+#include <linux/pkt_sched.h>
 #include <linux/tc_act/tc_mirred.h>
 #include <libudev.h>
 
@@ -40,6 +41,8 @@ G_STATIC_ASSERT (G_STRUCT_OFFSET (NMPlatformIPAddress, address_ptr) == G_STRUCT_
 G_STATIC_ASSERT (G_STRUCT_OFFSET (NMPlatformIPAddress, address_ptr) == G_STRUCT_OFFSET (NMPlatformIP6Address, address));
 G_STATIC_ASSERT (G_STRUCT_OFFSET (NMPlatformIPRoute, network_ptr) == G_STRUCT_OFFSET (NMPlatformIP4Route, network));
 G_STATIC_ASSERT (G_STRUCT_OFFSET (NMPlatformIPRoute, network_ptr) == G_STRUCT_OFFSET (NMPlatformIP6Route, network));
+G_STATIC_ASSERT (G_STRUCT_OFFSET (NMPlatformIPNexthop, gateway_ptr) == G_STRUCT_OFFSET (NMPlatformIP4Nexthop, gateway));
+G_STATIC_ASSERT (G_STRUCT_OFFSET (NMPlatformIPNexthop, gateway_ptr) == G_STRUCT_OFFSET (NMPlatformIP6Nexthop, gateway));
 
 /*****************************************************************************/
 
@@ -169,6 +172,28 @@ typedef struct _NMPlatformPrivate {
 	GHashTable *ip4_dev_route_blacklist_hash;
 	NMDedupMultiIndex *multi_idx;
 	NMPCache *cache;
+	NMPlatformRouteIgnore route_ignore;
+
+	/* per address family, maps the ifindex to the value of ip_route_serial_counter
+	 * when a visible route of that interface changed the last time. */
+	GHashTable *ip_route_serials[2];
+	guint ip_route_serial_counter;
+
+	/* incremented whenever the route-ignore settings change. */
+	guint route_ignore_generation;
+
+	struct {
+		/* the ChangeBatchSubscription of nm_platform_change_batch_subscribe(). */
+		GArray *subscriptions;
+		guint n_subscriptions[NMP_OBJECT_TYPE_MAX + 1];
+		guint subscription_id_last;
+
+		/* per object type, the ChangeBatchEntry that are not yet delivered,
+		 * by object ID. */
+		GHashTable *pending[NMP_OBJECT_TYPE_MAX + 1];
+		guint idle_id;
+		int is_dispatching;
+	} change_batch;
 } NMPlatformPrivate;
 
 G_DEFINE_TYPE (NMPlatform, nm_platform, G_TYPE_OBJECT)
@@ -1709,6 +1734,12 @@ nm_platform_link_supports_sriov (NMPlatform *self, int ifindex)
  * @num_vfs: the number of VFs to create
  * @autoprobe: the new autoprobe-drivers value (pass
  *     %NM_TERNARY_DEFAULT to keep current value)
+ * @eswitch_mode: the devlink eswitch mode, or -1 to keep
+ *     the current value
+ * @eswitch_inline_mode: the devlink eswitch inline mode, or -1
+ *     to keep the current value
+ * @eswitch_encap_mode: the devlink eswitch encap mode, or -1
+ *     to keep the current value
  * @callback: called when the operation finishes
  * @callback_data: data passed to @callback
  * @cancellable: cancellable to abort the operation
@@ -1716,12 +1747,18 @@ nm_platform_link_supports_sriov (NMPlatform *self, int ifindex)
  * Sets SR-IOV parameters asynchronously without
  * blocking the main thread. The callback function is
  * always invoked, and asynchronously.
+ *
+ * If the eswitch needs to change, the existing VFs are destroyed
+ * first and the VFs are created after changing it.
  */
 void
 nm_platform_link_set_sriov_params_async (NMPlatform *self,
                                          int ifindex,
                                          guint num_vfs,
                                          NMTernary autoprobe,
+                                         int eswitch_mode,
+                                         int eswitch_inline_mode,
+                                         int eswitch_encap_mode,
                                          NMPlatformAsyncCallback callback,
                                          gpointer callback_data,
                                          GCancellable *cancellable)
@@ -1730,11 +1767,15 @@ nm_platform_link_set_sriov_params_async (NMPlatform *self,
 
 	g_return_if_fail (ifindex > 0);
 
-	_LOG3D ("link: setting %u total VFs and autoprobe %d", num_vfs, (int) autoprobe);
+	_LOG3D ("link: setting %u total VFs, autoprobe %d and eswitch mode %d, inline-mode %d, encap-mode %d",
+	        num_vfs, (int) autoprobe, eswitch_mode, eswitch_inline_mode, eswitch_encap_mode);
 	klass->link_set_sriov_params_async (self,
 	                                    ifindex,
 	                                    num_vfs,
 	                                    autoprobe,
+	                                    eswitch_mode,
+	                                    eswitch_inline_mode,
+	                                    eswitch_encap_mode,
 	                                    callback,
 	                                    callback_data,
 	                                    cancellable);
@@ -1758,6 +1799,47 @@ nm_platform_link_set_sriov_vfs (NMPlatform *self, int ifindex, const NMPlatformV
 	return klass->link_set_sriov_vfs (self, ifindex, vfs);
 }
 
+/**
+ * nm_platform_link_set_sriov_vfs_async:
+ * @self: platform instance
+ * @ifindex: the index of the interface to change
+ * @vfs: the VFs to configure
+ * @callback: called when the operation finishes
+ * @callback_data: data passed to @callback
+ * @cancellable: cancellable to abort the operation
+ *
+ * Like nm_platform_link_set_sriov_vfs(), but does not wait for
+ * kernel to acknowledge the requests. The callback function is
+ * always invoked, and asynchronously.
+ */
+void
+nm_platform_link_set_sriov_vfs_async (NMPlatform *self,
+                                      int ifindex,
+                                      const NMPlatformVF *const *vfs,
+                                      NMPlatformAsyncCallback callback,
+                                      gpointer callback_data,
+                                      GCancellable *cancellable)
+{
+	guint i;
+	_CHECK_SELF_VOID (self, klass);
+
+	g_return_if_fail (ifindex > 0);
+
+	_LOG3D ("link: setting VFs asynchronously");
+	for (i = 0; vfs[i]; i++) {
+		const NMPlatformVF *vf = vfs[i];
+
+		_LOG3D ("link:   VF %s", nm_platform_vf_to_string (vf, NULL, 0));
+	}
+
+	klass->link_set_sriov_vfs_async (self,
+	                                 ifindex,
+	                                 vfs,
+	                                 callback,
+	                                 callback_data,
+	                                 cancellable);
+}
+
 gboolean
 nm_platform_link_set_bridge_vlans (NMPlatform *self, int ifindex, gboolean on_master, const NMPlatformBridgeVlan *const *vlans)
 {
@@ -1777,7 +1859,35 @@ nm_platform_link_set_bridge_vlans (NMPlatform *self, int ifindex, gboolean on_ma
 		}
 	}
 
-	return klass->link_set_bridge_vlans (self, ifindex, on_master, vlans);
+	return klass->link_set_bridge_vlans (self, ifindex, on_master, vlans, !vlans);
+}
+
+/**
+ * nm_platform_link_flush_bridge_vlans:
+ * @self: the #NMPlatform instance
+ * @ifindex: the bridge or bridge port
+ * @on_master: whether to flush the VLANs of the port on the bridge,
+ *   or the VLANs of the device itself
+ * @keep_vlans: (allow-none): the VLANs to keep
+ *
+ * Deletes all VLANs of @ifindex, except for the ones in @keep_vlans that
+ * already exist with the same flags. Unlike a full flush, this allows
+ * to add @keep_vlans afterwards without changing them again.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean
+nm_platform_link_flush_bridge_vlans (NMPlatform *self, int ifindex, gboolean on_master, const NMPlatformBridgeVlan *const *keep_vlans)
+{
+	_CHECK_SELF (self, klass, FALSE);
+
+	g_return_val_if_fail (ifindex > 0, FALSE);
+
+	_LOG3D ("link: clearing bridge VLANs on %s%s",
+	        on_master ? "master" : "self",
+	        keep_vlans && keep_vlans[0] ? ", except for the configured ones" : "");
+
+	return klass->link_set_bridge_vlans (self, ifindex, on_master, keep_vlans, TRUE);
 }
 
 /**
@@ -1817,6 +1927,129 @@ nm_platform_link_set_down (NMPlatform *self, int ifindex)
 	return klass->link_set_down (self, ifindex);
 }
 
+static void
+_async_fallback_return_idle (gpointer user_data,
+                             GCancellable *cancellable)
+{
+	gs_free_error GError *cancelled_error = NULL;
+	gs_free_error GError *error = NULL;
+	NMPlatformAsyncCallback callback;
+	gpointer callback_data;
+
+	nm_utils_user_data_unpack (user_data, &callback, &callback_data, &error);
+	g_cancellable_set_error_if_cancelled (cancellable, &cancelled_error);
+	callback (cancelled_error ?: error, callback_data);
+}
+
+/* For platform implementations without asynchronous requests, perform
+ * the operation synchronously but still report the result via the
+ * callback, on idle. */
+static guint32
+_async_fallback_complete (NMPlatform *self,
+                          gboolean success,
+                          const char *what,
+                          NMPlatformAsyncCallback callback,
+                          gpointer callback_data,
+                          GCancellable *cancellable)
+{
+	GError *error = NULL;
+
+	if (!callback)
+		return 0;
+
+	if (!success) {
+		g_set_error (&error,
+		             NM_UTILS_ERROR,
+		             NM_UTILS_ERROR_UNKNOWN,
+		             "failure to %s",
+		             what);
+	}
+	nm_utils_invoke_on_idle (_async_fallback_return_idle,
+	                         nm_utils_user_data_pack (callback, callback_data, error),
+	                         cancellable);
+	return 0;
+}
+
+static guint32
+_link_set_updown_async (NMPlatform *self,
+                        int ifindex,
+                        gboolean up,
+                        NMPlatformAsyncCallback callback,
+                        gpointer callback_data,
+                        GCancellable *cancellable)
+{
+	gboolean success;
+
+	_CHECK_SELF (self, klass, 0);
+
+	g_return_val_if_fail (ifindex > 0, 0);
+	g_return_val_if_fail (callback || !callback_data, 0);
+
+	_LOG3D ("link: setting %s async", up ? "up" : "down");
+
+	if (klass->link_change_flags_async) {
+		return klass->link_change_flags_async (self,
+		                                       ifindex,
+		                                       IFF_UP,
+		                                       up ? IFF_UP : 0,
+		                                       callback,
+		                                       callback_data,
+		                                       cancellable);
+	}
+
+	success =   up
+	          ? klass->link_set_up (self, ifindex, NULL)
+	          : klass->link_set_down (self, ifindex);
+	return _async_fallback_complete (self, success, up ? "set link up" : "set link down",
+	                                 callback, callback_data, cancellable);
+}
+
+/**
+ * nm_platform_link_set_up_async:
+ * @self: platform instance
+ * @ifindex: Interface index
+ * @callback: (allow-none): invoked with the result.
+ * @callback_data: user data for @callback.
+ * @cancellable: (allow-none): the cancellable.
+ *
+ * Like nm_platform_link_set_up(), but does not wait for the kernel's
+ * response. See nm_platform_object_add_async().
+ *
+ * Returns: the netlink sequence number of the request or 0.
+ */
+guint32
+nm_platform_link_set_up_async (NMPlatform *self,
+                               int ifindex,
+                               NMPlatformAsyncCallback callback,
+                               gpointer callback_data,
+                               GCancellable *cancellable)
+{
+	return _link_set_updown_async (self, ifindex, TRUE, callback, callback_data, cancellable);
+}
+
+/**
+ * nm_platform_link_set_down_async:
+ * @self: platform instance
+ * @ifindex: Interface index
+ * @callback: (allow-none): invoked with the result.
+ * @callback_data: user data for @callback.
+ * @cancellable: (allow-none): the cancellable.
+ *
+ * Like nm_platform_link_set_down(), but does not wait for the kernel's
+ * response. See nm_platform_object_add_async().
+ *
+ * Returns: the netlink sequence number of the request or 0.
+ */
+guint32
+nm_platform_link_set_down_async (NMPlatform *self,
+                                 int ifindex,
+                                 NMPlatformAsyncCallback callback,
+                                 gpointer callback_data,
+                                 GCancellable *cancellable)
+{
+	return _link_set_updown_async (self, ifindex, FALSE, callback, callback_data, cancellable);
+}
+
 /**
  * nm_platform_link_set_arp:
  * @self: platform instance
@@ -3536,6 +3769,8 @@ nm_platform_ethtool_get_link_settings (NMPlatform *self, int ifindex, gboolean *
 
 	g_return_val_if_fail (ifindex > 0, FALSE);
 
+	if (klass->ethtool_get_link_settings)
+		return klass->ethtool_get_link_settings (self, ifindex, out_autoneg, out_speed, out_duplex);
 	return nmp_utils_ethtool_get_link_settings (ifindex, out_autoneg, out_speed, out_duplex);
 }
 
@@ -3555,6 +3790,8 @@ nm_platform_ethtool_get_link_features (NMPlatform *self, int ifindex)
 
 	g_return_val_if_fail (ifindex > 0, NULL);
 
+	if (klass->ethtool_get_features)
+		return klass->ethtool_get_features (self, ifindex);
 	return nmp_utils_ethtool_get_features (ifindex);
 }
 
@@ -3569,6 +3806,8 @@ nm_platform_ethtool_set_features (NMPlatform *self,
 
 	g_return_val_if_fail (ifindex > 0, FALSE);
 
+	if (klass->ethtool_set_features)
+		return klass->ethtool_set_features (self, ifindex, features, requested, do_set);
 	return nmp_utils_ethtool_set_features (ifindex, features, requested, do_set);
 }
 
@@ -4429,6 +4668,286 @@ _err_inval_due_to_ipv6_tentative_pref_src (NMPlatform *self, const NMPObject *ob
 	return TRUE;
 }
 
+static void
+_route_ignore_fill (NMPlatformRouteIgnore *ri,
+                    const guint8 *protocols,
+                    guint n_protocols,
+                    const guint32 *tables,
+                    guint n_tables)
+{
+	guint i;
+
+	memset (ri->protocols, 0, sizeof (ri->protocols));
+	ri->n_protocols = 0;
+	for (i = 0; i < n_protocols; i++) {
+		if (NM_FLAGS_HAS (ri->protocols[protocols[i] / 32], 1u << (protocols[i] % 32)))
+			continue;
+		ri->protocols[protocols[i] / 32] |= (1u << (protocols[i] % 32));
+		ri->n_protocols++;
+	}
+
+	nm_clear_g_free (&ri->tables);
+	ri->n_tables = 0;
+	if (n_tables > 0) {
+		ri->tables = g_new (guint32, n_tables);
+		for (i = 0; i < n_tables; i++) {
+			guint j;
+
+			for (j = 0; j < ri->n_tables; j++) {
+				if (ri->tables[j] == tables[i])
+					break;
+			}
+			if (j == ri->n_tables)
+				ri->tables[ri->n_tables++] = tables[i];
+		}
+	}
+}
+
+static void
+_route_ignore_copy (NMPlatformRouteIgnore *dst,
+                    const NMPlatformRouteIgnore *src)
+{
+	memcpy (dst->protocols, src->protocols, sizeof (dst->protocols));
+	dst->n_protocols = src->n_protocols;
+	nm_clear_g_free (&dst->tables);
+	dst->tables = nm_memdup (src->tables, sizeof (guint32) * src->n_tables);
+	dst->n_tables = src->n_tables;
+}
+
+/* the policy is never modified once set. Every instance gets its own copy. */
+static const NMPlatformRouteIgnore *_route_ignore_default;
+
+/**
+ * nm_platform_route_ignore_set_default:
+ * @protocols: (allow-none): the rtm_protocol values to ignore.
+ * @n_protocols: the number of @protocols.
+ * @tables: (allow-none): the (uncoerced) kernel table ids to ignore.
+ * @n_tables: the number of @tables.
+ *
+ * Sets the route ignore policy that all #NMPlatform instances get when
+ * they are constructed, including the ones for other network namespaces.
+ * It doesn't affect existing instances, use nm_platform_route_ignore_set()
+ * for those.
+ */
+void
+nm_platform_route_ignore_set_default (const guint8 *protocols,
+                                      guint n_protocols,
+                                      const guint32 *tables,
+                                      guint n_tables)
+{
+	NMPlatformRouteIgnore *ri;
+
+	ri = g_new0 (NMPlatformRouteIgnore, 1);
+	_route_ignore_fill (ri,
+	                    protocols,
+	                    n_protocols,
+	                    tables,
+	                    n_tables);
+
+	if (_route_ignore_default) {
+		g_free (_route_ignore_default->tables);
+		g_free ((NMPlatformRouteIgnore *) _route_ignore_default);
+	}
+	_route_ignore_default = ri;
+}
+
+/**
+ * nm_platform_route_ignore_set:
+ * @self: the #NMPlatform instance.
+ * @protocols: (allow-none): the rtm_protocol values to ignore.
+ * @n_protocols: the number of @protocols.
+ * @tables: (allow-none): the (uncoerced) kernel table ids to ignore.
+ * @n_tables: the number of @tables.
+ *
+ * Routes with one of the given protocols or in one of the given tables
+ * are not tracked in the platform cache. This is useful when a routing
+ * daemon manages a large number of routes that NetworkManager doesn't
+ * care about. Since such routes are invisible, route sync neither adds
+ * routes to ignored tables nor prunes ignored routes.
+ */
+void
+nm_platform_route_ignore_set (NMPlatform *self,
+                              const guint8 *protocols,
+                              guint n_protocols,
+                              const guint32 *tables,
+                              guint n_tables)
+{
+	NMPlatformPrivate *priv;
+
+	_CHECK_SELF_VOID (self, klass);
+
+	priv = NM_PLATFORM_GET_PRIVATE (self);
+
+	_route_ignore_fill (&priv->route_ignore,
+	                    protocols,
+	                    n_protocols,
+	                    tables,
+	                    n_tables);
+
+	priv->route_ignore_generation++;
+
+	_LOGD ("route-ignore: ignore routes of %u protocols and %u tables",
+	       priv->route_ignore.n_protocols,
+	       priv->route_ignore.n_tables);
+
+	if (klass->route_ignore_changed)
+		klass->route_ignore_changed (self);
+}
+
+const NMPlatformRouteIgnore *
+nm_platform_route_ignore_get (NMPlatform *self)
+{
+	_CHECK_SELF (self, klass, NULL);
+
+	return &NM_PLATFORM_GET_PRIVATE (self)->route_ignore;
+}
+
+gboolean
+nm_platform_route_ignore_check (NMPlatform *self,
+                                guint8 rtm_protocol,
+                                guint32 table)
+{
+	const NMPlatformRouteIgnore *ri;
+	guint i;
+
+	_CHECK_SELF (self, klass, FALSE);
+
+	ri = &NM_PLATFORM_GET_PRIVATE (self)->route_ignore;
+
+	if (NM_FLAGS_HAS (ri->protocols[rtm_protocol / 32], 1u << (rtm_protocol % 32)))
+		return TRUE;
+	for (i = 0; i < ri->n_tables; i++) {
+		if (ri->tables[i] == table)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+gboolean
+nm_platform_route_ignore_check_route (NMPlatform *self,
+                                      const NMPlatformIPRoute *route)
+{
+	const NMPlatformRouteIgnore *ri;
+
+	_CHECK_SELF (self, klass, FALSE);
+
+	nm_assert (route);
+
+	ri = &NM_PLATFORM_GET_PRIVATE (self)->route_ignore;
+
+	if (   ri->n_protocols == 0
+	    && ri->n_tables == 0)
+		return FALSE;
+
+	return nm_platform_route_ignore_check (self,
+	                                       nmp_utils_ip_config_source_coerce_to_rtprot (route->rt_source),
+	                                       nm_platform_route_table_uncoerce (route->table_coerced, TRUE));
+}
+
+static void
+_ip_route_serial_bump (NMPlatform *self, int addr_family, int ifindex)
+{
+	NMPlatformPrivate *priv = NM_PLATFORM_GET_PRIVATE (self);
+	GHashTable **p_serials = &priv->ip_route_serials[addr_family == AF_INET];
+
+	if (ifindex <= 0)
+		return;
+
+	if (G_UNLIKELY (++priv->ip_route_serial_counter == 0))
+		priv->ip_route_serial_counter++;
+
+	if (!*p_serials)
+		*p_serials = g_hash_table_new (nm_direct_hash, NULL);
+	g_hash_table_insert (*p_serials,
+	                     GINT_TO_POINTER (ifindex),
+	                     GUINT_TO_POINTER (priv->ip_route_serial_counter));
+}
+
+static void
+_ip_route_serial_clear (NMPlatform *self, int ifindex)
+{
+	NMPlatformPrivate *priv = NM_PLATFORM_GET_PRIVATE (self);
+
+	if (priv->ip_route_serials[0])
+		g_hash_table_remove (priv->ip_route_serials[0], GINT_TO_POINTER (ifindex));
+	if (priv->ip_route_serials[1])
+		g_hash_table_remove (priv->ip_route_serials[1], GINT_TO_POINTER (ifindex));
+}
+
+static guint
+_ip_route_serial_get (NMPlatform *self, int addr_family, int ifindex)
+{
+	GHashTable *serials = NM_PLATFORM_GET_PRIVATE (self)->ip_route_serials[addr_family == AF_INET];
+
+	if (!serials)
+		return 0;
+	return GPOINTER_TO_UINT (g_hash_table_lookup (serials, GINT_TO_POINTER (ifindex)));
+}
+
+static gboolean
+_ip_route_is_prune_candidate (NMPlatform *self,
+                              const NMPObject *obj,
+                              NMIPRouteTableSyncMode route_table_sync)
+{
+	if (route_table_sync == NM_IP_ROUTE_TABLE_SYNC_MODE_FULL) {
+		if (nm_platform_route_table_uncoerce (NMP_OBJECT_CAST_IP_ROUTE (obj)->table_coerced, TRUE) == RT_TABLE_LOCAL)
+			return FALSE;
+	} else if (route_table_sync == NM_IP_ROUTE_TABLE_SYNC_MODE_MAIN) {
+		if (!nm_platform_route_table_is_main (NMP_OBJECT_CAST_IP_ROUTE (obj)->table_coerced))
+			return FALSE;
+	} else
+		nm_assert (route_table_sync == NM_IP_ROUTE_TABLE_SYNC_MODE_ALL);
+
+	if (nm_platform_route_ignore_check_route (self, NMP_OBJECT_CAST_IP_ROUTE (obj)))
+		return FALSE;
+
+	return TRUE;
+}
+
+/* nm_platform_ip_route_sync() adds a direct route to the gateway of a route
+ * that cannot be added otherwise. Don't prune that direct route, as long as a
+ * route via the gateway is still configured. */
+static gboolean
+_ip_route_is_gateway_route_in_use (NMPlatform *self,
+                                   const NMPObject *obj,
+                                   GHashTable *routes_idx)
+{
+	const NMDedupMultiHeadEntry *head_entry;
+	NMDedupMultiIter iter;
+	const NMPObject *o;
+	int ifindex;
+
+	if (!routes_idx)
+		return FALSE;
+
+	if (NMP_OBJECT_GET_TYPE (obj) == NMP_OBJECT_TYPE_IP4_ROUTE) {
+		const NMPlatformIP4Route *r = NMP_OBJECT_CAST_IP4_ROUTE (obj);
+
+		if (   r->plen != 32
+		    || r->gateway
+		    || !r->network)
+			return FALSE;
+		ifindex = r->ifindex;
+		head_entry = nm_platform_lookup_ip4_route_by_gateway (self, r->network);
+	} else {
+		const NMPlatformIP6Route *r = NMP_OBJECT_CAST_IP6_ROUTE (obj);
+
+		if (   r->plen != 128
+		    || !IN6_IS_ADDR_UNSPECIFIED (&r->gateway)
+		    || IN6_IS_ADDR_UNSPECIFIED (&r->network))
+			return FALSE;
+		ifindex = r->ifindex;
+		head_entry = nm_platform_lookup_ip6_route_by_gateway (self, &r->network);
+	}
+
+	nmp_cache_iter_for_each (&iter, head_entry, &o) {
+		if (   NMP_OBJECT_CAST_IP_ROUTE (o)->ifindex == ifindex
+		    && g_hash_table_contains (routes_idx, o))
+			return TRUE;
+	}
+	return FALSE;
+}
+
 GPtrArray *
 nm_platform_ip_route_get_prune_list (NMPlatform *self,
                                      int addr_family,
@@ -4438,6 +4957,7 @@ nm_platform_ip_route_get_prune_list (NMPlatform *self,
 	NMPLookup lookup;
 	GPtrArray *routes_prune;
 	const NMDedupMultiHeadEntry *head_entry;
+	NMPObjectType obj_type;
 	CList *iter;
 
 	nm_assert (NM_IS_PLATFORM (self));
@@ -4446,29 +4966,40 @@ nm_platform_ip_route_get_prune_list (NMPlatform *self,
 	                                        NM_IP_ROUTE_TABLE_SYNC_MODE_FULL,
 	                                        NM_IP_ROUTE_TABLE_SYNC_MODE_ALL));
 
-	nmp_lookup_init_object (&lookup,
-	                        addr_family == AF_INET
-	                          ? NMP_OBJECT_TYPE_IP4_ROUTE
-	                          : NMP_OBJECT_TYPE_IP6_ROUTE,
-	                        ifindex);
-	head_entry = nm_platform_lookup (self, &lookup);
+	obj_type = addr_family == AF_INET
+	           ? NMP_OBJECT_TYPE_IP4_ROUTE
+	           : NMP_OBJECT_TYPE_IP6_ROUTE;
+
+	head_entry = nm_platform_lookup (self,
+	                                 nmp_lookup_init_object (&lookup, obj_type, ifindex));
 	if (!head_entry)
 		return NULL;
 
+	if (route_table_sync == NM_IP_ROUTE_TABLE_SYNC_MODE_MAIN) {
+		const NMDedupMultiHeadEntry *head_entry_main;
+
+		/* we only care about the main table. Walk whichever is shorter: the
+		 * routes of the device, or the routes of the main table. */
+		head_entry_main = nm_platform_lookup (self,
+		                                      nmp_lookup_init_route_by_table (&lookup, obj_type, RT_TABLE_MAIN));
+		if (!head_entry_main)
+			return NULL;
+		if (head_entry_main->len < head_entry->len)
+			head_entry = head_entry_main;
+	}
+
 	routes_prune = g_ptr_array_new_full (head_entry->len,
 	                                     (GDestroyNotify) nm_dedup_multi_obj_unref);
 
 	c_list_for_each (iter, &head_entry->lst_entries_head) {
 		const NMPObject *obj = c_list_entry (iter, NMDedupMultiEntry, lst_entries)->obj;
 
-		if (route_table_sync == NM_IP_ROUTE_TABLE_SYNC_MODE_FULL) {
-			if (nm_platform_route_table_uncoerce (NMP_OBJECT_CAST_IP_ROUTE (obj)->table_coerced, TRUE) == RT_TABLE_LOCAL)
-				continue;
-		} else if (route_table_sync == NM_IP_ROUTE_TABLE_SYNC_MODE_MAIN) {
-			if (!nm_platform_route_table_is_main (NMP_OBJECT_CAST_IP_ROUTE (obj)->table_coerced))
-				continue;
-		} else
-			nm_assert (route_table_sync == NM_IP_ROUTE_TABLE_SYNC_MODE_ALL);
+		if (   ifindex > 0
+		    && NMP_OBJECT_CAST_IP_ROUTE (obj)->ifindex != ifindex)
+			continue;
+
+		if (!_ip_route_is_prune_candidate (self, obj, route_table_sync))
+			continue;
 
 		g_ptr_array_add (routes_prune, (gpointer) nmp_object_ref (obj));
 	}
@@ -4480,53 +5011,186 @@ nm_platform_ip_route_get_prune_list (NMPlatform *self,
 	return routes_prune;
 }
 
-/**
- * nm_platform_ip_route_sync:
- * @self: the #NMPlatform instance.
- * @addr_family: AF_INET or AF_INET6.
- * @ifindex: the @ifindex for which the routes are to be added.
- * @routes: (allow-none): a list of routes to configure. Must contain
- *   NMPObject instances of routes, according to @addr_family.
- * @routes_prune: (allow-none): the list of routes to delete.
- *   If platform has such a route configured, it will be deleted
- *   at the end of the operation. Note that if @routes contains
- *   the same route, then it will not be deleted. @routes overrules
- *   @routes_prune list.
- * @out_temporary_not_available: (allow-none) (out): routes that could
- *   currently not be synced. The caller shall keep them and try later again.
- *
- * Returns: %TRUE on success.
- */
-gboolean
-nm_platform_ip_route_sync (NMPlatform *self,
-                           int addr_family,
-                           int ifindex,
-                           GPtrArray *routes,
-                           GPtrArray *routes_prune,
-                           GPtrArray **out_temporary_not_available)
+static NMPObject *
+_ip_route_ecmp_new (const NMPObject *const*hops, guint n_hops)
 {
-	const NMPlatformVTableRoute *vt;
-	gs_unref_hashtable GHashTable *routes_idx = NULL;
-	const NMPObject *conf_o;
-	const NMDedupMultiEntry *plat_entry;
+	NMPObject *obj;
 	guint i;
-	int i_type;
-	gboolean success = TRUE;
-	char sbuf1[sizeof (_nm_utils_to_string_buffer)];
-	char sbuf2[sizeof (_nm_utils_to_string_buffer)];
-	const gboolean IS_IPv4 = (addr_family == AF_INET);
 
-	nm_assert (NM_IS_PLATFORM (self));
-	nm_assert (NM_IN_SET (addr_family, AF_INET, AF_INET6));
-	nm_assert (ifindex > 0);
+	nm_assert (n_hops > 1 && n_hops <= G_MAXUINT16);
 
-	vt = &nm_platform_vtable_route.vx[IS_IPv4];
+	obj = nmp_object_clone (hops[0], FALSE);
+	obj->ip_route.n_nexthops = n_hops;
+
+	if (NMP_OBJECT_GET_TYPE (obj) == NMP_OBJECT_TYPE_IP4_ROUTE) {
+		NMPlatformIP4RtNextHop *extra;
+
+		extra = g_new (NMPlatformIP4RtNextHop, n_hops - 1);
+		for (i = 1; i < n_hops; i++) {
+			const NMPlatformIP4Route *r = NMP_OBJECT_CAST_IP4_ROUTE (hops[i]);
+
+			extra[i - 1] = (NMPlatformIP4RtNextHop) {
+				.ifindex = r->ifindex,
+				.gateway = r->gateway,
+				.weight  = r->weight,
+			};
+		}
+		obj->_ip4_route.extra_nexthops = extra;
+	} else {
+		NMPlatformIP6RtNextHop *extra;
+
+		extra = g_new (NMPlatformIP6RtNextHop, n_hops - 1);
+		for (i = 1; i < n_hops; i++) {
+			const NMPlatformIP6Route *r = NMP_OBJECT_CAST_IP6_ROUTE (hops[i]);
+
+			extra[i - 1] = (NMPlatformIP6RtNextHop) {
+				.ifindex = r->ifindex,
+				.gateway = r->gateway,
+				.weight  = r->weight,
+			};
+		}
+		obj->_ip6_route.extra_nexthops = extra;
+	}
+
+	return obj;
+}
+
+static gboolean
+_ip_route_is_ecmp_candidate (const NMPObject *obj)
+{
+	const NMPlatformIPRoute *r = NMP_OBJECT_CAST_IP_ROUTE (obj);
+
+	return    r->weight > 0
+	       && r->n_nexthops <= 1
+	       && r->nhid == 0;
+}
+
+/* Routes to be configured that have a weight and share the same destination
+ * (that is, they are equal according to NM_PLATFORM_IP_ROUTE_CMP_TYPE_WEAK_ID)
+ * get merged into one ECMP route, like kernel would report them.
+ *
+ * Returns: %NULL if there is nothing to merge, or a new list of routes. */
+static GPtrArray *
+_ip_route_sync_merge_ecmp (GPtrArray *routes)
+{
+	gs_free const NMPObject **hops = NULL;
+	gs_free gboolean *merged = NULL;
+	GPtrArray *result;
+	guint n_candidates = 0;
+	guint i, j;
+
+	for (i = 0; i < routes->len; i++) {
+		if (_ip_route_is_ecmp_candidate (routes->pdata[i]))
+			n_candidates++;
+	}
+	if (n_candidates < 2)
+		return NULL;
+
+	hops = g_new (const NMPObject *, n_candidates);
+	merged = g_new0 (gboolean, routes->len);
+	result = g_ptr_array_new_full (routes->len, (GDestroyNotify) nmp_object_unref);
+
+	for (i = 0; i < routes->len; i++) {
+		const NMPObject *o = routes->pdata[i];
+		guint n_hops = 0;
+
+		if (merged[i])
+			continue;
+
+		if (_ip_route_is_ecmp_candidate (o)) {
+			hops[n_hops++] = o;
+			for (j = i + 1; j < routes->len && n_hops < G_MAXUINT16; j++) {
+				const NMPObject *o2 = routes->pdata[j];
+
+				if (   merged[j]
+				    || !_ip_route_is_ecmp_candidate (o2))
+					continue;
+				if (  NMP_OBJECT_GET_TYPE (o) == NMP_OBJECT_TYPE_IP4_ROUTE
+				    ? nm_platform_ip4_route_cmp (NMP_OBJECT_CAST_IP4_ROUTE (o), NMP_OBJECT_CAST_IP4_ROUTE (o2), NM_PLATFORM_IP_ROUTE_CMP_TYPE_WEAK_ID) != 0
+				    : nm_platform_ip6_route_cmp (NMP_OBJECT_CAST_IP6_ROUTE (o), NMP_OBJECT_CAST_IP6_ROUTE (o2), NM_PLATFORM_IP_ROUTE_CMP_TYPE_WEAK_ID) != 0)
+					continue;
+				merged[j] = TRUE;
+				hops[n_hops++] = o2;
+			}
+		}
+
+		if (n_hops > 1)
+			g_ptr_array_add (result, _ip_route_ecmp_new (hops, n_hops));
+		else
+			g_ptr_array_add (result, (gpointer) nmp_object_ref (o));
+	}
+
+	return result;
+}
+
+/**
+ * nm_platform_ip_route_sync:
+ * @self: the #NMPlatform instance.
+ * @addr_family: AF_INET or AF_INET6.
+ * @ifindex: the @ifindex for which the routes are to be added.
+ * @routes: (allow-none): a list of routes to configure. Must contain
+ *   NMPObject instances of routes, according to @addr_family. Routes
+ *   with a weight and the same destination, table and metric are
+ *   configured as one ECMP route.
+ * @routes_prune: (allow-none): the list of routes to delete.
+ *   If platform has such a route configured, it will be deleted
+ *   at the end of the operation. Note that if @routes contains
+ *   the same route, then it will not be deleted. @routes overrules
+ *   @routes_prune list.
+ * @out_temporary_not_available: (allow-none) (out): routes that could
+ *   currently not be synced. The caller shall keep them and try later again.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean
+nm_platform_ip_route_sync (NMPlatform *self,
+                           int addr_family,
+                           int ifindex,
+                           GPtrArray *routes,
+                           GPtrArray *routes_prune,
+                           GPtrArray **out_temporary_not_available)
+{
+	const NMPlatformVTableRoute *vt;
+	gs_unref_hashtable GHashTable *routes_idx = NULL;
+	gs_unref_ptrarray GPtrArray *routes_ecmp = NULL;
+	gs_unref_ptrarray GPtrArray *routes_add = NULL;
+	gs_unref_ptrarray GPtrArray *routes_del = NULL;
+	gs_free int *results = NULL;
+	const NMPObject *conf_o;
+	const NMDedupMultiEntry *plat_entry;
+	guint i;
+	int i_type;
+	gboolean success = TRUE;
+	char sbuf1[sizeof (_nm_utils_to_string_buffer)];
+	char sbuf2[sizeof (_nm_utils_to_string_buffer)];
+	const gboolean IS_IPv4 = (addr_family == AF_INET);
+
+	nm_assert (NM_IS_PLATFORM (self));
+	nm_assert (NM_IN_SET (addr_family, AF_INET, AF_INET6));
+	nm_assert (ifindex > 0);
+
+	vt = &nm_platform_vtable_route.vx[IS_IPv4];
+
+	if (routes) {
+		routes_ecmp = _ip_route_sync_merge_ecmp (routes);
+		if (routes_ecmp)
+			routes = routes_ecmp;
+	}
 
 	for (i_type = 0; routes && i_type < 2; i_type++) {
-		for (i = 0; i < routes->len; i++) {
-			int r, r2;
-			gboolean gateway_route_added = FALSE;
 
+		/* we add routes in two runs over @i_type. First device routes, then gateway routes.
+		 *
+		 * Each run first collects the routes that need to be (re-)added, and passes
+		 * them together to nm_platform_ip_route_add_many(). That way, the platform
+		 * implementation can send the requests in batches and only needs to wait
+		 * for the responses once per batch instead of once per route. */
+		if (routes_add)
+			g_ptr_array_set_size (routes_add, 0);
+		if (routes_del)
+			g_ptr_array_set_size (routes_del, 0);
+
+		for (i = 0; i < routes->len; i++) {
 			conf_o = routes->pdata[i];
 
 #define VTABLE_IS_DEVICE_ROUTE(vt, o) (vt->is_ip4 \
@@ -4534,12 +5198,8 @@ nm_platform_ip_route_sync (NMPlatform *self,
                                          : IN6_IS_ADDR_UNSPECIFIED (&NMP_OBJECT_CAST_IP6_ROUTE (o)->gateway) )
 
 			if (   (i_type == 0 && !VTABLE_IS_DEVICE_ROUTE (vt, conf_o))
-			    || (i_type == 1 &&  VTABLE_IS_DEVICE_ROUTE (vt, conf_o))) {
-				/* we add routes in two runs over @i_type.
-				 *
-				 * First device routes, then gateway routes. */
+			    || (i_type == 1 &&  VTABLE_IS_DEVICE_ROUTE (vt, conf_o)))
 				continue;
-			}
 
 			if (!routes_idx) {
 				routes_idx = g_hash_table_new ((GHashFunc) nmp_object_id_hash,
@@ -4551,6 +5211,13 @@ nm_platform_ip_route_sync (NMPlatform *self,
 				continue;
 			}
 
+			if (nm_platform_route_ignore_check_route (self, NMP_OBJECT_CAST_IP_ROUTE (conf_o))) {
+				/* we would not see the route in the cache, so we could never remove it again. */
+				_LOG3W ("route-sync: skip adding route %s to an ignored routing table",
+				        nmp_object_to_string (conf_o, NMP_OBJECT_TO_STRING_PUBLIC, sbuf1, sizeof (sbuf1)));
+				continue;
+			}
+
 			plat_entry = nm_platform_lookup_entry (self,
 			                                       NMP_CACHE_ID_TYPE_OBJECT_TYPE,
 			                                       conf_o);
@@ -4559,126 +5226,163 @@ nm_platform_ip_route_sync (NMPlatform *self,
 
 				plat_o = plat_entry->obj;
 
-				if (vt->route_cmp (NMP_OBJECT_CAST_IPX_ROUTE (conf_o),
-				                   NMP_OBJECT_CAST_IPX_ROUTE (plat_o),
-				                   NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY) == 0)
+				if (   vt->route_cmp (NMP_OBJECT_CAST_IPX_ROUTE (conf_o),
+				                      NMP_OBJECT_CAST_IPX_ROUTE (plat_o),
+				                      NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY) == 0
+				    && nmp_object_ip_route_cmp_extra_nexthops (conf_o, plat_o) == 0)
 					continue;
 
 				/* we need to replace the existing route with a (slightly) different
 				 * one. Delete it first. */
-				if (!nm_platform_object_delete (self, plat_o)) {
-					/* ignore error. */
-				}
+				if (!routes_del)
+					routes_del = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
+				g_ptr_array_add (routes_del, (gpointer) nmp_object_ref (plat_o));
 			}
 
-sync_route_add:
-			r = nm_platform_ip_route_add (self,
-			                                NMP_NLM_FLAG_APPEND
-			                              | NMP_NLM_FLAG_SUPPRESS_NETLINK_FAILURE,
-			                              conf_o);
-			if (r < 0) {
-				if (r == -EEXIST) {
-					/* Don't fail for EEXIST. It's not clear that the existing route
-					 * is identical to the one that we were about to add. However,
-					 * above we should have deleted conflicting (non-identical) routes. */
-					if (_LOGD_ENABLED ()) {
-						plat_entry = nm_platform_lookup_entry (self,
-						                                       NMP_CACHE_ID_TYPE_OBJECT_TYPE,
-						                                       conf_o);
-						if (!plat_entry) {
-							_LOG3D ("route-sync: adding route %s failed with EEXIST, however we cannot find such a route",
-							        nmp_object_to_string (conf_o, NMP_OBJECT_TO_STRING_PUBLIC, sbuf1, sizeof (sbuf1)));
-						} else if (vt->route_cmp (NMP_OBJECT_CAST_IPX_ROUTE (conf_o),
-						                          NMP_OBJECT_CAST_IPX_ROUTE (plat_entry->obj),
-						                          NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY) != 0) {
-							_LOG3D ("route-sync: adding route %s failed due to existing (different!) route %s",
-							        nmp_object_to_string (conf_o, NMP_OBJECT_TO_STRING_PUBLIC, sbuf1, sizeof (sbuf1)),
-							        nmp_object_to_string (plat_entry->obj, NMP_OBJECT_TO_STRING_PUBLIC, sbuf2, sizeof (sbuf2)));
-						}
-					}
-				} else if (NMP_OBJECT_CAST_IP_ROUTE (conf_o)->rt_source < NM_IP_CONFIG_SOURCE_USER) {
-					_LOG3D ("route-sync: ignore failure to add IPv%c route: %s: %s",
-					       vt->is_ip4 ? '4' : '6',
-					       nmp_object_to_string (conf_o, NMP_OBJECT_TO_STRING_PUBLIC, sbuf1, sizeof (sbuf1)),
-					       nm_strerror (r));
-				} else if (   r == -EINVAL
-				           && out_temporary_not_available
-				           && _err_inval_due_to_ipv6_tentative_pref_src (self, conf_o)) {
-					_LOG3D ("route-sync: ignore failure to add IPv6 route with tentative IPv6 pref-src: %s: %s",
-					        nmp_object_to_string (conf_o, NMP_OBJECT_TO_STRING_PUBLIC, sbuf1, sizeof (sbuf1)),
-					        nm_strerror (r));
-					if (!*out_temporary_not_available)
-						*out_temporary_not_available = g_ptr_array_new_full (0, (GDestroyNotify) nmp_object_unref);
-					g_ptr_array_add (*out_temporary_not_available, (gpointer) nmp_object_ref (conf_o));
-				} else if (   !gateway_route_added
-				           && (   (   r == -ENETUNREACH
-				                   && vt->is_ip4
-				                   && !!NMP_OBJECT_CAST_IP4_ROUTE (conf_o)->gateway)
-				               || (   r == -EHOSTUNREACH
-				                   && !vt->is_ip4
-				                   && !IN6_IS_ADDR_UNSPECIFIED (&NMP_OBJECT_CAST_IP6_ROUTE (conf_o)->gateway)))) {
-					NMPObject oo;
-
-					if (vt->is_ip4) {
-						const NMPlatformIP4Route *rt = NMP_OBJECT_CAST_IP4_ROUTE (conf_o);
-
-						nmp_object_stackinit (&oo,
-						                      NMP_OBJECT_TYPE_IP4_ROUTE,
-						                      &((NMPlatformIP4Route) {
-						                          .ifindex = rt->ifindex,
-						                          .network = rt->gateway,
-						                          .plen = 32,
-						                          .metric = rt->metric,
-						                          .rt_source = rt->rt_source,
-						                          .table_coerced = rt->table_coerced,
-						                      }));
-					} else {
-						const NMPlatformIP6Route *rt = NMP_OBJECT_CAST_IP6_ROUTE (conf_o);
-
-						nmp_object_stackinit (&oo,
-						                      NMP_OBJECT_TYPE_IP6_ROUTE,
-						                      &((NMPlatformIP6Route) {
-						                          .ifindex = rt->ifindex,
-						                          .network = rt->gateway,
-						                          .plen = 128,
-						                          .metric = rt->metric,
-						                          .rt_source = rt->rt_source,
-						                          .table_coerced = rt->table_coerced,
-						                      }));
-					}
+			if (!routes_add)
+				routes_add = g_ptr_array_new ();
+			g_ptr_array_add (routes_add, (gpointer) conf_o);
+		}
 
-					_LOG3D ("route-sync: failure to add IPv%c route: %s: %s; try adding direct route to gateway %s",
-					        vt->is_ip4 ? '4' : '6',
-					        nmp_object_to_string (conf_o, NMP_OBJECT_TO_STRING_PUBLIC, sbuf1, sizeof (sbuf1)),
-					        nm_strerror (r),
-					        nmp_object_to_string (&oo, NMP_OBJECT_TO_STRING_PUBLIC, sbuf2, sizeof (sbuf2)));
+		if (routes_del && routes_del->len > 0) {
+			/* ignore errors. */
+			nm_platform_ip_route_delete_many (self,
+			                                  (const NMPObject *const*) routes_del->pdata,
+			                                  routes_del->len);
+		}
+
+		if (!routes_add || routes_add->len == 0)
+			continue;
 
-					r2 = nm_platform_ip_route_add (self,
-					                                 NMP_NLM_FLAG_APPEND
-					                               | NMP_NLM_FLAG_SUPPRESS_NETLINK_FAILURE,
-					                               &oo);
+		results = g_renew (int, results, routes_add->len);
+		nm_platform_ip_route_add_many (self,
+		                                 NMP_NLM_FLAG_APPEND
+		                               | NMP_NLM_FLAG_SUPPRESS_NETLINK_FAILURE,
+		                               (const NMPObject *const*) routes_add->pdata,
+		                               routes_add->len,
+		                               results);
 
-					if (r2 < 0) {
-						_LOG3D ("route-sync: failure to add gateway IPv%c route: %s: %s",
-						        vt->is_ip4 ? '4' : '6',
+		for (i = 0; i < routes_add->len; i++) {
+			gboolean gateway_route_added = FALSE;
+			int r, r2;
+
+			conf_o = routes_add->pdata[i];
+			r = results[i];
+
+sync_route_check:
+			if (r >= 0)
+				continue;
+
+			if (r == -EEXIST) {
+				/* Don't fail for EEXIST. It's not clear that the existing route
+				 * is identical to the one that we were about to add. However,
+				 * above we should have deleted conflicting (non-identical) routes. */
+				if (_LOGD_ENABLED ()) {
+					plat_entry = nm_platform_lookup_entry (self,
+					                                       NMP_CACHE_ID_TYPE_OBJECT_TYPE,
+					                                       conf_o);
+					if (!plat_entry) {
+						_LOG3D ("route-sync: adding route %s failed with EEXIST, however we cannot find such a route",
+						        nmp_object_to_string (conf_o, NMP_OBJECT_TO_STRING_PUBLIC, sbuf1, sizeof (sbuf1)));
+					} else if (vt->route_cmp (NMP_OBJECT_CAST_IPX_ROUTE (conf_o),
+					                          NMP_OBJECT_CAST_IPX_ROUTE (plat_entry->obj),
+					                          NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY) != 0) {
+						_LOG3D ("route-sync: adding route %s failed due to existing (different!) route %s",
 						        nmp_object_to_string (conf_o, NMP_OBJECT_TO_STRING_PUBLIC, sbuf1, sizeof (sbuf1)),
-						        nm_strerror (r2));
+						        nmp_object_to_string (plat_entry->obj, NMP_OBJECT_TO_STRING_PUBLIC, sbuf2, sizeof (sbuf2)));
 					}
-
-					gateway_route_added = TRUE;
-					goto sync_route_add;
+				}
+			} else if (NMP_OBJECT_CAST_IP_ROUTE (conf_o)->rt_source < NM_IP_CONFIG_SOURCE_USER) {
+				_LOG3D ("route-sync: ignore failure to add IPv%c route: %s: %s",
+				       vt->is_ip4 ? '4' : '6',
+				       nmp_object_to_string (conf_o, NMP_OBJECT_TO_STRING_PUBLIC, sbuf1, sizeof (sbuf1)),
+				       nm_strerror (r));
+			} else if (   r == -EINVAL
+			           && out_temporary_not_available
+			           && _err_inval_due_to_ipv6_tentative_pref_src (self, conf_o)) {
+				_LOG3D ("route-sync: ignore failure to add IPv6 route with tentative IPv6 pref-src: %s: %s",
+				        nmp_object_to_string (conf_o, NMP_OBJECT_TO_STRING_PUBLIC, sbuf1, sizeof (sbuf1)),
+				        nm_strerror (r));
+				if (!*out_temporary_not_available)
+					*out_temporary_not_available = g_ptr_array_new_full (0, (GDestroyNotify) nmp_object_unref);
+				g_ptr_array_add (*out_temporary_not_available, (gpointer) nmp_object_ref (conf_o));
+			} else if (   !gateway_route_added
+			           && (   (   r == -ENETUNREACH
+			                   && vt->is_ip4
+			                   && !!NMP_OBJECT_CAST_IP4_ROUTE (conf_o)->gateway)
+			               || (   r == -EHOSTUNREACH
+			                   && !vt->is_ip4
+			                   && !IN6_IS_ADDR_UNSPECIFIED (&NMP_OBJECT_CAST_IP6_ROUTE (conf_o)->gateway)))) {
+				NMPObject oo;
+
+				if (vt->is_ip4) {
+					const NMPlatformIP4Route *rt = NMP_OBJECT_CAST_IP4_ROUTE (conf_o);
+
+					nmp_object_stackinit (&oo,
+					                      NMP_OBJECT_TYPE_IP4_ROUTE,
+					                      &((NMPlatformIP4Route) {
+					                          .ifindex = rt->ifindex,
+					                          .network = rt->gateway,
+					                          .plen = 32,
+					                          .metric = rt->metric,
+					                          .rt_source = rt->rt_source,
+					                          .table_coerced = rt->table_coerced,
+					                      }));
 				} else {
-					_LOG3W ("route-sync: failure to add IPv%c route: %s: %s",
-					       vt->is_ip4 ? '4' : '6',
-					       nmp_object_to_string (conf_o, NMP_OBJECT_TO_STRING_PUBLIC, sbuf1, sizeof (sbuf1)),
-					       nm_strerror (r));
-					success = FALSE;
+					const NMPlatformIP6Route *rt = NMP_OBJECT_CAST_IP6_ROUTE (conf_o);
+
+					nmp_object_stackinit (&oo,
+					                      NMP_OBJECT_TYPE_IP6_ROUTE,
+					                      &((NMPlatformIP6Route) {
+					                          .ifindex = rt->ifindex,
+					                          .network = rt->gateway,
+					                          .plen = 128,
+					                          .metric = rt->metric,
+					                          .rt_source = rt->rt_source,
+					                          .table_coerced = rt->table_coerced,
+					                      }));
+				}
+
+				_LOG3D ("route-sync: failure to add IPv%c route: %s: %s; try adding direct route to gateway %s",
+				        vt->is_ip4 ? '4' : '6',
+				        nmp_object_to_string (conf_o, NMP_OBJECT_TO_STRING_PUBLIC, sbuf1, sizeof (sbuf1)),
+				        nm_strerror (r),
+				        nmp_object_to_string (&oo, NMP_OBJECT_TO_STRING_PUBLIC, sbuf2, sizeof (sbuf2)));
+
+				r2 = nm_platform_ip_route_add (self,
+				                                 NMP_NLM_FLAG_APPEND
+				                               | NMP_NLM_FLAG_SUPPRESS_NETLINK_FAILURE,
+				                               &oo);
+
+				if (r2 < 0) {
+					_LOG3D ("route-sync: failure to add gateway IPv%c route: %s: %s",
+					        vt->is_ip4 ? '4' : '6',
+					        nmp_object_to_string (conf_o, NMP_OBJECT_TO_STRING_PUBLIC, sbuf1, sizeof (sbuf1)),
+					        nm_strerror (r2));
 				}
+
+				gateway_route_added = TRUE;
+
+				/* the retry is rare, no need to batch it. */
+				r = nm_platform_ip_route_add (self,
+				                                NMP_NLM_FLAG_APPEND
+				                              | NMP_NLM_FLAG_SUPPRESS_NETLINK_FAILURE,
+				                              conf_o);
+				goto sync_route_check;
+			} else {
+				_LOG3W ("route-sync: failure to add IPv%c route: %s: %s",
+				       vt->is_ip4 ? '4' : '6',
+				       nmp_object_to_string (conf_o, NMP_OBJECT_TO_STRING_PUBLIC, sbuf1, sizeof (sbuf1)),
+				       nm_strerror (r));
+				success = FALSE;
 			}
 		}
 	}
 
 	if (routes_prune) {
+		if (routes_del)
+			g_ptr_array_set_size (routes_del, 0);
+
 		for (i = 0; i < routes_prune->len; i++) {
 			const NMPObject *prune_o;
 
@@ -4691,20 +5395,415 @@ sync_route_add:
 			    && g_hash_table_lookup (routes_idx, prune_o))
 				continue;
 
+			/* never prune what we cannot see. */
+			if (nm_platform_route_ignore_check_route (self, NMP_OBJECT_CAST_IP_ROUTE (prune_o)))
+				continue;
+
 			if (!nm_platform_lookup_entry (self,
 			                               NMP_CACHE_ID_TYPE_OBJECT_TYPE,
 			                               prune_o))
 				continue;
 
-			if (!nm_platform_object_delete (self, prune_o)) {
-				/* ignore error... */
+			if (_ip_route_is_gateway_route_in_use (self, prune_o, routes_idx)) {
+				_LOG3D ("route-sync: keep direct route to gateway %s",
+				        nmp_object_to_string (prune_o, NMP_OBJECT_TO_STRING_PUBLIC, sbuf1, sizeof (sbuf1)));
+				continue;
 			}
+
+			if (!routes_del)
+				routes_del = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
+			g_ptr_array_add (routes_del, (gpointer) nmp_object_ref (prune_o));
+		}
+
+		if (routes_del && routes_del->len > 0) {
+			/* ignore errors... */
+			nm_platform_ip_route_delete_many (self,
+			                                  (const NMPObject *const*) routes_del->pdata,
+			                                  routes_del->len);
 		}
 	}
 
 	return success;
 }
 
+struct _NMPlatformIPRouteSyncState {
+	/* the routes configured by the last sync, by route ID. Keys are
+	 * references to the NMPObject instances. */
+	GHashTable *routes;
+	/* the @routes argument of the last sync, with references. The next
+	 * sync only looks closer at the positions where the objects differ. */
+	GPtrArray *routes_lst;
+	int addr_family;
+	int ifindex;
+	guint route_serial;
+	guint route_ignore_generation;
+	guint n_ecmp;
+	/* how many positions of @routes_lst the last sync had to diff. */
+	guint n_diffed;
+	NMIPRouteTableSyncMode route_table_sync;
+	bool valid:1;
+	bool has_duplicates:1;
+
+	/* set by nm_platform_ip_route_sync_state_get_prune_list(), if the
+	 * following sync can diff against @routes. */
+	bool usable:1;
+};
+
+/**
+ * nm_platform_ip_route_sync_state_new:
+ *
+ * Returns: (transfer full): a new, empty #NMPlatformIPRouteSyncState
+ *   for nm_platform_ip_route_sync_with_state(). Free it with
+ *   nm_platform_ip_route_sync_state_free().
+ */
+NMPlatformIPRouteSyncState *
+nm_platform_ip_route_sync_state_new (void)
+{
+	return g_slice_new0 (NMPlatformIPRouteSyncState);
+}
+
+void
+nm_platform_ip_route_sync_state_free (NMPlatformIPRouteSyncState *state)
+{
+	if (!state)
+		return;
+	nm_clear_pointer (&state->routes, g_hash_table_unref);
+	nm_clear_pointer (&state->routes_lst, g_ptr_array_unref);
+	g_slice_free (NMPlatformIPRouteSyncState, state);
+}
+
+guint
+_nmtst_platform_ip_route_sync_state_get_n_diffed (const NMPlatformIPRouteSyncState *state)
+{
+	return state->n_diffed;
+}
+
+static void
+_ip_route_sync_state_reset (NMPlatformIPRouteSyncState *state,
+                            GPtrArray *routes)
+{
+	const NMPObject *o;
+	guint i;
+
+	nm_clear_pointer (&state->routes, g_hash_table_unref);
+	nm_clear_pointer (&state->routes_lst, g_ptr_array_unref);
+
+	state->routes = g_hash_table_new_full ((GHashFunc) nmp_object_id_hash,
+	                                       (GEqualFunc) nmp_object_id_equal,
+	                                       (GDestroyNotify) nmp_object_unref,
+	                                       NULL);
+	state->routes_lst = g_ptr_array_new_full (routes ? routes->len : 0u,
+	                                          (GDestroyNotify) nmp_object_unref);
+	state->n_ecmp = 0;
+	state->n_diffed = routes ? routes->len : 0u;
+	state->has_duplicates = FALSE;
+
+	for (i = 0; routes && i < routes->len; i++) {
+		o = routes->pdata[i];
+		g_ptr_array_add (state->routes_lst, (gpointer) nmp_object_ref (o));
+		/* like nm_platform_ip_route_sync(), the first of duplicate routes wins. */
+		if (g_hash_table_contains (state->routes, o)) {
+			state->has_duplicates = TRUE;
+			continue;
+		}
+		g_hash_table_add (state->routes, (gpointer) nmp_object_ref (o));
+		if (_ip_route_is_ecmp_candidate (o))
+			state->n_ecmp++;
+	}
+}
+
+/* Diffs @routes against the routes of the last sync and updates @state.
+ * The routes are usually the same, deduplicated NMPObject instances as
+ * before, so only the positions where the instance differs need to be
+ * hashed and compared.
+ *
+ * Returns %FALSE and leaves @state untouched, if @routes contains
+ * duplicate routes. */
+static gboolean
+_ip_route_sync_state_diff (NMPlatform *self,
+                           NMPlatformIPRouteSyncState *state,
+                           GPtrArray *routes,
+                           GPtrArray **out_routes_changed,
+                           GPtrArray **out_routes_gone)
+{
+	gs_unref_hashtable GHashTable *removed = NULL;
+	gs_unref_hashtable GHashTable *added = NULL;
+	gs_unref_ptrarray GPtrArray *routes_changed = NULL;
+	gs_unref_ptrarray GPtrArray *routes_gone = NULL;
+	GHashTableIter iter;
+	const NMPObject *o;
+	const NMPObject *o_old;
+	const guint len_old = state->routes_lst->len;
+	const guint len_new = routes ? routes->len : 0u;
+	guint n_diffed = 0;
+	guint i;
+
+	nm_assert (!state->has_duplicates);
+
+	for (i = 0; i < len_old; i++) {
+		o_old = state->routes_lst->pdata[i];
+		if (   i < len_new
+		    && routes->pdata[i] == o_old)
+			continue;
+		if (!removed) {
+			removed = g_hash_table_new ((GHashFunc) nmp_object_id_hash,
+			                            (GEqualFunc) nmp_object_id_equal);
+		}
+		g_hash_table_add (removed, (gpointer) o_old);
+		n_diffed++;
+	}
+
+	for (i = 0; i < len_new; i++) {
+		o = routes->pdata[i];
+		if (   i < len_old
+		    && state->routes_lst->pdata[i] == o)
+			continue;
+		if (i >= len_old)
+			n_diffed++;
+
+		if (   (   added
+		        && g_hash_table_contains (added, o))
+		    || (   g_hash_table_contains (state->routes, o)
+		        && !(   removed
+		             && g_hash_table_contains (removed, o))))
+			return FALSE;
+
+		if (!added) {
+			added = g_hash_table_new ((GHashFunc) nmp_object_id_hash,
+			                          (GEqualFunc) nmp_object_id_equal);
+		}
+		g_hash_table_add (added, (gpointer) o);
+
+		o_old = removed ? g_hash_table_lookup (removed, o) : NULL;
+		if (o_old && nmp_object_equal (o, o_old))
+			continue;
+		if (!routes_changed)
+			routes_changed = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
+		g_ptr_array_add (routes_changed, (gpointer) nmp_object_ref (o));
+	}
+
+	if (removed) {
+		g_hash_table_iter_init (&iter, removed);
+		while (g_hash_table_iter_next (&iter, (gpointer *) &o_old, NULL)) {
+			if (   !added
+			    || !g_hash_table_contains (added, o_old)) {
+				if (_ip_route_is_prune_candidate (self, o_old, state->route_table_sync)) {
+					if (!routes_gone)
+						routes_gone = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
+					g_ptr_array_add (routes_gone, (gpointer) nmp_object_ref (o_old));
+				}
+			}
+			if (_ip_route_is_ecmp_candidate (o_old))
+				state->n_ecmp--;
+			g_hash_table_remove (state->routes, o_old);
+		}
+	}
+
+	if (added) {
+		g_hash_table_iter_init (&iter, added);
+		while (g_hash_table_iter_next (&iter, (gpointer *) &o, NULL)) {
+			if (_ip_route_is_ecmp_candidate (o))
+				state->n_ecmp++;
+			g_hash_table_add (state->routes, (gpointer) nmp_object_ref (o));
+		}
+	}
+
+	for (i = 0; i < MIN (len_old, len_new); i++) {
+		o = routes->pdata[i];
+		if (state->routes_lst->pdata[i] == o)
+			continue;
+		nmp_object_unref (state->routes_lst->pdata[i]);
+		state->routes_lst->pdata[i] = (gpointer) nmp_object_ref (o);
+	}
+	if (len_new < len_old)
+		g_ptr_array_set_size (state->routes_lst, len_new);
+	for (i = len_old; i < len_new; i++)
+		g_ptr_array_add (state->routes_lst, (gpointer) nmp_object_ref (routes->pdata[i]));
+
+	state->n_diffed = n_diffed;
+	*out_routes_changed = g_steal_pointer (&routes_changed);
+	*out_routes_gone = g_steal_pointer (&routes_gone);
+	return TRUE;
+}
+
+/**
+ * nm_platform_ip_route_sync_state_get_prune_list:
+ * @self: the #NMPlatform instance.
+ * @state: (allow-none): the sync state of the interface.
+ * @addr_family: AF_INET or AF_INET6.
+ * @ifindex: the interface.
+ * @route_table_sync: which routes of the interface to prune.
+ *
+ * The first half of nm_platform_ip_route_sync_with_state(). If no route
+ * of the interface changed in the platform cache since the last sync with
+ * @state, @state already knows which routes are there and this returns
+ * %NULL without looking at the cache. Otherwise, it returns the same as
+ * nm_platform_ip_route_get_prune_list().
+ *
+ * Like for nm_platform_ip_route_get_prune_list(), the caller should call
+ * this before changing the addresses of the interface.
+ *
+ * Returns: (transfer full): the list of routes to prune or %NULL.
+ */
+GPtrArray *
+nm_platform_ip_route_sync_state_get_prune_list (NMPlatform *self,
+                                                NMPlatformIPRouteSyncState *state,
+                                                int addr_family,
+                                                int ifindex,
+                                                NMIPRouteTableSyncMode route_table_sync)
+{
+	_CHECK_SELF (self, klass, NULL);
+
+	if (state) {
+		state->usable =    state->valid
+		                && state->n_ecmp == 0
+		                && !state->has_duplicates
+		                && state->addr_family == addr_family
+		                && state->ifindex == ifindex
+		                && state->route_table_sync == route_table_sync
+		                && state->route_ignore_generation == NM_PLATFORM_GET_PRIVATE (self)->route_ignore_generation
+		                && state->route_serial == _ip_route_serial_get (self, addr_family, ifindex);
+		if (state->usable)
+			return NULL;
+	}
+
+	return nm_platform_ip_route_get_prune_list (self, addr_family, ifindex, route_table_sync);
+}
+
+/**
+ * nm_platform_ip_route_sync_with_state:
+ * @self: the #NMPlatform instance.
+ * @addr_family: AF_INET or AF_INET6.
+ * @ifindex: the @ifindex for which the routes are to be synced.
+ * @state: (allow-none): the sync state of the interface, kept by the
+ *   caller between calls. If %NULL, this is the same as
+ *   nm_platform_ip_route_sync().
+ * @routes: (allow-none): the list of routes to configure.
+ * @routes_prune: (allow-none): the list returned by
+ *   nm_platform_ip_route_sync_state_get_prune_list().
+ * @route_table_sync: which routes of the interface to prune. Must be
+ *   the same as for nm_platform_ip_route_sync_state_get_prune_list().
+ * @out_temporary_not_available: (allow-none) (out): like for
+ *   nm_platform_ip_route_sync().
+ *
+ * Like nm_platform_ip_route_sync(), but remembers the synced routes
+ * in @state.
+ *
+ * If @state could be used for the sync, the new @routes only get diffed
+ * against the routes of the previous sync. Positions where @routes has
+ * the same NMPObject instance as before are skipped without hashing or
+ * comparing the route. Only routes that are new or different are passed
+ * on to nm_platform_ip_route_sync(), and only the routes that are gone
+ * are pruned. The cost of a sync then mostly depends on the number of
+ * changed routes, not on the number of routes on the interface.
+ *
+ * If routes of the interface changed in the platform cache in the meantime,
+ * for example because the kernel removed the routes of a removed address,
+ * all @routes get synced to configure missing routes again. Routes added
+ * by somebody else are only pruned by the next full sync.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean
+nm_platform_ip_route_sync_with_state (NMPlatform *self,
+                                      int addr_family,
+                                      int ifindex,
+                                      NMPlatformIPRouteSyncState *state,
+                                      GPtrArray *routes,
+                                      GPtrArray *routes_prune,
+                                      NMIPRouteTableSyncMode route_table_sync,
+                                      GPtrArray **out_temporary_not_available)
+{
+	NMPlatformPrivate *priv;
+	gs_unref_ptrarray GPtrArray *routes_changed = NULL;
+	gs_unref_ptrarray GPtrArray *routes_gone = NULL;
+	gs_unref_ptrarray GPtrArray *temporary_not_available = NULL;
+	gboolean success;
+
+	_CHECK_SELF (self, klass, FALSE);
+
+	nm_assert (NM_IN_SET (addr_family, AF_INET, AF_INET6));
+	nm_assert (ifindex > 0);
+
+	if (!state)
+		return nm_platform_ip_route_sync (self, addr_family, ifindex, routes, routes_prune, out_temporary_not_available);
+
+	priv = NM_PLATFORM_GET_PRIVATE (self);
+
+	if (!state->usable) {
+		_ip_route_sync_state_reset (state, routes);
+		success = nm_platform_ip_route_sync (self, addr_family, ifindex,
+		                                     routes, routes_prune,
+		                                     &temporary_not_available);
+		goto out;
+	}
+
+	nm_assert (!routes_prune);
+	nm_assert (state->route_table_sync == route_table_sync);
+
+	if (!_ip_route_sync_state_diff (self, state, routes, &routes_changed, &routes_gone)) {
+		gs_unref_hashtable GHashTable *routes_old = g_steal_pointer (&state->routes);
+		GHashTableIter iter;
+		const NMPObject *o_old;
+
+		/* @routes has duplicates. Start over, but still prune the
+		 * routes that are gone since the last sync. */
+		_ip_route_sync_state_reset (state, routes);
+		g_hash_table_iter_init (&iter, routes_old);
+		while (g_hash_table_iter_next (&iter, (gpointer *) &o_old, NULL)) {
+			if (g_hash_table_contains (state->routes, o_old))
+				continue;
+			if (!_ip_route_is_prune_candidate (self, o_old, route_table_sync))
+				continue;
+			if (!routes_gone)
+				routes_gone = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
+			g_ptr_array_add (routes_gone, (gpointer) nmp_object_ref (o_old));
+		}
+	}
+
+	if (   state->n_ecmp > 0
+	    || state->has_duplicates
+	    || state->route_serial != _ip_route_serial_get (self, addr_family, ifindex)) {
+		/* ECMP routes get merged by nm_platform_ip_route_sync(), so it needs
+		 * to see all of them. Duplicates are resolved by it too. And if routes
+		 * of the interface changed in the meantime, some of the unchanged
+		 * routes might be missing. */
+		success = nm_platform_ip_route_sync (self, addr_family, ifindex,
+		                                     routes, routes_gone,
+		                                     &temporary_not_available);
+		goto out;
+	}
+
+	if (!routes_changed && !routes_gone) {
+		_LOG3T ("route-sync: IPv%c routes unchanged since last sync",
+		        nm_utils_addr_family_to_char (addr_family));
+		success = TRUE;
+		goto out;
+	}
+
+	_LOG3D ("route-sync: sync %u changed and %u removed IPv%c routes",
+	        routes_changed ? routes_changed->len : 0u,
+	        routes_gone ? routes_gone->len : 0u,
+	        nm_utils_addr_family_to_char (addr_family));
+	success = nm_platform_ip_route_sync (self, addr_family, ifindex,
+	                                     routes_changed, routes_gone,
+	                                     &temporary_not_available);
+
+out:
+	state->addr_family = addr_family;
+	state->ifindex = ifindex;
+	state->route_table_sync = route_table_sync;
+	state->route_ignore_generation = priv->route_ignore_generation;
+	state->route_serial = _ip_route_serial_get (self, addr_family, ifindex);
+	state->valid = success && !temporary_not_available;
+	state->usable = FALSE;
+
+	if (out_temporary_not_available)
+		*out_temporary_not_available = g_steal_pointer (&temporary_not_available);
+
+	return success;
+}
+
 gboolean
 nm_platform_ip_route_flush (NMPlatform *self,
                             int addr_family,
@@ -4771,6 +5870,138 @@ _route_pref_normalize (guint8 pref)
 	       : NM_ICMPV6_ROUTER_PREF_MEDIUM;
 }
 
+static int
+_ip_route_ifindex_normalize (const NMPlatformIPRoute *route)
+{
+	/* with a nexthop object, the device and the gateway are those of the
+	 * nexthop. Kernel reports them, but the routes that we configure don't
+	 * have them. Compare only the nexthop id. */
+	return route->nhid ? 0 : route->ifindex;
+}
+
+static guint16
+_ip_route_n_nexthops_normalize (const NMPlatformIPRoute *route)
+{
+	return route->n_nexthops > 1 ? route->n_nexthops : 0;
+}
+
+static guint16
+_ip_route_weight_normalize (const NMPlatformIPRoute *route)
+{
+	/* kernel only remembers the weight for ECMP routes. */
+	return route->n_nexthops > 1 ? route->weight : 0;
+}
+
+/*****************************************************************************/
+
+const NMPlatformIPRouteMetrics _nm_platform_ip_route_metrics_empty = { 0 };
+
+G_LOCK_DEFINE_STATIC (_ip_route_metrics_lock);
+
+static guint
+_ip_route_metrics_hash_full (const NMPlatformIPRouteMetrics *metrics)
+{
+	NMHashState h;
+
+	nm_hash_init (&h, 1580023497u);
+	nm_hash_update_vals (&h,
+	                     metrics->window,
+	                     metrics->cwnd,
+	                     metrics->initcwnd,
+	                     metrics->initrwnd,
+	                     metrics->mtu,
+	                     NM_HASH_COMBINE_BOOLS (guint8,
+	                                            metrics->lock_window,
+	                                            metrics->lock_cwnd,
+	                                            metrics->lock_initcwnd,
+	                                            metrics->lock_initrwnd,
+	                                            metrics->lock_mtu));
+	return nm_hash_complete (&h);
+}
+
+static int
+_ip_route_metrics_cmp (const NMPlatformIPRouteMetrics *a, const NMPlatformIPRouteMetrics *b)
+{
+	/* interned blocks are unique, so pointer equality is the common case. */
+	if (a == b)
+		return 0;
+	if (!a)
+		a = &_nm_platform_ip_route_metrics_empty;
+	if (!b)
+		b = &_nm_platform_ip_route_metrics_empty;
+	NM_CMP_FIELD_UNSAFE (a, b, lock_window);
+	NM_CMP_FIELD_UNSAFE (a, b, lock_cwnd);
+	NM_CMP_FIELD_UNSAFE (a, b, lock_initcwnd);
+	NM_CMP_FIELD_UNSAFE (a, b, lock_initrwnd);
+	NM_CMP_FIELD_UNSAFE (a, b, lock_mtu);
+	NM_CMP_FIELD (a, b, window);
+	NM_CMP_FIELD (a, b, cwnd);
+	NM_CMP_FIELD (a, b, initcwnd);
+	NM_CMP_FIELD (a, b, initrwnd);
+	NM_CMP_FIELD (a, b, mtu);
+	return 0;
+}
+
+static guint
+_ip_route_metrics_hash (const NMPlatformIPRouteMetrics *metrics)
+{
+	return metrics ? metrics->hash : 0u;
+}
+
+static guint
+_ip_route_metrics_hash_fcn (gconstpointer ptr)
+{
+	return ((const NMPlatformIPRouteMetrics *) ptr)->hash;
+}
+
+static gboolean
+_ip_route_metrics_equal_fcn (gconstpointer a, gconstpointer b)
+{
+	return _ip_route_metrics_cmp (a, b) == 0;
+}
+
+/**
+ * nm_platform_ip_route_metrics_intern:
+ * @metrics: the metrics to look up.
+ *
+ * The uncommon RTA_METRICS of a route are not embedded in NMPlatformIPRoute.
+ * Instead, routes point to a block that is shared by all routes with the
+ * same values. This keeps routes (and the platform cache) small, because
+ * almost all routes have no such metrics at all.
+ *
+ * Like g_intern_string(), the returned blocks are never freed. There are
+ * only few distinct combinations in practice.
+ *
+ * Returns: the unique instance for @metrics, or %NULL if all metrics
+ *   of @metrics are unset. The hash field of @metrics is ignored.
+ */
+const NMPlatformIPRouteMetrics *
+nm_platform_ip_route_metrics_intern (const NMPlatformIPRouteMetrics *metrics)
+{
+	static GHashTable *interned;
+	NMPlatformIPRouteMetrics needle;
+	NMPlatformIPRouteMetrics *m;
+
+	if (   !metrics
+	    || _ip_route_metrics_cmp (metrics, &_nm_platform_ip_route_metrics_empty) == 0)
+		return NULL;
+
+	needle = *metrics;
+	needle.hash = _ip_route_metrics_hash_full (metrics);
+
+	G_LOCK (_ip_route_metrics_lock);
+	if (G_UNLIKELY (!interned))
+		interned = g_hash_table_new (_ip_route_metrics_hash_fcn, _ip_route_metrics_equal_fcn);
+	m = g_hash_table_lookup (interned, &needle);
+	if (!m) {
+		m = g_memdup (&needle, sizeof (needle));
+		g_hash_table_add (interned, m);
+	}
+	G_UNLOCK (_ip_route_metrics_lock);
+
+	return m;
+}
+
 /**
  * nm_platform_ip_route_normalize:
  * @addr_family: AF_INET or AF_INET6
@@ -4791,6 +6022,9 @@ nm_platform_ip_route_normalize (int addr_family,
 	NMPlatformIP4Route *r4;
 	NMPlatformIP6Route *r6;
 
+	route->weight = _ip_route_weight_normalize (route);
+	route->n_nexthops = _ip_route_n_nexthops_normalize (route);
+
 	switch (addr_family) {
 	case AF_INET:
 		r4 = (NMPlatformIP4Route *) route;
@@ -4813,96 +6047,409 @@ nm_platform_ip_route_normalize (int addr_family,
 	}
 }
 
-static int
-_ip_route_add (NMPlatform *self,
-               NMPNlmFlags flags,
-               int addr_family,
-               gconstpointer route)
+static int
+_ip_route_add (NMPlatform *self,
+               NMPNlmFlags flags,
+               int addr_family,
+               gconstpointer route)
+{
+	char sbuf[sizeof (_nm_utils_to_string_buffer)];
+	int ifindex;
+
+	_CHECK_SELF (self, klass, FALSE);
+
+	nm_assert (route);
+	nm_assert (NM_IN_SET (addr_family, AF_INET, AF_INET6));
+
+	ifindex = ((const NMPlatformIPRoute *) route)->ifindex;
+	_LOG3D ("route: %-10s IPv%c route: %s",
+	        _nmp_nlm_flag_to_string (flags & NMP_NLM_FLAG_FMASK),
+	        nm_utils_addr_family_to_char (addr_family),
+	        addr_family == AF_INET
+	          ? nm_platform_ip4_route_to_string (route, sbuf, sizeof (sbuf))
+	          : nm_platform_ip6_route_to_string (route, sbuf, sizeof (sbuf)));
+
+	return klass->ip_route_add (self, flags, addr_family, route);
+}
+
+int
+nm_platform_ip_route_add (NMPlatform *self,
+                          NMPNlmFlags flags,
+                          const NMPObject *route)
+{
+	int addr_family;
+
+	switch (NMP_OBJECT_GET_TYPE (route)) {
+	case NMP_OBJECT_TYPE_IP4_ROUTE:
+		addr_family = AF_INET;
+		break;
+	case NMP_OBJECT_TYPE_IP6_ROUTE:
+		addr_family = AF_INET6;
+		break;
+	default:
+		g_return_val_if_reached (FALSE);
+	}
+
+	if (nmp_object_ip_route_get_n_extra_nexthops (route) > 0) {
+		int r;
+
+		/* the nexthops of ECMP routes are not part of the NMPlatformIPRoute
+		 * struct, only ip_route_add_many() gets the NMPObject. */
+		nm_platform_ip_route_add_many (self, flags, &route, 1, &r);
+		return r;
+	}
+
+	return _ip_route_add (self, flags, addr_family, NMP_OBJECT_CAST_IP_ROUTE (route));
+}
+
+int
+nm_platform_ip4_route_add (NMPlatform *self,
+                           NMPNlmFlags flags,
+                           const NMPlatformIP4Route *route)
+{
+	return _ip_route_add (self, flags, AF_INET, route);
+}
+
+int
+nm_platform_ip6_route_add (NMPlatform *self,
+                           NMPNlmFlags flags,
+                           const NMPlatformIP6Route *route)
+{
+	return _ip_route_add (self, flags, AF_INET6, route);
+}
+
+/**
+ * nm_platform_ip_route_add_many:
+ * @self: the #NMPlatform instance.
+ * @flags: the flags for adding the routes.
+ * @routes: the list of routes to add. Must contain NMPObject instances
+ *   of IPv4 or IPv6 routes.
+ * @len: the number of routes in @routes.
+ * @out_results: an array of size @len. On return, it contains for each
+ *   route the result like nm_platform_ip_route_add() would return it.
+ *
+ * Like calling nm_platform_ip_route_add() for each route, but allows the
+ * implementation to send the requests together and to collect all responses
+ * at once.
+ */
+void
+nm_platform_ip_route_add_many (NMPlatform *self,
+                               NMPNlmFlags flags,
+                               const NMPObject *const*routes,
+                               guint len,
+                               int *out_results)
+{
+	char sbuf[sizeof (_nm_utils_to_string_buffer)];
+	guint i;
+
+	_CHECK_SELF_VOID (self, klass);
+
+	nm_assert (len == 0 || routes);
+	nm_assert (len == 0 || out_results);
+
+	if (len == 0)
+		return;
+
+	for (i = 0; i < len; i++) {
+		const NMPObject *route = routes[i];
+		int ifindex = NMP_OBJECT_CAST_IP_ROUTE (route)->ifindex;
+
+		nm_assert (NM_IN_SET (NMP_OBJECT_GET_TYPE (route), NMP_OBJECT_TYPE_IP4_ROUTE,
+		                                                   NMP_OBJECT_TYPE_IP6_ROUTE));
+
+		_LOG3D ("route: %-10s IPv%c route: %s",
+		        _nmp_nlm_flag_to_string (flags & NMP_NLM_FLAG_FMASK),
+		        NMP_OBJECT_GET_TYPE (route) == NMP_OBJECT_TYPE_IP4_ROUTE ? '4' : '6',
+		        nmp_object_to_string (route, NMP_OBJECT_TO_STRING_PUBLIC, sbuf, sizeof (sbuf)));
+	}
+
+	if (klass->ip_route_add_many) {
+		klass->ip_route_add_many (self, flags, routes, len, out_results);
+		return;
+	}
+
+	for (i = 0; i < len; i++) {
+		out_results[i] = klass->ip_route_add (self,
+		                                      flags,
+		                                        NMP_OBJECT_GET_TYPE (routes[i]) == NMP_OBJECT_TYPE_IP4_ROUTE
+		                                      ? AF_INET
+		                                      : AF_INET6,
+		                                      NMP_OBJECT_CAST_IP_ROUTE (routes[i]));
+	}
+}
+
+/**
+ * nm_platform_ip_route_delete_many:
+ * @self: the #NMPlatform instance.
+ * @routes: the list of routes to delete.
+ * @len: the number of routes in @routes.
+ *
+ * Like calling nm_platform_object_delete() for each route, but allows
+ * the implementation to send the requests together. Failures are only
+ * logged, like the callers of nm_platform_object_delete() commonly do.
+ */
+void
+nm_platform_ip_route_delete_many (NMPlatform *self,
+                                  const NMPObject *const*routes,
+                                  guint len)
+{
+	guint i;
+
+	_CHECK_SELF_VOID (self, klass);
+
+	nm_assert (len == 0 || routes);
+
+	if (len == 0)
+		return;
+
+	if (!klass->ip_route_delete_many) {
+		for (i = 0; i < len; i++)
+			nm_platform_object_delete (self, routes[i]);
+		return;
+	}
+
+	for (i = 0; i < len; i++) {
+		const NMPObject *route = routes[i];
+		int ifindex = NMP_OBJECT_CAST_IP_ROUTE (route)->ifindex;
+
+		nm_assert (NM_IN_SET (NMP_OBJECT_GET_TYPE (route), NMP_OBJECT_TYPE_IP4_ROUTE,
+		                                                   NMP_OBJECT_TYPE_IP6_ROUTE));
+
+		_LOG3D ("%s: delete %s",
+		        NMP_OBJECT_GET_CLASS (route)->obj_type_name,
+		        nmp_object_to_string (route, NMP_OBJECT_TO_STRING_PUBLIC, NULL, 0));
+	}
+
+	klass->ip_route_delete_many (self, routes, len);
+}
+
+gboolean
+nm_platform_object_delete (NMPlatform *self,
+                           const NMPObject *obj)
 {
-	char sbuf[sizeof (_nm_utils_to_string_buffer)];
 	int ifindex;
 
 	_CHECK_SELF (self, klass, FALSE);
 
-	nm_assert (route);
-	nm_assert (NM_IN_SET (addr_family, AF_INET, AF_INET6));
-
-	ifindex = ((const NMPlatformIPRoute *) route)->ifindex;
-	_LOG3D ("route: %-10s IPv%c route: %s",
-	        _nmp_nlm_flag_to_string (flags & NMP_NLM_FLAG_FMASK),
-	        nm_utils_addr_family_to_char (addr_family),
-	        addr_family == AF_INET
-	          ? nm_platform_ip4_route_to_string (route, sbuf, sizeof (sbuf))
-	          : nm_platform_ip6_route_to_string (route, sbuf, sizeof (sbuf)));
+	switch (NMP_OBJECT_GET_TYPE (obj)) {
+	case NMP_OBJECT_TYPE_ROUTING_RULE:
+		_LOGD ("%s: delete %s",
+		       NMP_OBJECT_GET_CLASS (obj)->obj_type_name,
+		       nmp_object_to_string (obj, NMP_OBJECT_TO_STRING_PUBLIC, NULL, 0));
+		break;
+	case NMP_OBJECT_TYPE_IP4_ROUTE:
+	case NMP_OBJECT_TYPE_IP6_ROUTE:
+	case NMP_OBJECT_TYPE_IP4_NEXTHOP:
+	case NMP_OBJECT_TYPE_IP6_NEXTHOP:
+	case NMP_OBJECT_TYPE_QDISC:
+	case NMP_OBJECT_TYPE_TFILTER:
+		ifindex = NMP_OBJECT_CAST_OBJ_WITH_IFINDEX (obj)->ifindex;
+		_LOG3D ("%s: delete %s",
+		        NMP_OBJECT_GET_CLASS (obj)->obj_type_name,
+		        nmp_object_to_string (obj, NMP_OBJECT_TO_STRING_PUBLIC, NULL, 0));
+		break;
+	default:
+		g_return_val_if_reached (FALSE);
+	}
 
-	return klass->ip_route_add (self, flags, addr_family, route);
+	return klass->object_delete (self, obj);
 }
 
-int
-nm_platform_ip_route_add (NMPlatform *self,
-                          NMPNlmFlags flags,
-                          const NMPObject *route)
+/*****************************************************************************/
+
+/**
+ * nm_platform_object_add_async:
+ * @self: the #NMPlatform instance.
+ * @flags: flags like for nm_platform_ip_route_add(). For addresses,
+ *   they are ignored and the address gets replaced.
+ * @obj: the address, route, nexthop, routing rule, qdisc or tfilter to add.
+ * @callback: (allow-none): invoked with the result.
+ * @callback_data: user data for @callback.
+ * @cancellable: (allow-none): on cancellation, @callback gets invoked
+ *   synchronously with a cancelled error. The kernel might still
+ *   perform the operation.
+ *
+ * Sends the request to add @obj and returns immediately, without waiting
+ * for the kernel to acknowledge it. @callback is invoked exactly once,
+ * and never synchronously from this function. Requests for different
+ * objects can be in flight at the same time.
+ *
+ * When @callback is invoked, the platform cache may not yet reflect the
+ * change, it gets updated as usual by the kernel's notifications.
+ *
+ * Returns: the netlink sequence number of the request, to correlate it
+ *   with log messages. 0 if the request could not be sent (and @callback
+ *   reports the failure), or if the platform implementation does not
+ *   use netlink.
+ */
+guint32
+nm_platform_object_add_async (NMPlatform *self,
+                              NMPNlmFlags flags,
+                              const NMPObject *obj,
+                              NMPlatformAsyncCallback callback,
+                              gpointer callback_data,
+                              GCancellable *cancellable)
 {
-	int addr_family;
+	int ifindex;
+	gboolean success;
 
-	switch (NMP_OBJECT_GET_TYPE (route)) {
-	case NMP_OBJECT_TYPE_IP4_ROUTE:
-		addr_family = AF_INET;
+	_CHECK_SELF (self, klass, 0);
+
+	g_return_val_if_fail (obj, 0);
+	g_return_val_if_fail (callback || !callback_data, 0);
+
+	switch (NMP_OBJECT_GET_TYPE (obj)) {
+	case NMP_OBJECT_TYPE_ROUTING_RULE:
+		_LOGD ("%s: add async %s",
+		       NMP_OBJECT_GET_CLASS (obj)->obj_type_name,
+		       nmp_object_to_string (obj, NMP_OBJECT_TO_STRING_PUBLIC, NULL, 0));
 		break;
+	case NMP_OBJECT_TYPE_IP4_ADDRESS:
+	case NMP_OBJECT_TYPE_IP6_ADDRESS:
+	case NMP_OBJECT_TYPE_IP4_ROUTE:
 	case NMP_OBJECT_TYPE_IP6_ROUTE:
-		addr_family = AF_INET6;
+	case NMP_OBJECT_TYPE_IP4_NEXTHOP:
+	case NMP_OBJECT_TYPE_IP6_NEXTHOP:
+	case NMP_OBJECT_TYPE_QDISC:
+	case NMP_OBJECT_TYPE_TFILTER:
+		ifindex = NMP_OBJECT_CAST_OBJ_WITH_IFINDEX (obj)->ifindex;
+		_LOG3D ("%s: add async %s",
+		        NMP_OBJECT_GET_CLASS (obj)->obj_type_name,
+		        nmp_object_to_string (obj, NMP_OBJECT_TO_STRING_PUBLIC, NULL, 0));
 		break;
 	default:
-		g_return_val_if_reached (FALSE);
+		g_return_val_if_reached (0);
 	}
 
-	return _ip_route_add (self, flags, addr_family, NMP_OBJECT_CAST_IP_ROUTE (route));
-}
+	if (klass->object_add_async)
+		return klass->object_add_async (self, flags, obj, callback, callback_data, cancellable);
 
-int
-nm_platform_ip4_route_add (NMPlatform *self,
-                           NMPNlmFlags flags,
-                           const NMPlatformIP4Route *route)
-{
-	return _ip_route_add (self, flags, AF_INET, route);
-}
+	switch (NMP_OBJECT_GET_TYPE (obj)) {
+	case NMP_OBJECT_TYPE_IP4_ADDRESS: {
+		const NMPlatformIP4Address *a = NMP_OBJECT_CAST_IP4_ADDRESS (obj);
+		guint32 lifetime, preferred;
 
-int
-nm_platform_ip6_route_add (NMPlatform *self,
-                           NMPNlmFlags flags,
-                           const NMPlatformIP6Route *route)
-{
-	return _ip_route_add (self, flags, AF_INET6, route);
+		lifetime = nm_utils_lifetime_get (a->timestamp, a->lifetime, a->preferred,
+		                                  nm_utils_get_monotonic_timestamp_s (), &preferred);
+		success = nm_platform_ip4_address_add (self, a->ifindex, a->address, a->plen, a->peer_address,
+		                                       lifetime, preferred, a->n_ifa_flags, a->label);
+		break;
+	}
+	case NMP_OBJECT_TYPE_IP6_ADDRESS: {
+		const NMPlatformIP6Address *a = NMP_OBJECT_CAST_IP6_ADDRESS (obj);
+		guint32 lifetime, preferred;
+
+		lifetime = nm_utils_lifetime_get (a->timestamp, a->lifetime, a->preferred,
+		                                  nm_utils_get_monotonic_timestamp_s (), &preferred);
+		success = nm_platform_ip6_address_add (self, a->ifindex, a->address, a->plen, a->peer_address,
+		                                       lifetime, preferred, a->n_ifa_flags);
+		break;
+	}
+	case NMP_OBJECT_TYPE_IP4_ROUTE:
+	case NMP_OBJECT_TYPE_IP6_ROUTE:
+		success = (nm_platform_ip_route_add (self, flags, obj) >= 0);
+		break;
+	case NMP_OBJECT_TYPE_IP4_NEXTHOP:
+	case NMP_OBJECT_TYPE_IP6_NEXTHOP:
+		success = (nm_platform_ip_nexthop_add (self, flags, obj) >= 0);
+		break;
+	case NMP_OBJECT_TYPE_ROUTING_RULE:
+		success = (nm_platform_routing_rule_add (self, flags, NMP_OBJECT_CAST_ROUTING_RULE (obj)) >= 0);
+		break;
+	case NMP_OBJECT_TYPE_QDISC:
+		success = (nm_platform_qdisc_add (self, flags, NMP_OBJECT_CAST_QDISC (obj)) >= 0);
+		break;
+	case NMP_OBJECT_TYPE_TFILTER:
+		success = (nm_platform_tfilter_add (self, flags, NMP_OBJECT_CAST_TFILTER (obj)) >= 0);
+		break;
+	default:
+		nm_assert_not_reached ();
+		success = FALSE;
+		break;
+	}
+
+	return _async_fallback_complete (self, success, "add object", callback, callback_data, cancellable);
 }
 
-gboolean
-nm_platform_object_delete (NMPlatform *self,
-                           const NMPObject *obj)
+/**
+ * nm_platform_object_delete_async:
+ * @self: the #NMPlatform instance.
+ * @obj: the link, address, route, nexthop, routing rule, qdisc or
+ *   tfilter to delete.
+ * @callback: (allow-none): invoked with the result.
+ * @callback_data: user data for @callback.
+ * @cancellable: (allow-none): the cancellable.
+ *
+ * Like nm_platform_object_add_async(), but deletes @obj. It is not an
+ * error if @obj is already gone.
+ *
+ * Returns: the netlink sequence number of the request or 0.
+ */
+guint32
+nm_platform_object_delete_async (NMPlatform *self,
+                                 const NMPObject *obj,
+                                 NMPlatformAsyncCallback callback,
+                                 gpointer callback_data,
+                                 GCancellable *cancellable)
 {
 	int ifindex;
+	gboolean success;
 
-	_CHECK_SELF (self, klass, FALSE);
+	_CHECK_SELF (self, klass, 0);
+
+	g_return_val_if_fail (obj, 0);
+	g_return_val_if_fail (callback || !callback_data, 0);
 
 	switch (NMP_OBJECT_GET_TYPE (obj)) {
 	case NMP_OBJECT_TYPE_ROUTING_RULE:
-		_LOGD ("%s: delete %s",
+		_LOGD ("%s: delete async %s",
 		       NMP_OBJECT_GET_CLASS (obj)->obj_type_name,
 		       nmp_object_to_string (obj, NMP_OBJECT_TO_STRING_PUBLIC, NULL, 0));
 		break;
+	case NMP_OBJECT_TYPE_LINK:
+	case NMP_OBJECT_TYPE_IP4_ADDRESS:
+	case NMP_OBJECT_TYPE_IP6_ADDRESS:
 	case NMP_OBJECT_TYPE_IP4_ROUTE:
 	case NMP_OBJECT_TYPE_IP6_ROUTE:
+	case NMP_OBJECT_TYPE_IP4_NEXTHOP:
+	case NMP_OBJECT_TYPE_IP6_NEXTHOP:
 	case NMP_OBJECT_TYPE_QDISC:
 	case NMP_OBJECT_TYPE_TFILTER:
 		ifindex = NMP_OBJECT_CAST_OBJ_WITH_IFINDEX (obj)->ifindex;
-		_LOG3D ("%s: delete %s",
+		_LOG3D ("%s: delete async %s",
 		        NMP_OBJECT_GET_CLASS (obj)->obj_type_name,
-		        nmp_object_to_string (obj, NMP_OBJECT_TO_STRING_PUBLIC, NULL, 0));
+		        nmp_object_to_string (obj, NMP_OBJECT_TO_STRING_ID, NULL, 0));
 		break;
 	default:
-		g_return_val_if_reached (FALSE);
+		g_return_val_if_reached (0);
 	}
 
-	return klass->object_delete (self, obj);
+	if (klass->object_delete_async)
+		return klass->object_delete_async (self, obj, callback, callback_data, cancellable);
+
+	switch (NMP_OBJECT_GET_TYPE (obj)) {
+	case NMP_OBJECT_TYPE_LINK:
+		success = klass->link_delete (self, obj->link.ifindex);
+		break;
+	case NMP_OBJECT_TYPE_IP4_ADDRESS:
+		success = klass->ip4_address_delete (self,
+		                                     obj->ip4_address.ifindex,
+		                                     obj->ip4_address.address,
+		                                     obj->ip4_address.plen,
+		                                     obj->ip4_address.peer_address);
+		break;
+	case NMP_OBJECT_TYPE_IP6_ADDRESS:
+		success = klass->ip6_address_delete (self,
+		                                     obj->ip6_address.ifindex,
+		                                     obj->ip6_address.address,
+		                                     obj->ip6_address.plen);
+		break;
+	default:
+		success = klass->object_delete (self, obj);
+		break;
+	}
+
+	return _async_fallback_complete (self, success, "delete object", callback, callback_data, cancellable);
 }
 
 /*****************************************************************************/
@@ -5229,6 +6776,129 @@ nm_platform_ip4_dev_route_blacklist_set (NMPlatform *self,
 
 /*****************************************************************************/
 
+int
+nm_platform_ip_nexthop_add (NMPlatform *self,
+                            NMPNlmFlags flags,
+                            const NMPObject *nexthop)
+{
+	int ifindex;
+
+	_CHECK_SELF (self, klass, -NME_BUG);
+
+	nm_assert (NM_IN_SET (NMP_OBJECT_GET_TYPE (nexthop), NMP_OBJECT_TYPE_IP4_NEXTHOP,
+	                                                     NMP_OBJECT_TYPE_IP6_NEXTHOP));
+
+	ifindex = NMP_OBJECT_CAST_IP_NEXTHOP (nexthop)->ifindex;
+
+	if (!klass->ip_nexthop_add)
+		return -NME_PL_OPNOTSUPP;
+
+	_LOG3D ("nexthop: adding or updating IPv%c nexthop: %s",
+	        nm_utils_addr_family_to_char (NMP_OBJECT_GET_CLASS (nexthop)->addr_family),
+	        nmp_object_to_string (nexthop, NMP_OBJECT_TO_STRING_PUBLIC, NULL, 0));
+	return klass->ip_nexthop_add (self,
+	                              flags,
+	                              NMP_OBJECT_GET_CLASS (nexthop)->addr_family,
+	                              NMP_OBJECT_CAST_IP_NEXTHOP (nexthop));
+}
+
+/**
+ * nm_platform_ip_nexthop_sync:
+ * @self: the #NMPlatform instance
+ * @addr_family: AF_INET or AF_INET6
+ * @ifindex: the ifindex where to configure the nexthops.
+ * @known_nexthops: (allow-none): the list of nexthops (#NMPObject) of
+ *   the @addr_family.
+ * @prune: if %TRUE, delete all other nexthops on @ifindex, except
+ *   those that were added by kernel.
+ *
+ * Nexthops that are already configured as requested are not touched.
+ * Note that kernel also deletes all routes that use a nexthop that
+ * gets deleted.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean
+nm_platform_ip_nexthop_sync (NMPlatform *self,
+                             int addr_family,
+                             int ifindex,
+                             GPtrArray *known_nexthops,
+                             gboolean prune)
+{
+	const NMPObjectType obj_type = (addr_family == AF_INET)
+	                               ? NMP_OBJECT_TYPE_IP4_NEXTHOP
+	                               : NMP_OBJECT_TYPE_IP6_NEXTHOP;
+	gs_unref_ptrarray GPtrArray *plat_nexthops = NULL;
+	gs_unref_hashtable GHashTable *known_nexthops_idx = NULL;
+	NMPLookup lookup;
+	guint i;
+	gboolean success = TRUE;
+
+	nm_assert (NM_IS_PLATFORM (self));
+	nm_assert (NM_IN_SET (addr_family, AF_INET, AF_INET6));
+	nm_assert (ifindex > 0);
+
+	known_nexthops_idx = g_hash_table_new ((GHashFunc) nmp_object_id_hash,
+	                                       (GEqualFunc) nmp_object_id_equal);
+
+	if (known_nexthops) {
+		for (i = 0; i < known_nexthops->len; i++) {
+			const NMPObject *n = g_ptr_array_index (known_nexthops, i);
+
+			nm_assert (NMP_OBJECT_GET_TYPE (n) == obj_type);
+			g_hash_table_insert (known_nexthops_idx, (gpointer) n, (gpointer) n);
+		}
+	}
+
+	if (prune) {
+		plat_nexthops = nm_platform_lookup_clone (self,
+		                                          nmp_lookup_init_object (&lookup,
+		                                                                  obj_type,
+		                                                                  ifindex),
+		                                          NULL, NULL);
+		if (plat_nexthops) {
+			for (i = 0; i < plat_nexthops->len; i++) {
+				const NMPObject *n = g_ptr_array_index (plat_nexthops, i);
+
+				if (NMP_OBJECT_CAST_IP_NEXTHOP (n)->nh_source == NM_IP_CONFIG_SOURCE_RTPROT_KERNEL)
+					continue;
+				if (g_hash_table_lookup (known_nexthops_idx, n))
+					continue;
+				success &= nm_platform_object_delete (self, n);
+			}
+		}
+	}
+
+	if (known_nexthops) {
+		for (i = 0; i < known_nexthops->len; i++) {
+			const NMPObject *n = g_ptr_array_index (known_nexthops, i);
+			const NMPObject *plat_n;
+
+			plat_n = nm_platform_lookup_obj (self, NMP_CACHE_ID_TYPE_OBJECT_TYPE, n);
+			if (plat_n) {
+				NMPObject n_norm;
+				NMPObject plat_n_norm;
+
+				/* compare like kernel would report it. Only RTNH_F_ONLINK
+				 * is configurable, kernel adds flags like RTNH_F_LINKDOWN. */
+				nmp_object_stackinit (&n_norm, obj_type, &n->object);
+				nmp_object_stackinit (&plat_n_norm, obj_type, &plat_n->object);
+				n_norm.ip_nexthop.nh_source = nmp_utils_ip_config_source_round_trip_rtprot (n_norm.ip_nexthop.nh_source);
+				n_norm.ip_nexthop.nh_flags &= RTNH_F_ONLINK;
+				plat_n_norm.ip_nexthop.nh_flags &= RTNH_F_ONLINK;
+				if (nmp_object_equal (&plat_n_norm, &n_norm))
+					continue;
+			}
+
+			success &= (nm_platform_ip_nexthop_add (self, NMP_NLM_FLAG_REPLACE, n) >= 0);
+		}
+	}
+
+	return success;
+}
+
+/*****************************************************************************/
+
 int
 nm_platform_routing_rule_add (NMPlatform *self,
                               NMPNlmFlags flags,
@@ -5259,6 +6929,104 @@ nm_platform_qdisc_add (NMPlatform *self,
 	return klass->qdisc_add (self, flags, qdisc);
 }
 
+/* whether the qdisc @plat in the platform cache already has the settings
+ * of @want. Parameters that are not set in @want are kernel defaults
+ * and are not compared. */
+static gboolean
+_qdisc_is_satisfied (const NMPlatformQdisc *plat,
+                     const NMPlatformQdisc *want)
+{
+	if (!nm_streq0 (plat->kind, want->kind))
+		return FALSE;
+	if (   want->handle
+	    && want->handle != plat->handle)
+		return FALSE;
+
+	if (nm_streq0 (want->kind, "fq_codel")) {
+		if (   want->fq_codel.limit
+		    && want->fq_codel.limit != plat->fq_codel.limit)
+			return FALSE;
+		if (   want->fq_codel.flows
+		    && want->fq_codel.flows != plat->fq_codel.flows)
+			return FALSE;
+		if (   want->fq_codel.target
+		    && want->fq_codel.target != plat->fq_codel.target)
+			return FALSE;
+		if (   want->fq_codel.interval
+		    && want->fq_codel.interval != plat->fq_codel.interval)
+			return FALSE;
+		if (   want->fq_codel.quantum
+		    && want->fq_codel.quantum != plat->fq_codel.quantum)
+			return FALSE;
+		if (   want->fq_codel.ce_threshold != NM_PLATFORM_FQ_CODEL_CE_THRESHOLD_DISABLED
+		    && want->fq_codel.ce_threshold != plat->fq_codel.ce_threshold)
+			return FALSE;
+		if (   want->fq_codel.memory_limit != NM_PLATFORM_FQ_CODEL_MEMORY_LIMIT_UNSET
+		    && want->fq_codel.memory_limit != plat->fq_codel.memory_limit)
+			return FALSE;
+		if (   want->fq_codel.ecn
+		    && !plat->fq_codel.ecn)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+gboolean
+_nmtst_platform_qdisc_is_satisfied (const NMPlatformQdisc *plat,
+                                    const NMPlatformQdisc *want)
+{
+	return _qdisc_is_satisfied (plat, want);
+}
+
+/* the handle of the qdisc that owns the class @parent, or zero if
+ * @parent is not a class of another qdisc. */
+static guint32
+_qdisc_parent_handle (guint32 parent)
+{
+	if (NM_IN_SET (parent, TC_H_UNSPEC, TC_H_ROOT, TC_H_INGRESS))
+		return 0;
+	return TC_H_MAJ (parent);
+}
+
+/* the number of ancestors of @q in @qdiscs, where the parent of
+ * a qdisc is the one whose handle is the major of its parent class. */
+static guint
+_qdisc_get_depth (GPtrArray *qdiscs,
+                  const NMPlatformQdisc *q)
+{
+	guint depth = 0;
+	guint i;
+
+again:
+	if (depth >= qdiscs->len) {
+		/* a loop? Give up. */
+		return depth;
+	}
+	for (i = 0; i < qdiscs->len; i++) {
+		const NMPlatformQdisc *p = NMP_OBJECT_CAST_QDISC (qdiscs->pdata[i]);
+
+		if (   p != q
+		    && p->handle != 0
+		    && p->handle == _qdisc_parent_handle (q->parent)) {
+			depth++;
+			q = p;
+			goto again;
+		}
+	}
+	return depth;
+}
+
+static int
+_qdisc_depth_cmp (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	GPtrArray *qdiscs = user_data;
+
+	NM_CMP_DIRECT (_qdisc_get_depth (qdiscs, NMP_OBJECT_CAST_QDISC (*((const NMPObject *const*) a))),
+	               _qdisc_get_depth (qdiscs, NMP_OBJECT_CAST_QDISC (*((const NMPObject *const*) b))));
+	return 0;
+}
+
 /**
  * nm_platform_qdisc_sync:
  * @self: the #NMPlatform instance
@@ -5271,6 +7039,11 @@ nm_platform_qdisc_add (NMPlatform *self,
  * caller to pass NMPlatformQdisc instances which "kind" string
  * have a limited lifetime.
  *
+ * Qdiscs that are already configured as requested are left alone,
+ * the others are replaced in place (NLM_F_REPLACE), parents before
+ * their children. That way, re-applying the same configuration does
+ * not interrupt traffic.
+ *
  * Returns: %TRUE on success.
  */
 gboolean
@@ -5279,16 +7052,25 @@ nm_platform_qdisc_sync (NMPlatform *self,
                         GPtrArray *known_qdiscs)
 {
 	gs_unref_ptrarray GPtrArray *plat_qdiscs = NULL;
+	gs_unref_ptrarray GPtrArray *known_sorted = NULL;
 	NMPLookup lookup;
 	guint i;
 	gboolean success = TRUE;
 	gs_unref_hashtable GHashTable *known_qdiscs_idx = NULL;
+	gs_unref_hashtable GHashTable *plat_qdiscs_idx = NULL;
+	gs_unref_hashtable GHashTable *reset_handles = NULL;
 
 	nm_assert (NM_IS_PLATFORM (self));
 	nm_assert (ifindex > 0);
 
 	known_qdiscs_idx = g_hash_table_new ((GHashFunc) nmp_object_id_hash,
 	                                     (GEqualFunc) nmp_object_id_equal);
+	plat_qdiscs_idx = g_hash_table_new ((GHashFunc) nmp_object_id_hash,
+	                                    (GEqualFunc) nmp_object_id_equal);
+
+	/* the handles of qdiscs that are deleted or replaced by a new instance.
+	 * Their child qdiscs are gone too. */
+	reset_handles = g_hash_table_new (nm_direct_hash, NULL);
 
 	if (known_qdiscs) {
 		for (i = 0; i < known_qdiscs->len; i++) {
@@ -5308,18 +7090,60 @@ nm_platform_qdisc_sync (NMPlatform *self,
 		for (i = 0; i < plat_qdiscs->len; i++) {
 			const NMPObject *q = g_ptr_array_index (plat_qdiscs, i);
 
-			if (!g_hash_table_lookup (known_qdiscs_idx, q))
-				success &= nm_platform_object_delete (self, q);
+			g_hash_table_insert (plat_qdiscs_idx, (gpointer) q, (gpointer) q);
+			if (   q->qdisc.handle != 0
+			    && !g_hash_table_lookup (known_qdiscs_idx, q))
+				g_hash_table_add (reset_handles, GUINT_TO_POINTER (q->qdisc.handle));
+		}
+
+		for (i = 0; i < plat_qdiscs->len; i++) {
+			const NMPObject *q = g_ptr_array_index (plat_qdiscs, i);
+
+			if (g_hash_table_lookup (known_qdiscs_idx, q))
+				continue;
+
+			/* deleting the parent qdisc already deletes the children. */
+			if (   _qdisc_parent_handle (q->qdisc.parent) != 0
+			    && g_hash_table_contains (reset_handles, GUINT_TO_POINTER (_qdisc_parent_handle (q->qdisc.parent))))
+				continue;
+
+			success &= nm_platform_object_delete (self, q);
 		}
 	}
 
-	if (known_qdiscs) {
-		for (i = 0; i < known_qdiscs->len; i++) {
-			const NMPObject *q = g_ptr_array_index (known_qdiscs, i);
+	if (!known_qdiscs)
+		return success;
+
+	known_sorted = g_ptr_array_new_full (known_qdiscs->len, NULL);
+	for (i = 0; i < known_qdiscs->len; i++)
+		g_ptr_array_add (known_sorted, known_qdiscs->pdata[i]);
+	g_ptr_array_sort_with_data (known_sorted, _qdisc_depth_cmp, known_qdiscs);
+
+	for (i = 0; i < known_sorted->len; i++) {
+		const NMPObject *q = g_ptr_array_index (known_sorted, i);
+		const NMPObject *plat_q;
+
+		plat_q = g_hash_table_lookup (plat_qdiscs_idx, q);
+		if (   plat_q
+		    && _qdisc_is_satisfied (NMP_OBJECT_CAST_QDISC (plat_q), NMP_OBJECT_CAST_QDISC (q))
+		    && (   _qdisc_parent_handle (q->qdisc.parent) == 0
+		        || !g_hash_table_contains (reset_handles, GUINT_TO_POINTER (_qdisc_parent_handle (q->qdisc.parent))))) {
+			/* already as desired. */
+			continue;
+		}
 
-			success &= (nm_platform_qdisc_add (self, NMP_NLM_FLAG_ADD,
-			                                   NMP_OBJECT_CAST_QDISC (q)) >= 0);
+		if (   plat_q
+		    && plat_q->qdisc.handle != 0
+		    && (   !nm_streq0 (plat_q->qdisc.kind, q->qdisc.kind)
+		        || (   q->qdisc.handle != 0
+		            && q->qdisc.handle != plat_q->qdisc.handle))) {
+			/* the kernel creates a new qdisc and grafts it in place of the
+			 * old one. The children of the old one are gone. */
+			g_hash_table_add (reset_handles, GUINT_TO_POINTER (plat_q->qdisc.handle));
 		}
+
+		success &= (nm_platform_qdisc_add (self, NMP_NLM_FLAG_REPLACE,
+		                                   NMP_OBJECT_CAST_QDISC (q)) >= 0);
 	}
 
 	return success;
@@ -5342,8 +7166,51 @@ nm_platform_tfilter_add (NMPlatform *self,
 	return klass->tfilter_add (self, flags, tfilter);
 }
 
+static gboolean
+_tfilter_action_equal (const NMPlatformAction *a,
+                       const NMPlatformAction *b)
+{
+	if (!nm_streq0 (a->kind, b->kind))
+		return FALSE;
+	if (!a->kind)
+		return TRUE;
+
+	if (nm_streq (a->kind, NM_PLATFORM_ACTION_KIND_SIMPLE))
+		return nm_streq (a->simple.sdata, b->simple.sdata);
+
+	if (nm_streq (a->kind, NM_PLATFORM_ACTION_KIND_MIRRED)) {
+		return    a->mirred.ifindex == b->mirred.ifindex
+		       && a->mirred.ingress == b->mirred.ingress
+		       && a->mirred.egress == b->mirred.egress
+		       && a->mirred.mirror == b->mirred.mirror
+		       && a->mirred.redirect == b->mirred.redirect;
+	}
+
+	return TRUE;
+}
+
+/* whether @want can be applied on top of @plat with NLM_F_REPLACE. Kernel
+ * identifies the filter by parent, priority, protocol and kind. */
+static gboolean
+_tfilter_can_replace (const NMPlatformTfilter *plat,
+                      const NMPlatformTfilter *want)
+{
+	return    plat->parent == want->parent
+	       && nm_streq0 (plat->kind, want->kind)
+	       && TC_H_MIN (plat->info) == TC_H_MIN (want->info)
+	       && (   TC_H_MAJ (want->info) == 0
+	           || TC_H_MAJ (want->info) == TC_H_MAJ (plat->info));
+}
+
+gboolean
+_nmtst_platform_tfilter_can_replace (const NMPlatformTfilter *plat,
+                                     const NMPlatformTfilter *want)
+{
+	return _tfilter_can_replace (plat, want);
+}
+
 /**
- * nm_platform_qdisc_sync:
+ * nm_platform_tfilter_sync:
  * @self: the #NMPlatform instance
  * @ifindex: the ifindex where to configure the qdiscs.
  * @known_tfilters: the list of tfilters (#NMPObject).
@@ -5354,6 +7221,10 @@ nm_platform_tfilter_add (NMPlatform *self,
  * caller to pass NMPlatformTfilter instances which "kind" string
  * have a limited lifetime.
  *
+ * Filters that are already configured as requested are left alone.
+ * Filters with a different action are updated in place (NLM_F_REPLACE).
+ * Only if that is not possible, they are deleted and added again.
+ *
  * Returns: %TRUE on success.
  */
 gboolean
@@ -5366,12 +7237,15 @@ nm_platform_tfilter_sync (NMPlatform *self,
 	guint i;
 	gboolean success = TRUE;
 	gs_unref_hashtable GHashTable *known_tfilters_idx = NULL;
+	gs_unref_hashtable GHashTable *plat_tfilters_idx = NULL;
 
 	nm_assert (NM_IS_PLATFORM (self));
 	nm_assert (ifindex > 0);
 
 	known_tfilters_idx = g_hash_table_new ((GHashFunc) nmp_object_id_hash,
 	                                       (GEqualFunc) nmp_object_id_equal);
+	plat_tfilters_idx = g_hash_table_new ((GHashFunc) nmp_object_id_hash,
+	                                      (GEqualFunc) nmp_object_id_equal);
 
 	if (known_tfilters) {
 		for (i = 0; i < known_tfilters->len; i++) {
@@ -5393,15 +7267,42 @@ nm_platform_tfilter_sync (NMPlatform *self,
 
 			if (!g_hash_table_lookup (known_tfilters_idx, q))
 				success &= nm_platform_object_delete (self, q);
+			else
+				g_hash_table_insert (plat_tfilters_idx, (gpointer) q, (gpointer) q);
 		}
 	}
 
 	if (known_tfilters) {
 		for (i = 0; i < known_tfilters->len; i++) {
 			const NMPObject *q = g_ptr_array_index (known_tfilters, i);
+			const NMPObject *plat_q;
+			NMPlatformTfilter tfilter;
+
+			plat_q = g_hash_table_lookup (plat_tfilters_idx, q);
+			if (!plat_q) {
+				success &= (nm_platform_tfilter_add (self, NMP_NLM_FLAG_ADD,
+				                                     NMP_OBJECT_CAST_TFILTER (q)) >= 0);
+				continue;
+			}
+
+			if (!_tfilter_can_replace (NMP_OBJECT_CAST_TFILTER (plat_q), NMP_OBJECT_CAST_TFILTER (q))) {
+				success &= nm_platform_object_delete (self, plat_q);
+				success &= (nm_platform_tfilter_add (self, NMP_NLM_FLAG_ADD,
+				                                     NMP_OBJECT_CAST_TFILTER (q)) >= 0);
+				continue;
+			}
+
+			if (_tfilter_action_equal (&plat_q->tfilter.action, &q->tfilter.action)) {
+				/* already as desired. */
+				continue;
+			}
+
+			/* with priority zero, kernel would allocate a new priority and add
+			 * another filter. Replace the existing one instead. */
+			tfilter = *NMP_OBJECT_CAST_TFILTER (q);
+			tfilter.info = TC_H_MAKE (TC_H_MAJ (plat_q->tfilter.info), TC_H_MIN (tfilter.info));
 
-			success &= (nm_platform_tfilter_add (self, NMP_NLM_FLAG_ADD,
-			                                     NMP_OBJECT_CAST_TFILTER (q)) >= 0);
+			success &= (nm_platform_tfilter_add (self, NMP_NLM_FLAG_REPLACE, &tfilter) >= 0);
 		}
 	}
 
@@ -6237,6 +8138,21 @@ _rtm_flags_to_string_full (char *buf, gsize buf_size, unsigned rtm_flags)
 	return buf0;
 }
 
+static const char *
+_ip_route_nexthops_to_string (const NMPlatformIPRoute *route, char *buf, gsize buf_size)
+{
+	if (route->n_nexthops > 1) {
+		g_snprintf (buf, buf_size,
+		            " weight %u n_nexthops %u",
+		            (unsigned) route->weight,
+		            (unsigned) route->n_nexthops);
+	} else if (route->weight)
+		g_snprintf (buf, buf_size, " weight %u", (unsigned) route->weight);
+	else
+		return "";
+	return buf;
+}
+
 /**
  * nm_platform_ip4_route_to_string:
  * @route: pointer to NMPlatformIP4Route route structure
@@ -6258,11 +8174,16 @@ nm_platform_ip4_route_to_string (const NMPlatformIP4Route *route, char *buf, gsi
 	char str_table[30];
 	char str_scope[30], s_source[50];
 	char str_tos[32], str_window[32], str_cwnd[32], str_initcwnd[32], str_initrwnd[32], str_mtu[32];
+	char str_nhid[32];
+	char str_nexthops[64];
 	char str_rtm_flags[_RTM_FLAGS_TO_STRING_MAXLEN];
+	const NMPlatformIPRouteMetrics *metrics;
 
 	if (!nm_utils_to_string_buffer_init_null (route, &buf, &len))
 		return buf;
 
+	metrics = nm_platform_ip_route_get_metrics (route);
+
 	inet_ntop (AF_INET, &route->network, s_network, sizeof(s_network));
 	inet_ntop (AF_INET, &route->gateway, s_gateway, sizeof(s_gateway));
 
@@ -6285,6 +8206,8 @@ nm_platform_ip4_route_to_string (const NMPlatformIP4Route *route, char *buf, gsi
 	            "%s" /* initcwnd */
 	            "%s" /* initrwnd */
 	            "%s" /* mtu */
+	            "%s" /* nhid */
+	            "%s" /* weight, n_nexthops */
 	            "",
 	            route->table_coerced ? nm_sprintf_buf (str_table, "table %u ", nm_platform_route_table_uncoerce (route->table_coerced, FALSE)) : "",
 	            s_network,
@@ -6300,11 +8223,13 @@ nm_platform_ip4_route_to_string (const NMPlatformIP4Route *route, char *buf, gsi
 	            route->pref_src ? " pref-src " : "",
 	            route->pref_src ? inet_ntop (AF_INET, &route->pref_src, s_pref_src, sizeof(s_pref_src)) : "",
 	            route->tos ? nm_sprintf_buf (str_tos, " tos 0x%x", (unsigned) route->tos) : "",
-	            route->window   || route->lock_window   ? nm_sprintf_buf (str_window,   " window %s%"G_GUINT32_FORMAT,   route->lock_window   ? "lock " : "", route->window)   : "",
-	            route->cwnd     || route->lock_cwnd     ? nm_sprintf_buf (str_cwnd,     " cwnd %s%"G_GUINT32_FORMAT,     route->lock_cwnd     ? "lock " : "", route->cwnd)     : "",
-	            route->initcwnd || route->lock_initcwnd ? nm_sprintf_buf (str_initcwnd, " initcwnd %s%"G_GUINT32_FORMAT, route->lock_initcwnd ? "lock " : "", route->initcwnd) : "",
-	            route->initrwnd || route->lock_initrwnd ? nm_sprintf_buf (str_initrwnd, " initrwnd %s%"G_GUINT32_FORMAT, route->lock_initrwnd ? "lock " : "", route->initrwnd) : "",
-	            route->mtu      || route->lock_mtu      ? nm_sprintf_buf (str_mtu,      " mtu %s%"G_GUINT32_FORMAT,      route->lock_mtu      ? "lock " : "", route->mtu)      : "");
+	            metrics->window   || metrics->lock_window   ? nm_sprintf_buf (str_window,   " window %s%"G_GUINT32_FORMAT,   metrics->lock_window   ? "lock " : "", metrics->window)   : "",
+	            metrics->cwnd     || metrics->lock_cwnd     ? nm_sprintf_buf (str_cwnd,     " cwnd %s%"G_GUINT32_FORMAT,     metrics->lock_cwnd     ? "lock " : "", metrics->cwnd)     : "",
+	            metrics->initcwnd || metrics->lock_initcwnd ? nm_sprintf_buf (str_initcwnd, " initcwnd %s%"G_GUINT32_FORMAT, metrics->lock_initcwnd ? "lock " : "", metrics->initcwnd) : "",
+	            metrics->initrwnd || metrics->lock_initrwnd ? nm_sprintf_buf (str_initrwnd, " initrwnd %s%"G_GUINT32_FORMAT, metrics->lock_initrwnd ? "lock " : "", metrics->initrwnd) : "",
+	            metrics->mtu      || metrics->lock_mtu      ? nm_sprintf_buf (str_mtu,      " mtu %s%"G_GUINT32_FORMAT,      metrics->lock_mtu      ? "lock " : "", metrics->mtu)      : "",
+	            route->nhid ? nm_sprintf_buf (str_nhid, " nhid %"G_GUINT32_FORMAT, route->nhid) : "",
+	            _ip_route_nexthops_to_string (NM_PLATFORM_IP_ROUTE_CAST (route), str_nexthops, sizeof (str_nexthops)));
 	return buf;
 }
 
@@ -6338,11 +8263,16 @@ nm_platform_ip6_route_to_string (const NMPlatformIP6Route *route, char *buf, gsi
 	char str_initcwnd[32];
 	char str_initrwnd[32];
 	char str_mtu[32];
+	char str_nhid[32];
+	char str_nexthops[64];
 	char str_rtm_flags[_RTM_FLAGS_TO_STRING_MAXLEN];
+	const NMPlatformIPRouteMetrics *metrics;
 
 	if (!nm_utils_to_string_buffer_init_null (route, &buf, &len))
 		return buf;
 
+	metrics = nm_platform_ip_route_get_metrics (route);
+
 	inet_ntop (AF_INET6, &route->network, s_network, sizeof (s_network));
 	inet_ntop (AF_INET6, &route->gateway, s_gateway, sizeof (s_gateway));
 
@@ -6370,6 +8300,8 @@ nm_platform_ip6_route_to_string (const NMPlatformIP6Route *route, char *buf, gsi
 	            "%s" /* initrwnd */
 	            "%s" /* mtu */
 	            "%s" /* pref */
+	            "%s" /* nhid */
+	            "%s" /* weight, n_nexthops */
 	            "",
 	            route->table_coerced ? nm_sprintf_buf (str_table, "table %u ", nm_platform_route_table_uncoerce (route->table_coerced, FALSE)) : "",
 	            s_network,
@@ -6385,12 +8317,14 @@ nm_platform_ip6_route_to_string (const NMPlatformIP6Route *route, char *buf, gsi
 	            _rtm_flags_to_string_full (str_rtm_flags, sizeof (str_rtm_flags), route->r_rtm_flags),
 	            s_pref_src[0] ? " pref-src " : "",
 	            s_pref_src[0] ? s_pref_src : "",
-	            route->window   || route->lock_window   ? nm_sprintf_buf (str_window,   " window %s%"G_GUINT32_FORMAT,   route->lock_window   ? "lock " : "", route->window)   : "",
-	            route->cwnd     || route->lock_cwnd     ? nm_sprintf_buf (str_cwnd,     " cwnd %s%"G_GUINT32_FORMAT,     route->lock_cwnd     ? "lock " : "", route->cwnd)     : "",
-	            route->initcwnd || route->lock_initcwnd ? nm_sprintf_buf (str_initcwnd, " initcwnd %s%"G_GUINT32_FORMAT, route->lock_initcwnd ? "lock " : "", route->initcwnd) : "",
-	            route->initrwnd || route->lock_initrwnd ? nm_sprintf_buf (str_initrwnd, " initrwnd %s%"G_GUINT32_FORMAT, route->lock_initrwnd ? "lock " : "", route->initrwnd) : "",
-	            route->mtu      || route->lock_mtu      ? nm_sprintf_buf (str_mtu,      " mtu %s%"G_GUINT32_FORMAT,      route->lock_mtu      ? "lock " : "", route->mtu)      : "",
-	            route->rt_pref ? nm_sprintf_buf (str_pref, " pref %s", nm_icmpv6_router_pref_to_string (route->rt_pref, str_pref2, sizeof (str_pref2))) : "");
+	            metrics->window   || metrics->lock_window   ? nm_sprintf_buf (str_window,   " window %s%"G_GUINT32_FORMAT,   metrics->lock_window   ? "lock " : "", metrics->window)   : "",
+	            metrics->cwnd     || metrics->lock_cwnd     ? nm_sprintf_buf (str_cwnd,     " cwnd %s%"G_GUINT32_FORMAT,     metrics->lock_cwnd     ? "lock " : "", metrics->cwnd)     : "",
+	            metrics->initcwnd || metrics->lock_initcwnd ? nm_sprintf_buf (str_initcwnd, " initcwnd %s%"G_GUINT32_FORMAT, metrics->lock_initcwnd ? "lock " : "", metrics->initcwnd) : "",
+	            metrics->initrwnd || metrics->lock_initrwnd ? nm_sprintf_buf (str_initrwnd, " initrwnd %s%"G_GUINT32_FORMAT, metrics->lock_initrwnd ? "lock " : "", metrics->initrwnd) : "",
+	            metrics->mtu      || metrics->lock_mtu      ? nm_sprintf_buf (str_mtu,      " mtu %s%"G_GUINT32_FORMAT,      metrics->lock_mtu      ? "lock " : "", metrics->mtu)      : "",
+	            route->rt_pref ? nm_sprintf_buf (str_pref, " pref %s", nm_icmpv6_router_pref_to_string (route->rt_pref, str_pref2, sizeof (str_pref2))) : "",
+	            route->nhid ? nm_sprintf_buf (str_nhid, " nhid %"G_GUINT32_FORMAT, route->nhid) : "",
+	            _ip_route_nexthops_to_string (NM_PLATFORM_IP_ROUTE_CAST (route), str_nexthops, sizeof (str_nexthops)));
 
 	return buf;
 }
@@ -6642,6 +8576,104 @@ nm_platform_routing_rule_to_string (const NMPlatformRoutingRule *routing_rule, c
 	return buf0;
 }
 
+const char *
+nm_platform_ip4_nexthop_to_string (const NMPlatformIP4Nexthop *nexthop, char *buf, gsize len)
+{
+	char s_gateway[INET_ADDRSTRLEN];
+	char str_dev[TO_STRING_DEV_BUF_SIZE];
+	char s_source[50];
+	char str_flags[30];
+
+	if (!nm_utils_to_string_buffer_init_null (nexthop, &buf, &len))
+		return buf;
+
+	g_snprintf (buf, len,
+	            "id %"G_GUINT32_FORMAT
+	            " via %s"
+	            "%s"
+	            " nh-src %s"
+	            "%s" /* nh_flags */
+	            "",
+	            nexthop->id,
+	            nm_utils_inet4_ntop (nexthop->gateway, s_gateway),
+	            _to_string_dev (NULL, nexthop->ifindex, str_dev, sizeof (str_dev)),
+	            nmp_utils_ip_config_source_to_string (nexthop->nh_source, s_source, sizeof (s_source)),
+	            nexthop->nh_flags ? nm_sprintf_buf (str_flags, " nh-flags 0x%x", nexthop->nh_flags) : "");
+	return buf;
+}
+
+const char *
+nm_platform_ip6_nexthop_to_string (const NMPlatformIP6Nexthop *nexthop, char *buf, gsize len)
+{
+	char s_gateway[INET6_ADDRSTRLEN];
+	char str_dev[TO_STRING_DEV_BUF_SIZE];
+	char s_source[50];
+	char str_flags[30];
+
+	if (!nm_utils_to_string_buffer_init_null (nexthop, &buf, &len))
+		return buf;
+
+	g_snprintf (buf, len,
+	            "id %"G_GUINT32_FORMAT
+	            " via %s"
+	            "%s"
+	            " nh-src %s"
+	            "%s" /* nh_flags */
+	            "",
+	            nexthop->id,
+	            nm_utils_inet6_ntop (&nexthop->gateway, s_gateway),
+	            _to_string_dev (NULL, nexthop->ifindex, str_dev, sizeof (str_dev)),
+	            nmp_utils_ip_config_source_to_string (nexthop->nh_source, s_source, sizeof (s_source)),
+	            nexthop->nh_flags ? nm_sprintf_buf (str_flags, " nh-flags 0x%x", nexthop->nh_flags) : "");
+	return buf;
+}
+
+void
+nm_platform_ip4_nexthop_hash_update (const NMPlatformIP4Nexthop *obj, NMHashState *h)
+{
+	nm_hash_update_vals (h,
+	                     obj->id,
+	                     obj->ifindex,
+	                     obj->gateway,
+	                     obj->nh_source,
+	                     obj->nh_flags);
+}
+
+void
+nm_platform_ip6_nexthop_hash_update (const NMPlatformIP6Nexthop *obj, NMHashState *h)
+{
+	nm_hash_update_vals (h,
+	                     obj->id,
+	                     obj->ifindex,
+	                     obj->gateway,
+	                     obj->nh_source,
+	                     obj->nh_flags);
+}
+
+int
+nm_platform_ip4_nexthop_cmp (const NMPlatformIP4Nexthop *a, const NMPlatformIP4Nexthop *b)
+{
+	NM_CMP_SELF (a, b);
+	NM_CMP_FIELD (a, b, id);
+	NM_CMP_FIELD (a, b, ifindex);
+	NM_CMP_FIELD (a, b, gateway);
+	NM_CMP_FIELD (a, b, nh_source);
+	NM_CMP_FIELD (a, b, nh_flags);
+	return 0;
+}
+
+int
+nm_platform_ip6_nexthop_cmp (const NMPlatformIP6Nexthop *a, const NMPlatformIP6Nexthop *b)
+{
+	NM_CMP_SELF (a, b);
+	NM_CMP_FIELD (a, b, id);
+	NM_CMP_FIELD (a, b, ifindex);
+	NM_CMP_FIELD_IN6ADDR (a, b, gateway);
+	NM_CMP_FIELD (a, b, nh_source);
+	NM_CMP_FIELD (a, b, nh_flags);
+	return 0;
+}
+
 const char *
 nm_platform_qdisc_to_string (const NMPlatformQdisc *qdisc, char *buf, gsize len)
 {
@@ -7384,50 +9416,35 @@ nm_platform_ip4_route_hash_update (const NMPlatformIP4Route *obj, NMPlatformIPRo
 		                     obj->metric,
 		                     obj->tos,
 		                     /* on top of WEAK_ID: */
-		                     obj->ifindex,
+		                     _ip_route_ifindex_normalize (NM_PLATFORM_IP_ROUTE_CAST (obj)),
 		                     nmp_utils_ip_config_source_round_trip_rtprot (obj->rt_source),
 		                     _ip_route_scope_inv_get_normalized (obj),
-		                     obj->gateway,
+		                     obj->nhid ? 0u : obj->gateway,
+		                     obj->nhid,
 		                     obj->mss,
 		                     obj->pref_src,
-		                     obj->window,
-		                     obj->cwnd,
-		                     obj->initcwnd,
-		                     obj->initrwnd,
-		                     obj->mtu,
 		                     obj->r_rtm_flags & RTNH_F_ONLINK,
-		                     NM_HASH_COMBINE_BOOLS (guint8,
-		                                            obj->lock_window,
-		                                            obj->lock_cwnd,
-		                                            obj->lock_initcwnd,
-		                                            obj->lock_initrwnd,
-		                                            obj->lock_mtu));
+		                     _ip_route_metrics_hash (obj->metrics));
 		break;
 	case NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY:
 		nm_hash_update_vals (h,
 		                     nm_platform_route_table_uncoerce (obj->table_coerced, TRUE),
-		                     obj->ifindex,
+		                     _ip_route_ifindex_normalize (NM_PLATFORM_IP_ROUTE_CAST (obj)),
 		                     nm_utils_ip4_address_clear_host_address (obj->network, obj->plen),
 		                     obj->plen,
 		                     obj->metric,
-		                     obj->gateway,
+		                     obj->nhid ? 0u : obj->gateway,
 		                     nmp_utils_ip_config_source_round_trip_rtprot (obj->rt_source),
 		                     _ip_route_scope_inv_get_normalized (obj),
 		                     obj->tos,
 		                     obj->mss,
 		                     obj->pref_src,
-		                     obj->window,
-		                     obj->cwnd,
-		                     obj->initcwnd,
-		                     obj->initrwnd,
-		                     obj->mtu,
+		                     obj->nhid,
 		                     obj->r_rtm_flags & (RTM_F_CLONED | RTNH_F_ONLINK),
-		                     NM_HASH_COMBINE_BOOLS (guint8,
-		                                            obj->lock_window,
-		                                            obj->lock_cwnd,
-		                                            obj->lock_initcwnd,
-		                                            obj->lock_initrwnd,
-		                                            obj->lock_mtu));
+		                     _ip_route_metrics_hash (obj->metrics));
+		nm_hash_update_vals (h,
+		                     _ip_route_n_nexthops_normalize (NM_PLATFORM_IP_ROUTE_CAST (obj)),
+		                     _ip_route_weight_normalize (NM_PLATFORM_IP_ROUTE_CAST (obj)));
 		break;
 	case NM_PLATFORM_IP_ROUTE_CMP_TYPE_FULL:
 		nm_hash_update_vals (h,
@@ -7442,18 +9459,12 @@ nm_platform_ip4_route_hash_update (const NMPlatformIP4Route *obj, NMPlatformIPRo
 		                     obj->tos,
 		                     obj->mss,
 		                     obj->pref_src,
-		                     obj->window,
-		                     obj->cwnd,
-		                     obj->initcwnd,
-		                     obj->initrwnd,
-		                     obj->mtu,
+		                     obj->nhid,
 		                     obj->r_rtm_flags,
-		                     NM_HASH_COMBINE_BOOLS (guint8,
-		                                            obj->lock_window,
-		                                            obj->lock_cwnd,
-		                                            obj->lock_initcwnd,
-		                                            obj->lock_initrwnd,
-		                                            obj->lock_mtu));
+		                     _ip_route_metrics_hash (obj->metrics));
+		nm_hash_update_vals (h,
+		                     obj->n_nexthops,
+		                     obj->weight);
 		break;
 	}
 }
@@ -7472,26 +9483,20 @@ nm_platform_ip4_route_cmp (const NMPlatformIP4Route *a, const NMPlatformIP4Route
 		NM_CMP_FIELD (a, b, metric);
 		NM_CMP_FIELD (a, b, tos);
 		if (cmp_type == NM_PLATFORM_IP_ROUTE_CMP_TYPE_ID) {
-			NM_CMP_FIELD (a, b, ifindex);
+			NM_CMP_FIELD (a, b, nhid);
+			NM_CMP_DIRECT (_ip_route_ifindex_normalize (NM_PLATFORM_IP_ROUTE_CAST (a)),
+			               _ip_route_ifindex_normalize (NM_PLATFORM_IP_ROUTE_CAST (b)));
 			NM_CMP_DIRECT (nmp_utils_ip_config_source_round_trip_rtprot (a->rt_source),
 			               nmp_utils_ip_config_source_round_trip_rtprot (b->rt_source));
 			NM_CMP_DIRECT (_ip_route_scope_inv_get_normalized (a),
 			               _ip_route_scope_inv_get_normalized (b));
-			NM_CMP_FIELD (a, b, gateway);
+			if (!a->nhid)
+				NM_CMP_FIELD (a, b, gateway);
 			NM_CMP_FIELD (a, b, mss);
 			NM_CMP_FIELD (a, b, pref_src);
-			NM_CMP_FIELD (a, b, window);
-			NM_CMP_FIELD (a, b, cwnd);
-			NM_CMP_FIELD (a, b, initcwnd);
-			NM_CMP_FIELD (a, b, initrwnd);
-			NM_CMP_FIELD (a, b, mtu);
 			NM_CMP_DIRECT (a->r_rtm_flags & RTNH_F_ONLINK,
 			               b->r_rtm_flags & RTNH_F_ONLINK);
-			NM_CMP_FIELD_UNSAFE (a, b, lock_window);
-			NM_CMP_FIELD_UNSAFE (a, b, lock_cwnd);
-			NM_CMP_FIELD_UNSAFE (a, b, lock_initcwnd);
-			NM_CMP_FIELD_UNSAFE (a, b, lock_initrwnd);
-			NM_CMP_FIELD_UNSAFE (a, b, lock_mtu);
+			NM_CMP_RETURN (_ip_route_metrics_cmp (a->metrics, b->metrics));
 		}
 		break;
 	case NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY:
@@ -7501,14 +9506,21 @@ nm_platform_ip4_route_cmp (const NMPlatformIP4Route *a, const NMPlatformIP4Route
 			               nm_platform_route_table_uncoerce (b->table_coerced, TRUE));
 		} else
 			NM_CMP_FIELD (a, b, table_coerced);
-		NM_CMP_FIELD (a, b, ifindex);
+		if (cmp_type == NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY) {
+			NM_CMP_FIELD (a, b, nhid);
+			NM_CMP_DIRECT (_ip_route_ifindex_normalize (NM_PLATFORM_IP_ROUTE_CAST (a)),
+			               _ip_route_ifindex_normalize (NM_PLATFORM_IP_ROUTE_CAST (b)));
+		} else
+			NM_CMP_FIELD (a, b, ifindex);
 		if (cmp_type == NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY)
 			NM_CMP_DIRECT_IN4ADDR_SAME_PREFIX (a->network, b->network, MIN (a->plen, b->plen));
 		else
 			NM_CMP_FIELD (a, b, network);
 		NM_CMP_FIELD (a, b, plen);
 		NM_CMP_FIELD (a, b, metric);
-		NM_CMP_FIELD (a, b, gateway);
+		if (   cmp_type != NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY
+		    || !a->nhid)
+			NM_CMP_FIELD (a, b, gateway);
 		if (cmp_type == NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY) {
 			NM_CMP_DIRECT (nmp_utils_ip_config_source_round_trip_rtprot (a->rt_source),
 			               nmp_utils_ip_config_source_round_trip_rtprot (b->rt_source));
@@ -7526,16 +9538,17 @@ nm_platform_ip4_route_cmp (const NMPlatformIP4Route *a, const NMPlatformIP4Route
 		} else
 			NM_CMP_FIELD (a, b, r_rtm_flags);
 		NM_CMP_FIELD (a, b, tos);
-		NM_CMP_FIELD_UNSAFE (a, b, lock_window);
-		NM_CMP_FIELD_UNSAFE (a, b, lock_cwnd);
-		NM_CMP_FIELD_UNSAFE (a, b, lock_initcwnd);
-		NM_CMP_FIELD_UNSAFE (a, b, lock_initrwnd);
-		NM_CMP_FIELD_UNSAFE (a, b, lock_mtu);
-		NM_CMP_FIELD (a, b, window);
-		NM_CMP_FIELD (a, b, cwnd);
-		NM_CMP_FIELD (a, b, initcwnd);
-		NM_CMP_FIELD (a, b, initrwnd);
-		NM_CMP_FIELD (a, b, mtu);
+		NM_CMP_RETURN (_ip_route_metrics_cmp (a->metrics, b->metrics));
+		NM_CMP_FIELD (a, b, nhid);
+		if (cmp_type == NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY) {
+			NM_CMP_DIRECT (_ip_route_n_nexthops_normalize (NM_PLATFORM_IP_ROUTE_CAST (a)),
+			               _ip_route_n_nexthops_normalize (NM_PLATFORM_IP_ROUTE_CAST (b)));
+			NM_CMP_DIRECT (_ip_route_weight_normalize (NM_PLATFORM_IP_ROUTE_CAST (a)),
+			               _ip_route_weight_normalize (NM_PLATFORM_IP_ROUTE_CAST (b)));
+		} else {
+			NM_CMP_FIELD (a, b, n_nexthops);
+			NM_CMP_FIELD (a, b, weight);
+		}
 		break;
 	}
 	return 0;
@@ -7565,35 +9578,30 @@ nm_platform_ip6_route_hash_update (const NMPlatformIP6Route *obj, NMPlatformIPRo
 		                     *nm_utils_ip6_address_clear_host_address (&a2, &obj->src, obj->src_plen),
 		                     obj->src_plen,
 		                     /* on top of WEAK_ID: */
-		                     obj->ifindex,
-		                     obj->gateway);
+		                     _ip_route_ifindex_normalize (NM_PLATFORM_IP_ROUTE_CAST (obj)),
+		                     obj->nhid ? in6addr_any : obj->gateway,
+		                     obj->nhid);
 		break;
 	case NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY:
 		nm_hash_update_vals (h,
 		                     nm_platform_route_table_uncoerce (obj->table_coerced, TRUE),
-		                     obj->ifindex,
+		                     _ip_route_ifindex_normalize (NM_PLATFORM_IP_ROUTE_CAST (obj)),
 		                     *nm_utils_ip6_address_clear_host_address (&a1, &obj->network, obj->plen),
 		                     obj->plen,
 		                     nm_utils_ip6_route_metric_normalize (obj->metric),
-		                     obj->gateway,
+		                     obj->nhid ? in6addr_any : obj->gateway,
 		                     obj->pref_src,
 		                     *nm_utils_ip6_address_clear_host_address (&a2, &obj->src, obj->src_plen),
 		                     obj->src_plen,
 		                     nmp_utils_ip_config_source_round_trip_rtprot (obj->rt_source),
 		                     obj->mss,
 		                     obj->r_rtm_flags & RTM_F_CLONED,
-		                     NM_HASH_COMBINE_BOOLS (guint8,
-		                                            obj->lock_window,
-		                                            obj->lock_cwnd,
-		                                            obj->lock_initcwnd,
-		                                            obj->lock_initrwnd,
-		                                            obj->lock_mtu),
-		                     obj->window,
-		                     obj->cwnd,
-		                     obj->initcwnd,
-		                     obj->initrwnd,
-		                     obj->mtu,
+		                     _ip_route_metrics_hash (obj->metrics),
+		                     obj->nhid,
 		                     _route_pref_normalize (obj->rt_pref));
+		nm_hash_update_vals (h,
+		                     _ip_route_n_nexthops_normalize (NM_PLATFORM_IP_ROUTE_CAST (obj)),
+		                     _ip_route_weight_normalize (NM_PLATFORM_IP_ROUTE_CAST (obj)));
 		break;
 	case NM_PLATFORM_IP_ROUTE_CMP_TYPE_FULL:
 		nm_hash_update_vals (h,
@@ -7609,18 +9617,12 @@ nm_platform_ip6_route_hash_update (const NMPlatformIP6Route *obj, NMPlatformIPRo
 		                     obj->rt_source,
 		                     obj->mss,
 		                     obj->r_rtm_flags,
-		                     NM_HASH_COMBINE_BOOLS (guint8,
-		                                            obj->lock_window,
-		                                            obj->lock_cwnd,
-		                                            obj->lock_initcwnd,
-		                                            obj->lock_initrwnd,
-		                                            obj->lock_mtu),
-		                     obj->window,
-		                     obj->cwnd,
-		                     obj->initcwnd,
-		                     obj->initrwnd,
-		                     obj->mtu,
+		                     _ip_route_metrics_hash (obj->metrics),
+		                     obj->nhid,
 		                     obj->rt_pref);
+		nm_hash_update_vals (h,
+		                     obj->n_nexthops,
+		                     obj->weight);
 		break;
 	}
 }
@@ -7640,8 +9642,11 @@ nm_platform_ip6_route_cmp (const NMPlatformIP6Route *a, const NMPlatformIP6Route
 		NM_CMP_DIRECT_IN6ADDR_SAME_PREFIX (&a->src, &b->src, MIN (a->src_plen, b->src_plen));
 		NM_CMP_FIELD (a, b, src_plen);
 		if (cmp_type == NM_PLATFORM_IP_ROUTE_CMP_TYPE_ID) {
-			NM_CMP_FIELD (a, b, ifindex);
-			NM_CMP_FIELD_IN6ADDR (a, b, gateway);
+			NM_CMP_FIELD (a, b, nhid);
+			NM_CMP_DIRECT (_ip_route_ifindex_normalize (NM_PLATFORM_IP_ROUTE_CAST (a)),
+			               _ip_route_ifindex_normalize (NM_PLATFORM_IP_ROUTE_CAST (b)));
+			if (!a->nhid)
+				NM_CMP_FIELD_IN6ADDR (a, b, gateway);
 		}
 		break;
 	case NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY:
@@ -7651,7 +9656,12 @@ nm_platform_ip6_route_cmp (const NMPlatformIP6Route *a, const NMPlatformIP6Route
 			               nm_platform_route_table_uncoerce (b->table_coerced, TRUE));
 		} else
 			NM_CMP_FIELD (a, b, table_coerced);
-		NM_CMP_FIELD (a, b, ifindex);
+		if (cmp_type == NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY) {
+			NM_CMP_FIELD (a, b, nhid);
+			NM_CMP_DIRECT (_ip_route_ifindex_normalize (NM_PLATFORM_IP_ROUTE_CAST (a)),
+			               _ip_route_ifindex_normalize (NM_PLATFORM_IP_ROUTE_CAST (b)));
+		} else
+			NM_CMP_FIELD (a, b, ifindex);
 		if (cmp_type == NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY)
 			NM_CMP_DIRECT_IN6ADDR_SAME_PREFIX (&a->network, &b->network, MIN (a->plen, b->plen));
 		else
@@ -7661,7 +9671,9 @@ nm_platform_ip6_route_cmp (const NMPlatformIP6Route *a, const NMPlatformIP6Route
 			NM_CMP_DIRECT (nm_utils_ip6_route_metric_normalize (a->metric), nm_utils_ip6_route_metric_normalize (b->metric));
 		else
 			NM_CMP_FIELD (a, b, metric);
-		NM_CMP_FIELD_IN6ADDR (a, b, gateway);
+		if (   cmp_type != NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY
+		    || !a->nhid)
+			NM_CMP_FIELD_IN6ADDR (a, b, gateway);
 		NM_CMP_FIELD_IN6ADDR (a, b, pref_src);
 		if (cmp_type == NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY) {
 			NM_CMP_DIRECT_IN6ADDR_SAME_PREFIX (&a->src, &b->src, MIN (a->src_plen, b->src_plen));
@@ -7679,20 +9691,19 @@ nm_platform_ip6_route_cmp (const NMPlatformIP6Route *a, const NMPlatformIP6Route
 			               b->r_rtm_flags & RTM_F_CLONED);
 		} else
 			NM_CMP_FIELD (a, b, r_rtm_flags);
-		NM_CMP_FIELD_UNSAFE (a, b, lock_window);
-		NM_CMP_FIELD_UNSAFE (a, b, lock_cwnd);
-		NM_CMP_FIELD_UNSAFE (a, b, lock_initcwnd);
-		NM_CMP_FIELD_UNSAFE (a, b, lock_initrwnd);
-		NM_CMP_FIELD_UNSAFE (a, b, lock_mtu);
-		NM_CMP_FIELD (a, b, window);
-		NM_CMP_FIELD (a, b, cwnd);
-		NM_CMP_FIELD (a, b, initcwnd);
-		NM_CMP_FIELD (a, b, initrwnd);
-		NM_CMP_FIELD (a, b, mtu);
-		if (cmp_type == NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY)
+		NM_CMP_RETURN (_ip_route_metrics_cmp (a->metrics, b->metrics));
+		NM_CMP_FIELD (a, b, nhid);
+		if (cmp_type == NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY) {
 			NM_CMP_DIRECT (_route_pref_normalize (a->rt_pref), _route_pref_normalize (b->rt_pref));
-		else
+			NM_CMP_DIRECT (_ip_route_n_nexthops_normalize (NM_PLATFORM_IP_ROUTE_CAST (a)),
+			               _ip_route_n_nexthops_normalize (NM_PLATFORM_IP_ROUTE_CAST (b)));
+			NM_CMP_DIRECT (_ip_route_weight_normalize (NM_PLATFORM_IP_ROUTE_CAST (a)),
+			               _ip_route_weight_normalize (NM_PLATFORM_IP_ROUTE_CAST (b)));
+		} else {
 			NM_CMP_FIELD (a, b, rt_pref);
+			NM_CMP_FIELD (a, b, n_nexthops);
+			NM_CMP_FIELD (a, b, weight);
+		}
 		break;
 	}
 	return 0;
@@ -8004,6 +10015,18 @@ log_ip6_route (NMPlatform *self, NMPObjectType obj_type, int ifindex, NMPlatform
 	_LOG3D ("signal: route   6 %7s: %s", nm_platform_signal_change_type_to_string (change_type), nm_platform_ip6_route_to_string (route, NULL, 0));
 }
 
+static void
+log_ip4_nexthop (NMPlatform *self, NMPObjectType obj_type, int ifindex, NMPlatformIP4Nexthop *nexthop, NMPlatformSignalChangeType change_type, gpointer user_data)
+{
+	_LOG3D ("signal: nexthop 4 %7s: %s", nm_platform_signal_change_type_to_string (change_type), nm_platform_ip4_nexthop_to_string (nexthop, NULL, 0));
+}
+
+static void
+log_ip6_nexthop (NMPlatform *self, NMPObjectType obj_type, int ifindex, NMPlatformIP6Nexthop *nexthop, NMPlatformSignalChangeType change_type, gpointer user_data)
+{
+	_LOG3D ("signal: nexthop 6 %7s: %s", nm_platform_signal_change_type_to_string (change_type), nm_platform_ip6_nexthop_to_string (nexthop, NULL, 0));
+}
+
 static void
 log_routing_rule (NMPlatform *self, NMPObjectType obj_type, int ifindex, NMPlatformRoutingRule *routing_rule, NMPlatformSignalChangeType change_type, gpointer user_data)
 {
@@ -8025,6 +10048,268 @@ log_tfilter (NMPlatform *self, NMPObjectType obj_type, int ifindex, NMPlatformTf
 
 /*****************************************************************************/
 
+typedef struct {
+	guint id;
+	NMPObjectType obj_type;
+	NMPlatformChangeBatchCallback callback;
+	gpointer user_data;
+} ChangeBatchSubscription;
+
+typedef struct {
+	/* the key in the hash table. Only its ID matters. */
+	const NMPObject *obj_id;
+	const NMPObject *obj_old;
+	const NMPObject *obj_new;
+} ChangeBatchEntry;
+
+static void
+_change_batch_entry_free (gpointer data)
+{
+	ChangeBatchEntry *entry = data;
+
+	nmp_object_unref (entry->obj_id);
+	nmp_object_unref (entry->obj_old);
+	nmp_object_unref (entry->obj_new);
+	g_slice_free (ChangeBatchEntry, entry);
+}
+
+static void
+_change_batch_dispatch_type (NMPlatform *self,
+                             NMPObjectType obj_type,
+                             GHashTable *pending)
+{
+	NMPlatformPrivate *priv = NM_PLATFORM_GET_PRIVATE (self);
+	gs_free NMPlatformChange *changes = NULL;
+	GHashTableIter iter;
+	ChangeBatchEntry *entry;
+	guint n_changes = 0;
+	guint n_subscriptions;
+	guint i;
+
+	changes = g_new (NMPlatformChange, g_hash_table_size (pending));
+
+	g_hash_table_iter_init (&iter, pending);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry)) {
+		NMPlatformSignalChangeType change_type;
+
+		if (entry->obj_old && entry->obj_new) {
+			if (nmp_object_equal (entry->obj_old, entry->obj_new)) {
+				/* changed and changed back. */
+				continue;
+			}
+			change_type = NM_PLATFORM_SIGNAL_CHANGED;
+		} else if (entry->obj_new)
+			change_type = NM_PLATFORM_SIGNAL_ADDED;
+		else if (entry->obj_old)
+			change_type = NM_PLATFORM_SIGNAL_REMOVED;
+		else {
+			/* added and removed again. */
+			continue;
+		}
+
+		changes[n_changes++] = (NMPlatformChange) {
+			.obj_old     = entry->obj_old,
+			.obj_new     = entry->obj_new,
+			.change_type = change_type,
+		};
+	}
+
+	if (n_changes == 0)
+		return;
+
+	_LOGt ("change-batch: deliver %u changes of %u %s objects",
+	       n_changes,
+	       g_hash_table_size (pending),
+	       nmp_class_from_type (obj_type)->obj_type_name);
+
+	/* subscriptions added by a callback only get the next batch. */
+	n_subscriptions = priv->change_batch.subscriptions->len;
+	for (i = 0; i < n_subscriptions; i++) {
+		const ChangeBatchSubscription *sub = &g_array_index (priv->change_batch.subscriptions, ChangeBatchSubscription, i);
+
+		if (   sub->obj_type == obj_type
+		    && sub->callback)
+			sub->callback (self, obj_type, changes, n_changes, sub->user_data);
+	}
+}
+
+static gboolean
+_change_batch_dispatch_cb (gpointer user_data)
+{
+	NMPlatform *self = user_data;
+	NMPlatformPrivate *priv = NM_PLATFORM_GET_PRIVATE (self);
+	nm_auto_pop_netns NMPNetns *netns = NULL;
+	NMPObjectType obj_type;
+	guint i;
+
+	priv->change_batch.idle_id = 0;
+
+	if (!nm_platform_netns_push (self, &netns)) {
+		for (obj_type = 1; obj_type <= NMP_OBJECT_TYPE_MAX; obj_type++)
+			nm_clear_pointer (&priv->change_batch.pending[obj_type], g_hash_table_unref);
+		return G_SOURCE_REMOVE;
+	}
+
+	g_object_ref (self);
+	priv->change_batch.is_dispatching++;
+
+	for (obj_type = 1; obj_type <= NMP_OBJECT_TYPE_MAX; obj_type++) {
+		gs_unref_hashtable GHashTable *pending = NULL;
+
+		/* changes made by the callbacks go to the next batch. */
+		pending = g_steal_pointer (&priv->change_batch.pending[obj_type]);
+		if (pending)
+			_change_batch_dispatch_type (self, obj_type, pending);
+	}
+
+	if (--priv->change_batch.is_dispatching == 0) {
+		/* drop the subscriptions that were cancelled during dispatch. */
+		for (i = priv->change_batch.subscriptions->len; i > 0; i--) {
+			if (!g_array_index (priv->change_batch.subscriptions, ChangeBatchSubscription, i - 1).callback)
+				g_array_remove_index (priv->change_batch.subscriptions, i - 1);
+		}
+	}
+
+	g_object_unref (self);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+_change_batch_record (NMPlatform *self,
+                      NMPObjectType obj_type,
+                      const NMPObject *obj_old,
+                      const NMPObject *obj_new)
+{
+	NMPlatformPrivate *priv = NM_PLATFORM_GET_PRIVATE (self);
+	GHashTable *pending;
+	ChangeBatchEntry *entry;
+
+	nm_assert (obj_old || obj_new);
+
+	pending = priv->change_batch.pending[obj_type];
+	if (!pending) {
+		pending = g_hash_table_new_full ((GHashFunc) nmp_object_id_hash,
+		                                 (GEqualFunc) nmp_object_id_equal,
+		                                 NULL,
+		                                 _change_batch_entry_free);
+		priv->change_batch.pending[obj_type] = pending;
+	}
+
+	entry = g_hash_table_lookup (pending, obj_old ?: obj_new);
+	if (entry) {
+		/* keep the state before the first change, and only update the
+		 * new state. */
+		nmp_object_ref (obj_new);
+		nmp_object_unref (entry->obj_new);
+		entry->obj_new = obj_new;
+	} else {
+		entry = g_slice_new (ChangeBatchEntry);
+		*entry = (ChangeBatchEntry) {
+			.obj_id  = nmp_object_ref (obj_old ?: obj_new),
+			.obj_old = nmp_object_ref (obj_old),
+			.obj_new = nmp_object_ref (obj_new),
+		};
+		g_hash_table_insert (pending, (gpointer) entry->obj_id, entry);
+	}
+
+	if (!priv->change_batch.idle_id)
+		priv->change_batch.idle_id = g_idle_add (_change_batch_dispatch_cb, self);
+}
+
+/**
+ * nm_platform_change_batch_subscribe:
+ * @self: the #NMPlatform instance
+ * @obj_type: the type of objects to get notified about
+ * @callback: the callback that receives the changes
+ * @user_data: the user data for @callback
+ *
+ * Subscribe to batched notifications about the changes to objects of type
+ * @obj_type. Unlike the change signals, which are emitted for each change
+ * right away, the changes are collected and delivered once per main loop
+ * iteration. Each object is contained only once per batch, with the state
+ * before its first change and after its last change. Objects that were added
+ * and removed again within the batch are not reported at all.
+ *
+ * The objects in the batch are only valid during the callback. Take a
+ * reference to keep them.
+ *
+ * Returns: the subscription ID for nm_platform_change_batch_unsubscribe().
+ */
+guint
+nm_platform_change_batch_subscribe (NMPlatform *self,
+                                    NMPObjectType obj_type,
+                                    NMPlatformChangeBatchCallback callback,
+                                    gpointer user_data)
+{
+	NMPlatformPrivate *priv;
+	ChangeBatchSubscription *sub;
+
+	_CHECK_SELF (self, klass, 0);
+
+	g_return_val_if_fail (obj_type > NMP_OBJECT_TYPE_UNKNOWN && obj_type <= NMP_OBJECT_TYPE_MAX, 0);
+	g_return_val_if_fail (callback, 0);
+
+	priv = NM_PLATFORM_GET_PRIVATE (self);
+
+	if (!priv->change_batch.subscriptions)
+		priv->change_batch.subscriptions = g_array_new (FALSE, FALSE, sizeof (ChangeBatchSubscription));
+
+	g_array_set_size (priv->change_batch.subscriptions, priv->change_batch.subscriptions->len + 1);
+	sub = &g_array_index (priv->change_batch.subscriptions, ChangeBatchSubscription, priv->change_batch.subscriptions->len - 1);
+	*sub = (ChangeBatchSubscription) {
+		.id        = ++priv->change_batch.subscription_id_last ?: ++priv->change_batch.subscription_id_last,
+		.obj_type  = obj_type,
+		.callback  = callback,
+		.user_data = user_data,
+	};
+	priv->change_batch.n_subscriptions[obj_type]++;
+	return sub->id;
+}
+
+/**
+ * nm_platform_change_batch_unsubscribe:
+ * @self: the #NMPlatform instance
+ * @subscription_id: the ID from nm_platform_change_batch_subscribe()
+ *
+ * Cancel a subscription. The callback will not be invoked anymore,
+ * even if it is called during the dispatch of a batch.
+ */
+void
+nm_platform_change_batch_unsubscribe (NMPlatform *self,
+                                      guint subscription_id)
+{
+	NMPlatformPrivate *priv;
+	guint i;
+
+	_CHECK_SELF_VOID (self, klass);
+
+	g_return_if_fail (subscription_id);
+
+	priv = NM_PLATFORM_GET_PRIVATE (self);
+
+	for (i = 0; priv->change_batch.subscriptions && i < priv->change_batch.subscriptions->len; i++) {
+		ChangeBatchSubscription *sub = &g_array_index (priv->change_batch.subscriptions, ChangeBatchSubscription, i);
+
+		if (   sub->id != subscription_id
+		    || !sub->callback)
+			continue;
+
+		nm_assert (priv->change_batch.n_subscriptions[sub->obj_type] > 0);
+		if (--priv->change_batch.n_subscriptions[sub->obj_type] == 0)
+			nm_clear_pointer (&priv->change_batch.pending[sub->obj_type], g_hash_table_unref);
+
+		if (priv->change_batch.is_dispatching)
+			sub->callback = NULL;
+		else
+			g_array_remove_index (priv->change_batch.subscriptions, i);
+		return;
+	}
+
+	g_return_if_reached ();
+}
+
+/*****************************************************************************/
+
 void
 nm_platform_cache_update_emit_signal (NMPlatform *self,
                                       NMPCacheOpsType cache_op,
@@ -8089,6 +10374,22 @@ nm_platform_cache_update_emit_signal (NMPlatform *self,
 	    && NM_IN_SET (cache_op, NMP_CACHE_OPS_ADDED, NMP_CACHE_OPS_UPDATED))
 		_ip4_dev_route_blacklist_notify_route (self, o);
 
+	if (NM_IN_SET (klass->obj_type, NMP_OBJECT_TYPE_IP4_ROUTE,
+	                                NMP_OBJECT_TYPE_IP6_ROUTE)) {
+		/* the ifindex is part of the route's ID, so an update never moves
+		 * a route to another interface. */
+		_ip_route_serial_bump (self, klass->addr_family, ifindex);
+	} else if (   klass->obj_type == NMP_OBJECT_TYPE_LINK
+	           && cache_op == NMP_CACHE_OPS_REMOVED)
+		_ip_route_serial_clear (self, ifindex);
+
+	if (NM_PLATFORM_GET_PRIVATE (self)->change_batch.n_subscriptions[klass->obj_type] > 0) {
+		_change_batch_record (self,
+		                      klass->obj_type,
+		                      cache_op == NMP_CACHE_OPS_ADDED ? NULL : obj_old,
+		                      cache_op == NMP_CACHE_OPS_REMOVED ? NULL : obj_new);
+	}
+
 	_LOG3t ("emit signal %s %s: %s",
 	        klass->signal_type,
 	        nm_platform_signal_change_type_to_string ((NMPlatformSignalChangeType) cache_op),
@@ -8227,6 +10528,10 @@ constructor (GType type,
 	priv->cache = nmp_cache_new (priv->multi_idx,
 	                             priv->use_udev);
 
+	/* the subclass applies the policy in its constructed(). */
+	if (_route_ignore_default)
+		_route_ignore_copy (&priv->route_ignore, _route_ignore_default);
+
 	return object;
 }
 
@@ -8235,6 +10540,7 @@ finalize (GObject *object)
 {
 	NMPlatform *self = NM_PLATFORM (object);
 	NMPlatformPrivate *priv = NM_PLATFORM_GET_PRIVATE (self);
+	guint i;
 
 	nm_clear_g_source (&priv->ip4_dev_route_blacklist_check_id);
 	nm_clear_g_source (&priv->ip4_dev_route_blacklist_gc_timeout_id);
@@ -8242,6 +10548,14 @@ finalize (GObject *object)
 	g_clear_object (&self->_netns);
 	nm_dedup_multi_index_unref (priv->multi_idx);
 	nmp_cache_free (priv->cache);
+	g_free (priv->route_ignore.tables);
+	nm_clear_pointer (&priv->ip_route_serials[0], g_hash_table_unref);
+	nm_clear_pointer (&priv->ip_route_serials[1], g_hash_table_unref);
+
+	nm_clear_g_source (&priv->change_batch.idle_id);
+	for (i = 1; i <= NMP_OBJECT_TYPE_MAX; i++)
+		nm_clear_pointer (&priv->change_batch.pending[i], g_hash_table_unref);
+	nm_clear_pointer (&priv->change_batch.subscriptions, g_array_unref);
 }
 
 static void
@@ -8303,6 +10617,8 @@ nm_platform_class_init (NMPlatformClass *platform_class)
 	SIGNAL (NM_PLATFORM_SIGNAL_ID_IP6_ADDRESS,  NM_PLATFORM_SIGNAL_IP6_ADDRESS_CHANGED,  log_ip6_address);
 	SIGNAL (NM_PLATFORM_SIGNAL_ID_IP4_ROUTE,    NM_PLATFORM_SIGNAL_IP4_ROUTE_CHANGED,    log_ip4_route);
 	SIGNAL (NM_PLATFORM_SIGNAL_ID_IP6_ROUTE,    NM_PLATFORM_SIGNAL_IP6_ROUTE_CHANGED,    log_ip6_route);
+	SIGNAL (NM_PLATFORM_SIGNAL_ID_IP4_NEXTHOP,  NM_PLATFORM_SIGNAL_IP4_NEXTHOP_CHANGED,  log_ip4_nexthop);
+	SIGNAL (NM_PLATFORM_SIGNAL_ID_IP6_NEXTHOP,  NM_PLATFORM_SIGNAL_IP6_NEXTHOP_CHANGED,  log_ip6_nexthop);
 	SIGNAL (NM_PLATFORM_SIGNAL_ID_ROUTING_RULE, NM_PLATFORM_SIGNAL_ROUTING_RULE_CHANGED, log_routing_rule);
 	SIGNAL (NM_PLATFORM_SIGNAL_ID_QDISC,        NM_PLATFORM_SIGNAL_QDISC_CHANGED,        log_qdisc);
 	SIGNAL (NM_PLATFORM_SIGNAL_ID_TFILTER,      NM_PLATFORM_SIGNAL_TFILTER_CHANGED,      log_tfilter);
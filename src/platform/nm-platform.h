@@ -257,6 +257,8 @@ typedef enum { /*< skip >*/
 	NM_PLATFORM_SIGNAL_ID_IP6_ADDRESS,
 	NM_PLATFORM_SIGNAL_ID_IP4_ROUTE,
 	NM_PLATFORM_SIGNAL_ID_IP6_ROUTE,
+	NM_PLATFORM_SIGNAL_ID_IP4_NEXTHOP,
+	NM_PLATFORM_SIGNAL_ID_IP6_NEXTHOP,
 	NM_PLATFORM_SIGNAL_ID_ROUTING_RULE,
 	NM_PLATFORM_SIGNAL_ID_QDISC,
 	NM_PLATFORM_SIGNAL_ID_TFILTER,
@@ -379,6 +381,34 @@ typedef union {
  * configures addresses. */
 #define NM_PLATFORM_ROUTE_METRIC_IP4_DEVICE_ROUTE 0
 
+/* The uncommon RTA_METRICS of a route. See nm_platform_ip_route_metrics_intern(). */
+typedef struct {
+	/* RTA_METRICS.RTAX_WINDOW (iproute2: window) */
+	guint32 window;
+
+	/* RTA_METRICS.RTAX_CWND (iproute2: cwnd) */
+	guint32 cwnd;
+
+	/* RTA_METRICS.RTAX_INITCWND (iproute2: initcwnd) */
+	guint32 initcwnd;
+
+	/* RTA_METRICS.RTAX_INITRWND (iproute2: initrwnd) */
+	guint32 initrwnd;
+
+	/* RTA_METRICS.RTAX_MTU (iproute2: mtu) */
+	guint32 mtu;
+
+	/* precomputed by nm_platform_ip_route_metrics_intern(). */
+	guint hash;
+
+	/* RTA_METRICS.RTAX_LOCK (iproute2: "lock" arguments) */
+	bool lock_window:1;
+	bool lock_cwnd:1;
+	bool lock_initcwnd:1;
+	bool lock_initrwnd:1;
+	bool lock_mtu:1;
+} NMPlatformIPRouteMetrics;
+
 #define __NMPlatformIPRoute_COMMON \
 	__NMPlatformObjWithIfindex_COMMON; \
 	\
@@ -398,6 +428,18 @@ typedef union {
 	\
 	guint8 plen; \
 	\
+	/* rtnh_flags
+	 *
+	 * Routes with rtm_flags RTM_F_CLONED are hidden by platform and
+	 * do not exist from the point-of-view of platform users.
+	 * Such a route is not alive, according to nmp_object_is_alive().
+	 *
+	 * NOTE: currently we ignore all flags except RTM_F_CLONED
+	 * and RTNH_F_ONLINK.
+	 * We also may not properly consider the flags as part of the ID
+	 * in route-cmp. */ \
+	unsigned r_rtm_flags; \
+	\
 	/* RTA_METRICS:
 	 *
 	 * For IPv4 routes, these properties are part of their
@@ -410,44 +452,16 @@ typedef union {
 	 * That is a problem/bug for IPv4 because you cannot explicitly select which
 	 * route to delete. Kernel just picks the first. See rh#1475642. */ \
 	\
-	/* RTA_METRICS.RTAX_LOCK (iproute2: "lock" arguments) */ \
-	bool lock_window:1; \
-	bool lock_cwnd:1; \
-	bool lock_initcwnd:1; \
-	bool lock_initrwnd:1; \
-	bool lock_mtu:1; \
-	\
-	/* rtnh_flags
-	 *
-	 * Routes with rtm_flags RTM_F_CLONED are hidden by platform and
-	 * do not exist from the point-of-view of platform users.
-	 * Such a route is not alive, according to nmp_object_is_alive().
-	 *
-	 * NOTE: currently we ignore all flags except RTM_F_CLONED
-	 * and RTNH_F_ONLINK.
-	 * We also may not properly consider the flags as part of the ID
-	 * in route-cmp. */ \
-	unsigned r_rtm_flags; \
+	/* The rarely used RTA_METRICS (window, cwnd, initcwnd, initrwnd,
+	 * mtu and their locks). Most routes have none of them, so they are kept out
+	 * of line in a block that is shared between all routes with the same values.
+	 * %NULL means all zero. Only assign values returned by nm_platform_ip_route_metrics_intern()
+	 * and read it via nm_platform_ip_route_get_metrics(). */ \
+	const NMPlatformIPRouteMetrics *metrics; \
 	\
 	/* RTA_METRICS.RTAX_ADVMSS (iproute2: advmss) */ \
 	guint32 mss; \
 	\
-	/* RTA_METRICS.RTAX_WINDOW (iproute2: window) */ \
-	guint32 window; \
-	\
-	/* RTA_METRICS.RTAX_CWND (iproute2: cwnd) */ \
-	guint32 cwnd; \
-	\
-	/* RTA_METRICS.RTAX_INITCWND (iproute2: initcwnd) */ \
-	guint32 initcwnd; \
-	\
-	/* RTA_METRICS.RTAX_INITRWND (iproute2: initrwnd) */ \
-	guint32 initrwnd; \
-	\
-	/* RTA_METRICS.RTAX_MTU (iproute2: mtu) */ \
-	guint32 mtu; \
-	\
-	\
 	/* RTA_PRIORITY (iproute2: metric) */ \
 	guint32 metric; \
 	\
@@ -458,6 +472,31 @@ typedef union {
 	 * table. Use nm_platform_route_table_coerce()/nm_platform_route_table_uncoerce(). */ \
 	guint32 table_coerced; \
 	\
+	/* RTA_NH_ID (iproute2: nhid)
+	 *
+	 * The id of a kernel nexthop object (see NMPlatformIP4Nexthop) that the
+	 * route uses, or zero. Kernel still reports the device and the gateway
+	 * of the nexthop via RTA_OIF/RTA_GATEWAY, so @ifindex and gateway are
+	 * filled in for routes from the cache. When adding a route with a nexthop
+	 * id, they are not sent to kernel (which rejects the combination).
+	 * For routes with a nexthop id, the id replaces @ifindex and gateway
+	 * when comparing routes (except for NM_PLATFORM_IP_ROUTE_CMP_TYPE_FULL). */ \
+	guint32 nhid; \
+	\
+	/* RTA_MULTIPATH.
+	 *
+	 * For ECMP routes, the number of nexthops (at least 2). The first nexthop
+	 * is embedded in the route itself (@ifindex and gateway), the remaining
+	 * (n_nexthops - 1) are in the extra_nexthops of the NMPObject. Zero for
+	 * a regular, single-hop route. The nexthops are not part of the ID. */ \
+	guint16 n_nexthops; \
+	\
+	/* rtnh_hops + 1 (iproute2: weight). For ECMP routes the weight of the first
+	 * nexthop. For routes that are to be configured, a non-zero weight marks
+	 * the route as candidate for merging with other weighted routes of the
+	 * same destination into one ECMP route (see nm_platform_ip_route_sync()). */ \
+	guint16 weight; \
+	\
 	/*end*/
 
 typedef struct {
@@ -474,6 +513,16 @@ typedef struct {
 #define NM_PLATFORM_IP_ROUTE_IS_DEFAULT(route) \
 	(NM_PLATFORM_IP_ROUTE_CAST (route)->plen <= 0)
 
+extern const NMPlatformIPRouteMetrics _nm_platform_ip_route_metrics_empty;
+
+/* Returns the (never %NULL) metrics block of an IPv4 or IPv6 route. */
+#define nm_platform_ip_route_get_metrics(route) \
+	({ \
+		const NMPlatformIPRouteMetrics *const _metrics = NM_PLATFORM_IP_ROUTE_CAST (route)->metrics; \
+		\
+		_metrics ?: &_nm_platform_ip_route_metrics_empty; \
+	})
+
 struct _NMPlatformIP4Route {
 	__NMPlatformIPRoute_COMMON;
 	in_addr_t network;
@@ -541,6 +590,20 @@ struct _NMPlatformIP6Route {
 	guint8 rt_pref;
 };
 
+/* A further nexthop of an ECMP route. The first nexthop is stored in the
+ * NMPlatformIP4Route itself. */
+typedef struct {
+	int ifindex;
+	in_addr_t gateway;
+	guint16 weight;
+} NMPlatformIP4RtNextHop;
+
+typedef struct {
+	int ifindex;
+	struct in6_addr gateway;
+	guint16 weight;
+} NMPlatformIP6RtNextHop;
+
 typedef union {
 	NMPlatformIPRoute  rx;
 	NMPlatformIP4Route r4;
@@ -549,6 +612,56 @@ typedef union {
 
 #undef __NMPlatformIPRoute_COMMON
 
+#define __NMPlatformIPNexthop_COMMON \
+	__NMPlatformObjWithIfindex_COMMON; \
+	\
+	/* NHA_ID. The id is the primary key of a nexthop. Note that kernel
+	 * has one id space for IPv4 and IPv6 nexthops (and nexthop groups). */ \
+	guint32 id; \
+	\
+	/* nh_protocol. Like rt_source of routes, this is the NMIPConfigSource
+	 * for the RTPROT_* value. */ \
+	NMIPConfigSource nh_source; \
+	\
+	/* nh_flags. Only RTNH_F_ONLINK can be configured, kernel also reports
+	 * RTNH_F_DEAD and RTNH_F_LINKDOWN. */ \
+	unsigned nh_flags; \
+	\
+	/*end*/
+
+/* A kernel nexthop object (RTM_NEWNEXTHOP), that routes can refer to
+ * via their nhid. Blackhole nexthops and nexthop groups are not tracked
+ * by platform. */
+typedef struct {
+	__NMPlatformIPNexthop_COMMON;
+	union {
+		guint8 gateway_ptr[1];
+		guint32 __dummy_for_32bit_alignment;
+	};
+} NMPlatformIPNexthop;
+
+typedef struct {
+	__NMPlatformIPNexthop_COMMON;
+
+	/* NHA_GATEWAY. Zero for a nexthop that is directly on the device. */
+	in_addr_t gateway;
+} NMPlatformIP4Nexthop;
+
+typedef struct {
+	__NMPlatformIPNexthop_COMMON;
+
+	/* NHA_GATEWAY. */
+	struct in6_addr gateway;
+} NMPlatformIP6Nexthop;
+
+typedef union {
+	NMPlatformIPNexthop  nx;
+	NMPlatformIP4Nexthop n4;
+	NMPlatformIP6Nexthop n6;
+} NMPlatformIPXNexthop;
+
+#undef __NMPlatformIPNexthop_COMMON
+
 typedef struct {
 	/* struct fib_rule_uid_range */
 	guint32 start;
@@ -866,6 +979,8 @@ typedef enum {
 	NM_PLATFORM_LINK_DUPLEX_FULL,
 } NMPlatformLinkDuplexType;
 
+typedef struct _NMEthtoolFeatureStates NMEthtoolFeatureStates;
+
 typedef enum {
 	NM_PLATFORM_WIREGUARD_CHANGE_FLAG_NONE                        = 0,
 	NM_PLATFORM_WIREGUARD_CHANGE_FLAG_REPLACE_PEERS               = (1LL << 0),
@@ -976,6 +1091,13 @@ typedef struct {
 	gboolean (*link_set_netns) (NMPlatform *self, int ifindex, int netns_fd);
 	gboolean (*link_set_up) (NMPlatform *self, int ifindex, gboolean *out_no_firmware);
 	gboolean (*link_set_down) (NMPlatform *self, int ifindex);
+	guint32 (*link_change_flags_async) (NMPlatform *self,
+	                                    int ifindex,
+	                                    unsigned flags_mask,
+	                                    unsigned flags_set,
+	                                    NMPlatformAsyncCallback callback,
+	                                    gpointer callback_data,
+	                                    GCancellable *cancellable);
 	gboolean (*link_set_arp) (NMPlatform *self, int ifindex);
 	gboolean (*link_set_noarp) (NMPlatform *self, int ifindex);
 
@@ -996,11 +1118,20 @@ typedef struct {
 	                                     int ifindex,
 	                                     guint num_vfs,
 	                                     int autoprobe,
+	                                     int eswitch_mode,
+	                                     int eswitch_inline_mode,
+	                                     int eswitch_encap_mode,
 	                                     NMPlatformAsyncCallback callback,
 	                                     gpointer callback_data,
 	                                     GCancellable *cancellable);
 	gboolean (*link_set_sriov_vfs) (NMPlatform *self, int ifindex, const NMPlatformVF *const *vfs);
-	gboolean (*link_set_bridge_vlans) (NMPlatform *self, int ifindex, gboolean on_master, const NMPlatformBridgeVlan *const *vlans);
+	void (*link_set_sriov_vfs_async) (NMPlatform *self,
+	                                  int ifindex,
+	                                  const NMPlatformVF *const *vfs,
+	                                  NMPlatformAsyncCallback callback,
+	                                  gpointer callback_data,
+	                                  GCancellable *cancellable);
+	gboolean (*link_set_bridge_vlans) (NMPlatform *self, int ifindex, gboolean on_master, const NMPlatformBridgeVlan *const *vlans, gboolean flush);
 
 	char *   (*link_get_physical_port_id) (NMPlatform *self, int ifindex);
 	guint    (*link_get_dev_id) (NMPlatform *self, int ifindex);
@@ -1011,6 +1142,18 @@ typedef struct {
 	                                  char **out_driver_version,
 	                                  char **out_fw_version);
 
+	NMEthtoolFeatureStates *(*ethtool_get_features) (NMPlatform *self, int ifindex);
+	gboolean (*ethtool_set_features) (NMPlatform *self,
+	                                  int ifindex,
+	                                  const NMEthtoolFeatureStates *features,
+	                                  const NMTernary *requested,
+	                                  gboolean do_set);
+	gboolean (*ethtool_get_link_settings) (NMPlatform *self,
+	                                       int ifindex,
+	                                       gboolean *out_autoneg,
+	                                       guint32 *out_speed,
+	                                       NMPlatformLinkDuplexType *out_duplex);
+
 	gboolean (*link_supports_carrier_detect) (NMPlatform *self, int ifindex);
 	gboolean (*link_supports_vlans) (NMPlatform *self, int ifindex);
 	gboolean (*link_supports_sriov) (NMPlatform *self, int ifindex);
@@ -1111,6 +1254,18 @@ typedef struct {
 
 	gboolean (*object_delete) (NMPlatform *self, const NMPObject *obj);
 
+	guint32 (*object_add_async) (NMPlatform *self,
+	                             NMPNlmFlags flags,
+	                             const NMPObject *obj,
+	                             NMPlatformAsyncCallback callback,
+	                             gpointer callback_data,
+	                             GCancellable *cancellable);
+	guint32 (*object_delete_async) (NMPlatform *self,
+	                                const NMPObject *obj,
+	                                NMPlatformAsyncCallback callback,
+	                                gpointer callback_data,
+	                                GCancellable *cancellable);
+
 	gboolean (*ip4_address_add) (NMPlatform *self,
 	                             int ifindex,
 	                             in_addr_t address,
@@ -1135,12 +1290,26 @@ typedef struct {
 	                     NMPNlmFlags flags,
 	                     int addr_family,
 	                     const NMPlatformIPRoute *route);
+	void (*ip_route_add_many) (NMPlatform *self,
+	                           NMPNlmFlags flags,
+	                           const NMPObject *const*routes,
+	                           guint len,
+	                           int *out_results);
+	void (*ip_route_delete_many) (NMPlatform *self,
+	                              const NMPObject *const*routes,
+	                              guint len);
+	void (*route_ignore_changed) (NMPlatform *self);
 	int (*ip_route_get) (NMPlatform *self,
 	                     int addr_family,
 	                     gconstpointer address,
 	                     int oif_ifindex,
 	                     NMPObject **out_route);
 
+	int (*ip_nexthop_add) (NMPlatform *self,
+	                       NMPNlmFlags flags,
+	                       int addr_family,
+	                       const NMPlatformIPNexthop *nexthop);
+
 	int (*routing_rule_add) (NMPlatform *self,
 	                         NMPNlmFlags flags,
 	                         const NMPlatformRoutingRule *routing_rule);
@@ -1170,12 +1339,45 @@ typedef struct {
 #define NM_PLATFORM_SIGNAL_IP6_ADDRESS_CHANGED "ip6-address-changed"
 #define NM_PLATFORM_SIGNAL_IP4_ROUTE_CHANGED "ip4-route-changed"
 #define NM_PLATFORM_SIGNAL_IP6_ROUTE_CHANGED "ip6-route-changed"
+#define NM_PLATFORM_SIGNAL_IP4_NEXTHOP_CHANGED "ip4-nexthop-changed"
+#define NM_PLATFORM_SIGNAL_IP6_NEXTHOP_CHANGED "ip6-nexthop-changed"
 #define NM_PLATFORM_SIGNAL_ROUTING_RULE_CHANGED "routing-rule-changed"
 #define NM_PLATFORM_SIGNAL_QDISC_CHANGED "qdisc-changed"
 #define NM_PLATFORM_SIGNAL_TFILTER_CHANGED "tfilter-changed"
 
 const char *nm_platform_signal_change_type_to_string (NMPlatformSignalChangeType change_type);
 
+/**
+ * NMPlatformChange:
+ * @obj_old: the object before the first change of the batch, or %NULL
+ *   if it was added.
+ * @obj_new: the object after the last change of the batch, or %NULL
+ *   if it was removed.
+ * @change_type: the resulting change.
+ *
+ * One entry of a batch of changes. A batch contains each object (by ID)
+ * only once, with the accumulated changes since the previous batch.
+ */
+typedef struct {
+	const NMPObject *obj_old;
+	const NMPObject *obj_new;
+	NMPlatformSignalChangeType change_type;
+} NMPlatformChange;
+
+typedef void (*NMPlatformChangeBatchCallback) (NMPlatform *platform,
+                                               NMPObjectType obj_type,
+                                               const NMPlatformChange *changes,
+                                               guint n_changes,
+                                               gpointer user_data);
+
+guint nm_platform_change_batch_subscribe (NMPlatform *self,
+                                          NMPObjectType obj_type,
+                                          NMPlatformChangeBatchCallback callback,
+                                          gpointer user_data);
+
+void nm_platform_change_batch_unsubscribe (NMPlatform *self,
+                                           guint subscription_id);
+
 /*****************************************************************************/
 
 GType nm_platform_get_type (void);
@@ -1419,6 +1621,16 @@ const NMPlatformLink *nm_platform_process_events_ensure_link (NMPlatform *self,
 
 gboolean nm_platform_link_set_up (NMPlatform *self, int ifindex, gboolean *out_no_firmware);
 gboolean nm_platform_link_set_down (NMPlatform *self, int ifindex);
+guint32 nm_platform_link_set_up_async (NMPlatform *self,
+                                       int ifindex,
+                                       NMPlatformAsyncCallback callback,
+                                       gpointer callback_data,
+                                       GCancellable *cancellable);
+guint32 nm_platform_link_set_down_async (NMPlatform *self,
+                                         int ifindex,
+                                         NMPlatformAsyncCallback callback,
+                                         gpointer callback_data,
+                                         GCancellable *cancellable);
 gboolean nm_platform_link_set_arp (NMPlatform *self, int ifindex);
 gboolean nm_platform_link_set_noarp (NMPlatform *self, int ifindex);
 
@@ -1438,12 +1650,22 @@ void nm_platform_link_set_sriov_params_async (NMPlatform *self,
                                               int ifindex,
                                               guint num_vfs,
                                               int autoprobe,
+                                              int eswitch_mode,
+                                              int eswitch_inline_mode,
+                                              int eswitch_encap_mode,
                                               NMPlatformAsyncCallback callback,
                                               gpointer callback_data,
                                               GCancellable *cancellable);
 
 gboolean nm_platform_link_set_sriov_vfs (NMPlatform *self, int ifindex, const NMPlatformVF *const *vfs);
+void nm_platform_link_set_sriov_vfs_async (NMPlatform *self,
+                                         int ifindex,
+                                         const NMPlatformVF *const *vfs,
+                                         NMPlatformAsyncCallback callback,
+                                         gpointer callback_data,
+                                         GCancellable *cancellable);
 gboolean nm_platform_link_set_bridge_vlans (NMPlatform *self, int ifindex, gboolean on_master, const NMPlatformBridgeVlan *const *vlans);
+gboolean nm_platform_link_flush_bridge_vlans (NMPlatform *self, int ifindex, gboolean on_master, const NMPlatformBridgeVlan *const *keep_vlans);
 
 char    *nm_platform_link_get_physical_port_id (NMPlatform *self, int ifindex);
 guint    nm_platform_link_get_dev_id (NMPlatform *self, int ifindex);
@@ -1609,6 +1831,18 @@ const NMPlatformIP6Address *nm_platform_ip6_address_get (NMPlatform *self, int i
 
 gboolean nm_platform_object_delete (NMPlatform *self, const NMPObject *route);
 
+guint32 nm_platform_object_add_async (NMPlatform *self,
+                                      NMPNlmFlags flags,
+                                      const NMPObject *obj,
+                                      NMPlatformAsyncCallback callback,
+                                      gpointer callback_data,
+                                      GCancellable *cancellable);
+guint32 nm_platform_object_delete_async (NMPlatform *self,
+                                         const NMPObject *obj,
+                                         NMPlatformAsyncCallback callback,
+                                         gpointer callback_data,
+                                         GCancellable *cancellable);
+
 gboolean nm_platform_ip4_address_add (NMPlatform *self,
                                       int ifindex,
                                       in_addr_t address,
@@ -1634,6 +1868,8 @@ gboolean nm_platform_ip_address_flush (NMPlatform *self,
                                        int addr_family,
                                        int ifindex);
 
+const NMPlatformIPRouteMetrics *nm_platform_ip_route_metrics_intern (const NMPlatformIPRouteMetrics *metrics);
+
 void nm_platform_ip_route_normalize (int addr_family,
                                      NMPlatformIPRoute *route);
 
@@ -1643,6 +1879,47 @@ int nm_platform_ip_route_add (NMPlatform *self,
 int nm_platform_ip4_route_add (NMPlatform *self, NMPNlmFlags flags, const NMPlatformIP4Route *route);
 int nm_platform_ip6_route_add (NMPlatform *self, NMPNlmFlags flags, const NMPlatformIP6Route *route);
 
+void nm_platform_ip_route_add_many (NMPlatform *self,
+                                    NMPNlmFlags flags,
+                                    const NMPObject *const*routes,
+                                    guint len,
+                                    int *out_results);
+void nm_platform_ip_route_delete_many (NMPlatform *self,
+                                       const NMPObject *const*routes,
+                                       guint len);
+
+/* The routes of these protocols and tables are hidden from the platform
+ * cache. See nm_platform_route_ignore_set(). */
+typedef struct {
+	/* bitmap of rtm_protocol values (RTPROT_*). */
+	guint32 protocols[256 / 32];
+	guint n_protocols;
+
+	/* kernel table ids (not coerced). */
+	guint32 *tables;
+	guint n_tables;
+} NMPlatformRouteIgnore;
+
+void nm_platform_route_ignore_set_default (const guint8 *protocols,
+                                           guint n_protocols,
+                                           const guint32 *tables,
+                                           guint n_tables);
+
+void nm_platform_route_ignore_set (NMPlatform *self,
+                                   const guint8 *protocols,
+                                   guint n_protocols,
+                                   const guint32 *tables,
+                                   guint n_tables);
+
+const NMPlatformRouteIgnore *nm_platform_route_ignore_get (NMPlatform *self);
+
+gboolean nm_platform_route_ignore_check (NMPlatform *self,
+                                         guint8 rtm_protocol,
+                                         guint32 table);
+
+gboolean nm_platform_route_ignore_check_route (NMPlatform *self,
+                                               const NMPlatformIPRoute *route);
+
 GPtrArray *nm_platform_ip_route_get_prune_list (NMPlatform *self,
                                                 int addr_family,
                                                 int ifindex,
@@ -1655,6 +1932,28 @@ gboolean nm_platform_ip_route_sync (NMPlatform *self,
                                     GPtrArray *routes_prune,
                                     GPtrArray **out_temporary_not_available);
 
+/* Remembers the routes of the last sync of one interface and address family,
+ * see nm_platform_ip_route_sync_with_state(). */
+typedef struct _NMPlatformIPRouteSyncState NMPlatformIPRouteSyncState;
+
+NMPlatformIPRouteSyncState *nm_platform_ip_route_sync_state_new (void);
+void nm_platform_ip_route_sync_state_free (NMPlatformIPRouteSyncState *state);
+
+GPtrArray *nm_platform_ip_route_sync_state_get_prune_list (NMPlatform *self,
+                                                           NMPlatformIPRouteSyncState *state,
+                                                           int addr_family,
+                                                           int ifindex,
+                                                           NMIPRouteTableSyncMode route_table_sync);
+
+gboolean nm_platform_ip_route_sync_with_state (NMPlatform *self,
+                                               int addr_family,
+                                               int ifindex,
+                                               NMPlatformIPRouteSyncState *state,
+                                               GPtrArray *routes,
+                                               GPtrArray *routes_prune,
+                                               NMIPRouteTableSyncMode route_table_sync,
+                                               GPtrArray **out_temporary_not_available);
+
 gboolean nm_platform_ip_route_flush (NMPlatform *self,
                                      int addr_family,
                                      int ifindex);
@@ -1665,6 +1964,16 @@ int nm_platform_ip_route_get (NMPlatform *self,
                               int oif_ifindex,
                               NMPObject **out_route);
 
+int nm_platform_ip_nexthop_add (NMPlatform *self,
+                                NMPNlmFlags flags,
+                                const NMPObject *nexthop);
+
+gboolean nm_platform_ip_nexthop_sync (NMPlatform *self,
+                                      int addr_family,
+                                      int ifindex,
+                                      GPtrArray *known_nexthops,
+                                      gboolean prune);
+
 int nm_platform_routing_rule_add (NMPlatform *self,
                                   NMPNlmFlags flags,
                                   const NMPlatformRoutingRule *routing_rule);
@@ -1699,6 +2008,8 @@ const char *nm_platform_ip4_address_to_string (const NMPlatformIP4Address *addre
 const char *nm_platform_ip6_address_to_string (const NMPlatformIP6Address *address, char *buf, gsize len);
 const char *nm_platform_ip4_route_to_string (const NMPlatformIP4Route *route, char *buf, gsize len);
 const char *nm_platform_ip6_route_to_string (const NMPlatformIP6Route *route, char *buf, gsize len);
+const char *nm_platform_ip4_nexthop_to_string (const NMPlatformIP4Nexthop *nexthop, char *buf, gsize len);
+const char *nm_platform_ip6_nexthop_to_string (const NMPlatformIP6Nexthop *nexthop, char *buf, gsize len);
 const char *nm_platform_routing_rule_to_string (const NMPlatformRoutingRule *routing_rule, char *buf, gsize len);
 const char *nm_platform_qdisc_to_string (const NMPlatformQdisc *qdisc, char *buf, gsize len);
 const char *nm_platform_tfilter_to_string (const NMPlatformTfilter *tfilter, char *buf, gsize len);
@@ -1745,6 +2056,9 @@ nm_platform_ip6_route_cmp_full (const NMPlatformIP6Route *a, const NMPlatformIP6
 	return nm_platform_ip6_route_cmp (a, b, NM_PLATFORM_IP_ROUTE_CMP_TYPE_FULL);
 }
 
+int nm_platform_ip4_nexthop_cmp (const NMPlatformIP4Nexthop *a, const NMPlatformIP4Nexthop *b);
+int nm_platform_ip6_nexthop_cmp (const NMPlatformIP6Nexthop *a, const NMPlatformIP6Nexthop *b);
+
 int nm_platform_routing_rule_cmp (const NMPlatformRoutingRule *a, const NMPlatformRoutingRule *b, NMPlatformRoutingRuleCmpType cmp_type);
 
 static inline int
@@ -1761,6 +2075,8 @@ void nm_platform_ip4_address_hash_update (const NMPlatformIP4Address *obj, NMHas
 void nm_platform_ip6_address_hash_update (const NMPlatformIP6Address *obj, NMHashState *h);
 void nm_platform_ip4_route_hash_update (const NMPlatformIP4Route *obj, NMPlatformIPRouteCmpType cmp_type, NMHashState *h);
 void nm_platform_ip6_route_hash_update (const NMPlatformIP6Route *obj, NMPlatformIPRouteCmpType cmp_type, NMHashState *h);
+void nm_platform_ip4_nexthop_hash_update (const NMPlatformIP4Nexthop *obj, NMHashState *h);
+void nm_platform_ip6_nexthop_hash_update (const NMPlatformIP6Nexthop *obj, NMHashState *h);
 void nm_platform_routing_rule_hash_update (const NMPlatformRoutingRule *obj, NMPlatformRoutingRuleCmpType cmp_type, NMHashState *h);
 void nm_platform_lnk_gre_hash_update (const NMPlatformLnkGre *obj, NMHashState *h);
 void nm_platform_lnk_infiniband_hash_update (const NMPlatformLnkInfiniband *obj, NMHashState *h);
@@ -1790,8 +2106,6 @@ gboolean nm_platform_ethtool_set_wake_on_lan (NMPlatform *self, int ifindex, NMS
 gboolean nm_platform_ethtool_set_link_settings (NMPlatform *self, int ifindex, gboolean autoneg, guint32 speed, NMPlatformLinkDuplexType duplex);
 gboolean nm_platform_ethtool_get_link_settings (NMPlatform *self, int ifindex, gboolean *out_autoneg, guint32 *out_speed, NMPlatformLinkDuplexType *out_duplex);
 
-typedef struct _NMEthtoolFeatureStates NMEthtoolFeatureStates;
-
 NMEthtoolFeatureStates *nm_platform_ethtool_get_link_features (NMPlatform *self,
                                                                int ifindex);
 gboolean nm_platform_ethtool_set_features (NMPlatform *self,
@@ -1808,4 +2122,10 @@ void nm_platform_ip4_dev_route_blacklist_set (NMPlatform *self,
 
 struct _NMDedupMultiIndex *nm_platform_get_multi_idx (NMPlatform *self);
 
+gboolean _nmtst_platform_qdisc_is_satisfied (const NMPlatformQdisc *plat,
+                                             const NMPlatformQdisc *want);
+gboolean _nmtst_platform_tfilter_can_replace (const NMPlatformTfilter *plat,
+                                              const NMPlatformTfilter *want);
+guint _nmtst_platform_ip_route_sync_state_get_n_diffed (const NMPlatformIPRouteSyncState *state);
+
 #endif /* __NETWORKMANAGER_PLATFORM_H__ */
@@ -8,6 +8,7 @@
 #include "nmp-object.h"
 
 #include <unistd.h>
+#include <sys/mman.h>
 #include <linux/rtnetlink.h>
 #include <linux/if.h>
 #include <libudev.h>
@@ -17,6 +18,7 @@
 
 #include "nm-core-utils.h"
 #include "nm-platform-utils.h"
+#include "nm-netlink.h"
 
 #include "wifi/nm-wifi-utils.h"
 #include "wpan/nm-wpan-utils.h"
@@ -367,6 +369,8 @@ _idx_obj_part (const DedupMultiIdxType *idx_type,
 		                                                NMP_OBJECT_TYPE_IP6_ADDRESS,
 		                                                NMP_OBJECT_TYPE_IP4_ROUTE,
 		                                                NMP_OBJECT_TYPE_IP6_ROUTE,
+		                                                NMP_OBJECT_TYPE_IP4_NEXTHOP,
+		                                                NMP_OBJECT_TYPE_IP6_NEXTHOP,
 		                                                NMP_OBJECT_TYPE_QDISC,
 		                                                NMP_OBJECT_TYPE_TFILTER)
 		    || !nmp_object_is_visible (obj_a)) {
@@ -431,6 +435,57 @@ _idx_obj_part (const DedupMultiIdxType *idx_type,
 		}
 		return 1;
 
+	case NMP_CACHE_ID_TYPE_ROUTES_BY_TABLE:
+		obj_type = NMP_OBJECT_GET_TYPE (obj_a);
+		if (   !NM_IN_SET (obj_type, NMP_OBJECT_TYPE_IP4_ROUTE,
+		                             NMP_OBJECT_TYPE_IP6_ROUTE)
+		    || !nmp_object_is_visible (obj_a)) {
+			if (h)
+				nm_hash_update_val (h, obj_a);
+			return 0;
+		}
+		if (obj_b) {
+			return    obj_type == NMP_OBJECT_GET_TYPE (obj_b)
+			       && nmp_object_is_visible (obj_b)
+			       && (   nm_platform_route_table_uncoerce (obj_a->ip_route.table_coerced, TRUE)
+			           == nm_platform_route_table_uncoerce (obj_b->ip_route.table_coerced, TRUE));
+		}
+		if (h) {
+			nm_hash_update_vals (h,
+			                     idx_type->cache_id_type,
+			                     obj_type,
+			                     nm_platform_route_table_uncoerce (obj_a->ip_route.table_coerced, TRUE));
+		}
+		return 1;
+
+	case NMP_CACHE_ID_TYPE_ROUTES_BY_GATEWAY:
+		obj_type = NMP_OBJECT_GET_TYPE (obj_a);
+		if (   !NM_IN_SET (obj_type, NMP_OBJECT_TYPE_IP4_ROUTE,
+		                             NMP_OBJECT_TYPE_IP6_ROUTE)
+		    || (obj_type == NMP_OBJECT_TYPE_IP4_ROUTE
+		        ? obj_a->ip4_route.gateway == 0
+		        : IN6_IS_ADDR_UNSPECIFIED (&obj_a->ip6_route.gateway))
+		    || !nmp_object_is_visible (obj_a)) {
+			if (h)
+				nm_hash_update_val (h, obj_a);
+			return 0;
+		}
+		if (obj_b) {
+			return    obj_type == NMP_OBJECT_GET_TYPE (obj_b)
+			       && nmp_object_is_visible (obj_b)
+			       && (obj_type == NMP_OBJECT_TYPE_IP4_ROUTE
+			           ? obj_a->ip4_route.gateway == obj_b->ip4_route.gateway
+			           : IN6_ARE_ADDR_EQUAL (&obj_a->ip6_route.gateway, &obj_b->ip6_route.gateway));
+		}
+		if (h) {
+			nm_hash_update_vals (h, idx_type->cache_id_type, obj_type);
+			if (obj_type == NMP_OBJECT_TYPE_IP4_ROUTE)
+				nm_hash_update_val (h, obj_a->ip4_route.gateway);
+			else
+				nm_hash_update_val (h, obj_a->ip6_route.gateway);
+		}
+		return 1;
+
 	case NMP_CACHE_ID_TYPE_NONE:
 	case __NMP_CACHE_ID_TYPE_MAX:
 		break;
@@ -756,6 +811,212 @@ _vt_cmd_obj_dispose_lnk_wireguard (NMPObject *obj)
 	_wireguard_clear (&obj->_lnk_wireguard);
 }
 
+static void
+_vt_cmd_obj_dispose_ip4_route (NMPObject *obj)
+{
+	g_free ((gpointer) obj->_ip4_route.extra_nexthops);
+}
+
+static void
+_vt_cmd_obj_dispose_ip6_route (NMPObject *obj)
+{
+	g_free ((gpointer) obj->_ip6_route.extra_nexthops);
+}
+
+/*****************************************************************************/
+
+/* The platform cache can hold hundreds of thousands of routes. Instead of
+ * allocating each object individually, objects of the types with
+ * NMPClass.alloc_slab are carved out of per-type pages. The pages are
+ * aligned to their size, so that freeing an object finds its page by masking
+ * the pointer. A page that becomes empty is unmapped, except one spare page
+ * per type, to avoid thrashing when a single object gets allocated and freed
+ * repeatedly.
+ *
+ * Like the ref-counting of NMPObject, this is not thread-safe.
+ *
+ * With G_SLICE=always-malloc (as used by the tests under valgrind), the slab
+ * is disabled. */
+
+#define _SLAB_PAGE_SIZE  ((gsize) (64 * 1024))
+#define _SLAB_OBJ_ALIGN  (2 * sizeof (gsize))
+
+#define _SLAB_ALIGN_TO(val, to) (((val) + (to) - 1) & ~((to) - 1))
+
+typedef struct {
+	CList lst_pages;
+	gpointer free_list;
+	guint n_used;
+	guint n_carved;
+} SlabPage;
+
+#define _SLAB_PAGE_HEADER_SIZE  _SLAB_ALIGN_TO (sizeof (SlabPage), _SLAB_OBJ_ALIGN)
+
+typedef struct {
+	/* pages that have free slots. Full pages are not linked. */
+	CList lst_partial;
+	SlabPage *spare;
+	gsize obj_size;
+	guint n_per_page;
+	guint n_pages;
+	guint64 n_objs;
+	guint64 n_allocs;
+} Slab;
+
+static struct {
+	Slab slabs[NMP_OBJECT_TYPE_MAX];
+	int enabled;
+} _slab_global;
+
+static gboolean
+_slab_enabled (void)
+{
+	if (G_UNLIKELY (_slab_global.enabled == 0)) {
+		const char *s = g_getenv ("G_SLICE");
+
+		_slab_global.enabled = (s && strstr (s, "always-malloc")) ? -1 : 1;
+	}
+	return _slab_global.enabled > 0;
+}
+
+static Slab *
+_slab_get (const NMPClass *klass)
+{
+	Slab *slab = &_slab_global.slabs[klass->obj_type - 1];
+
+	if (G_UNLIKELY (slab->obj_size == 0)) {
+		c_list_init (&slab->lst_partial);
+		slab->obj_size = _SLAB_ALIGN_TO (klass->sizeof_data + G_STRUCT_OFFSET (NMPObject, object),
+		                              _SLAB_OBJ_ALIGN);
+		slab->n_per_page = (_SLAB_PAGE_SIZE - _SLAB_PAGE_HEADER_SIZE) / slab->obj_size;
+		nm_assert (slab->n_per_page > 1);
+	}
+	return slab;
+}
+
+static SlabPage *
+_slab_page_new (Slab *slab)
+{
+	guint8 *mem;
+	guint8 *page;
+	gsize head;
+
+	/* over-allocate to get a page aligned to _SLAB_PAGE_SIZE, and
+	 * unmap the excess. */
+	mem = mmap (NULL, 2 * _SLAB_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mem == MAP_FAILED)
+		g_error ("nmp-object: failure to allocate slab page: %s", nm_strerror_native (errno));
+
+	page = (guint8 *) _SLAB_ALIGN_TO ((uintptr_t) mem, _SLAB_PAGE_SIZE);
+	head = page - mem;
+	if (head > 0)
+		munmap (mem, head);
+	munmap (page + _SLAB_PAGE_SIZE, _SLAB_PAGE_SIZE - head);
+
+	slab->n_pages++;
+	return (SlabPage *) page;
+}
+
+static void
+_slab_page_free (Slab *slab, SlabPage *page)
+{
+	nm_assert (slab->n_pages > 0);
+
+	slab->n_pages--;
+	munmap (page, _SLAB_PAGE_SIZE);
+}
+
+static gpointer
+_slab_alloc (Slab *slab)
+{
+	SlabPage *page;
+	gpointer obj;
+
+	page = c_list_first_entry (&slab->lst_partial, SlabPage, lst_pages);
+	if (!page) {
+		if (slab->spare)
+			page = g_steal_pointer (&slab->spare);
+		else
+			page = _slab_page_new (slab);
+		*page = (SlabPage) { };
+		c_list_link_front (&slab->lst_partial, &page->lst_pages);
+	}
+
+	if (page->free_list) {
+		obj = page->free_list;
+		page->free_list = *((gpointer *) obj);
+	} else {
+		nm_assert (page->n_carved < slab->n_per_page);
+		obj = ((guint8 *) page) + _SLAB_PAGE_HEADER_SIZE + (page->n_carved++ * slab->obj_size);
+	}
+
+	if (++page->n_used == slab->n_per_page)
+		c_list_unlink (&page->lst_pages);
+
+	slab->n_objs++;
+	slab->n_allocs++;
+	return memset (obj, 0, slab->obj_size);
+}
+
+static void
+_slab_free (Slab *slab, gpointer obj)
+{
+	SlabPage *page = (SlabPage *) (((uintptr_t) obj) & ~((uintptr_t) (_SLAB_PAGE_SIZE - 1)));
+
+	nm_assert (page->n_used > 0);
+	nm_assert (slab->n_objs > 0);
+
+	slab->n_objs--;
+
+	if (page->n_used-- == slab->n_per_page)
+		c_list_link_front (&slab->lst_partial, &page->lst_pages);
+
+	if (page->n_used == 0) {
+		c_list_unlink (&page->lst_pages);
+		if (!slab->spare)
+			slab->spare = page;
+		else
+			_slab_page_free (slab, page);
+		return;
+	}
+
+	*((gpointer *) obj) = page->free_list;
+	page->free_list = obj;
+}
+
+/**
+ * nmp_object_alloc_stats_get:
+ * @obj_type: the object type
+ * @out_stats: (out): the statistics
+ *
+ * Get statistics about the allocations of objects of @obj_type. The counters
+ * are only kept for types that are allocated from the slab.
+ */
+void
+nmp_object_alloc_stats_get (NMPObjectType obj_type, NMPObjectAllocStats *out_stats)
+{
+	const NMPClass *klass = nmp_class_from_type (obj_type);
+	const Slab *slab;
+
+	g_return_if_fail (klass);
+	g_return_if_fail (out_stats);
+
+	*out_stats = (NMPObjectAllocStats) { };
+
+	if (   !klass->alloc_slab
+	    || !_slab_enabled ())
+		return;
+
+	slab = _slab_get (klass);
+	*out_stats = (NMPObjectAllocStats) {
+		.obj_size  = slab->obj_size,
+		.page_size = _SLAB_PAGE_SIZE,
+		.n_pages   = slab->n_pages + (slab->spare ? 1u : 0u),
+		.n_objs    = slab->n_objs,
+		.n_allocs  = slab->n_allocs,
+	};
+}
+
 static NMPObject *
 _nmp_object_new_from_class (const NMPClass *klass)
 {
@@ -765,12 +1026,26 @@ _nmp_object_new_from_class (const NMPClass *klass)
 	nm_assert (klass->sizeof_data > 0);
 	nm_assert (klass->sizeof_public > 0 && klass->sizeof_public <= klass->sizeof_data);
 
-	obj = g_slice_alloc0 (klass->sizeof_data + G_STRUCT_OFFSET (NMPObject, object));
+	if (   klass->alloc_slab
+	    && _slab_enabled ())
+		obj = _slab_alloc (_slab_get (klass));
+	else
+		obj = g_slice_alloc0 (klass->sizeof_data + G_STRUCT_OFFSET (NMPObject, object));
 	obj->_class = klass;
 	obj->parent._ref_count = 1;
 	return obj;
 }
 
+static void
+_nmp_object_free (const NMPClass *klass, NMPObject *obj)
+{
+	if (   klass->alloc_slab
+	    && _slab_enabled ())
+		_slab_free (_slab_get (klass), obj);
+	else
+		g_slice_free1 (klass->sizeof_data + G_STRUCT_OFFSET (NMPObject, object), obj);
+}
+
 NMPObject *
 nmp_object_new (NMPObjectType obj_type, gconstpointer plobj)
 {
@@ -1069,6 +1344,59 @@ _vt_cmd_obj_to_string_lnk_wireguard (const NMPObject *obj, NMPObjectToStringMode
 	}
 }
 
+static const char *
+_vt_cmd_obj_to_string_ipx_route (const NMPObject *obj, NMPObjectToStringMode to_string_mode, char *buf, gsize buf_size)
+{
+	const NMPClass *klass;
+	char buf2[sizeof (_nm_utils_to_string_buffer)];
+	char s_gateway[NM_UTILS_INET_ADDRSTRLEN];
+	char *b;
+	guint i, n;
+
+	klass = NMP_OBJECT_GET_CLASS (obj);
+
+	switch (to_string_mode) {
+	case NMP_OBJECT_TO_STRING_ID:
+		return klass->cmd_plobj_to_string_id (&obj->object, buf, buf_size);
+	case NMP_OBJECT_TO_STRING_ALL:
+		g_snprintf (buf, buf_size,
+		            "[%s,%p,%u,%calive,%cvisible; %s]",
+		            klass->obj_type_name, obj, obj->parent._ref_count,
+		            nmp_object_is_alive (obj) ? '+' : '-',
+		            nmp_object_is_visible (obj) ? '+' : '-',
+		            nmp_object_to_string (obj, NMP_OBJECT_TO_STRING_PUBLIC, buf2, sizeof (buf2)));
+		return buf;
+	case NMP_OBJECT_TO_STRING_PUBLIC:
+		b = buf;
+		klass->cmd_plobj_to_string (&obj->object, b, buf_size);
+		nm_utils_strbuf_seek_end (&b, &buf_size);
+
+		n = nmp_object_ip_route_get_n_extra_nexthops (obj);
+		for (i = 0; i < n; i++) {
+			if (klass->obj_type == NMP_OBJECT_TYPE_IP4_ROUTE) {
+				const NMPlatformIP4RtNextHop *nh = &obj->_ip4_route.extra_nexthops[i];
+
+				nm_utils_strbuf_append (&b, &buf_size,
+				                        " nexthop via %s dev %d weight %u",
+				                        nm_utils_inet4_ntop (nh->gateway, s_gateway),
+				                        nh->ifindex,
+				                        (unsigned) nh->weight);
+			} else {
+				const NMPlatformIP6RtNextHop *nh = &obj->_ip6_route.extra_nexthops[i];
+
+				nm_utils_strbuf_append (&b, &buf_size,
+				                        " nexthop via %s dev %d weight %u",
+				                        nm_utils_inet6_ntop (&nh->gateway, s_gateway),
+				                        nh->ifindex,
+				                        (unsigned) nh->weight);
+			}
+		}
+		return buf;
+	default:
+		g_return_val_if_reached ("ERROR");
+	}
+}
+
 #define _vt_cmd_plobj_to_string_id(type, plat_type, ...) \
 static const char * \
 _vt_cmd_plobj_to_string_id_##type (const NMPlatformObject *_obj, char *buf, gsize buf_len) \
@@ -1086,6 +1414,8 @@ _vt_cmd_plobj_to_string_id (ip4_address, NMPlatformIP4Address, "%d: %s/%d%s%s",
                                                                obj->peer_address != obj->address ? "," : "",
                                                                obj->peer_address != obj->address ? nm_utils_inet4_ntop (nm_utils_ip4_address_clear_host_address (obj->peer_address, obj->plen), buf2) : "");
 _vt_cmd_plobj_to_string_id (ip6_address, NMPlatformIP6Address, "%d: %s",        obj->ifindex, nm_utils_inet6_ntop (&obj->address, buf1));
+_vt_cmd_plobj_to_string_id (ip4_nexthop, NMPlatformIP4Nexthop, "%u",            obj->id);
+_vt_cmd_plobj_to_string_id (ip6_nexthop, NMPlatformIP6Nexthop, "%u",            obj->id);
 _vt_cmd_plobj_to_string_id (qdisc,       NMPlatformQdisc,      "%d: %d",        obj->ifindex, obj->parent);
 _vt_cmd_plobj_to_string_id (tfilter,     NMPlatformTfilter,    "%d: %d",        obj->ifindex, obj->parent);
 
@@ -1149,6 +1479,48 @@ _vt_cmd_obj_hash_update_lnk_wireguard (const NMPObject *obj, NMHashState *h)
 		_wireguard_peer_hash_update (&obj->_lnk_wireguard.peers[i], h);
 }
 
+static void
+_vt_cmd_obj_hash_update_ip4_route (const NMPObject *obj, NMHashState *h)
+{
+	guint i, n;
+
+	nm_assert (NMP_OBJECT_GET_TYPE (obj) == NMP_OBJECT_TYPE_IP4_ROUTE);
+
+	nm_platform_ip4_route_hash_update (&obj->ip4_route, NM_PLATFORM_IP_ROUTE_CMP_TYPE_FULL, h);
+
+	n = nmp_object_ip_route_get_n_extra_nexthops (obj);
+	nm_hash_update_val (h, n);
+	for (i = 0; i < n; i++) {
+		const NMPlatformIP4RtNextHop *nh = &obj->_ip4_route.extra_nexthops[i];
+
+		nm_hash_update_vals (h,
+		                     nh->ifindex,
+		                     nh->gateway,
+		                     nh->weight);
+	}
+}
+
+static void
+_vt_cmd_obj_hash_update_ip6_route (const NMPObject *obj, NMHashState *h)
+{
+	guint i, n;
+
+	nm_assert (NMP_OBJECT_GET_TYPE (obj) == NMP_OBJECT_TYPE_IP6_ROUTE);
+
+	nm_platform_ip6_route_hash_update (&obj->ip6_route, NM_PLATFORM_IP_ROUTE_CMP_TYPE_FULL, h);
+
+	n = nmp_object_ip_route_get_n_extra_nexthops (obj);
+	nm_hash_update_val (h, n);
+	for (i = 0; i < n; i++) {
+		const NMPlatformIP6RtNextHop *nh = &obj->_ip6_route.extra_nexthops[i];
+
+		nm_hash_update_vals (h,
+		                     nh->ifindex,
+		                     nh->gateway,
+		                     nh->weight);
+	}
+}
+
 int
 nmp_object_cmp (const NMPObject *obj1, const NMPObject *obj2)
 {
@@ -1233,6 +1605,62 @@ _vt_cmd_obj_cmp_lnk_wireguard (const NMPObject *obj1, const NMPObject *obj2)
 	return 0;
 }
 
+/**
+ * nmp_object_ip_route_cmp_extra_nexthops:
+ * @obj1: an IPv4 or IPv6 route object
+ * @obj2: a route object of the same type
+ *
+ * Compares the nexthops of ECMP routes, that are not in the public
+ * NMPlatformIP4Route/NMPlatformIP6Route part. That is, the remaining
+ * part that nm_platform_ip4_route_cmp() cannot compare.
+ *
+ * Returns: a value like strcmp().
+ */
+int
+nmp_object_ip_route_cmp_extra_nexthops (const NMPObject *obj1, const NMPObject *obj2)
+{
+	guint i, n;
+
+	nm_assert (NM_IN_SET (NMP_OBJECT_GET_TYPE (obj1), NMP_OBJECT_TYPE_IP4_ROUTE, NMP_OBJECT_TYPE_IP6_ROUTE));
+	nm_assert (NMP_OBJECT_GET_TYPE (obj1) == NMP_OBJECT_GET_TYPE (obj2));
+
+	n = nmp_object_ip_route_get_n_extra_nexthops (obj1);
+	NM_CMP_DIRECT (n, nmp_object_ip_route_get_n_extra_nexthops (obj2));
+
+	for (i = 0; i < n; i++) {
+		if (NMP_OBJECT_GET_TYPE (obj1) == NMP_OBJECT_TYPE_IP4_ROUTE) {
+			const NMPlatformIP4RtNextHop *a = &obj1->_ip4_route.extra_nexthops[i];
+			const NMPlatformIP4RtNextHop *b = &obj2->_ip4_route.extra_nexthops[i];
+
+			NM_CMP_FIELD (a, b, ifindex);
+			NM_CMP_FIELD (a, b, gateway);
+			NM_CMP_FIELD (a, b, weight);
+		} else {
+			const NMPlatformIP6RtNextHop *a = &obj1->_ip6_route.extra_nexthops[i];
+			const NMPlatformIP6RtNextHop *b = &obj2->_ip6_route.extra_nexthops[i];
+
+			NM_CMP_FIELD (a, b, ifindex);
+			NM_CMP_FIELD_IN6ADDR (a, b, gateway);
+			NM_CMP_FIELD (a, b, weight);
+		}
+	}
+	return 0;
+}
+
+static int
+_vt_cmd_obj_cmp_ip4_route (const NMPObject *obj1, const NMPObject *obj2)
+{
+	NM_CMP_RETURN (nm_platform_ip4_route_cmp_full (&obj1->ip4_route, &obj2->ip4_route));
+	return nmp_object_ip_route_cmp_extra_nexthops (obj1, obj2);
+}
+
+static int
+_vt_cmd_obj_cmp_ip6_route (const NMPObject *obj1, const NMPObject *obj2)
+{
+	NM_CMP_RETURN (nm_platform_ip6_route_cmp_full (&obj1->ip6_route, &obj2->ip6_route));
+	return nmp_object_ip_route_cmp_extra_nexthops (obj1, obj2);
+}
+
 /* @src is a const object, which is not entirely correct for link types, where
  * we increase the ref count for src->_link.udev.device.
  * Hence, nmp_object_copy() can violate the const promise of @src.
@@ -1334,6 +1762,40 @@ _vt_cmd_obj_copy_lnk_wireguard (NMPObject *dst, const NMPObject *src)
 	nm_assert (nmp_object_equal (src, dst));
 }
 
+static void
+_vt_cmd_obj_copy_ip4_route (NMPObject *dst, const NMPObject *src)
+{
+	guint n;
+
+	nm_assert (dst != src);
+
+	g_free ((gpointer) dst->_ip4_route.extra_nexthops);
+	dst->_ip4_route = src->_ip4_route;
+
+	n = nmp_object_ip_route_get_n_extra_nexthops (src);
+	if (n > 0) {
+		dst->_ip4_route.extra_nexthops = nm_memdup (src->_ip4_route.extra_nexthops,
+		                                            sizeof (NMPlatformIP4RtNextHop) * n);
+	}
+}
+
+static void
+_vt_cmd_obj_copy_ip6_route (NMPObject *dst, const NMPObject *src)
+{
+	guint n;
+
+	nm_assert (dst != src);
+
+	g_free ((gpointer) dst->_ip6_route.extra_nexthops);
+	dst->_ip6_route = src->_ip6_route;
+
+	n = nmp_object_ip_route_get_n_extra_nexthops (src);
+	if (n > 0) {
+		dst->_ip6_route.extra_nexthops = nm_memdup (src->_ip6_route.extra_nexthops,
+		                                            sizeof (NMPlatformIP6RtNextHop) * n);
+	}
+}
+
 #define _vt_cmd_plobj_id_copy(type, plat_type, cmd) \
 static void \
 _vt_cmd_plobj_id_copy_##type (NMPlatformObject *_dst, const NMPlatformObject *_src) \
@@ -1363,6 +1825,14 @@ _vt_cmd_plobj_id_copy (ip6_route, NMPlatformIP6Route, {
 	*dst = *src;
 	nm_assert (nm_platform_ip6_route_cmp (dst, src, NM_PLATFORM_IP_ROUTE_CMP_TYPE_ID) == 0);
 });
+_vt_cmd_plobj_id_copy (ip4_nexthop, NMPlatformIP4Nexthop, {
+	dst->id = src->id;
+	dst->ifindex = src->ifindex;
+});
+_vt_cmd_plobj_id_copy (ip6_nexthop, NMPlatformIP6Nexthop, {
+	dst->id = src->id;
+	dst->ifindex = src->ifindex;
+});
 _vt_cmd_plobj_id_copy (routing_rule, NMPlatformRoutingRule, {
 	*dst = *src;
 	nm_assert (nm_platform_routing_rule_cmp (dst, src, NM_PLATFORM_ROUTING_RULE_CMP_TYPE_ID) == 0);
@@ -1446,6 +1916,13 @@ _vt_cmd_plobj_id_cmp (ip6_address, NMPlatformIP6Address,
                       /* for IPv6 addresses, the prefix length is not part of the primary identifier. */
                       NM_CMP_FIELD_IN6ADDR (obj1, obj2, address);
 )
+_vt_cmd_plobj_id_cmp (ip4_nexthop, NMPlatformIP4Nexthop,
+                      /* kernel has only one id space for all nexthops. */
+                      NM_CMP_FIELD (obj1, obj2, id);
+)
+_vt_cmd_plobj_id_cmp (ip6_nexthop, NMPlatformIP6Nexthop,
+                      NM_CMP_FIELD (obj1, obj2, id);
+)
 _vt_cmd_plobj_id_cmp (qdisc, NMPlatformQdisc,
                       NM_CMP_FIELD (obj1, obj2, ifindex);
                       NM_CMP_FIELD (obj1, obj2, parent);
@@ -1541,6 +2018,12 @@ _vt_cmd_plobj_id_hash_update (ip6_route, NMPlatformIP6Route, {
 _vt_cmd_plobj_id_hash_update (routing_rule, NMPlatformRoutingRule, {
 	nm_platform_routing_rule_hash_update (obj, NM_PLATFORM_ROUTING_RULE_CMP_TYPE_ID, h);
 })
+_vt_cmd_plobj_id_hash_update (ip4_nexthop, NMPlatformIP4Nexthop, {
+	nm_hash_update_val (h, obj->id);
+})
+_vt_cmd_plobj_id_hash_update (ip6_nexthop, NMPlatformIP6Nexthop, {
+	nm_hash_update_val (h, obj->id);
+})
 _vt_cmd_plobj_id_hash_update (qdisc, NMPlatformQdisc, {
 	nm_hash_update_vals (h,
 	                     obj->ifindex,
@@ -1619,6 +2102,15 @@ _vt_cmd_obj_is_alive_ipx_route (const NMPObject *obj)
 	       && !NM_FLAGS_HAS (obj->ip_route.r_rtm_flags, RTM_F_CLONED);
 }
 
+static gboolean
+_vt_cmd_obj_is_alive_ipx_nexthop (const NMPObject *obj)
+{
+	/* like routes without device, blackhole nexthops are not
+	 * tracked. Nexthop groups are never created from netlink. */
+	return    NMP_OBJECT_CAST_IP_NEXTHOP (obj)->id > 0
+	       && NMP_OBJECT_CAST_IP_NEXTHOP (obj)->ifindex > 0;
+}
+
 static gboolean
 _vt_cmd_obj_is_alive_routing_rule (const NMPObject *obj)
 {
@@ -1689,6 +2181,8 @@ static const guint8 _supported_cache_ids_ipx_route[] = {
 	NMP_CACHE_ID_TYPE_OBJECT_BY_IFINDEX,
 	NMP_CACHE_ID_TYPE_DEFAULT_ROUTES,
 	NMP_CACHE_ID_TYPE_ROUTES_BY_WEAK_ID,
+	NMP_CACHE_ID_TYPE_ROUTES_BY_TABLE,
+	NMP_CACHE_ID_TYPE_ROUTES_BY_GATEWAY,
 	0,
 };
 
@@ -1712,7 +2206,7 @@ _vt_dedup_obj_destroy (NMDedupMultiObj *obj)
 	klass = o->_class;
 	if (klass->cmd_obj_dispose)
 		klass->cmd_obj_dispose (o);
-	g_slice_free1 (klass->sizeof_data + G_STRUCT_OFFSET (NMPObject, object), o);
+	_nmp_object_free (klass, o);
 }
 
 static const NMDedupMultiObj *
@@ -1975,6 +2469,8 @@ nmp_lookup_init_obj_type (NMPLookup *lookup,
 	case NMP_OBJECT_TYPE_IP6_ADDRESS:
 	case NMP_OBJECT_TYPE_IP4_ROUTE:
 	case NMP_OBJECT_TYPE_IP6_ROUTE:
+	case NMP_OBJECT_TYPE_IP4_NEXTHOP:
+	case NMP_OBJECT_TYPE_IP6_NEXTHOP:
 	case NMP_OBJECT_TYPE_ROUTING_RULE:
 	case NMP_OBJECT_TYPE_QDISC:
 	case NMP_OBJECT_TYPE_TFILTER:
@@ -2016,6 +2512,8 @@ nmp_lookup_init_object (NMPLookup *lookup,
 	                                NMP_OBJECT_TYPE_IP6_ADDRESS,
 	                                NMP_OBJECT_TYPE_IP4_ROUTE,
 	                                NMP_OBJECT_TYPE_IP6_ROUTE,
+	                                NMP_OBJECT_TYPE_IP4_NEXTHOP,
+	                                NMP_OBJECT_TYPE_IP6_NEXTHOP,
 	                                NMP_OBJECT_TYPE_QDISC,
 	                                NMP_OBJECT_TYPE_TFILTER));
 
@@ -2124,6 +2622,56 @@ nmp_lookup_init_ip6_route_by_weak_id (NMPLookup *lookup,
 	return _L (lookup);
 }
 
+const NMPLookup *
+nmp_lookup_init_route_by_table (NMPLookup *lookup,
+                                NMPObjectType obj_type,
+                                guint32 table)
+{
+	NMPObject *o;
+
+	nm_assert (lookup);
+	nm_assert (NM_IN_SET (obj_type, NMP_OBJECT_TYPE_IP4_ROUTE,
+	                                NMP_OBJECT_TYPE_IP6_ROUTE));
+
+	o = _nmp_object_stackinit_from_type (&lookup->selector_obj, obj_type);
+	o->ip_route.ifindex = 1;
+	o->ip_route.table_coerced = nm_platform_route_table_coerce (table);
+	lookup->cache_id_type = NMP_CACHE_ID_TYPE_ROUTES_BY_TABLE;
+	return _L (lookup);
+}
+
+const NMPLookup *
+nmp_lookup_init_ip4_route_by_gateway (NMPLookup *lookup,
+                                      in_addr_t gateway)
+{
+	NMPObject *o;
+
+	nm_assert (lookup);
+	nm_assert (gateway);
+
+	o = _nmp_object_stackinit_from_type (&lookup->selector_obj, NMP_OBJECT_TYPE_IP4_ROUTE);
+	o->ip4_route.ifindex = 1;
+	o->ip4_route.gateway = gateway;
+	lookup->cache_id_type = NMP_CACHE_ID_TYPE_ROUTES_BY_GATEWAY;
+	return _L (lookup);
+}
+
+const NMPLookup *
+nmp_lookup_init_ip6_route_by_gateway (NMPLookup *lookup,
+                                      const struct in6_addr *gateway)
+{
+	NMPObject *o;
+
+	nm_assert (lookup);
+	nm_assert (gateway && !IN6_IS_ADDR_UNSPECIFIED (gateway));
+
+	o = _nmp_object_stackinit_from_type (&lookup->selector_obj, NMP_OBJECT_TYPE_IP6_ROUTE);
+	o->ip6_route.ifindex = 1;
+	o->ip6_route.gateway = *gateway;
+	lookup->cache_id_type = NMP_CACHE_ID_TYPE_ROUTES_BY_GATEWAY;
+	return _L (lookup);
+}
+
 const NMPLookup *
 nmp_lookup_init_object_by_addr_family (NMPLookup *lookup,
                                        NMPObjectType obj_type,
@@ -3056,6 +3604,7 @@ const NMPClass _nmp_classes[NMP_OBJECT_TYPE_MAX] = {
 	[NMP_OBJECT_TYPE_IP4_ADDRESS - 1] = {
 		.parent                             = DEDUP_MULTI_OBJ_CLASS_INIT(),
 		.obj_type                           = NMP_OBJECT_TYPE_IP4_ADDRESS,
+		.alloc_slab                         = TRUE,
 		.sizeof_data                        = sizeof (NMPObjectIP4Address),
 		.sizeof_public                      = sizeof (NMPlatformIP4Address),
 		.obj_type_name                      = "ip4-address",
@@ -3076,6 +3625,7 @@ const NMPClass _nmp_classes[NMP_OBJECT_TYPE_MAX] = {
 	[NMP_OBJECT_TYPE_IP6_ADDRESS - 1] = {
 		.parent                             = DEDUP_MULTI_OBJ_CLASS_INIT(),
 		.obj_type                           = NMP_OBJECT_TYPE_IP6_ADDRESS,
+		.alloc_slab                         = TRUE,
 		.sizeof_data                        = sizeof (NMPObjectIP6Address),
 		.sizeof_public                      = sizeof (NMPlatformIP6Address),
 		.obj_type_name                      = "ip6-address",
@@ -3096,6 +3646,7 @@ const NMPClass _nmp_classes[NMP_OBJECT_TYPE_MAX] = {
 	[NMP_OBJECT_TYPE_IP4_ROUTE - 1] = {
 		.parent                             = DEDUP_MULTI_OBJ_CLASS_INIT(),
 		.obj_type                           = NMP_OBJECT_TYPE_IP4_ROUTE,
+		.alloc_slab                         = TRUE,
 		.sizeof_data                        = sizeof (NMPObjectIP4Route),
 		.sizeof_public                      = sizeof (NMPlatformIP4Route),
 		.obj_type_name                      = "ip4-route",
@@ -3104,7 +3655,12 @@ const NMPClass _nmp_classes[NMP_OBJECT_TYPE_MAX] = {
 		.signal_type_id                     = NM_PLATFORM_SIGNAL_ID_IP4_ROUTE,
 		.signal_type                        = NM_PLATFORM_SIGNAL_IP4_ROUTE_CHANGED,
 		.supported_cache_ids                = _supported_cache_ids_ipx_route,
+		.cmd_obj_hash_update                = _vt_cmd_obj_hash_update_ip4_route,
+		.cmd_obj_cmp                        = _vt_cmd_obj_cmp_ip4_route,
+		.cmd_obj_copy                       = _vt_cmd_obj_copy_ip4_route,
+		.cmd_obj_dispose                    = _vt_cmd_obj_dispose_ip4_route,
 		.cmd_obj_is_alive                   = _vt_cmd_obj_is_alive_ipx_route,
+		.cmd_obj_to_string                  = _vt_cmd_obj_to_string_ipx_route,
 		.cmd_plobj_id_copy                  = _vt_cmd_plobj_id_copy_ip4_route,
 		.cmd_plobj_id_cmp                   = _vt_cmd_plobj_id_cmp_ip4_route,
 		.cmd_plobj_id_hash_update           = _vt_cmd_plobj_id_hash_update_ip4_route,
@@ -3116,6 +3672,7 @@ const NMPClass _nmp_classes[NMP_OBJECT_TYPE_MAX] = {
 	[NMP_OBJECT_TYPE_IP6_ROUTE - 1] = {
 		.parent                             = DEDUP_MULTI_OBJ_CLASS_INIT(),
 		.obj_type                           = NMP_OBJECT_TYPE_IP6_ROUTE,
+		.alloc_slab                         = TRUE,
 		.sizeof_data                        = sizeof (NMPObjectIP6Route),
 		.sizeof_public                      = sizeof (NMPlatformIP6Route),
 		.obj_type_name                      = "ip6-route",
@@ -3124,7 +3681,12 @@ const NMPClass _nmp_classes[NMP_OBJECT_TYPE_MAX] = {
 		.signal_type_id                     = NM_PLATFORM_SIGNAL_ID_IP6_ROUTE,
 		.signal_type                        = NM_PLATFORM_SIGNAL_IP6_ROUTE_CHANGED,
 		.supported_cache_ids                = _supported_cache_ids_ipx_route,
+		.cmd_obj_hash_update                = _vt_cmd_obj_hash_update_ip6_route,
+		.cmd_obj_cmp                        = _vt_cmd_obj_cmp_ip6_route,
+		.cmd_obj_copy                       = _vt_cmd_obj_copy_ip6_route,
+		.cmd_obj_dispose                    = _vt_cmd_obj_dispose_ip6_route,
 		.cmd_obj_is_alive                   = _vt_cmd_obj_is_alive_ipx_route,
+		.cmd_obj_to_string                  = _vt_cmd_obj_to_string_ipx_route,
 		.cmd_plobj_id_copy                  = _vt_cmd_plobj_id_copy_ip6_route,
 		.cmd_plobj_id_cmp                   = _vt_cmd_plobj_id_cmp_ip6_route,
 		.cmd_plobj_id_hash_update           = _vt_cmd_plobj_id_hash_update_ip6_route,
@@ -3133,9 +3695,52 @@ const NMPClass _nmp_classes[NMP_OBJECT_TYPE_MAX] = {
 		.cmd_plobj_hash_update              = _vt_cmd_plobj_hash_update_ip6_route,
 		.cmd_plobj_cmp                      = (int (*) (const NMPlatformObject *obj1, const NMPlatformObject *obj2)) nm_platform_ip6_route_cmp_full,
 	},
+	[NMP_OBJECT_TYPE_IP4_NEXTHOP - 1] = {
+		.parent                             = DEDUP_MULTI_OBJ_CLASS_INIT(),
+		.obj_type                           = NMP_OBJECT_TYPE_IP4_NEXTHOP,
+		.alloc_slab                         = TRUE,
+		.sizeof_data                        = sizeof (NMPObjectIP4Nexthop),
+		.sizeof_public                      = sizeof (NMPlatformIP4Nexthop),
+		.obj_type_name                      = "ip4-nexthop",
+		.addr_family                        = AF_INET,
+		.rtm_gettype                        = RTM_GETNEXTHOP,
+		.signal_type_id                     = NM_PLATFORM_SIGNAL_ID_IP4_NEXTHOP,
+		.signal_type                        = NM_PLATFORM_SIGNAL_IP4_NEXTHOP_CHANGED,
+		.supported_cache_ids                = _supported_cache_ids_object,
+		.cmd_obj_is_alive                   = _vt_cmd_obj_is_alive_ipx_nexthop,
+		.cmd_plobj_id_copy                  = _vt_cmd_plobj_id_copy_ip4_nexthop,
+		.cmd_plobj_id_cmp                   = _vt_cmd_plobj_id_cmp_ip4_nexthop,
+		.cmd_plobj_id_hash_update           = _vt_cmd_plobj_id_hash_update_ip4_nexthop,
+		.cmd_plobj_to_string_id             = _vt_cmd_plobj_to_string_id_ip4_nexthop,
+		.cmd_plobj_to_string                = (const char *(*) (const NMPlatformObject *obj, char *buf, gsize len)) nm_platform_ip4_nexthop_to_string,
+		.cmd_plobj_hash_update              = (void (*) (const NMPlatformObject *obj, NMHashState *h)) nm_platform_ip4_nexthop_hash_update,
+		.cmd_plobj_cmp                      = (int (*) (const NMPlatformObject *obj1, const NMPlatformObject *obj2)) nm_platform_ip4_nexthop_cmp,
+	},
+	[NMP_OBJECT_TYPE_IP6_NEXTHOP - 1] = {
+		.parent                             = DEDUP_MULTI_OBJ_CLASS_INIT(),
+		.obj_type                           = NMP_OBJECT_TYPE_IP6_NEXTHOP,
+		.alloc_slab                         = TRUE,
+		.sizeof_data                        = sizeof (NMPObjectIP6Nexthop),
+		.sizeof_public                      = sizeof (NMPlatformIP6Nexthop),
+		.obj_type_name                      = "ip6-nexthop",
+		.addr_family                        = AF_INET6,
+		.rtm_gettype                        = RTM_GETNEXTHOP,
+		.signal_type_id                     = NM_PLATFORM_SIGNAL_ID_IP6_NEXTHOP,
+		.signal_type                        = NM_PLATFORM_SIGNAL_IP6_NEXTHOP_CHANGED,
+		.supported_cache_ids                = _supported_cache_ids_object,
+		.cmd_obj_is_alive                   = _vt_cmd_obj_is_alive_ipx_nexthop,
+		.cmd_plobj_id_copy                  = _vt_cmd_plobj_id_copy_ip6_nexthop,
+		.cmd_plobj_id_cmp                   = _vt_cmd_plobj_id_cmp_ip6_nexthop,
+		.cmd_plobj_id_hash_update           = _vt_cmd_plobj_id_hash_update_ip6_nexthop,
+		.cmd_plobj_to_string_id             = _vt_cmd_plobj_to_string_id_ip6_nexthop,
+		.cmd_plobj_to_string                = (const char *(*) (const NMPlatformObject *obj, char *buf, gsize len)) nm_platform_ip6_nexthop_to_string,
+		.cmd_plobj_hash_update              = (void (*) (const NMPlatformObject *obj, NMHashState *h)) nm_platform_ip6_nexthop_hash_update,
+		.cmd_plobj_cmp                      = (int (*) (const NMPlatformObject *obj1, const NMPlatformObject *obj2)) nm_platform_ip6_nexthop_cmp,
+	},
 	[NMP_OBJECT_TYPE_ROUTING_RULE - 1] = {
 		.parent                             = DEDUP_MULTI_OBJ_CLASS_INIT(),
 		.obj_type                           = NMP_OBJECT_TYPE_ROUTING_RULE,
+		.alloc_slab                         = TRUE,
 		.sizeof_data                        = sizeof (NMPObjectRoutingRule),
 		.sizeof_public                      = sizeof (NMPlatformRoutingRule),
 		.obj_type_name                      = "routing-rule",
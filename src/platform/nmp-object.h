@@ -164,6 +164,15 @@ typedef enum { /*< skip >*/
 	 * Note that currently on NMPObjectRoutingRule is indexed by this filter. */
 	NMP_CACHE_ID_TYPE_OBJECT_BY_ADDR_FAMILY,
 
+	/* the visible routes (by object-type, hence by address family) of one
+	 * routing table, regardless of the ifindex. */
+	NMP_CACHE_ID_TYPE_ROUTES_BY_TABLE,
+
+	/* the visible routes (by object-type) via a certain gateway, regardless of the
+	 * ifindex and table. Only routes with a gateway are indexed. For ECMP routes,
+	 * that is the gateway of the first nexthop. */
+	NMP_CACHE_ID_TYPE_ROUTES_BY_GATEWAY,
+
 	__NMP_CACHE_ID_TYPE_MAX,
 	NMP_CACHE_ID_TYPE_MAX = __NMP_CACHE_ID_TYPE_MAX - 1,
 } NMPCacheIdType;
@@ -184,6 +193,11 @@ typedef struct {
 	/* Only for NMPObjectLnk* types. */
 	NMLinkType lnk_link_type;
 
+	/* Whether instances are allocated from the per-type slab (see
+	 * nmp_object_alloc_stats_get()). Only worthwhile for types that
+	 * can have very many instances in the cache. */
+	bool alloc_slab:1;
+
 	void (*cmd_obj_hash_update) (const NMPObject *obj, NMHashState *h);
 	int (*cmd_obj_cmp) (const NMPObject *obj1, const NMPObject *obj2);
 	void (*cmd_obj_copy) (NMPObject *dst, const NMPObject *src);
@@ -212,6 +226,11 @@ typedef struct {
 
 		/* Additional data that depends on the link-type (IFLA_INFO_DATA) */
 		const NMPObject *lnk;
+
+		/* the hash of IFLA_INFO_KIND and IFLA_INFO_DATA that @lnk was parsed
+		 * from, or zero. As long as it doesn't change, the next RTM_NEWLINK
+		 * reuses @lnk instead of parsing it again. */
+		guint64 lnk_hash;
 	} netlink;
 
 	struct {
@@ -304,6 +323,11 @@ typedef struct {
 
 typedef struct {
 	NMPlatformIP4Route _public;
+
+	/* For ECMP routes, the (_public.n_nexthops - 1) nexthops after the first one.
+	 * Note that objects that are only initialized from the public part (like
+	 * stack-allocated objects) don't have them. */
+	const NMPlatformIP4RtNextHop *extra_nexthops;
 } NMPObjectIP4Route;
 
 typedef struct {
@@ -312,8 +336,19 @@ typedef struct {
 
 typedef struct {
 	NMPlatformIP6Route _public;
+
+	/* see NMPObjectIP4Route.extra_nexthops */
+	const NMPlatformIP6RtNextHop *extra_nexthops;
 } NMPObjectIP6Route;
 
+typedef struct {
+	NMPlatformIP4Nexthop _public;
+} NMPObjectIP4Nexthop;
+
+typedef struct {
+	NMPlatformIP6Nexthop _public;
+} NMPObjectIP6Nexthop;
+
 typedef struct {
 	NMPlatformRoutingRule _public;
 } NMPObjectRoutingRule;
@@ -386,6 +421,13 @@ struct _NMPObject {
 		NMPObjectIP4Route       _ip4_route;
 		NMPObjectIP6Route       _ip6_route;
 
+		NMPlatformIPNexthop     ip_nexthop;
+		NMPlatformIPXNexthop    ipx_nexthop;
+		NMPlatformIP4Nexthop    ip4_nexthop;
+		NMPlatformIP6Nexthop    ip6_nexthop;
+		NMPObjectIP4Nexthop     _ip4_nexthop;
+		NMPObjectIP6Nexthop     _ip6_nexthop;
+
 		NMPlatformRoutingRule   routing_rule;
 		NMPObjectRoutingRule    _routing_rule;
 
@@ -475,6 +517,8 @@ _NMP_OBJECT_TYPE_IS_OBJ_WITH_IFINDEX (NMPObjectType obj_type)
 	case NMP_OBJECT_TYPE_IP6_ADDRESS:
 	case NMP_OBJECT_TYPE_IP4_ROUTE:
 	case NMP_OBJECT_TYPE_IP6_ROUTE:
+	case NMP_OBJECT_TYPE_IP4_NEXTHOP:
+	case NMP_OBJECT_TYPE_IP6_NEXTHOP:
 
 	case NMP_OBJECT_TYPE_QDISC:
 
@@ -537,6 +581,10 @@ _NMP_OBJECT_TYPE_IS_OBJ_WITH_IFINDEX (NMPObjectType obj_type)
 #define NMP_OBJECT_CAST_IPX_ROUTE(obj)     _NMP_OBJECT_CAST (obj, ipx_route,     NMP_OBJECT_TYPE_IP4_ROUTE, NMP_OBJECT_TYPE_IP6_ROUTE)
 #define NMP_OBJECT_CAST_IP4_ROUTE(obj)     _NMP_OBJECT_CAST (obj, ip4_route,     NMP_OBJECT_TYPE_IP4_ROUTE)
 #define NMP_OBJECT_CAST_IP6_ROUTE(obj)     _NMP_OBJECT_CAST (obj, ip6_route,     NMP_OBJECT_TYPE_IP6_ROUTE)
+#define NMP_OBJECT_CAST_IP_NEXTHOP(obj)    _NMP_OBJECT_CAST (obj, ip_nexthop,    NMP_OBJECT_TYPE_IP4_NEXTHOP, NMP_OBJECT_TYPE_IP6_NEXTHOP)
+#define NMP_OBJECT_CAST_IPX_NEXTHOP(obj)   _NMP_OBJECT_CAST (obj, ipx_nexthop,   NMP_OBJECT_TYPE_IP4_NEXTHOP, NMP_OBJECT_TYPE_IP6_NEXTHOP)
+#define NMP_OBJECT_CAST_IP4_NEXTHOP(obj)   _NMP_OBJECT_CAST (obj, ip4_nexthop,   NMP_OBJECT_TYPE_IP4_NEXTHOP)
+#define NMP_OBJECT_CAST_IP6_NEXTHOP(obj)   _NMP_OBJECT_CAST (obj, ip6_nexthop,   NMP_OBJECT_TYPE_IP6_NEXTHOP)
 #define NMP_OBJECT_CAST_ROUTING_RULE(obj)  _NMP_OBJECT_CAST (obj, routing_rule,  NMP_OBJECT_TYPE_ROUTING_RULE)
 #define NMP_OBJECT_CAST_QDISC(obj)         _NMP_OBJECT_CAST (obj, qdisc,         NMP_OBJECT_TYPE_QDISC)
 #define NMP_OBJECT_CAST_TFILTER(obj)       _NMP_OBJECT_CAST (obj, tfilter,       NMP_OBJECT_TYPE_TFILTER)
@@ -585,6 +633,23 @@ nmp_object_unref (const NMPObject *obj)
 		_changed; \
 	})
 
+typedef struct {
+	/* the size of one object and of one slab page, or zero
+	 * if the type is not allocated from the slab. */
+	gsize obj_size;
+	gsize page_size;
+
+	/* the number of currently allocated pages. */
+	guint n_pages;
+
+	/* the number of live objects, and the number of allocations
+	 * since start. */
+	guint64 n_objs;
+	guint64 n_allocs;
+} NMPObjectAllocStats;
+
+void nmp_object_alloc_stats_get (NMPObjectType obj_type, NMPObjectAllocStats *out_stats);
+
 NMPObject *nmp_object_new (NMPObjectType obj_type, gconstpointer plobj);
 NMPObject *nmp_object_new_link (int ifindex);
 
@@ -613,6 +678,25 @@ nmp_object_equal (const NMPObject *obj1, const NMPObject *obj2)
 	return nmp_object_cmp (obj1, obj2) == 0;
 }
 
+static inline guint
+nmp_object_ip_route_get_n_extra_nexthops (const NMPObject *obj)
+{
+	gconstpointer extra_nexthops;
+
+	nm_assert (NM_IN_SET (NMP_OBJECT_GET_TYPE (obj), NMP_OBJECT_TYPE_IP4_ROUTE, NMP_OBJECT_TYPE_IP6_ROUTE));
+
+	extra_nexthops = NMP_OBJECT_GET_TYPE (obj) == NMP_OBJECT_TYPE_IP4_ROUTE
+	                 ? (gconstpointer) obj->_ip4_route.extra_nexthops
+	                 : (gconstpointer) obj->_ip6_route.extra_nexthops;
+	if (!extra_nexthops)
+		return 0;
+
+	nm_assert (obj->ip_route.n_nexthops > 1);
+	return obj->ip_route.n_nexthops - 1u;
+}
+
+int nmp_object_ip_route_cmp_extra_nexthops (const NMPObject *obj1, const NMPObject *obj2);
+
 void nmp_object_copy (NMPObject *dst, const NMPObject *src, gboolean id_only);
 NMPObject *nmp_object_clone (const NMPObject *obj, gboolean id_only);
 
@@ -695,6 +779,13 @@ const NMPLookup *nmp_lookup_init_ip6_route_by_weak_id (NMPLookup *lookup,
                                                        guint32 metric,
                                                        const struct in6_addr *src,
                                                        guint8 src_plen);
+const NMPLookup *nmp_lookup_init_route_by_table (NMPLookup *lookup,
+                                                 NMPObjectType obj_type,
+                                                 guint32 table);
+const NMPLookup *nmp_lookup_init_ip4_route_by_gateway (NMPLookup *lookup,
+                                                       in_addr_t gateway);
+const NMPLookup *nmp_lookup_init_ip6_route_by_gateway (NMPLookup *lookup,
+                                                       const struct in6_addr *gateway);
 const NMPLookup *nmp_lookup_init_object_by_addr_family (NMPLookup *lookup,
                                                         NMPObjectType obj_type,
                                                         int addr_family);
@@ -970,6 +1061,37 @@ nm_platform_lookup_ip6_route_by_weak_id (NMPlatform *platform,
 	return nm_platform_lookup (platform, &lookup);
 }
 
+static inline const NMDedupMultiHeadEntry *
+nm_platform_lookup_route_by_table (NMPlatform *platform,
+                                   NMPObjectType obj_type,
+                                   guint32 table)
+{
+	NMPLookup lookup;
+
+	nmp_lookup_init_route_by_table (&lookup, obj_type, table);
+	return nm_platform_lookup (platform, &lookup);
+}
+
+static inline const NMDedupMultiHeadEntry *
+nm_platform_lookup_ip4_route_by_gateway (NMPlatform *platform,
+                                         in_addr_t gateway)
+{
+	NMPLookup lookup;
+
+	nmp_lookup_init_ip4_route_by_gateway (&lookup, gateway);
+	return nm_platform_lookup (platform, &lookup);
+}
+
+static inline const NMDedupMultiHeadEntry *
+nm_platform_lookup_ip6_route_by_gateway (NMPlatform *platform,
+                                         const struct in6_addr *gateway)
+{
+	NMPLookup lookup;
+
+	nmp_lookup_init_ip6_route_by_gateway (&lookup, gateway);
+	return nm_platform_lookup (platform, &lookup);
+}
+
 static inline const NMDedupMultiHeadEntry *
 nm_platform_lookup_object_by_addr_family (NMPlatform *platform,
                                           NMPObjectType obj_type,
@@ -17,6 +17,12 @@ struct _NMPRulesManager {
 	GHashTable *by_obj;
 	GHashTable *by_user_tag;
 	GHashTable *by_data;
+
+	/* the RulesObjData entries that need to be considered during the
+	 * next sync, because their tracking or their platform state changed. */
+	CList changed_lst_head;
+
+	gulong platform_rule_changed_id;
 	guint ref_count;
 };
 
@@ -101,6 +107,9 @@ typedef struct {
 	const NMPObject *obj;
 	CList obj_lst_head;
 
+	/* linked in NMPRulesManager.changed_lst_head. */
+	CList changed_lst;
+
 	/* indicates whether we configured/removed the rule (during sync()). We need that, so
 	 * if the rule gets untracked, that we know to remove/restore it.
 	 *
@@ -242,10 +251,19 @@ _rules_obj_destroy (gpointer data)
 	RulesObjData *obj_data = data;
 
 	c_list_unlink_stale (&obj_data->obj_lst_head);
+	c_list_unlink (&obj_data->changed_lst);
 	nmp_object_unref (obj_data->obj);
 	g_slice_free (RulesObjData, obj_data);
 }
 
+static void
+_rules_obj_set_changed (NMPRulesManager *self,
+                        RulesObjData *obj_data)
+{
+	if (!c_list_is_linked (&obj_data->changed_lst))
+		c_list_link_tail (&self->changed_lst_head, &obj_data->changed_lst);
+}
+
 static guint
 _rules_user_tag_hash (gconstpointer data)
 {
@@ -359,6 +377,7 @@ nmp_rules_manager_track (NMPRulesManager *self,
 			*obj_data = (RulesObjData) {
 				.obj          = nmp_object_ref (rules_data->obj),
 				.obj_lst_head = C_LIST_INIT (obj_data->obj_lst_head),
+				.changed_lst  = C_LIST_INIT (obj_data->changed_lst),
 				.config_state = CONFIG_STATE_NONE,
 			};
 			g_hash_table_add (self->by_obj, obj_data);
@@ -375,6 +394,7 @@ nmp_rules_manager_track (NMPRulesManager *self,
 			g_hash_table_add (self->by_user_tag, user_tag_data);
 		}
 		c_list_link_tail (&user_tag_data->user_tag_lst_head, &rules_data->user_tag_lst);
+		_rules_obj_set_changed (self, obj_data);
 		changed = TRUE;
 	} else {
 		rules_data->dirty = FALSE;
@@ -382,6 +402,9 @@ nmp_rules_manager_track (NMPRulesManager *self,
 		    || rules_data->track_priority_present != track_priority_present) {
 			rules_data->track_priority_val = track_priority_val;
 			rules_data->track_priority_present = track_priority_present;
+			obj_data = g_hash_table_lookup (self->by_obj, &rules_data->obj);
+			nm_assert (obj_data);
+			_rules_obj_set_changed (self, obj_data);
 			changed = TRUE;
 		}
 	}
@@ -446,6 +469,8 @@ _rules_data_untrack (NMPRulesManager *self,
 	nm_assert (c_list_contains (&obj_data->obj_lst_head, &rules_data->obj_lst));
 	nm_assert (obj_data == g_hash_table_lookup (self->by_obj, &rules_data->obj));
 
+	_rules_obj_set_changed (self, obj_data);
+
 	if (make_owned_by_us) {
 		if (obj_data->config_state == CONFIG_STATE_NONE) {
 			/* we need to mark this entry that it requires a touch on the next
@@ -538,16 +563,25 @@ nmp_rules_manager_untrack_all (NMPRulesManager *self,
 		g_hash_table_remove (self->by_user_tag, user_tag_data);
 }
 
+/**
+ * nmp_rules_manager_sync:
+ * @self: the #NMPRulesManager instance
+ * @keep_deleted_rules: if %TRUE, don't remove rules that are no longer
+ *   tracked, but forget about them.
+ *
+ * Adds and removes rules in platform. Only rules whose tracking state or
+ * platform state changed since the previous sync are considered. Rules
+ * that nobody touched are not even looked at.
+ */
 void
 nmp_rules_manager_sync (NMPRulesManager *self,
                         gboolean keep_deleted_rules)
 {
-	const NMDedupMultiHeadEntry *pl_head_entry;
-	NMDedupMultiIter pl_iter;
 	const NMPObject *plobj;
 	gs_unref_ptrarray GPtrArray *rules_to_delete = NULL;
 	RulesObjData *obj_data;
-	GHashTableIter h_iter;
+	RulesObjData *obj_data_safe;
+	CList changed_lst_head;
 	guint i;
 	const RulesData *rd_best;
 
@@ -556,48 +590,54 @@ nmp_rules_manager_sync (NMPRulesManager *self,
 	if (!self->by_data)
 		return;
 
-	_LOGD ("sync%s", keep_deleted_rules ? " (don't remove any rules)" : "");
+	if (c_list_is_empty (&self->changed_lst_head)) {
+		_LOGD ("sync%s: no changes", keep_deleted_rules ? " (don't remove any rules)" : "");
+		return;
+	}
+
+	_LOGD ("sync%s: %u changed rules",
+	       keep_deleted_rules ? " (don't remove any rules)" : "",
+	       (guint) c_list_length (&self->changed_lst_head));
 
-	pl_head_entry = nm_platform_lookup_obj_type (self->platform, NMP_OBJECT_TYPE_ROUTING_RULE);
-	if (pl_head_entry) {
-		nmp_cache_iter_for_each (&pl_iter, pl_head_entry, &plobj) {
-			obj_data = g_hash_table_lookup (self->by_obj, &plobj);
+	/* move the changed entries aside, they are all handled now. Changes
+	 * in platform that happen meanwhile (including our own) mark the rules
+	 * as changed again, for the next sync. */
+	c_list_init (&changed_lst_head);
+	c_list_splice (&changed_lst_head, &self->changed_lst_head);
+
+	c_list_for_each_entry (obj_data, &changed_lst_head, changed_lst) {
+		plobj = nm_platform_lookup_obj (self->platform, NMP_CACHE_ID_TYPE_OBJECT_TYPE, obj_data->obj);
+		if (!plobj)
+			continue;
 
-			if (!obj_data) {
-				/* this rule is not tracked. It was externally added, hence we
-				 * ignore it. */
+		rd_best = _rules_obj_get_best_data (obj_data);
+		if (rd_best) {
+			if (rd_best->track_priority_present) {
+				if (obj_data->config_state == CONFIG_STATE_OWNED_BY_US)
+					obj_data->config_state = CONFIG_STATE_ADDED_BY_US;
 				continue;
 			}
-
-			rd_best = _rules_obj_get_best_data (obj_data);
-			if (rd_best) {
-				if (rd_best->track_priority_present) {
-					if (obj_data->config_state == CONFIG_STATE_OWNED_BY_US)
-						obj_data->config_state = CONFIG_STATE_ADDED_BY_US;
-					continue;
-				}
-				if (rd_best->track_priority_val == 0) {
-					if (!NM_IN_SET (obj_data->config_state, CONFIG_STATE_ADDED_BY_US,
-					                                        CONFIG_STATE_OWNED_BY_US)) {
-						obj_data->config_state = CONFIG_STATE_NONE;
-						continue;
-					}
+			if (rd_best->track_priority_val == 0) {
+				if (!NM_IN_SET (obj_data->config_state, CONFIG_STATE_ADDED_BY_US,
+				                                        CONFIG_STATE_OWNED_BY_US)) {
 					obj_data->config_state = CONFIG_STATE_NONE;
+					continue;
 				}
+				obj_data->config_state = CONFIG_STATE_NONE;
 			}
+		}
 
-			if (keep_deleted_rules) {
-				_LOGD ("forget/leak rule added by us: %s", nmp_object_to_string (plobj, NMP_OBJECT_TO_STRING_PUBLIC, NULL, 0));
-				continue;
-			}
+		if (keep_deleted_rules) {
+			_LOGD ("forget/leak rule added by us: %s", nmp_object_to_string (plobj, NMP_OBJECT_TO_STRING_PUBLIC, NULL, 0));
+			continue;
+		}
 
-			if (!rules_to_delete)
-				rules_to_delete = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
+		if (!rules_to_delete)
+			rules_to_delete = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
 
-			g_ptr_array_add (rules_to_delete, (gpointer) nmp_object_ref (plobj));
+		g_ptr_array_add (rules_to_delete, (gpointer) nmp_object_ref (plobj));
 
-			obj_data->config_state = CONFIG_STATE_REMOVED_BY_US;
-		}
+		obj_data->config_state = CONFIG_STATE_REMOVED_BY_US;
 	}
 
 	if (rules_to_delete) {
@@ -605,13 +645,14 @@ nmp_rules_manager_sync (NMPRulesManager *self,
 			nm_platform_object_delete (self->platform, rules_to_delete->pdata[i]);
 	}
 
-	g_hash_table_iter_init (&h_iter, self->by_obj);
-	while (g_hash_table_iter_next (&h_iter, (gpointer *) &obj_data, NULL)) {
+	c_list_for_each_entry_safe (obj_data, obj_data_safe, &changed_lst_head, changed_lst) {
+
+		c_list_unlink (&obj_data->changed_lst);
 
 		rd_best = _rules_obj_get_best_data (obj_data);
 
 		if (!rd_best) {
-			g_hash_table_iter_remove (&h_iter);
+			g_hash_table_remove (self->by_obj, obj_data);
 			continue;
 		}
 
@@ -636,6 +677,8 @@ nmp_rules_manager_sync (NMPRulesManager *self,
 		obj_data->config_state = CONFIG_STATE_ADDED_BY_US;
 		nm_platform_routing_rule_add (self->platform, NMP_NLM_FLAG_ADD, NMP_OBJECT_CAST_ROUTING_RULE (obj_data->obj));
 	}
+
+	nm_assert (c_list_is_empty (&changed_lst_head));
 }
 
 void
@@ -760,6 +803,28 @@ _rules_init (NMPRulesManager *self)
 
 /*****************************************************************************/
 
+static void
+_platform_routing_rule_changed_cb (NMPlatform *platform,
+                                   int obj_type_i,
+                                   int ifindex,
+                                   const NMPlatformRoutingRule *routing_rule,
+                                   int change_type_i,
+                                   NMPRulesManager *self)
+{
+	const NMPObject *obj;
+	RulesObjData *obj_data;
+
+	if (!self->by_obj)
+		return;
+
+	/* a tracked rule was added or removed, possibly by somebody else. The next
+	 * sync needs to have a look at it. */
+	obj = NMP_OBJECT_UP_CAST (routing_rule);
+	obj_data = g_hash_table_lookup (self->by_obj, &obj);
+	if (obj_data)
+		_rules_obj_set_changed (self, obj_data);
+}
+
 NMPRulesManager *
 nmp_rules_manager_new (NMPlatform *platform)
 {
@@ -769,9 +834,14 @@ nmp_rules_manager_new (NMPlatform *platform)
 
 	self = g_slice_new (NMPRulesManager);
 	*self = (NMPRulesManager) {
-		.ref_count     = 1,
-		.platform      = g_object_ref (platform),
+		.ref_count        = 1,
+		.platform         = g_object_ref (platform),
+		.changed_lst_head = C_LIST_INIT (self->changed_lst_head),
 	};
+	self->platform_rule_changed_id = g_signal_connect (platform,
+	                                                   NM_PLATFORM_SIGNAL_ROUTING_RULE_CHANGED,
+	                                                   G_CALLBACK (_platform_routing_rule_changed_cb),
+	                                                   self);
 	return self;
 }
 
@@ -790,6 +860,8 @@ void nmp_rules_manager_unref (NMPRulesManager *self)
 	if (--self->ref_count > 0)
 		return;
 
+	nm_clear_g_signal_handler (self->platform, &self->platform_rule_changed_id);
+
 	if (self->by_data) {
 		g_hash_table_destroy (self->by_user_tag);
 		g_hash_table_destroy (self->by_obj);
@@ -0,0 +1,368 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Copyright (C) 2020 Red Hat, Inc.
+ */
+
+#include "nm-default.h"
+
+#include <linux/rtnetlink.h>
+
+#include "platform/nmp-object.h"
+
+#include "test-common.h"
+
+/*****************************************************************************
+ * Scale benchmarks for NMPlatform.
+ *
+ * The benchmarks are built against both the fake platform and the linux
+ * platform (bench-platform-fake, bench-platform-linux). Like the root tests,
+ * the linux variant runs in an unshared network namespace so it does not
+ * touch the host configuration.
+ *
+ * Each measurement is printed to stdout as one JSON object per line, starting
+ * with '{'. Filter other output (TAP, logging) with "grep '^{'". The largest
+ * sizes only run in perf mode ("-m perf").
+ *****************************************************************************/
+
+#define BENCH_ROUTE_METRIC 20121
+
+static const char *
+_bench_platform_name (void)
+{
+	return nmtstp_is_root_test () ? "linux" : "fake";
+}
+
+static void
+_bench_report (const char *bench,
+               const char *phase,
+               int addr_family,
+               guint n,
+               gint64 duration_ns)
+{
+	g_print ("{"
+	         "\"bench\":\"%s\","
+	         "\"phase\":\"%s\","
+	         "\"platform\":\"%s\","
+	         "\"family\":%s,"
+	         "\"n\":%u,"
+	         "\"duration_ns\":%"G_GINT64_FORMAT","
+	         "\"ns_per_op\":%"G_GINT64_FORMAT
+	         "}\n",
+	         bench,
+	         phase,
+	         _bench_platform_name (),
+	         addr_family == AF_UNSPEC ? "null" : (addr_family == AF_INET ? "4" : "6"),
+	         n,
+	         duration_ns,
+	         n > 0 ? duration_ns / n : (gint64) 0);
+}
+
+#define _bench_start() nm_utils_clock_gettime_ns (CLOCK_MONOTONIC)
+
+#define _bench_stop(bench, phase, addr_family, n, start_ns) \
+	_bench_report ((bench), (phase), (addr_family), (n), nm_utils_clock_gettime_ns (CLOCK_MONOTONIC) - (start_ns))
+
+/*****************************************************************************/
+
+static NMPObject *
+_bench_route_new (int addr_family, int ifindex, guint i)
+{
+	if (addr_family == AF_INET) {
+		const NMPlatformIP4Route r = {
+			.ifindex = ifindex,
+			.rt_source = NM_IP_CONFIG_SOURCE_USER,
+			.network = htonl (0x0A000000u + i),
+			.plen = 32,
+			.metric = BENCH_ROUTE_METRIC,
+		};
+
+		return nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, &r);
+	} else {
+		NMPlatformIP6Route r = {
+			.ifindex = ifindex,
+			.rt_source = NM_IP_CONFIG_SOURCE_USER,
+			.plen = 128,
+			.metric = BENCH_ROUTE_METRIC,
+		};
+
+		r.network.s6_addr32[0] = htonl (0x20010db8u);
+		r.network.s6_addr32[3] = htonl (i + 1);
+		return nmp_object_new (NMP_OBJECT_TYPE_IP6_ROUTE, &r);
+	}
+}
+
+static GPtrArray *
+_bench_routes_new (int addr_family, int ifindex, guint n)
+{
+	GPtrArray *routes;
+	guint i;
+
+	routes = g_ptr_array_new_full (n, (GDestroyNotify) nmp_object_unref);
+	for (i = 0; i < n; i++)
+		g_ptr_array_add (routes, _bench_route_new (addr_family, ifindex, i));
+	return routes;
+}
+
+static void
+_bench_route_sync (int addr_family, guint n)
+{
+	const int ifindex = NMTSTP_ENV1_IFINDEX;
+	gs_unref_ptrarray GPtrArray *routes = NULL;
+	gs_unref_ptrarray GPtrArray *routes_prune = NULL;
+	gs_unref_ptrarray GPtrArray *routes_cur = NULL;
+	NMPLookup lookup;
+	gint64 start_ns;
+
+	routes = _bench_routes_new (addr_family, ifindex, n);
+
+	start_ns = _bench_start ();
+	g_assert (nm_platform_ip_route_sync (NM_PLATFORM_GET, addr_family, ifindex, routes, NULL, NULL));
+	_bench_stop ("route-sync", "add", addr_family, n, start_ns);
+
+	routes_cur = nm_platform_lookup_clone (NM_PLATFORM_GET,
+	                                       nmp_lookup_init_object (&lookup,
+	                                                               addr_family == AF_INET
+	                                                                 ? NMP_OBJECT_TYPE_IP4_ROUTE
+	                                                                 : NMP_OBJECT_TYPE_IP6_ROUTE,
+	                                                               ifindex),
+	                                       NULL, NULL);
+	g_assert (routes_cur);
+	g_assert_cmpint (routes_cur->len, >=, n);
+
+	start_ns = _bench_start ();
+	g_assert (nm_platform_ip_route_sync (NM_PLATFORM_GET, addr_family, ifindex, routes, NULL, NULL));
+	_bench_stop ("route-sync", "unchanged", addr_family, n, start_ns);
+
+	g_ptr_array_set_size (routes, 0);
+	routes_prune = nm_platform_ip_route_get_prune_list (NM_PLATFORM_GET,
+	                                                    addr_family,
+	                                                    ifindex,
+	                                                    NM_IP_ROUTE_TABLE_SYNC_MODE_ALL);
+
+	start_ns = _bench_start ();
+	g_assert (nm_platform_ip_route_sync (NM_PLATFORM_GET, addr_family, ifindex, routes, routes_prune, NULL));
+	_bench_stop ("route-sync", "prune", addr_family, n, start_ns);
+}
+
+static void
+bench_ip4_route_sync (gconstpointer test_data)
+{
+	_bench_route_sync (AF_INET, GPOINTER_TO_UINT (test_data));
+}
+
+static void
+bench_ip6_route_sync (gconstpointer test_data)
+{
+	_bench_route_sync (AF_INET6, GPOINTER_TO_UINT (test_data));
+}
+
+/*****************************************************************************/
+
+static GPtrArray *
+_bench_addresses_new (int addr_family, int ifindex, guint n)
+{
+	GPtrArray *addresses;
+	guint i;
+
+	addresses = g_ptr_array_new_full (n, (GDestroyNotify) nmp_object_unref);
+	for (i = 0; i < n; i++) {
+		if (addr_family == AF_INET) {
+			const NMPlatformIP4Address a = {
+				.ifindex = ifindex,
+				.address = htonl (0x0A800000u + i),
+				.peer_address = htonl (0x0A800000u + i),
+				.plen = 32,
+				.lifetime = NM_PLATFORM_LIFETIME_PERMANENT,
+				.preferred = NM_PLATFORM_LIFETIME_PERMANENT,
+			};
+
+			g_ptr_array_add (addresses, nmp_object_new (NMP_OBJECT_TYPE_IP4_ADDRESS, &a));
+		} else {
+			NMPlatformIP6Address a = {
+				.ifindex = ifindex,
+				.plen = 128,
+				.lifetime = NM_PLATFORM_LIFETIME_PERMANENT,
+				.preferred = NM_PLATFORM_LIFETIME_PERMANENT,
+				.n_ifa_flags = IFA_F_NODAD,
+			};
+
+			a.address.s6_addr32[0] = htonl (0x20010db8u);
+			a.address.s6_addr32[1] = htonl (0x00010000u);
+			a.address.s6_addr32[3] = htonl (i + 1);
+			g_ptr_array_add (addresses, nmp_object_new (NMP_OBJECT_TYPE_IP6_ADDRESS, &a));
+		}
+	}
+	return addresses;
+}
+
+static gboolean
+_bench_address_sync_one (int addr_family, int ifindex, GPtrArray *addresses)
+{
+	if (addr_family == AF_INET)
+		return nm_platform_ip4_address_sync (NM_PLATFORM_GET, ifindex, addresses);
+	return nm_platform_ip6_address_sync (NM_PLATFORM_GET, ifindex, addresses, TRUE);
+}
+
+static void
+_bench_address_sync (int addr_family, guint n)
+{
+	const int ifindex = NMTSTP_ENV1_IFINDEX;
+	gs_unref_ptrarray GPtrArray *addresses = NULL;
+	gint64 start_ns;
+
+	addresses = _bench_addresses_new (addr_family, ifindex, n);
+
+	start_ns = _bench_start ();
+	g_assert (_bench_address_sync_one (addr_family, ifindex, addresses));
+	_bench_stop ("address-sync", "add", addr_family, n, start_ns);
+
+	start_ns = _bench_start ();
+	g_assert (_bench_address_sync_one (addr_family, ifindex, addresses));
+	_bench_stop ("address-sync", "unchanged", addr_family, n, start_ns);
+
+	g_ptr_array_set_size (addresses, 0);
+
+	start_ns = _bench_start ();
+	g_assert (_bench_address_sync_one (addr_family, ifindex, addresses));
+	_bench_stop ("address-sync", "prune", addr_family, n, start_ns);
+}
+
+static void
+bench_ip4_address_sync (gconstpointer test_data)
+{
+	_bench_address_sync (AF_INET, GPOINTER_TO_UINT (test_data));
+}
+
+static void
+bench_ip6_address_sync (gconstpointer test_data)
+{
+	_bench_address_sync (AF_INET6, GPOINTER_TO_UINT (test_data));
+}
+
+/*****************************************************************************/
+
+static void
+bench_link_veth (gconstpointer test_data)
+{
+	const guint n = GPOINTER_TO_UINT (test_data);
+	gs_free int *ifindexes = g_new (int, n);
+	gint64 start_ns;
+	guint i;
+
+	start_ns = _bench_start ();
+	for (i = 0; i < n; i++) {
+		char name[IFNAMSIZ];
+		char peer[IFNAMSIZ];
+		const NMPlatformLink *plink = NULL;
+
+		nm_sprintf_buf (name, "nm-bench-%u", i);
+		nm_sprintf_buf (peer, "nm-benchp-%u", i);
+		g_assert (NMTST_NM_ERR_SUCCESS (nm_platform_link_veth_add (NM_PLATFORM_GET, name, peer, &plink)));
+		g_assert (plink);
+		ifindexes[i] = plink->ifindex;
+	}
+	_bench_stop ("link-veth", "add", AF_UNSPEC, n, start_ns);
+
+	start_ns = _bench_start ();
+	for (i = 0; i < n; i++)
+		g_assert (nm_platform_link_delete (NM_PLATFORM_GET, ifindexes[i]));
+	_bench_stop ("link-veth", "delete", AF_UNSPEC, n, start_ns);
+}
+
+/*****************************************************************************/
+
+static void
+bench_cache_update_route (gconstpointer test_data)
+{
+	const guint n = GPOINTER_TO_UINT (test_data);
+	nm_auto_unref_dedup_multi_index NMDedupMultiIndex *multi_idx = NULL;
+	gs_unref_ptrarray GPtrArray *routes = NULL;
+	NMPCache *cache;
+	gint64 start_ns;
+	guint i;
+
+	/* this measures the cache part of handling one RTM_NEWROUTE/RTM_DELROUTE
+	 * message, without parsing and without emitting signals. */
+
+	multi_idx = nm_dedup_multi_index_new ();
+	cache = nmp_cache_new (multi_idx, FALSE);
+
+	routes = _bench_routes_new (AF_INET, 1, n);
+
+	start_ns = _bench_start ();
+	for (i = 0; i < n; i++) {
+		nm_auto_nmpobj const NMPObject *obj_old = NULL;
+		nm_auto_nmpobj const NMPObject *obj_new = NULL;
+		nm_auto_nmpobj const NMPObject *obj_replace = NULL;
+		gboolean resync_required;
+
+		nmp_cache_update_netlink_route (cache, routes->pdata[i], FALSE, NLM_F_CREATE | NLM_F_EXCL,
+		                                &obj_old, &obj_new, &obj_replace, &resync_required);
+	}
+	_bench_stop ("cache-update-route", "add", AF_INET, n, start_ns);
+
+	start_ns = _bench_start ();
+	for (i = 0; i < n; i++) {
+		nm_auto_nmpobj NMPObject *obj = _bench_route_new (AF_INET, 1, i);
+		nm_auto_nmpobj const NMPObject *obj_old = NULL;
+		nm_auto_nmpobj const NMPObject *obj_new = NULL;
+		nm_auto_nmpobj const NMPObject *obj_replace = NULL;
+		gboolean resync_required;
+
+		nmp_cache_update_netlink_route (cache, obj, FALSE, 0,
+		                                &obj_old, &obj_new, &obj_replace, &resync_required);
+	}
+	_bench_stop ("cache-update-route", "unchanged", AF_INET, n, start_ns);
+
+	start_ns = _bench_start ();
+	for (i = 0; i < n; i++) {
+		nm_auto_nmpobj const NMPObject *obj_old = NULL;
+		nm_auto_nmpobj const NMPObject *obj_new = NULL;
+
+		nmp_cache_remove_netlink (cache, routes->pdata[i], &obj_old, &obj_new);
+	}
+	_bench_stop ("cache-update-route", "remove", AF_INET, n, start_ns);
+
+	nmp_cache_free (cache);
+}
+
+/*****************************************************************************/
+
+NMTstpSetupFunc const _nmtstp_setup_platform_func = SETUP;
+
+void
+_nmtstp_init_tests (int *argc, char ***argv)
+{
+	nmtst_init_with_logging (argc, argv, "WARN", "ALL");
+}
+
+void
+_nmtstp_setup_tests (void)
+{
+	static const guint route_sizes[] = { 1000, 10000, 100000 };
+	static const guint address_sizes[] = { 1000, 4000 };
+	guint i;
+
+#define add_test_func_data(testpath, test_func, arg) nmtstp_env1_add_test_func_data(testpath, test_func, arg, TRUE)
+	for (i = 0; i < G_N_ELEMENTS (route_sizes); i++) {
+		const guint n = route_sizes[i];
+		char path[100];
+
+		if (n > 10000 && !g_test_perf ())
+			continue;
+
+		add_test_func_data (nm_sprintf_buf (path, "/bench/route-sync/ip4/%u", n), bench_ip4_route_sync, GUINT_TO_POINTER (n));
+		add_test_func_data (nm_sprintf_buf (path, "/bench/route-sync/ip6/%u", n), bench_ip6_route_sync, GUINT_TO_POINTER (n));
+		add_test_func_data (nm_sprintf_buf (path, "/bench/cache-update/route/%u", n), bench_cache_update_route, GUINT_TO_POINTER (n));
+	}
+	for (i = 0; i < G_N_ELEMENTS (address_sizes); i++) {
+		const guint n = address_sizes[i];
+		char path[100];
+
+		add_test_func_data (nm_sprintf_buf (path, "/bench/address-sync/ip4/%u", n), bench_ip4_address_sync, GUINT_TO_POINTER (n));
+		add_test_func_data (nm_sprintf_buf (path, "/bench/address-sync/ip6/%u", n), bench_ip6_address_sync, GUINT_TO_POINTER (n));
+	}
+	add_test_func_data ("/bench/link-veth/100", bench_link_veth, GUINT_TO_POINTER (100));
+	if (g_test_perf ())
+		add_test_func_data ("/bench/link-veth/1000", bench_link_veth, GUINT_TO_POINTER (1000));
+}
@@ -7,6 +7,7 @@
 
 #include <stdlib.h>
 #include <syslog.h>
+#include <glib-unix.h>
 
 #include "platform/nm-linux-platform.h"
 
@@ -16,6 +17,8 @@ NMTST_DEFINE ();
 
 static struct {
 	gboolean persist;
+	char *record;
+	char *replay;
 } global_opt = {
 	.persist = TRUE,
 };
@@ -26,6 +29,8 @@ read_argv (int *argc, char ***argv)
 	GOptionContext *context;
 	GOptionEntry options[] = {
 		{ "no-persist", 'P', G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE, &global_opt.persist, "Exit after processing netlink messages", NULL },
+		{ "record", 'r', 0, G_OPTION_ARG_FILENAME, &global_opt.record, "Write the netlink messages to a file", "FILE" },
+		{ "replay", 'R', 0, G_OPTION_ARG_FILENAME, &global_opt.replay, "Feed the netlink messages from a recorded file to the platform cache and exit", "FILE" },
 		{ 0 },
 	};
 	gs_free_error GError *error = NULL;
@@ -44,6 +49,13 @@ read_argv (int *argc, char ***argv)
 	return TRUE;
 }
 
+static gboolean
+quit_cb (gpointer user_data)
+{
+	g_main_loop_quit (user_data);
+	return G_SOURCE_REMOVE;
+}
+
 int
 main (int argc, char **argv)
 {
@@ -57,16 +69,54 @@ main (int argc, char **argv)
 	if (!read_argv (&argc, &argv))
 		return 2;
 
+	if (global_opt.replay) {
+		gs_unref_object NMPlatform *platform = NULL;
+		gs_free_error GError *error = NULL;
+		guint64 n_messages;
+		gint64 start_ns;
+		gint64 duration_ns;
+
+		platform = nm_linux_platform_new_replay (FALSE);
+
+		start_ns = nm_utils_get_monotonic_timestamp_ns ();
+		if (!nm_linux_platform_replay (platform, global_opt.replay, &n_messages, &error)) {
+			g_printerr ("Failure to replay \"%s\": %s\n", global_opt.replay, error->message);
+			return EXIT_FAILURE;
+		}
+		duration_ns = nm_utils_get_monotonic_timestamp_ns () - start_ns;
+
+		g_print ("replayed %"G_GUINT64_FORMAT" messages in %"G_GINT64_FORMAT" usec\n",
+		         n_messages,
+		         duration_ns / 1000);
+		return EXIT_SUCCESS;
+	}
+
 	nm_log_info (LOGD_PLATFORM, "platform monitor start");
 
 	loop = g_main_loop_new (NULL, FALSE);
 
 	nm_linux_platform_setup ();
 
+	if (global_opt.record) {
+		gs_free_error GError *error = NULL;
+
+		if (!nm_linux_platform_record_start (NM_PLATFORM_GET, global_opt.record, &error)) {
+			g_printerr ("Failure to record to \"%s\": %s\n", global_opt.record, error->message);
+			return EXIT_FAILURE;
+		}
+
+		/* quit the loop on signal, so that the recording is complete. */
+		g_unix_signal_add (SIGINT, quit_cb, loop);
+		g_unix_signal_add (SIGTERM, quit_cb, loop);
+	}
+
 	if (global_opt.persist)
 		g_main_loop_run (loop);
 
 	g_main_loop_unref (loop);
 
+	if (global_opt.record)
+		nm_linux_platform_record_stop (NM_PLATFORM_GET);
+
 	return EXIT_SUCCESS;
 }
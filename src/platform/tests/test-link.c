@@ -487,6 +487,95 @@ test_vlan (void)
 
 /*****************************************************************************/
 
+static void
+_assert_bridge_vlan (NMPlatform *platform,
+                     int ifindex,
+                     guint16 vid,
+                     gboolean present,
+                     gboolean untagged,
+                     gboolean pvid)
+{
+	gboolean has_untagged;
+	gboolean has_pvid;
+
+	if (!_nmtst_linux_platform_bridge_vlan_get (platform, ifindex, vid, &has_untagged, &has_pvid)) {
+		if (present)
+			g_error ("VLAN %u on ifindex %d is missing", vid, ifindex);
+		return;
+	}
+	if (!present)
+		g_error ("VLAN %u on ifindex %d is unexpectedly present", vid, ifindex);
+	g_assert_cmpint (has_untagged, ==, untagged);
+	g_assert_cmpint (has_pvid, ==, pvid);
+}
+
+static void
+test_bridge_vlans (void)
+{
+	const NMPlatformBridgeVlan vlan_range = { .vid_start = 10, .vid_end = 20, .untagged = TRUE };
+	const NMPlatformBridgeVlan vlan_pvid = { .vid_start = 30, .vid_end = 30, .untagged = TRUE, .pvid = TRUE };
+	const NMPlatformBridgeVlan *const vlans[] = { &vlan_range, &vlan_pvid, NULL };
+	int ifindex_bridge;
+	int ifindex;
+
+	nmtstp_run_command_check ("ip link add %s type bridge vlan_filtering 1", PARENT_NAME);
+	ifindex_bridge = nmtstp_assert_wait_for_link (NM_PLATFORM_GET, PARENT_NAME, NM_LINK_TYPE_BRIDGE, 100)->ifindex;
+	ifindex = nmtstp_link_dummy_add (NM_PLATFORM_GET, FALSE, DEVICE_NAME)->ifindex;
+	g_assert (nm_platform_link_enslave (NM_PLATFORM_GET, ifindex_bridge, ifindex));
+
+	g_assert (nm_platform_link_set_bridge_vlans (NM_PLATFORM_GET, ifindex, TRUE, vlans));
+
+	/* a new platform instance dumps the VLANs from kernel... */
+	{
+		gs_unref_object NMPlatform *platform = nm_linux_platform_new (TRUE, NM_PLATFORM_NETNS_SUPPORT_DEFAULT);
+
+		_assert_bridge_vlan (platform, ifindex, 1, TRUE, TRUE, FALSE);
+		_assert_bridge_vlan (platform, ifindex, 9, FALSE, FALSE, FALSE);
+		_assert_bridge_vlan (platform, ifindex, 10, TRUE, TRUE, FALSE);
+		_assert_bridge_vlan (platform, ifindex, 15, TRUE, TRUE, FALSE);
+		_assert_bridge_vlan (platform, ifindex, 20, TRUE, TRUE, FALSE);
+		_assert_bridge_vlan (platform, ifindex, 21, FALSE, FALSE, FALSE);
+		_assert_bridge_vlan (platform, ifindex, 30, TRUE, TRUE, TRUE);
+	}
+
+	/* ... while the first one follows the notifications about changes
+	 * of somebody else. */
+	nmtstp_run_command_check ("bridge vlan add dev %s vid 100 master", DEVICE_NAME);
+	nmtstp_run_command_check ("bridge vlan del dev %s vid 15 master", DEVICE_NAME);
+	_assert_bridge_vlan (NM_PLATFORM_GET, ifindex, 100, TRUE, FALSE, FALSE);
+	_assert_bridge_vlan (NM_PLATFORM_GET, ifindex, 15, FALSE, FALSE, FALSE);
+
+	/* setting the VLANs again only adds the missing one. */
+	g_assert (nm_platform_link_set_bridge_vlans (NM_PLATFORM_GET, ifindex, TRUE, vlans));
+	_assert_bridge_vlan (NM_PLATFORM_GET, ifindex, 15, TRUE, TRUE, FALSE);
+
+	/* flush all but the configured VLANs. */
+	g_assert (nm_platform_link_flush_bridge_vlans (NM_PLATFORM_GET, ifindex, TRUE, vlans));
+	{
+		gs_unref_object NMPlatform *platform = nm_linux_platform_new (TRUE, NM_PLATFORM_NETNS_SUPPORT_DEFAULT);
+
+		_assert_bridge_vlan (platform, ifindex, 1, FALSE, FALSE, FALSE);
+		_assert_bridge_vlan (platform, ifindex, 100, FALSE, FALSE, FALSE);
+		_assert_bridge_vlan (platform, ifindex, 10, TRUE, TRUE, FALSE);
+		_assert_bridge_vlan (platform, ifindex, 20, TRUE, TRUE, FALSE);
+		_assert_bridge_vlan (platform, ifindex, 30, TRUE, TRUE, TRUE);
+	}
+
+	/* a full flush. */
+	g_assert (nm_platform_link_set_bridge_vlans (NM_PLATFORM_GET, ifindex, TRUE, NULL));
+	{
+		gs_unref_object NMPlatform *platform = nm_linux_platform_new (TRUE, NM_PLATFORM_NETNS_SUPPORT_DEFAULT);
+
+		_assert_bridge_vlan (platform, ifindex, 10, FALSE, FALSE, FALSE);
+		_assert_bridge_vlan (platform, ifindex, 30, FALSE, FALSE, FALSE);
+	}
+
+	nmtstp_link_delete (NULL, -1, ifindex, DEVICE_NAME, TRUE);
+	nmtstp_link_delete (NULL, -1, ifindex_bridge, PARENT_NAME, TRUE);
+}
+
+/*****************************************************************************/
+
 static void
 test_bridge_addr (void)
 {
@@ -816,6 +905,7 @@ _test_wireguard_change (NMPlatform *platform,
 	gs_unref_ptrarray GPtrArray *allowed_ips_keep_alive = NULL;
 	gs_unref_array GArray *peers = NULL;
 	NMPlatformLnkWireGuard lnk_wireguard;
+	guint n_refreshes = 0;
 	int r;
 	guint i;
 
@@ -893,6 +983,9 @@ _test_wireguard_change (NMPlatform *platform,
 	} else
 		g_assert_not_reached ();
 
+	if (NM_IS_LINUX_PLATFORM (platform))
+		n_refreshes = _nmtst_linux_platform_wireguard_get_n_refreshes (platform);
+
 	r = nm_platform_link_wireguard_change (platform,
 	                                       ifindex,
 	                                       &lnk_wireguard,
@@ -904,6 +997,11 @@ _test_wireguard_change (NMPlatform *platform,
 	                                       | NM_PLATFORM_WIREGUARD_CHANGE_FLAG_HAS_FWMARK
 	                                       | NM_PLATFORM_WIREGUARD_CHANGE_FLAG_REPLACE_PEERS);
 	g_assert (NMTST_NM_ERR_SUCCESS (r));
+
+	/* the change is diffed against the cache. Only after sending it,
+	 * the peers are fetched from kernel, once. */
+	if (NM_IS_LINUX_PLATFORM (platform))
+		g_assert_cmpint (_nmtst_linux_platform_wireguard_get_n_refreshes (platform) - n_refreshes, <=, 1);
 }
 
 /*****************************************************************************/
@@ -1615,6 +1713,49 @@ _assert_vlan_flags (int ifindex, NMVlanFlags flags)
 	g_assert_cmpint (plnk->flags, ==, flags);
 }
 
+static void
+test_vlan_lnk_reuse (void)
+{
+	nm_auto_nmpobj const NMPObject *lnk = NULL;
+	const NMPObject *lnk2;
+	const NMPlatformLink *plink;
+	int ifindex, ifindex_parent;
+
+	nmtstp_run_command_check ("ip link add %s type dummy", PARENT_NAME);
+	ifindex_parent = nmtstp_assert_wait_for_link (NM_PLATFORM_GET, PARENT_NAME, NM_LINK_TYPE_DUMMY, 100)->ifindex;
+
+	nmtstp_run_command_check ("ip link add name %s link %s type vlan id 1245", DEVICE_NAME, PARENT_NAME);
+	ifindex = nmtstp_assert_wait_for_link (NM_PLATFORM_GET, DEVICE_NAME, NM_LINK_TYPE_VLAN, 100)->ifindex;
+
+	/* keep a reference, so that a new lnk cannot get the same address. */
+	lnk = nmp_object_ref (nm_platform_link_get_lnk (NM_PLATFORM_GET, ifindex, NM_LINK_TYPE_VLAN, NULL));
+	g_assert (lnk);
+	g_assert_cmpint (lnk->lnk_vlan.id, ==, 1245);
+
+	/* the link changes, but its IFLA_INFO_DATA does not. The cached lnk
+	 * instance is kept. */
+	g_assert (NMTST_NM_ERR_SUCCESS (nm_platform_link_set_mtu (NM_PLATFORM_GET, ifindex, 1400)));
+	lnk2 = nm_platform_link_get_lnk (NM_PLATFORM_GET, ifindex, NM_LINK_TYPE_VLAN, &plink);
+	g_assert (plink);
+	g_assert_cmpint (plink->mtu, ==, 1400);
+	g_assert (lnk2 == lnk);
+
+	nm_platform_link_refresh (NM_PLATFORM_GET, ifindex);
+	g_assert (lnk == nm_platform_link_get_lnk (NM_PLATFORM_GET, ifindex, NM_LINK_TYPE_VLAN, NULL));
+
+	/* when IFLA_INFO_DATA changes, the lnk is parsed again. */
+	g_assert (nm_platform_link_vlan_set_ingress_map (NM_PLATFORM_GET, ifindex, 4, 5));
+	lnk2 = nm_platform_link_get_lnk (NM_PLATFORM_GET, ifindex, NM_LINK_TYPE_VLAN, NULL);
+	g_assert (lnk2);
+	g_assert (lnk2 != lnk);
+	g_assert_cmpint (lnk2->lnk_vlan.id, ==, 1245);
+	_assert_ingress_qos_mappings (ifindex, 1,
+	                              4, 5);
+
+	nmtstp_link_delete (NULL, -1, ifindex, DEVICE_NAME, TRUE);
+	nmtstp_link_delete (NULL, -1, ifindex_parent, PARENT_NAME, TRUE);
+}
+
 static void
 test_vlan_set_xgress (void)
 {
@@ -2328,6 +2469,58 @@ again:
 
 /*****************************************************************************/
 
+static void
+test_nl_overrun_resync (void)
+{
+	const char *IFACE_DUMMY0 = "nm-test-dummy0";
+	const char *IFACE_DUMMY1 = "nm-test-dummy1";
+	const NMPlatformLink *pllink;
+	int ifindex_dummy0;
+	int ifindex_dummy1;
+	guint i;
+
+	g_assert (NM_IS_LINUX_PLATFORM (NM_PLATFORM_GET));
+
+	ifindex_dummy0 = nmtstp_link_dummy_add (NM_PLATFORM_GET, FALSE, IFACE_DUMMY0)->ifindex;
+
+	/* the first overrun resyncs all object types at once. Overruns that follow
+	 * shortly after still refresh links and addresses right away, only the
+	 * other types are delayed. Check both cases, without iterating the
+	 * mainloop (which would run the delayed resync). */
+	for (i = 0; i < 2; i++) {
+		char addr[INET_ADDRSTRLEN];
+
+		nm_sprintf_buf (addr, "192.0.2.%u", i + 1);
+
+		nmtstp_run_command_check ("ip link add %s type dummy", IFACE_DUMMY1);
+		nmtstp_run_command_check ("ip address add %s/24 dev %s", addr, IFACE_DUMMY0);
+
+		_nmtst_linux_platform_simulate_overrun (NM_PLATFORM_GET);
+		nm_platform_process_events (NM_PLATFORM_GET);
+
+		pllink = nm_platform_link_get_by_ifname (NM_PLATFORM_GET, IFACE_DUMMY1);
+		g_assert (pllink);
+		ifindex_dummy1 = pllink->ifindex;
+		g_assert (nm_platform_ip4_address_get (NM_PLATFORM_GET,
+		                                       ifindex_dummy0,
+		                                       nmtst_inet4_from_string (addr),
+		                                       24,
+		                                       nmtst_inet4_from_string (addr)));
+
+		nmtstp_run_command_check ("ip link delete %s", IFACE_DUMMY1);
+
+		_nmtst_linux_platform_simulate_overrun (NM_PLATFORM_GET);
+		nm_platform_process_events (NM_PLATFORM_GET);
+
+		g_assert (!nm_platform_link_get (NM_PLATFORM_GET, ifindex_dummy1));
+		g_assert (!nm_platform_link_get_by_ifname (NM_PLATFORM_GET, IFACE_DUMMY1));
+	}
+
+	nmtstp_link_delete (NULL, -1, ifindex_dummy0, IFACE_DUMMY0, TRUE);
+}
+
+/*****************************************************************************/
+
 static void
 _test_netns_setup (gpointer fixture, gconstpointer test_data)
 {
@@ -2748,6 +2941,52 @@ test_netns_push (gpointer fixture, gconstpointer test_data)
 
 /*****************************************************************************/
 
+static void
+test_netns_worker_error (void)
+{
+	gs_unref_object NMPlatform *platform_1 = NULL;
+	nm_auto_pop_netns NMPNetns *netns_pop = NULL;
+	guint64 n_polls_before;
+	guint64 n_polls;
+
+	if (_test_netns_check_skip ())
+		return;
+
+	platform_1 = _test_netns_create_platform ();
+	if (!_nmtst_linux_platform_event_worker_set_error (platform_1, -EIO, NULL)) {
+		g_test_skip ("No worker thread for the netns platform");
+		return;
+	}
+
+	g_assert (nm_platform_netns_push (platform_1, &netns_pop));
+
+	/* the event stays in the socket, so that it is readable all the time.
+	 * The worker reports the failure, which triggers a resync. */
+	nmtstp_run_command_check ("ip link add nm-test-worker type dummy");
+	NMTST_WAIT_ASSERT (2000, {
+		nmtstp_wait_for_signal (platform_1, 50);
+		if (nm_platform_link_get_by_ifname (platform_1, "nm-test-worker"))
+			break;
+	});
+
+	/* meanwhile, the thread backs off instead of spinning. */
+	_nmtst_linux_platform_event_worker_set_error (platform_1, -EIO, &n_polls_before);
+	g_usleep (500 * 1000);
+	_nmtst_linux_platform_event_worker_set_error (platform_1, 0, &n_polls);
+	g_assert_cmpint (n_polls - n_polls_before, <, 20);
+
+	/* and events are received again afterwards. */
+	nmtstp_run_command_check ("ip link delete nm-test-worker");
+	NMTST_WAIT_ASSERT (12000, {
+		nm_platform_process_events (platform_1);
+		if (!nm_platform_link_get_by_ifname (platform_1, "nm-test-worker"))
+			break;
+		nmtstp_wait_for_signal (platform_1, 50);
+	});
+}
+
+/*****************************************************************************/
+
 static void
 test_netns_bind_to_path (gpointer fixture, gconstpointer test_data)
 {
@@ -3306,6 +3545,8 @@ _nmtstp_setup_tests (void)
 		test_software_detect_add ("/link/software/detect/wireguard/2", NM_LINK_TYPE_WIREGUARD, 2);
 
 		g_test_add_func ("/link/software/vlan/set-xgress", test_vlan_set_xgress);
+		g_test_add_func ("/link/software/vlan/lnk-reuse", test_vlan_lnk_reuse);
+		g_test_add_func ("/link/software/bridge/vlans", test_bridge_vlans);
 
 		g_test_add_data_func ("/link/create-many-links/20", GUINT_TO_POINTER (20), test_create_many_links);
 		g_test_add_data_func ("/link/create-many-links/1000", GUINT_TO_POINTER (1000), test_create_many_links);
@@ -3314,12 +3555,15 @@ _nmtstp_setup_tests (void)
 		g_test_add_func ("/link/nl-bugs/spurious-newlink", test_nl_bugs_spuroius_newlink);
 		g_test_add_func ("/link/nl-bugs/spurious-dellink", test_nl_bugs_spuroius_dellink);
 
+		g_test_add_func ("/link/nl-overrun/resync", test_nl_overrun_resync);
+
 		g_test_add_vtable ("/general/netns/general", 0, NULL, _test_netns_setup, test_netns_general, _test_netns_teardown);
 		g_test_add_vtable ("/general/netns/set-netns", 0, NULL, _test_netns_setup, test_netns_set_netns, _test_netns_teardown);
 		g_test_add_vtable ("/general/netns/push", 0, NULL, _test_netns_setup, test_netns_push, _test_netns_teardown);
 		g_test_add_vtable ("/general/netns/bind-to-path", 0, NULL, _test_netns_setup, test_netns_bind_to_path, _test_netns_teardown);
 
 		g_test_add_func ("/general/netns/mt", test_netns_mt);
+		g_test_add_func ("/general/netns/worker-error", test_netns_worker_error);
 
 		g_test_add_func ("/general/sysctl/rename", test_sysctl_rename);
 		g_test_add_func ("/general/sysctl/netns-switch", test_sysctl_netns_switch);
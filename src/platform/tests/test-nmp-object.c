@@ -7,6 +7,7 @@
 
 #include <libudev.h>
 #include <linux/pkt_sched.h>
+#include <linux/rtnetlink.h>
 
 #include "platform/nmp-object.h"
 #include "nm-udev-aux/nm-udev-utils.h"
@@ -524,6 +525,213 @@ test_cache_qdisc (void)
 
 /*****************************************************************************/
 
+static void
+test_cache_route_indices (void)
+{
+	NMPCache *cache;
+	nm_auto_unref_dedup_multi_index NMDedupMultiIndex *multi_idx = NULL;
+	NMPLookup lookup;
+	const NMDedupMultiHeadEntry *head_entry;
+	const in_addr_t gw1 = nmtst_inet4_from_string ("192.168.1.1");
+	const in_addr_t gw2 = nmtst_inet4_from_string ("192.168.1.2");
+	NMPlatformIP4Route r = { 0 };
+	nm_auto_nmpobj NMPObject *obj1 = NULL;
+	nm_auto_nmpobj NMPObject *obj2 = NULL;
+	nm_auto_nmpobj NMPObject *obj3 = NULL;
+
+	multi_idx = nm_dedup_multi_index_new ();
+	cache = nmp_cache_new (multi_idx, nmtst_get_rand_uint32 () % 2);
+
+	r.ifindex = 1;
+	r.network = nmtst_inet4_from_string ("10.0.1.0");
+	r.plen = 24;
+	r.gateway = gw1;
+	obj1 = nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, (NMPlatformObject *) &r);
+
+	r.ifindex = 2;
+	r.network = nmtst_inet4_from_string ("10.0.2.0");
+	r.table_coerced = nm_platform_route_table_coerce (100);
+	obj2 = nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, (NMPlatformObject *) &r);
+
+	r.network = nmtst_inet4_from_string ("10.0.3.0");
+	r.gateway = 0;
+	obj3 = nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, (NMPlatformObject *) &r);
+
+	g_assert (nmp_cache_update_netlink (cache, obj1, FALSE, NULL, NULL) == NMP_CACHE_OPS_ADDED);
+	g_assert (nmp_cache_update_netlink (cache, obj2, FALSE, NULL, NULL) == NMP_CACHE_OPS_ADDED);
+	g_assert (nmp_cache_update_netlink (cache, obj3, FALSE, NULL, NULL) == NMP_CACHE_OPS_ADDED);
+
+	head_entry = nmp_cache_lookup (cache, nmp_lookup_init_route_by_table (&lookup, NMP_OBJECT_TYPE_IP4_ROUTE, RT_TABLE_MAIN));
+	g_assert (head_entry);
+	g_assert_cmpint (head_entry->len, ==, 1);
+	head_entry = nmp_cache_lookup (cache, nmp_lookup_init_route_by_table (&lookup, NMP_OBJECT_TYPE_IP4_ROUTE, 100));
+	g_assert (head_entry);
+	g_assert_cmpint (head_entry->len, ==, 2);
+	g_assert (!nmp_cache_lookup (cache, nmp_lookup_init_route_by_table (&lookup, NMP_OBJECT_TYPE_IP4_ROUTE, 101)));
+	g_assert (!nmp_cache_lookup (cache, nmp_lookup_init_route_by_table (&lookup, NMP_OBJECT_TYPE_IP6_ROUTE, 100)));
+
+	head_entry = nmp_cache_lookup (cache, nmp_lookup_init_ip4_route_by_gateway (&lookup, gw1));
+	g_assert (head_entry);
+	g_assert_cmpint (head_entry->len, ==, 2);
+	g_assert (!nmp_cache_lookup (cache, nmp_lookup_init_ip4_route_by_gateway (&lookup, gw2)));
+
+	/* removing a route drops it from all partitions. */
+
+	g_assert (nmp_cache_remove (cache, obj2, FALSE, FALSE, NULL) == NMP_CACHE_OPS_REMOVED);
+	head_entry = nmp_cache_lookup (cache, nmp_lookup_init_route_by_table (&lookup, NMP_OBJECT_TYPE_IP4_ROUTE, 100));
+	g_assert_cmpint (head_entry->len, ==, 1);
+	head_entry = nmp_cache_lookup (cache, nmp_lookup_init_ip4_route_by_gateway (&lookup, gw1));
+	g_assert_cmpint (head_entry->len, ==, 1);
+
+	nmp_cache_free (cache);
+}
+
+/*****************************************************************************/
+
+static gsize
+_get_rss (void)
+{
+	gs_free char *contents = NULL;
+	gs_free char **tokens = NULL;
+
+	if (!g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL))
+		return 0;
+	tokens = g_strsplit (contents, " ", -1);
+	if (!tokens[0] || !tokens[1])
+		return 0;
+	return _nm_utils_ascii_str_to_int64 (tokens[1], 10, 0, G_MAXINT64, 0) * sysconf (_SC_PAGESIZE);
+}
+
+static void
+test_alloc_routes (void)
+{
+	const guint N = nmtst_test_quick () ? 10000 : 1000000;
+	gs_unref_ptrarray GPtrArray *objs = g_ptr_array_new_full (N, (GDestroyNotify) nmp_object_unref);
+	NMPObjectAllocStats stats0;
+	NMPObjectAllocStats stats;
+	gsize rss0, rss;
+	guint n_per_page;
+	guint i;
+
+	nmp_object_alloc_stats_get (NMP_OBJECT_TYPE_IP4_ROUTE, &stats0);
+	rss0 = _get_rss ();
+
+	for (i = 0; i < N; i++) {
+		const NMPlatformIP4Route r = {
+			.ifindex = 1 + (i % 10),
+			.network = htonl (0x0A000000u + (i << 8)),
+			.plen = 24,
+			.metric = i,
+		};
+
+		g_ptr_array_add (objs, nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, &r));
+	}
+
+	nmp_object_alloc_stats_get (NMP_OBJECT_TYPE_IP4_ROUTE, &stats);
+	rss = _get_rss ();
+	g_print (">>> %u IPv4 routes: rss +%"G_GSIZE_FORMAT" KiB, %"G_GUINT64_FORMAT" allocations, %u pages of %"G_GSIZE_FORMAT" bytes, object size %"G_GSIZE_FORMAT"\n",
+	         N,
+	         (rss - MIN (rss0, rss)) / 1024,
+	         stats.n_allocs - stats0.n_allocs,
+	         stats.n_pages,
+	         stats.page_size,
+	         stats.obj_size);
+
+	if (stats.page_size == 0) {
+		/* the slab is disabled (G_SLICE=always-malloc). */
+		return;
+	}
+
+	n_per_page = stats.page_size / stats.obj_size;
+	g_assert_cmpint (stats.n_objs - stats0.n_objs, ==, N);
+	g_assert_cmpint (stats.n_allocs - stats0.n_allocs, ==, N);
+	g_assert_cmpint (stats.n_pages, <=, stats0.n_pages + (N / n_per_page) + 1);
+
+	/* freeing every other object keeps the pages... */
+	for (i = 0; i < N; i += 2)
+		nm_clear_pointer (&objs->pdata[i], nmp_object_unref);
+	nmp_object_alloc_stats_get (NMP_OBJECT_TYPE_IP4_ROUTE, &stats);
+	g_assert_cmpint (stats.n_objs - stats0.n_objs, ==, N / 2);
+
+	/* ... and the freed slots get reused. */
+	for (i = 0; i < N; i += 2)
+		objs->pdata[i] = nmp_object_clone (objs->pdata[i + 1], FALSE);
+	nmp_object_alloc_stats_get (NMP_OBJECT_TYPE_IP4_ROUTE, &stats);
+	g_assert_cmpint (stats.n_pages, <=, stats0.n_pages + (N / n_per_page) + 1);
+
+	/* freeing all objects returns the pages, except one spare page. */
+	g_ptr_array_set_size (objs, 0);
+	nmp_object_alloc_stats_get (NMP_OBJECT_TYPE_IP4_ROUTE, &stats);
+	rss = _get_rss ();
+	g_print (">>> after free: rss +%"G_GSSIZE_FORMAT" KiB, %u pages\n",
+	         (gssize) (rss - rss0) / 1024,
+	         stats.n_pages);
+	g_assert_cmpint (stats.n_objs, ==, stats0.n_objs);
+	g_assert_cmpint (stats.n_pages, <=, MAX (stats0.n_pages, 1u));
+}
+
+/*****************************************************************************/
+
+static void
+test_route_metrics (void)
+{
+	const NMPlatformIPRouteMetrics m1 = {
+		.mtu = 1400,
+		.lock_mtu = TRUE,
+	};
+	const NMPlatformIPRouteMetrics m2 = {
+		.mtu = 1400,
+	};
+	const NMPlatformIPRouteMetrics *i1;
+	const NMPlatformIPRouteMetrics *i2;
+	NMPlatformIP4Route r1 = {
+		.ifindex = 1,
+		.network = htonl (0x0A000000u),
+		.plen = 24,
+	};
+	NMPlatformIP4Route r2;
+	nm_auto_nmpobj NMPObject *obj1 = NULL;
+	nm_auto_nmpobj NMPObject *obj2 = NULL;
+	NMHashState h1, h2;
+
+	g_assert (!nm_platform_ip_route_metrics_intern (NULL));
+	g_assert (!nm_platform_ip_route_metrics_intern (&((NMPlatformIPRouteMetrics) { 0 })));
+
+	i1 = nm_platform_ip_route_metrics_intern (&m1);
+	i2 = nm_platform_ip_route_metrics_intern (&m2);
+	g_assert (i1 && i2);
+	g_assert (i1 != &m1);
+	g_assert (i1 != i2);
+	g_assert (i1 == nm_platform_ip_route_metrics_intern (&m1));
+	g_assert (i2 == nm_platform_ip_route_metrics_intern (&m2));
+	g_assert_cmpint (i1->mtu, ==, 1400);
+	g_assert (i1->lock_mtu);
+
+	g_assert (nm_platform_ip_route_get_metrics (&r1) == &_nm_platform_ip_route_metrics_empty);
+
+	r2 = r1;
+	r2.metrics = i1;
+	g_assert (nm_platform_ip_route_get_metrics (&r2) == i1);
+	g_assert_cmpint (nm_platform_ip4_route_cmp_full (&r1, &r2), !=, 0);
+	g_assert_cmpint (nm_platform_ip4_route_cmp (&r1, &r2, NM_PLATFORM_IP_ROUTE_CMP_TYPE_ID), !=, 0);
+	g_assert_cmpint (nm_platform_ip4_route_cmp (&r1, &r2, NM_PLATFORM_IP_ROUTE_CMP_TYPE_WEAK_ID), ==, 0);
+
+	r1.metrics = nm_platform_ip_route_metrics_intern (&m1);
+	g_assert_cmpint (nm_platform_ip4_route_cmp_full (&r1, &r2), ==, 0);
+
+	obj1 = nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, (NMPlatformObject *) &r1);
+	obj2 = nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, (NMPlatformObject *) &r2);
+	g_assert (nmp_object_equal (obj1, obj2));
+	nm_hash_init (&h1, 1);
+	nmp_object_hash_update (obj1, &h1);
+	nm_hash_init (&h2, 1);
+	nmp_object_hash_update (obj2, &h2);
+	g_assert_cmpint (nm_hash_complete (&h1), ==, nm_hash_complete (&h2));
+	g_assert (obj1->ip4_route.metrics == i1);
+}
+
+/*****************************************************************************/
+
 NMTST_DEFINE ();
 
 int
@@ -569,6 +777,9 @@ main (int argc, char **argv)
 	g_test_add_func ("/nmp-object/obj-base", test_obj_base);
 	g_test_add_func ("/nmp-object/cache_link", test_cache_link);
 	g_test_add_func ("/nmp-object/cache_qdisc", test_cache_qdisc);
+	g_test_add_func ("/nmp-object/cache_route_indices", test_cache_route_indices);
+	g_test_add_func ("/nmp-object/alloc_routes", test_alloc_routes);
+	g_test_add_func ("/nmp-object/route_metrics", test_route_metrics);
 
 	result = g_test_run ();
 
@@ -6,9 +6,12 @@
 #include "nm-default.h"
 
 #include <linux/rtnetlink.h>
+#include <linux/pkt_sched.h>
 
 #include "platform/nm-platform-utils.h"
 #include "platform/nm-linux-platform.h"
+#include "platform/nm-netlink.h"
+#include "platform/nmp-object.h"
 
 #include "nm-test-utils-core.h"
 
@@ -62,6 +65,749 @@ test_nm_platform_link_flags2str (void)
 
 /*****************************************************************************/
 
+/* A netlink record, as written by nm_linux_platform_record_start() on a
+ * little endian host. It contains:
+ *   #1 RTM_NEWLINK dummy "nm-rec0", ifindex 7
+ *   #2 RTM_NEWADDR 192.0.2.7/24 on ifindex 7
+ *   #3 RTM_NEWROUTE 192.0.2.0/24 dev 7 proto kernel scope link
+ *   #4 RTM_NEWLINK dummy "nm-rec1", ifindex 8
+ *   #5 RTM_DELLINK ifindex 8 */
+static const guint8 nl_record_fixture[] = {
+	0x4e, 0x4d, 0x4e, 0x4c, 0x52, 0x45, 0x43, 0x31, 0x00, 0xf2, 0x05, 0x2a,
+	0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x5c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5c, 0x00, 0x00, 0x00,
+	0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x01, 0x00, 0x07, 0x00, 0x00, 0x00, 0x43, 0x00, 0x01, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x03, 0x00, 0x6e, 0x6d, 0x2d, 0x72,
+	0x65, 0x63, 0x30, 0x00, 0x08, 0x00, 0x04, 0x00, 0xdc, 0x05, 0x00, 0x00,
+	0x0a, 0x00, 0x01, 0x00, 0x02, 0x00, 0x5e, 0x10, 0x00, 0x07, 0x00, 0x00,
+	0x0a, 0x00, 0x02, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00,
+	0x10, 0x00, 0x12, 0x00, 0x0a, 0x00, 0x01, 0x00, 0x64, 0x75, 0x6d, 0x6d,
+	0x79, 0x00, 0x00, 0x00, 0x40, 0x34, 0x15, 0x2a, 0x01, 0x00, 0x00, 0x00,
+	0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x30, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x18, 0x80, 0x00,
+	0x07, 0x00, 0x00, 0x00, 0x08, 0x00, 0x02, 0x00, 0xc0, 0x00, 0x02, 0x07,
+	0x08, 0x00, 0x01, 0x00, 0xc0, 0x00, 0x02, 0x07, 0x08, 0x00, 0x08, 0x00,
+	0x80, 0x00, 0x00, 0x00, 0x80, 0x76, 0x24, 0x2a, 0x01, 0x00, 0x00, 0x00,
+	0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x06,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x18, 0x00, 0x00,
+	0xfe, 0x02, 0xfd, 0x01, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x0f, 0x00,
+	0xfe, 0x00, 0x00, 0x00, 0x08, 0x00, 0x01, 0x00, 0xc0, 0x00, 0x02, 0x00,
+	0x08, 0x00, 0x07, 0x00, 0xc0, 0x00, 0x02, 0x07, 0x08, 0x00, 0x04, 0x00,
+	0x07, 0x00, 0x00, 0x00, 0xc0, 0xb8, 0x33, 0x2a, 0x01, 0x00, 0x00, 0x00,
+	0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5c, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x5c, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+	0x08, 0x00, 0x00, 0x00, 0x02, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x0c, 0x00, 0x03, 0x00, 0x6e, 0x6d, 0x2d, 0x72, 0x65, 0x63, 0x31, 0x00,
+	0x08, 0x00, 0x04, 0x00, 0xdc, 0x05, 0x00, 0x00, 0x0a, 0x00, 0x01, 0x00,
+	0x02, 0x00, 0x5e, 0x10, 0x00, 0x08, 0x00, 0x00, 0x0a, 0x00, 0x02, 0x00,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x10, 0x00, 0x12, 0x00,
+	0x0a, 0x00, 0x01, 0x00, 0x64, 0x75, 0x6d, 0x6d, 0x79, 0x00, 0x00, 0x00,
+	0x00, 0xfb, 0x42, 0x2a, 0x01, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x20, 0x00, 0x00, 0x00, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x08, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+static void
+test_nl_record_replay (void)
+{
+	gs_unref_object NMPlatform *platform = NULL;
+	gs_free_error GError *error = NULL;
+	gs_free char *filename = NULL;
+	const NMDedupMultiHeadEntry *head_entry;
+	const NMPlatformLink *plink;
+	const NMPlatformIP4Address *a;
+	guint64 n_messages;
+	int fd;
+
+	if (G_BYTE_ORDER != G_LITTLE_ENDIAN) {
+		g_test_skip ("the netlink record is in little endian byte order");
+		return;
+	}
+
+	fd = g_file_open_tmp ("nm-test-record-XXXXXX", &filename, &error);
+	g_assert_no_error (error);
+	nm_close (fd);
+
+	g_assert (g_file_set_contents (filename, (const char *) nl_record_fixture, sizeof (nl_record_fixture), &error));
+	g_assert_no_error (error);
+
+	/* the replay platform never opens a netlink socket, so this works
+	 * without root. */
+	platform = nm_linux_platform_new_replay (TRUE);
+	g_assert (nm_linux_platform_replay (platform, filename, &n_messages, &error));
+	g_assert_no_error (error);
+	g_assert_cmpint (n_messages, ==, 5);
+
+	plink = nm_platform_link_get_by_ifname (platform, "nm-rec0");
+	g_assert (plink);
+	g_assert_cmpint (plink->ifindex, ==, 7);
+	g_assert_cmpint (plink->type, ==, NM_LINK_TYPE_DUMMY);
+	g_assert_cmpint (plink->mtu, ==, 1500);
+	g_assert (plink->connected);
+
+	g_assert (!nm_platform_link_get (platform, 8));
+	g_assert (!nm_platform_link_get_by_ifname (platform, "nm-rec1"));
+
+	a = nm_platform_ip4_address_get (platform, 7, nmtst_inet4_from_string ("192.0.2.7"), 24, nmtst_inet4_from_string ("192.0.2.7"));
+	g_assert (a);
+	g_assert (NM_FLAGS_HAS (a->n_ifa_flags, IFA_F_PERMANENT));
+
+	head_entry = nm_platform_lookup_object (platform, NMP_OBJECT_TYPE_IP4_ROUTE, 7);
+	g_assert (head_entry);
+	g_assert_cmpint (head_entry->len, ==, 1);
+
+	/* a truncated record fails, but keeps what was replayed so far. */
+	g_clear_object (&platform);
+	g_assert (g_file_set_contents (filename, (const char *) nl_record_fixture, sizeof (nl_record_fixture) - 4, &error));
+	g_assert_no_error (error);
+
+	platform = nm_linux_platform_new_replay (TRUE);
+	g_assert (!nm_linux_platform_replay (platform, filename, &n_messages, &error));
+	g_assert (error);
+	g_clear_error (&error);
+	g_assert_cmpint (n_messages, ==, 4);
+	g_assert (nm_platform_link_get (platform, 8));
+
+	unlink (filename);
+}
+
+/*****************************************************************************/
+
+static NMPWireGuardAllowedIP
+_wg_aip (const char *addr, guint8 mask)
+{
+	NMPWireGuardAllowedIP aip = {
+		.family = AF_INET,
+		.mask = mask,
+	};
+
+	aip.addr.addr4 = nmtst_inet4_from_string (addr);
+	return aip;
+}
+
+static void
+test_wireguard_peers_diff (void)
+{
+	const NMPWireGuardAllowedIP aips_a[] = { _wg_aip ("10.0.0.0", 24) };
+	const NMPWireGuardAllowedIP aips_a2[] = { _wg_aip ("10.0.0.0", 24), _wg_aip ("10.0.2.0", 24) };
+	const NMPWireGuardAllowedIP aips_b[] = { _wg_aip ("10.0.1.0", 24) };
+	nm_auto_nmpobj NMPObject *lnk_old = NULL;
+	NMPlatformLnkWireGuard lnk_wireguard;
+	NMPWireGuardPeer peers_old[2] = { };
+	NMPWireGuardPeer peers[3] = { };
+	NMPlatformWireGuardChangePeerFlags peer_flags[3];
+	NMPlatformWireGuardChangeFlags change_flags;
+	const NMPWireGuardPeer *p;
+
+	/* the kernel state: peers "A" and "B". */
+	memset (peers_old[0].public_key, 'A', sizeof (peers_old[0].public_key));
+	peers_old[0].persistent_keepalive_interval = 25;
+	peers_old[0].allowed_ips = aips_a;
+	peers_old[0].allowed_ips_len = G_N_ELEMENTS (aips_a);
+	memset (peers_old[1].public_key, 'B', sizeof (peers_old[1].public_key));
+	peers_old[1].allowed_ips = aips_b;
+	peers_old[1].allowed_ips_len = G_N_ELEMENTS (aips_b);
+
+	lnk_old = nmp_object_new (NMP_OBJECT_TYPE_LNK_WIREGUARD, NULL);
+	memset (lnk_old->_lnk_wireguard._public.private_key, 'K', sizeof (lnk_old->_lnk_wireguard._public.private_key));
+	lnk_old->_lnk_wireguard._public.listen_port = 51820;
+	lnk_old->_lnk_wireguard.peers = nm_memdup (peers_old, sizeof (peers_old));
+	lnk_old->_lnk_wireguard.peers_len = G_N_ELEMENTS (peers_old);
+
+	lnk_wireguard = lnk_old->_lnk_wireguard._public;
+
+	/* replace the peers with "A" (unchanged) and "C" (new). Only "C" is
+	 * added and "B" is removed. The unchanged private key is not sent. */
+	{
+		gs_unref_array GArray *d_peers = NULL;
+		gs_unref_array GArray *d_peer_flags = NULL;
+		gs_unref_ptrarray GPtrArray *d_allowed_ips = NULL;
+
+		peers[0] = peers_old[0];
+		memset (peers[1].public_key, 'C', sizeof (peers[1].public_key));
+		peer_flags[0] = NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_DEFAULT;
+		peer_flags[1] = NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_DEFAULT;
+		change_flags =   NM_PLATFORM_WIREGUARD_CHANGE_FLAG_REPLACE_PEERS
+		               | NM_PLATFORM_WIREGUARD_CHANGE_FLAG_HAS_PRIVATE_KEY
+		               | NM_PLATFORM_WIREGUARD_CHANGE_FLAG_HAS_LISTEN_PORT;
+		lnk_wireguard.listen_port = 51821;
+
+		_nmtst_linux_platform_wireguard_peers_diff (lnk_old, &lnk_wireguard, peers, peer_flags, 2,
+		                                            &change_flags, &d_peers, &d_peer_flags, &d_allowed_ips);
+
+		g_assert_cmpint (change_flags, ==, NM_PLATFORM_WIREGUARD_CHANGE_FLAG_HAS_LISTEN_PORT);
+		g_assert_cmpint (d_peers->len, ==, 2);
+		g_assert_cmpint (d_peer_flags->len, ==, 2);
+
+		p = &g_array_index (d_peers, NMPWireGuardPeer, 0);
+		g_assert_cmpint (p->public_key[0], ==, 'C');
+		g_assert_cmpint (g_array_index (d_peer_flags, NMPlatformWireGuardChangePeerFlags, 0), ==, NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_DEFAULT);
+
+		p = &g_array_index (d_peers, NMPWireGuardPeer, 1);
+		g_assert_cmpint (p->public_key[0], ==, 'B');
+		g_assert_cmpint (g_array_index (d_peer_flags, NMPlatformWireGuardChangePeerFlags, 1), ==, NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_REMOVE_ME);
+
+		/* the request is not modified. */
+		g_assert_cmpint (peers[0].allowed_ips_len, ==, G_N_ELEMENTS (aips_a));
+	}
+
+	/* "A" gets one more allowed-ip, "D" is unknown and to be removed, and
+	 * the keepalive of "B" is unchanged. Only the new allowed-ip of "A" is
+	 * sent, without replacing the existing ones. */
+	{
+		gs_unref_array GArray *d_peers = NULL;
+		gs_unref_array GArray *d_peer_flags = NULL;
+		gs_unref_ptrarray GPtrArray *d_allowed_ips = NULL;
+
+		memset (peers, 0, sizeof (peers));
+		peers[0] = peers_old[0];
+		peers[0].allowed_ips = aips_a2;
+		peers[0].allowed_ips_len = G_N_ELEMENTS (aips_a2);
+		memset (peers[1].public_key, 'D', sizeof (peers[1].public_key));
+		peers[2] = peers_old[1];
+		peer_flags[0] =   NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_ALLOWEDIPS
+		                | NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_REPLACE_ALLOWEDIPS;
+		peer_flags[1] = NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_REMOVE_ME;
+		peer_flags[2] = NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_KEEPALIVE_INTERVAL;
+		change_flags = NM_PLATFORM_WIREGUARD_CHANGE_FLAG_NONE;
+
+		_nmtst_linux_platform_wireguard_peers_diff (lnk_old, &lnk_wireguard, peers, peer_flags, 3,
+		                                            &change_flags, &d_peers, &d_peer_flags, &d_allowed_ips);
+
+		g_assert_cmpint (change_flags, ==, NM_PLATFORM_WIREGUARD_CHANGE_FLAG_NONE);
+		g_assert_cmpint (d_peers->len, ==, 1);
+
+		p = &g_array_index (d_peers, NMPWireGuardPeer, 0);
+		g_assert_cmpint (p->public_key[0], ==, 'A');
+		g_assert_cmpint (g_array_index (d_peer_flags, NMPlatformWireGuardChangePeerFlags, 0), ==, NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_ALLOWEDIPS);
+		g_assert_cmpint (p->allowed_ips_len, ==, 1);
+		g_assert_cmpint (p->allowed_ips[0].addr.addr4, ==, nmtst_inet4_from_string ("10.0.2.0"));
+	}
+
+	/* dropping an allowed-ip of "A" requires replacing them all. */
+	{
+		gs_unref_array GArray *d_peers = NULL;
+		gs_unref_array GArray *d_peer_flags = NULL;
+		gs_unref_ptrarray GPtrArray *d_allowed_ips = NULL;
+
+		memset (peers, 0, sizeof (peers));
+		peers[0] = peers_old[0];
+		peers[0].allowed_ips = aips_b;
+		peers[0].allowed_ips_len = G_N_ELEMENTS (aips_b);
+		peer_flags[0] =   NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_HAS_ALLOWEDIPS
+		                | NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_REPLACE_ALLOWEDIPS;
+		change_flags = NM_PLATFORM_WIREGUARD_CHANGE_FLAG_NONE;
+
+		_nmtst_linux_platform_wireguard_peers_diff (lnk_old, &lnk_wireguard, peers, peer_flags, 1,
+		                                            &change_flags, &d_peers, &d_peer_flags, &d_allowed_ips);
+
+		g_assert_cmpint (d_peers->len, ==, 1);
+		p = &g_array_index (d_peers, NMPWireGuardPeer, 0);
+		g_assert_cmpint (g_array_index (d_peer_flags, NMPlatformWireGuardChangePeerFlags, 0), ==, peer_flags[0]);
+		g_assert (p->allowed_ips == aips_b);
+	}
+
+	/* nothing changed. */
+	{
+		gs_unref_array GArray *d_peers = NULL;
+		gs_unref_array GArray *d_peer_flags = NULL;
+		gs_unref_ptrarray GPtrArray *d_allowed_ips = NULL;
+
+		change_flags =   NM_PLATFORM_WIREGUARD_CHANGE_FLAG_REPLACE_PEERS
+		               | NM_PLATFORM_WIREGUARD_CHANGE_FLAG_HAS_PRIVATE_KEY;
+		peer_flags[0] = NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_DEFAULT;
+		peer_flags[1] = NM_PLATFORM_WIREGUARD_CHANGE_PEER_FLAG_DEFAULT;
+
+		_nmtst_linux_platform_wireguard_peers_diff (lnk_old, &lnk_wireguard, peers_old, peer_flags, 2,
+		                                            &change_flags, &d_peers, &d_peer_flags, &d_allowed_ips);
+
+		g_assert_cmpint (change_flags, ==, NM_PLATFORM_WIREGUARD_CHANGE_FLAG_NONE);
+		g_assert_cmpint (d_peers->len, ==, 0);
+	}
+}
+
+/*****************************************************************************/
+
+static void
+test_qdisc_is_satisfied (void)
+{
+	const NMPlatformQdisc plat = {
+		.kind = "fq_codel",
+		.handle = TC_H_MAKE (0x8001u << 16, 0),
+		.parent = TC_H_ROOT,
+		.fq_codel = {
+			.limit = 10240,
+			.flows = 1024,
+			.target = 4999,
+			.interval = 99999,
+			.quantum = 1514,
+			.ce_threshold = NM_PLATFORM_FQ_CODEL_CE_THRESHOLD_DISABLED,
+			.memory_limit = 33554432,
+			.ecn = TRUE,
+		},
+	};
+	NMPlatformQdisc want;
+
+	/* unset parameters accept whatever kernel chose. */
+	want = (NMPlatformQdisc) {
+		.kind = "fq_codel",
+		.parent = TC_H_ROOT,
+		.fq_codel = {
+			.ce_threshold = NM_PLATFORM_FQ_CODEL_CE_THRESHOLD_DISABLED,
+			.memory_limit = NM_PLATFORM_FQ_CODEL_MEMORY_LIMIT_UNSET,
+		},
+	};
+	g_assert (_nmtst_platform_qdisc_is_satisfied (&plat, &want));
+
+	want.handle = plat.handle;
+	want.fq_codel.limit = 10240;
+	want.fq_codel.memory_limit = 33554432;
+	want.fq_codel.ecn = TRUE;
+	g_assert (_nmtst_platform_qdisc_is_satisfied (&plat, &want));
+
+	want.handle = TC_H_MAKE (0x8002u << 16, 0);
+	g_assert (!_nmtst_platform_qdisc_is_satisfied (&plat, &want));
+	want.handle = 0;
+
+	want.fq_codel.limit = 10241;
+	g_assert (!_nmtst_platform_qdisc_is_satisfied (&plat, &want));
+	want.fq_codel.limit = 0;
+
+	/* zero is a valid ce-threshold and memory-limit, not the default. */
+	want.fq_codel.ce_threshold = 0;
+	g_assert (!_nmtst_platform_qdisc_is_satisfied (&plat, &want));
+	want.fq_codel.ce_threshold = NM_PLATFORM_FQ_CODEL_CE_THRESHOLD_DISABLED;
+
+	want.fq_codel.memory_limit = 0;
+	g_assert (!_nmtst_platform_qdisc_is_satisfied (&plat, &want));
+	want.fq_codel.memory_limit = NM_PLATFORM_FQ_CODEL_MEMORY_LIMIT_UNSET;
+
+	/* ecn can only be requested, not explicitly disabled. */
+	{
+		NMPlatformQdisc plat2 = plat;
+
+		plat2.fq_codel.ecn = FALSE;
+		want.fq_codel.ecn = FALSE;
+		g_assert (_nmtst_platform_qdisc_is_satisfied (&plat2, &want));
+		want.fq_codel.ecn = TRUE;
+		g_assert (!_nmtst_platform_qdisc_is_satisfied (&plat2, &want));
+	}
+
+	want = (NMPlatformQdisc) {
+		.kind = "sfq",
+		.parent = TC_H_ROOT,
+	};
+	g_assert (!_nmtst_platform_qdisc_is_satisfied (&plat, &want));
+}
+
+static void
+test_tfilter_can_replace (void)
+{
+	const NMPlatformTfilter plat = {
+		.kind = "matchall",
+		.parent = TC_H_MAKE (0xFFFFu << 16, 0),
+		.info = TC_H_MAKE (49152u << 16, 0x0300u),
+		.action = {
+			.kind = NM_PLATFORM_ACTION_KIND_SIMPLE,
+		},
+	};
+	NMPlatformTfilter want;
+
+	/* the action is what gets replaced. */
+	want = plat;
+	want.action.kind = NM_PLATFORM_ACTION_KIND_MIRRED;
+	g_assert (_nmtst_platform_tfilter_can_replace (&plat, &want));
+
+	/* a zero priority lets kernel choose it. */
+	want.info = TC_H_MAKE (0, 0x0300u);
+	g_assert (_nmtst_platform_tfilter_can_replace (&plat, &want));
+
+	want.info = TC_H_MAKE (49153u << 16, 0x0300u);
+	g_assert (!_nmtst_platform_tfilter_can_replace (&plat, &want));
+
+	/* a different protocol. */
+	want.info = TC_H_MAKE (49152u << 16, 0x0008u);
+	g_assert (!_nmtst_platform_tfilter_can_replace (&plat, &want));
+
+	want = plat;
+	want.parent = TC_H_MAKE (0x8001u << 16, 0);
+	g_assert (!_nmtst_platform_tfilter_can_replace (&plat, &want));
+
+	want = plat;
+	want.kind = "u32";
+	g_assert (!_nmtst_platform_tfilter_can_replace (&plat, &want));
+}
+
+/*****************************************************************************/
+
+static guint
+_sriov_nlmsg_count_vfs (struct nl_msg *nlmsg)
+{
+	struct nlmsghdr *nlh = nlmsg_hdr (nlmsg);
+	struct nlattr *list;
+	struct nlattr *nla;
+	guint n = 0;
+	int rem;
+
+	g_assert_cmpint (nlh->nlmsg_type, ==, RTM_SETLINK);
+
+	list = nlmsg_find_attr (nlh, sizeof (struct ifinfomsg), IFLA_VFINFO_LIST);
+	g_assert (list);
+
+	nla_for_each_nested (nla, list, rem) {
+		g_assert_cmpint (nla_type (nla), ==, IFLA_VF_INFO);
+		n++;
+	}
+	return n;
+}
+
+static void
+test_sriov_vfs_nlmsgs (void)
+{
+	gs_unref_object NMPlatform *platform = NULL;
+	gs_unref_ptrarray GPtrArray *nlmsgs = NULL;
+	NMPlatformVF vfs_data[50];
+	const NMPlatformVF *vfs[G_N_ELEMENTS (vfs_data) + 1];
+	NMPlatformVFVlan vlans[2] = { };
+	guint n_per_msg;
+	guint n_total;
+	guint i;
+
+	/* a replay platform fails reading the VFs from kernel, so that all
+	 * VFs get configured. */
+	platform = nm_linux_platform_new_replay (TRUE);
+
+	for (i = 0; i < G_N_ELEMENTS (vfs_data); i++) {
+		vfs_data[i] = (NMPlatformVF) {
+			.index    = i,
+			.spoofchk = -1,
+			.trust    = -1,
+		};
+		vfs[i] = &vfs_data[i];
+	}
+	vfs[G_N_ELEMENTS (vfs_data)] = NULL;
+
+	nlmsgs = _nmtst_linux_platform_sriov_vfs_create_nlmsgs (platform, 7, vfs);
+	g_assert (nlmsgs);
+	g_assert_cmpint (nlmsgs->len, >, 1);
+
+	/* all messages but the last one are full. */
+	n_per_msg = _sriov_nlmsg_count_vfs (nlmsgs->pdata[0]);
+	n_total = 0;
+	for (i = 0; i < nlmsgs->len; i++) {
+		const guint n = _sriov_nlmsg_count_vfs (nlmsgs->pdata[i]);
+
+		if (i + 1 < nlmsgs->len)
+			g_assert_cmpint (n, ==, n_per_msg);
+		else
+			g_assert_cmpint (n, >, 0);
+		g_assert_cmpint (n, <=, n_per_msg);
+		g_assert_cmpint (nlmsg_hdr (nlmsgs->pdata[i])->nlmsg_len, <=, 4096);
+		n_total += n;
+	}
+	g_assert_cmpint (n_total, ==, G_N_ELEMENTS (vfs_data));
+	g_assert_cmpint (nlmsgs->len, ==, (G_N_ELEMENTS (vfs_data) + n_per_msg - 1) / n_per_msg);
+	g_clear_pointer (&nlmsgs, g_ptr_array_unref);
+
+	/* exactly one full message. */
+	vfs[n_per_msg] = NULL;
+	nlmsgs = _nmtst_linux_platform_sriov_vfs_create_nlmsgs (platform, 7, vfs);
+	g_assert (nlmsgs);
+	g_assert_cmpint (nlmsgs->len, ==, 1);
+	g_assert_cmpint (_sriov_nlmsg_count_vfs (nlmsgs->pdata[0]), ==, n_per_msg);
+	g_clear_pointer (&nlmsgs, g_ptr_array_unref);
+
+	/* nothing to configure. */
+	vfs[0] = NULL;
+	nlmsgs = _nmtst_linux_platform_sriov_vfs_create_nlmsgs (platform, 7, vfs);
+	g_assert (nlmsgs);
+	g_assert_cmpint (nlmsgs->len, ==, 0);
+	g_clear_pointer (&nlmsgs, g_ptr_array_unref);
+
+	/* kernel supports only one VLAN per VF. */
+	vfs_data[0].num_vlans = 2;
+	vfs_data[0].vlans = vlans;
+	vfs[0] = &vfs_data[0];
+	vfs[1] = NULL;
+	NMTST_EXPECT_NM_WARN ("*multiple VLANs per VF are not supported*");
+	nlmsgs = _nmtst_linux_platform_sriov_vfs_create_nlmsgs (platform, 7, vfs);
+	g_test_assert_expected_messages ();
+	g_assert (!nlmsgs);
+}
+
+static void
+test_sriov_vf_is_satisfied (void)
+{
+	NMPlatformVFVlan vf_vlan = { .id = 10, .qos = 3, };
+	NMPlatformVFVlan state_vlan;
+	NMPlatformVF vf;
+	NMPlatformVF state;
+
+	state = (NMPlatformVF) {
+		.index       = 1,
+		.mac         = {
+			.data = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 },
+			.len  = 6,
+		},
+		.spoofchk    = 1,
+		.trust       = 0,
+		.min_tx_rate = 100,
+		.max_tx_rate = 1000,
+	};
+
+	/* nothing requested, only the VLAN gets cleared. */
+	vf = (NMPlatformVF) {
+		.index    = 1,
+		.spoofchk = -1,
+		.trust    = -1,
+	};
+	g_assert (_nmtst_linux_platform_sriov_vf_is_satisfied (&vf, &state));
+
+	state_vlan = vf_vlan;
+	state.num_vlans = 1;
+	state.vlans = &state_vlan;
+	g_assert (!_nmtst_linux_platform_sriov_vf_is_satisfied (&vf, &state));
+
+	vf.num_vlans = 1;
+	vf.vlans = &vf_vlan;
+	g_assert (_nmtst_linux_platform_sriov_vf_is_satisfied (&vf, &state));
+
+	state_vlan.qos = 4;
+	g_assert (!_nmtst_linux_platform_sriov_vf_is_satisfied (&vf, &state));
+	state_vlan.qos = vf_vlan.qos;
+	state_vlan.proto_ad = TRUE;
+	g_assert (!_nmtst_linux_platform_sriov_vf_is_satisfied (&vf, &state));
+	vf_vlan.proto_ad = TRUE;
+	g_assert (_nmtst_linux_platform_sriov_vf_is_satisfied (&vf, &state));
+	state_vlan.id = 11;
+	g_assert (!_nmtst_linux_platform_sriov_vf_is_satisfied (&vf, &state));
+	state_vlan.id = vf_vlan.id;
+
+	/* MAC address */
+	vf.mac = state.mac;
+	g_assert (_nmtst_linux_platform_sriov_vf_is_satisfied (&vf, &state));
+	vf.mac.data[5] = 0x56;
+	g_assert (!_nmtst_linux_platform_sriov_vf_is_satisfied (&vf, &state));
+	vf.mac = state.mac;
+
+	/* rates are set together. */
+	vf.min_tx_rate = state.min_tx_rate;
+	vf.max_tx_rate = state.max_tx_rate;
+	g_assert (_nmtst_linux_platform_sriov_vf_is_satisfied (&vf, &state));
+	vf.max_tx_rate = 2000;
+	g_assert (!_nmtst_linux_platform_sriov_vf_is_satisfied (&vf, &state));
+	vf.min_tx_rate = 0;
+	vf.max_tx_rate = 0;
+	g_assert (_nmtst_linux_platform_sriov_vf_is_satisfied (&vf, &state));
+	vf.max_tx_rate = state.max_tx_rate;
+	g_assert (!_nmtst_linux_platform_sriov_vf_is_satisfied (&vf, &state));
+	vf.min_tx_rate = state.min_tx_rate;
+
+	/* spoofchk and trust */
+	vf.spoofchk = 1;
+	vf.trust = 0;
+	g_assert (_nmtst_linux_platform_sriov_vf_is_satisfied (&vf, &state));
+	vf.spoofchk = 0;
+	g_assert (!_nmtst_linux_platform_sriov_vf_is_satisfied (&vf, &state));
+	vf.spoofchk = 1;
+	vf.trust = 1;
+	g_assert (!_nmtst_linux_platform_sriov_vf_is_satisfied (&vf, &state));
+}
+
+/*****************************************************************************/
+
+static void
+test_ethtool_features_prepare_set (void)
+{
+	gs_free NMEthtoolFeatureStates *features = NULL;
+	const char *ss_features[40];
+	char ss_features_buf[G_N_ELEMENTS (ss_features)][20];
+	NMPUtilsEthtoolFeatureBlock blocks[2] = { };
+	NMTernary requested[_NM_ETHTOOL_ID_FEATURE_NUM];
+	guint32 valid[2];
+	guint32 wanted[2];
+	gboolean success;
+	guint n;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (ss_features); i++) {
+		nm_sprintf_buf (ss_features_buf[i], "unknown-%u", i);
+		ss_features[i] = ss_features_buf[i];
+	}
+
+	/* the second block is used too. "rx-gro" can never be changed,
+	 * "rx-lro" is fixed. */
+	ss_features[0] = "rx-checksum";
+	ss_features[1] = "tx-scatter-gather";
+	ss_features[2] = "tx-scatter-gather-fraglist";
+	ss_features[3] = "rx-lro";
+	ss_features[33] = "rx-gro";
+	ss_features[34] = "rx-hashing";
+	blocks[0].available = (1u << 0) | (1u << 1) | (1u << 2);
+	blocks[0].active = (1u << 0) | (1u << 2);
+	blocks[0].requested = blocks[0].active;
+	blocks[1].available = (1u << 1) | (1u << 2);
+	blocks[1].active = (1u << 1);
+	blocks[1].requested = blocks[1].active;
+	blocks[1].never_changed = (1u << 1);
+
+	features = nmp_utils_ethtool_features_new (G_N_ELEMENTS (ss_features), ss_features, blocks);
+	g_assert (features);
+	g_assert_cmpint (features->n_states, ==, 6);
+	g_assert_cmpint (features->n_ss_features, ==, G_N_ELEMENTS (ss_features));
+
+	/* both kernel names of "sg" */
+	g_assert (features->states_indexed[NM_ETHTOOL_ID_FEATURE_SG - _NM_ETHTOOL_ID_FEATURE_FIRST]);
+	g_assert (features->states_indexed[NM_ETHTOOL_ID_FEATURE_SG - _NM_ETHTOOL_ID_FEATURE_FIRST][1]);
+	g_assert (!features->states_indexed[NM_ETHTOOL_ID_FEATURE_SG - _NM_ETHTOOL_ID_FEATURE_FIRST][2]);
+	g_assert (!features->states_indexed[NM_ETHTOOL_ID_FEATURE_TSO - _NM_ETHTOOL_ID_FEATURE_FIRST]);
+
+#define _REQUESTED_RESET() \
+	G_STMT_START { \
+		for (i = 0; i < G_N_ELEMENTS (requested); i++) \
+			requested[i] = NM_TERNARY_DEFAULT; \
+		memset (valid, 0, sizeof (valid)); \
+		memset (wanted, 0, sizeof (wanted)); \
+	} G_STMT_END
+#define _REQUESTED(id) requested[NM_ETHTOOL_ID_FEATURE_##id - _NM_ETHTOOL_ID_FEATURE_FIRST]
+
+	/* nothing requested. */
+	_REQUESTED_RESET ();
+	n = nmp_utils_ethtool_features_prepare_set (1, features, requested, TRUE, valid, wanted, &success);
+	g_assert_cmpint (n, ==, 0);
+	g_assert (success);
+	g_assert_cmpint (valid[0], ==, 0);
+	g_assert_cmpint (valid[1], ==, 0);
+
+	/* all changes are collected together. */
+	_REQUESTED_RESET ();
+	_REQUESTED (RX) = NM_TERNARY_FALSE;
+	_REQUESTED (SG) = NM_TERNARY_TRUE;
+	_REQUESTED (RXHASH) = NM_TERNARY_TRUE;
+	n = nmp_utils_ethtool_features_prepare_set (1, features, requested, TRUE, valid, wanted, &success);
+	g_assert_cmpint (n, ==, 4);
+	g_assert (success);
+	g_assert_cmpint (valid[0], ==, (1u << 0) | (1u << 1) | (1u << 2));
+	g_assert_cmpint (wanted[0], ==, (1u << 1) | (1u << 2));
+	g_assert_cmpint (valid[1], ==, (1u << 2));
+	g_assert_cmpint (wanted[1], ==, (1u << 2));
+
+	/* resetting restores the current state. */
+	_REQUESTED_RESET ();
+	_REQUESTED (RX) = NM_TERNARY_FALSE;
+	_REQUESTED (SG) = NM_TERNARY_TRUE;
+	n = nmp_utils_ethtool_features_prepare_set (1, features, requested, FALSE, valid, wanted, &success);
+	g_assert_cmpint (n, ==, 3);
+	g_assert (success);
+	g_assert_cmpint (valid[0], ==, (1u << 0) | (1u << 1) | (1u << 2));
+	g_assert_cmpint (wanted[0], ==, (1u << 0) | (1u << 2));
+
+	/* changing a fixed feature fails, but it's still requested. */
+	_REQUESTED_RESET ();
+	_REQUESTED (LRO) = NM_TERNARY_TRUE;
+	n = nmp_utils_ethtool_features_prepare_set (1, features, requested, TRUE, valid, wanted, &success);
+	g_assert_cmpint (n, ==, 1);
+	g_assert (!success);
+	g_assert_cmpint (valid[0], ==, (1u << 3));
+	g_assert_cmpint (wanted[0], ==, (1u << 3));
+
+	/* the fixed feature already has the requested state. */
+	_REQUESTED_RESET ();
+	_REQUESTED (LRO) = NM_TERNARY_FALSE;
+	n = nmp_utils_ethtool_features_prepare_set (1, features, requested, TRUE, valid, wanted, &success);
+	g_assert_cmpint (n, ==, 1);
+	g_assert (success);
+
+	/* features marked as never changed are skipped. */
+	_REQUESTED_RESET ();
+	_REQUESTED (GRO) = NM_TERNARY_FALSE;
+	n = nmp_utils_ethtool_features_prepare_set (1, features, requested, TRUE, valid, wanted, &success);
+	g_assert_cmpint (n, ==, 0);
+	g_assert (success);
+	g_assert_cmpint (valid[1], ==, 0);
+
+	/* a feature that the device doesn't have only fails when set. */
+	_REQUESTED_RESET ();
+	_REQUESTED (TSO) = NM_TERNARY_TRUE;
+	n = nmp_utils_ethtool_features_prepare_set (1, features, requested, TRUE, valid, wanted, &success);
+	g_assert_cmpint (n, ==, 0);
+	g_assert (!success);
+	n = nmp_utils_ethtool_features_prepare_set (1, features, requested, FALSE, valid, wanted, &success);
+	g_assert_cmpint (n, ==, 0);
+	g_assert (success);
+
+#undef _REQUESTED
+#undef _REQUESTED_RESET
+}
+
+/* the attributes of a bitset, from <linux/ethtool_netlink.h> */
+#define ETHTOOL_A_BITSET_NOMASK 1
+#define ETHTOOL_A_BITSET_SIZE   2
+#define ETHTOOL_A_BITSET_VALUE  4
+
+static void
+test_ethtool_bitset_parse (void)
+{
+	nm_auto_nlmsg struct nl_msg *msg = NULL;
+	const guint32 value[2] = { 0x80000005u, 0x3u };
+	struct nlattr *nla_compact;
+	struct nlattr *nla_no_value;
+	guint32 words[3];
+
+	msg = nlmsg_alloc ();
+
+	nla_compact = nla_nest_start (msg, 1);
+	g_assert (nla_compact);
+	g_assert_cmpint (nla_put (msg, ETHTOOL_A_BITSET_NOMASK, 0, NULL), >=, 0);
+	g_assert_cmpint (nla_put_uint32 (msg, ETHTOOL_A_BITSET_SIZE, 34), >=, 0);
+	g_assert_cmpint (nla_put (msg, ETHTOOL_A_BITSET_VALUE, sizeof (value), value), >=, 0);
+	nla_nest_end (msg, nla_compact);
+
+	nla_no_value = nla_nest_start (msg, 2);
+	g_assert (nla_no_value);
+	g_assert_cmpint (nla_put (msg, ETHTOOL_A_BITSET_NOMASK, 0, NULL), >=, 0);
+	g_assert_cmpint (nla_put_uint32 (msg, ETHTOOL_A_BITSET_SIZE, 34), >=, 0);
+	nla_nest_end (msg, nla_no_value);
+
+	memset (words, 0xFF, sizeof (words));
+	g_assert (_nmtst_linux_platform_ethtool_bitset_parse (nla_compact, words, 2));
+	g_assert_cmpint (words[0], ==, value[0]);
+	g_assert_cmpint (words[1], ==, value[1]);
+	g_assert_cmpint (words[2], ==, 0xFFFFFFFFu);
+
+	/* the remaining words are cleared. */
+	memset (words, 0xFF, sizeof (words));
+	g_assert (_nmtst_linux_platform_ethtool_bitset_parse (nla_compact, words, 3));
+	g_assert_cmpint (words[0], ==, value[0]);
+	g_assert_cmpint (words[1], ==, value[1]);
+	g_assert_cmpint (words[2], ==, 0);
+
+	/* extra words are ignored. */
+	memset (words, 0xFF, sizeof (words));
+	g_assert (_nmtst_linux_platform_ethtool_bitset_parse (nla_compact, words, 1));
+	g_assert_cmpint (words[0], ==, value[0]);
+	g_assert_cmpint (words[1], ==, 0xFFFFFFFFu);
+
+	/* only compact bitsets are supported. */
+	memset (words, 0xFF, sizeof (words));
+	g_assert (!_nmtst_linux_platform_ethtool_bitset_parse (nla_no_value, words, 2));
+	g_assert_cmpint (words[0], ==, 0);
+	g_assert_cmpint (words[1], ==, 0);
+
+	memset (words, 0xFF, sizeof (words));
+	g_assert (!_nmtst_linux_platform_ethtool_bitset_parse (NULL, words, 2));
+	g_assert_cmpint (words[0], ==, 0);
+	g_assert_cmpint (words[1], ==, 0);
+}
+
+/*****************************************************************************/
+
 NMTST_DEFINE ();
 
 int
@@ -72,6 +818,14 @@ main (int argc, char **argv)
 	g_test_add_func ("/general/init_linux_platform", test_init_linux_platform);
 	g_test_add_func ("/general/link_get_all", test_link_get_all);
 	g_test_add_func ("/general/nm_platform_link_flags2str", test_nm_platform_link_flags2str);
+	g_test_add_func ("/general/nl_record_replay", test_nl_record_replay);
+	g_test_add_func ("/general/wireguard_peers_diff", test_wireguard_peers_diff);
+	g_test_add_func ("/general/qdisc_is_satisfied", test_qdisc_is_satisfied);
+	g_test_add_func ("/general/tfilter_can_replace", test_tfilter_can_replace);
+	g_test_add_func ("/general/sriov_vfs_nlmsgs", test_sriov_vfs_nlmsgs);
+	g_test_add_func ("/general/sriov_vf_is_satisfied", test_sriov_vf_is_satisfied);
+	g_test_add_func ("/general/ethtool_features_prepare_set", test_ethtool_features_prepare_set);
+	g_test_add_func ("/general/ethtool_bitset_parse", test_ethtool_bitset_parse);
 
 	return g_test_run ();
 }
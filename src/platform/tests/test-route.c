@@ -306,6 +306,822 @@ test_ip4_route (void)
 	free_signal (route_removed);
 }
 
+static void
+test_ip4_route_sync_many (void)
+{
+	const int ifindex = nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME);
+	gs_unref_ptrarray GPtrArray *routes = NULL;
+	gs_unref_ptrarray GPtrArray *routes_prune = NULL;
+	gs_unref_ptrarray GPtrArray *routes_cur = NULL;
+	const guint N_ROUTES = 600;
+	guint i;
+
+	/* enough routes, so that the linux platform needs to send more than one
+	 * batch of requests. */
+	routes = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
+	for (i = 0; i < N_ROUTES; i++) {
+		const NMPlatformIP4Route r = {
+			.ifindex = ifindex,
+			.rt_source = NM_IP_CONFIG_SOURCE_USER,
+			.network = htonl (0xC6120000u + i),
+			.plen = 32,
+			.metric = 22987,
+		};
+
+		g_ptr_array_add (routes, nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, &r));
+	}
+
+	g_assert (nm_platform_ip_route_sync (NM_PLATFORM_GET, AF_INET, ifindex, routes, NULL, NULL));
+
+	routes_cur = nmtstp_ip4_route_get_all (NM_PLATFORM_GET, ifindex);
+	g_assert_cmpint (routes_cur->len, ==, N_ROUTES);
+	nm_clear_pointer (&routes_cur, g_ptr_array_unref);
+
+	/* syncing again is a no-op. */
+	g_assert (nm_platform_ip_route_sync (NM_PLATFORM_GET, AF_INET, ifindex, routes, NULL, NULL));
+
+	/* keep only the first half of the routes, and prune the rest. */
+	g_ptr_array_set_size (routes, N_ROUTES / 2);
+	routes_prune = nm_platform_ip_route_get_prune_list (NM_PLATFORM_GET,
+	                                                    AF_INET,
+	                                                    ifindex,
+	                                                    NM_IP_ROUTE_TABLE_SYNC_MODE_ALL);
+	g_assert (routes_prune);
+	g_assert (nm_platform_ip_route_sync (NM_PLATFORM_GET, AF_INET, ifindex, routes, routes_prune, NULL));
+
+	routes_cur = nmtstp_ip4_route_get_all (NM_PLATFORM_GET, ifindex);
+	g_assert_cmpint (routes_cur->len, ==, N_ROUTES / 2);
+	nm_clear_pointer (&routes_cur, g_ptr_array_unref);
+
+	g_assert (nm_platform_ip_route_flush (NM_PLATFORM_GET, AF_INET, ifindex));
+
+	routes_cur = nmtstp_ip4_route_get_all (NM_PLATFORM_GET, ifindex);
+	g_assert_cmpint (routes_cur->len, ==, 0);
+}
+
+static void
+test_ip4_route_sync_gateway (void)
+{
+	const int ifindex = nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME);
+	const NMPlatformIP4Route route = {
+		.ifindex = ifindex,
+		.rt_source = NM_IP_CONFIG_SOURCE_USER,
+		.network = nmtst_inet4_from_string ("198.18.9.0"),
+		.plen = 24,
+		.gateway = nmtst_inet4_from_string ("198.18.8.1"),
+		.metric = 22987,
+	};
+	gs_unref_ptrarray GPtrArray *routes = NULL;
+	gs_unref_ptrarray GPtrArray *routes_prune = NULL;
+	const NMDedupMultiHeadEntry *head_entry;
+
+	routes = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
+	g_ptr_array_add (routes, nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, &route));
+
+	/* the gateway is not reachable, the sync adds a direct route to it. */
+	g_assert (nm_platform_ip_route_sync (NM_PLATFORM_GET, AF_INET, ifindex, routes, NULL, NULL));
+	g_assert (nmtstp_ip4_route_get (NM_PLATFORM_GET, ifindex, route.network, route.plen, route.metric, 0));
+	g_assert (nmtstp_ip4_route_get (NM_PLATFORM_GET, ifindex, route.gateway, 32, route.metric, 0));
+
+	head_entry = nm_platform_lookup_ip4_route_by_gateway (NM_PLATFORM_GET, route.gateway);
+	g_assert (head_entry);
+	g_assert_cmpint (head_entry->len, ==, 1);
+
+	/* pruning keeps the direct route, as long as the route via the gateway stays. */
+	routes_prune = nm_platform_ip_route_get_prune_list (NM_PLATFORM_GET,
+	                                                    AF_INET,
+	                                                    ifindex,
+	                                                    NM_IP_ROUTE_TABLE_SYNC_MODE_ALL);
+	g_assert (nm_platform_ip_route_sync (NM_PLATFORM_GET, AF_INET, ifindex, routes, routes_prune, NULL));
+	g_assert (nmtstp_ip4_route_get (NM_PLATFORM_GET, ifindex, route.network, route.plen, route.metric, 0));
+	g_assert (nmtstp_ip4_route_get (NM_PLATFORM_GET, ifindex, route.gateway, 32, route.metric, 0));
+	nm_clear_pointer (&routes_prune, g_ptr_array_unref);
+
+	/* without the route via the gateway, both go away. */
+	g_ptr_array_set_size (routes, 0);
+	routes_prune = nm_platform_ip_route_get_prune_list (NM_PLATFORM_GET,
+	                                                    AF_INET,
+	                                                    ifindex,
+	                                                    NM_IP_ROUTE_TABLE_SYNC_MODE_ALL);
+	g_assert (nm_platform_ip_route_sync (NM_PLATFORM_GET, AF_INET, ifindex, routes, routes_prune, NULL));
+	g_assert (!nmtstp_ip4_route_get (NM_PLATFORM_GET, ifindex, route.network, route.plen, route.metric, 0));
+	g_assert (!nmtstp_ip4_route_get (NM_PLATFORM_GET, ifindex, route.gateway, 32, route.metric, 0));
+	g_assert (!nm_platform_lookup_ip4_route_by_gateway (NM_PLATFORM_GET, route.gateway));
+}
+
+static gboolean
+_ip4_route_sync_with_state (int ifindex, NMPlatformIPRouteSyncState *state, GPtrArray *routes)
+{
+	gs_unref_ptrarray GPtrArray *routes_prune = NULL;
+
+	routes_prune = nm_platform_ip_route_sync_state_get_prune_list (NM_PLATFORM_GET,
+	                                                               state,
+	                                                               AF_INET,
+	                                                               ifindex,
+	                                                               NM_IP_ROUTE_TABLE_SYNC_MODE_ALL);
+	return nm_platform_ip_route_sync_with_state (NM_PLATFORM_GET,
+	                                             AF_INET,
+	                                             ifindex,
+	                                             state,
+	                                             routes,
+	                                             routes_prune,
+	                                             NM_IP_ROUTE_TABLE_SYNC_MODE_ALL,
+	                                             NULL);
+}
+
+static void
+test_ip4_route_dump_while_deleting (void)
+{
+	const int ifindex = nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME);
+	gs_unref_object NMPlatform *platform = NULL;
+	gs_unref_ptrarray GPtrArray *routes = NULL;
+	gs_unref_ptrarray GPtrArray *routes_cur = NULL;
+	gs_free_error GError *error = NULL;
+	gs_free char *donefile = NULL;
+	const guint N_ROUTES = 3000;
+	guint i;
+	int fd;
+
+	routes = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
+	for (i = 0; i < N_ROUTES; i++) {
+		const NMPlatformIP4Route r = {
+			.ifindex = ifindex,
+			.rt_source = NM_IP_CONFIG_SOURCE_USER,
+			.network = htonl (0xC6130000u + i),
+			.plen = 32,
+			.metric = 22993,
+		};
+
+		g_ptr_array_add (routes, nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, &r));
+	}
+	g_assert (nm_platform_ip_route_sync (NM_PLATFORM_GET, AF_INET, ifindex, routes, NULL, NULL));
+
+	fd = g_file_open_tmp ("nm-test-done-XXXXXX", &donefile, &error);
+	g_assert_no_error (error);
+	nm_close (fd);
+	unlink (donefile);
+
+	/* delete the routes while a new platform instance dumps them. The deletion
+	 * events arrive on the event socket and can overtake the dump datagrams
+	 * on the request socket. No deleted route may come back from the dump. */
+	nmtstp_run_command_check ("(ip route flush dev %s; touch %s) &", DEVICE_NAME, donefile);
+	platform = nm_linux_platform_new (TRUE, NM_PLATFORM_NETNS_SUPPORT_DEFAULT);
+
+	NMTST_WAIT_ASSERT (5000, {
+		if (g_file_test (donefile, G_FILE_TEST_EXISTS))
+			break;
+		g_usleep (10 * 1000);
+	});
+	unlink (donefile);
+
+	NMTST_WAIT_ASSERT (1000, {
+		nm_platform_process_events (platform);
+		routes_cur = nmtstp_ip4_route_get_all (platform, ifindex);
+		if (routes_cur->len == 0)
+			break;
+		nm_clear_pointer (&routes_cur, g_ptr_array_unref);
+		nmtstp_wait_for_signal (platform, 10);
+	});
+
+	/* no more events must bring them back. */
+	nmtstp_wait_for_signal (platform, 50);
+	nm_platform_process_events (platform);
+	nm_clear_pointer (&routes_cur, g_ptr_array_unref);
+	routes_cur = nmtstp_ip4_route_get_all (platform, ifindex);
+	g_assert_cmpint (routes_cur->len, ==, 0);
+}
+
+static void
+test_ip4_route_sync_state (void)
+{
+	const int ifindex = nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME);
+	gs_unref_ptrarray GPtrArray *routes = NULL;
+	gs_unref_ptrarray GPtrArray *routes_cur = NULL;
+	NMPlatformIPRouteSyncState *state;
+	NMPlatformIP4Route r_changed;
+	const NMPlatformIP4Route *r;
+	const guint N_ROUTES = 10;
+	guint i;
+
+	routes = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
+	for (i = 0; i < N_ROUTES; i++) {
+		const NMPlatformIP4Route r = {
+			.ifindex = ifindex,
+			.rt_source = NM_IP_CONFIG_SOURCE_USER,
+			.network = htonl (0xC6130000u + i),
+			.plen = 32,
+			.metric = 22988,
+		};
+
+		g_ptr_array_add (routes, nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, &r));
+	}
+
+	state = nm_platform_ip_route_sync_state_new ();
+
+	g_assert (_ip4_route_sync_with_state (ifindex, state, routes));
+	g_assert_cmpint (_nmtst_platform_ip_route_sync_state_get_n_diffed (state), ==, N_ROUTES);
+	routes_cur = nmtstp_ip4_route_get_all (NM_PLATFORM_GET, ifindex);
+	g_assert_cmpint (routes_cur->len, ==, N_ROUTES);
+	nm_clear_pointer (&routes_cur, g_ptr_array_unref);
+
+	/* nothing changed, this only diffs against the state and does not
+	 * even look at the unchanged routes. */
+	g_assert (_ip4_route_sync_with_state (ifindex, state, routes));
+	g_assert_cmpint (_nmtst_platform_ip_route_sync_state_get_n_diffed (state), ==, 0);
+	routes_cur = nmtstp_ip4_route_get_all (NM_PLATFORM_GET, ifindex);
+	g_assert_cmpint (routes_cur->len, ==, N_ROUTES);
+	nm_clear_pointer (&routes_cur, g_ptr_array_unref);
+
+	/* only the changed route gets diffed and replaced. */
+	r_changed = *NMP_OBJECT_CAST_IP4_ROUTE (routes->pdata[3]);
+	r_changed.mss = 1300;
+	nmp_object_unref (routes->pdata[3]);
+	routes->pdata[3] = nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, &r_changed);
+	g_assert (_ip4_route_sync_with_state (ifindex, state, routes));
+	g_assert_cmpint (_nmtst_platform_ip_route_sync_state_get_n_diffed (state), ==, 1);
+	r = nmtstp_ip4_route_get (NM_PLATFORM_GET, ifindex, r_changed.network, 32, 22988, 0);
+	g_assert (r);
+	g_assert_cmpint (r->mss, ==, 1300);
+	routes_cur = nmtstp_ip4_route_get_all (NM_PLATFORM_GET, ifindex);
+	g_assert_cmpint (routes_cur->len, ==, N_ROUTES);
+	nm_clear_pointer (&routes_cur, g_ptr_array_unref);
+
+	/* a route removed behind our back is noticed and added again. */
+	g_assert (nmtstp_platform_ip4_route_delete (NM_PLATFORM_GET, ifindex, htonl (0xC6130000u), 32, 22988));
+	g_assert (_ip4_route_sync_with_state (ifindex, state, routes));
+	routes_cur = nmtstp_ip4_route_get_all (NM_PLATFORM_GET, ifindex);
+	g_assert_cmpint (routes_cur->len, ==, N_ROUTES);
+	nm_clear_pointer (&routes_cur, g_ptr_array_unref);
+
+	/* routes that are gone from the configuration get pruned. */
+	g_ptr_array_set_size (routes, N_ROUTES / 2);
+	g_assert (_ip4_route_sync_with_state (ifindex, state, routes));
+	g_assert_cmpint (_nmtst_platform_ip_route_sync_state_get_n_diffed (state), ==, N_ROUTES / 2);
+	routes_cur = nmtstp_ip4_route_get_all (NM_PLATFORM_GET, ifindex);
+	g_assert_cmpint (routes_cur->len, ==, N_ROUTES / 2);
+	nm_clear_pointer (&routes_cur, g_ptr_array_unref);
+
+	nm_platform_ip_route_sync_state_free (state);
+
+	g_assert (nm_platform_ip_route_flush (NM_PLATFORM_GET, AF_INET, ifindex));
+}
+
+typedef struct {
+	GMainLoop *loop;
+	guint n_pending;
+	guint n_failed;
+} AsyncData;
+
+static void
+_async_cb (GError *error, gpointer user_data)
+{
+	AsyncData *data = user_data;
+
+	if (error)
+		data->n_failed++;
+	g_assert_cmpint (data->n_pending, >, 0);
+	if (--data->n_pending == 0)
+		g_main_loop_quit (data->loop);
+}
+
+static void
+test_ip4_route_async (void)
+{
+	const int ifindex = nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME);
+	gs_unref_ptrarray GPtrArray *routes = NULL;
+	gs_unref_ptrarray GPtrArray *routes_cur = NULL;
+	gs_unref_object GCancellable *cancellable = NULL;
+	AsyncData data = { };
+	const guint N_ROUTES = 20;
+	guint i;
+
+	data.loop = g_main_loop_new (NULL, FALSE);
+	cancellable = g_cancellable_new ();
+
+	routes = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
+	for (i = 0; i < N_ROUTES; i++) {
+		const NMPlatformIP4Route r = {
+			.ifindex = ifindex,
+			.rt_source = NM_IP_CONFIG_SOURCE_USER,
+			.network = htonl (0xC6140000u + i),
+			.plen = 32,
+			.metric = 22989,
+		};
+
+		g_ptr_array_add (routes, nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, &r));
+	}
+
+	/* all requests are in flight at the same time. */
+	for (i = 0; i < N_ROUTES; i++) {
+		nm_platform_object_add_async (NM_PLATFORM_GET, NMP_NLM_FLAG_ADD, routes->pdata[i],
+		                              _async_cb, &data, cancellable);
+		data.n_pending++;
+	}
+	if (!nmtst_main_loop_run (data.loop, 2000))
+		g_assert_not_reached ();
+	g_assert_cmpint (data.n_failed, ==, 0);
+
+	nm_platform_process_events (NM_PLATFORM_GET);
+	routes_cur = nmtstp_ip4_route_get_all (NM_PLATFORM_GET, ifindex);
+	g_assert_cmpint (routes_cur->len, ==, N_ROUTES);
+	nm_clear_pointer (&routes_cur, g_ptr_array_unref);
+
+	if (nmtstp_is_root_test ()) {
+		/* adding the same route again fails with EEXIST. */
+		nm_platform_object_add_async (NM_PLATFORM_GET, NMP_NLM_FLAG_ADD, routes->pdata[0],
+		                              _async_cb, &data, cancellable);
+		data.n_pending++;
+		if (!nmtst_main_loop_run (data.loop, 2000))
+			g_assert_not_reached ();
+		g_assert_cmpint (data.n_failed, ==, 1);
+		data.n_failed = 0;
+	}
+
+	for (i = 0; i < N_ROUTES; i++) {
+		nm_platform_object_delete_async (NM_PLATFORM_GET, routes->pdata[i],
+		                                 _async_cb, &data, cancellable);
+		data.n_pending++;
+	}
+	if (!nmtst_main_loop_run (data.loop, 2000))
+		g_assert_not_reached ();
+	g_assert_cmpint (data.n_failed, ==, 0);
+
+	nm_platform_process_events (NM_PLATFORM_GET);
+	routes_cur = nmtstp_ip4_route_get_all (NM_PLATFORM_GET, ifindex);
+	g_assert_cmpint (routes_cur->len, ==, 0);
+
+	g_main_loop_unref (data.loop);
+}
+
+typedef struct {
+	GMainLoop *loop;
+	in_addr_t network_a;
+	in_addr_t network_b;
+	NMPlatformSignalChangeType expected_a;
+	guint32 mss_a;
+	guint n_batches;
+	guint n_a;
+	guint n_b;
+} ChangeBatchData;
+
+static void
+_change_batch_cb (NMPlatform *platform,
+                  NMPObjectType obj_type,
+                  const NMPlatformChange *changes,
+                  guint n_changes,
+                  gpointer user_data)
+{
+	ChangeBatchData *data = user_data;
+	guint i;
+
+	g_assert_cmpint (obj_type, ==, NMP_OBJECT_TYPE_IP4_ROUTE);
+	g_assert_cmpint (n_changes, >, 0);
+
+	for (i = 0; i < n_changes; i++) {
+		const NMPObject *obj = changes[i].obj_new ?: changes[i].obj_old;
+
+		if (NMP_OBJECT_CAST_IP4_ROUTE (obj)->network == data->network_a) {
+			g_assert_cmpint (changes[i].change_type, ==, data->expected_a);
+			if (data->expected_a == NM_PLATFORM_SIGNAL_ADDED) {
+				g_assert (!changes[i].obj_old);
+				data->mss_a = NMP_OBJECT_CAST_IP4_ROUTE (changes[i].obj_new)->mss;
+			} else
+				g_assert (!changes[i].obj_new);
+			data->n_a++;
+		} else if (NMP_OBJECT_CAST_IP4_ROUTE (obj)->network == data->network_b)
+			data->n_b++;
+	}
+
+	data->n_batches++;
+	g_main_loop_quit (data->loop);
+}
+
+static void
+test_ip4_route_change_batch (void)
+{
+	const int ifindex = nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME);
+	nm_auto_nmpobj NMPObject *obj_a = NULL;
+	nm_auto_nmpobj NMPObject *obj_b = NULL;
+	NMPlatformIP4Route route_a = {
+		.ifindex = ifindex,
+		.rt_source = NM_IP_CONFIG_SOURCE_USER,
+		.network = nmtst_inet4_from_string ("198.21.1.0"),
+		.plen = 24,
+		.metric = 22991,
+		.mss = 1000,
+	};
+	NMPlatformIP4Route route_b = {
+		.ifindex = ifindex,
+		.rt_source = NM_IP_CONFIG_SOURCE_USER,
+		.network = nmtst_inet4_from_string ("198.21.2.0"),
+		.plen = 24,
+		.metric = 22991,
+	};
+	ChangeBatchData data = {
+		.network_a = route_a.network,
+		.network_b = route_b.network,
+		.expected_a = NM_PLATFORM_SIGNAL_ADDED,
+	};
+	guint subscription_id;
+
+	data.loop = g_main_loop_new (NULL, FALSE);
+
+	subscription_id = nm_platform_change_batch_subscribe (NM_PLATFORM_GET,
+	                                                      NMP_OBJECT_TYPE_IP4_ROUTE,
+	                                                      _change_batch_cb,
+	                                                      &data);
+	g_assert (subscription_id);
+
+	/* route A is added and changed, route B is added and removed again, all
+	 * before returning to the main loop. */
+	g_assert (NMTST_NM_ERR_SUCCESS (nm_platform_ip4_route_add (NM_PLATFORM_GET, NMP_NLM_FLAG_REPLACE, &route_a)));
+	route_a.mss = 1400;
+	g_assert (NMTST_NM_ERR_SUCCESS (nm_platform_ip4_route_add (NM_PLATFORM_GET, NMP_NLM_FLAG_REPLACE, &route_a)));
+	g_assert (NMTST_NM_ERR_SUCCESS (nm_platform_ip4_route_add (NM_PLATFORM_GET, NMP_NLM_FLAG_REPLACE, &route_b)));
+	obj_b = nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, (const NMPlatformObject *) &route_b);
+	g_assert (nm_platform_object_delete (NM_PLATFORM_GET, obj_b));
+	nm_platform_process_events (NM_PLATFORM_GET);
+
+	if (!nmtst_main_loop_run (data.loop, 2000))
+		g_assert_not_reached ();
+	g_assert_cmpint (data.n_batches, ==, 1);
+	g_assert_cmpint (data.n_a, ==, 1);
+	g_assert_cmpint (data.mss_a, ==, 1400);
+	g_assert_cmpint (data.n_b, ==, 0);
+
+	data.expected_a = NM_PLATFORM_SIGNAL_REMOVED;
+	obj_a = nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, (const NMPlatformObject *) &route_a);
+	g_assert (nm_platform_object_delete (NM_PLATFORM_GET, obj_a));
+	nm_platform_process_events (NM_PLATFORM_GET);
+
+	if (!nmtst_main_loop_run (data.loop, 2000))
+		g_assert_not_reached ();
+	g_assert_cmpint (data.n_batches, ==, 2);
+	g_assert_cmpint (data.n_a, ==, 2);
+
+	nm_platform_change_batch_unsubscribe (NM_PLATFORM_GET, subscription_id);
+
+	/* no more batches after unsubscribing. */
+	g_assert (NMTST_NM_ERR_SUCCESS (nm_platform_ip4_route_add (NM_PLATFORM_GET, NMP_NLM_FLAG_REPLACE, &route_b)));
+	nm_platform_process_events (NM_PLATFORM_GET);
+	nmtst_main_context_iterate_until (NULL, 100, FALSE);
+	g_assert_cmpint (data.n_batches, ==, 2);
+
+	g_assert (nm_platform_ip_route_flush (NM_PLATFORM_GET, AF_INET, ifindex));
+	g_main_loop_unref (data.loop);
+}
+
+static void
+test_ip4_route_record_replay (void)
+{
+	const int ifindex = nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME);
+	gs_unref_object NMPlatform *platform_replay = NULL;
+	gs_unref_ptrarray GPtrArray *routes = NULL;
+	gs_unref_ptrarray GPtrArray *routes_cur = NULL;
+	gs_unref_ptrarray GPtrArray *routes_replay = NULL;
+	gs_free_error GError *error = NULL;
+	gs_free char *filename = NULL;
+	const NMPlatformLink *plink;
+	const guint N_ROUTES = 20;
+	guint64 n_messages;
+	guint i;
+	int fd;
+
+	fd = g_file_open_tmp ("nm-test-record-XXXXXX", &filename, &error);
+	g_assert_no_error (error);
+	nm_close (fd);
+
+	g_assert (nm_linux_platform_record_start (NM_PLATFORM_GET, filename, &error));
+	g_assert_no_error (error);
+
+	routes = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
+	for (i = 0; i < N_ROUTES; i++) {
+		const NMPlatformIP4Route r = {
+			.ifindex = ifindex,
+			.rt_source = NM_IP_CONFIG_SOURCE_USER,
+			.network = htonl (0xC6140000u + i),
+			.plen = 32,
+			.metric = 22992,
+		};
+
+		g_ptr_array_add (routes, nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, &r));
+	}
+	g_assert (nm_platform_ip_route_sync (NM_PLATFORM_GET, AF_INET, ifindex, routes, NULL, NULL));
+
+	/* the last route is removed again. */
+	g_assert (nm_platform_object_delete (NM_PLATFORM_GET, routes->pdata[N_ROUTES - 1]));
+	nm_platform_process_events (NM_PLATFORM_GET);
+
+	nm_linux_platform_record_stop (NM_PLATFORM_GET);
+
+	/* the replay reproduces the cache content, without talking to kernel. */
+	platform_replay = nm_linux_platform_new_replay (TRUE);
+	g_assert (nm_linux_platform_replay (platform_replay, filename, &n_messages, &error));
+	g_assert_no_error (error);
+	g_assert_cmpint (n_messages, >, N_ROUTES);
+
+	plink = nm_platform_link_get (platform_replay, ifindex);
+	g_assert (plink);
+	g_assert_cmpstr (plink->name, ==, DEVICE_NAME);
+
+	for (i = 0; i < N_ROUTES; i++) {
+		const NMPlatformIP4Route *r = NMP_OBJECT_CAST_IP4_ROUTE (routes->pdata[i]);
+		const NMPlatformIP4Route *r_replay;
+
+		r_replay = nmtstp_ip4_route_get (platform_replay, ifindex, r->network, r->plen, r->metric, r->tos);
+		if (i < N_ROUTES - 1)
+			g_assert (r_replay);
+		else
+			g_assert (!r_replay);
+	}
+
+	routes_cur = nmtstp_ip4_route_get_all (NM_PLATFORM_GET, ifindex);
+	routes_replay = nmtstp_ip4_route_get_all (platform_replay, ifindex);
+	g_assert_cmpint (routes_replay->len, ==, routes_cur->len);
+
+	g_assert (nm_platform_ip_route_flush (NM_PLATFORM_GET, AF_INET, ifindex));
+	unlink (filename);
+}
+
+static void
+test_ip4_route_ignore (void)
+{
+	const int ifindex = nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME);
+	const guint8 protocols[] = { 12 /* bird */ };
+	const guint32 tables[] = { 10017 };
+	gs_unref_object NMPlatform *platform = NULL;
+	gs_unref_ptrarray GPtrArray *routes_prune = NULL;
+	gs_unref_ptrarray GPtrArray *routes_cur = NULL;
+
+	/* one ignored route is received by the initial dump... */
+	nmtstp_run_command_check ("ip route add 198.18.1.0/24 dev %s proto bird", DEVICE_NAME);
+
+	/* the default applies to platform instances created afterwards, like
+	 * the ones for other namespaces. */
+	nm_platform_route_ignore_set_default (protocols, G_N_ELEMENTS (protocols),
+	                                      tables, G_N_ELEMENTS (tables));
+	platform = nm_linux_platform_new (TRUE, NM_PLATFORM_NETNS_SUPPORT_DEFAULT);
+	nm_platform_route_ignore_set_default (NULL, 0, NULL, 0);
+
+	g_assert_cmpint (nm_platform_route_ignore_get (platform)->n_protocols, ==, 1);
+	g_assert_cmpint (nm_platform_route_ignore_get (NM_PLATFORM_GET)->n_protocols, ==, 0);
+
+	/* ... and the others by notifications. */
+	nmtstp_run_command_check ("ip route add 198.18.2.0/24 dev %s table 10017", DEVICE_NAME);
+	nmtstp_run_command_check ("ip route add 198.18.3.0/24 dev %s proto static", DEVICE_NAME);
+
+	NMTST_WAIT_ASSERT (100, {
+		nmtstp_wait_for_signal (platform, 10);
+		if (nmtstp_ip4_route_get (platform, ifindex, nmtst_inet4_from_string ("198.18.3.0"), 24, 0, 0))
+			break;
+	});
+
+	/* the ignored routes are hidden... */
+	nm_platform_process_events (platform);
+	g_assert (!nmtstp_ip4_route_get (platform, ifindex, nmtst_inet4_from_string ("198.18.1.0"), 24, 0, 0));
+	routes_cur = nmtstp_ip4_route_get_all (platform, ifindex);
+	g_assert_cmpint (routes_cur->len, ==, 1);
+	nm_clear_pointer (&routes_cur, g_ptr_array_unref);
+
+	/* ... and route sync doesn't prune them. */
+	routes_prune = nm_platform_ip_route_get_prune_list (platform,
+	                                                    AF_INET,
+	                                                    ifindex,
+	                                                    NM_IP_ROUTE_TABLE_SYNC_MODE_ALL);
+	g_assert (nm_platform_ip_route_sync (platform, AF_INET, ifindex, NULL, routes_prune, NULL));
+
+	/* the platform without policy still sees them. */
+	nm_platform_process_events (NM_PLATFORM_GET);
+	g_assert (nmtstp_ip4_route_get (NM_PLATFORM_GET, ifindex, nmtst_inet4_from_string ("198.18.1.0"), 24, 0, 0));
+
+	/* deleting the ignored routes succeeds, so they were not pruned. */
+	nmtstp_run_command_check ("ip route del 198.18.1.0/24 dev %s proto bird", DEVICE_NAME);
+	nmtstp_run_command_check ("ip route del 198.18.2.0/24 dev %s table 10017", DEVICE_NAME);
+	nmtstp_run_command_check ("ip route flush dev %s", DEVICE_NAME);
+}
+
+static void
+test_ip4_route_ecmp (void)
+{
+	const int ifindex = nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME);
+	const NMPlatformIP4Route rts[] = {
+		{
+			.ifindex = ifindex,
+			.network = nmtst_inet4_from_string ("198.18.6.0"),
+			.plen = 24,
+			.metric = 22989,
+			.gateway = nmtst_inet4_from_string ("198.18.5.1"),
+			.rt_source = NM_IP_CONFIG_SOURCE_USER,
+			.r_rtm_flags = RTNH_F_ONLINK,
+			.weight = 1,
+		},
+		{
+			.ifindex = ifindex,
+			.network = nmtst_inet4_from_string ("198.18.6.0"),
+			.plen = 24,
+			.metric = 22989,
+			.gateway = nmtst_inet4_from_string ("198.18.5.2"),
+			.rt_source = NM_IP_CONFIG_SOURCE_USER,
+			.r_rtm_flags = RTNH_F_ONLINK,
+			.weight = 3,
+		},
+	};
+	gs_unref_ptrarray GPtrArray *routes = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
+	gs_unref_ptrarray GPtrArray *routes_cur = NULL;
+	const NMPlatformIP4Route *r;
+	const NMPObject *obj;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (rts); i++)
+		g_ptr_array_add (routes, nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, (const NMPlatformObject *) &rts[i]));
+
+	/* the two weighted routes are configured as one ECMP route. */
+	g_assert (nm_platform_ip_route_sync (NM_PLATFORM_GET, AF_INET, ifindex, routes, NULL, NULL));
+
+	r = nmtstp_ip4_route_get (NM_PLATFORM_GET, ifindex, rts[0].network, rts[0].plen, rts[0].metric, 0);
+	g_assert (r);
+	g_assert_cmpint (r->n_nexthops, ==, 2);
+	g_assert_cmpint (r->weight, ==, 1);
+	g_assert_cmpint (r->gateway, ==, rts[0].gateway);
+
+	obj = NMP_OBJECT_UP_CAST (r);
+	g_assert_cmpint (nmp_object_ip_route_get_n_extra_nexthops (obj), ==, 1);
+	g_assert_cmpint (obj->_ip4_route.extra_nexthops[0].ifindex, ==, ifindex);
+	g_assert_cmpint (obj->_ip4_route.extra_nexthops[0].gateway, ==, rts[1].gateway);
+	g_assert_cmpint (obj->_ip4_route.extra_nexthops[0].weight, ==, 3);
+
+	routes_cur = nmtstp_ip4_route_get_all (NM_PLATFORM_GET, ifindex);
+	g_assert_cmpint (routes_cur->len, ==, 1);
+	nm_clear_pointer (&routes_cur, g_ptr_array_unref);
+
+	/* syncing again keeps the ECMP route. */
+	g_assert (nm_platform_ip_route_sync (NM_PLATFORM_GET, AF_INET, ifindex, routes, NULL, NULL));
+	g_assert (nmtstp_ip4_route_get (NM_PLATFORM_GET, ifindex, rts[0].network, rts[0].plen, rts[0].metric, 0) == r);
+
+	g_assert (nm_platform_ip_route_flush (NM_PLATFORM_GET, AF_INET, ifindex));
+	g_assert (!nmtstp_ip4_route_get (NM_PLATFORM_GET, ifindex, rts[0].network, rts[0].plen, rts[0].metric, 0));
+}
+
+static void
+test_ip4_nexthop (void)
+{
+	const int ifindex = nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME);
+	const NMPlatformIP4Nexthop nexthop = {
+		.id = 4711,
+	};
+	const NMPlatformIP4Route route = {
+		.ifindex = ifindex,
+		.network = nmtst_inet4_from_string ("198.18.4.0"),
+		.plen = 24,
+		.metric = 22988,
+		.rt_source = NM_IP_CONFIG_SOURCE_USER,
+		.nhid = 4711,
+	};
+	nm_auto_nmpobj NMPObject *obj_nexthop = NULL;
+	gs_unref_ptrarray GPtrArray *routes = NULL;
+	const NMPObject *obj;
+	const NMPlatformIP4Route *r;
+	int i;
+
+	nmtstp_ip4_address_add (NM_PLATFORM_GET, -1, ifindex, nmtst_inet4_from_string ("198.18.5.2"), 24,
+	                        nmtst_inet4_from_string ("198.18.5.2"), NM_PLATFORM_LIFETIME_PERMANENT,
+	                        NM_PLATFORM_LIFETIME_PERMANENT, 0, NULL);
+	_wait_for_ipv4_addr_device_route (NM_PLATFORM_GET, 200, ifindex, nmtst_inet4_from_string ("198.18.5.2"), 24);
+
+	if (nmtstp_run_command ("ip nexthop add id 4711 via 198.18.5.1 dev %s", DEVICE_NAME) != 0) {
+		g_test_skip ("Skipping test for nexthops: not supported by kernel");
+		nmtstp_run_command_check ("ip addr flush dev %s", DEVICE_NAME);
+		return;
+	}
+
+	obj_nexthop = nmp_object_new (NMP_OBJECT_TYPE_IP4_NEXTHOP, (const NMPlatformObject *) &nexthop);
+
+	NMTST_WAIT_ASSERT (100, {
+		nmtstp_wait_for_signal (NM_PLATFORM_GET, 10);
+		if (nm_platform_lookup_obj (NM_PLATFORM_GET, NMP_CACHE_ID_TYPE_OBJECT_TYPE, obj_nexthop))
+			break;
+	});
+	obj = nm_platform_lookup_obj (NM_PLATFORM_GET, NMP_CACHE_ID_TYPE_OBJECT_TYPE, obj_nexthop);
+	g_assert_cmpint (NMP_OBJECT_CAST_IP4_NEXTHOP (obj)->ifindex, ==, ifindex);
+	g_assert_cmpint (NMP_OBJECT_CAST_IP4_NEXTHOP (obj)->gateway, ==, nmtst_inet4_from_string ("198.18.5.1"));
+
+	/* kernel reports the device and the gateway of the nexthop for the route,
+	 * while the route that we configure only has the nexthop id. Syncing it
+	 * a second time is a no-op: it is neither replaced nor pruned. */
+	routes = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
+	g_ptr_array_add (routes, nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, (const NMPlatformObject *) &route));
+
+	for (i = 0; i < 2; i++) {
+		gs_unref_ptrarray GPtrArray *routes_prune = NULL;
+
+		routes_prune = nm_platform_ip_route_get_prune_list (NM_PLATFORM_GET,
+		                                                    AF_INET,
+		                                                    ifindex,
+		                                                    NM_IP_ROUTE_TABLE_SYNC_MODE_MAIN);
+		g_assert (nm_platform_ip_route_sync (NM_PLATFORM_GET, AF_INET, ifindex, routes, routes_prune, NULL));
+		nm_platform_process_events (NM_PLATFORM_GET);
+
+		r = nmtstp_ip4_route_get (NM_PLATFORM_GET, ifindex, route.network, route.plen, route.metric, 0);
+		g_assert (r);
+		g_assert_cmpint (r->nhid, ==, 4711);
+		g_assert_cmpint (r->gateway, ==, nmtst_inet4_from_string ("198.18.5.1"));
+		g_assert_cmpint (nm_platform_ip4_route_cmp (&route, r, NM_PLATFORM_IP_ROUTE_CMP_TYPE_ID), ==, 0);
+		g_assert_cmpint (nm_platform_ip4_route_cmp (&route, r, NM_PLATFORM_IP_ROUTE_CMP_TYPE_SEMANTICALLY), ==, 0);
+		g_assert (nmp_object_id_equal (routes->pdata[0], NMP_OBJECT_UP_CAST (r)));
+		g_assert_cmpint (nmp_object_id_hash (routes->pdata[0]), ==, nmp_object_id_hash (NMP_OBJECT_UP_CAST (r)));
+	}
+
+	/* deleting the nexthop also removes the route, without RTM_DELROUTE. */
+	g_assert (nm_platform_object_delete (NM_PLATFORM_GET, obj));
+	nm_platform_process_events (NM_PLATFORM_GET);
+	g_assert (!nm_platform_lookup_obj (NM_PLATFORM_GET, NMP_CACHE_ID_TYPE_OBJECT_TYPE, obj_nexthop));
+	g_assert (!nmtstp_ip4_route_get (NM_PLATFORM_GET, ifindex, route.network, route.plen, route.metric, 0));
+
+	nmtstp_run_command_check ("ip addr flush dev %s", DEVICE_NAME);
+}
+
+static void
+test_ip4_nexthop_sync (void)
+{
+	const int ifindex = nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME);
+	NMPlatformIP4Nexthop nexthop = {
+		.id = 4712,
+		.ifindex = ifindex,
+		.gateway = nmtst_inet4_from_string ("198.18.6.1"),
+		.nh_source = NM_IP_CONFIG_SOURCE_USER,
+	};
+	const NMPlatformIP4Route route = {
+		.ifindex = ifindex,
+		.network = nmtst_inet4_from_string ("198.18.7.0"),
+		.plen = 24,
+		.metric = 22988,
+		.rt_source = NM_IP_CONFIG_SOURCE_USER,
+		.nhid = 4712,
+	};
+	gs_unref_ptrarray GPtrArray *nexthops = NULL;
+	const NMPObject *obj;
+	const NMPlatformIP4Route *r;
+	int ret;
+
+	nmtstp_ip4_address_add (NM_PLATFORM_GET, -1, ifindex, nmtst_inet4_from_string ("198.18.6.2"), 24,
+	                        nmtst_inet4_from_string ("198.18.6.2"), NM_PLATFORM_LIFETIME_PERMANENT,
+	                        NM_PLATFORM_LIFETIME_PERMANENT, 0, NULL);
+	_wait_for_ipv4_addr_device_route (NM_PLATFORM_GET, 200, ifindex, nmtst_inet4_from_string ("198.18.6.2"), 24);
+
+	nexthops = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
+	g_ptr_array_add (nexthops, nmp_object_new (NMP_OBJECT_TYPE_IP4_NEXTHOP, (const NMPlatformObject *) &nexthop));
+
+	ret = nm_platform_ip_nexthop_add (NM_PLATFORM_GET, NMP_NLM_FLAG_REPLACE, nexthops->pdata[0]);
+	if (ret < 0) {
+		g_test_skip ("Skipping test for nexthops: not supported by kernel");
+		nmtstp_run_command_check ("ip addr flush dev %s", DEVICE_NAME);
+		return;
+	}
+
+	obj = nm_platform_lookup_obj (NM_PLATFORM_GET, NMP_CACHE_ID_TYPE_OBJECT_TYPE, nexthops->pdata[0]);
+	g_assert (obj);
+	g_assert_cmpint (NMP_OBJECT_CAST_IP4_NEXTHOP (obj)->ifindex, ==, ifindex);
+	g_assert_cmpint (NMP_OBJECT_CAST_IP4_NEXTHOP (obj)->gateway, ==, nexthop.gateway);
+
+	/* syncing an unchanged nexthop succeeds and keeps it. */
+	g_assert (nm_platform_ip_nexthop_sync (NM_PLATFORM_GET, AF_INET, ifindex, nexthops, TRUE));
+	nm_platform_process_events (NM_PLATFORM_GET);
+	obj = nm_platform_lookup_obj (NM_PLATFORM_GET, NMP_CACHE_ID_TYPE_OBJECT_TYPE, nexthops->pdata[0]);
+	g_assert (obj);
+	g_assert_cmpint (NMP_OBJECT_CAST_IP4_NEXTHOP (obj)->gateway, ==, nexthop.gateway);
+
+	g_assert_cmpint (nm_platform_ip4_route_add (NM_PLATFORM_GET, NMP_NLM_FLAG_REPLACE, &route), ==, 0);
+	r = nmtstp_ip4_route_get (NM_PLATFORM_GET, ifindex, route.network, route.plen, route.metric, 0);
+	g_assert (r);
+	g_assert_cmpint (r->nhid, ==, 4712);
+
+	/* failover: the nexthop gets a new gateway, the route is not touched. */
+	nexthop.gateway = nmtst_inet4_from_string ("198.18.6.254");
+	g_ptr_array_set_size (nexthops, 0);
+	g_ptr_array_add (nexthops, nmp_object_new (NMP_OBJECT_TYPE_IP4_NEXTHOP, (const NMPlatformObject *) &nexthop));
+	g_assert (nm_platform_ip_nexthop_sync (NM_PLATFORM_GET, AF_INET, ifindex, nexthops, TRUE));
+	nm_platform_process_events (NM_PLATFORM_GET);
+	obj = nm_platform_lookup_obj (NM_PLATFORM_GET, NMP_CACHE_ID_TYPE_OBJECT_TYPE, nexthops->pdata[0]);
+	g_assert (obj);
+	g_assert_cmpint (NMP_OBJECT_CAST_IP4_NEXTHOP (obj)->gateway, ==, nexthop.gateway);
+	r = nmtstp_ip4_route_get (NM_PLATFORM_GET, ifindex, route.network, route.plen, route.metric, 0);
+	g_assert (r);
+	g_assert_cmpint (r->nhid, ==, 4712);
+
+	/* without prune, other nexthops stay. */
+	g_assert (nm_platform_ip_nexthop_sync (NM_PLATFORM_GET, AF_INET, ifindex, NULL, FALSE));
+	nm_platform_process_events (NM_PLATFORM_GET);
+	g_assert (nm_platform_lookup_obj (NM_PLATFORM_GET, NMP_CACHE_ID_TYPE_OBJECT_TYPE, nexthops->pdata[0]));
+
+	/* pruning the nexthop also removes the route, without RTM_DELROUTE. */
+	g_assert (nm_platform_ip_nexthop_sync (NM_PLATFORM_GET, AF_INET, ifindex, NULL, TRUE));
+	nm_platform_process_events (NM_PLATFORM_GET);
+	g_assert (!nm_platform_lookup_obj (NM_PLATFORM_GET, NMP_CACHE_ID_TYPE_OBJECT_TYPE, nexthops->pdata[0]));
+	g_assert (!nmtstp_ip4_route_get (NM_PLATFORM_GET, ifindex, route.network, route.plen, route.metric, 0));
+
+	nmtstp_run_command_check ("ip addr flush dev %s", DEVICE_NAME);
+}
+
 static void
 test_ip6_route (void)
 {
@@ -492,12 +1308,14 @@ test_ip4_route_options (gconstpointer test_data)
 			.plen = 24,
 			.metric = 20,
 			.tos = 0x28,
-			.window = 10000,
-			.cwnd = 16,
-			.initcwnd = 30,
-			.initrwnd = 50,
-			.mtu = 1350,
-			.lock_cwnd = TRUE,
+			.metrics = nm_platform_ip_route_metrics_intern (&((NMPlatformIPRouteMetrics) {
+				.window = 10000,
+				.cwnd = 16,
+				.initcwnd = 30,
+				.initrwnd = 50,
+				.mtu = 1350,
+				.lock_cwnd = TRUE,
+			})),
 		});
 		break;
 	case 2:
@@ -635,12 +1453,14 @@ test_ip6_route_options (gconstpointer test_data)
 			.plen = 64,
 			.gateway = in6addr_any,
 			.metric = 1024,
-			.window = 20000,
-			.cwnd = 8,
-			.initcwnd = 22,
-			.initrwnd = 33,
-			.mtu = 1300,
-			.lock_mtu = TRUE,
+			.metrics = nm_platform_ip_route_metrics_intern (&((NMPlatformIPRouteMetrics) {
+				.window = 20000,
+				.cwnd = 8,
+				.initcwnd = 22,
+				.initrwnd = 33,
+				.mtu = 1300,
+				.lock_mtu = TRUE,
+			})),
 		});
 		break;
 	case 2:
@@ -1541,6 +2361,14 @@ again:
 		nmp_rules_manager_sync (rules_manager, FALSE);
 		g_assert_cmpint (nmtstp_platform_routing_rules_get_count (platform, AF_UNSPEC), ==, objs_sync->len);
 
+		if (objs_sync->len > 0) {
+			/* a tracked rule that was removed externally, is restored by the next sync. */
+			g_assert (nm_platform_object_delete (platform, objs_sync->pdata[0]));
+			g_assert_cmpint (nmtstp_platform_routing_rules_get_count (platform, AF_UNSPEC), ==, objs_sync->len - 1);
+			nmp_rules_manager_sync (rules_manager, FALSE);
+			g_assert_cmpint (nmtstp_platform_routing_rules_get_count (platform, AF_UNSPEC), ==, objs_sync->len);
+		}
+
 		for (i = 0; i < objs_sync->len; i++) {
 			switch (nmtst_get_rand_uint32 () % 3) {
 			case 0:
@@ -1735,6 +2563,11 @@ _nmtstp_setup_tests (void)
 	add_test_func ("/route/ip4", test_ip4_route);
 	add_test_func ("/route/ip6", test_ip6_route);
 	add_test_func ("/route/ip4_metric0", test_ip4_route_metric0);
+	add_test_func ("/route/ip4_sync_many", test_ip4_route_sync_many);
+	add_test_func ("/route/ip4_sync_gateway", test_ip4_route_sync_gateway);
+	add_test_func ("/route/ip4_sync_state", test_ip4_route_sync_state);
+	add_test_func ("/route/ip4_async", test_ip4_route_async);
+	add_test_func ("/route/ip4_change_batch", test_ip4_route_change_batch);
 	add_test_func_data ("/route/ip4_options/1", test_ip4_route_options, GINT_TO_POINTER (1));
 	if (nmtstp_is_root_test ())
 		add_test_func_data ("/route/ip4_options/2", test_ip4_route_options, GINT_TO_POINTER (2));
@@ -1747,6 +2580,12 @@ _nmtstp_setup_tests (void)
 		add_test_func ("/route/ip4_route_get", test_ip4_route_get);
 		add_test_func ("/route/ip6_route_get", test_ip6_route_get);
 		add_test_func ("/route/ip4_zero_gateway", test_ip4_zero_gateway);
+		add_test_func ("/route/ip4_ignore", test_ip4_route_ignore);
+		add_test_func ("/route/ip4_ecmp", test_ip4_route_ecmp);
+		add_test_func ("/route/ip4_nexthop", test_ip4_nexthop);
+		add_test_func ("/route/ip4_nexthop_sync", test_ip4_nexthop_sync);
+		add_test_func ("/route/ip4_record_replay", test_ip4_route_record_replay);
+		add_test_func ("/route/ip4_dump_while_deleting", test_ip4_route_dump_while_deleting);
 	}
 
 	if (nmtstp_is_root_test ()) {